@@ -15,46 +15,161 @@
 #include <linux/wait.h>
 #include <linux/device/class.h>
 #include <linux/types.h>
+#include <linux/kfifo.h>
+#include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
+#include <linux/kref.h>
+#include <linux/idr.h>
+#include <linux/property.h>
+#include <linux/log2.h>
+#include <linux/workqueue.h>
+#include <linux/scatterlist.h>
+#include <asm/unaligned.h>
+
+#include "bhe-enclave.h"
+
+#define PACKET_SIGNATURE ENCLAVE_PACKET_SIGNATURE
+#define RX_BUFFER_SIZE 2048     /* default, overridden by "bhe,rx-buffer-size" */
+#define RX_BUFFER_MIN  256
+#define RX_BUFFER_MAX  65536
+#define FRAME_MAX      U16_MAX  /* record length of the per-client kfifo_rec_ptr_2 */
+#define CLIENT_FIFO_MAX (2 * RX_BUFFER_MAX)
+#define HEADER_SIZE ENCLAVE_HEADER_SIZE
+#define RESYNC_SCAN_SIZE 64
+#define TX_BUFFER_SIZE 4096     /* default, overridden by "bhe,tx-buffer-size" */
+#define TX_BUFFER_MAX  131072
+#define MAX_ENCLAVES 16
+
+struct enclave_rx_stats {
+    unsigned long bytes;
+    unsigned long frames;
+    unsigned long resyncs;
+    unsigned long overflows;
+};
 
-static struct serdev_device *serdev_device;
-
-#define PACKET_SIGNATURE 0xBADF00D
-#define BUF_SIZE 2048
-#define RX_BUFFER_SIZE 2048
-#define HEADER_SIZE 8
+struct enclave_tx_stats {
+    unsigned long bytes;
+    unsigned long writes;
+    unsigned long submits;
+    unsigned long wakeups;
+};
 
-static char uart_buffer[BUF_SIZE];
-static size_t buffer_head = 0;
-static size_t buffer_tail = 0;
-static wait_queue_head_t uart_wait_queue;
+/*
+ * One instance per enclave UART.
+ *
+ * RX path: serdev ->receive_buf() is the only producer of rx_fifo and the
+ * frame parser (running in the same context) its only consumer, so neither
+ * side needs a lock. Complete frames are copied into the record kfifo of
+ * every open file whose packet_type filter matches; the receive path is the
+ * only producer of those queues and walks the client list under RCU.
+ */
+struct enclave_dev {
+    struct serdev_device *serdev;
+    struct device *sysfs_dev;
+    struct miscdevice misc;
+    struct kref ref;
+    int id;
+
+    u32 baud;
+    unsigned int rx_size;           /* power of two, also the max frame size */
+    struct kfifo rx_fifo;
+    unsigned char *rx_frame;
+    struct enclave_rx_stats rx_stats;
+    bool rx_in_sync;
+
+    unsigned char root_state;
+    unsigned char version;
+
+    struct list_head client_list;
+    spinlock_t client_lock;
+
+    /*
+     * TX path: writers (serialised by write_lock) are the only producer of
+     * tx_fifo and tx_work its only consumer. Back-to-back writes accumulate
+     * in the ring and go out in as few serdev submissions as the tty layer
+     * accepts; ->write_wakeup() requeues tx_work when it has room again.
+     */
+    unsigned int tx_size;
+    struct kfifo tx_fifo;
+    struct work_struct tx_work;
+    wait_queue_head_t tx_wait;
+    struct enclave_tx_stats tx_stats;
+    struct mutex write_lock;
+    struct mutex tx_lock;           /* serdev submissions vs. removal */
+    bool dead;
+};
 
-static char rx_buffer[RX_BUFFER_SIZE];
-static size_t rx_buffer_pos = 0;
-static DEFINE_MUTEX(buffer_lock);
+struct enclave_client {
+    struct enclave_dev *enclave;
+    struct list_head node;
+    struct kfifo_rec_ptr_2 fifo;    /* one record per packet */
+    wait_queue_head_t wait;
+    struct mutex read_lock;         /* serialises readers of this file */
+    u32 filter;
+};
 
 static int baud_rate = 9600;
 
-static unsigned char root_state = 0;
-static unsigned char version = 0;
-
 static struct class *enclave_class;
+static DEFINE_IDA(enclave_ida);
 
 static ssize_t root_state_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
-    return scnprintf(buf, PAGE_SIZE, "%u\n", root_state);
+    struct enclave_dev *enclave = dev_get_drvdata(dev);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(enclave->root_state));
 }
 
 static ssize_t version_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
-    return scnprintf(buf, PAGE_SIZE, "%u\n", version);
+    struct enclave_dev *enclave = dev_get_drvdata(dev);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(enclave->version));
+}
+
+static ssize_t rx_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct enclave_dev *enclave = dev_get_drvdata(dev);
+    struct enclave_rx_stats *stats = &enclave->rx_stats;
+
+    return scnprintf(buf, PAGE_SIZE, "bytes: %lu\nframes: %lu\nresyncs: %lu\noverflows: %lu\n",
+                     READ_ONCE(stats->bytes), READ_ONCE(stats->frames),
+                     READ_ONCE(stats->resyncs), READ_ONCE(stats->overflows));
+}
+
+static ssize_t tx_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct enclave_dev *enclave = dev_get_drvdata(dev);
+    struct enclave_tx_stats *stats = &enclave->tx_stats;
+
+    return scnprintf(buf, PAGE_SIZE, "bytes: %lu\nwrites: %lu\nsubmits: %lu\nwakeups: %lu\n"
+                     "pending: %u\n",
+                     READ_ONCE(stats->bytes), READ_ONCE(stats->writes),
+                     READ_ONCE(stats->submits), READ_ONCE(stats->wakeups),
+                     kfifo_len(&enclave->tx_fifo));
+}
+
+static ssize_t baud_rate_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct enclave_dev *enclave = dev_get_drvdata(dev);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", enclave->baud);
 }
 
 static DEVICE_ATTR_RO(root_state);
 static DEVICE_ATTR_RO(version);
+static DEVICE_ATTR_RO(rx_stats);
+static DEVICE_ATTR_RO(tx_stats);
+static DEVICE_ATTR_RO(baud_rate);
 
 static struct attribute *enclave_attrs[] = {
     &dev_attr_root_state.attr,
     &dev_attr_version.attr,
+    &dev_attr_rx_stats.attr,
+    &dev_attr_tx_stats.attr,
+    &dev_attr_baud_rate.attr,
     NULL,
 };
 
@@ -62,230 +177,638 @@ static const struct attribute_group enclave_group = {
     .attrs = enclave_attrs,
 };
 
+static void enclave_release(struct kref *ref)
+{
+    struct enclave_dev *enclave = container_of(ref, struct enclave_dev, ref);
+
+    /* A writer may have queued tx_work just before the device went away. */
+    cancel_work_sync(&enclave->tx_work);
+    kfifo_free(&enclave->tx_fifo);
+    kfifo_free(&enclave->rx_fifo);
+    kfree(enclave->rx_frame);
+    kfree(enclave->misc.name);
+    ida_simple_remove(&enclave_ida, enclave->id);
+    kfree(enclave);
+}
+
+/*
+ * Counters have a single writer (the receive path, tx_work or a writer
+ * holding write_lock); sysfs reads them locklessly.
+ */
+static inline void stats_add(unsigned long *counter, unsigned long n)
+{
+    WRITE_ONCE(*counter, *counter + n);
+}
+
+/* Hand as much of tx_fifo to serdev as it takes, without copying. */
+static void enclave_tx_work(struct work_struct *work)
+{
+    struct enclave_dev *enclave = container_of(work, struct enclave_dev, tx_work);
+    struct scatterlist sg[2];
+    unsigned int nents, i, sent = 0;
+    int ret;
+
+    mutex_lock(&enclave->tx_lock);
+    if (enclave->dead)
+        goto out;
+
+    sg_init_table(sg, ARRAY_SIZE(sg));
+    nents = kfifo_dma_out_prepare(&enclave->tx_fifo, sg, ARRAY_SIZE(sg),
+                                  kfifo_len(&enclave->tx_fifo));
+    for (i = 0; i < nents; i++) {
+        ret = serdev_device_write_buf(enclave->serdev, sg_virt(&sg[i]), sg[i].length);
+        if (ret <= 0)
+            break;
+        stats_add(&enclave->tx_stats.submits, 1);
+        sent += ret;
+        if (ret < sg[i].length)
+            break;
+    }
+
+    if (sent) {
+        kfifo_dma_out_finish(&enclave->tx_fifo, sent);
+        stats_add(&enclave->tx_stats.bytes, sent);
+        wake_up_interruptible_all(&enclave->tx_wait);
+    }
+out:
+    mutex_unlock(&enclave->tx_lock);
+}
+
 static void uart_write_wakeup(struct serdev_device *serdev)
 {
-    printk(KERN_INFO "UART write wakeup for %s\n", dev_name(&serdev->dev));
+    struct enclave_dev *enclave = serdev_device_get_drvdata(serdev);
+
+    stats_add(&enclave->tx_stats.wakeups, 1);
+    if (!kfifo_is_empty(&enclave->tx_fifo))
+        schedule_work(&enclave->tx_work);
+    else
+        wake_up_interruptible_all(&enclave->tx_wait);
 }
 
-static int uart_receive_buf(struct serdev_device *serdev, const unsigned char *data, size_t count)
+/* Drop @n bytes from the head of rx_fifo without copying them out. */
+static inline void rx_fifo_skip(struct enclave_dev *enclave, unsigned int n)
 {
-    size_t i;
-    u16 packet_type;
-    u32 payload_size;
-    unsigned char *payload;
-    u32 signature;
+    kfifo_dma_out_finish(&enclave->rx_fifo, n);
+}
 
-    if (!data || count == 0) {
-        printk(KERN_ERR "Invalid receive_buf parameters\n");
-        return 0;
+/*
+ * Discard bytes up to the next position that may hold PACKET_SIGNATURE.
+ * The head is compared a 32-bit word at a time against the signature; if no
+ * candidate is found in the scanned window its last three bytes are kept, as
+ * they may be the start of a signature whose tail has not arrived yet.
+ */
+static void rx_resync(struct enclave_dev *enclave)
+{
+    u8 scan[RESYNC_SCAN_SIZE] __aligned(4);
+    unsigned int len, i;
+
+    len = kfifo_out_peek(&enclave->rx_fifo, scan, sizeof(scan));
+    for (i = 1; i + 4 <= len; i++) {
+        if (get_unaligned_le32(&scan[i]) == PACKET_SIGNATURE) {
+            rx_fifo_skip(enclave, i);
+            return;
+        }
     }
 
-    if (rx_buffer_pos + count > RX_BUFFER_SIZE) {
-        printk(KERN_ERR "Receive buffer overflow\n");
-        rx_buffer_pos = 0;
-        return 0;
+    rx_fifo_skip(enclave, len > 3 ? len - 3 : 1);
+}
+
+static void handle_state_update(struct enclave_dev *enclave, const unsigned char *payload,
+                                u16 payload_size)
+{
+    if (payload_size < 2) {
+        dev_err(&enclave->serdev->dev, "State Update packet payload too small\n");
+        return;
     }
 
-    memcpy(&rx_buffer[rx_buffer_pos], data, count);
-    rx_buffer_pos += count;
+    WRITE_ONCE(enclave->root_state, payload[0]);
+    WRITE_ONCE(enclave->version, payload[1]);
+    dev_info(&enclave->serdev->dev, "State Update Packet Received\n");
+    dev_info(&enclave->serdev->dev, "Root State: %u\n", payload[0]);
+    dev_info(&enclave->serdev->dev, "Version: %u\n", payload[1]);
+}
+
+/* Queue rx_frame on every client that asked for @packet_type. */
+static void deliver_packet(struct enclave_dev *enclave, u16 packet_type, unsigned int frame_len)
+{
+    struct enclave_client *client;
+    u32 filter;
+
+    rcu_read_lock();
+    list_for_each_entry_rcu(client, &enclave->client_list, node) {
+        filter = READ_ONCE(client->filter);
+        if (filter != ENCLAVE_FILTER_ANY && filter != packet_type)
+            continue;
 
-    while (rx_buffer_pos >= HEADER_SIZE) {
-        signature = le32_to_cpu(*((u32 *)rx_buffer));
-        if (signature != PACKET_SIGNATURE) {
-            printk(KERN_WARNING "Invalid packet signature, discarding byte\n");
-            memmove(rx_buffer, &rx_buffer[1], --rx_buffer_pos);
+        if (!kfifo_in(&client->fifo, enclave->rx_frame, frame_len)) {
+            stats_add(&enclave->rx_stats.overflows, 1);
+            dev_warn_ratelimited(&enclave->serdev->dev, "Client queue full, dropping packet\n");
             continue;
         }
+        wake_up_interruptible_poll(&client->wait, EPOLLIN | EPOLLRDNORM);
+    }
+    rcu_read_unlock();
+}
 
-        packet_type = le16_to_cpu(*((u16 *)(rx_buffer + 4)));
-        payload_size = le16_to_cpu(*((u16 *)(rx_buffer + 6)));
+static void rx_parse_frames(struct enclave_dev *enclave)
+{
+    struct enclave_rx_stats *stats = &enclave->rx_stats;
+    u8 header[HEADER_SIZE];
+    u16 packet_type;
+    u32 payload_size;
+    unsigned int frame_len;
+
+    while (kfifo_len(&enclave->rx_fifo) >= HEADER_SIZE) {
+        kfifo_out_peek(&enclave->rx_fifo, header, HEADER_SIZE);
+
+        if (get_unaligned_le32(header) != PACKET_SIGNATURE) {
+            if (enclave->rx_in_sync) {
+                stats_add(&stats->resyncs, 1);
+                dev_warn_ratelimited(&enclave->serdev->dev,
+                                     "Invalid packet signature, resyncing\n");
+                enclave->rx_in_sync = false;
+            }
+            rx_resync(enclave);
+            continue;
+        }
 
-        if (rx_buffer_pos < HEADER_SIZE + payload_size)
+        packet_type = get_unaligned_le16(header + 4);
+        payload_size = get_unaligned_le16(header + 6);
+        frame_len = HEADER_SIZE + payload_size;
+
+        /*
+         * A frame that can never fit the ring, or a client record, is a
+         * false signature match.
+         */
+        if (frame_len > enclave->rx_size || frame_len > FRAME_MAX) {
+            if (enclave->rx_in_sync)
+                stats_add(&stats->resyncs, 1);
+            dev_warn_ratelimited(&enclave->serdev->dev,
+                                 "Oversized packet (%u bytes), resyncing\n", frame_len);
+            enclave->rx_in_sync = false;
+            rx_fifo_skip(enclave, 1);
+            continue;
+        }
+
+        if (kfifo_len(&enclave->rx_fifo) < frame_len)
             break;
 
-        payload = &rx_buffer[HEADER_SIZE];
+        enclave->rx_in_sync = true;
+        kfifo_out(&enclave->rx_fifo, enclave->rx_frame, frame_len);
+        stats_add(&stats->frames, 1);
 
         if (packet_type == 0x0004) {
-            if (payload_size >= 2) {
-                root_state = payload[0];
-                version = payload[1];
-                printk(KERN_INFO "State Update Packet Received\n");
-                printk(KERN_INFO "Root State: %u\n", root_state);
-                printk(KERN_INFO "Version: %u\n", version);
-            } else {
-                printk(KERN_ERR "State Update packet payload too small\n");
-            }
-        } else {
-            printk(KERN_INFO "Unhandled packet type: 0x%04X\n", packet_type);
-            mutex_lock(&buffer_lock);
-            for (i = 0; i < HEADER_SIZE + payload_size; i++) {
-                uart_buffer[buffer_head] = rx_buffer[i];
-                buffer_head = (buffer_head + 1) % BUF_SIZE;
-                if (buffer_head == buffer_tail) {
-                    printk(KERN_WARNING "UART buffer overflow, dropping data\n");
-                    buffer_tail = (buffer_tail + 1) % BUF_SIZE;
-                }
-            }
-            wake_up_interruptible(&uart_wait_queue);
-            mutex_unlock(&buffer_lock);
+            handle_state_update(enclave, &enclave->rx_frame[HEADER_SIZE], payload_size);
+            continue;
         }
 
-        memmove(rx_buffer, &rx_buffer[HEADER_SIZE + payload_size],
-                rx_buffer_pos - (HEADER_SIZE + payload_size));
-        rx_buffer_pos -= (HEADER_SIZE + payload_size);
+        dev_dbg(&enclave->serdev->dev, "Unhandled packet type: 0x%04X\n", packet_type);
+        deliver_packet(enclave, packet_type, frame_len);
+    }
+}
+
+static int uart_receive_buf(struct serdev_device *serdev, const unsigned char *data, size_t count)
+{
+    struct enclave_dev *enclave = serdev_device_get_drvdata(serdev);
+    size_t done = 0;
+    unsigned int copied;
+
+    if (!data || count == 0) {
+        dev_err(&serdev->dev, "Invalid receive_buf parameters\n");
+        return 0;
+    }
+
+    while (done < count) {
+        copied = kfifo_in(&enclave->rx_fifo, data + done, count - done);
+        done += copied;
+        stats_add(&enclave->rx_stats.bytes, copied);
+        rx_parse_frames(enclave);
+
+        /*
+         * The parser always frees space unless the ring holds a partial
+         * frame, which cannot fill it; treat no progress as an overflow.
+         */
+        if (!copied && kfifo_is_full(&enclave->rx_fifo)) {
+            stats_add(&enclave->rx_stats.overflows, 1);
+            dev_err_ratelimited(&serdev->dev, "Receive buffer overflow\n");
+            kfifo_reset_out(&enclave->rx_fifo);
+        }
     }
 
     return count;
 }
 
+static int uart_misc_open(struct inode *inode, struct file *file)
+{
+    struct enclave_dev *enclave = container_of(file->private_data, struct enclave_dev, misc);
+    struct enclave_client *client;
+    int ret;
+
+    client = kzalloc(sizeof(*client), GFP_KERNEL);
+    if (!client)
+        return -ENOMEM;
+
+    /*
+     * Room for at least three maximum-size frames plus their record headers,
+     * bounded so that large rings still hold one.
+     */
+    ret = kfifo_alloc(&client->fifo, min_t(unsigned int, enclave->rx_size * 4, CLIENT_FIFO_MAX),
+                      GFP_KERNEL);
+    if (ret) {
+        kfree(client);
+        return ret;
+    }
+
+    init_waitqueue_head(&client->wait);
+    mutex_init(&client->read_lock);
+    client->filter = ENCLAVE_FILTER_ANY;
+    client->enclave = enclave;
+    kref_get(&enclave->ref);
+    file->private_data = client;
+
+    spin_lock(&enclave->client_lock);
+    list_add_tail_rcu(&client->node, &enclave->client_list);
+    spin_unlock(&enclave->client_lock);
+
+    return nonseekable_open(inode, file);
+}
+
+static int uart_misc_release(struct inode *inode, struct file *file)
+{
+    struct enclave_client *client = file->private_data;
+    struct enclave_dev *enclave = client->enclave;
+
+    spin_lock(&enclave->client_lock);
+    list_del_rcu(&client->node);
+    spin_unlock(&enclave->client_lock);
+
+    /* The receive path may still be queueing into this client. */
+    synchronize_rcu();
+    kfifo_free(&client->fifo);
+    kfree(client);
+    kref_put(&enclave->ref, enclave_release);
+
+    return 0;
+}
+
+/* Returns exactly one packet, header included, per call. */
 static ssize_t uart_misc_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
 {
-    size_t bytes_read = 0;
+    struct enclave_client *client = file->private_data;
+    struct enclave_dev *enclave = client->enclave;
+    unsigned int copied;
+    int ret;
 
-    if (buffer_head == buffer_tail) {
+    if (mutex_lock_interruptible(&client->read_lock))
+        return -ERESTARTSYS;
+
+    while (kfifo_is_empty(&client->fifo)) {
+        mutex_unlock(&client->read_lock);
+        if (READ_ONCE(enclave->dead))
+            return -ENODEV;
         if (file->f_flags & O_NONBLOCK)
             return -EAGAIN;
-        wait_event_interruptible(uart_wait_queue, buffer_head != buffer_tail);
+        ret = wait_event_interruptible(client->wait, !kfifo_is_empty(&client->fifo) ||
+                                       READ_ONCE(enclave->dead));
+        if (ret)
+            return ret;
+        if (mutex_lock_interruptible(&client->read_lock))
+            return -ERESTARTSYS;
     }
 
-    mutex_lock(&buffer_lock);
-    while (buffer_head != buffer_tail && bytes_read < count) {
-        if (put_user(uart_buffer[buffer_tail], &buf[bytes_read])) {
-            mutex_unlock(&buffer_lock);
-            return -EFAULT;
-        }
-        buffer_tail = (buffer_tail + 1) % BUF_SIZE;
-        bytes_read++;
+    /* Never hand out a truncated packet; let the caller retry with room. */
+    if (count < kfifo_peek_len(&client->fifo)) {
+        mutex_unlock(&client->read_lock);
+        return -EMSGSIZE;
     }
-    mutex_unlock(&buffer_lock);
 
-    return bytes_read;
+    ret = kfifo_to_user(&client->fifo, buf, count, &copied);
+    mutex_unlock(&client->read_lock);
+
+    return ret ? ret : copied;
+}
+
+static __poll_t uart_misc_poll(struct file *file, poll_table *wait)
+{
+    struct enclave_client *client = file->private_data;
+    __poll_t mask = EPOLLOUT | EPOLLWRNORM;
+
+    poll_wait(file, &client->wait, wait);
+    poll_wait(file, &client->enclave->tx_wait, wait);
+    if (!kfifo_is_empty(&client->fifo))
+        mask |= EPOLLIN | EPOLLRDNORM;
+    if (kfifo_avail(&client->enclave->tx_fifo) < client->enclave->tx_size / 2)
+        mask &= ~(EPOLLOUT | EPOLLWRNORM);
+    if (READ_ONCE(client->enclave->dead))
+        mask |= EPOLLHUP | EPOLLERR;
+
+    return mask;
+}
+
+static long uart_misc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct enclave_client *client = file->private_data;
+    u32 __user *argp = (u32 __user *)arg;
+    u32 val;
+
+    switch (cmd) {
+    case ENCLAVE_SET_FILTER:
+        if (get_user(val, argp))
+            return -EFAULT;
+        if (val != ENCLAVE_FILTER_ANY && val > U16_MAX)
+            return -EINVAL;
+        WRITE_ONCE(client->filter, val);
+        return 0;
+    case ENCLAVE_GET_FILTER:
+        return put_user(READ_ONCE(client->filter), argp);
+    case ENCLAVE_GET_NEXT_SIZE:
+        mutex_lock(&client->read_lock);
+        val = kfifo_is_empty(&client->fifo) ? 0 : kfifo_peek_len(&client->fifo);
+        mutex_unlock(&client->read_lock);
+        return put_user(val, argp);
+    case ENCLAVE_GET_TX_PENDING:
+        return put_user(kfifo_len(&client->enclave->tx_fifo), argp);
+    default:
+        return -ENOTTY;
+    }
 }
 
+/*
+ * Queue data for transmission and return without waiting for the UART.
+ * A write of up to the TX ring size is queued atomically, so packets from
+ * concurrent writers never interleave; larger writes are queued in
+ * ring-sized chunks. Blocks only while the ring is too full.
+ */
 static ssize_t uart_misc_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
 {
-    int ret;
-    char kbuf_stack[128];
-    char *kbuf = kbuf_stack;
-    bool needs_free = false;
+    struct enclave_client *client = file->private_data;
+    struct enclave_dev *enclave = client->enclave;
+    size_t done = 0;
+    unsigned int chunk, copied;
+    int ret = 0;
 
     if (count == 0)
         return 0;
 
-    if (count > sizeof(kbuf_stack)) {
-        kbuf = kmalloc(count, GFP_KERNEL);
-        if (!kbuf)
-            return -ENOMEM;
-        needs_free = true;
-    }
+    if (mutex_lock_interruptible(&enclave->write_lock))
+        return -ERESTARTSYS;
+
+    while (done < count) {
+        chunk = min_t(size_t, count - done, enclave->tx_size);
+
+        while (kfifo_avail(&enclave->tx_fifo) < chunk) {
+            if (READ_ONCE(enclave->dead)) {
+                ret = -ENODEV;
+                goto out;
+            }
+            if (file->f_flags & O_NONBLOCK) {
+                ret = -EAGAIN;
+                goto out;
+            }
+            ret = wait_event_interruptible(enclave->tx_wait,
+                                           kfifo_avail(&enclave->tx_fifo) >= chunk ||
+                                           READ_ONCE(enclave->dead));
+            if (ret)
+                goto out;
+        }
+
+        ret = kfifo_from_user(&enclave->tx_fifo, buf + done, chunk, &copied);
+        if (ret)
+            goto out;
 
-    if (copy_from_user(kbuf, buf, count)) {
-        if (needs_free)
-            kfree(kbuf);
-        return -EFAULT;
+        done += copied;
+        stats_add(&enclave->tx_stats.writes, 1);
+        schedule_work(&enclave->tx_work);
     }
 
-    ret = serdev_device_write_buf(serdev_device, kbuf, count);
-    if (needs_free)
-        kfree(kbuf);
+out:
+    mutex_unlock(&enclave->write_lock);
 
-    return ret < 0 ? ret : count;
+    return done ? done : ret;
+}
+
+/* Wait until everything queued so far has left the UART. */
+static int uart_misc_fsync(struct file *file, loff_t start, loff_t end, int datasync)
+{
+    struct enclave_client *client = file->private_data;
+    struct enclave_dev *enclave = client->enclave;
+    int ret;
+
+    ret = wait_event_interruptible(enclave->tx_wait, kfifo_is_empty(&enclave->tx_fifo) ||
+                                   READ_ONCE(enclave->dead));
+    if (ret)
+        return ret;
+
+    mutex_lock(&enclave->tx_lock);
+    if (enclave->dead)
+        ret = -ENODEV;
+    else
+        serdev_device_wait_until_sent(enclave->serdev, 0);
+    mutex_unlock(&enclave->tx_lock);
+
+    return ret;
 }
 
 static const struct file_operations uart_fops = {
     .owner = THIS_MODULE,
+    .open = uart_misc_open,
+    .release = uart_misc_release,
     .read = uart_misc_read,
     .write = uart_misc_write,
+    .poll = uart_misc_poll,
+    .fsync = uart_misc_fsync,
+    .unlocked_ioctl = uart_misc_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,
     .llseek = no_llseek,
 };
 
-static struct miscdevice uart_misc_device = {
-    .minor = MISC_DYNAMIC_MINOR,
-    .name = "enclave",
-    .fops = &uart_fops,
-    .mode = 0666,
-};
-
 static const struct serdev_device_ops uart_ops = {
     .receive_buf = uart_receive_buf,
     .write_wakeup = uart_write_wakeup,
 };
 
+/*
+ * Per-instance link settings. "current-speed" is the standard serial
+ * property for the line rate; the module parameter is only the fallback.
+ * "uart-has-rtscts" enables hardware flow control, which is required to run
+ * the link at Mbaud rates without FIFO overruns. Bulk transfers use DMA when
+ * the parent UART node provides "dmas"/"dma-names" (8250_dw), serdev needs
+ * nothing else for that.
+ */
+static int enclave_parse_dt(struct enclave_dev *enclave)
+{
+    struct device *dev = &enclave->serdev->dev;
+    u32 val;
+
+    enclave->baud = baud_rate;
+    if (!device_property_read_u32(dev, "current-speed", &val))
+        enclave->baud = val;
+
+    enclave->rx_size = RX_BUFFER_SIZE;
+    if (!device_property_read_u32(dev, "bhe,rx-buffer-size", &val)) {
+        if (val < RX_BUFFER_MIN || val > RX_BUFFER_MAX) {
+            dev_err(dev, "bhe,rx-buffer-size %u out of range [%u, %u]\n",
+                    val, RX_BUFFER_MIN, RX_BUFFER_MAX);
+            return -EINVAL;
+        }
+        enclave->rx_size = roundup_pow_of_two(val);
+    }
+
+    enclave->tx_size = TX_BUFFER_SIZE;
+    if (!device_property_read_u32(dev, "bhe,tx-buffer-size", &val)) {
+        if (val < RX_BUFFER_MIN || val > TX_BUFFER_MAX) {
+            dev_err(dev, "bhe,tx-buffer-size %u out of range [%u, %u]\n",
+                    val, RX_BUFFER_MIN, TX_BUFFER_MAX);
+            return -EINVAL;
+        }
+        enclave->tx_size = roundup_pow_of_two(val);
+    }
+
+    return 0;
+}
+
 static int my_module_probe(struct serdev_device *serdev)
 {
     struct serdev_controller *ctrl;
-    struct device *sysfs_dev;
+    struct enclave_dev *enclave;
+    unsigned int speed;
     int ret;
 
-    printk(KERN_INFO "UART Probe Called for %s\n", dev_name(&serdev->dev));
-    serdev_device = serdev;
+    dev_info(&serdev->dev, "UART Probe Called\n");
     ctrl = serdev->ctrl;
 
     if (!ctrl) {
-        printk(KERN_ERR "serdev->ctrl is NULL\n");
+        dev_err(&serdev->dev, "serdev->ctrl is NULL\n");
         return -ENODEV;
     }
 
     if (!ctrl->ops) {
-        printk(KERN_ERR "serdev->ctrl->ops is NULL\n");
+        dev_err(&serdev->dev, "serdev->ctrl->ops is NULL\n");
         return -ENODEV;
     }
 
     if (!ctrl->ops->set_baudrate) {
-        printk(KERN_ERR "set_baudrate is not implemented by the controller\n");
+        dev_err(&serdev->dev, "set_baudrate is not implemented by the controller\n");
         return -ENOTSUPP;
     }
 
-    sysfs_dev = device_create(enclave_class, &serdev->dev, 0, NULL, "enclave-%s",
-                              dev_name(&serdev->dev));
-    if (IS_ERR(sysfs_dev)) {
-        printk(KERN_ERR "Failed to create sysfs device: %ld\n", PTR_ERR(sysfs_dev));
-        return PTR_ERR(sysfs_dev);
+    enclave = kzalloc(sizeof(*enclave), GFP_KERNEL);
+    if (!enclave)
+        return -ENOMEM;
+
+    kref_init(&enclave->ref);
+    enclave->serdev = serdev;
+    enclave->rx_in_sync = true;
+    INIT_LIST_HEAD(&enclave->client_list);
+    spin_lock_init(&enclave->client_lock);
+    INIT_WORK(&enclave->tx_work, enclave_tx_work);
+    init_waitqueue_head(&enclave->tx_wait);
+    mutex_init(&enclave->write_lock);
+    mutex_init(&enclave->tx_lock);
+
+    enclave->id = ida_simple_get(&enclave_ida, 0, MAX_ENCLAVES, GFP_KERNEL);
+    if (enclave->id < 0) {
+        ret = enclave->id;
+        kfree(enclave);
+        return ret;
     }
-    dev_set_drvdata(&serdev->dev, sysfs_dev);
 
-    ret = sysfs_create_group(&sysfs_dev->kobj, &enclave_group);
+    ret = enclave_parse_dt(enclave);
+    if (ret)
+        goto err_put;
+
+    ret = kfifo_alloc(&enclave->rx_fifo, enclave->rx_size, GFP_KERNEL);
+    if (ret)
+        goto err_put;
+
+    ret = kfifo_alloc(&enclave->tx_fifo, enclave->tx_size, GFP_KERNEL);
+    if (ret)
+        goto err_put;
+
+    enclave->rx_frame = kmalloc(enclave->rx_size, GFP_KERNEL);
+    enclave->misc.name = kasprintf(GFP_KERNEL, "enclave%d", enclave->id);
+    if (!enclave->rx_frame || !enclave->misc.name) {
+        ret = -ENOMEM;
+        goto err_put;
+    }
+
+    enclave->sysfs_dev = device_create(enclave_class, &serdev->dev, 0, enclave, "enclave-%s",
+                                       dev_name(&serdev->dev));
+    if (IS_ERR(enclave->sysfs_dev)) {
+        ret = PTR_ERR(enclave->sysfs_dev);
+        dev_err(&serdev->dev, "Failed to create sysfs device: %d\n", ret);
+        goto err_put;
+    }
+
+    ret = sysfs_create_group(&enclave->sysfs_dev->kobj, &enclave_group);
     if (ret) {
-        printk(KERN_ERR "Failed to create sysfs group: %d\n", ret);
-        device_destroy(enclave_class, 0);
-        return ret;
+        dev_err(&serdev->dev, "Failed to create sysfs group: %d\n", ret);
+        goto err_device;
     }
 
+    serdev_device_set_drvdata(serdev, enclave);
     serdev_device_set_client_ops(serdev, &uart_ops);
 
     ret = serdev_device_open(serdev);
     if (ret) {
-        printk(KERN_ERR "Failed to open serdev device: %d\n", ret);
-        sysfs_remove_group(&sysfs_dev->kobj, &enclave_group);
-        device_destroy(enclave_class, 0);
-        return ret;
+        dev_err(&serdev->dev, "Failed to open serdev device: %d\n", ret);
+        goto err_group;
     }
 
-    serdev_device_set_baudrate(serdev, baud_rate);
-    init_waitqueue_head(&uart_wait_queue);
-
-    ret = misc_register(&uart_misc_device);
+    speed = serdev_device_set_baudrate(serdev, enclave->baud);
+    if (speed != enclave->baud)
+        dev_warn(&serdev->dev, "Requested %u baud, got %u\n", enclave->baud, speed);
+    enclave->baud = speed;
+    serdev_device_set_flow_control(serdev,
+                                   device_property_read_bool(&serdev->dev, "uart-has-rtscts"));
+
+    enclave->misc.minor = MISC_DYNAMIC_MINOR;
+    enclave->misc.fops = &uart_fops;
+    enclave->misc.mode = 0666;
+    enclave->misc.parent = &serdev->dev;
+    ret = misc_register(&enclave->misc);
     if (ret) {
-        printk(KERN_ERR "Failed to register misc device: %d\n", ret);
-        serdev_device_close(serdev);
-        sysfs_remove_group(&sysfs_dev->kobj, &enclave_group);
-        device_destroy(enclave_class, 0);
-        return ret;
+        dev_err(&serdev->dev, "Failed to register misc device: %d\n", ret);
+        goto err_close;
     }
 
-    printk(KERN_INFO "UART device probed successfully\n");
+    dev_info(&serdev->dev, "UART device probed successfully as /dev/%s at %u baud\n",
+             enclave->misc.name, enclave->baud);
     return 0;
+
+err_close:
+    serdev_device_close(serdev);
+err_group:
+    sysfs_remove_group(&enclave->sysfs_dev->kobj, &enclave_group);
+err_device:
+    device_unregister(enclave->sysfs_dev);
+err_put:
+    kref_put(&enclave->ref, enclave_release);
+    return ret;
 }
 
 static void uart_serdev_remove(struct serdev_device *serdev)
 {
-    struct device *sysfs_dev = dev_get_drvdata(&serdev->dev);
+    struct enclave_dev *enclave = serdev_device_get_drvdata(serdev);
+    struct enclave_client *client;
 
-    printk(KERN_INFO "Removing UART device\n");
-    misc_deregister(&uart_misc_device);
+    dev_info(&serdev->dev, "Removing UART device\n");
+    misc_deregister(&enclave->misc);
+
+    /* Fail further I/O on files that are still open and wake their readers. */
+    mutex_lock(&enclave->tx_lock);
+    WRITE_ONCE(enclave->dead, true);
+    mutex_unlock(&enclave->tx_lock);
     serdev_device_close(serdev);
-    sysfs_remove_group(&sysfs_dev->kobj, &enclave_group);
-    device_destroy(enclave_class, sysfs_dev->devt);
+    spin_lock(&enclave->client_lock);
+    list_for_each_entry(client, &enclave->client_list, node)
+        wake_up_interruptible_poll(&client->wait, EPOLLHUP | EPOLLERR);
+    spin_unlock(&enclave->client_lock);
+    wake_up_interruptible_all(&enclave->tx_wait);
+
+    sysfs_remove_group(&enclave->sysfs_dev->kobj, &enclave_group);
+    device_unregister(enclave->sysfs_dev);
+    kref_put(&enclave->ref, enclave_release);
 }
 
 static const struct of_device_id my_module_of_match[] = {
@@ -293,7 +816,18 @@ static const struct of_device_id my_module_of_match[] = {
     { }
 };
 
-static int enclave_serdev_probe(struct serdev_device *serdev)
+MODULE_DEVICE_TABLE(of, my_module_of_match);
+
+static struct serdev_device_driver my_module_driver = {
+    .driver = {
+        .name = "card-enclave-driver",
+        .of_match_table = my_module_of_match,
+    },
+    .probe = my_module_probe,
+    .remove = uart_serdev_remove,
+};
+
+static int __init enclave_init(void)
 {
     int ret;
 
@@ -303,36 +837,25 @@ static int enclave_serdev_probe(struct serdev_device *serdev)
         return PTR_ERR(enclave_class);
     }
 
-    /* call your existing probe logic */
-    ret = my_module_probe(serdev);
+    ret = serdev_device_driver_register(&my_module_driver);
     if (ret)
         class_destroy(enclave_class);
 
     return ret;
 }
 
-static void enclave_serdev_remove(struct serdev_device *serdev)
+static void __exit enclave_exit(void)
 {
-    uart_serdev_remove(serdev);
+    serdev_device_driver_unregister(&my_module_driver);
     class_destroy(enclave_class);
-
+    ida_destroy(&enclave_ida);
 }
 
-MODULE_DEVICE_TABLE(of, my_module_of_match);
-
-static struct serdev_device_driver my_module_driver = {
-    .driver = {
-        .name = "card-enclave-driver",
-        .of_match_table = my_module_of_match,
-    },
-    .probe = enclave_serdev_probe,
-    .remove = enclave_serdev_remove,
-};
-
-module_serdev_device_driver(my_module_driver);
+module_init(enclave_init);
+module_exit(enclave_exit);
 
 module_param(baud_rate, int, 0644);
-MODULE_PARM_DESC(baud_rate, "UART baud rate (default 9600)");
+MODULE_PARM_DESC(baud_rate, "UART baud rate used when the device tree has no current-speed (default 9600)");
 MODULE_DESCRIPTION("Hello World");
 MODULE_AUTHOR("Matias Sebastian Soler <matias.s.soler@gmail.com>");
 MODULE_VERSION("0.1");
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * bhe-enclave.h - userspace interface of the BHE enclave driver
+ */
+
+#ifndef __BHE_ENCLAVE_H__
+#define __BHE_ENCLAVE_H__
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* Every packet returned by read() starts with this 8-byte header. */
+#define ENCLAVE_PACKET_SIGNATURE   0xBADF00D
+#define ENCLAVE_HEADER_SIZE        8
+
+/* Filter value that lets every packet type through (the default). */
+#define ENCLAVE_FILTER_ANY         0xFFFFFFFFu
+
+/*
+ * ioctl cmd
+ *
+ * ENCLAVE_SET_FILTER: only queue packets whose packet_type equals the
+ *                     argument (or all packets for ENCLAVE_FILTER_ANY) on
+ *                     this file descriptor. Packets already queued stay.
+ * ENCLAVE_GET_FILTER: return the current filter.
+ * ENCLAVE_GET_NEXT_SIZE: return the size of the next queued packet, 0 if
+ *                     the queue is empty.
+ * ENCLAVE_GET_TX_PENDING: return the number of written bytes not yet handed
+ *                     to the UART. fsync() waits until they have been sent.
+ */
+#define ENCLAVE_SET_FILTER     _IOW('E', 0, __u32)
+#define ENCLAVE_GET_FILTER     _IOR('E', 1, __u32)
+#define ENCLAVE_GET_NEXT_SIZE  _IOR('E', 2, __u32)
+#define ENCLAVE_GET_TX_PENDING _IOR('E', 3, __u32)
+
+#endif /* __BHE_ENCLAVE_H__ */
@@ -21,7 +21,12 @@
 #include <linux/module.h>
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
-#include <linux/of_gpio.h>
+#include <linux/gpio/consumer.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/kfifo.h>
+#include <linux/poll.h>
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/clockchips.h>
@@ -34,25 +39,39 @@
 
 #include "motor_24byj48.h"
 
-#define TIMER_LOAD_COUNT0	0x00
-#define TIMER_LOAD_COUNT1	0x04
-#define TIMER_CONTROL_REG3288	0x10
-#define TIMER_CONTROL_REG3399	0x1c
-#define TIMER_INT_STATUS	0x18
-
-#define TIMER_DISABLE		0x0
-#define TIMER_ENABLE		0x1
-#define TIMER_MODE_FREE_RUNNING			(0 << 1)
-#define TIMER_MODE_USER_DEFINED_COUNT		(1 << 1)
-#define TIMER_INT_UNMASK			(1 << 2)
-
-struct rk_timer {
-	void __iomem *base;
-	void __iomem *ctrl;
-	struct clk *timer_clk;
-	struct clk *pclk;
-	u32 freq;
-	bool skipped;
+/*
+ * Half-step coil pattern, bit n drives coil n. All coils of a motor are
+ * written with one gpiod_set_array_value() call, which gpiolib turns into
+ * one set_multiple() per GPIO bank. On v2 banks that is a single
+ * write-masked register write, so the coils never see a mixed phase.
+ */
+static const unsigned long motor_phase_table[8] = {
+	0x1, 0x3, 0x2, 0x6, 0x4, 0xc, 0x8, 0x9,
+};
+
+enum motor_profile_type {
+	MOTOR_PROFILE_NONE,		/* every step at the cruise period */
+	MOTOR_PROFILE_TRAPEZOID,	/* constant acceleration ramps */
+	MOTOR_PROFILE_SCURVE,		/* smoothstep velocity ramps, limited jerk */
+};
+
+/* shortest step period a profile may ask for */
+#define MOTOR_PROFILE_MIN_PERIOD	800000	/*ns*/
+#define MOTOR_PROFILE_MAX_RAMP		1000
+
+/* queued moves per motor and completion events kept for the reader */
+#define MOTOR_CMD_QUEUE_DEPTH		16
+#define MOTOR_EVENT_QUEUE_DEPTH		32	/* power of two */
+
+enum motor_move_type {
+	MOTOR_MOVE_RELATIVE,
+	MOTOR_MOVE_ABSOLUTE,
+};
+
+enum motor_event_status {
+	MOTOR_EVENT_DONE,		/* move finished, position reached */
+	MOTOR_EVENT_STOPPED,		/* move interrupted by MOTOR_STOP/close */
+	MOTOR_EVENT_CANCELLED,		/* queued move dropped before it started */
 };
 
 enum motor_status {
@@ -75,6 +94,36 @@ enum motor_cnt {
 	HAS_MOTOR_CNT,
 };
 
+struct motor_profile {
+	int motor_id;			/* HORIZONTAL_MOTOR or VERTICAL_MOTOR */
+	int profile;			/* enum motor_profile_type */
+	unsigned int start_period;	/* ns */
+	unsigned int cruise_period;	/* ns */
+	unsigned int ramp_steps;
+};
+
+/* MOTOR_QUEUE_MOVE argument */
+struct motor_move_cmd {
+	int motor_id;
+	int type;			/* enum motor_move_type */
+	int steps;			/* relative steps or absolute position */
+	unsigned int cookie;		/* returned in the completion event */
+	/* optional per-move profile, cruise_period == 0 keeps the default */
+	int profile;
+	unsigned int start_period;
+	unsigned int cruise_period;
+	unsigned int ramp_steps;
+};
+
+/* read() returns an array of these */
+struct motor_event {
+	int motor_id;
+	int status;			/* enum motor_event_status */
+	int position;			/* cur_steps after the move */
+	unsigned int cookie;
+	long long timestamp_ns;		/* CLOCK_MONOTONIC */
+};
+
 struct motor_device_attribute {
 	char motor_direction;
 	int max_steps;
@@ -83,10 +132,25 @@ struct motor_device_attribute {
 	int cur_steps;
 	int motor_speed;
 	int reset_point;
-	ktime_t  m_kt;
+	ktime_t next_step;
 	unsigned int timer_count;
-	int motor_gpio[MAX_GPIO_NUM];
+	struct gpio_desc *motor_gpio[MAX_GPIO_NUM];
+	/* array handed to gpiod_set_array_value(), gpio_info is only valid for it */
+	struct gpio_desc **phase_descs;
+	struct gpio_array *gpio_info;
 	enum motor_status motor_current_status;
+	/* acceleration profile */
+	enum motor_profile_type profile;
+	unsigned int start_period;	/* ns, first and last step */
+	unsigned int cruise_period;	/* ns */
+	unsigned int ramp_steps;
+	struct motor_profile dflt;	/* set by MOTOR_SET_PROFILE */
+	/* pending MOTOR_QUEUE_MOVE commands, started back-to-back */
+	struct motor_move_cmd cmd_queue[MOTOR_CMD_QUEUE_DEPTH];
+	unsigned int cmd_head;
+	unsigned int cmd_count;
+	bool cmd_active;		/* current move came from the queue */
+	unsigned int cmd_cookie;
 };
 
 struct motor_message {
@@ -120,115 +184,158 @@ struct motor_device {
 	struct mutex dev_mutex;
 	spinlock_t slock;
 	int motor_open_flag;
-	struct rk_timer rk_timer;
+	struct hrtimer step_timer;	/* one timer clocks every motor */
 	struct motor_device_attribute motors[HAS_MOTOR_CNT];
+	/* completions, produced under slock, consumed by read() */
+	DECLARE_KFIFO(events, struct motor_event, MOTOR_EVENT_QUEUE_DEPTH);
+	wait_queue_head_t event_wait;
+	unsigned int events_lost;
 };
 
-static inline void rk_timer_disable(struct rk_timer *timer)
+static void motor_write_phase(struct motor_device_attribute *motor, unsigned long phase)
 {
-	writel_relaxed(TIMER_DISABLE, timer->ctrl);
+	gpiod_set_array_value(MAX_GPIO_NUM, motor->phase_descs, motor->gpio_info, &phase);
 }
 
-static inline void rk_timer_enable(struct rk_timer *timer, u32 flags)
+void motor_off(struct motor_device_attribute *motor)
 {
-	writel_relaxed(TIMER_ENABLE | TIMER_INT_UNMASK | flags, timer->ctrl);
+	motor_write_phase(motor, 0);
 }
 
-static void rk_timer_update_counter(unsigned long cycles, struct rk_timer *timer)
+static int meter_turn(struct motor_device_attribute *motor)
 {
-	writel_relaxed(cycles, timer->base + TIMER_LOAD_COUNT0);
-	writel_relaxed(0, timer->base + TIMER_LOAD_COUNT1);
+	motor_write_phase(motor, motor_phase_table[motor->timer_count & 7]);
+
+	return 0;
 }
 
-static void rk_timer_interrupt_clear(struct rk_timer *timer)
+/*
+ * Period of the next step of a running motor. The ramp length is capped at
+ * half the move so short moves get a triangular profile; the velocity used
+ * in the maths is in milli-steps per second.
+ */
+static unsigned int motor_step_period(struct motor_device_attribute *motor)
 {
-	writel_relaxed(1, timer->base + TIMER_INT_STATUS);
+	unsigned int done = motor->real_move_steps;
+	unsigned int left = motor->input_move_steps;
+	unsigned int ramp = motor->ramp_steps;
+	unsigned int n;
+	u64 v0, v1, v, x, x2, x3;
+
+	if (motor->profile == MOTOR_PROFILE_NONE || !ramp)
+		return motor->cruise_period;
+
+	ramp = min(ramp, (done + left + 1) / 2);
+	n = min(done, left ? left - 1 : 0);
+	if (n >= ramp)
+		return motor->cruise_period;
+
+	v0 = div_u64(1000ULL * NSEC_PER_SEC, motor->start_period);
+	v1 = div_u64(1000ULL * NSEC_PER_SEC, motor->cruise_period);
+
+	if (motor->profile == MOTOR_PROFILE_TRAPEZOID) {
+		/* v^2 grows linearly with distance under constant acceleration */
+		v = int_sqrt64(v0 * v0 + div_u64((v1 * v1 - v0 * v0) * n, ramp));
+	} else {
+		/* smoothstep 3x^2 - 2x^3 in Q16 */
+		x = div_u64((u64)n << 16, ramp);
+		x2 = (x * x) >> 16;
+		x3 = (x2 * x) >> 16;
+		v = v0 + (((v1 - v0) * (3 * x2 - 2 * x3)) >> 16);
+	}
+
+	return (unsigned int)div_u64(1000ULL * NSEC_PER_SEC, max_t(u64, v, 1));
 }
 
-static inline int rk_timer_set_next_event(unsigned long cycles, struct rk_timer *timer)
+static void motor_apply_profile(struct motor_device_attribute *motor, int profile,
+				unsigned int start_period, unsigned int cruise_period,
+				unsigned int ramp_steps)
 {
-	rk_timer_disable(timer);
-	rk_timer_update_counter(cycles, timer);
-	rk_timer_enable(timer, TIMER_MODE_USER_DEFINED_COUNT | TIMER_INT_UNMASK);
-	return 0;
+	motor->profile = profile;
+	motor->start_period = start_period;
+	motor->cruise_period = cruise_period;
+	motor->ramp_steps = ramp_steps;
 }
 
-static __maybe_unused int rk_timer_set_periodic(unsigned long cycles, struct rk_timer *timer)
+/* Called with slock held. */
+static void motor_post_event(struct motor_device *mdev, int motor_id, int status,
+			     unsigned int cookie)
 {
-	rk_timer_disable(timer);
-	rk_timer_update_counter(cycles, timer);
-	rk_timer_enable(timer, TIMER_MODE_FREE_RUNNING);
-	return 0;
+	struct motor_event ev = {
+		.motor_id = motor_id,
+		.status = status,
+		.position = mdev->motors[motor_id].cur_steps,
+		.cookie = cookie,
+		.timestamp_ns = ktime_get_ns(),
+	};
+
+	if (!kfifo_put(&mdev->events, ev))
+		mdev->events_lost++;
+	wake_up_interruptible(&mdev->event_wait);
 }
 
-void motor_off(struct motor_device_attribute motor)
+/*
+ * Start the next queued move of a stopped motor. Called with slock held,
+ * from the step timer as soon as the previous move ends, so consecutive
+ * moves are separated by one step period and no ioctl round trip.
+ */
+static bool motor_start_next_cmd(struct motor_device *mdev, int motor_id)
 {
-	gpio_set_value(motor.motor_gpio[0], 0);
-	gpio_set_value(motor.motor_gpio[1], 0);
-	gpio_set_value(motor.motor_gpio[2], 0);
-	gpio_set_value(motor.motor_gpio[3], 0);
+	struct motor_device_attribute *motor = &mdev->motors[motor_id];
+	struct motor_move_cmd *cmd;
+	int steps;
+
+	while (motor->cmd_count) {
+		cmd = &motor->cmd_queue[motor->cmd_head];
+		motor->cmd_head = (motor->cmd_head + 1) % MOTOR_CMD_QUEUE_DEPTH;
+		motor->cmd_count--;
+
+		if (cmd->type == MOTOR_MOVE_ABSOLUTE)
+			steps = clamp(cmd->steps, 0, motor->max_steps) - motor->cur_steps;
+		else
+			steps = clamp(motor->cur_steps + cmd->steps, 0, motor->max_steps) -
+				motor->cur_steps;
+
+		if (cmd->cruise_period)
+			motor_apply_profile(motor, cmd->profile, cmd->start_period,
+					    cmd->cruise_period, cmd->ramp_steps);
+		else
+			motor_apply_profile(motor, motor->dflt.profile, motor->dflt.start_period,
+					    motor->dflt.cruise_period, motor->dflt.ramp_steps);
+
+		if (steps == 0) {
+			motor_post_event(mdev, motor_id, MOTOR_EVENT_DONE, cmd->cookie);
+			continue;
+		}
+
+		motor->motor_direction = steps > 0 ? 'R' : 'L';
+		motor->input_move_steps = abs(steps);
+		motor->real_move_steps = 0;
+		motor->motor_current_status = MOTOR_IS_RUNNING;
+		motor->cmd_active = true;
+		motor->cmd_cookie = cmd->cookie;
+		return true;
+	}
+
+	return false;
 }
 
-static int meter_turn(struct motor_device_attribute motor)
+/* Called with slock held when a move has ended, normally or not. */
+static void motor_move_finished(struct motor_device *mdev, int motor_id, int status)
 {
+	struct motor_device_attribute *motor = &mdev->motors[motor_id];
 
-	switch (motor.timer_count) {
-	case 0:
-		gpio_set_value(motor.motor_gpio[0], 1);
-		gpio_set_value(motor.motor_gpio[1], 0);
-		gpio_set_value(motor.motor_gpio[2], 0);
-		gpio_set_value(motor.motor_gpio[3], 0);
-		break;
-	case 1:
-		gpio_set_value(motor.motor_gpio[0], 1);
-		gpio_set_value(motor.motor_gpio[1], 1);
-		gpio_set_value(motor.motor_gpio[2], 0);
-		gpio_set_value(motor.motor_gpio[3], 0);
-		break;
-	case 2:
-		gpio_set_value(motor.motor_gpio[0], 0);
-		gpio_set_value(motor.motor_gpio[1], 1);
-		gpio_set_value(motor.motor_gpio[2], 0);
-		gpio_set_value(motor.motor_gpio[3], 0);
-		break;
-	case 3:
-		gpio_set_value(motor.motor_gpio[0], 0);
-		gpio_set_value(motor.motor_gpio[1], 1);
-		gpio_set_value(motor.motor_gpio[2], 1);
-		gpio_set_value(motor.motor_gpio[3], 0);
-		break;
-	case 4:
-		gpio_set_value(motor.motor_gpio[0], 0);
-		gpio_set_value(motor.motor_gpio[1], 0);
-		gpio_set_value(motor.motor_gpio[2], 1);
-		gpio_set_value(motor.motor_gpio[3], 0);
-		break;
-	case 5:
-		gpio_set_value(motor.motor_gpio[0], 0);
-		gpio_set_value(motor.motor_gpio[1], 0);
-		gpio_set_value(motor.motor_gpio[2], 1);
-		gpio_set_value(motor.motor_gpio[3], 1);
-		break;
-	case 6:
-		gpio_set_value(motor.motor_gpio[0], 0);
-		gpio_set_value(motor.motor_gpio[1], 0);
-		gpio_set_value(motor.motor_gpio[2], 0);
-		gpio_set_value(motor.motor_gpio[3], 1);
-		break;
-	case 7:
-		gpio_set_value(motor.motor_gpio[0], 1);
-		gpio_set_value(motor.motor_gpio[1], 0);
-		gpio_set_value(motor.motor_gpio[2], 0);
-		gpio_set_value(motor.motor_gpio[3], 1);
-		break;
-	}
+	if (!motor->cmd_active)
+		return;
 
-	return 0;
+	motor->cmd_active = false;
+	motor_post_event(mdev, motor_id, status, motor->cmd_cookie);
+	if (status == MOTOR_EVENT_DONE)
+		motor_start_next_cmd(mdev, motor_id);
 }
 
 static void motor_turn_by_id(struct motor_device *mdev, int motor_id)
 {
-	unsigned long flags;
 	if  (mdev->motors[motor_id].motor_direction == 'R') {
 		mdev->motors[motor_id].timer_count++;
 		if (mdev->motors[motor_id].timer_count > 7)
@@ -238,12 +345,10 @@ static void motor_turn_by_id(struct motor_device *mdev, int motor_id)
 			mdev->motors[motor_id].timer_count = 8;
 		mdev->motors[motor_id].timer_count--;
 	}
-	meter_turn(mdev->motors[motor_id]);
+	meter_turn(&mdev->motors[motor_id]);
 	mdev->motors[motor_id].real_move_steps++;
 	mdev->motors[motor_id].input_move_steps--;
 	if (mdev->motors[motor_id].input_move_steps == 0) {
-		mutex_lock(&mdev->dev_mutex);
-		spin_lock_irqsave(&mdev->slock, flags);
 		mdev->motors[motor_id].motor_current_status = MOTOR_IS_STOP;
 		if (mdev->motors[motor_id].motor_direction == 'R')
 			mdev->motors[motor_id].cur_steps = mdev->motors[motor_id].cur_steps +
@@ -253,117 +358,71 @@ static void motor_turn_by_id(struct motor_device *mdev, int motor_id)
 			mdev->motors[motor_id].real_move_steps;
 		mdev->motors[motor_id].input_move_steps = 0;
 		mdev->motors[motor_id].real_move_steps = 0;
-		spin_unlock_irqrestore(&mdev->slock, flags);
-		mutex_unlock(&mdev->dev_mutex);
-		printk("the motor %d steps after stop：%d\n", motor_id, mdev->motors[HORIZONTAL_MOTOR].cur_steps);
-		motor_off(mdev->motors[motor_id]);
+		motor_off(&mdev->motors[motor_id]);
+		motor_move_finished(mdev, motor_id, MOTOR_EVENT_DONE);
 	}
 }
 
-#define SECOND_IN_NS 1000000000u
-
-static inline uint32_t ns_to_rktimer_cycles(uint32_t freq, uint32_t ns)
+/*
+ * Single step engine for all motors: step every motor whose deadline has
+ * passed, then re-arm for the earliest pending deadline. Runs in hard irq
+ * context, so it only takes the spinlock.
+ */
+static enum hrtimer_restart motor_step_timer(struct hrtimer *timer)
 {
-	return ns / (SECOND_IN_NS / freq);
-}
+	struct motor_device *mdev = container_of(timer, struct motor_device, step_timer);
+	struct motor_device_attribute *motor;
+	ktime_t now = hrtimer_cb_get_time(timer);
+	ktime_t next = KTIME_MAX;
+	int index;
 
-static irqreturn_t rk_timer_interrupt(int irq, void *dev_id)
-{
-	struct motor_device *mdev = dev_id;
-	int next_event = 0;
-	rk_timer_interrupt_clear(&mdev->rk_timer);
-	if (mdev->motors[HORIZONTAL_MOTOR].input_move_steps != 0) {
-		next_event = 1;
-		motor_turn_by_id(mdev, HORIZONTAL_MOTOR);
-	}
-	if (mdev->motors[VERTICAL_MOTOR].input_move_steps !=0) {
-		next_event = 1;
-		motor_turn_by_id(mdev, VERTICAL_MOTOR);
-	}
-	if (next_event) {
-		rk_timer_set_next_event(ns_to_rktimer_cycles(mdev->rk_timer.freq, MOTOR_MAX_SPEED), &mdev->rk_timer);
+	spin_lock(&mdev->slock);
+	for (index = 0; index < HAS_MOTOR_CNT; index++) {
+		motor = &mdev->motors[index];
+		if (motor->input_move_steps == 0)
+			continue;
+		if (ktime_compare(motor->next_step, now) <= 0) {
+			motor->next_step = ktime_add_ns(motor->next_step,
+							motor_step_period(motor));
+			/* never try to catch up on steps we were late for */
+			if (ktime_before(motor->next_step, now))
+				motor->next_step = now;
+			motor_turn_by_id(mdev, index);
+			if (motor->input_move_steps == 0)
+				continue;
+		}
+		if (ktime_before(motor->next_step, next))
+			next = motor->next_step;
 	}
-	return IRQ_HANDLED;
-}
+	spin_unlock(&mdev->slock);
 
-static void rk_timer_deinit(struct motor_device *mdev)
-{
-	struct rk_timer *timer = &mdev->rk_timer;
+	if (next == KTIME_MAX)
+		return HRTIMER_NORESTART;
 
-	rk_timer_interrupt_clear(timer);
-	rk_timer_disable(timer);
-
-	clk_disable_unprepare(timer->timer_clk);
-	clk_disable_unprepare(timer->pclk);
-	iounmap(timer->base);
-
-};
+	hrtimer_set_expires(timer, next);
+	return HRTIMER_RESTART;
+}
 
-static struct rk_timer *rk_timer_init(struct platform_device *pdev, struct motor_device *mdev)
+/* Called with mdev->slock held once motors have been given steps. */
+static void motor_engine_kick(struct motor_device *mdev)
 {
-	struct rk_timer *timer = &mdev->rk_timer;
-	struct device_node *np = pdev->dev.of_node;
-	int ret, irq;
-
-	timer->base = of_iomap(np, 0);
-	if (!timer->base) {
-		dev_err(mdev->dev, "Failed to get base address\n");
-		return NULL;
-	}
-
-	timer->ctrl = timer->base + TIMER_CONTROL_REG3288; //TODO: check 3399/3288
-
-	timer->pclk = of_clk_get_by_name(np, "pclk");
-	if (IS_ERR(timer->pclk)) {
-		dev_err(mdev->dev, "Failed to get pclk\n");
-		goto out_unmap;
-	}
-
-	if (clk_prepare_enable(timer->pclk)) {
-		dev_err(mdev->dev, "Failed to enable pclk\n");
-		goto out_unmap;
-	}
-
-	timer->timer_clk = of_clk_get_by_name(np, "timer");
-	if (IS_ERR(timer->timer_clk)) {
-		dev_err(mdev->dev, "Failed to get timer clock\n");
-		goto out_timer_clk;
-	}
-
-	if (clk_prepare_enable(timer->timer_clk)) {
-		dev_err(mdev->dev, "Failed to enable timer clock\n");
-		goto out_timer_clk;
-	}
-
-	timer->freq = clk_get_rate(timer->timer_clk);
-	dev_info(mdev->dev, "Timer clk is %d\n", timer->freq);
-
-	irq = irq_of_parse_and_map(np, 0);
-	if (!irq) {
-		dev_err(mdev->dev, "Failed to map interrupts for\n");
-		goto out_irq;
-	}
-
-	rk_timer_interrupt_clear(timer);
-	rk_timer_disable(timer);
+	ktime_t now = ktime_get();
+	ktime_t next = KTIME_MAX;
+	struct motor_device_attribute *motor;
+	int index;
 
-	ret = devm_request_irq(mdev->dev, irq, rk_timer_interrupt,
-			       IRQF_TIMER, dev_name(mdev->dev), mdev);
-	if (ret) {
-		dev_err(mdev->dev, "Failed to initialize: %d\n", ret);
-		goto out_irq;
+	for (index = 0; index < HAS_MOTOR_CNT; index++) {
+		motor = &mdev->motors[index];
+		if (motor->input_move_steps == 0)
+			continue;
+		if (motor->real_move_steps == 0)
+			motor->next_step = now;
+		if (ktime_before(motor->next_step, next))
+			next = motor->next_step;
 	}
 
-	return timer;
-
-out_irq:
-	clk_disable_unprepare(timer->timer_clk);
-out_timer_clk:
-	clk_disable_unprepare(timer->pclk);
-out_unmap:
-	iounmap(timer->base);
-
-	return NULL;
+	if (next != KTIME_MAX)
+		hrtimer_start(&mdev->step_timer, next, HRTIMER_MODE_ABS_HARD);
 }
 
 static void motor_set_default(struct motor_device *mdev)
@@ -381,6 +440,16 @@ static void motor_set_default(struct motor_device *mdev)
 		motor->motor_speed = MOTOR_MIN_SPEED;
 		motor->motor_current_status = MOTOR_IS_STOP;
 		motor->reset_point = motor->max_steps >> 1;
+		motor->dflt.motor_id = index;
+		motor->dflt.profile = MOTOR_PROFILE_NONE;
+		motor->dflt.start_period = MOTOR_MIN_SPEED;
+		motor->dflt.cruise_period = MOTOR_MAX_SPEED;
+		motor->dflt.ramp_steps = 0;
+		motor_apply_profile(motor, MOTOR_PROFILE_NONE, MOTOR_MIN_SPEED,
+				    MOTOR_MAX_SPEED, 0);
+		motor->cmd_head = 0;
+		motor->cmd_count = 0;
+		motor->cmd_active = false;
 	}
 }
 
@@ -438,6 +507,10 @@ static long motor_ops_move(struct motor_device *mdev, int x, int y)
 	mutex_lock(&mdev->dev_mutex);
 	spin_lock_irqsave(&mdev->slock, flags);
 	if (x1 > 0) {
+		motor_apply_profile(&motors[HORIZONTAL_MOTOR], motors[HORIZONTAL_MOTOR].dflt.profile,
+				    motors[HORIZONTAL_MOTOR].dflt.start_period,
+				    motors[HORIZONTAL_MOTOR].dflt.cruise_period,
+				    motors[HORIZONTAL_MOTOR].dflt.ramp_steps);
 		mdev->motors[HORIZONTAL_MOTOR].motor_current_status =
 			MOTOR_IS_RUNNING;
 		mdev->motors[HORIZONTAL_MOTOR].input_move_steps = x1;
@@ -445,15 +518,19 @@ static long motor_ops_move(struct motor_device *mdev, int x, int y)
 		mdev->motors[HORIZONTAL_MOTOR].motor_direction = x_dir;
 	}
 	if (y1 > 0) {
+		motor_apply_profile(&motors[VERTICAL_MOTOR], motors[VERTICAL_MOTOR].dflt.profile,
+				    motors[VERTICAL_MOTOR].dflt.start_period,
+				    motors[VERTICAL_MOTOR].dflt.cruise_period,
+				    motors[VERTICAL_MOTOR].dflt.ramp_steps);
 		mdev->motors[VERTICAL_MOTOR].motor_current_status =
 			MOTOR_IS_RUNNING;
 		mdev->motors[VERTICAL_MOTOR].input_move_steps = y1;
 		mdev->motors[VERTICAL_MOTOR].real_move_steps = 0;
 		mdev->motors[VERTICAL_MOTOR].motor_direction = y_dir;
 	}
+	motor_engine_kick(mdev);
 	spin_unlock_irqrestore(&mdev->slock, flags);
 	mutex_unlock(&mdev->dev_mutex);
-	rk_timer_set_next_event(ns_to_rktimer_cycles(mdev->rk_timer.freq, MOTOR_MAX_SPEED), &mdev->rk_timer);
 	return 0;
 }
 
@@ -466,20 +543,16 @@ static void motor_ops_stop(struct motor_device *mdev)
 	if (mdev->motors[HORIZONTAL_MOTOR].motor_current_status ==
 			MOTOR_IS_STOP &&
 		mdev->motors[VERTICAL_MOTOR].motor_current_status ==
-			MOTOR_IS_STOP)
+			MOTOR_IS_STOP &&
+		!mdev->motors[HORIZONTAL_MOTOR].cmd_count &&
+		!mdev->motors[VERTICAL_MOTOR].cmd_count)
 		return;
-	if (mdev->motors[HORIZONTAL_MOTOR].motor_current_status !=
-			MOTOR_IS_STOP) {
-		motor_off(mdev->motors[HORIZONTAL_MOTOR]);
-	}
-	if (mdev->motors[VERTICAL_MOTOR].motor_current_status !=
-			MOTOR_IS_STOP) {
-		motor_off(mdev->motors[VERTICAL_MOTOR]);
-	}
 	mutex_lock(&mdev->dev_mutex);
 	spin_lock_irqsave(&mdev->slock, flags);
 
 	for (index = 0; index < HAS_MOTOR_CNT; index++) {
+		if (motors[index].motor_current_status != MOTOR_IS_STOP)
+			motor_off(&motors[index]);
 		motors[index].motor_current_status = MOTOR_IS_STOP;
 		if (mdev->motors[index].motor_direction == 'R')
 			mdev->motors[index].cur_steps = mdev->motors[index].cur_steps +
@@ -489,6 +562,14 @@ static void motor_ops_stop(struct motor_device *mdev)
 			motors[index].real_move_steps;
 		motors[index].input_move_steps = 0;
 		motors[index].real_move_steps = 0;
+		motor_move_finished(mdev, index, MOTOR_EVENT_STOPPED);
+		while (motors[index].cmd_count) {
+			motor_post_event(mdev, index, MOTOR_EVENT_CANCELLED,
+					 motors[index].cmd_queue[motors[index].cmd_head].cookie);
+			motors[index].cmd_head = (motors[index].cmd_head + 1) %
+						 MOTOR_CMD_QUEUE_DEPTH;
+			motors[index].cmd_count--;
+		}
 	}
 
 	spin_unlock_irqrestore(&mdev->slock, flags);
@@ -509,6 +590,90 @@ static int motor_speed(struct motor_device *mdev, struct motors_input_speed spee
 	return 0;
 }
 
+static int motor_check_profile(int profile, unsigned int start_period,
+			       unsigned int cruise_period, unsigned int ramp_steps)
+{
+	if (profile < MOTOR_PROFILE_NONE || profile > MOTOR_PROFILE_SCURVE)
+		return -EINVAL;
+	if (cruise_period < MOTOR_PROFILE_MIN_PERIOD || cruise_period > MOTOR_MIN_SPEED)
+		return -EINVAL;
+	if (profile != MOTOR_PROFILE_NONE &&
+		(start_period < cruise_period || start_period > MOTOR_MIN_SPEED ||
+		 ramp_steps > MOTOR_PROFILE_MAX_RAMP))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int motor_set_profile(struct motor_device *mdev, struct motor_profile *prof)
+{
+	struct motor_device_attribute *motor;
+	unsigned long flags;
+
+	if (prof->motor_id < 0 || prof->motor_id >= HAS_MOTOR_CNT)
+		return -EINVAL;
+	if (motor_check_profile(prof->profile, prof->start_period,
+				prof->cruise_period, prof->ramp_steps))
+		return -EINVAL;
+
+	motor = &mdev->motors[prof->motor_id];
+	mutex_lock(&mdev->dev_mutex);
+	spin_lock_irqsave(&mdev->slock, flags);
+	if (motor->motor_current_status == MOTOR_IS_RUNNING) {
+		spin_unlock_irqrestore(&mdev->slock, flags);
+		mutex_unlock(&mdev->dev_mutex);
+		return -EBUSY;
+	}
+	motor->dflt = *prof;
+	motor_apply_profile(motor, prof->profile, prof->start_period,
+			    prof->cruise_period, prof->ramp_steps);
+	spin_unlock_irqrestore(&mdev->slock, flags);
+	mutex_unlock(&mdev->dev_mutex);
+
+	return 0;
+}
+
+/*
+ * Append a move to the motor's queue; an idle motor starts it right away.
+ * Returns -EBUSY if a plain MOTOR_MOVE is in progress and -ENOSPC when the
+ * queue is full.
+ */
+static int motor_queue_move(struct motor_device *mdev, struct motor_move_cmd *cmd)
+{
+	struct motor_device_attribute *motor;
+	unsigned long flags;
+	int ret = 0;
+
+	if (cmd->motor_id < 0 || cmd->motor_id >= HAS_MOTOR_CNT)
+		return -EINVAL;
+	if (cmd->type != MOTOR_MOVE_RELATIVE && cmd->type != MOTOR_MOVE_ABSOLUTE)
+		return -EINVAL;
+	if (cmd->cruise_period &&
+		motor_check_profile(cmd->profile, cmd->start_period,
+				    cmd->cruise_period, cmd->ramp_steps))
+		return -EINVAL;
+
+	motor = &mdev->motors[cmd->motor_id];
+	mutex_lock(&mdev->dev_mutex);
+	spin_lock_irqsave(&mdev->slock, flags);
+	if (motor->motor_current_status == MOTOR_IS_RUNNING && !motor->cmd_active) {
+		ret = -EBUSY;
+	} else if (motor->cmd_count == MOTOR_CMD_QUEUE_DEPTH) {
+		ret = -ENOSPC;
+	} else {
+		motor->cmd_queue[(motor->cmd_head + motor->cmd_count) %
+				 MOTOR_CMD_QUEUE_DEPTH] = *cmd;
+		motor->cmd_count++;
+		if (motor->motor_current_status != MOTOR_IS_RUNNING &&
+			motor_start_next_cmd(mdev, cmd->motor_id))
+			motor_engine_kick(mdev);
+	}
+	spin_unlock_irqrestore(&mdev->slock, flags);
+	mutex_unlock(&mdev->dev_mutex);
+
+	return ret;
+}
+
 static long motor_ops_goback(struct motor_device *mdev)
 {
 	struct motor_device_attribute *motors = mdev->motors;
@@ -663,6 +828,7 @@ static int motor_open(struct inode *inode, struct file *file)
 {
 	struct miscdevice *dev = file->private_data;
 	struct motor_device *mdev = container_of(dev, struct motor_device, misc_dev);
+	unsigned long flags;
 	int ret = 0;
 
 	if (mdev->motor_open_flag) {
@@ -670,6 +836,11 @@ static int motor_open(struct inode *inode, struct file *file)
 		dev_err(mdev->dev, "Motor driver busy now!\n");
 	} else {
 		printk("open motor is success!\n");
+		/* the step timer may still be finishing a move and producing */
+		spin_lock_irqsave(&mdev->slock, flags);
+		kfifo_reset(&mdev->events);
+		mdev->events_lost = 0;
+		spin_unlock_irqrestore(&mdev->slock, flags);
 		mdev->motor_open_flag = 1;
 	}
 
@@ -816,6 +987,30 @@ static long motor_ioctl(struct file *file, unsigned int cmd, unsigned long value
 		}
 		break;
 	}
+	case MOTOR_QUEUE_MOVE: {
+		struct motor_move_cmd cmd;
+
+		if (copy_from_user(&cmd, (void __user *)value,
+			sizeof(struct motor_move_cmd))) {
+			dev_err(mdev->dev, "[%s][%d] copy from user error\n",
+			__func__, __LINE__);
+			return -EFAULT;
+		}
+		ret = motor_queue_move(mdev, &cmd);
+		break;
+	}
+	case MOTOR_SET_PROFILE: {
+		struct motor_profile prof;
+
+		if (copy_from_user(&prof, (void __user *)value,
+			sizeof(struct motor_profile))) {
+			dev_err(mdev->dev, "[%s][%d] copy from user error\n",
+			__func__, __LINE__);
+			return -EFAULT;
+		}
+		ret = motor_set_profile(mdev, &prof);
+		break;
+	}
 	default:
 		return -EINVAL;
 	}
@@ -824,10 +1019,47 @@ static long motor_ioctl(struct file *file, unsigned int cmd, unsigned long value
 
 }
 
+/* Returns as many whole struct motor_event records as fit in @count. */
+static ssize_t motor_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+	struct miscdevice *dev = file->private_data;
+	struct motor_device *mdev = container_of(dev, struct motor_device, misc_dev);
+	unsigned int copied;
+	int ret;
+
+	if (count < sizeof(struct motor_event))
+		return -EINVAL;
+
+	while (kfifo_is_empty(&mdev->events)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(mdev->event_wait,
+					       !kfifo_is_empty(&mdev->events));
+		if (ret)
+			return ret;
+	}
+
+	ret = kfifo_to_user(&mdev->events, buf, count, &copied);
+
+	return ret ? ret : copied;
+}
+
+static __poll_t motor_poll(struct file *file, poll_table *wait)
+{
+	struct miscdevice *dev = file->private_data;
+	struct motor_device *mdev = container_of(dev, struct motor_device, misc_dev);
+
+	poll_wait(file, &mdev->event_wait, wait);
+
+	return kfifo_is_empty(&mdev->events) ? 0 : EPOLLIN | EPOLLRDNORM;
+}
+
 static struct file_operations motor_fops = {
 	.owner = THIS_MODULE,
 	.open = motor_open,
 	.release = motor_release,
+	.read = motor_read,
+	.poll = motor_poll,
 	.unlocked_ioctl = motor_ioctl,
 };
 
@@ -849,268 +1081,62 @@ static const struct proc_ops motor_info_fops = {
 	.proc_release = single_release,
 };
 
+/*
+ * Preferred binding: one 4-line array per motor ("horizontal-gpios",
+ * "vertical-gpios"), which lets gpiolib set all coils with one bank write.
+ * The older motorA..motorH single-line properties are still accepted.
+ */
 static int motor_request_gpio(struct platform_device *pdev, struct motor_device *mdev)
 {
-	int ret;
-	int GPIO_ID_A = -1;
-	int GPIO_ID_B = -1;
-	int GPIO_ID_C = -1;
-	int GPIO_ID_D = -1;
-	int GPIO_ID_E = -1;
-	int GPIO_ID_F = -1;
-	int GPIO_ID_G = -1;
-	int GPIO_ID_H = -1;
-
-	GPIO_ID_A = of_get_named_gpio(pdev->dev.of_node, "motorA-gpios", 0);
-	if (GPIO_ID_A < 0) {
-		printk("get gpioA named is error!\n");
-		return -1;
-	}
-	GPIO_ID_B = of_get_named_gpio(pdev->dev.of_node, "motorB-gpios", 0);
-	if (GPIO_ID_B < 0) {
-		printk("get gpioB named is error!\n");
-		return -1;
-	}
-	GPIO_ID_C = of_get_named_gpio(pdev->dev.of_node, "motorC-gpios", 0);
-	if (GPIO_ID_C < 0) {
-		printk("get gpioC named is error!\n");
-		return -1;
-	}
-	GPIO_ID_D = of_get_named_gpio(pdev->dev.of_node, "motorD-gpios", 0);
-	if (GPIO_ID_D < 0) {
-		printk("get gpioD named is error!\n");
-		return -1;
-	}
-	GPIO_ID_E = of_get_named_gpio(pdev->dev.of_node, "motorE-gpios", 0);
-	if (GPIO_ID_E < 0) {
-		printk("get gpioA named is error!\n");
-		return -1;
-	}
-	GPIO_ID_F = of_get_named_gpio(pdev->dev.of_node, "motorF-gpios", 0);
-	if (GPIO_ID_F < 0) {
-		printk("get gpioB named is error!\n");
-		return -1;
-	}
-	GPIO_ID_G = of_get_named_gpio(pdev->dev.of_node, "motorG-gpios", 0);
-	if (GPIO_ID_G < 0) {
-		printk("get gpioC named is error!\n");
-		return -1;
-	}
-	GPIO_ID_H = of_get_named_gpio(pdev->dev.of_node, "motorH-gpios", 0);
-	if (GPIO_ID_H < 0) {
-		printk("get gpioD named is error!\n");
-		return -1;
-	}
+	static const char * const array_names[HAS_MOTOR_CNT] = {
+		"horizontal", "vertical",
+	};
+	static const char * const line_names[HAS_MOTOR_CNT][MAX_GPIO_NUM] = {
+		{ "motorA", "motorB", "motorC", "motorD" },
+		{ "motorE", "motorF", "motorG", "motorH" },
+	};
+	struct motor_device_attribute *motor;
+	struct gpio_descs *descs;
+	int index, i;
 
+	for (index = 0; index < HAS_MOTOR_CNT; index++) {
+		motor = &mdev->motors[index];
+
+		descs = devm_gpiod_get_array_optional(&pdev->dev, array_names[index],
+						      GPIOD_OUT_LOW);
+		if (IS_ERR(descs))
+			return PTR_ERR(descs);
+		if (descs) {
+			if (descs->ndescs != MAX_GPIO_NUM) {
+				dev_err(&pdev->dev, "%s-gpios needs %d lines\n",
+					array_names[index], MAX_GPIO_NUM);
+				return -EINVAL;
+			}
+			for (i = 0; i < MAX_GPIO_NUM; i++)
+				motor->motor_gpio[i] = descs->desc[i];
+			/* gpiolib only takes the fast path for the array it built */
+			motor->phase_descs = descs->desc;
+			motor->gpio_info = descs->info;
+			continue;
+		}
 
-	ret = gpio_request(GPIO_ID_A, "motor_A_GPIO");
-	if (ret != 0) {
-		printk("motor gpio request is error!\n");
-		return -1;
-	}
-	ret = gpio_request(GPIO_ID_B, "motor_B_GPIO");
-	if (ret != 0) {
-		printk("motor gpio request is error!\n");
-		gpio_free(GPIO_ID_A);
-		GPIO_ID_A = -1;
-		return -1;
-	}
-	ret = gpio_request(GPIO_ID_C, "motor_C_GPIO");
-	if (ret != 0) {
-		printk("motor gpio request is error!\n");
-		gpio_free(GPIO_ID_A);
-		gpio_free(GPIO_ID_B);
-		GPIO_ID_A = -1;
-		GPIO_ID_B = -1;
-		return -1;
-	}
-	ret = gpio_request(GPIO_ID_D, "motor_D_GPIO");
-	if (ret != 0) {
-		printk("motor gpio request is error!\n");
-		gpio_free(GPIO_ID_A);
-		gpio_free(GPIO_ID_B);
-		gpio_free(GPIO_ID_C);
-		GPIO_ID_A = -1;
-		GPIO_ID_B = -1;
-		GPIO_ID_C = -1;
-		return -1;
-	}
-	ret = gpio_request(GPIO_ID_E, "motor_E_GPIO");
-	if (ret != 0) {
-		printk("motor gpio request is error!\n");
-		gpio_free(GPIO_ID_A);
-		gpio_free(GPIO_ID_B);
-		gpio_free(GPIO_ID_C);
-		gpio_free(GPIO_ID_D);
-		GPIO_ID_A = -1;
-		GPIO_ID_B = -1;
-		GPIO_ID_C = -1;
-		GPIO_ID_D = -1;
-		return -1;
-	}
-	ret = gpio_request(GPIO_ID_F, "motor_F_GPIO");
-	if (ret != 0) {
-		printk("motor gpio request is error!\n");
-		gpio_free(GPIO_ID_A);
-		gpio_free(GPIO_ID_B);
-		gpio_free(GPIO_ID_C);
-		gpio_free(GPIO_ID_D);
-		gpio_free(GPIO_ID_E);
-		GPIO_ID_A = -1;
-		GPIO_ID_B = -1;
-		GPIO_ID_C = -1;
-		GPIO_ID_D = -1;
-		GPIO_ID_E = -1;
-		return -1;
-	}
-	ret = gpio_request(GPIO_ID_G, "motor_G_GPIO");
-	if (ret != 0) {
-		printk("motor gpio request is error!\n");
-		gpio_free(GPIO_ID_A);
-		gpio_free(GPIO_ID_B);
-		gpio_free(GPIO_ID_C);
-		gpio_free(GPIO_ID_D);
-		gpio_free(GPIO_ID_E);
-		gpio_free(GPIO_ID_F);
-		GPIO_ID_A = -1;
-		GPIO_ID_B = -1;
-		GPIO_ID_C = -1;
-		GPIO_ID_D = -1;
-		GPIO_ID_E = -1;
-		GPIO_ID_F = -1;
-		return -1;
-	}
-	ret = gpio_request(GPIO_ID_H, "motor_H_GPIO");
-	if (ret != 0) {
-		printk("motor gpio request is error!\n");
-		gpio_free(GPIO_ID_A);
-		gpio_free(GPIO_ID_B);
-		gpio_free(GPIO_ID_C);
-		gpio_free(GPIO_ID_D);
-		gpio_free(GPIO_ID_E);
-		gpio_free(GPIO_ID_F);
-		gpio_free(GPIO_ID_G);
-		GPIO_ID_A = -1;
-		GPIO_ID_B = -1;
-		GPIO_ID_C = -1;
-		GPIO_ID_D = -1;
-		GPIO_ID_E = -1;
-		GPIO_ID_F = -1;
-		GPIO_ID_G = -1;
-		return -1;
+		for (i = 0; i < MAX_GPIO_NUM; i++) {
+			motor->motor_gpio[i] = devm_gpiod_get(&pdev->dev, line_names[index][i],
+							      GPIOD_OUT_LOW);
+			if (IS_ERR(motor->motor_gpio[i])) {
+				dev_err(&pdev->dev, "get %s gpio failed\n", line_names[index][i]);
+				return PTR_ERR(motor->motor_gpio[i]);
+			}
+		}
+		motor->phase_descs = motor->motor_gpio;
+		motor->gpio_info = NULL;
 	}
 
-	ret = gpio_direction_output(GPIO_ID_A, 0);
-	if (ret) {
-		printk("motor gpioA set direction fail%d\n", ret);
-		goto free_gpio;
-	}
-	ret = gpio_direction_output(GPIO_ID_B, 0);
-	if (ret) {
-		printk("motor gpioB set direction fail%d\n", ret);
-		goto free_gpio;
-	}
-	ret = gpio_direction_output(GPIO_ID_C, 0);
-	if (ret) {
-		printk("motor gpioC set direction fail%d\n", ret);
-		goto free_gpio;
-	}
-	ret = gpio_direction_output(GPIO_ID_D, 0);
-	if (ret) {
-		printk("motor gpioD set direction fail%d\n", ret);
-		goto free_gpio;
-	}
-	ret = gpio_direction_output(GPIO_ID_E, 0);
-	if (ret) {
-		printk("motor gpioE set direction fail%d\n", ret);
-		goto free_gpio;
-	}
-	ret = gpio_direction_output(GPIO_ID_F, 0);
-	if (ret) {
-		printk("motor gpioF set direction fail%d\n", ret);
-		goto free_gpio;
-	}
-	ret = gpio_direction_output(GPIO_ID_G, 0);
-	if (ret) {
-		printk("motor gpioG set direction fail%d\n", ret);
-		goto free_gpio;
-	}
-	ret = gpio_direction_output(GPIO_ID_H, 0);
-	if (ret) {
-		printk("motor gpioH set direction fail%d\n", ret);
-		goto free_gpio;
-	}
-	mdev->motors[HORIZONTAL_MOTOR].motor_gpio[0] = GPIO_ID_A;
-	mdev->motors[HORIZONTAL_MOTOR].motor_gpio[1] = GPIO_ID_B;
-	mdev->motors[HORIZONTAL_MOTOR].motor_gpio[2] = GPIO_ID_C;
-	mdev->motors[HORIZONTAL_MOTOR].motor_gpio[3] = GPIO_ID_D;
-	mdev->motors[VERTICAL_MOTOR].motor_gpio[0] = GPIO_ID_E;
-	mdev->motors[VERTICAL_MOTOR].motor_gpio[1] = GPIO_ID_F;
-	mdev->motors[VERTICAL_MOTOR].motor_gpio[2] = GPIO_ID_G;
-	mdev->motors[VERTICAL_MOTOR].motor_gpio[3] = GPIO_ID_H;
 	return 0;
-free_gpio:
-	if (GPIO_ID_A  != -1)
-		gpio_free(GPIO_ID_A);
-	if (GPIO_ID_B  != -1)
-		gpio_free(GPIO_ID_B);
-	if (GPIO_ID_C  != -1)
-		gpio_free(GPIO_ID_C);
-	if (GPIO_ID_D  != -1)
-		gpio_free(GPIO_ID_D);
-	if (GPIO_ID_E  != -1)
-		gpio_free(GPIO_ID_E);
-	if (GPIO_ID_F  != -1)
-		gpio_free(GPIO_ID_F);
-	if (GPIO_ID_G  != -1)
-		gpio_free(GPIO_ID_G);
-	if (GPIO_ID_H  != -1)
-		gpio_free(GPIO_ID_H);
-	return -1;
-}
-
-static void motor_release_gpio(struct motor_device *mdev)
-{
-	int i = 0, index = 0;
-	struct motor_device_attribute *motor = NULL;
-	int GPIO_ID_A = mdev->motors[HORIZONTAL_MOTOR].motor_gpio[0];
-	int GPIO_ID_B = mdev->motors[HORIZONTAL_MOTOR].motor_gpio[1];
-	int GPIO_ID_C = mdev->motors[HORIZONTAL_MOTOR].motor_gpio[2];
-	int GPIO_ID_D = mdev->motors[HORIZONTAL_MOTOR].motor_gpio[3];
-	int GPIO_ID_E = mdev->motors[VERTICAL_MOTOR].motor_gpio[0];
-	int GPIO_ID_F = mdev->motors[VERTICAL_MOTOR].motor_gpio[1];
-	int GPIO_ID_G = mdev->motors[VERTICAL_MOTOR].motor_gpio[2];
-	int GPIO_ID_H = mdev->motors[VERTICAL_MOTOR].motor_gpio[3];
-
-	if (GPIO_ID_A  != -1)
-		gpio_free(GPIO_ID_A);
-	if (GPIO_ID_B  != -1)
-		gpio_free(GPIO_ID_B);
-	if (GPIO_ID_C  != -1)
-		gpio_free(GPIO_ID_C);
-	if (GPIO_ID_D  != -1)
-		gpio_free(GPIO_ID_D);
-	if (GPIO_ID_E  != -1)
-		gpio_free(GPIO_ID_E);
-	if (GPIO_ID_F  != -1)
-		gpio_free(GPIO_ID_F);
-	if (GPIO_ID_G  != -1)
-		gpio_free(GPIO_ID_G);
-	if (GPIO_ID_H  != -1)
-		gpio_free(GPIO_ID_H);
-
-
-	for (index = 0; index < HAS_MOTOR_CNT; index++) {
-		motor =  &mdev->motors[index];
-		for (i = 0; i < MAX_GPIO_NUM; i++)
-			motor->motor_gpio[i] = -1;
-	}
 }
 
 static int motor_probe(struct platform_device *pdev)
 {
-	int i = 0, index = 0;
-	struct motor_device_attribute *motor = NULL;
 	struct motor_device *mdev;
 	struct proc_dir_entry *proc = NULL;
 	struct proc_dir_entry *motor_info = NULL;
@@ -1127,6 +1153,11 @@ static int motor_probe(struct platform_device *pdev)
 	mdev->dev = &pdev->dev;
 	mutex_init(&mdev->dev_mutex);
 	spin_lock_init(&mdev->slock);
+	INIT_KFIFO(mdev->events);
+	init_waitqueue_head(&mdev->event_wait);
+	/* ioctls arm the timer as soon as the misc device is registered */
+	hrtimer_init(&mdev->step_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS_HARD);
+	mdev->step_timer.function = motor_step_timer;
 
 	platform_set_drvdata(pdev, mdev);
 
@@ -1156,29 +1187,16 @@ static int motor_probe(struct platform_device *pdev)
 	motor_set_default(mdev);
 	mdev->motors[HORIZONTAL_MOTOR].max_steps = HORIZONTAL_MAX_STEPS;
 	mdev->motors[VERTICAL_MOTOR].max_steps = VERTICAL_MAX_STEPS;
-	for (index = 0; index < HAS_MOTOR_CNT; index++) {
-		motor =  &mdev->motors[index];
-		for (i = 0; i < MAX_GPIO_NUM; i++)
-			motor->motor_gpio[i] = -1;
-	}
 	mdev->motor_open_flag = 0;
 
 	ret = motor_request_gpio(pdev, mdev);
 	if (ret) {
 		printk("motor_request_gpio fail\n");
-		ret = -1;
 		goto motor_request_gpio_fail;
 	}
-	if (rk_timer_init(pdev, mdev) == NULL) {
-		printk("init timer fail\n");
-		ret = -1;
-		goto motor_timer_init_fail;
-	}
 	printk("%s leave\n", __func__);
 	return 0;
 
-motor_timer_init_fail:
-	motor_release_gpio(mdev);
 motor_request_gpio_fail:
 	if (mdev->proc)
 		proc_remove(mdev->proc);
@@ -1193,12 +1211,16 @@ error_devm_kzalloc:
 static int motor_remove(struct platform_device *pdev)
 {
 	struct motor_device *mdev = platform_get_drvdata(pdev);
-	rk_timer_deinit(mdev);
+	int index;
+
+	/* no new ioctl can re-arm the timer once the device is gone */
+	misc_deregister(&mdev->misc_dev);
+	hrtimer_cancel(&mdev->step_timer);
+	for (index = 0; index < HAS_MOTOR_CNT; index++)
+		motor_off(&mdev->motors[index]);
 	mutex_destroy(&mdev->dev_mutex);
-	motor_release_gpio(mdev);
 	if (mdev->proc)
 		proc_remove(mdev->proc);
-	misc_deregister(&mdev->misc_dev);
 	kfree(mdev);
 	return 0;
 }
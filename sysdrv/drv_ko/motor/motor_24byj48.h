@@ -27,6 +27,8 @@
 #define MOTOR_CRUISE        _IOW('M', 6, long)
 #define MOTOR_SET_STATUS    _IOW('M', 7, long)
 #define MOTOR_RESET_NOTCALI _IOW('M', 8, long)
+#define MOTOR_SET_PROFILE   _IOW('M', 9, long)
+#define MOTOR_QUEUE_MOVE    _IOW('M', 10, long)
 
 #endif //__RK_MOTOR_H__
 
@@ -25,10 +25,6 @@ static struct wifi_ring_buffer_status ring_buffer[] = {
 	},
 };
 
-static struct wlan_driver_wake_reason_cnt_t wake_reason_cnt = {
-	.total_cmd_event_wake = 10,
-};
-
 #endif
 
 #ifdef CONFIG_APF
@@ -44,6 +40,7 @@ int aic_dev_start_mkeep_alive(struct rwnx_hw *rwnx_hw,
 			      u8 *dst_mac, u32 period_msec)
 {
 	u8 *data, *pos;
+	int ret;
 
 	data = kzalloc(ip_pkt_len + 14, GFP_KERNEL);
 	if (!data)
@@ -62,10 +59,12 @@ int aic_dev_start_mkeep_alive(struct rwnx_hw *rwnx_hw,
 	memcpy(pos, ip_pkt, ip_pkt_len);
 	pos += ip_pkt_len;
 
-	//add send 802.3 pkt(raw data)
+	/* The fw sends the 802.3 pkt every period_msec, also while the host sleeps */
+	ret = rwnx_send_set_keepalive_req(rwnx_hw, mkeep_alive_id, data,
+					  pos - data, period_msec);
 	kfree(data);
 
-	return 0;
+	return ret;
 }
 
 int aic_dev_stop_mkeep_alive(struct rwnx_hw *rwnx_hw, struct rwnx_vif *rwnx_vif,
@@ -82,8 +81,7 @@ int aic_dev_stop_mkeep_alive(struct rwnx_hw *rwnx_hw, struct rwnx_vif *rwnx_vif,
 
 	printk("%s execution\n", __func__);
 
-	//add send stop keep alive
-	res = 0;
+	res = rwnx_send_set_keepalive_req(rwnx_hw, mkeep_alive_id, NULL, 0, 0);
 	return res;
 }
 
@@ -622,18 +620,39 @@ static int aicwf_vendor_logger_get_wake_reason_stats(struct wiphy *wiphy,
 	int ret;
 	struct sk_buff *reply;
 	uint32_t payload;
+	struct rwnx_hw *rwnx_hw = wiphy_priv(wiphy);
+	struct rwnx_wake_stats *stats = &rwnx_hw->wake_stats;
 
-	payload = sizeof(wake_reason_cnt.total_cmd_event_wake);
+	payload = 13 * nla_total_size(sizeof(u32));
 	reply = cfg80211_vendor_cmd_alloc_reply_skb(wiphy, payload);
 
 	if (!reply)
 		return -ENOMEM;
 
-	/* TODO
-	 * Add handle in the future
-	 */
 	if (nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_TOTAL_CMD_EVENT,
-			wake_reason_cnt.total_cmd_event_wake))
+			stats->cmd_event) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_TOTAL_RX_DATA_WAKE,
+			stats->rx_data) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_RX_UNICAST_COUNT,
+			stats->rx_unicast) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_RX_MULTICAST_COUNT,
+			stats->rx_multicast) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_RX_BROADCAST_COUNT,
+			stats->rx_broadcast) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_RX_ICMP_PKT, stats->icmp) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_RX_ICMP6_PKT, stats->icmp6) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_RX_ICMP6_RA,
+			stats->icmp6_ra) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_RX_ICMP6_NA,
+			stats->icmp6_na) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_RX_ICMP6_NS,
+			stats->icmp6_ns) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_IPV4_RX_MULTICAST_ADD_CNT,
+			stats->ipv4_mcast) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_IPV6_RX_MULTICAST_ADD_CNT,
+			stats->ipv6_mcast) ||
+	    nla_put_u32(reply, WAKE_STAT_ATTRIBUTE_OTHER__RX_MULTICAST_ADD_CNT,
+			stats->other_mcast))
 		goto out_put_fail;
 
 	ret = cfg80211_vendor_cmd_reply(reply);
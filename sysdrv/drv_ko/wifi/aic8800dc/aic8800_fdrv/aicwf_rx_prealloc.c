@@ -12,23 +12,75 @@ int aic_rxbuff_num_max = 30;
 
 int aic_rxbuff_size = (64 * 512);
 
+static int aicwf_prealloc_rxbuff_page(struct rx_buff *rxbuff, gfp_t gfp)
+{
+	struct page *page;
+
+	page = alloc_pages(gfp | __GFP_COMP | __GFP_NOWARN,
+			   get_order(aic_rxbuff_size));
+	if (page == NULL)
+		return -ENOMEM;
+
+	rxbuff->page = page;
+	rxbuff->data = page_address(page);
+	return 0;
+}
+
+// give the buffers back whose skbs have all been freed, called with the lock held
+static void aicwf_prealloc_rxbuff_recycle(void)
+{
+	struct rx_buff *rxbuff;
+	struct rx_buff *pos;
+
+	list_for_each_entry_safe (rxbuff, pos, &aic_rx_buff_list.busy_list,
+				  queue) {
+		if (page_ref_count(rxbuff->page) != 1)
+			continue;
+		list_move_tail(&rxbuff->queue, &aic_rx_buff_list.rxbuff_list);
+		atomic_inc(&aic_rx_buff_list.rxbuff_list_len);
+	}
+}
+
 struct rx_buff *aicwf_prealloc_rxbuff_alloc(spinlock_t *lock)
 {
 	unsigned long flags;
+	struct page *page;
 	struct rx_buff *rxbuff = NULL;
 
 	spin_lock_irqsave(lock, flags);
-	if (list_empty(&aic_rx_buff_list.rxbuff_list)) {
-		spin_unlock_irqrestore(lock, flags);
-		printk("%s %d, rxbuff list is empty\n", __func__, __LINE__);
-		return NULL;
-	} else {
+	if (list_empty(&aic_rx_buff_list.rxbuff_list))
+		aicwf_prealloc_rxbuff_recycle();
+
+	if (!list_empty(&aic_rx_buff_list.rxbuff_list)) {
 		rxbuff = list_first_entry(&aic_rx_buff_list.rxbuff_list,
 					  struct rx_buff, queue);
 		list_del_init(&rxbuff->queue);
 		atomic_dec(&aic_rx_buff_list.rxbuff_list_len);
+	} else if (!list_empty(&aic_rx_buff_list.busy_list)) {
+		// the stack holds on to every page, leave the oldest one to it
+		rxbuff = list_first_entry(&aic_rx_buff_list.busy_list,
+					  struct rx_buff, queue);
+		list_del_init(&rxbuff->queue);
+		spin_unlock_irqrestore(lock, flags);
+
+		page = rxbuff->page;
+		if (aicwf_prealloc_rxbuff_page(rxbuff, GFP_KERNEL)) {
+			aicwf_prealloc_rxbuff_free(rxbuff, lock);
+			printk("%s %d, rxbuff list is empty\n", __func__,
+			       __LINE__);
+			return NULL;
+		}
+		put_page(page);
+		goto reset;
 	}
 	spin_unlock_irqrestore(lock, flags);
+
+	if (rxbuff == NULL) {
+		printk("%s %d, rxbuff list is empty\n", __func__, __LINE__);
+		return NULL;
+	}
+
+reset:
 	//printk("len:%d\n", aic_rx_buff_list.rxbuff_list_len);
 	memset(rxbuff->data, 0, aic_rxbuff_size);
 	rxbuff->len = 0;
@@ -44,9 +96,28 @@ void aicwf_prealloc_rxbuff_free(struct rx_buff *rxbuff, spinlock_t *lock)
 	unsigned long flags;
 
 	spin_lock_irqsave(lock, flags);
-	list_add_tail(&rxbuff->queue, &aic_rx_buff_list.rxbuff_list);
-	atomic_inc(&aic_rx_buff_list.rxbuff_list_len);
+	if (page_ref_count(rxbuff->page) == 1) {
+		list_add_tail(&rxbuff->queue, &aic_rx_buff_list.rxbuff_list);
+		atomic_inc(&aic_rx_buff_list.rxbuff_list_len);
+	} else {
+		list_add_tail(&rxbuff->queue, &aic_rx_buff_list.busy_list);
+	}
+	spin_unlock_irqrestore(lock, flags);
+}
+
+bool aicwf_prealloc_rxbuff_empty(spinlock_t *lock)
+{
+	unsigned long flags;
+	bool empty;
+
+	spin_lock_irqsave(lock, flags);
+	if (list_empty(&aic_rx_buff_list.rxbuff_list))
+		aicwf_prealloc_rxbuff_recycle();
+	empty = list_empty(&aic_rx_buff_list.rxbuff_list) &&
+		list_empty(&aic_rx_buff_list.busy_list);
 	spin_unlock_irqrestore(lock, flags);
+
+	return empty;
 }
 
 int aicwf_prealloc_init()
@@ -56,12 +127,12 @@ int aicwf_prealloc_init()
 
 	printk("%s enter\n", __func__);
 	INIT_LIST_HEAD(&aic_rx_buff_list.rxbuff_list);
+	INIT_LIST_HEAD(&aic_rx_buff_list.busy_list);
 
 	for (i = 0; i < aic_rxbuff_num_max; i++) {
 		rxbuff = kzalloc(sizeof(struct rx_buff), GFP_KERNEL);
 		if (rxbuff) {
-			rxbuff->data = kzalloc(aic_rxbuff_size, GFP_KERNEL);
-			if (rxbuff->data == NULL) {
+			if (aicwf_prealloc_rxbuff_page(rxbuff, GFP_KERNEL)) {
 				printk("failed to alloc rxbuff data\n");
 				kfree(rxbuff);
 				continue;
@@ -93,7 +164,15 @@ void aicwf_prealloc_exit()
 	list_for_each_entry_safe (rxbuff, pos, &aic_rx_buff_list.rxbuff_list,
 				  queue) {
 		list_del_init(&rxbuff->queue);
-		kfree(rxbuff->data);
+		put_page(rxbuff->page);
+		kfree(rxbuff);
+	}
+
+	// the skbs still holding these pages free them
+	list_for_each_entry_safe (rxbuff, pos, &aic_rx_buff_list.busy_list,
+				  queue) {
+		list_del_init(&rxbuff->queue);
+		put_page(rxbuff->page);
 		kfree(rxbuff);
 	}
 }
@@ -4,6 +4,7 @@
 #ifdef CONFIG_PREALLOC_RX_SKB
 struct rx_buff {
 	struct list_head queue;
+	struct page *page;
 	unsigned char *data;
 	u32 len;
 	uint8_t *start;
@@ -14,10 +15,15 @@ struct rx_buff {
 struct aicwf_rx_buff_list {
 	struct list_head rxbuff_list;
 	atomic_t rxbuff_list_len;
+	// buffers whose pages are still attached to skbs in the stack
+	struct list_head busy_list;
 };
 
+extern int aic_rxbuff_size;
+
 struct rx_buff *aicwf_prealloc_rxbuff_alloc(spinlock_t *lock);
 void aicwf_prealloc_rxbuff_free(struct rx_buff *rxbuff, spinlock_t *lock);
+bool aicwf_prealloc_rxbuff_empty(spinlock_t *lock);
 int aicwf_prealloc_init(void);
 void aicwf_prealloc_exit(void);
 #endif
@@ -41,6 +41,9 @@
 #endif
 
 #include "aic_bsp_export.h"
+#ifdef CONFIG_SDIO_ADMA
+#include <linux/mmc/sdio_batch.h>
+#endif
 extern uint8_t scanning;
 
 #ifdef CONFIG_SDIO_ADMA
@@ -65,6 +68,14 @@ struct proc_dir_entry *wifi_suspend_node;
 int tx_aggr_counter = 32;
 module_param_named(tx_aggr_counter, tx_aggr_counter, int, 0644);
 
+//airtime of one tx burst at the current phy rate, 0 to always aggregate tx_aggr_counter pkts
+int tx_aggr_latency_us = 1000;
+module_param_named(tx_aggr_latency_us, tx_aggr_latency_us, int, 0644);
+
+//longest time a partial burst waits for more pkts, 0 to send it once the txq is empty
+int tx_aggr_hold_us = 200;
+module_param_named(tx_aggr_hold_us, tx_aggr_hold_us, int, 0644);
+
 #ifdef CONFIG_TX_NETIF_FLOWCTRL
 int tx_fc_low_water = AICWF_SDIO_TX_LOW_WATER;
 module_param_named(tx_fc_low_water, tx_fc_low_water, int, 0644);
@@ -570,6 +581,7 @@ static irqreturn_t rwnx_hostwake_irq_handler(int irq, void *para)
 {
 	static int wake_cnt;
 	wake_cnt++;
+	g_rwnx_plat->sdiodev->rwnx_hw->wake_stats.wake_irq++;
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
 	rwnx_wakeup_lock_timeout(g_rwnx_plat->sdiodev->rwnx_hw->ws_rx, 1000);
@@ -1124,6 +1136,8 @@ static int aicwf_sdio_suspend(struct device *dev)
 	}
 #endif
 
+	rwnx_wake_reason_arm(sdiodev->rwnx_hw);
+
 	sdio_dbg("%s exit\n", __func__);
 
 	return 0;
@@ -1188,6 +1202,8 @@ static int aicwf_sdio_resume(struct device *dev)
 		sdio_release_host(sdiodev->func);
 	}
 #endif
+	//the rx threads only run from here, see rwnx_wake_reason_rx()
+	sdiodev->rwnx_hw->wake_stats.resume_time = jiffies;
 	atomic_set(&sdiodev->is_bus_suspend, 0);
 	//    smp_mb();
 #ifdef CONFIG_WIFI_SUSPEND_FOR_LINUX
@@ -1568,13 +1584,10 @@ int aicwf_sdio_txscatterpkt(struct aicwf_tx_priv *tx_priv)
 
 	//AICWFDBG(LOGTRACE,"%s aggr_segcnt %d len %d \n",__func__,tx_priv->aggr_segcnt, tx_priv->len);
 	sdio_claim_host(sdiodev->func);
-	ret = sdio_write_sg(sdiodev->func, sdiodev->sdio_reg.wr_fifo_addr,
-			    &(tx_priv->sg_list[0]), tx_priv->aggr_segcnt,
-			    tx_priv->len); //&(tx_priv->sg_list[0])
-	//sdio_writesb(sdiodev->func, sdiodev->sdio_reg.wr_fifo_addr, tx_priv->sg_list[0].buf, tx_priv->sg_list[0].len);
-	/*for(i=0;i<1;i++){
-		sdio_writesb(sdiodev->func, sdiodev->sdio_reg.wr_fifo_addr, tx_priv->sg_list[i].buf, tx_priv->sg_list[i].len);
-	}*/
+	//one block mode CMD53 gathering all the segments, the tail is padded by aicwf_sdio_aggr_send
+	ret = sdio_writesb_sg(sdiodev->func, sdiodev->sdio_reg.wr_fifo_addr,
+			      tx_priv->sg_list, tx_priv->aggr_segcnt,
+			      tx_priv->len);
 	sdio_release_host(sdiodev->func);
 
 	return ret;
@@ -1637,8 +1650,8 @@ void aicwf_adma_add(struct aicwf_tx_priv *tx_priv, struct sk_buff *pkt)
 
 		curr_len = sdio_len + SDIO_HEADER_LEN;
 
-		tx_priv->sg_list[tx_priv->aggr_segcnt].buf = start_ptr;
-		tx_priv->sg_list[tx_priv->aggr_segcnt].len = curr_len;
+		sg_set_buf(&tx_priv->sg_list[tx_priv->aggr_segcnt], start_ptr,
+			   curr_len);
 		tx_priv->free_buf[tx_priv->aggr_segcnt] = pkt;
 
 		//AICWFDBG(LOGTRACE,"curr_len %d \n",curr_len);
@@ -1668,10 +1681,9 @@ void aicwf_adma_add(struct aicwf_tx_priv *tx_priv, struct sk_buff *pkt)
 		sdio_tx_buf_dummy[tx_priv->aggr_segcnt][5] = 0;
 		sdio_tx_buf_dummy[tx_priv->aggr_segcnt][6] = 0;
 
-		tx_priv->sg_list[tx_priv->aggr_segcnt].buf =
-			sdio_tx_buf_dummy[tx_priv->aggr_segcnt];
-		tx_priv->sg_list[tx_priv->aggr_segcnt].len =
-			SDIO_HEADER_LEN + 3;
+		sg_set_buf(&tx_priv->sg_list[tx_priv->aggr_segcnt],
+			   sdio_tx_buf_dummy[tx_priv->aggr_segcnt],
+			   SDIO_HEADER_LEN + 3);
 		tx_priv->free_buf[tx_priv->aggr_segcnt] = NULL;
 
 		tx_priv->aggr_segcnt++;
@@ -1681,8 +1693,8 @@ void aicwf_adma_add(struct aicwf_tx_priv *tx_priv, struct sk_buff *pkt)
 
 		curr_len = sdio_len - 3;
 
-		tx_priv->sg_list[tx_priv->aggr_segcnt].buf = start_ptr;
-		tx_priv->sg_list[tx_priv->aggr_segcnt].len = curr_len;
+		sg_set_buf(&tx_priv->sg_list[tx_priv->aggr_segcnt], start_ptr,
+			   curr_len);
 		tx_priv->free_buf[tx_priv->aggr_segcnt] = pkt;
 
 		//AICWFDBG(LOGTRACE,"curr_len %d \n",curr_len);
@@ -1713,10 +1725,9 @@ void aicwf_adma_add(struct aicwf_tx_priv *tx_priv, struct sk_buff *pkt)
 		sdio_tx_buf_dummy[tx_priv->aggr_segcnt][4] = 0;
 		sdio_tx_buf_dummy[tx_priv->aggr_segcnt][5] = 0;
 
-		tx_priv->sg_list[tx_priv->aggr_segcnt].buf =
-			sdio_tx_buf_dummy[tx_priv->aggr_segcnt];
-		tx_priv->sg_list[tx_priv->aggr_segcnt].len =
-			SDIO_HEADER_LEN + SDIO_DATA_FAKE_LEN;
+		sg_set_buf(&tx_priv->sg_list[tx_priv->aggr_segcnt],
+			   sdio_tx_buf_dummy[tx_priv->aggr_segcnt],
+			   SDIO_HEADER_LEN + SDIO_DATA_FAKE_LEN);
 		tx_priv->free_buf[tx_priv->aggr_segcnt] = NULL;
 
 		tx_priv->aggr_segcnt++;
@@ -1727,8 +1738,8 @@ void aicwf_adma_add(struct aicwf_tx_priv *tx_priv, struct sk_buff *pkt)
 
 		curr_len = sdio_len - SDIO_DATA_FAKE_LEN;
 
-		tx_priv->sg_list[tx_priv->aggr_segcnt].buf = start_ptr;
-		tx_priv->sg_list[tx_priv->aggr_segcnt].len = curr_len;
+		sg_set_buf(&tx_priv->sg_list[tx_priv->aggr_segcnt], start_ptr,
+			   curr_len);
 		tx_priv->free_buf[tx_priv->aggr_segcnt] = pkt;
 
 		//AICWFDBG(LOGTRACE,"curr_len %d \n",curr_len);
@@ -1757,10 +1768,9 @@ void aicwf_adma_add(struct aicwf_tx_priv *tx_priv, struct sk_buff *pkt)
 		sdio_tx_buf_dummy[tx_priv->aggr_segcnt][3] = 0;
 		sdio_tx_buf_dummy[tx_priv->aggr_segcnt][4] = 0;
 
-		tx_priv->sg_list[tx_priv->aggr_segcnt].buf =
-			sdio_tx_buf_dummy[tx_priv->aggr_segcnt];
-		tx_priv->sg_list[tx_priv->aggr_segcnt].len =
-			SDIO_HEADER_LEN + 1;
+		sg_set_buf(&tx_priv->sg_list[tx_priv->aggr_segcnt],
+			   sdio_tx_buf_dummy[tx_priv->aggr_segcnt],
+			   SDIO_HEADER_LEN + 1);
 		tx_priv->free_buf[tx_priv->aggr_segcnt] = NULL;
 
 		tx_priv->aggr_segcnt++;
@@ -1772,8 +1782,8 @@ void aicwf_adma_add(struct aicwf_tx_priv *tx_priv, struct sk_buff *pkt)
 
 		curr_len = sdio_len - 1;
 
-		tx_priv->sg_list[tx_priv->aggr_segcnt].buf = start_ptr;
-		tx_priv->sg_list[tx_priv->aggr_segcnt].len = curr_len;
+		sg_set_buf(&tx_priv->sg_list[tx_priv->aggr_segcnt], start_ptr,
+			   curr_len);
 		tx_priv->free_buf[tx_priv->aggr_segcnt] = pkt;
 
 		//AICWFDBG(LOGTRACE,"curr_len %d \n",curr_len);
@@ -2057,6 +2067,17 @@ static void aicwf_sdio_tx_process(struct aic_sdio_dev *sdiodev)
 		}
 	}
 
+	//the burst waiting for more pkts is due
+	if (READ_ONCE(sdiodev->tx_priv->aggr_flush)) {
+		if (atomic_read(&sdiodev->tx_priv->aggr_count) > 0) {
+			sdiodev->tx_priv->aggr_timer_flush++;
+			sdiodev->tx_priv->fw_avail_bufcnt -=
+				atomic_read(&sdiodev->tx_priv->aggr_count);
+			aicwf_sdio_aggr_send(sdiodev->tx_priv);
+		}
+		WRITE_ONCE(sdiodev->tx_priv->aggr_flush, false);
+	}
+
 #ifdef CONFIG_TX_NETIF_FLOWCTRL
 	spin_lock_irqsave(&sdiodev->tx_flow_lock, flags);
 	if (atomic_read(&sdiodev->tx_priv->tx_pktcnt) < tx_fc_low_water) {
@@ -2071,6 +2092,10 @@ static void aicwf_sdio_tx_process(struct aic_sdio_dev *sdiodev)
 #endif
 
 	up(&sdiodev->tx_priv->txctl_sema);
+
+	//push the txqs held back by the airtime limit now that the queue drained
+	if (sdiodev->rwnx_hw)
+		rwnx_txq_aql_kick(sdiodev->rwnx_hw);
 }
 
 static int aicwf_sdio_bus_txdata(struct device *dev, struct sk_buff *pkt)
@@ -2089,6 +2114,7 @@ static int aicwf_sdio_bus_txdata(struct device *dev, struct sk_buff *pkt)
 		sdio_err("bus_if stopped\n");
 		txhdr = (struct rwnx_txhdr *)pkt->data;
 		headroom = txhdr->sw_hdr->headroom;
+		rwnx_txq_airtime_release(txhdr->sw_hdr);
 		kmem_cache_free(
 			txhdr->sw_hdr->rwnx_vif->rwnx_hw->sw_txhdr_cache,
 			txhdr->sw_hdr);
@@ -2102,6 +2128,7 @@ static int aicwf_sdio_bus_txdata(struct device *dev, struct sk_buff *pkt)
 	if (!aicwf_frame_enq(sdiodev->dev, &sdiodev->tx_priv->txq, pkt, prio)) {
 		txhdr = (struct rwnx_txhdr *)pkt->data;
 		headroom = txhdr->sw_hdr->headroom;
+		rwnx_txq_airtime_release(txhdr->sw_hdr);
 		kmem_cache_free(
 			txhdr->sw_hdr->rwnx_vif->rwnx_hw->sw_txhdr_cache,
 			txhdr->sw_hdr);
@@ -2170,11 +2197,65 @@ static int aicwf_sdio_bus_txmsg(struct device *dev, u8 *msg, uint msglen)
 	return 0;
 }
 
+/*
+ * Number of pkts to aggregate into one sdio burst: as many full size frames
+ * as the link sends in tx_aggr_latency_us at the last known tx phy rate,
+ * within tx_aggr_counter and the fw buffers. The rate is unknown until the
+ * station info has been read once, tx_aggr_counter is used until then.
+ */
+static int aicwf_sdio_aggr_target(struct aicwf_tx_priv *tx_priv)
+{
+	u32 rate = READ_ONCE(tx_priv->link_rate);
+	int target = tx_aggr_counter;
+	u64 pkts;
+
+	if (rate && tx_aggr_latency_us > 0) {
+		pkts = div_u64((u64)rate * tx_aggr_latency_us,
+			       10 * AICWF_SDIO_AGGR_FRAME_BITS);
+		target = clamp_t(u64, pkts, 1, max(tx_aggr_counter, 1));
+	}
+
+	target = min(target, tx_priv->fw_avail_bufcnt - DATA_FLOW_CTRL_THRESH);
+	tx_priv->aggr_target = max(target, 1);
+
+	return tx_priv->aggr_target;
+}
+
+/*
+ * The txq is empty but the burst is below its target: keep it for more pkts,
+ * at most tx_aggr_hold_us from the first time it was kept.
+ */
+static bool aicwf_sdio_aggr_hold(struct aicwf_tx_priv *tx_priv)
+{
+	if (tx_aggr_hold_us <= 0 || !READ_ONCE(tx_priv->link_rate) ||
+	    READ_ONCE(tx_priv->aggr_flush))
+		return false;
+
+	if (!hrtimer_active(&tx_priv->aggr_timer))
+		hrtimer_start(&tx_priv->aggr_timer,
+			      ns_to_ktime((u64)tx_aggr_hold_us * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+
+	return true;
+}
+
+static enum hrtimer_restart aicwf_sdio_aggr_timeout(struct hrtimer *timer)
+{
+	struct aicwf_tx_priv *tx_priv =
+		container_of(timer, struct aicwf_tx_priv, aggr_timer);
+
+	WRITE_ONCE(tx_priv->aggr_flush, true);
+	complete(&tx_priv->sdiodev->bus_if->bustx_trgg);
+
+	return HRTIMER_NORESTART;
+}
+
 int aicwf_sdio_send(struct aicwf_tx_priv *tx_priv, u8 txnow)
 {
 	struct sk_buff *pkt;
 	struct aic_sdio_dev *sdiodev = tx_priv->sdiodev;
 	u32 aggr_len = 0;
+	int target;
 #ifdef CONFIG_TX_NETIF_FLOWCTRL
 	unsigned long flags;
 #endif
@@ -2225,6 +2306,7 @@ int aicwf_sdio_send(struct aicwf_tx_priv *tx_priv, u8 txnow)
 		}
 		//atomic_dec(&sdiodev->tx_priv->tx_pktcnt);
 		spin_unlock_bh(&sdiodev->tx_priv->txqlock);
+		rwnx_txq_airtime_release(((struct rwnx_txhdr *)pkt->data)->sw_hdr);
 
 #ifdef CONFIG_TX_NETIF_FLOWCTRL
 		spin_lock_irqsave(&sdiodev->tx_flow_lock, flags);
@@ -2253,10 +2335,13 @@ int aicwf_sdio_send(struct aicwf_tx_priv *tx_priv, u8 txnow)
 		}
 
 		//when aggr finish or there is cmd to send, just send this aggr pkt to fw
-		if ((int)atomic_read(&sdiodev->tx_priv->tx_pktcnt) == 1 ||
-		    txnow ||
+		target = aicwf_sdio_aggr_target(tx_priv);
+		if (txnow ||
 		    (atomic_read(&tx_priv->aggr_count) ==
-		     (tx_priv->fw_avail_bufcnt - DATA_FLOW_CTRL_THRESH))) {
+		     (tx_priv->fw_avail_bufcnt - DATA_FLOW_CTRL_THRESH)) ||
+		    atomic_read(&tx_priv->aggr_count) >= target ||
+		    ((int)atomic_read(&sdiodev->tx_priv->tx_pktcnt) == 1 &&
+		     !aicwf_sdio_aggr_hold(tx_priv))) {
 			tx_priv->fw_avail_bufcnt -=
 				atomic_read(&tx_priv->aggr_count);
 			aicwf_sdio_aggr_send(tx_priv);
@@ -2406,6 +2491,19 @@ int aicwf_sdio_aggr(struct aicwf_tx_priv *tx_priv, struct sk_buff *pkt)
 	return 0;
 }
 
+static void aicwf_sdio_aggr_account(struct aicwf_tx_priv *tx_priv)
+{
+	int cnt = atomic_read(&tx_priv->aggr_count);
+
+	if (cnt > 0)
+		tx_priv->aggr_hist[min(ilog2(cnt),
+				       AICWF_SDIO_AGGR_HIST_LEN - 1)]++;
+
+	//the burst is out, no need to wait for it any more
+	hrtimer_try_to_cancel(&tx_priv->aggr_timer);
+	WRITE_ONCE(tx_priv->aggr_flush, false);
+}
+
 void aicwf_sdio_aggr_send(struct aicwf_tx_priv *tx_priv)
 {
 #ifdef CONFIG_SDIO_ADMA
@@ -2419,8 +2517,8 @@ void aicwf_sdio_aggr_send(struct aicwf_tx_priv *tx_priv)
 				(tx_priv->len & (TXPKT_BLOCKSIZE - 1));
 
 		memset(sdio_tx_buf_fill, 0, 32);
-		tx_priv->sg_list[tx_priv->aggr_segcnt].buf = sdio_tx_buf_fill;
-		tx_priv->sg_list[tx_priv->aggr_segcnt].len = alen;
+		sg_set_buf(&tx_priv->sg_list[tx_priv->aggr_segcnt], sdio_tx_buf_fill,
+			   alen);
 		tx_priv->free_buf[tx_priv->aggr_segcnt] = NULL;
 		tx_priv->aggr_segcnt += 1;
 		tx_priv->len += alen;
@@ -2458,6 +2556,7 @@ void aicwf_sdio_aggr_send(struct aicwf_tx_priv *tx_priv)
 	}
 #endif /* CONFIG_SDIO_ADMA */
 
+	aicwf_sdio_aggr_account(tx_priv);
 	aicwf_sdio_aggrbuf_reset(tx_priv);
 }
 
@@ -2713,7 +2812,8 @@ int sdio_bustx_thread(void *data)
 			rwnx_wakeup_lock(sdiodev->rwnx_hw->ws_tx);
 			if ((int)(atomic_read(&sdiodev->tx_priv->tx_pktcnt) >
 				  0) ||
-			    (sdiodev->tx_priv->cmd_txstate == true)) {
+			    (sdiodev->tx_priv->cmd_txstate == true) ||
+			    READ_ONCE(sdiodev->tx_priv->aggr_flush)) {
 				aicwf_sdio_tx_process(sdiodev);
 			}
 			rwnx_wakeup_unlock(sdiodev->rwnx_hw->ws_tx);
@@ -2971,7 +3071,7 @@ void aicwf_sdio_hal_irqhandler(struct sdio_func *func)
 	}
 
 #ifdef CONFIG_PREALLOC_RX_SKB
-	if (list_empty(&aic_rx_buff_list.rxbuff_list)) {
+	if (aicwf_prealloc_rxbuff_empty(&sdiodev->rx_priv->rxbuff_lock)) {
 		printk("%s %d, rxbuff list is empty\n", __func__, __LINE__);
 		rwnx_wakeup_unlock(sdiodev->rwnx_hw->ws_irqrx);
 		return;
@@ -3165,6 +3265,9 @@ void aicwf_sdio_release(struct aic_sdio_dev *sdiodev)
 	sdio_release_irq(sdiodev->func);
 	sdio_release_host(sdiodev->func);
 #endif
+	if (sdiodev->tx_priv)
+		hrtimer_cancel(&sdiodev->tx_priv->aggr_timer);
+
 	if (sdiodev->dev)
 		aicwf_bus_deinit(sdiodev->dev);
 
@@ -3514,6 +3617,8 @@ void *aicwf_sdio_bus_init(struct aic_sdio_dev *sdiodev)
 		goto fail;
 	}
 	sdiodev->tx_priv = tx_priv;
+	hrtimer_init(&tx_priv->aggr_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	tx_priv->aggr_timer.function = aicwf_sdio_aggr_timeout;
 	aicwf_frame_queue_init(&tx_priv->txq, 8, TXQLEN);
 	spin_lock_init(&tx_priv->txqlock);
 	sema_init(&tx_priv->txctl_sema, 1);
@@ -57,6 +57,10 @@
 #define SDIO_ACTIVE_ST 1
 
 #define DATA_FLOW_CTRL_THRESH 2
+
+/* adaptive tx aggregation: bits of a full size frame, burst size histogram */
+#define AICWF_SDIO_AGGR_FRAME_BITS (BUFFER_SIZE * 8)
+#define AICWF_SDIO_AGGR_HIST_LEN 7
 #ifdef CONFIG_TX_NETIF_FLOWCTRL
 #define AICWF_SDIO_TX_LOW_WATER 100
 #define AICWF_SDIO_TX_HIGH_WATER 500
@@ -213,6 +217,9 @@ int aicwf_sdio_aggr(struct aicwf_tx_priv *tx_priv, struct sk_buff *pkt);
 int aicwf_sdio_send(struct aicwf_tx_priv *tx_priv, u8 txnow);
 void aicwf_sdio_aggr_send(struct aicwf_tx_priv *tx_priv);
 void aicwf_sdio_aggrbuf_reset(struct aicwf_tx_priv *tx_priv);
+extern int tx_aggr_counter;
+extern int tx_aggr_latency_us;
+extern int tx_aggr_hold_us;
 extern void aicwf_hostif_ready(void);
 extern void aicwf_hostif_fail(void);
 #ifdef CONFIG_PLATFORM_AMLOGIC
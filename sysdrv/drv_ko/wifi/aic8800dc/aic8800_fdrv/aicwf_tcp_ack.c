@@ -2,7 +2,15 @@
 //#include"rwnx_tx.h"
 //#include "aicwf_tcp_ack.h"
 #include "rwnx_defs.h"
+#include <linux/jhash.h>
+#include <linux/rculist.h>
+#include <asm/unaligned.h>
 extern int intf_tx(struct rwnx_hw *priv, struct msg_buf *msg);
+
+//longest time in ms a tcp ack is held back, the cap of the rtt based delay
+int tcp_ack_max_delay = 5;
+module_param_named(tcp_ack_max_delay, tcp_ack_max_delay, int, 0644);
+
 struct msg_buf *intf_tcp_alloc_msg(struct msg_buf *msg)
 {
 	//printk("%s \n",__func__);
@@ -14,6 +22,57 @@ struct msg_buf *intf_tcp_alloc_msg(struct msg_buf *msg)
 	return msg;
 }
 
+static struct hlist_head *tcp_ack_bucket(struct tcp_ack_manage *ack_m,
+					 struct tcp_ack_msg *msg)
+{
+	u32 hash = jhash_3words(msg->saddr, msg->daddr,
+				((u32)msg->source << 16) | msg->dest, 0);
+
+	return &ack_m->hash[hash & (ARRAY_SIZE(ack_m->hash) - 1)];
+}
+
+/* hold acks for a fraction of the rtt, a held ack delays the sender */
+unsigned long tcp_ack_delay(struct tcp_ack_info *ack_info)
+{
+	unsigned long max_delay = msecs_to_jiffies(max(tcp_ack_max_delay, 1));
+	u32 srtt_us = READ_ONCE(ack_info->srtt_us);
+
+	if (!srtt_us)
+		return max_delay;
+
+	return clamp(usecs_to_jiffies(srtt_us >> TCP_ACK_RTT_SHIFT), 1UL,
+		     max_delay);
+}
+
+static void tcp_ack_rtt_sample(struct tcp_ack_info *ack_info, s64 rtt_us)
+{
+	u32 srtt_us = ack_info->srtt_us;
+
+	ack_info->rtt_tsval = 0;
+	if (rtt_us > TCP_ACK_RTT_MAX_US)
+		return;
+	if (rtt_us <= 0)
+		rtt_us = 1;
+
+	/* srtt = 7/8 srtt + 1/8 rtt, as in tcp_rtt_estimator() */
+	if (srtt_us)
+		srtt_us = srtt_us - (srtt_us >> 3) + ((u32)rtt_us >> 3);
+	else
+		srtt_us = rtt_us;
+	WRITE_ONCE(ack_info->srtt_us, max(srtt_us, 1U));
+}
+
+/* start a sample with the tsval of an ack going out now */
+static void tcp_ack_rtt_start(struct tcp_ack_info *ack_info,
+			      struct tcp_ack_msg *ack_msg)
+{
+	if (!ack_msg->tsval || ack_info->rtt_tsval)
+		return;
+
+	ack_info->rtt_tsval = ack_msg->tsval;
+	ack_info->rtt_stamp = ktime_get();
+}
+
 void intf_tcp_drop_msg(struct rwnx_hw *priv, struct msg_buf *msg)
 {
 	//printk("%s \n",__func__);
@@ -49,6 +108,7 @@ void tcp_ack_timeout(struct timer_list *t)
 		ack_info->msgbuf = NULL;
 		ack_info->drop_cnt = 0;
 		ack_info->in_send_msg = msg;
+		ack_info->send_total++;
 		write_sequnlock_bh(&ack_info->seqlock);
 		intf_tx(ack_m->priv, msg); //send skb
 		//ack_info->in_send_msg = NULL;//add by dwx
@@ -73,10 +133,14 @@ void tcp_ack_init(struct rwnx_hw *priv)
 	ack_m->last_time = jiffies;
 	ack_m->timeout = msecs_to_jiffies(ACK_OLD_TIME);
 
+	for (i = 0; i < ARRAY_SIZE(ack_m->hash); i++)
+		INIT_HLIST_HEAD(&ack_m->hash[i]);
+
 	for (i = 0; i < TCP_ACK_NUM; i++) {
 		ack_info = &ack_m->ack_info[i];
 		ack_info->ack_info_num = i;
 		seqlock_init(&ack_info->seqlock);
+		INIT_HLIST_NODE(&ack_info->hnode);
 		ack_info->last_time = jiffies;
 		ack_info->timeout = msecs_to_jiffies(ACK_OLD_TIME);
 
@@ -115,6 +179,40 @@ void tcp_ack_deinit(struct rwnx_hw *priv)
 	}
 }
 
+/* return the tsecr of the tcp timestamp option, 0 if there is none */
+static u32 tcp_ack_tsecr(struct tcphdr *tcphdr)
+{
+	int len = tcphdr->doff * 4 - sizeof(struct tcphdr);
+	unsigned char *ptr = (unsigned char *)(tcphdr + 1);
+
+	while (len > 0) {
+		int opcode = *ptr++;
+		int opsize;
+
+		if (opcode == TCPOPT_EOL)
+			break;
+		if (opcode == TCPOPT_NOP) {
+			len--;
+			continue;
+		}
+		if (len < 2)
+			break;
+		opsize = *ptr++;
+		if (opsize < 2 || opsize > len)
+			break;
+		if (opcode == TCPOPT_TIMESTAMP && opsize == TCPOLEN_TIMESTAMP)
+			return get_unaligned_be32(ptr + 4);
+		ptr += opsize - 2;
+		len -= opsize;
+	}
+
+	return 0;
+}
+
+/* flag:0 for not tcp ack
+ *	1 for ack of the flow of a tx ack
+ *	2 for ack with push, which the tx ack must answer quickly
+ */
 int tcp_check_quick_ack(unsigned char *buf, struct tcp_ack_msg *msg)
 {
 	int ip_hdr_len;
@@ -136,20 +234,18 @@ int tcp_check_quick_ack(unsigned char *buf, struct tcp_ack_msg *msg)
 	if (!(temp[13] & 0x10))
 		return 0;
 
-	if (temp[13] & 0x8) {
-		msg->saddr = iphdr->daddr;
-		msg->daddr = iphdr->saddr;
-		msg->source = tcphdr->dest;
-		msg->dest = tcphdr->source;
-		msg->seq = ntohl(tcphdr->seq);
-		return 1;
-	}
+	msg->saddr = iphdr->daddr;
+	msg->daddr = iphdr->saddr;
+	msg->source = tcphdr->dest;
+	msg->dest = tcphdr->source;
+	msg->seq = ntohl(tcphdr->seq);
+	msg->tsval = tcp_ack_tsecr(tcphdr);
 
-	return 0;
+	return (temp[13] & 0x8) ? 2 : 1;
 }
 
 int is_drop_tcp_ack(struct tcphdr *tcphdr, int tcp_tot_len,
-		    unsigned short *win_scale)
+		    unsigned short *win_scale, u32 *tsval)
 {
 	//printk("%s \n",__func__);
 	int drop = 1;
@@ -182,6 +278,8 @@ int is_drop_tcp_ack(struct tcphdr *tcphdr, int tcp_tot_len,
 				switch (opcode) {
 				/* TODO: Add other ignore opt */
 				case TCPOPT_TIMESTAMP:
+					if (tsval && opsize == TCPOLEN_TIMESTAMP)
+						*tsval = get_unaligned_be32(ptr);
 					break;
 				case TCPOPT_WINDOW:
 					if (*ptr < 15)
@@ -233,7 +331,8 @@ int tcp_check_ack(unsigned char *buf, struct tcp_ack_msg *msg,
 		return 0;
 
 	tcp_tot_len = ntohs(iphdr->tot_len) - ip_hdr_len; // tcp total len
-	ret = is_drop_tcp_ack(tcphdr, tcp_tot_len, win_scale);
+	msg->tsval = 0;
+	ret = is_drop_tcp_ack(tcphdr, tcp_tot_len, win_scale, &msg->tsval);
 	//printk("is drop:%d \n",ret);
 
 	if (ret > 0) {
@@ -251,13 +350,14 @@ int tcp_check_ack(unsigned char *buf, struct tcp_ack_msg *msg,
 /* return val: -1 for not match, others for match */
 int tcp_ack_match(struct tcp_ack_manage *ack_m, struct tcp_ack_msg *ack_msg)
 {
-	int i, ret = -1;
+	int ret = -1;
 	unsigned start;
 	struct tcp_ack_info *ack_info;
 	struct tcp_ack_msg *ack;
 
-	for (i = 0; ((ret < 0) && (i < TCP_ACK_NUM)); i++) {
-		ack_info = &ack_m->ack_info[i];
+	rcu_read_lock();
+	hlist_for_each_entry_rcu (ack_info, tcp_ack_bucket(ack_m, ack_msg),
+				  hnode) {
 		do {
 			start = read_seqbegin(&ack_info->seqlock);
 			ret = -1;
@@ -267,9 +367,13 @@ int tcp_ack_match(struct tcp_ack_manage *ack_m, struct tcp_ack_msg *ack_msg)
 			    ack->source == ack_msg->source &&
 			    ack->saddr == ack_msg->saddr &&
 			    ack->daddr == ack_msg->daddr)
-				ret = i;
+				ret = ack_info->ack_info_num;
 		} while (read_seqretry(&ack_info->seqlock, start));
+
+		if (ret >= 0)
+			break;
 	}
+	rcu_read_unlock();
 
 	return ret;
 }
@@ -291,6 +395,7 @@ void tcp_ack_update(struct tcp_ack_manage *ack_m)
 				ack_m->free_index = i;
 				ack_m->max_num--;
 				ack_info->busy = 0;
+				hlist_del_init_rcu(&ack_info->hnode);
 			}
 			write_sequnlock_bh(&ack_info->seqlock);
 		}
@@ -429,10 +534,14 @@ int tcp_ack_handle_new(struct msg_buf *new_msgbuf, struct tcp_ack_manage *ack_m,
 	struct tcp_ack_msg *ack;
 	int ret = 0;
 	struct msg_buf *drop_msg = NULL;
+	unsigned long delay = tcp_ack_delay(ack_info);
+	bool idle;
 	//struct msg_buf * send_msg = NULL;
 	//printk("",);
 	write_seqlock_bh(&ack_info->seqlock);
 
+	/* nothing to coalesce with on a sparse flow, like an interactive one */
+	idle = time_after(jiffies, ack_info->last_time + delay);
 	ack_info->last_time = jiffies;
 	ack = &ack_info->ack_msg;
 
@@ -447,6 +556,8 @@ int tcp_ack_handle_new(struct msg_buf *new_msgbuf, struct tcp_ack_manage *ack_m,
 		    !U32_BEFORE(ack_msg->seq, ack_info->psh_seq)) {
 			ack_info->psh_flag = 0;
 			quick_ack = 1;
+		} else if (idle) {
+			quick_ack = 1;
 		} else {
 			ack_info->drop_cnt++;
 		}
@@ -459,13 +570,14 @@ int tcp_ack_handle_new(struct msg_buf *new_msgbuf, struct tcp_ack_manage *ack_m,
 			ack_info->drop_cnt = 0;
 			//send_msg = new_msgbuf;
 			ack_info->in_send_msg = new_msgbuf;
+			ack_info->send_total++;
+			tcp_ack_rtt_start(ack_info, ack_msg);
 			del_timer(&ack_info->timer);
 		} else {
 			ret = 1;
 			ack_info->msgbuf = new_msgbuf;
 			if (!timer_pending(&ack_info->timer))
-				mod_timer(&ack_info->timer,
-					  (jiffies + msecs_to_jiffies(5)));
+				mod_timer(&ack_info->timer, jiffies + delay);
 		}
 
 		//ret = 1;
@@ -483,6 +595,9 @@ int tcp_ack_handle_new(struct msg_buf *new_msgbuf, struct tcp_ack_manage *ack_m,
 
 	//ack_info->in_send_msg=NULL;
 
+	if (drop_msg)
+		ack_info->drop_total++;
+
 	write_sequnlock_bh(&ack_info->seqlock);
 
 	/*if(send_msg){
@@ -498,7 +613,8 @@ int tcp_ack_handle_new(struct msg_buf *new_msgbuf, struct tcp_ack_manage *ack_m,
 
 void filter_rx_tcp_ack(struct rwnx_hw *priv, unsigned char *buf, unsigned plen)
 {
-	int index;
+	int index, type;
+	bool psh;
 	struct tcp_ack_msg ack_msg;
 	struct tcp_ack_info *ack_info;
 	struct tcp_ack_manage *ack_m = &priv->ack_m;
@@ -506,15 +622,31 @@ void filter_rx_tcp_ack(struct rwnx_hw *priv, unsigned char *buf, unsigned plen)
 	if (!atomic_read(&ack_m->enable))
 		return;
 
-	if ((plen > MAX_TCP_ACK) || !tcp_check_quick_ack(buf, &ack_msg))
+	type = tcp_check_quick_ack(buf, &ack_msg);
+	if (!type)
+		return;
+
+	psh = (type == 2) && (plen <= MAX_TCP_ACK);
+	if (!psh && !ack_msg.tsval)
 		return;
 
 	index = tcp_ack_match(ack_m, &ack_msg);
 	if (index >= 0) {
 		ack_info = ack_m->ack_info + index;
+		if (!psh && !READ_ONCE(ack_info->rtt_tsval))
+			return;
+
 		write_seqlock_bh(&ack_info->seqlock);
-		ack_info->psh_flag = 1;
-		ack_info->psh_seq = ack_msg.seq;
+		if (psh) {
+			ack_info->psh_flag = 1;
+			ack_info->psh_seq = ack_msg.seq;
+		}
+		/* the peer echoes the tsval of the ack the sample started with */
+		if (ack_info->rtt_tsval && ack_msg.tsval &&
+		    U32_BEFORE(ack_info->rtt_tsval, ack_msg.tsval))
+			tcp_ack_rtt_sample(ack_info,
+					   ktime_us_delta(ktime_get(),
+							  ack_info->rtt_stamp));
 		write_sequnlock_bh(&ack_info->seqlock);
 	}
 }
@@ -574,6 +706,12 @@ int filter_send_tcp_ack(struct rwnx_hw *priv, struct msg_buf *msgbuf,
 		ack_m->ack_info[index].win_scale =
 			(win_scale != 0) ? win_scale : 1;
 
+		ack_m->ack_info[index].srtt_us = 0;
+		ack_m->ack_info[index].rtt_tsval = 0;
+		ack_m->ack_info[index].drop_total = 0;
+		ack_m->ack_info[index].send_total = 0;
+		tcp_ack_rtt_start(&ack_m->ack_info[index], &ack_msg);
+
 		//ack_m->ack_info[index].msgbuf = NULL;
 		//ack_m->ack_info[index].in_send_msg = NULL;
 		ack = &ack_m->ack_info[index].ack_msg;
@@ -583,6 +721,11 @@ int filter_send_tcp_ack(struct rwnx_hw *priv, struct msg_buf *msgbuf,
 		ack->daddr = ack_msg.daddr;
 		ack->seq = ack_msg.seq;
 		write_sequnlock_bh(&ack_m->ack_info[index].seqlock);
+
+		spin_lock_bh(&ack_m->lock);
+		hlist_add_head_rcu(&ack_m->ack_info[index].hnode,
+				   tcp_ack_bucket(ack_m, &ack_msg));
+		spin_unlock_bh(&ack_m->lock);
 	}
 
 out:
@@ -8,8 +8,10 @@
 #include <linux/moduleparam.h>
 #include <net/tcp.h>
 #include <linux/timer.h>
+#include <linux/ktime.h>
 
 #define TCP_ACK_NUM 32
+#define TCP_ACK_HASH_BITS 4
 #define TCP_ACK_EXIT_VAL 0x800
 #define TCP_ACK_DROP_CNT 10
 
@@ -17,6 +19,10 @@
 #define U32_BEFORE(a, b) ((__s32)((__u32)a - (__u32)b) <= 0)
 
 #define MAX_TCP_ACK 200
+/*acks are held for at most a quarter of the smoothed rtt*/
+#define TCP_ACK_RTT_SHIFT 2
+/*longer samples are from an idle flow, not the rtt*/
+#define TCP_ACK_RTT_MAX_US 1000000
 /*min window size in KB, it's 256KB*/
 #define MIN_WIN 256
 #define SIZE_KB 1024
@@ -35,6 +41,8 @@ struct tcp_ack_msg {
 	s32 daddr;
 	u32 seq;
 	u16 win;
+	/*tcp timestamp option, tsval of tx acks and tsecr of rx data*/
+	u32 tsval;
 };
 
 struct tcp_ack_info {
@@ -52,6 +60,14 @@ struct tcp_ack_info {
 	struct msg_buf *msgbuf;
 	struct msg_buf *in_send_msg;
 	struct tcp_ack_msg ack_msg;
+	struct hlist_node hnode;
+	/*rtt sample in flight: tsval of the ack and when it was seen*/
+	u32 rtt_tsval;
+	ktime_t rtt_stamp;
+	/*smoothed rtt in us, 0 until the first sample*/
+	u32 srtt_us;
+	u32 drop_total;
+	u32 send_total;
 };
 
 struct tcp_ack_manage {
@@ -66,6 +82,8 @@ struct tcp_ack_manage {
 	spinlock_t lock;
 	struct rwnx_hw *priv;
 	struct tcp_ack_info ack_info[TCP_ACK_NUM];
+	/*busy ack_info by flow, changed under lock*/
+	struct hlist_head hash[1 << TCP_ACK_HASH_BITS];
 	/*size in KB*/
 	unsigned int ack_winsize;
 };
@@ -76,8 +94,10 @@ void tcp_ack_init(struct rwnx_hw *priv);
 
 void tcp_ack_deinit(struct rwnx_hw *priv);
 
+extern int tcp_ack_max_delay;
+
 int is_drop_tcp_ack(struct tcphdr *tcphdr, int tcp_tot_len,
-		    unsigned short *win_scale);
+		    unsigned short *win_scale, u32 *tsval);
 
 int is_tcp_ack(struct sk_buff *skb, unsigned short *win_scale);
 
@@ -87,4 +107,6 @@ int filter_send_tcp_ack(struct rwnx_hw *priv, struct msg_buf *msgbuf,
 void filter_rx_tcp_ack(struct rwnx_hw *priv, unsigned char *buf, unsigned plen);
 
 void move_tcpack_msg(struct rwnx_hw *priv, struct msg_buf *msg);
+
+unsigned long tcp_ack_delay(struct tcp_ack_info *ack_info);
 #endif
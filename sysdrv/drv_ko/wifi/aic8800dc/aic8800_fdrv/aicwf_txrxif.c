@@ -232,6 +232,7 @@ struct aicwf_tx_priv *aicwf_tx_init(void *arg)
 	tx_priv->tail = tx_priv->aggr_buf->data;
 
 #ifdef CONFIG_SDIO_ADMA
+	sg_init_table(tx_priv->sg_list, SDIO_TX_SLIST_MAX);
 	tx_priv->aggr_segcnt = 0;
 	tx_priv->len = 0;
 #endif
@@ -275,6 +276,67 @@ static bool aicwf_another_ptk_1(struct rx_buff *buffer)
 
 	return true;
 }
+
+// A-MSDUs, fragments, management and monitor frames are parsed as a whole
+static bool aicwf_rxframe_can_share(const u8 *data, u16 aggr_len)
+{
+	const struct hw_rxhdr *hw_rxhdr = (const struct hw_rxhdr *)data;
+	const u8 *mac = data + RX_HWHRD_LEN;
+
+	if (aggr_len <= RX_COPY_HDR_LEN)
+		return false;
+#ifdef AICWF_RX_REORDER
+	if (hw_rxhdr->is_monitor_vif)
+		return false;
+#endif
+	if (!hw_rxhdr->flags_upload || hw_rxhdr->flags_is_80211_mpdu)
+		return false;
+
+	if ((mac[0] & 0x0f) != 0x08) // data
+		return false;
+	if ((mac[1] & 0x04) || (mac[22] & 0x0f)) // more frag, frag num
+		return false;
+	if ((mac[0] & 0x80) && (mac[24] & 0x80)) // qos amsdu
+		return false;
+
+	return true;
+}
+
+/*
+ * Build the skb of a data frame on the prealloc buffer: only the headers
+ * rwnx_rxdataind_aicwf() rewrites are copied, the payload is attached as a
+ * fragment of the buffer page, which goes back to the ring once the stack
+ * has freed all the skbs of the buffer.
+ */
+static struct sk_buff *aicwf_rxframe_build_skb(struct rx_buff *buffer,
+					       u8 *data, u16 aggr_len,
+					       u16 adjust_len)
+{
+	struct sk_buff *skb;
+
+	if (!aicwf_rxframe_can_share(data, aggr_len)) {
+		skb = __dev_alloc_skb(aggr_len + CCMP_OR_WEP_INFO, GFP_KERNEL);
+		if (skb) {
+			skb_put(skb, aggr_len);
+			memcpy(skb->data, data, aggr_len);
+		}
+		return skb;
+	}
+
+	skb = __dev_alloc_skb(RX_COPY_HDR_LEN + CCMP_OR_WEP_INFO, GFP_KERNEL);
+	if (skb == NULL)
+		return NULL;
+
+	skb_put(skb, RX_COPY_HDR_LEN);
+	memcpy(skb->data, data, RX_COPY_HDR_LEN);
+	get_page(buffer->page);
+	skb_add_rx_frag(skb, 0, buffer->page,
+			data + RX_COPY_HDR_LEN - buffer->data,
+			aggr_len - RX_COPY_HDR_LEN,
+			adjust_len - RX_COPY_HDR_LEN);
+
+	return skb;
+}
 #else
 static bool aicwf_another_ptk(struct sk_buff *skb)
 {
@@ -337,9 +399,8 @@ int aicwf_process_rxframes(struct aicwf_rx_priv *rx_priv)
 				else
 					adjust_len = aggr_len;
 
-				skb_inblock = __dev_alloc_skb(
-					aggr_len + CCMP_OR_WEP_INFO,
-					GFP_KERNEL);
+				skb_inblock = aicwf_rxframe_build_skb(
+					buffer, data, aggr_len, adjust_len);
 				if (skb_inblock == NULL) {
 					txrx_err("no more space! skip\n");
 					buffer->read =
@@ -347,8 +408,6 @@ int aicwf_process_rxframes(struct aicwf_rx_priv *rx_priv)
 					continue;
 				}
 
-				skb_put(skb_inblock, aggr_len);
-				memcpy(skb_inblock->data, data, aggr_len);
 				rwnx_rxdataind_aicwf(rx_priv->sdiodev->rwnx_hw,
 						     skb_inblock,
 						     (void *)rx_priv);
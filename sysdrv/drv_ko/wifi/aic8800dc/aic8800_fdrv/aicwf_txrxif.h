@@ -11,6 +11,8 @@
 
 #include <linux/skbuff.h>
 #include <linux/sched.h>
+#include <linux/hrtimer.h>
+#include <linux/scatterlist.h>
 #include "ipc_shared.h"
 #include "aicwf_rx_prealloc.h"
 #ifdef AICWF_SDIO_SUPPORT
@@ -29,6 +31,7 @@
 #define CCMP_OR_WEP_INFO 8
 #define MAX_RXQLEN 2000
 #define RX_ALIGNMENT 4
+#define RX_COPY_HDR_LEN 256 //hw rx header, 802.11 and IP/TCP headers stay linear
 
 #define DEBUG_ERROR_LEVEL 0
 #define DEBUG_DEBUG_LEVEL 1
@@ -110,11 +113,6 @@ struct aicwf_bus {
 #define ALIGN4_ADJ_LEN(x) ((4 - (x & 3)) & 3)
 
 #define SDIO_TX_SLIST_MAX 136
-
-/*struct tx_scatterlist {
-	const void *buf;
-	unsigned int len;
-};*/
 #endif
 
 struct aicwf_tx_priv {
@@ -134,6 +132,14 @@ struct aicwf_tx_priv {
 	struct frame_queue txq;
 	spinlock_t txqlock;
 	struct semaphore txctl_sema;
+
+	//adaptive aggregation
+	u32 link_rate; //last tx phy rate, in 100 kbps
+	int aggr_target;
+	bool aggr_flush;
+	struct hrtimer aggr_timer;
+	u32 aggr_hist[AICWF_SDIO_AGGR_HIST_LEN];
+	u32 aggr_timer_flush;
 #endif
 #ifdef AICWF_USB_SUPPORT
 	struct aic_usb_dev *usbdev;
@@ -144,7 +150,7 @@ struct aicwf_tx_priv {
 	u8 *tail;
 
 #ifdef CONFIG_SDIO_ADMA
-	struct tx_scatterlist sg_list[SDIO_TX_SLIST_MAX];
+	struct scatterlist sg_list[SDIO_TX_SLIST_MAX];
 	void *free_buf[SDIO_TX_SLIST_MAX];
 	bool copyd[SDIO_TX_SLIST_MAX];
 	u32 aggr_segcnt;
@@ -501,8 +501,12 @@ static int cmd_mgr_msgind(struct rwnx_cmd_mgr *cmd_mgr,
 	}
 	spin_unlock_bh(&cmd_mgr->lock);
 
-	if (!found)
+	if (!found) {
+		/* an indication, which may have woken up the host */
+		if (rwnx_hw)
+			rwnx_wake_reason_event(rwnx_hw);
 		cmd_mgr_run_callback(rwnx_hw, NULL, msg, cb);
+	}
 
 	return 0;
 }
@@ -195,9 +195,18 @@ DEBUGFS_READ_WRITE_FILE_OPS(stats);
 #define PS_HDR_MAX_LEN 0
 #endif /* CONFIG_RWNX_FULLMAC */
 
+#ifdef AICWF_SDIO_SUPPORT
+#define AIRTIME_HDR "airtime: tx=%llu us, pending=%d us, rate=%u.%u Mbps\n"
+#define AIRTIME_HDR_MAX_LEN                                                    \
+	sizeof("airtime: tx=xxxxxxxxxxxxxxxxxxxx us, pending=xxxxxxxxxx us, rate=xxxx.x Mbps\n")
+#else
+#define AIRTIME_HDR_MAX_LEN 0
+#endif
+
 #define STA_HDR "** STA %d (%pM)\n"
 #define STA_HDR_MAX_LEN                                                        \
-	(sizeof("- STA xx (xx:xx:xx:xx:xx:xx)\n") + PS_HDR_MAX_LEN)
+	(sizeof("- STA xx (xx:xx:xx:xx:xx:xx)\n") + PS_HDR_MAX_LEN +             \
+	 AIRTIME_HDR_MAX_LEN)
 
 #ifdef CONFIG_RWNX_FULLMAC
 #define VIF_HDR "* VIF [%d] %s\n"
@@ -317,6 +326,14 @@ static int rwnx_dbgfs_txq_sta(char *buf, size_t size, struct rwnx_sta *rwnx_sta,
 	}
 #endif /* CONFIG_RWNX_FULLMAC */
 
+#ifdef AICWF_SDIO_SUPPORT
+	res = scnprintf(&buf[idx], size, AIRTIME_HDR, rwnx_sta->airtime.tx,
+			atomic_read(&rwnx_sta->airtime.pending),
+			rwnx_sta->airtime.rate / 10, rwnx_sta->airtime.rate % 10);
+	idx += res;
+	size -= res;
+#endif
+
 	res = scnprintf(&buf[idx], size,
 			TXQ_STA_PREF TXQ_HDR TXQ_HDR_SUFF "\n");
 	idx += res;
@@ -665,6 +682,141 @@ static ssize_t rwnx_dbgfs_sys_stats_read(struct file *file,
 
 DEBUGFS_READ_FILE_OPS(sys_stats);
 
+#ifdef AICWF_SDIO_SUPPORT
+static ssize_t rwnx_dbgfs_sdio_aggr_read(struct file *file,
+					 char __user *user_buf, size_t count,
+					 loff_t *ppos)
+{
+	static const char *const sizes[AICWF_SDIO_AGGR_HIST_LEN] = {
+		"1", "2-3", "4-7", "8-15", "16-31", "32-63", "64+"
+	};
+	struct rwnx_hw *priv = file->private_data;
+	struct aicwf_tx_priv *tx_priv;
+	char buf[16 * 64];
+	int len = 0;
+	int i;
+	u32 rate;
+
+	if (!priv->sdiodev || !priv->sdiodev->tx_priv)
+		return 0;
+
+	tx_priv = priv->sdiodev->tx_priv;
+	rate = READ_ONCE(tx_priv->link_rate);
+
+	len += scnprintf(&buf[len], sizeof(buf) - len,
+			 "link rate   : %u.%u Mbps\n", rate / 10, rate % 10);
+	len += scnprintf(&buf[len], sizeof(buf) - len,
+			 "aggr target : %d pkts\n", tx_priv->aggr_target);
+	len += scnprintf(&buf[len], sizeof(buf) - len,
+			 "fw credits  : %d\n", tx_priv->fw_avail_bufcnt);
+	len += scnprintf(&buf[len], sizeof(buf) - len,
+			 "max %d pkts, latency %d us, hold %d us\n",
+			 tx_aggr_counter, tx_aggr_latency_us, tx_aggr_hold_us);
+	len += scnprintf(&buf[len], sizeof(buf) - len,
+			 "hold timeouts: %u\n", tx_priv->aggr_timer_flush);
+	len += scnprintf(&buf[len], sizeof(buf) - len, "bursts by pkts:\n");
+	for (i = 0; i < AICWF_SDIO_AGGR_HIST_LEN; i++)
+		len += scnprintf(&buf[len], sizeof(buf) - len,
+				 "  %-6s: %u\n", sizes[i],
+				 tx_priv->aggr_hist[i]);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+DEBUGFS_READ_FILE_OPS(sdio_aggr);
+#endif
+
+#ifdef CONFIG_FILTER_TCP_ACK
+static ssize_t rwnx_dbgfs_tcp_ack_read(struct file *file,
+				       char __user *user_buf, size_t count,
+				       loff_t *ppos)
+{
+	struct rwnx_hw *priv = file->private_data;
+	struct tcp_ack_manage *ack_m = &priv->ack_m;
+	struct tcp_ack_info *ack_info;
+	struct tcp_ack_msg ack;
+	char *buf;
+	size_t bufsz = (TCP_ACK_NUM + 2) * 112;
+	ssize_t read;
+	unsigned start;
+	int len = 0;
+	int i, busy;
+	u32 srtt_us, drop, sent;
+
+	buf = kmalloc(bufsz, GFP_ATOMIC);
+	if (buf == NULL)
+		return 0;
+
+	len += scnprintf(&buf[len], bufsz - len,
+			 "max delay %d ms, max drop %d, min win %u KB\n",
+			 tcp_ack_max_delay, atomic_read(&ack_m->max_drop_cnt),
+			 ack_m->ack_winsize);
+	len += scnprintf(&buf[len], bufsz - len,
+			 "%-21s %-21s %8s %6s %10s %10s\n", "source", "dest",
+			 "srtt(us)", "delay", "dropped", "sent");
+
+	for (i = 0; i < TCP_ACK_NUM; i++) {
+		ack_info = &ack_m->ack_info[i];
+		do {
+			start = read_seqbegin(&ack_info->seqlock);
+			busy = ack_info->busy;
+			ack = ack_info->ack_msg;
+			srtt_us = ack_info->srtt_us;
+			drop = ack_info->drop_total;
+			sent = ack_info->send_total;
+		} while (read_seqretry(&ack_info->seqlock, start));
+
+		if (!busy)
+			continue;
+
+		len += scnprintf(&buf[len], bufsz - len,
+				 "%pI4:%-5u %pI4:%-5u %8u %4ums %10u %10u\n",
+				 &ack.saddr, ntohs(ack.source), &ack.daddr,
+				 ntohs(ack.dest), srtt_us,
+				 jiffies_to_msecs(tcp_ack_delay(ack_info)),
+				 drop, sent);
+	}
+
+	read = simple_read_from_buffer(user_buf, count, ppos, buf, len);
+	kfree(buf);
+
+	return read;
+}
+
+DEBUGFS_READ_FILE_OPS(tcp_ack);
+#endif
+
+static ssize_t rwnx_dbgfs_wake_reason_read(struct file *file,
+					   char __user *user_buf, size_t count,
+					   loff_t *ppos)
+{
+	struct rwnx_hw *priv = file->private_data;
+	struct rwnx_wake_stats *stats = &priv->wake_stats;
+	char buf[512];
+	int len;
+
+	len = scnprintf(buf, sizeof(buf),
+			"wake irq     %10u\n"
+			"fw event     %10u\n"
+			"rx data      %10u\n"
+			"  unicast    %10u\n"
+			"  multicast  %10u (ipv4 %u, ipv6 %u, other %u)\n"
+			"  broadcast  %10u\n"
+			"  icmp       %10u\n"
+			"  icmp6      %10u (ra %u, ns %u, na %u)\n"
+			"unknown      %10u\n",
+			stats->wake_irq, stats->cmd_event, stats->rx_data,
+			stats->rx_unicast, stats->rx_multicast,
+			stats->ipv4_mcast, stats->ipv6_mcast,
+			stats->other_mcast, stats->rx_broadcast, stats->icmp,
+			stats->icmp6, stats->icmp6_ra, stats->icmp6_ns,
+			stats->icmp6_na, stats->unknown);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+DEBUGFS_READ_FILE_OPS(wake_reason);
+
 #ifdef CONFIG_RWNX_MUMIMO_TX
 static ssize_t rwnx_dbgfs_mu_group_read(struct file *file,
 					char __user *user_buf, size_t count,
@@ -2479,6 +2631,13 @@ int rwnx_dbgfs_register(struct rwnx_hw *rwnx_hw, const char *name)
 			S_IWUSR | S_IRUSR);
 	DEBUGFS_ADD_FILE(stats, dir_drv, S_IWUSR | S_IRUSR);
 	DEBUGFS_ADD_FILE(sys_stats, dir_drv, S_IRUSR);
+#ifdef AICWF_SDIO_SUPPORT
+	DEBUGFS_ADD_FILE(sdio_aggr, dir_drv, S_IRUSR);
+#endif
+#ifdef CONFIG_FILTER_TCP_ACK
+	DEBUGFS_ADD_FILE(tcp_ack, dir_drv, S_IRUSR);
+#endif
+	DEBUGFS_ADD_FILE(wake_reason, dir_drv, S_IRUSR);
 	DEBUGFS_ADD_FILE(txq, dir_drv, S_IRUSR);
 	DEBUGFS_ADD_FILE(acsinfo, dir_drv, S_IRUSR);
 #ifdef CONFIG_RWNX_MUMIMO_TX
@@ -280,6 +280,30 @@ struct rwnx_tdls {
 	bool chsw_allowed; /* Indicate if TDLS channel switch is allowed */
 };
 
+/**
+ * struct rwnx_last_bss - BSS of the last successful connection
+ *
+ * Kept across suspend and disconnection so that a reconnection to the same
+ * SSID can be sent to the fw with the BSSID and channel already known, the fw
+ * then joins with a directed probe on that single channel instead of scanning
+ * all of them.
+ *
+ * @ssid: SSID of the BSS
+ * @ssid_len: length of @ssid, 0 if no BSS is cached
+ * @bssid: BSSID of the BSS
+ * @chan: primary channel of the BSS
+ * @time: boottime of the connection
+ * @hinted: the pending connection request was completed from this cache
+ */
+struct rwnx_last_bss {
+	u8 ssid[IEEE80211_MAX_SSID_LEN];
+	u8 ssid_len;
+	u8 bssid[ETH_ALEN];
+	struct ieee80211_channel *chan;
+	ktime_t time;
+	bool hinted;
+};
+
 /**
  * enum rwnx_ap_flags - AP flags
  *
@@ -321,6 +345,7 @@ struct rwnx_vif {
 	enum nl80211_auth_type
 		last_auth_type; /* Authentication type (algorithm) sent in the last connection
 											  when WEP enabled */
+	struct rwnx_last_bss last_bss; /* BSS of the last connection, for fast reconnect */
 	union {
 		struct {
 			struct rwnx_sta *
@@ -433,6 +458,19 @@ struct rwnx_sta_stats {
 	struct rwnx_rx_rate_stats rx_rate;
 };
 
+/*
+ * Airtime accounting of a station, see rwnx_txq_airtime_charge().
+ */
+struct rwnx_sta_airtime {
+	s32 deficit[NX_TXQ_CNT]; /* airtime left in the current round per
+							   HWQ (us) */
+	atomic_t pending; /* airtime queued to the bus and not sent
+							   yet (us) */
+	u32 rate; /* estimated tx rate (100kbps) */
+	unsigned long rate_time; /* jiffies of the last rate update */
+	u64 tx; /* total airtime pushed (us) */
+};
+
 #if (defined CONFIG_HE_FOR_OLD_KERNEL) || (defined CONFIG_VHT_FOR_OLD_KERNEL)
 struct aic_sta {
 	u8 sta_idx; /* Identifier of the station */
@@ -494,6 +532,7 @@ struct rwnx_sta {
 	u32 ac_param[AC_MAX]; /* EDCA parameters */
 	struct rwnx_tdls tdls; /* TDLS station information */
 	struct rwnx_sta_stats stats;
+	struct rwnx_sta_airtime airtime;
 	enum nl80211_mesh_power_mode
 		mesh_pm; /*  link-specific mesh power save mode */
 };
@@ -615,6 +654,30 @@ static const char *const s_conn_state[] = {
 	"RWNX_DRV_STATUS_ROAMING",
 };
 
+/*
+ * Reasons of the host wake ups, from the first event or frame received after
+ * resume, see rwnx_wake_reason_rx().
+ */
+struct rwnx_wake_stats {
+	atomic_t armed; /* host suspended, next rx is the wake reason */
+	unsigned long resume_time; /* jiffies of the last resume */
+	u32 wake_irq; /* host wake irqs */
+	u32 cmd_event; /* fw events */
+	u32 rx_data; /* data frames */
+	u32 rx_unicast;
+	u32 rx_multicast;
+	u32 rx_broadcast;
+	u32 icmp;
+	u32 icmp6;
+	u32 icmp6_ra;
+	u32 icmp6_na;
+	u32 icmp6_ns;
+	u32 ipv4_mcast;
+	u32 ipv6_mcast;
+	u32 other_mcast;
+	u32 unknown; /* nothing received after resume */
+};
+
 struct rwnx_hw {
 	struct rwnx_mod_params *mod_params;
 	struct device *dev;
@@ -697,6 +760,7 @@ struct rwnx_hw {
 #endif
 
 	struct rwnx_hwq hwq[NX_TXQ_CNT];
+	bool aql_kick; /* a txq was held back by the airtime limit */
 
 	u64 avail_idx_map;
 	u8 vif_started;
@@ -732,6 +796,8 @@ struct rwnx_hw {
 	struct wakeup_source *ws_irqrx;
 	struct wakeup_source *ws_tx;
 	struct wakeup_source *ws_pwrctrl;
+	struct rwnx_wake_stats wake_stats;
+	bool wow_patterns; /* wake patterns programmed in the fw */
 
 #ifdef CONFIG_SCHED_SCAN
 	bool is_sched_scan;
@@ -4729,6 +4729,19 @@ static int rwnx_fill_station_info(struct rwnx_sta *sta, struct rwnx_vif *vif,
 	sinfo->filled |= (BIT(NL80211_STA_INFO_TX_BITRATE) |
 			  BIT(NL80211_STA_INFO_TX_FAILED));
 
+#ifdef AICWF_SDIO_SUPPORT
+	//sizes the sdio tx bursts, see aicwf_sdio_aggr_target()
+	if (vif->rwnx_hw->sdiodev && vif->rwnx_hw->sdiodev->tx_priv)
+		WRITE_ONCE(vif->rwnx_hw->sdiodev->tx_priv->link_rate,
+			   cfg80211_calculate_bitrate(&sinfo->txrate));
+	//airtime of the buffers pushed to this sta, see rwnx_txq_airtime_rate()
+	if (cfg80211_calculate_bitrate(&sinfo->txrate)) {
+		WRITE_ONCE(sta->airtime.rate,
+			   cfg80211_calculate_bitrate(&sinfo->txrate));
+		WRITE_ONCE(sta->airtime.rate_time, jiffies);
+	}
+#endif
+
 	sinfo->inactive_time =
 		jiffies_to_msecs(jiffies - vif->rwnx_hw->stats.last_tx);
 	sinfo->rx_bytes = vif->net_stats.rx_bytes;
@@ -4737,82 +4750,8 @@ static int rwnx_fill_station_info(struct rwnx_sta *sta, struct rwnx_vif *vif,
 	sinfo->rx_packets = vif->net_stats.rx_packets;
 	sinfo->signal = (s8)cfm.rssi;
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 0, 0)
-	switch (rx_vect1->ch_bw) {
-	case PHY_CHNL_BW_20:
-		sinfo->rxrate.bw = RATE_INFO_BW_20;
-		break;
-	case PHY_CHNL_BW_40:
-		sinfo->rxrate.bw = RATE_INFO_BW_40;
-		break;
-	case PHY_CHNL_BW_80:
-		sinfo->rxrate.bw = RATE_INFO_BW_80;
-		break;
-	case PHY_CHNL_BW_160:
-		sinfo->rxrate.bw = RATE_INFO_BW_160;
-		break;
-	default:
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
-		sinfo->rxrate.bw = RATE_INFO_BW_HE_RU;
-#else
-		sinfo->rxrate.bw = RATE_INFO_BW_20;
-#endif
-		break;
-	}
-#endif
-
-	switch (rx_vect1->format_mod) {
-	case FORMATMOD_NON_HT:
-	case FORMATMOD_NON_HT_DUP_OFDM:
-		sinfo->rxrate.flags = 0;
-		sinfo->rxrate.legacy = legrates_lut[rx_vect1->leg_rate].rate;
-		sinfo->rxrate.nss = 1;
-		break;
-	case FORMATMOD_HT_MF:
-	case FORMATMOD_HT_GF:
-		sinfo->rxrate.flags = RATE_INFO_FLAGS_MCS;
-		if (rx_vect1->ht.short_gi)
-			sinfo->rxrate.flags |= RATE_INFO_FLAGS_SHORT_GI;
-		sinfo->rxrate.mcs = rx_vect1->ht.mcs;
-		sinfo->rxrate.nss = rx_vect1->ht.num_extn_ss + 1;
-		break;
-	case FORMATMOD_VHT:
-		sinfo->rxrate.flags = RATE_INFO_FLAGS_VHT_MCS;
-		if (rx_vect1->vht.short_gi)
-			sinfo->rxrate.flags |= RATE_INFO_FLAGS_SHORT_GI;
-		sinfo->rxrate.mcs = rx_vect1->vht.mcs;
-		sinfo->rxrate.nss = rx_vect1->vht.nss + 1;
-		break;
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
-	case FORMATMOD_HE_MU:
-		sinfo->rxrate.he_ru_alloc = rx_vect1->he.ru_size;
-	case FORMATMOD_HE_SU:
-	case FORMATMOD_HE_ER:
-		sinfo->rxrate.flags = RATE_INFO_FLAGS_HE_MCS;
-		sinfo->rxrate.mcs = rx_vect1->he.mcs;
-		sinfo->rxrate.he_gi = rx_vect1->he.gi_type;
-		sinfo->rxrate.he_dcm = rx_vect1->he.dcm;
-		sinfo->rxrate.nss = rx_vect1->he.nss + 1;
-		break;
-#else
-	//kernel not support he
-	case FORMATMOD_HE_MU:
-	case FORMATMOD_HE_SU:
-	case FORMATMOD_HE_ER:
-		sinfo->rxrate.flags = RATE_INFO_FLAGS_VHT_MCS;
-		if (rx_vect1->he.mcs > 9) {
-			sinfo->rxrate.mcs = 9;
-		} else {
-			sinfo->rxrate.mcs = rx_vect1->he.mcs;
-		}
-		sinfo->rxrate.mcs =
-			(rx_vect1->he.mcs > 9 ? 9 : rx_vect1->he.mcs);
-		sinfo->rxrate.nss = rx_vect1->he.nss + 1;
-		break;
-#endif
-	default:
+	if (rwnx_rx_vect_rate_info(rx_vect1, &sinfo->rxrate))
 		return -EINVAL;
-	}
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4, 0, 0)
 	sinfo->filled |= (STATION_INFO_INACTIVE_TIME | STATION_INFO_RX_BYTES64 |
@@ -5362,6 +5301,63 @@ static int rwnx_cfg80211_leave_mesh(struct wiphy *wiphy, struct net_device *dev)
 	return 0;
 }
 
+#if IS_ENABLED(CONFIG_PM)
+/* wake patterns matched by the fw while the host sleeps */
+#define RWNX_WOWLAN_MAX_PATTERNS 4
+#define RWNX_WOWLAN_MAX_PATTERN_LEN 64
+#define RWNX_WOWLAN_MAX_PKT_OFFSET 128
+
+/**
+ * @suspend: program the wake patterns, so that the fw only wakes up the host
+ *  for the frames the host has to handle
+ */
+static int rwnx_cfg80211_suspend(struct wiphy *wiphy,
+				 struct cfg80211_wowlan *wow)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 13, 0)
+	struct rwnx_hw *rwnx_hw = wiphy_priv(wiphy);
+	u8 mask[RWNX_WOWLAN_MAX_PATTERN_LEN];
+	int i, j, error;
+
+	if (!wow || !wow->n_patterns)
+		return 0;
+
+	for (i = 0; i < wow->n_patterns; i++) {
+		struct cfg80211_pkt_pattern *pat = &wow->patterns[i];
+
+		/* cfg80211 mask has one bit per pattern byte, the fw one byte */
+		for (j = 0; j < pat->pattern_len; j++)
+			mask[j] = (pat->mask[j / 8] & BIT(j % 8)) ? 0xff : 0;
+
+		error = rwnx_send_set_wakeup_info_req(rwnx_hw, pat->pkt_offset,
+						      mask, pat->pattern,
+						      pat->pattern_len);
+		if (error) {
+			rwnx_send_set_wakeup_info_req(rwnx_hw, 0, NULL, NULL, 0);
+			return error;
+		}
+	}
+	rwnx_hw->wow_patterns = true;
+#endif
+
+	return 0;
+}
+
+/**
+ * @resume: clear the wake patterns, the host gets all the frames again
+ */
+static int rwnx_cfg80211_resume(struct wiphy *wiphy)
+{
+	struct rwnx_hw *rwnx_hw = wiphy_priv(wiphy);
+
+	if (!rwnx_hw->wow_patterns)
+		return 0;
+
+	rwnx_hw->wow_patterns = false;
+	return rwnx_send_set_wakeup_info_req(rwnx_hw, 0, NULL, NULL, 0);
+}
+#endif
+
 static struct cfg80211_ops rwnx_cfg80211_ops = {
 	.add_virtual_intf = rwnx_cfg80211_add_iface,
 	.del_virtual_intf = rwnx_cfg80211_del_iface,
@@ -5417,6 +5413,10 @@ static struct cfg80211_ops rwnx_cfg80211_ops = {
 	.sched_scan_start = rwnx_cfg80211_sched_scan_start,
 	.sched_scan_stop = rwnx_cfg80211_sched_scan_stop,
 #endif
+#if IS_ENABLED(CONFIG_PM)
+	.suspend = rwnx_cfg80211_suspend,
+	.resume = rwnx_cfg80211_resume,
+#endif
 };
 
 /*********************************************************************
@@ -5510,6 +5510,12 @@ extern int get_wifi_custom_mac_address(char *addr_str);
 #if IS_ENABLED(CONFIG_PM)
 static const struct wiphy_wowlan_support aic_wowlan_support = {
 	.flags = WIPHY_WOWLAN_ANY | WIPHY_WOWLAN_MAGIC_PKT,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 13, 0)
+	.n_patterns = RWNX_WOWLAN_MAX_PATTERNS,
+	.pattern_min_len = 1,
+	.pattern_max_len = RWNX_WOWLAN_MAX_PATTERN_LEN,
+	.max_pkt_offset = RWNX_WOWLAN_MAX_PKT_OFFSET,
+#endif
 };
 #endif
 /**
@@ -792,6 +792,33 @@ static inline int rwnx_rx_me_tx_credits_update_ind(struct rwnx_hw *rwnx_hw,
  * Messages from SM task
  **************************************************************************/
 #ifdef CONFIG_RWNX_FULLMAC
+/*
+ * Remember the BSS of a successful connection for the next connection to the
+ * same SSID. A failed connection which was completed from the cache drops it,
+ * so that the retry of the supplicant scans all the channels again.
+ */
+static void rwnx_last_bss_update(struct rwnx_vif *rwnx_vif,
+				 struct sm_connect_ind *ind,
+				 struct ieee80211_channel *chan)
+{
+	struct rwnx_last_bss *last = &rwnx_vif->last_bss;
+
+	if (ind->status_code == 0 && chan && rwnx_vif->sta.ssid_len > 0 &&
+	    rwnx_vif->sta.ssid_len <= IEEE80211_MAX_SSID_LEN) {
+		memcpy(last->ssid, rwnx_vif->sta.ssid, rwnx_vif->sta.ssid_len);
+		last->ssid_len = rwnx_vif->sta.ssid_len;
+		memcpy(last->bssid, ind->bssid.array, ETH_ALEN);
+		last->chan = chan;
+		last->time = ktime_get_boottime();
+	} else if (ind->status_code && last->hinted) {
+		AICWFDBG(LOGINFO, "%s join %pM failed, drop it\n", __func__,
+			 last->bssid);
+		last->ssid_len = 0;
+		last->chan = NULL;
+	}
+	last->hinted = false;
+}
+
 static inline int rwnx_rx_sm_connect_ind(struct rwnx_hw *rwnx_hw,
 					 struct rwnx_cmd *cmd,
 					 struct ipc_e2a_msg *msg)
@@ -802,7 +829,7 @@ static inline int rwnx_rx_sm_connect_ind(struct rwnx_hw *rwnx_hw,
 	const u8 *req_ie, *rsp_ie;
 	const u8 *extcap_ie;
 	const struct ieee_types_extcap *extcap;
-	struct ieee80211_channel *chan;
+	struct ieee80211_channel *chan = NULL;
 	//struct cfg80211_bss *bss = NULL;
 	struct wireless_dev *wdev = NULL;
 	//int retry_counter = 10;
@@ -937,6 +964,7 @@ static inline int rwnx_rx_sm_connect_ind(struct rwnx_hw *rwnx_hw,
 		rwnx_set_conn_state(&rwnx_vif->drv_conn_state,
 				    (int)RWNX_DRV_STATUS_DISCONNECTED);
 	}
+	rwnx_last_bss_update(rwnx_vif, ind, chan);
 
 	AICWFDBG(
 		LOGINFO,
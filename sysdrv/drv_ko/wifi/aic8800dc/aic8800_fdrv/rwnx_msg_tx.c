@@ -60,6 +60,11 @@ const int chnl2bw[] = {
 	[PHY_CHNL_BW_80P80] = NL80211_CHAN_WIDTH_80P80,
 };
 
+// Seconds a cached last BSS may be used to complete a connection request
+// without BSSID and channel, 0 disables the fast reconnect
+static int fast_reconnect_timeout = 600;
+module_param_named(fast_reconnect_timeout, fast_reconnect_timeout, int, 0644);
+
 #define RWNX_CMD_ARRAY_SIZE 40
 #define RWNX_CMD_HIGH_WATER_SIZE RWNX_CMD_ARRAY_SIZE / 2
 
@@ -1456,6 +1461,85 @@ int rwnx_send_vendor_hwconfig_req(struct rwnx_hw *rwnx_hw, uint32_t hwconfig_id,
 	return error;
 }
 
+/**
+ * rwnx_send_set_keepalive_req - Configure a keepalive frame sent by the fw
+ *
+ * @rwnx_hw: Main driver data
+ * @code: Keepalive slot
+ * @payload: 802.3 frame to send, NULL to stop the keepalive of @code
+ * @length: Length of @payload
+ * @intv: Period in ms
+ *
+ * The fw keeps sending the frame while the host sleeps, so the AP and the
+ * remote server don't drop the connection.
+ */
+int rwnx_send_set_keepalive_req(struct rwnx_hw *rwnx_hw, u16 code,
+				const u8 *payload, u16 length, u32 intv)
+{
+	struct mm_set_keepalive_req *req;
+
+	RWNX_DBG(RWNX_FN_ENTRY_STR);
+
+	if (!payload)
+		length = 0;
+
+	/* Build the KEEPALIVE_PKT_REQ message */
+	req = rwnx_msg_zalloc(MM_SET_VENDOR_HWCONFIG_REQ, TASK_MM, DRV_TASK_ID,
+			      sizeof(struct mm_set_keepalive_req) + length);
+	if (!req)
+		return -ENOMEM;
+
+	/* Fill the message parameters */
+	req->hwconfig_id = KEEPALIVE_PKT_REQ;
+	req->code = code;
+	req->length = length;
+	req->intv = length ? intv : 0;
+	if (length)
+		memcpy(req->payload, payload, length);
+
+	/* Send the MM_SET_VENDOR_HWCONFIG_REQ message to UMAC FW */
+	return rwnx_send_msg(rwnx_hw, req, 1, MM_SET_VENDOR_HWCONFIG_CFM, NULL);
+}
+
+/**
+ * rwnx_send_set_wakeup_info_req - Add a pattern waking up the host
+ *
+ * @rwnx_hw: Main driver data
+ * @offset: Offset of the pattern in the received 802.3 frame
+ * @mask: One byte per pattern byte, 0 for the bytes to ignore
+ * @pattern: Bytes to match
+ * @length: Length of @mask and @pattern, 0 to clear all the patterns
+ *
+ * While the host sleeps, the fw only raises the host wake up for the frames
+ * matching one of the patterns.
+ */
+int rwnx_send_set_wakeup_info_req(struct rwnx_hw *rwnx_hw, u16 offset,
+				  const u8 *mask, const u8 *pattern, u8 length)
+{
+	struct mm_set_wakeup_info_req *req;
+
+	RWNX_DBG(RWNX_FN_ENTRY_STR);
+
+	/* Build the WAKEUP_INFO_REQ message, the mask is followed by the pattern */
+	req = rwnx_msg_zalloc(MM_SET_VENDOR_HWCONFIG_REQ, TASK_MM, DRV_TASK_ID,
+			      sizeof(struct mm_set_wakeup_info_req) +
+				      2 * length);
+	if (!req)
+		return -ENOMEM;
+
+	/* Fill the message parameters */
+	req->hwconfig_id = WAKEUP_INFO_REQ;
+	req->offset = offset;
+	req->length = length;
+	if (length) {
+		memcpy(req->mask_and_patten, mask, length);
+		memcpy(req->mask_and_patten + length, pattern, length);
+	}
+
+	/* Send the MM_SET_VENDOR_HWCONFIG_REQ message to UMAC FW */
+	return rwnx_send_msg(rwnx_hw, req, 1, MM_SET_VENDOR_HWCONFIG_CFM, NULL);
+}
+
 int rwnx_send_vendor_swconfig_req(struct rwnx_hw *rwnx_hw, uint32_t swconfig_id,
 				  int32_t *param_in, int32_t *param_out)
 {
@@ -3315,12 +3399,56 @@ int rwnx_send_me_config_req(struct rwnx_hw *rwnx_hw)
 				     NULL);
 	}
 
+	/*
+	 * Complete a connection request to the last connected SSID with the
+	 * BSSID and channel of that BSS, so that the fw joins it on a single
+	 * channel. Only requests leaving both to the driver are completed, and
+	 * only if the supplicant doesn't hint at another BSS.
+	 */
+	static void rwnx_last_bss_hint(struct rwnx_vif *rwnx_vif,
+				       struct cfg80211_connect_params *sme,
+				       const u8 **bssid,
+				       struct ieee80211_channel **chan)
+	{
+		struct rwnx_last_bss *last = &rwnx_vif->last_bss;
+
+		last->hinted = false;
+		if (fast_reconnect_timeout <= 0 || *bssid || *chan ||
+		    !last->ssid_len || !last->chan)
+			return;
+
+		if (sme->ssid_len != last->ssid_len ||
+		    memcmp(sme->ssid, last->ssid, last->ssid_len))
+			return;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 15, 0)
+		if (sme->bssid_hint &&
+		    !ether_addr_equal(sme->bssid_hint, last->bssid))
+			return;
+#endif
+
+		if (last->chan->flags & IEEE80211_CHAN_DISABLED)
+			return;
+
+		if (ktime_to_ms(ktime_sub(ktime_get_boottime(), last->time)) >
+		    fast_reconnect_timeout * 1000LL)
+			return;
+
+		*bssid = last->bssid;
+		*chan = last->chan;
+		last->hinted = true;
+		AICWFDBG(LOGINFO, "%s join %pM on %d MHz\n", __func__,
+			 last->bssid, last->chan->center_freq);
+	}
+
 	int rwnx_send_sm_connect_req(struct rwnx_hw * rwnx_hw,
 				     struct rwnx_vif * rwnx_vif,
 				     struct cfg80211_connect_params * sme,
 				     struct sm_connect_cfm * cfm)
 	{
 		struct sm_connect_req *req;
+		const u8 *bssid = sme->bssid;
+		struct ieee80211_channel *chan = sme->channel;
 		int i;
 		u32_l flags = 0;
 		bool gval = false;
@@ -3377,15 +3505,16 @@ int rwnx_send_me_config_req(struct rwnx_hw *rwnx_hw)
 
 		req->ctrl_port_ethertype = sme->crypto.control_port_ethertype;
 
-		if (sme->bssid)
-			memcpy(&req->bssid, sme->bssid, ETH_ALEN);
+		rwnx_last_bss_hint(rwnx_vif, sme, &bssid, &chan);
+		if (bssid)
+			memcpy(&req->bssid, bssid, ETH_ALEN);
 		else
 			req->bssid = mac_addr_bcst;
 		req->vif_idx = rwnx_vif->vif_index;
-		if (sme->channel) {
-			req->chan.band = sme->channel->band;
-			req->chan.freq = sme->channel->center_freq;
-			req->chan.flags = get_chan_flags(sme->channel->flags);
+		if (chan) {
+			req->chan.band = chan->band;
+			req->chan.freq = chan->center_freq;
+			req->chan.flags = get_chan_flags(chan->flags);
 		} else {
 			req->chan.freq = (u16_l)-1;
 		}
@@ -3427,8 +3556,8 @@ int rwnx_send_me_config_req(struct rwnx_hw *rwnx_hw)
 		rwnx_vif->sta.ssid_len = (int)sme->ssid_len;
 		memset(rwnx_vif->sta.ssid, 0, rwnx_vif->sta.ssid_len + 1);
 		memcpy(rwnx_vif->sta.ssid, sme->ssid, rwnx_vif->sta.ssid_len);
-		if (sme->bssid)
-			memcpy(rwnx_vif->sta.bssid, sme->bssid, ETH_ALEN);
+		if (bssid)
+			memcpy(rwnx_vif->sta.bssid, bssid, ETH_ALEN);
 
 		printk("%s drv_vif_index:%d connect to %s(%d) channel:%d auth_type:%d\r\n",
 		       __func__, rwnx_vif->drv_vif_index, rwnx_vif->sta.ssid,
@@ -201,6 +201,10 @@ int rwnx_send_vendor_hwconfig_req(struct rwnx_hw *rwnx_hw, uint32_t hwconfig_id,
 				  int32_t *param, int32_t *param_out);
 int rwnx_send_vendor_swconfig_req(struct rwnx_hw *rwnx_hw, uint32_t swconfig_id,
 				  int32_t *param_in, int32_t *param_out);
+int rwnx_send_set_keepalive_req(struct rwnx_hw *rwnx_hw, u16 code,
+				const u8 *payload, u16 length, u32 intv);
+int rwnx_send_set_wakeup_info_req(struct rwnx_hw *rwnx_hw, u16 offset,
+				  const u8 *mask, const u8 *pattern, u8 length);
 int rwnx_send_mask_set_ext_flags_req(struct rwnx_hw *rwnx_hw,
 				     uint32_t flags_mask, uint32_t flags_val,
 				     struct mm_set_vendor_swconfig_cfm *cfm);
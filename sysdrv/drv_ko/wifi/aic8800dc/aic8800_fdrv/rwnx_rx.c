@@ -23,6 +23,9 @@
 #ifdef AICWF_ARP_OFFLOAD
 #include <linux/ip.h>
 #include <linux/udp.h>
+#include <linux/ipv6.h>
+#include <linux/icmpv6.h>
+#include <net/ndisc.h>
 #include "rwnx_msg_tx.h"
 #endif
 
@@ -271,6 +274,95 @@ static void rwnx_rx_statistic(struct rwnx_hw *rwnx_hw,
 #endif
 }
 
+/**
+ * rwnx_rx_vect_rate_info - Convert the rate of a rx vector
+ *
+ * @rx_vect1: rx vector of the frame
+ * @rate: filled with the rate of the frame
+ * @return: 0 on success, -EINVAL if the format is unknown
+ */
+int rwnx_rx_vect_rate_info(struct rx_vector_1 *rx_vect1, struct rate_info *rate)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 0, 0)
+	switch (rx_vect1->ch_bw) {
+	case PHY_CHNL_BW_20:
+		rate->bw = RATE_INFO_BW_20;
+		break;
+	case PHY_CHNL_BW_40:
+		rate->bw = RATE_INFO_BW_40;
+		break;
+	case PHY_CHNL_BW_80:
+		rate->bw = RATE_INFO_BW_80;
+		break;
+	case PHY_CHNL_BW_160:
+		rate->bw = RATE_INFO_BW_160;
+		break;
+	default:
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+		rate->bw = RATE_INFO_BW_HE_RU;
+#else
+		rate->bw = RATE_INFO_BW_20;
+#endif
+		break;
+	}
+#endif
+
+	switch (rx_vect1->format_mod) {
+	case FORMATMOD_NON_HT:
+	case FORMATMOD_NON_HT_DUP_OFDM:
+		rate->flags = 0;
+		rate->legacy = legrates_lut[rx_vect1->leg_rate].rate;
+		rate->nss = 1;
+		break;
+	case FORMATMOD_HT_MF:
+	case FORMATMOD_HT_GF:
+		rate->flags = RATE_INFO_FLAGS_MCS;
+		if (rx_vect1->ht.short_gi)
+			rate->flags |= RATE_INFO_FLAGS_SHORT_GI;
+		rate->mcs = rx_vect1->ht.mcs;
+		rate->nss = rx_vect1->ht.num_extn_ss + 1;
+		break;
+	case FORMATMOD_VHT:
+		rate->flags = RATE_INFO_FLAGS_VHT_MCS;
+		if (rx_vect1->vht.short_gi)
+			rate->flags |= RATE_INFO_FLAGS_SHORT_GI;
+		rate->mcs = rx_vect1->vht.mcs;
+		rate->nss = rx_vect1->vht.nss + 1;
+		break;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+	case FORMATMOD_HE_MU:
+		rate->he_ru_alloc = rx_vect1->he.ru_size;
+	case FORMATMOD_HE_SU:
+	case FORMATMOD_HE_ER:
+		rate->flags = RATE_INFO_FLAGS_HE_MCS;
+		rate->mcs = rx_vect1->he.mcs;
+		rate->he_gi = rx_vect1->he.gi_type;
+		rate->he_dcm = rx_vect1->he.dcm;
+		rate->nss = rx_vect1->he.nss + 1;
+		break;
+#else
+	//kernel not support he
+	case FORMATMOD_HE_MU:
+	case FORMATMOD_HE_SU:
+	case FORMATMOD_HE_ER:
+		rate->flags = RATE_INFO_FLAGS_VHT_MCS;
+		if (rx_vect1->he.mcs > 9) {
+			rate->mcs = 9;
+		} else {
+			rate->mcs = rx_vect1->he.mcs;
+		}
+		rate->mcs =
+			(rx_vect1->he.mcs > 9 ? 9 : rx_vect1->he.mcs);
+		rate->nss = rx_vect1->he.nss + 1;
+		break;
+#endif
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 /**
  * rwnx_rx_data_skb - Process one data frame
  *
@@ -293,6 +385,109 @@ static void rwnx_rx_statistic(struct rwnx_hw *rwnx_hw,
 #define RAISE_RX_SOFTIRQ() cpu_raise_softirq(smp_processor_id(), NET_RX_SOFTIRQ)
 #endif /* LINUX_VERSION_CODE  */
 
+/* how long after resume the first received frame is taken as the wake reason */
+#define RWNX_WAKE_REASON_TIMEOUT (HZ)
+
+/**
+ * rwnx_wake_reason_arm - Take the next received event or frame as wake reason
+ *
+ * @rwnx_hw: main driver data
+ *
+ * To be called when the host suspends.
+ */
+void rwnx_wake_reason_arm(struct rwnx_hw *rwnx_hw)
+{
+	/* nothing was received since the previous resume */
+	if (atomic_xchg(&rwnx_hw->wake_stats.armed, 1))
+		rwnx_hw->wake_stats.unknown++;
+}
+
+static bool rwnx_wake_reason_claim(struct rwnx_hw *rwnx_hw)
+{
+	struct rwnx_wake_stats *stats = &rwnx_hw->wake_stats;
+
+	if (likely(!atomic_read(&stats->armed)) ||
+	    !atomic_xchg(&stats->armed, 0))
+		return false;
+
+	if (time_after(jiffies, stats->resume_time + RWNX_WAKE_REASON_TIMEOUT)) {
+		stats->unknown++;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * rwnx_wake_reason_event - Account a fw event as wake reason
+ *
+ * @rwnx_hw: main driver data
+ */
+void rwnx_wake_reason_event(struct rwnx_hw *rwnx_hw)
+{
+	if (rwnx_wake_reason_claim(rwnx_hw))
+		rwnx_hw->wake_stats.cmd_event++;
+}
+
+/**
+ * rwnx_wake_reason_rx - Account a received frame as wake reason
+ *
+ * @rwnx_hw: main driver data
+ * @skb: received frame, after eth_type_trans()
+ */
+void rwnx_wake_reason_rx(struct rwnx_hw *rwnx_hw, struct sk_buff *skb)
+{
+	struct rwnx_wake_stats *stats = &rwnx_hw->wake_stats;
+
+	if (!rwnx_wake_reason_claim(rwnx_hw))
+		return;
+
+	stats->rx_data++;
+	switch (skb->pkt_type) {
+	case PACKET_BROADCAST:
+		stats->rx_broadcast++;
+		break;
+	case PACKET_MULTICAST:
+		stats->rx_multicast++;
+		if (skb->protocol == htons(ETH_P_IP))
+			stats->ipv4_mcast++;
+		else if (skb->protocol == htons(ETH_P_IPV6))
+			stats->ipv6_mcast++;
+		else
+			stats->other_mcast++;
+		break;
+	default:
+		stats->rx_unicast++;
+		break;
+	}
+
+	if (skb->protocol == htons(ETH_P_IP) &&
+	    pskb_may_pull(skb, sizeof(struct iphdr))) {
+		if (((struct iphdr *)skb->data)->protocol == IPPROTO_ICMP)
+			stats->icmp++;
+	} else if (skb->protocol == htons(ETH_P_IPV6) &&
+		   pskb_may_pull(skb, sizeof(struct ipv6hdr) +
+					      sizeof(struct icmp6hdr))) {
+		struct ipv6hdr *ip6h = (struct ipv6hdr *)skb->data;
+		struct icmp6hdr *icmp6h = (struct icmp6hdr *)(ip6h + 1);
+
+		if (ip6h->nexthdr != IPPROTO_ICMPV6)
+			return;
+
+		stats->icmp6++;
+		switch (icmp6h->icmp6_type) {
+		case NDISC_ROUTER_ADVERTISEMENT:
+			stats->icmp6_ra++;
+			break;
+		case NDISC_NEIGHBOUR_SOLICITATION:
+			stats->icmp6_ns++;
+			break;
+		case NDISC_NEIGHBOUR_ADVERTISEMENT:
+			stats->icmp6_na++;
+			break;
+		}
+	}
+}
+
 void rwnx_rx_data_skb_resend(struct rwnx_hw *rwnx_hw, struct rwnx_vif *rwnx_vif,
 			     struct sk_buff *skb, struct hw_rxhdr *rxhdr)
 {
@@ -381,11 +576,14 @@ static void rwnx_rx_data_skb_forward(struct rwnx_hw *rwnx_hw,
 	//printk("forward\n");
 
 	rx_skb->protocol = eth_type_trans(rx_skb, rwnx_vif->ndev);
+	rwnx_wake_reason_rx(rwnx_hw, rx_skb);
 	memset(rx_skb->cb, 0, sizeof(rx_skb->cb));
 	REG_SW_SET_PROFILING(rwnx_hw, SW_PROF_IEEE80211RX);
 
 #ifdef CONFIG_FILTER_TCP_ACK
-	filter_rx_tcp_ack(rwnx_hw, rx_skb->data, cpu_to_le16(rx_skb->len));
+	/* eth_type_trans() pulled the ethernet header the filter parses */
+	filter_rx_tcp_ack(rwnx_hw, skb_mac_header(rx_skb),
+			  cpu_to_le16(rx_skb->len + ETH_HLEN));
 #endif
 
 #ifdef CONFIG_RX_NETIF_RECV_SKB //modify by aic
@@ -568,6 +766,7 @@ static bool rwnx_rx_data_skb(struct rwnx_hw *rwnx_hw, struct rwnx_vif *rwnx_vif,
 
 			rx_skb->protocol =
 				eth_type_trans(rx_skb, rwnx_vif->ndev);
+			rwnx_wake_reason_rx(rwnx_hw, rx_skb);
 #ifdef AICWF_ARP_OFFLOAD
 			if (RWNX_VIF_TYPE(rwnx_vif) == NL80211_IFTYPE_STATION ||
 			    RWNX_VIF_TYPE(rwnx_vif) ==
@@ -578,8 +777,8 @@ static bool rwnx_rx_data_skb(struct rwnx_hw *rwnx_hw, struct rwnx_vif *rwnx_vif,
 			REG_SW_SET_PROFILING(rwnx_hw, SW_PROF_IEEE80211RX);
 
 #ifdef CONFIG_FILTER_TCP_ACK
-			filter_rx_tcp_ack(rwnx_hw, rx_skb->data,
-					  cpu_to_le16(rx_skb->len));
+			filter_rx_tcp_ack(rwnx_hw, skb_mac_header(rx_skb),
+					  cpu_to_le16(rx_skb->len + ETH_HLEN));
 #endif
 
 #ifdef CONFIG_RX_NETIF_RECV_SKB //modify by aic
@@ -1309,6 +1508,12 @@ void arpoffload_proc(struct sk_buff *skb, struct rwnx_vif *rwnx_vif)
 			if ((udph->source == __constant_htons(SERVER_PORT)) &&
 			    (udph->dest ==
 			     __constant_htons(CLIENT_PORT))) { // DHCP offset/ack
+				/* the options may be in the page fragment of the frame */
+				if (skb_linearize(skb))
+					return;
+				iphead = (struct iphdr *)(skb->data);
+				udph = (struct udphdr *)((u8 *)iphead +
+							 (iphead->ihl << 2));
 				dhcph = (struct DHCPInfo
 						 *)((u8 *)udph +
 						    sizeof(struct udphdr));
@@ -1621,6 +1826,7 @@ int reord_single_frame_ind(struct aicwf_rx_priv *rx_priv,
 
 		rx_skb->dev = rwnx_vif->ndev;
 		rx_skb->protocol = eth_type_trans(rx_skb, rwnx_vif->ndev);
+		rwnx_wake_reason_rx(rwnx_vif->rwnx_hw, rx_skb);
 
 #ifdef AICWF_ARP_OFFLOAD
 		if (RWNX_VIF_TYPE(rwnx_vif) == NL80211_IFTYPE_STATION ||
@@ -1631,8 +1837,8 @@ int reord_single_frame_ind(struct aicwf_rx_priv *rx_priv,
 		memset(rx_skb->cb, 0, sizeof(rx_skb->cb));
 
 #ifdef CONFIG_FILTER_TCP_ACK
-		filter_rx_tcp_ack(rwnx_vif->rwnx_hw, rx_skb->data,
-				  cpu_to_le16(rx_skb->len));
+		filter_rx_tcp_ack(rwnx_vif->rwnx_hw, skb_mac_header(rx_skb),
+				  cpu_to_le16(rx_skb->len + ETH_HLEN));
 #endif
 
 #ifdef CONFIG_RX_NETIF_RECV_SKB //AIDEN test
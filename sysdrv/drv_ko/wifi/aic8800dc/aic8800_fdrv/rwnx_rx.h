@@ -344,6 +344,10 @@ struct DHCPInfo {
 	u8 options[308]; /* 312 - cookie */
 };
 
+int rwnx_rx_vect_rate_info(struct rx_vector_1 *rx_vect1, struct rate_info *rate);
+void rwnx_wake_reason_arm(struct rwnx_hw *rwnx_hw);
+void rwnx_wake_reason_event(struct rwnx_hw *rwnx_hw);
+void rwnx_wake_reason_rx(struct rwnx_hw *rwnx_hw, struct sk_buff *skb);
 u8 rwnx_rxdataind_aicwf(struct rwnx_hw *rwnx_hw, void *hostid, void *rx_priv);
 int aicwf_process_rxframes(struct aicwf_rx_priv *rx_priv);
 
@@ -634,6 +634,7 @@ void rwnx_tx_push(struct rwnx_hw *rwnx_hw, struct rwnx_txhdr *txhdr, int flags)
 	/* Wait here to update hw_queue, as for multicast STA hwq may change
 	   between queue and push (because of PS) */
 	sw_txhdr->hw_queue = hw_queue;
+	rwnx_txq_airtime_charge(sw_txhdr);
 
 	//sw_txhdr->desc.host.packet_addr = hw_queue; //use packet_addr field for hw_txq
 	sw_txhdr->desc.host.ac = hw_queue; //use ac field for hw_txq
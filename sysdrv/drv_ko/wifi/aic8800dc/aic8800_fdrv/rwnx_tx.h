@@ -107,6 +107,7 @@ struct rwnx_amsdu {
  *            (Only used to update stat, can't we use skb->len instead ?)
  * @headroom Headroom added in skb to add rwnx_txhdr
  *           (Only used to remove it before freeing skb, is it needed ?)
+ * @airtime Airtime charged to @rwnx_sta when pushed, in us
  * @amsdu Description of amsdu whose first subframe is this buffer
  *        (amsdu.nb = 0 means this buffer is not part of amsdu)
  * @skb skb received from transmission
@@ -121,6 +122,7 @@ struct rwnx_sw_txhdr {
 	u8 hw_queue;
 	u16 frame_len;
 	u16 headroom;
+	u16 airtime;
 #ifdef CONFIG_RWNX_AMSDUS_TX
 	struct rwnx_amsdu amsdu;
 #endif
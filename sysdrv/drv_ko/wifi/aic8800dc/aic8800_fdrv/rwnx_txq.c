@@ -12,6 +12,7 @@
 #include "rwnx_tx.h"
 #include "ipc_host.h"
 #include "rwnx_events.h"
+#include "rwnx_rx.h"
 
 /******************************************************************************
  * Utils functions
@@ -283,6 +284,13 @@ void rwnx_txq_sta_init(struct rwnx_hw *rwnx_hw, struct rwnx_sta *rwnx_sta,
 	struct rwnx_vif *rwnx_vif = rwnx_hw->vif_table[rwnx_sta->vif_idx];
 	idx = rwnx_txq_sta_idx(rwnx_sta, 0);
 
+#ifdef AICWF_SDIO_SUPPORT
+	memset(rwnx_sta->airtime.deficit, 0, sizeof(rwnx_sta->airtime.deficit));
+	atomic_set(&rwnx_sta->airtime.pending, 0);
+	rwnx_sta->airtime.rate = 0;
+	rwnx_sta->airtime.tx = 0;
+#endif
+
 	foreach_sta_txq(rwnx_sta, txq, tid, rwnx_hw)
 	{
 		rwnx_txq_init(txq, idx, status,
@@ -947,6 +955,201 @@ void rwnx_txq_confirm_any(struct rwnx_hw *rwnx_hw, struct rwnx_txq *txq,
 	rwnx_hw->stats.cfm_balance[hwq->id]--;
 }
 
+/******************************************************************************
+ * Airtime fairness
+ *****************************************************************************/
+#ifdef AICWF_SDIO_SUPPORT
+/*
+ * There is no per buffer tx confirmation over SDIO, so the airtime of a
+ * buffer is estimated from its length and the tx rate of its STA when it is
+ * pushed to the bus.
+ * - Each STA spends it from a deficit per HWQ, which gets another
+ *   RWNX_AIRTIME_QUANTUM when the STA has its turn with a negative deficit.
+ *   A STA on a slow link therefore gets the same airtime as the others,
+ *   instead of the same number of buffers.
+ * - The airtime pushed to the bus for a STA and not yet taken by the bus
+ *   thread is limited to tx_aql_limit_us, so a slow STA can't fill the bus
+ *   queue in front of the others. Its txqs are processed again by
+ *   rwnx_txq_aql_kick() once the bus thread drained the queue.
+ */
+//max airtime queued to the bus for one sta (us), 0 for no limit
+int tx_aql_limit_us = 5000;
+module_param_named(tx_aql_limit_us, tx_aql_limit_us, int, 0644);
+
+enum rwnx_airtime_hold {
+	RWNX_AIRTIME_PUSH,
+	RWNX_AIRTIME_HOLD_DEFICIT,
+	RWNX_AIRTIME_HOLD_AQL,
+};
+
+/**
+ * rwnx_txq_airtime_rate - Get tx rate estimate of a STA
+ *
+ * @sta: STA to get the rate for
+ * @return: tx rate in 100kbps
+ *
+ * Use the rate from the last get_station request, or the rate of the last
+ * frame received from the STA when it is older than RWNX_AIRTIME_RATE_MS.
+ */
+static u32 rwnx_txq_airtime_rate(struct rwnx_sta *sta)
+{
+	struct rate_info rate;
+	u32 bitrate = READ_ONCE(sta->airtime.rate);
+
+	if (bitrate &&
+	    time_before(jiffies, READ_ONCE(sta->airtime.rate_time) +
+					 msecs_to_jiffies(RWNX_AIRTIME_RATE_MS)))
+		return bitrate;
+
+	memset(&rate, 0, sizeof(rate));
+	if (!rwnx_rx_vect_rate_info(&sta->stats.last_rx.rx_vect1, &rate))
+		bitrate = cfg80211_calculate_bitrate(&rate);
+	if (!bitrate)
+		bitrate = RWNX_AIRTIME_DEFAULT_RATE;
+
+	WRITE_ONCE(sta->airtime.rate, bitrate);
+	WRITE_ONCE(sta->airtime.rate_time, jiffies);
+	return bitrate;
+}
+
+static inline u32 rwnx_txq_airtime_len(u32 len, u32 rate)
+{
+	return min_t(u32, DIV_ROUND_UP(len * 80, rate), U16_MAX);
+}
+
+/**
+ * rwnx_txq_airtime_charge - Charge the airtime of a buffer to its STA
+ *
+ * @sw_txhdr: Sw desc of the buffer, pushed on HWQ sw_txhdr->hw_queue
+ *
+ * To be called with tx_lock hold
+ */
+void rwnx_txq_airtime_charge(struct rwnx_sw_txhdr *sw_txhdr)
+{
+	struct rwnx_sta *sta = sw_txhdr->rwnx_sta;
+
+	sw_txhdr->airtime = 0;
+	if (!sta)
+		return;
+
+	sw_txhdr->airtime = rwnx_txq_airtime_len(sw_txhdr->frame_len,
+						 rwnx_txq_airtime_rate(sta));
+	sta->airtime.deficit[sw_txhdr->hw_queue] -= sw_txhdr->airtime;
+	sta->airtime.tx += sw_txhdr->airtime;
+	atomic_add(sw_txhdr->airtime, &sta->airtime.pending);
+}
+
+/**
+ * rwnx_txq_airtime_release - Release the airtime of a buffer
+ *
+ * @sw_txhdr: Sw desc of the buffer
+ *
+ * To be called when the buffer leaves the bus queue, whether it is sent or
+ * dropped.
+ */
+void rwnx_txq_airtime_release(struct rwnx_sw_txhdr *sw_txhdr)
+{
+	struct rwnx_sta *sta = sw_txhdr->rwnx_sta;
+
+	if (!sw_txhdr->airtime)
+		return;
+
+	if (atomic_sub_return(sw_txhdr->airtime, &sta->airtime.pending) < 0)
+		atomic_set(&sta->airtime.pending, 0);
+	sw_txhdr->airtime = 0;
+}
+
+/**
+ * rwnx_txq_aql_kick - Process the txqs held back by the airtime limit
+ *
+ * @rwnx_hw: Driver main data
+ *
+ * To be called by the bus thread once it drained the bus queue, without
+ * tx_lock hold
+ */
+void rwnx_txq_aql_kick(struct rwnx_hw *rwnx_hw)
+{
+	if (!READ_ONCE(rwnx_hw->aql_kick))
+		return;
+
+	spin_lock_bh(&rwnx_hw->tx_lock);
+	rwnx_hw->aql_kick = false;
+	rwnx_hwq_process_all(rwnx_hw);
+	spin_unlock_bh(&rwnx_hw->tx_lock);
+}
+
+/**
+ * rwnx_txq_airtime_hold - Check if a txq can push buffers now
+ *
+ * @rwnx_hw: Driver main data
+ * @hwq: HWQ being processed
+ * @txq: TXQ to check
+ *
+ * Gives the STA of the txq a new quantum when its deficit is negative.
+ */
+static enum rwnx_airtime_hold rwnx_txq_airtime_hold(struct rwnx_hw *rwnx_hw,
+						    struct rwnx_hwq *hwq,
+						    struct rwnx_txq *txq)
+{
+	struct rwnx_sta *sta = txq->sta;
+
+	if (!sta)
+		return RWNX_AIRTIME_PUSH;
+
+	if (tx_aql_limit_us > 0 &&
+	    atomic_read(&sta->airtime.pending) >= tx_aql_limit_us) {
+		hwq->need_processing = true;
+		rwnx_hw->aql_kick = true;
+		return RWNX_AIRTIME_HOLD_AQL;
+	}
+
+	if (sta->airtime.deficit[hwq->id] < 0) {
+		sta->airtime.deficit[hwq->id] += RWNX_AIRTIME_QUANTUM;
+		return RWNX_AIRTIME_HOLD_DEFICIT;
+	}
+
+	return RWNX_AIRTIME_PUSH;
+}
+
+/**
+ * rwnx_txq_airtime_credits - Limit the number of buffers to push for a txq
+ *
+ * @txq: TXQ to get buffers from
+ * @credits: Max number of buffers to push
+ * @return: number of buffers, at least one, fitting in the deficit and the
+ *          airtime limit of the STA
+ */
+static int rwnx_txq_airtime_credits(struct rwnx_txq *txq, int credits)
+{
+	struct rwnx_sta *sta = txq->sta;
+	struct sk_buff *skb;
+	s32 budget;
+	u32 rate;
+	int nb = 0;
+
+	if (!sta)
+		return credits;
+
+	budget = sta->airtime.deficit[txq->hwq->id];
+	if (tx_aql_limit_us > 0)
+		budget = min_t(s32, budget,
+			       tx_aql_limit_us -
+				       atomic_read(&sta->airtime.pending));
+	rate = rwnx_txq_airtime_rate(sta);
+
+	skb_queue_walk(&txq->sk_list, skb) {
+		struct rwnx_txhdr *txhdr = (struct rwnx_txhdr *)skb->data;
+
+		if (nb >= credits || (nb && budget <= 0))
+			break;
+		budget -= rwnx_txq_airtime_len(txhdr->sw_hdr->frame_len, rate);
+		nb++;
+	}
+
+	return nb;
+}
+#endif /* AICWF_SDIO_SUPPORT */
+
 /******************************************************************************
  * HWQ processing
  *****************************************************************************/
@@ -1110,6 +1313,10 @@ static bool rwnx_txq_get_skb_to_push(struct rwnx_hw *rwnx_hw,
 
 	__skb_queue_head_init(sk_list_push);
 
+#ifdef AICWF_SDIO_SUPPORT
+	credits = rwnx_txq_airtime_credits(txq, credits);
+#endif
+
 	if (credits >= nb_ready) {
 		skb_queue_splice_init(&txq->sk_list, sk_list_push);
 #ifdef CONFIG_MAC80211_TXQ
@@ -1245,6 +1452,9 @@ void rwnx_hwq_process(struct rwnx_hw *rwnx_hw, struct rwnx_hwq *hwq)
 	struct rwnx_txq *txq, *next;
 	int user, credit_map = 0;
 	bool mu_enable;
+#ifdef AICWF_SDIO_SUPPORT
+	bool again;
+#endif
 #ifdef CREATE_TRACE_POINTS
 	trace_process_hw_queue(hwq);
 #endif
@@ -1254,6 +1464,10 @@ void rwnx_hwq_process(struct rwnx_hw *rwnx_hw, struct rwnx_hwq *hwq)
 	if (!mu_enable)
 		credit_map = ALL_HWQ_MASK - 1;
 
+#ifdef AICWF_SDIO_SUPPORT
+restart:
+	again = false;
+#endif
 	list_for_each_entry_safe (txq, next, &hwq->list, sched_list) {
 		struct rwnx_txhdr *txhdr = NULL;
 		struct sk_buff_head sk_list_push;
@@ -1280,6 +1494,19 @@ void rwnx_hwq_process(struct rwnx_hw *rwnx_hw, struct rwnx_hwq *hwq)
 			continue;
 		}
 
+#ifdef AICWF_SDIO_SUPPORT
+		switch (rwnx_txq_airtime_hold(rwnx_hw, hwq, txq)) {
+		case RWNX_AIRTIME_HOLD_DEFICIT:
+			/* check the other txqs, then come back with new quantum */
+			again = true;
+			continue;
+		case RWNX_AIRTIME_HOLD_AQL:
+			continue;
+		default:
+			break;
+		}
+#endif
+
 		txq_empty = rwnx_txq_get_skb_to_push(rwnx_hw, hwq, txq, user,
 						     &sk_list_push);
 		while ((skb = __skb_dequeue(&sk_list_push)) != NULL) {
@@ -1336,6 +1563,11 @@ void rwnx_hwq_process(struct rwnx_hw *rwnx_hw, struct rwnx_hwq *hwq)
 #endif /* CONFIG_RWNX_FULLMAC */
 	}
 
+#ifdef AICWF_SDIO_SUPPORT
+	if (again)
+		goto restart;
+#endif
+
 	if (mu_enable)
 		rwnx_txq_release_mu_lock(rwnx_hw);
 }
@@ -113,6 +113,13 @@
 
 #define NX_TXQ_INITIAL_CREDITS 64
 
+/* airtime given to a STA txq each time it gets its turn in the HWQ (us) */
+#define RWNX_AIRTIME_QUANTUM 2000
+/* tx rate assumed until one is known for the STA (100kbps) */
+#define RWNX_AIRTIME_DEFAULT_RATE 60
+/* how long a STA tx rate estimate is used before refreshing it (ms) */
+#define RWNX_AIRTIME_RATE_MS 100
+
 /**
  * TXQ tid sorted by decreasing priority
  */
@@ -401,4 +408,22 @@ void rwnx_hwq_init(struct rwnx_hw *rwnx_hw);
 void rwnx_hwq_process(struct rwnx_hw *rwnx_hw, struct rwnx_hwq *hwq);
 void rwnx_hwq_process_all(struct rwnx_hw *rwnx_hw);
 
+#ifdef AICWF_SDIO_SUPPORT
+void rwnx_txq_airtime_charge(struct rwnx_sw_txhdr *sw_txhdr);
+void rwnx_txq_airtime_release(struct rwnx_sw_txhdr *sw_txhdr);
+void rwnx_txq_aql_kick(struct rwnx_hw *rwnx_hw);
+#else
+static inline void rwnx_txq_airtime_charge(struct rwnx_sw_txhdr *sw_txhdr)
+{
+}
+
+static inline void rwnx_txq_airtime_release(struct rwnx_sw_txhdr *sw_txhdr)
+{
+}
+
+static inline void rwnx_txq_aql_kick(struct rwnx_hw *rwnx_hw)
+{
+}
+#endif /* AICWF_SDIO_SUPPORT */
+
 #endif /* _RWNX_TXQ_H_ */
@@ -3,6 +3,7 @@
  * Copyright (c) 2023 Rockchip Electronics Co., Ltd.
  */
 
+#include <linux/clocksource.h>
 #include <linux/io.h>
 
 #include "rkpm_helpers.h"
@@ -224,3 +225,47 @@ void rk_hptimer_mode_init(void __iomem *base, enum rk_hptimer_mode_t mode)
 	if (rk_hptimer_wait_mode(base, mode))
 		pr_err("%s: can't wait hptimer mode:%d\n", __func__, mode);
 }
+
+static void __iomem *rk_hptimer_cs_base;
+
+/* The count is two 32-bit registers, read the high word again on a carry */
+static u64 notrace rk_hptimer_cs_read(struct clocksource *cs)
+{
+	void __iomem *base = rk_hptimer_cs_base;
+	u32 hi, lo;
+
+	do {
+		hi = readl_relaxed(base + TIMER_HP_CURR_TIMER_VALUE1);
+		lo = readl_relaxed(base + TIMER_HP_CURR_TIMER_VALUE0);
+	} while (hi != readl_relaxed(base + TIMER_HP_CURR_TIMER_VALUE1));
+
+	return (u64)hi << 32 | lo;
+}
+
+/*
+ * Rated below the arch timer, so it normally isn't the system clocksource.
+ * In the adjust modes the hptimer keeps track of time in sleep through the
+ * 32k clock, which makes it the suspend clocksource: the time spent in
+ * suspend is then accounted to CLOCK_BOOTTIME with the timer resolution
+ * instead of the RTC one, and timestamps taken with ktime_get_boottime_ns()
+ * by different drivers stay comparable across suspend.
+ */
+static struct clocksource rk_hptimer_cs = {
+	.name	= "rk_hptimer",
+	.rating	= 150,
+	.read	= rk_hptimer_cs_read,
+	.mask	= CLOCKSOURCE_MASK(64),
+	.flags	= CLOCK_SOURCE_IS_CONTINUOUS,
+};
+
+int rk_hptimer_clocksource_init(void __iomem *base, u32 rate)
+{
+	if (!rk_hptimer_is_enabled(base))
+		return -ENODEV;
+
+	rk_hptimer_cs_base = base;
+	if (rk_hptimer_get_mode(base) != RK_HPTIMER_NORM_MODE)
+		rk_hptimer_cs.flags |= CLOCK_SOURCE_SUSPEND_NONSTOP;
+
+	return clocksource_register_hz(&rk_hptimer_cs, rate);
+}
@@ -19,4 +19,5 @@ int rk_hptimer_wait_mode(void __iomem *base, enum rk_hptimer_mode_t mode);
 void rk_hptimer_do_soft_adjust(void __iomem *base, u32 hf, u32 lf);
 void rk_hptimer_do_soft_adjust_no_wait(void __iomem *base, u32 hf, u32 lf);
 void rk_hptimer_mode_init(void __iomem *base, enum rk_hptimer_mode_t mode);
+int rk_hptimer_clocksource_init(void __iomem *base, u32 rate);
 #endif
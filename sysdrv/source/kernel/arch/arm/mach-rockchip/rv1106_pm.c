@@ -3,13 +3,21 @@
  * Copyright (c) 2023 Rockchip Electronics Co., Ltd.
  */
 
+#include <linux/debugfs.h>
+#include <linux/i2c.h>
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
+#include <linux/of_platform.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
 #include <linux/suspend.h>
 #include <linux/mfd/syscon.h>
+#include <trace/events/power.h>
 
 #include <asm/cacheflush.h>
 #include <asm/fiq_glue.h>
@@ -78,6 +86,27 @@ struct rv1106_sleep_ddr_data {
 
 static struct rv1106_sleep_ddr_data ddr_data;
 
+/*
+ * Sleep accounting in hptimer ticks, the hptimer keeps counting in sleep.
+ * Cumulative counts plus the breakdown of the last suspend, so that an
+ * always-on capture loop can tell how long it slept and how long it took
+ * to get back. The last sleep includes every hpmcu fast wakeup re-entry.
+ * The restore time and the wake latency both start at the final WFI exit
+ * and end when suspend_enter returns and at PM_POST_SUSPEND.
+ */
+struct rv1106_sleep_stats {
+	u32 sleeps;
+	u32 mcu_wakeups;
+	u32 last_wkup_st;
+	u64 total_sleep_cnt;
+	u64 last_sleep_cnt;
+	u64 last_restore_cnt;
+	u64 last_wake_cnt;
+	u64 wkup_cnt;
+};
+
+static struct rv1106_sleep_stats sleep_stats;
+
 static const struct rk_sleep_config *slp_cfg;
 
 static void __iomem *pmucru_base;
@@ -1161,6 +1190,8 @@ static int rockchip_lpmode_enter(unsigned long arg)
 
 static int rv1106_suspend_enter(suspend_state_t state)
 {
+	u64 wfi_cnt;
+
 	rkpm_printstr("rv1106 enter sleep\n");
 
 	slp_cfg = rockchip_get_cur_sleep_config();
@@ -1171,6 +1202,9 @@ static int rv1106_suspend_enter(suspend_state_t state)
 
 	rkpm_printch('-');
 
+	sleep_stats.sleeps++;
+	sleep_stats.last_sleep_cnt = 0;
+
 RE_ENTER_SLEEP:
 	clock_suspend();
 	rkpm_printch('0');
@@ -1189,7 +1223,10 @@ RE_ENTER_SLEEP:
 	rkpm_printch('4');
 
 	rkpm_printstr("-WFI-");
+	wfi_cnt = rk_hptimer_get_count(hptimer_base);
 	cpu_suspend(0, rockchip_lpmode_enter);
+	sleep_stats.wkup_cnt = rk_hptimer_get_count(hptimer_base);
+	sleep_stats.last_sleep_cnt += sleep_stats.wkup_cnt - wfi_cnt;
 
 	rkpm_printch('4');
 
@@ -1213,6 +1250,7 @@ RE_ENTER_SLEEP:
 	if (IS_ENABLED(CONFIG_RV1106_HPMCU_FAST_WAKEUP)) {
 		if (hpmcu_fast_wkup()) {
 			rkpm_gicv2_dist_restore(gicd_base, &gicd_ctx_save);
+			sleep_stats.mcu_wakeups++;
 			goto RE_ENTER_SLEEP;
 		} else {
 			rkpm_gicv2_dist_restore(gicd_base, &gicd_ctx_save);
@@ -1230,6 +1268,12 @@ RE_ENTER_SLEEP:
 
 	rv1106_dbg_irq_finish();
 
+	sleep_stats.total_sleep_cnt += sleep_stats.last_sleep_cnt;
+	sleep_stats.last_wkup_st = ddr_data.pmu_wkup_int_st;
+	sleep_stats.last_restore_cnt =
+		rk_hptimer_get_count(hptimer_base) - sleep_stats.wkup_cnt;
+	sleep_stats.last_wake_cnt = 0;
+
 	local_fiq_enable();
 	rkpm_printstr("rv1106 exit sleep\n");
 
@@ -1256,6 +1300,8 @@ static int __init rv1106_suspend_init(struct device_node *np)
 	gicc_base = dev_reg_base + RV1106_GIC_OFFSET + 0x2000;
 
 	hptimer_base = dev_reg_base + RV1106_HPTIMER_OFFSET;
+	if (dev_reg_base && rk_hptimer_clocksource_init(hptimer_base, 24000000))
+		pr_info("%s: hptimer isn't running, no suspend clocksource\n", __func__);
 
 	firewall_ddr_base = dev_reg_base + RV1106_FW_DDR_OFFSET;
 	firewall_syssram_base = dev_reg_base + RV1106_FW_SRAM_OFFSET;
@@ -1339,6 +1385,281 @@ static int __init rv1106_suspend_init(struct device_node *np)
 	return 0;
 }
 
+/*
+ * Resume tiers
+ *
+ * Devices listed in "rockchip,fast-resume-devices" of the PMU node, and
+ * their parents, are made async so that dpm_resume() starts them first
+ * instead of in dpm_list order. This is meant for the wake to first frame
+ * path: sensor, ISP, VENC and Wi-Fi.
+ *
+ * Devices listed in "rockchip,lazy-resume-devices" (display, USB, audio...)
+ * are expected to be runtime suspended and to take the direct_complete path,
+ * so that they are only resumed on first use through runtime PM. The core
+ * only does that if the driver allows it, so the per-device resume times in
+ * debugfs flag lazy devices that still went through a full resume.
+ */
+#define RV1106_PM_RESUME_DEVS_MAX	128
+#define RV1106_PM_LAZY_DEVS_MAX		16
+
+struct rv1106_resume_time {
+	struct device *dev;
+	char name[32];
+	u64 start_ns;
+	u64 total_ns;
+};
+
+static struct rv1106_resume_time resume_times[RV1106_PM_RESUME_DEVS_MAX];
+static int resume_times_num;
+static u64 resume_first_ns, resume_last_ns;
+static DEFINE_SPINLOCK(resume_times_lock);
+
+static struct device *lazy_devs[RV1106_PM_LAZY_DEVS_MAX];
+static int lazy_devs_num;
+
+static bool rv1106_pm_is_lazy(struct device *dev)
+{
+	int i;
+
+	for (i = 0; i < lazy_devs_num; i++) {
+		if (lazy_devs[i] == dev)
+			return true;
+	}
+
+	return false;
+}
+
+static struct rv1106_resume_time *resume_time_find_locked(struct device *dev,
+							  bool add)
+{
+	struct rv1106_resume_time *t;
+	int i;
+
+	for (i = 0; i < resume_times_num; i++) {
+		if (resume_times[i].dev == dev)
+			return &resume_times[i];
+	}
+
+	if (!add || resume_times_num >= RV1106_PM_RESUME_DEVS_MAX)
+		return NULL;
+
+	t = &resume_times[resume_times_num++];
+	t->dev = dev;
+	strscpy(t->name, dev_name(dev), sizeof(t->name));
+
+	return t;
+}
+
+static void rv1106_pm_cb_start(void *data, struct device *dev,
+			       const char *pm_ops, int event)
+{
+	struct rv1106_resume_time *t;
+	unsigned long flags;
+	u64 now;
+
+	if (event != PM_EVENT_RESUME)
+		return;
+
+	now = ktime_get_ns();
+	spin_lock_irqsave(&resume_times_lock, flags);
+	t = resume_time_find_locked(dev, true);
+	if (t)
+		t->start_ns = now;
+	if (!resume_first_ns)
+		resume_first_ns = now;
+	spin_unlock_irqrestore(&resume_times_lock, flags);
+}
+
+static void rv1106_pm_cb_end(void *data, struct device *dev, int error)
+{
+	struct rv1106_resume_time *t;
+	unsigned long flags;
+	u64 now = ktime_get_ns();
+
+	spin_lock_irqsave(&resume_times_lock, flags);
+	t = resume_time_find_locked(dev, false);
+	if (t && t->start_ns) {
+		t->total_ns += now - t->start_ns;
+		t->start_ns = 0;
+		resume_last_ns = now;
+	}
+	spin_unlock_irqrestore(&resume_times_lock, flags);
+}
+
+static int resume_time_cmp(const void *a, const void *b)
+{
+	const struct rv1106_resume_time *ta = a, *tb = b;
+
+	if (ta->total_ns == tb->total_ns)
+		return 0;
+
+	return ta->total_ns < tb->total_ns ? 1 : -1;
+}
+
+static int rv1106_pm_notifier(struct notifier_block *nb, unsigned long action,
+			      void *data)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&resume_times_lock, flags);
+	if (action == PM_SUSPEND_PREPARE) {
+		memset(resume_times, 0, sizeof(resume_times));
+		resume_times_num = 0;
+		resume_first_ns = 0;
+		resume_last_ns = 0;
+	} else if (action == PM_POST_SUSPEND) {
+		sort(resume_times, resume_times_num, sizeof(resume_times[0]),
+		     resume_time_cmp, NULL);
+		if (sleep_stats.wkup_cnt)
+			sleep_stats.last_wake_cnt =
+				rk_hptimer_get_count(hptimer_base) - sleep_stats.wkup_cnt;
+	}
+	spin_unlock_irqrestore(&resume_times_lock, flags);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block rv1106_pm_nb = {
+	.notifier_call = rv1106_pm_notifier,
+};
+
+static int resume_times_show(struct seq_file *s, void *unused)
+{
+	struct rv1106_resume_time *t;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&resume_times_lock, flags);
+	if (resume_last_ns > resume_first_ns)
+		seq_printf(s, "devices resumed in %llu us\n",
+			   div_u64(resume_last_ns - resume_first_ns, NSEC_PER_USEC));
+
+	for (i = 0; i < resume_times_num; i++) {
+		t = &resume_times[i];
+		seq_printf(s, "%-32s %8llu us%s\n", t->name,
+			   div_u64(t->total_ns, NSEC_PER_USEC),
+			   rv1106_pm_is_lazy(t->dev) ? " (lazy, not deferred)" : "");
+	}
+
+	for (i = 0; i < lazy_devs_num; i++) {
+		if (!resume_time_find_locked(lazy_devs[i], false))
+			seq_printf(s, "%-32s deferred\n", dev_name(lazy_devs[i]));
+	}
+	spin_unlock_irqrestore(&resume_times_lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(resume_times);
+
+/* hptimer runs at 24MHz */
+#define RV1106_HPTIMER_CNT_TO_US(cnt)	div_u64(cnt, 24)
+
+static int sleep_stats_show(struct seq_file *s, void *unused)
+{
+	struct rv1106_sleep_stats st;
+	unsigned long flags;
+
+	spin_lock_irqsave(&resume_times_lock, flags);
+	st = sleep_stats;
+	spin_unlock_irqrestore(&resume_times_lock, flags);
+
+	seq_printf(s, "sleeps:             %u\n", st.sleeps);
+	seq_printf(s, "hpmcu wakeups:      %u\n", st.mcu_wakeups);
+	seq_printf(s, "total sleep:        %llu us\n",
+		   RV1106_HPTIMER_CNT_TO_US(st.total_sleep_cnt));
+	seq_printf(s, "last sleep:         %llu us\n",
+		   RV1106_HPTIMER_CNT_TO_US(st.last_sleep_cnt));
+	seq_printf(s, "last soc restore:   %llu us\n",
+		   RV1106_HPTIMER_CNT_TO_US(st.last_restore_cnt));
+	seq_printf(s, "last wake latency:  %llu us\n",
+		   RV1106_HPTIMER_CNT_TO_US(st.last_wake_cnt));
+	seq_printf(s, "last wakeup status: 0x%x\n", st.last_wkup_st);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(sleep_stats);
+
+static struct device *rv1106_pm_find_device(struct device_node *np)
+{
+	struct platform_device *pdev;
+	struct device *dev = NULL;
+
+	pdev = of_find_device_by_node(np);
+	if (pdev)
+		return &pdev->dev;
+
+#if IS_ENABLED(CONFIG_I2C)
+	{
+		struct i2c_client *client = of_find_i2c_device_by_node(np);
+
+		if (client)
+			dev = &client->dev;
+	}
+#endif
+
+	return dev;
+}
+
+static int __init rv1106_pm_resume_tier_init(void)
+{
+	struct device_node *np, *dn;
+	struct device *dev, *parent;
+	struct dentry *root;
+	int i;
+
+	if (!is_rv1103 && !is_rv1106)
+		return 0;
+
+	np = of_find_compatible_node(NULL, NULL, "rockchip,rv1106-pmu");
+	if (!np)
+		return 0;
+
+	for (i = 0; (dn = of_parse_phandle(np, "rockchip,fast-resume-devices", i)); i++) {
+		dev = rv1106_pm_find_device(dn);
+		of_node_put(dn);
+		if (!dev) {
+			pr_warn("%s: fast resume device %d not found\n", __func__, i);
+			continue;
+		}
+
+		for (parent = dev; parent; parent = parent->parent)
+			device_enable_async_suspend(parent);
+		put_device(dev);
+	}
+
+	for (i = 0; (dn = of_parse_phandle(np, "rockchip,lazy-resume-devices", i)); i++) {
+		dev = rv1106_pm_find_device(dn);
+		of_node_put(dn);
+		if (!dev) {
+			pr_warn("%s: lazy resume device %d not found\n", __func__, i);
+			continue;
+		}
+
+		/* Keep the reference, the device is compared by address */
+		if (lazy_devs_num < RV1106_PM_LAZY_DEVS_MAX)
+			lazy_devs[lazy_devs_num++] = dev;
+		else
+			put_device(dev);
+	}
+	of_node_put(np);
+
+	if (register_trace_device_pm_callback_start(rv1106_pm_cb_start, NULL) ||
+	    register_trace_device_pm_callback_end(rv1106_pm_cb_end, NULL)) {
+		unregister_trace_device_pm_callback_start(rv1106_pm_cb_start, NULL);
+		pr_info("%s: no device resume times\n", __func__);
+		return 0;
+	}
+
+	register_pm_notifier(&rv1106_pm_nb);
+
+	root = debugfs_create_dir("rv1106_pm", NULL);
+	debugfs_create_file("resume_times", 0444, root, NULL, &resume_times_fops);
+	debugfs_create_file("sleep_stats", 0444, root, NULL, &sleep_stats_fops);
+
+	return 0;
+}
+late_initcall(rv1106_pm_resume_tier_init);
+
 static const struct platform_suspend_ops rv1106_suspend_ops = {
 	.enter   = rv1106_suspend_enter,
 	.valid   = suspend_valid_only_mem,
@@ -86,6 +86,11 @@ struct clk_core {
 	struct hlist_node	child_node;
 	struct hlist_head	clks;
 	unsigned int		notifier_count;
+#ifdef CONFIG_COMMON_CLK_RESIDENCY
+	u64			enabled_ns;
+	u64			enabled_since;
+	unsigned long		enable_events;
+#endif
 #ifdef CONFIG_DEBUG_FS
 	struct dentry		*dentry;
 	struct hlist_node	debug_node;
@@ -961,6 +966,41 @@ int clk_prepare(struct clk *clk)
 }
 EXPORT_SYMBOL_GPL(clk_prepare);
 
+#ifdef CONFIG_COMMON_CLK_RESIDENCY
+/*
+ * Called with enable_lock held on the 0 <-> 1 enable_count transitions. Clocks
+ * are toggled from syscore and suspend paths where timekeeping may already be
+ * suspended, so use the NMI-safe fast accessor.
+ */
+static void clk_residency_enable(struct clk_core *core)
+{
+	core->enabled_since = ktime_get_mono_fast_ns();
+	core->enable_events++;
+}
+
+static void clk_residency_disable(struct clk_core *core)
+{
+	core->enabled_ns += ktime_get_mono_fast_ns() - core->enabled_since;
+}
+
+static u64 clk_residency_get(struct clk_core *core)
+{
+	unsigned long flags;
+	u64 ns;
+
+	flags = clk_enable_lock();
+	ns = core->enabled_ns;
+	if (core->enable_count)
+		ns += ktime_get_mono_fast_ns() - core->enabled_since;
+	clk_enable_unlock(flags);
+
+	return ns;
+}
+#else
+static inline void clk_residency_enable(struct clk_core *core) {}
+static inline void clk_residency_disable(struct clk_core *core) {}
+#endif
+
 static void clk_core_disable(struct clk_core *core)
 {
 	lockdep_assert_held(&enable_lock);
@@ -978,6 +1018,7 @@ static void clk_core_disable(struct clk_core *core)
 	if (--core->enable_count > 0)
 		return;
 
+	clk_residency_disable(core);
 	trace_clk_disable_rcuidle(core);
 
 	if (core->ops->disable)
@@ -1048,6 +1089,8 @@ static int clk_core_enable(struct clk_core *core)
 			clk_core_disable(core->parent);
 			return ret;
 		}
+
+		clk_residency_enable(core);
 	}
 
 	core->enable_count++;
@@ -3068,6 +3111,47 @@ static int clk_summary_show(struct seq_file *s, void *data)
 }
 DEFINE_SHOW_ATTRIBUTE(clk_summary);
 
+#ifdef CONFIG_COMMON_CLK_RESIDENCY
+static int clk_residency_show(struct seq_file *s, void *data)
+{
+	struct clk_core *core = s->private;
+
+	seq_printf(s, "%llu ms %lu enables\n",
+		   div_u64(clk_residency_get(core), NSEC_PER_MSEC),
+		   core->enable_events);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(clk_residency);
+
+/* Clocks that were ever enabled, with their share of the uptime */
+static int clk_residency_summary_show(struct seq_file *s, void *data)
+{
+	u64 uptime = ktime_get_ns();
+	struct clk_core *core;
+	u64 ns;
+
+	seq_puts(s, "   clock                          enable   enabled ms  enabled  enables\n");
+	seq_puts(s, "                                   count                    %%\n");
+	seq_puts(s, "--------------------------------------------------------------------------\n");
+
+	mutex_lock(&clk_debug_lock);
+	hlist_for_each_entry(core, &clk_debug_list, debug_node) {
+		ns = clk_residency_get(core);
+		if (!ns)
+			continue;
+
+		seq_printf(s, " %-32s %6u %12llu %8llu %8lu\n", core->name,
+			   core->enable_count, div_u64(ns, NSEC_PER_MSEC),
+			   div64_u64(ns * 100, uptime), core->enable_events);
+	}
+	mutex_unlock(&clk_debug_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(clk_residency_summary);
+#endif
+
 static void clk_dump_one(struct seq_file *s, struct clk_core *c, int level)
 {
 	int phase;
@@ -3354,6 +3438,10 @@ static void clk_debug_create_one(struct clk_core *core, struct dentry *pdentry)
 	debugfs_create_u32("clk_enable_count", 0444, root, &core->enable_count);
 	debugfs_create_u32("clk_protect_count", 0444, root, &core->protect_count);
 	debugfs_create_u32("clk_notifier_count", 0444, root, &core->notifier_count);
+#ifdef CONFIG_COMMON_CLK_RESIDENCY
+	debugfs_create_file("clk_residency", 0444, root, core,
+			    &clk_residency_fops);
+#endif
 	debugfs_create_file("clk_duty_cycle", 0444, root, core,
 			    &clk_duty_cycle_fops);
 #ifdef CLOCK_ALLOW_WRITE_DEBUGFS
@@ -3448,6 +3536,10 @@ static int __init clk_debug_init(void)
 			    &clk_summary_fops);
 	debugfs_create_file("clk_orphan_dump", 0444, rootdir, &orphan_list,
 			    &clk_dump_fops);
+#ifdef CONFIG_COMMON_CLK_RESIDENCY
+	debugfs_create_file("clk_residency_summary", 0444, rootdir, NULL,
+			    &clk_residency_summary_fops);
+#endif
 
 	mutex_lock(&clk_debug_lock);
 	hlist_for_each_entry(core, &clk_debug_list, debug_node)
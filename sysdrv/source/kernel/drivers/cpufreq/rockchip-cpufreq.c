@@ -45,6 +45,7 @@ struct cluster_info {
 	struct freq_qos_request dsu_qos_req;
 	cpumask_t cpus;
 	unsigned int idle_threshold_freq;
+	unsigned int transition_delay_us;
 	int scale;
 	bool is_idle_disabled;
 	bool is_opp_shared_dsu;
@@ -587,6 +588,8 @@ static int rockchip_cpufreq_cluster_init(int cpu, struct cluster_info *cluster)
 	cluster->is_opp_shared_dsu = of_property_read_bool(np, "rockchip,opp-shared-dsu");
 	if (!of_property_read_u32(np, "rockchip,idle-threshold-freq", &freq))
 		cluster->idle_threshold_freq = freq;
+	of_property_read_u32(np, "rockchip,transition-delay-us",
+			     &cluster->transition_delay_us);
 	rockchip_get_opp_data(rockchip_cpufreq_of_match, opp_info);
 	if (opp_info->data && opp_info->data->set_read_margin) {
 		opp_info->current_rm = UINT_MAX;
@@ -802,6 +805,13 @@ static int rockchip_cpufreq_notifier(struct notifier_block *nb,
 		return NOTIFY_BAD;
 
 	if (event == CPUFREQ_CREATE_POLICY) {
+		/*
+		 * The transition latency includes the regulator ramp, which
+		 * makes governors rate limit to several ms. Boards can ask
+		 * schedutil to react to bursts sooner.
+		 */
+		if (cluster->transition_delay_us)
+			policy->transition_delay_us = cluster->transition_delay_us;
 		if (rockchip_cpufreq_add_monitor(cluster, policy))
 			return NOTIFY_BAD;
 		if (rockchip_cpufreq_add_dsu_qos_req(cluster, policy))
@@ -46,6 +46,22 @@ static void crypto_show_stat(struct seq_file *p, struct rk_crypto_stat *stat)
 	seq_puts(p, "\n");
 }
 
+static void crypto_show_batch_hist(struct seq_file *p, struct rk_crypto_stat *stat)
+{
+	u32 i;
+
+	/* requests served back to back before the queue went idle */
+	seq_puts(p, "Batch size histogram:\n");
+
+	for (i = 0; i < RK_CRYPTO_BATCH_HIST_NUM - 1; i++)
+		seq_printf(p, "\t[%2u - %2u]     : %llu\n",
+			   1U << i, (2U << i) - 1, stat->batch_hist[i]);
+
+	seq_printf(p, "\t[%2u+     ]     : %llu\n",
+		   1U << i, stat->batch_hist[i]);
+	seq_puts(p, "\n");
+}
+
 static void crypto_show_queue_info(struct seq_file *p, struct rk_crypto_dev *rk_dev)
 {
 	bool busy;
@@ -86,6 +102,41 @@ static void crypto_show_valid_algo_single(struct seq_file *p, enum alg_type type
 	seq_puts(p, "\n");
 }
 
+static void crypto_show_sw_threshold(struct seq_file *p, struct rk_crypto_soc_data *soc_data)
+{
+	u32 i, k, algs_num = 0;
+	struct rk_crypto_algt **algs;
+
+	if (!soc_data->use_sw_dispatch)
+		return;
+
+	seq_puts(p, "Software dispatch threshold (bytes):\n");
+
+	algs = soc_data->hw_get_algts(&algs_num);
+	if (!algs || algs_num == 0)
+		return;
+
+	for (i = 0; i < algs_num; i++) {
+		if (!algs[i]->valid_flag || algs[i]->type != ALG_TYPE_CIPHER)
+			continue;
+
+		seq_printf(p, "\t%-20s", algs[i]->name);
+
+		for (k = 0; k < RK_CIPHER_CALIB_KEY_NUM; k++) {
+			if (!algs[i]->sw_keylen[k] ||
+			    (k && algs[i]->sw_keylen[k] == algs[i]->sw_keylen[k - 1]))
+				continue;
+
+			seq_printf(p, " key%u: %u", algs[i]->sw_keylen[k] * 8,
+				   READ_ONCE(algs[i]->sw_threshold[k]));
+		}
+
+		seq_puts(p, "\n");
+	}
+
+	seq_puts(p, "\n");
+}
+
 static void crypto_show_valid_algos(struct seq_file *p, struct rk_crypto_soc_data *soc_data)
 {
 	u32 algs_num = 0;
@@ -119,8 +170,12 @@ static int crypto_show_all(struct seq_file *p, void *v)
 
 	crypto_show_valid_algos(p, soc_data);
 
+	crypto_show_sw_threshold(p, soc_data);
+
 	crypto_show_stat(p, stat);
 
+	crypto_show_batch_hist(p, stat);
+
 	crypto_show_queue_info(p, rk_dev);
 
 	return 0;
@@ -277,6 +277,39 @@ int rk_ahash_digest(struct ahash_request *req)
 	return rk_ahash_init(req) ?: rk_ahash_finup(req);
 }
 
+/*
+ * Between two requests at most RK_DMA_ALIGNMENT bytes wait in hash_tmp or
+ * lastc for the next calculation, so the whole software state is small
+ * enough to go through export/import.
+ */
+void rk_ahash_state_save(struct rk_ahash_ctx *ctx, struct rk_ahash_state *state)
+{
+	state->calc_cnt     = ctx->calc_cnt;
+	state->hash_tmp_len = ctx->hash_tmp_len;
+	state->lastc_len    = ctx->lastc_len;
+
+	memcpy(state->hash_tmp, ctx->hash_tmp, ctx->hash_tmp_len);
+	memcpy(state->lastc, ctx->lastc, ctx->lastc_len);
+}
+
+int rk_ahash_state_load(struct rk_ahash_ctx *ctx, const struct rk_ahash_state *state)
+{
+	if (state->hash_tmp_len > sizeof(state->hash_tmp) ||
+	    state->lastc_len > sizeof(state->lastc))
+		return -EINVAL;
+
+	rk_ahash_ctx_clear(ctx);
+
+	ctx->calc_cnt     = state->calc_cnt;
+	ctx->hash_tmp_len = state->hash_tmp_len;
+	ctx->lastc_len    = state->lastc_len;
+
+	memcpy(ctx->hash_tmp, state->hash_tmp, state->hash_tmp_len);
+	memcpy(ctx->lastc, state->lastc, state->lastc_len);
+
+	return 0;
+}
+
 int rk_ahash_start(struct rk_crypto_dev *rk_dev)
 {
 	struct ahash_request *req = ahash_request_cast(rk_dev->async_req);
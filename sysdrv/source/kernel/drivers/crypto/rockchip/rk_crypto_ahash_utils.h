@@ -10,6 +10,15 @@
 #include "rk_crypto_core.h"
 #include "rk_crypto_utils.h"
 
+/* software part of an exported hash state, hardware state follows it */
+struct rk_ahash_state {
+	u32	calc_cnt;
+	u32	hash_tmp_len;
+	u32	lastc_len;
+	u8	hash_tmp[RK_DMA_ALIGNMENT];
+	u8	lastc[RK_DMA_ALIGNMENT];
+};
+
 struct rk_alg_ctx *rk_ahash_alg_ctx(struct rk_crypto_dev *rk_dev);
 
 struct rk_crypto_algt *rk_ahash_get_algt(struct crypto_ahash *tfm);
@@ -28,6 +37,10 @@ int rk_ahash_finup(struct ahash_request *req);
 
 int rk_ahash_digest(struct ahash_request *req);
 
+void rk_ahash_state_save(struct rk_ahash_ctx *ctx, struct rk_ahash_state *state);
+
+int rk_ahash_state_load(struct rk_ahash_ctx *ctx, const struct rk_ahash_state *state);
+
 int rk_ahash_crypto_rx(struct rk_crypto_dev *rk_dev);
 
 int rk_ahash_start(struct rk_crypto_dev *rk_dev);
@@ -128,3 +128,70 @@ int rk_bn_highest_bit(const struct rk_bignum *bn)
 
 	return (int)(bn->n_words - 1) * RK_WORD_SIZE + b;
 }
+
+void rk_bn_pool_init(struct rk_bn_pool *pool)
+{
+	spin_lock_init(&pool->lock);
+	pool->cnt = 0;
+}
+
+/*
+ * Reuse a cached bignum of the same size if any, a burst of operations on
+ * one key only ever asks for a couple of sizes.
+ */
+struct rk_bignum *rk_bn_pool_get(struct rk_bn_pool *pool, u32 max_size)
+{
+	struct rk_bignum *bn = NULL;
+	u32 i;
+
+	spin_lock_bh(&pool->lock);
+
+	for (i = 0; i < pool->cnt; i++) {
+		if (pool->bn[i]->n_words == BYTES2WORDS(max_size)) {
+			bn = pool->bn[i];
+			pool->bn[i] = pool->bn[--pool->cnt];
+			break;
+		}
+	}
+
+	spin_unlock_bh(&pool->lock);
+
+	return bn ? bn : rk_bn_alloc(max_size);
+}
+
+void rk_bn_pool_put(struct rk_bn_pool *pool, struct rk_bignum *bn)
+{
+	if (!bn)
+		return;
+
+	/* data may be a key or a plain text, never keep it around */
+	memset(bn->data, 0x00, WORDS2BYTES(bn->n_words));
+
+	spin_lock_bh(&pool->lock);
+
+	if (pool->cnt < ARRAY_SIZE(pool->bn)) {
+		pool->bn[pool->cnt++] = bn;
+		bn = NULL;
+	}
+
+	spin_unlock_bh(&pool->lock);
+
+	rk_bn_free(bn);
+}
+
+void rk_bn_pool_drain(struct rk_bn_pool *pool)
+{
+	struct rk_bignum *bn;
+
+	spin_lock_bh(&pool->lock);
+
+	while (pool->cnt) {
+		bn = pool->bn[--pool->cnt];
+
+		spin_unlock_bh(&pool->lock);
+		rk_bn_free(bn);
+		spin_lock_bh(&pool->lock);
+	}
+
+	spin_unlock_bh(&pool->lock);
+}
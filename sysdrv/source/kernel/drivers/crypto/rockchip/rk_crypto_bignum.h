@@ -4,6 +4,10 @@
 #ifndef __RK_CRYPTO_BIGNUM_H__
 #define __RK_CRYPTO_BIGNUM_H__
 
+#include <linux/spinlock.h>
+
+#define RK_BN_POOL_SIZE		16
+
 enum bignum_endian {
 	RK_BG_BIG_ENDIAN,
 	RK_BG_LITTILE_ENDIAN
@@ -17,6 +21,15 @@ struct rk_bignum {
 	u32 *data;
 };
 
+/**
+ * struct rk_bn_pool - cache of freed bignums for reuse by the same size.
+ */
+struct rk_bn_pool {
+	spinlock_t lock;
+	u32 cnt;
+	struct rk_bignum *bn[RK_BN_POOL_SIZE];
+};
+
 struct rk_bignum *rk_bn_alloc(u32 max_size);
 void rk_bn_free(struct rk_bignum *bn);
 int rk_bn_set_data(struct rk_bignum *bn, const u8 *data, u32 size, enum bignum_endian endian);
@@ -24,4 +37,9 @@ int rk_bn_get_data(const struct rk_bignum *bn, u8 *data, u32 size, enum bignum_e
 u32 rk_bn_get_size(const struct rk_bignum *bn);
 int rk_bn_highest_bit(const struct rk_bignum *src);
 
+void rk_bn_pool_init(struct rk_bn_pool *pool);
+struct rk_bignum *rk_bn_pool_get(struct rk_bn_pool *pool, u32 max_size);
+void rk_bn_pool_put(struct rk_bn_pool *pool, struct rk_bignum *bn);
+void rk_bn_pool_drain(struct rk_bn_pool *pool);
+
 #endif
@@ -16,12 +16,14 @@
 #include <linux/of.h>
 #include <linux/clk.h>
 #include <linux/crypto.h>
+#include <linux/log2.h>
 #include <linux/reset.h>
 #include <linux/slab.h>
 #include <linux/string.h>
 
 #include "rk_crypto_core.h"
 #include "rk_crypto_utils.h"
+#include "rk_crypto_skcipher_utils.h"
 #include "rk_crypto_v1.h"
 #include "rk_crypto_v2.h"
 #include "rk_crypto_v3.h"
@@ -125,6 +127,30 @@ static int rk_load_data(struct rk_crypto_dev *rk_dev,
 							 alg_ctx->align_size);
 		alg_ctx->is_dma  = rk_crypto_check_dmafd(sg_src, src_nents) &&
 				   rk_crypto_check_dmafd(sg_dst, dst_nents);
+
+		/*
+		 * A misaligned entry only costs a bounce copy of itself for
+		 * skcipher on lli chain engines, XTS forces the bounce path
+		 * by its align_size as it can't be split.
+		 */
+		alg_ctx->split_bounce = !alg_ctx->aligned && !alg_ctx->is_dma &&
+					sg_dst && !alg_ctx->is_aead &&
+					rk_dev->soc_data->use_lli_chain &&
+					alg_ctx->align_size < rk_dev->vir_max;
+	}
+
+	if (alg_ctx->split_bounce) {
+		u32 done = alg_ctx->total - alg_ctx->left_bytes;
+		u32 nents;
+
+		sg_src = scatterwalk_ffwd(rk_dev->src, alg_ctx->req_src, done);
+		sg_dst = (alg_ctx->req_src == alg_ctx->req_dst) ? sg_src :
+			 scatterwalk_ffwd(rk_dev->dst, alg_ctx->req_dst, done);
+
+		alg_ctx->sg_src  = sg_src;
+		alg_ctx->sg_dst  = sg_dst;
+		alg_ctx->aligned = rk_crypto_aligned_len(sg_src, sg_dst, alg_ctx->left_bytes,
+							 alg_ctx->align_size, &nents) > 0;
 	}
 
 	CRYPTO_TRACE("aligned = %d, is_dma = %d, total = %u, left_bytes = %u, assoclen = %u\n",
@@ -134,7 +160,10 @@ static int rk_load_data(struct rk_crypto_dev *rk_dev,
 	if (alg_ctx->aligned) {
 		u32 nents;
 
-		if (rk_dev->soc_data->use_lli_chain) {
+		if (alg_ctx->split_bounce) {
+			count = rk_crypto_aligned_len(sg_src, sg_dst, alg_ctx->left_bytes,
+						      alg_ctx->align_size, &nents);
+		} else if (rk_dev->soc_data->use_lli_chain) {
 			count = rk_crypto_hw_desc_maxlen(sg_src, alg_ctx->left_bytes, &nents);
 		} else {
 			nents = 1;
@@ -167,8 +196,12 @@ static int rk_load_data(struct rk_crypto_dev *rk_dev,
 	} else {
 		alg_ctx->map_nents = 1;
 
-		count = (alg_ctx->left_bytes > rk_dev->vir_max) ?
-			rk_dev->vir_max : alg_ctx->left_bytes;
+		if (alg_ctx->split_bounce)
+			count = rk_crypto_unaligned_len(sg_src, sg_dst, alg_ctx->left_bytes,
+							rk_dev->vir_max, alg_ctx->align_size);
+		else
+			count = (alg_ctx->left_bytes > rk_dev->vir_max) ?
+				rk_dev->vir_max : alg_ctx->left_bytes;
 
 		if (!sg_pcopy_to_buffer(alg_ctx->req_src, alg_ctx->src_nents,
 					rk_dev->addr_vir, count,
@@ -324,6 +357,7 @@ static int rk_start_op(struct rk_crypto_dev *rk_dev)
 		return -EINVAL;
 
 	alg_ctx->aligned = false;
+	alg_ctx->split_bounce = false;
 
 	enable_irq(rk_dev->irq);
 	start_irq_timer(rk_dev);
@@ -373,8 +407,6 @@ static void rk_complete_op(struct rk_crypto_dev *rk_dev, int err)
 	alg_ctx->ops.complete(rk_dev->async_req, err);
 
 	rk_dev->async_req = NULL;
-
-	tasklet_schedule(&rk_dev->queue_task);
 }
 
 static int rk_crypto_enqueue(struct rk_crypto_dev *rk_dev,
@@ -403,10 +435,56 @@ static int rk_crypto_enqueue(struct rk_crypto_dev *rk_dev,
 	return ret;
 }
 
+static void rk_crypto_stat_batch(struct rk_crypto_dev *rk_dev)
+{
+	u32 idx;
+
+	if (!rk_dev->batch_cnt)
+		return;
+
+	idx = min_t(u32, ilog2(rk_dev->batch_cnt), RK_CRYPTO_BATCH_HIST_NUM - 1);
+	rk_dev->stat.batch_hist[idx]++;
+	rk_dev->batch_cnt = 0;
+}
+
+/*
+ * Dequeue and start the next request, called with rk_dev->lock held.
+ * Requests failing to start are completed right away and the next one is
+ * tried, the device goes idle only once the queue is empty.
+ */
+static void rk_crypto_start_next(struct rk_crypto_dev *rk_dev)
+{
+	struct crypto_async_request *async_req, *backlog;
+
+	while (!rk_dev->async_req) {
+		rk_dev->err = 0;
+
+		backlog   = crypto_get_backlog(&rk_dev->queue);
+		async_req = crypto_dequeue_request(&rk_dev->queue);
+
+		if (!async_req) {
+			rk_crypto_stat_batch(rk_dev);
+			rk_dev->busy = false;
+			return;
+		}
+		rk_dev->stat.dequeue_cnt++;
+		rk_dev->batch_cnt++;
+
+		if (backlog) {
+			backlog->complete(backlog, -EINPROGRESS);
+			backlog = NULL;
+		}
+
+		rk_dev->async_req = async_req;
+		rk_dev->err = rk_start_op(rk_dev);
+		if (rk_dev->err)
+			rk_complete_op(rk_dev, rk_dev->err);
+	}
+}
+
 static void rk_crypto_queue_task_cb(unsigned long data)
 {
 	struct rk_crypto_dev *rk_dev = (struct rk_crypto_dev *)data;
-	struct crypto_async_request *async_req, *backlog;
 	unsigned long flags;
 
 	spin_lock_irqsave(&rk_dev->lock, flags);
@@ -415,26 +493,7 @@ static void rk_crypto_queue_task_cb(unsigned long data)
 		goto exit;
 	}
 
-	rk_dev->err = 0;
-
-	backlog   = crypto_get_backlog(&rk_dev->queue);
-	async_req = crypto_dequeue_request(&rk_dev->queue);
-
-	if (!async_req) {
-		rk_dev->busy = false;
-		goto exit;
-	}
-	rk_dev->stat.dequeue_cnt++;
-
-	if (backlog) {
-		backlog->complete(backlog, -EINPROGRESS);
-		backlog = NULL;
-	}
-
-	rk_dev->async_req = async_req;
-	rk_dev->err = rk_start_op(rk_dev);
-	if (rk_dev->err)
-		rk_complete_op(rk_dev, rk_dev->err);
+	rk_crypto_start_next(rk_dev);
 
 exit:
 	spin_unlock_irqrestore(&rk_dev->lock, flags);
@@ -477,6 +536,17 @@ static void rk_crypto_done_task_cb(unsigned long data)
 	return;
 exit:
 	rk_complete_op(rk_dev, rk_dev->err);
+
+	/*
+	 * Start the queued requests back to back from the done pass, only
+	 * bounce through the queue tasklet every RK_CRYPTO_BATCH_MAX requests
+	 * so the other softirqs still get to run.
+	 */
+	if (rk_dev->batch_cnt % RK_CRYPTO_BATCH_MAX)
+		rk_crypto_start_next(rk_dev);
+	else
+		tasklet_schedule(&rk_dev->queue_task);
+
 	spin_unlock_irqrestore(&rk_dev->lock, flags);
 }
 
@@ -596,6 +666,26 @@ err_cipher_algs:
 	return err;
 }
 
+static void rk_crypto_calib_work(struct work_struct *work)
+{
+	struct rk_crypto_dev *rk_dev = container_of(work, struct rk_crypto_dev, calib_work);
+	struct rk_crypto_algt **algs;
+	uint32_t i, total_algs_num = 0;
+
+	if (!rk_dev->soc_data->use_sw_dispatch)
+		return;
+
+	algs = rk_dev->soc_data->hw_get_algts(&total_algs_num);
+	if (!algs || total_algs_num == 0)
+		return;
+
+	for (i = 0; i < total_algs_num; i++) {
+		if (algs[i]->valid_flag && algs[i]->type == ALG_TYPE_CIPHER &&
+		    (algs[i]->alg.crypto.base.cra_flags & CRYPTO_ALG_NEED_FALLBACK))
+			rk_cipher_calibrate(algs[i]);
+	}
+}
+
 static void rk_crypto_unregister(struct rk_crypto_dev *rk_dev)
 {
 	unsigned int i;
@@ -894,6 +984,10 @@ static int rk_crypto_probe(struct platform_device *pdev)
 
 	rkcrypto_proc_init(rk_dev);
 
+	/* measure the software/hardware crossover without delaying the boot */
+	INIT_WORK(&rk_dev->calib_work, rk_crypto_calib_work);
+	schedule_work(&rk_dev->calib_work);
+
 	dev_info(dev, "%s Accelerator successfully registered\n", soc_data->crypto_ver);
 	return 0;
 
@@ -908,6 +1002,8 @@ static int rk_crypto_remove(struct platform_device *pdev)
 {
 	struct rk_crypto_dev *rk_dev = platform_get_drvdata(pdev);
 
+	cancel_work_sync(&rk_dev->calib_work);
+
 	rkcrypto_proc_cleanup(rk_dev);
 
 	rk_cryptodev_unregister_dev(rk_dev->dev);
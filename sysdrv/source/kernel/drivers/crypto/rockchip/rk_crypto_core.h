@@ -48,6 +48,17 @@
 #define RK_FLAG_FINAL			BIT(0)
 #define RK_FLAG_UPDATE			BIT(1)
 
+/* requests started back to back from one done tasklet pass */
+#define RK_CRYPTO_BATCH_MAX		16
+/* batch size histogram buckets: 1, 2-3, 4-7, 8-15, 16+ */
+#define RK_CRYPTO_BATCH_HIST_NUM	5
+
+/* software/hardware crossover calibration of the ciphers */
+#define RK_CIPHER_CALIB_KEY_NUM		3
+#define RK_CIPHER_CALIB_MIN_LEN		16
+#define RK_CIPHER_CALIB_MAX_LEN		2048
+#define RK_CIPHER_CALIB_LOOPS		16
+
 struct rk_crypto_stat {
 	unsigned long long	busy_cnt;
 	unsigned long long	equeue_cnt;
@@ -59,6 +70,7 @@ struct rk_crypto_stat {
 	unsigned long long	timeout_cnt;
 	unsigned long long	error_cnt;
 	unsigned long long	ever_queue_max;
+	unsigned long long	batch_hist[RK_CRYPTO_BATCH_HIST_NUM];
 	int			last_error;
 };
 
@@ -94,6 +106,8 @@ struct rk_crypto_dev {
 
 	struct timer_list		timer;
 	bool				busy;
+	u32				batch_cnt;
+	struct work_struct		calib_work;
 	void (*request_crypto)(struct rk_crypto_dev *rk_dev, const char *name);
 	void (*release_crypto)(struct rk_crypto_dev *rk_dev, const char *name);
 	int (*load_data)(struct rk_crypto_dev *rk_dev,
@@ -112,6 +126,7 @@ struct rk_crypto_soc_data {
 	bool				use_soft_aes192;
 	int				default_pka_offset;
 	bool				use_lli_chain;
+	bool				use_sw_dispatch;
 
 	int (*hw_init)(struct device *dev, void *hw_info);
 	void (*hw_deinit)(struct device *dev, void *hw_info);
@@ -158,6 +173,8 @@ struct rk_alg_ctx {
 
 	bool				aligned;
 	bool				is_dma;
+	/* aligned runs go to the DMA directly, the rest through addr_vir */
+	bool				split_bounce;
 	int				align_size;
 	int				chunk_size;
 };
@@ -242,6 +259,10 @@ struct rk_crypto_algt {
 	char				*name;
 	bool				use_soft_aes192;
 	bool				valid_flag;
+
+	/* requests shorter than sw_threshold go to the fallback tfm */
+	u32				sw_keylen[RK_CIPHER_CALIB_KEY_NUM];
+	u32				sw_threshold[RK_CIPHER_CALIB_KEY_NUM];
 };
 
 enum rk_hash_algo {
@@ -8,6 +8,8 @@
  *
  */
 
+#include <linux/random.h>
+
 #include "rk_crypto_skcipher_utils.h"
 
 struct rk_crypto_algt *rk_cipher_get_algt(struct crypto_skcipher *tfm)
@@ -85,6 +87,130 @@ exit:
 	return ret;
 }
 
+bool rk_cipher_dispatch_sw(struct rk_cipher_ctx *ctx, struct rk_crypto_algt *algt, u32 len)
+{
+	u32 i;
+
+	if (!ctx->fallback_tfm)
+		return false;
+
+	for (i = 0; i < RK_CIPHER_CALIB_KEY_NUM; i++) {
+		if (algt->sw_keylen[i] == ctx->keylen)
+			return len < READ_ONCE(algt->sw_threshold[i]);
+	}
+
+	return false;
+}
+
+/* average time in ns of one encryption of @len bytes, negative on error */
+static s64 rk_cipher_bench(struct crypto_skcipher *tfm, u8 *buf, u32 len)
+{
+	struct skcipher_request *req;
+	struct scatterlist sg;
+	u8 iv[AES_BLOCK_SIZE];
+	DECLARE_CRYPTO_WAIT(wait);
+	ktime_t start;
+	s64 ret = 0;
+	u32 i;
+
+	req = skcipher_request_alloc(tfm, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+
+	skcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+				      crypto_req_done, &wait);
+
+	/* the first run is not counted, it only warms up the caches */
+	for (i = 0; i <= RK_CIPHER_CALIB_LOOPS; i++) {
+		if (i == 1)
+			start = ktime_get();
+
+		memset(iv, 0x00, sizeof(iv));
+		sg_init_one(&sg, buf, len);
+		skcipher_request_set_crypt(req, &sg, &sg, len, iv);
+
+		ret = crypto_wait_req(crypto_skcipher_encrypt(req), &wait);
+		if (ret)
+			goto exit;
+	}
+
+	ret = div_s64(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		      RK_CIPHER_CALIB_LOOPS);
+exit:
+	skcipher_request_free(req);
+
+	return ret;
+}
+
+/*
+ * Find for each key size the request length from which the hardware beats
+ * the fallback, below it the IRQ and tasklet round trip dominates.
+ */
+void rk_cipher_calibrate(struct rk_crypto_algt *algt)
+{
+	struct skcipher_alg *alg = &algt->alg.crypto;
+	struct crypto_skcipher *hw_tfm = NULL, *sw_tfm = NULL;
+	u8 key[AES_MAX_KEY_SIZE * 2];
+	s64 hw_ns, sw_ns;
+	u32 i, len, threshold;
+	u8 *buf = NULL;
+
+	algt->sw_keylen[0] = alg->min_keysize;
+	algt->sw_keylen[1] = (alg->min_keysize + alg->max_keysize) / 2;
+	algt->sw_keylen[2] = alg->max_keysize;
+
+	buf = kzalloc(RK_CIPHER_CALIB_MAX_LEN, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	hw_tfm = crypto_alloc_skcipher(alg->base.cra_driver_name, 0, 0);
+	if (IS_ERR(hw_tfm))
+		goto exit;
+
+	sw_tfm = crypto_alloc_skcipher(algt->name, 0, CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(sw_tfm))
+		goto exit;
+
+	for (i = 0; i < RK_CIPHER_CALIB_KEY_NUM; i++) {
+		if (i && algt->sw_keylen[i] == algt->sw_keylen[i - 1])
+			continue;
+
+		get_random_bytes(key, algt->sw_keylen[i]);
+
+		if (crypto_skcipher_setkey(hw_tfm, key, algt->sw_keylen[i]) ||
+		    crypto_skcipher_setkey(sw_tfm, key, algt->sw_keylen[i]))
+			continue;
+
+		threshold = RK_CIPHER_CALIB_MAX_LEN;
+
+		for (len = RK_CIPHER_CALIB_MIN_LEN; len <= RK_CIPHER_CALIB_MAX_LEN; len <<= 1) {
+			hw_ns = rk_cipher_bench(hw_tfm, buf, len);
+			sw_ns = rk_cipher_bench(sw_tfm, buf, len);
+			if (hw_ns < 0 || sw_ns < 0) {
+				threshold = 0;
+				break;
+			}
+
+			if (hw_ns <= sw_ns) {
+				threshold = len;
+				break;
+			}
+		}
+
+		WRITE_ONCE(algt->sw_threshold[i], threshold);
+
+		CRYPTO_MSG("%s keylen = %u, sw threshold = %u\n",
+			   algt->name, algt->sw_keylen[i], threshold);
+	}
+
+exit:
+	if (!IS_ERR_OR_NULL(sw_tfm))
+		crypto_free_skcipher(sw_tfm);
+	if (!IS_ERR_OR_NULL(hw_tfm))
+		crypto_free_skcipher(hw_tfm);
+	kfree(buf);
+}
+
 /* increment counter (128-bit int) by 1 */
 static void rk_ctr128_inc(uint8_t *counter)
 {
@@ -265,7 +391,8 @@ int rk_ablk_rx(struct rk_crypto_dev *rk_dev)
 
 	if (alg_ctx->left_bytes) {
 		rk_update_iv(rk_dev);
-		if (alg_ctx->aligned) {
+		/* split_bounce passes find their position again from req_src */
+		if (alg_ctx->aligned && !alg_ctx->split_bounce) {
 			if (sg_is_last(alg_ctx->sg_src)) {
 				dev_err(rk_dev->dev, "[%s:%d] Lack of data\n",
 					__func__, __LINE__);
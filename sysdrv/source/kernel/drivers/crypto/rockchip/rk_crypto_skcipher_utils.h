@@ -24,6 +24,10 @@ struct rk_cipher_ctx *rk_cipher_ctx_cast(struct rk_crypto_dev *rk_dev);
 
 int rk_cipher_fallback(struct skcipher_request *req, struct rk_cipher_ctx *ctx, bool encrypt);
 
+bool rk_cipher_dispatch_sw(struct rk_cipher_ctx *ctx, struct rk_crypto_algt *algt, u32 len);
+
+void rk_cipher_calibrate(struct rk_crypto_algt *algt);
+
 int rk_cipher_setkey(struct crypto_skcipher *cipher, const u8 *key, unsigned int keylen);
 
 int rk_ablk_rx(struct rk_crypto_dev *rk_dev);
@@ -120,6 +120,61 @@ bool rk_crypto_check_align(struct scatterlist *src_sg, size_t src_nents,
 	return true;
 }
 
+/*
+ * Length of the leading run of entries that can be handed to the DMA as
+ * they are, @nents returns the number of entries of the run.
+ */
+u64 rk_crypto_aligned_len(struct scatterlist *src_sg, struct scatterlist *dst_sg,
+			  u64 len, int align_mask, u32 *nents)
+{
+	u64 total = 0;
+
+	*nents = 0;
+
+	while (src_sg && total < len && *nents < RK_DEFAULT_LLI_CNT) {
+		if (!check_scatter_align(src_sg, dst_sg, align_mask))
+			break;
+
+		total += src_sg->length;
+		(*nents)++;
+
+		src_sg = sg_next(src_sg);
+		if (dst_sg)
+			dst_sg = sg_next(dst_sg);
+	}
+
+	return total > len ? len : total;
+}
+
+/*
+ * Length to go through the bounce buffer before an entry the DMA can use
+ * directly again, it stays a multiple of @align_mask unless it reaches @len
+ * so the block chaining is not broken between passes.
+ */
+u64 rk_crypto_unaligned_len(struct scatterlist *src_sg, struct scatterlist *dst_sg,
+			    u64 len, u64 max_len, int align_mask)
+{
+	u64 total = 0;
+
+	while (src_sg && total < len && total < max_len) {
+		if (total && IS_ALIGNED(total, align_mask) &&
+		    check_scatter_align(src_sg, dst_sg, align_mask))
+			return total;
+
+		/* entries of src and dst no longer line up, bounce the rest */
+		if (dst_sg && src_sg->length != dst_sg->length)
+			break;
+
+		total += src_sg->length;
+
+		src_sg = sg_next(src_sg);
+		if (dst_sg)
+			dst_sg = sg_next(dst_sg);
+	}
+
+	return len <= max_len ? len : round_down(max_len, align_mask);
+}
+
 bool rk_crypto_check_dmafd(struct scatterlist *sgl, size_t nents)
 {
 	struct scatterlist *src_tmp = NULL;
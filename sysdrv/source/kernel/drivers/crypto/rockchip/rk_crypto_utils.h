@@ -44,6 +44,12 @@ bool rk_crypto_check_align(struct scatterlist *src_sg, size_t src_nents,
 			   struct scatterlist *dst_sg, size_t dst_nents,
 			   int align_mask);
 
+u64 rk_crypto_aligned_len(struct scatterlist *src_sg, struct scatterlist *dst_sg,
+			  u64 len, int align_mask, u32 *nents);
+
+u64 rk_crypto_unaligned_len(struct scatterlist *src_sg, struct scatterlist *dst_sg,
+			    u64 len, u64 max_len, int align_mask);
+
 bool rk_crypto_check_dmafd(struct scatterlist *sgl, size_t nents);
 
 u64 rk_crypto_hw_desc_maxlen(struct scatterlist *sg, u64 len, u32 *max_nents);
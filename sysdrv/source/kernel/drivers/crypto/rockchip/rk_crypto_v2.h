@@ -26,6 +26,7 @@ struct rk_hw_crypto_v2_info {
 	.hw_info_size		= sizeof(struct rk_hw_crypto_v2_info),\
 	.default_pka_offset	= 0x0480,\
 	.use_lli_chain          = true,\
+	.use_sw_dispatch        = true,\
 }
 
 #if IS_ENABLED(CONFIG_CRYPTO_DEV_ROCKCHIP_V2)
@@ -10,6 +10,7 @@
  */
 
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include "rk_crypto_core.h"
 #include "rk_crypto_v2.h"
@@ -19,6 +20,24 @@
 #define BG_WORDS2BYTES(words)	((words) * sizeof(u32))
 #define BG_BYTES2WORDS(bytes)	(((bytes) + sizeof(u32) - 1) / sizeof(u32))
 
+#define RK_RSA_QUEUE_LEN	50
+
+struct rk_rsa_rctx {
+	bool			encrypt;
+};
+
+/*
+ * There is only one PKA, requests of all tfms are queued here and run back
+ * to back by a single work, which also owns the bignum pool.
+ */
+static struct {
+	spinlock_t		lock;
+	struct crypto_queue	queue;
+	struct work_struct	work;
+	struct rk_bn_pool	bn_pool;
+	u32			users;
+} rsa_engine;
+
 static DEFINE_MUTEX(akcipher_mutex);
 
 static void rk_rsa_adjust_rsa_key(struct rsa_key *key)
@@ -132,41 +151,30 @@ static int rk_rsa_calc(struct akcipher_request *req, bool encypt)
 {
 	struct crypto_akcipher *tfm = crypto_akcipher_reqtfm(req);
 	struct rk_rsa_ctx *ctx = akcipher_tfm_ctx(tfm);
-	struct rk_bignum *in = NULL, *out = NULL;
+	struct rk_bignum *in = NULL, *out = NULL, *tmp = NULL;
 	u32 key_byte_size;
-	u8 *tmp_buf = NULL;
+	u8 *tmp_buf;
 	int ret = -ENOMEM;
 
 	CRYPTO_TRACE();
 
-	if (unlikely(!ctx->n || !ctx->e))
-		return -EINVAL;
-
-	if (!encypt && !ctx->d)
-		return -EINVAL;
-
 	key_byte_size = rk_bn_get_size(ctx->n);
 
-	if (req->dst_len < key_byte_size) {
-		req->dst_len = key_byte_size;
-		return -EOVERFLOW;
-	}
-
-	if (req->src_len > key_byte_size)
-		return -EINVAL;
-
-	in = rk_bn_alloc(key_byte_size);
+	in = rk_bn_pool_get(&rsa_engine.bn_pool, key_byte_size);
 	if (!in)
 		goto exit;
 
-	out = rk_bn_alloc(key_byte_size);
+	out = rk_bn_pool_get(&rsa_engine.bn_pool, key_byte_size);
 	if (!out)
 		goto exit;
 
-	tmp_buf = kzalloc(key_byte_size, GFP_KERNEL);
-	if (!tmp_buf)
+	/* pooled bignums come back zeroed, borrow one as the byte buffer */
+	tmp = rk_bn_pool_get(&rsa_engine.bn_pool, key_byte_size);
+	if (!tmp)
 		goto exit;
 
+	tmp_buf = (u8 *)tmp->data;
+
 	if (!sg_copy_to_buffer(req->src, sg_nents(req->src), tmp_buf, req->src_len)) {
 		dev_err(ctx->rk_dev->dev, "[%s:%d] sg copy err\n",
 			__func__, __LINE__);
@@ -180,15 +188,11 @@ static int rk_rsa_calc(struct akcipher_request *req, bool encypt)
 
 	CRYPTO_DUMPHEX("in = ", in->data, BG_WORDS2BYTES(in->n_words));
 
-	mutex_lock(&akcipher_mutex);
-
 	if (encypt)
 		ret = rk_pka_expt_mod(in, ctx->e, ctx->n, out);
 	else
 		ret = rk_pka_expt_mod(in, ctx->d, ctx->n, out);
 
-	mutex_unlock(&akcipher_mutex);
-
 	if (ret)
 		goto exit;
 
@@ -211,10 +215,75 @@ static int rk_rsa_calc(struct akcipher_request *req, bool encypt)
 
 	CRYPTO_TRACE("ret = %d", ret);
 exit:
-	kfree(tmp_buf);
+	rk_bn_pool_put(&rsa_engine.bn_pool, tmp);
+	rk_bn_pool_put(&rsa_engine.bn_pool, in);
+	rk_bn_pool_put(&rsa_engine.bn_pool, out);
+
+	return ret;
+}
+
+static void rk_rsa_queue_work(struct work_struct *work)
+{
+	struct crypto_async_request *async_req, *backlog;
+	struct akcipher_request *req;
+	struct rk_rsa_rctx *rctx;
+	int ret;
+
+	while (true) {
+		spin_lock_bh(&rsa_engine.lock);
+		backlog   = crypto_get_backlog(&rsa_engine.queue);
+		async_req = crypto_dequeue_request(&rsa_engine.queue);
+		spin_unlock_bh(&rsa_engine.lock);
+
+		if (!async_req)
+			break;
+
+		if (backlog)
+			backlog->complete(backlog, -EINPROGRESS);
+
+		req  = akcipher_request_cast(async_req);
+		rctx = akcipher_request_ctx(req);
+
+		ret = rk_rsa_calc(req, rctx->encrypt);
+
+		async_req->complete(async_req, ret);
+
+		cond_resched();
+	}
+}
+
+static int rk_rsa_enqueue(struct akcipher_request *req, bool encypt)
+{
+	struct crypto_akcipher *tfm = crypto_akcipher_reqtfm(req);
+	struct rk_rsa_ctx *ctx = akcipher_tfm_ctx(tfm);
+	struct rk_rsa_rctx *rctx = akcipher_request_ctx(req);
+	u32 key_byte_size;
+	int ret;
+
+	if (unlikely(!ctx->n || !ctx->e))
+		return -EINVAL;
 
-	rk_bn_free(in);
-	rk_bn_free(out);
+	if (!encypt && !ctx->d)
+		return -EINVAL;
+
+	key_byte_size = rk_bn_get_size(ctx->n);
+
+	if (req->dst_len < key_byte_size) {
+		req->dst_len = key_byte_size;
+		return -EOVERFLOW;
+	}
+
+	if (req->src_len > key_byte_size)
+		return -EINVAL;
+
+	rctx->encrypt = encypt;
+
+	spin_lock_bh(&rsa_engine.lock);
+	ret = crypto_enqueue_request(&rsa_engine.queue, &req->base);
+	spin_unlock_bh(&rsa_engine.lock);
+
+	if (ret != -ENOSPC)
+		queue_work(system_long_wq, &rsa_engine.work);
 
 	return ret;
 }
@@ -223,14 +292,14 @@ static int rk_rsa_enc(struct akcipher_request *req)
 {
 	CRYPTO_TRACE();
 
-	return rk_rsa_calc(req, true);
+	return rk_rsa_enqueue(req, true);
 }
 
 static int rk_rsa_dec(struct akcipher_request *req)
 {
 	CRYPTO_TRACE();
 
-	return rk_rsa_calc(req, false);
+	return rk_rsa_enqueue(req, false);
 }
 
 static int rk_rsa_start(struct rk_crypto_dev *rk_dev)
@@ -283,6 +352,17 @@ static int rk_rsa_init_tfm(struct crypto_akcipher *tfm)
 
 	rk_pka_set_crypto_base(ctx->rk_dev->pka_reg);
 
+	mutex_lock(&akcipher_mutex);
+
+	if (!rsa_engine.users++) {
+		spin_lock_init(&rsa_engine.lock);
+		crypto_init_queue(&rsa_engine.queue, RK_RSA_QUEUE_LEN);
+		INIT_WORK(&rsa_engine.work, rk_rsa_queue_work);
+		rk_bn_pool_init(&rsa_engine.bn_pool);
+	}
+
+	mutex_unlock(&akcipher_mutex);
+
 	return 0;
 }
 
@@ -294,6 +374,15 @@ static void rk_rsa_exit_tfm(struct crypto_akcipher *tfm)
 
 	rk_rsa_clear_ctx(ctx);
 
+	mutex_lock(&akcipher_mutex);
+
+	if (!--rsa_engine.users) {
+		flush_work(&rsa_engine.work);
+		rk_bn_pool_drain(&rsa_engine.bn_pool);
+	}
+
+	mutex_unlock(&akcipher_mutex);
+
 	ctx->rk_dev->release_crypto(ctx->rk_dev, "rsa");
 }
 
@@ -308,11 +397,12 @@ struct rk_crypto_algt rk_v2_asym_rsa = {
 		.max_size = rk_rsa_max_size,
 		.init = rk_rsa_init_tfm,
 		.exit = rk_rsa_exit_tfm,
-		.reqsize = 64,
+		.reqsize = sizeof(struct rk_rsa_rctx),
 		.base = {
 			.cra_name = "rsa",
 			.cra_driver_name = "rsa-rk",
 			.cra_priority = RK_CRYPTO_PRIORITY,
+			.cra_flags = CRYPTO_ALG_ASYNC,
 			.cra_module = THIS_MODULE,
 			.cra_ctxsize = sizeof(struct rk_rsa_ctx),
 		},
@@ -266,6 +266,9 @@ static int rk_cipher_crypt(struct skcipher_request *req, bool encrypt)
 	if (is_force_fallback(algt, ctx->keylen))
 		return rk_cipher_fallback(req, ctx, encrypt);
 
+	if (rk_cipher_dispatch_sw(ctx, algt, req->cryptlen))
+		return rk_cipher_fallback(req, ctx, encrypt);
+
 	ctx->mode = cipher_algo2bc[algt->algo] |
 		    cipher_mode2bc[algt->mode];
 	if (!encrypt)
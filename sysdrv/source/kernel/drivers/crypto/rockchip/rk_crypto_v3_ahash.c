@@ -21,17 +21,18 @@
 #define RK_POLL_PERIOD_US	100
 #define RK_POLL_TIMEOUT_US	50000
 
-struct rk_ahash_expt_ctx {
-	struct rk_ahash_ctx	ctx;
-	u8			lastc[RK_DMA_ALIGNMENT];
-};
-
 struct rk_hash_mid_data {
 	u32 valid_flag;
 	u32 hash_ctl;
 	u32 data[CRYPTO_HASH_MID_WORD_SIZE];
 };
 
+struct rk_ahash_expt_ctx {
+	u32			magic;
+	struct rk_ahash_state	state;
+	struct rk_hash_mid_data	mid_data;
+};
+
 static const u32 hash_algo2bc[] = {
 	[HASH_ALGO_MD5]    = CRYPTO_MD5,
 	[HASH_ALGO_SHA1]   = CRYPTO_SHA1,
@@ -261,27 +262,49 @@ static void clean_hash_setting(struct rk_crypto_dev *rk_dev)
 
 static int rk_ahash_import(struct ahash_request *req, const void *in)
 {
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct rk_ahash_ctx *ctx = crypto_ahash_ctx(tfm);
 	struct rk_ahash_expt_ctx state;
+	int ret;
 
 	/* 'in' may not be aligned so memcpy to local variable */
 	memcpy(&state, in, sizeof(state));
 
-	///TODO:  deal with import
+	if (state.magic != RK_HASH_CTX_MAGIC)
+		return -EINVAL;
+
+	ret = rk_ahash_state_load(ctx, &state.state);
+	if (ret)
+		return ret;
+
+	/* loaded to the engine by the next request, see rk_ahash_dma_start() */
+	memcpy(ctx->priv, &state.mid_data, sizeof(state.mid_data));
+
+	memzero_explicit(&state, sizeof(state));
 
 	return 0;
 }
 
 static int rk_ahash_export(struct ahash_request *req, void *out)
 {
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct rk_ahash_ctx *ctx = crypto_ahash_ctx(tfm);
 	struct rk_ahash_expt_ctx state;
 
 	/* Don't let anything leak to 'out' */
 	memset(&state, 0, sizeof(state));
 
-	///TODO:  deal with import
+	state.magic = RK_HASH_CTX_MAGIC;
+
+	rk_ahash_state_save(ctx, &state.state);
+
+	/* stored by rk_ahash_crypto_complete() when the last update finished */
+	memcpy(&state.mid_data, ctx->priv, sizeof(state.mid_data));
 
 	memcpy(out, &state, sizeof(state));
 
+	memzero_explicit(&state, sizeof(state));
+
 	return 0;
 }
 
@@ -294,6 +317,7 @@ static int rk_ahash_dma_start(struct rk_crypto_dev *rk_dev, uint32_t flag)
 	struct crypto_lli_desc *lli_head, *lli_tail;
 	u32 dma_ctl = CRYPTO_DMA_RESTART;
 	bool is_final = flag & RK_FLAG_FINAL;
+	bool is_first;
 	int ret;
 
 	CRYPTO_TRACE("ctx->calc_cnt = %u, count %u Byte, is_final = %d",
@@ -311,7 +335,8 @@ static int rk_ahash_dma_start(struct rk_crypto_dev *rk_dev, uint32_t flag)
 		return 0;
 	}
 
-	if (alg_ctx->total == alg_ctx->left_bytes + alg_ctx->count)
+	is_first = alg_ctx->total == alg_ctx->left_bytes + alg_ctx->count;
+	if (is_first)
 		rk_hash_mid_data_restore(rk_dev, (struct rk_hash_mid_data *)ctx->priv);
 
 	if (alg_ctx->aligned)
@@ -339,6 +364,18 @@ static int rk_ahash_dma_start(struct rk_crypto_dev *rk_dev, uint32_t flag)
 		CRYPTO_WRITE(rk_dev, CRYPTO_HASH_CTL,
 			     (CRYPTO_HASH_ENABLE << CRYPTO_WRITE_MASK_SHIFT) |
 			     CRYPTO_HASH_ENABLE);
+	} else if (is_first) {
+		/*
+		 * The engine may have served other streams or other imported
+		 * states of this tfm since our last pause, so don't resume a
+		 * paused descriptor, start a new one on top of the restored
+		 * mid data instead.
+		 */
+		dma_ctl = CRYPTO_DMA_START;
+
+		lli_head->user_define |= LLI_USER_CIPHER_START;
+
+		CRYPTO_WRITE(rk_dev, CRYPTO_DMA_LLI_ADDR, hw_info->hw_desc.lli_head_dma);
 	}
 
 	if (is_final && alg_ctx->left_bytes == 0)
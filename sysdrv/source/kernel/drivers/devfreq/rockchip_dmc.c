@@ -39,6 +39,7 @@
 #include <soc/rockchip/pm_domains.h>
 #include <soc/rockchip/rkfb_dmc.h>
 #include <soc/rockchip/rockchip_dmc.h>
+#include <soc/rockchip/rockchip_dmc_bw.h>
 #include <soc/rockchip/rockchip_sip.h>
 #include <soc/rockchip/rockchip_system_monitor.h>
 #include <soc/rockchip/rockchip-system-status.h>
@@ -119,6 +120,7 @@ struct rockchip_dmcfreq {
 	struct notifier_block panic_nb;
 	struct list_head video_info_list;
 	struct freq_map_table *cpu_bw_tbl;
+	struct freq_map_table *media_bw_tbl;
 	struct work_struct boost_work;
 	struct input_handler input_handler;
 	struct monitor_dev_info *mdev_info;
@@ -2597,6 +2599,27 @@ out:
 	return target;
 }
 
+static unsigned long get_media_bw_req_rate(struct rockchip_dmcfreq *dmcfreq)
+{
+	unsigned long target = 0;
+	unsigned int bw;
+	int i;
+
+	if (!dmcfreq->media_bw_tbl)
+		return 0;
+
+	bw = rockchip_dmcfreq_bw_total();
+	if (!bw)
+		return 0;
+
+	for (i = 0; dmcfreq->media_bw_tbl[i].freq != DMCFREQ_TABLE_END; i++) {
+		if (bw >= dmcfreq->media_bw_tbl[i].min)
+			target = dmcfreq->media_bw_tbl[i].freq;
+	}
+
+	return target;
+}
+
 static int devfreq_dmc_ondemand_func(struct devfreq *df,
 				     unsigned long *freq)
 {
@@ -2608,6 +2631,7 @@ static int devfreq_dmc_ondemand_func(struct devfreq *df,
 	unsigned int upthreshold = data->upthreshold;
 	unsigned int downdifferential = data->downdifferential;
 	unsigned long target_freq = 0, nocp_req_rate = 0;
+	unsigned long media_req_rate = get_media_bw_req_rate(dmcfreq);
 	u64 now;
 
 	if (dmcfreq->info.auto_freq_en && !dmcfreq->is_fixed) {
@@ -2618,6 +2642,7 @@ static int devfreq_dmc_ondemand_func(struct devfreq *df,
 		nocp_req_rate = get_nocp_req_rate(dmcfreq);
 		target_freq = max3(target_freq, nocp_req_rate,
 				   dmcfreq->info.vop_req_rate);
+		target_freq = max(target_freq, media_req_rate);
 		now = ktime_to_us(ktime_get());
 		if (now < dmcfreq->touchboostpulse_endtime)
 			target_freq = max(target_freq, dmcfreq->boost_rate);
@@ -2626,6 +2651,7 @@ static int devfreq_dmc_ondemand_func(struct devfreq *df,
 			target_freq = dmcfreq->status_rate;
 		else if (dmcfreq->normal_rate)
 			target_freq = dmcfreq->normal_rate;
+		target_freq = max(target_freq, media_req_rate);
 		if (target_freq)
 			*freq = target_freq;
 		if (dmcfreq->info.auto_freq_en && !devfreq_update_stats(df))
@@ -2959,6 +2985,9 @@ static void rockchip_dmcfreq_parse_dt(struct rockchip_dmcfreq *dmcfreq)
 	if (rockchip_get_freq_map_talbe(np, "cpu-bw-dmc-freq",
 					&dmcfreq->cpu_bw_tbl))
 		dev_dbg(dev, "failed to get cpu bandwidth to dmc rate\n");
+	if (rockchip_get_freq_map_talbe(np, "media-bw-dmc-freq",
+					&dmcfreq->media_bw_tbl))
+		dev_dbg(dev, "failed to get media bandwidth to dmc rate\n");
 	if (rockchip_get_freq_map_talbe(np, "vop-frame-bw-dmc-freq",
 					&dmcfreq->info.vop_frame_bw_tbl))
 		dev_dbg(dev, "failed to get vop frame bandwidth to dmc rate\n");
@@ -6,8 +6,13 @@
  * Author: Finley Xiao <finley.xiao@rock-chips.com>
  */
 
+#include <linux/list.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 #include <soc/rockchip/rockchip_dmc.h>
+#include <soc/rockchip/rockchip_dmc_bw.h>
 
 #define msch_rl_to_dmcfreq(work) container_of(to_delayed_work(work), \
 					      struct rockchip_dmcfreq, \
@@ -17,6 +22,16 @@
 static struct dmcfreq_common_info *common_info;
 static DECLARE_RWSEM(rockchip_dmcfreq_sem);
 
+struct dmcfreq_bw_vote {
+	struct list_head node;
+	const char *name;
+	unsigned int mbyte;
+};
+
+static LIST_HEAD(bw_vote_list);
+static DEFINE_MUTEX(bw_vote_lock);
+static unsigned int bw_vote_total;
+
 void rockchip_dmcfreq_lock(void)
 {
 	down_read(&rockchip_dmcfreq_sem);
@@ -163,6 +178,105 @@ int rockchip_dmcfreq_vop_bandwidth_request(struct dmcfreq_vop_info *vop_info)
 }
 EXPORT_SYMBOL(rockchip_dmcfreq_vop_bandwidth_request);
 
+/**
+ * rockchip_dmcfreq_bw_get - get a DDR bandwidth vote
+ * @name: client name, shown in the dmcdbg bwvote listing
+ *
+ * Media drivers vote the bandwidth they are about to use when a stream
+ * starts, so the DDR rate is raised before the traffic shows up in the load
+ * monitors. The votes of all clients are summed and the dmc maps the total
+ * to a floor frequency through its media-bw-dmc-freq table.
+ */
+struct dmcfreq_bw_vote *rockchip_dmcfreq_bw_get(const char *name)
+{
+	struct dmcfreq_bw_vote *vote;
+
+	vote = kzalloc(sizeof(*vote), GFP_KERNEL);
+	if (!vote)
+		return ERR_PTR(-ENOMEM);
+
+	vote->name = kstrdup_const(name, GFP_KERNEL);
+	if (!vote->name) {
+		kfree(vote);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	mutex_lock(&bw_vote_lock);
+	list_add_tail(&vote->node, &bw_vote_list);
+	mutex_unlock(&bw_vote_lock);
+
+	return vote;
+}
+EXPORT_SYMBOL(rockchip_dmcfreq_bw_get);
+
+void rockchip_dmcfreq_bw_put(struct dmcfreq_bw_vote *vote)
+{
+	if (IS_ERR_OR_NULL(vote))
+		return;
+
+	rockchip_dmcfreq_bw_set(vote, 0);
+
+	mutex_lock(&bw_vote_lock);
+	list_del(&vote->node);
+	mutex_unlock(&bw_vote_lock);
+
+	kfree_const(vote->name);
+	kfree(vote);
+}
+EXPORT_SYMBOL(rockchip_dmcfreq_bw_put);
+
+/**
+ * rockchip_dmcfreq_bw_set - update a bandwidth vote
+ * @vote: vote from rockchip_dmcfreq_bw_get()
+ * @mbyte: expected DDR bandwidth in MB/s, 0 when idle
+ *
+ * May sleep, the dmc rate is updated before returning.
+ */
+int rockchip_dmcfreq_bw_set(struct dmcfreq_bw_vote *vote, unsigned int mbyte)
+{
+	if (IS_ERR_OR_NULL(vote))
+		return -EINVAL;
+
+	mutex_lock(&bw_vote_lock);
+	if (vote->mbyte == mbyte) {
+		mutex_unlock(&bw_vote_lock);
+		return 0;
+	}
+	bw_vote_total = bw_vote_total - vote->mbyte + mbyte;
+	vote->mbyte = mbyte;
+	mutex_unlock(&bw_vote_lock);
+
+	if (!common_info || !common_info->devfreq)
+		return 0;
+
+	dev_dbg(common_info->dev, "%s bw=%u, total bw=%u\n", vote->name,
+		mbyte, READ_ONCE(bw_vote_total));
+	mutex_lock(&common_info->devfreq->lock);
+	update_devfreq(common_info->devfreq);
+	mutex_unlock(&common_info->devfreq->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(rockchip_dmcfreq_bw_set);
+
+unsigned int rockchip_dmcfreq_bw_total(void)
+{
+	return READ_ONCE(bw_vote_total);
+}
+EXPORT_SYMBOL(rockchip_dmcfreq_bw_total);
+
+void rockchip_dmcfreq_bw_show(struct seq_file *m)
+{
+	struct dmcfreq_bw_vote *vote;
+
+	mutex_lock(&bw_vote_lock);
+	list_for_each_entry(vote, &bw_vote_list, node)
+		seq_printf(m, "%-16s %u MB/s\n", vote->name, vote->mbyte);
+	seq_printf(m, "%-16s %u MB/s\n", "total", bw_vote_total);
+	mutex_unlock(&bw_vote_lock);
+}
+EXPORT_SYMBOL(rockchip_dmcfreq_bw_show);
+
 MODULE_AUTHOR("Finley Xiao <finley.xiao@rock-chips.com>");
 MODULE_DESCRIPTION("rockchip dmcfreq driver with devfreq framework");
 MODULE_LICENSE("GPL v2");
@@ -5,22 +5,224 @@
 
 #include <linux/slab.h>
 #include <linux/dma-buf.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
 #undef CONFIG_DMABUF_CACHE
 #include <linux/dma-buf-cache.h>
 
 /* NOTE: dma-buf-cache APIs are not irq safe, please DO NOT run in irq context !! */
 
+#define DMA_BUF_CACHE_STAT_MAX	64
+
 struct dma_buf_cache_list {
 	struct list_head head;
 };
 
 struct dma_buf_cache {
 	struct list_head list;
+	/* on cache_lru while no importer holds the attachment */
+	struct list_head lru;
+	struct dma_buf *dmabuf;
 	struct dma_buf_attachment *attach;
 	enum dma_data_direction direction;
 	struct sg_table *sg_table;
+	int users;
+};
+
+struct dma_buf_cache_stat {
+	struct list_head list;
+	const struct device *dev;
+	char name[32];
+	unsigned long attach_hit;
+	unsigned long attach_miss;
+	unsigned long map_hit;
+	unsigned long map_miss;
+	unsigned long evict;
+};
+
+/*
+ * Idle attachments of all dma-bufs, oldest first. Once there are more than
+ * max_entries of them the oldest are unmapped and detached, instead of
+ * staying around until their dma-buf is released.
+ */
+static unsigned int max_entries = 1024;
+module_param(max_entries, uint, 0644);
+MODULE_PARM_DESC(max_entries, "max idle attachments kept cached");
+
+static LIST_HEAD(cache_lru);
+static unsigned int cache_lru_cnt;
+static DEFINE_SPINLOCK(cache_lru_lock);
+
+static LIST_HEAD(cache_stats);
+static unsigned int cache_stats_cnt;
+static DEFINE_MUTEX(cache_stats_lock);
+
+static struct dma_buf_cache_stat *dma_buf_cache_get_stat(const struct device *dev)
+{
+	struct dma_buf_cache_stat *stat;
+
+	list_for_each_entry(stat, &cache_stats, list) {
+		if (stat->dev == dev && !strncmp(stat->name, dev_name(dev),
+						 sizeof(stat->name) - 1))
+			return stat;
+	}
+
+	if (cache_stats_cnt >= DMA_BUF_CACHE_STAT_MAX)
+		return NULL;
+
+	stat = kzalloc(sizeof(*stat), GFP_KERNEL);
+	if (!stat)
+		return NULL;
+
+	stat->dev = dev;
+	strscpy(stat->name, dev_name(dev), sizeof(stat->name));
+	list_add_tail(&stat->list, &cache_stats);
+	cache_stats_cnt++;
+
+	return stat;
+}
+
+enum {
+	CACHE_ATTACH_HIT,
+	CACHE_ATTACH_MISS,
+	CACHE_MAP_HIT,
+	CACHE_MAP_MISS,
+	CACHE_EVICT,
 };
 
+static void dma_buf_cache_account(const struct device *dev, int event)
+{
+	struct dma_buf_cache_stat *stat;
+
+	mutex_lock(&cache_stats_lock);
+
+	stat = dma_buf_cache_get_stat(dev);
+	if (!stat)
+		goto out;
+
+	switch (event) {
+	case CACHE_ATTACH_HIT:
+		stat->attach_hit++;
+		break;
+	case CACHE_ATTACH_MISS:
+		stat->attach_miss++;
+		break;
+	case CACHE_MAP_HIT:
+		stat->map_hit++;
+		break;
+	case CACHE_MAP_MISS:
+		stat->map_miss++;
+		break;
+	case CACHE_EVICT:
+		stat->evict++;
+		break;
+	}
+
+out:
+	mutex_unlock(&cache_stats_lock);
+}
+
+/* called with dmabuf->cache_lock held */
+static void dma_buf_cache_get(struct dma_buf_cache *cache)
+{
+	if (cache->users++)
+		return;
+
+	spin_lock(&cache_lru_lock);
+	if (!list_empty(&cache->lru)) {
+		list_del_init(&cache->lru);
+		cache_lru_cnt--;
+	}
+	spin_unlock(&cache_lru_lock);
+}
+
+/* called with dmabuf->cache_lock held */
+static void dma_buf_cache_put(struct dma_buf_cache *cache)
+{
+	if (WARN_ON(cache->users <= 0) || --cache->users)
+		return;
+
+	spin_lock(&cache_lru_lock);
+	list_add_tail(&cache->lru, &cache_lru);
+	cache_lru_cnt++;
+	spin_unlock(&cache_lru_lock);
+}
+
+/* called with dmabuf->cache_lock held */
+static void dma_buf_cache_free(struct dma_buf_cache *cache)
+{
+	if (!IS_ERR_OR_NULL(cache->sg_table))
+		dma_buf_unmap_attachment(cache->attach,
+					 cache->sg_table,
+					 cache->direction);
+
+	dma_buf_detach(cache->dmabuf, cache->attach);
+	list_del(&cache->list);
+	kfree(cache);
+}
+
+/*
+ * Must not be called with any cache_lock held, the victims belong to other
+ * dma-bufs. The victim is looked at under cache_lru_lock, then its dma-buf
+ * file is pinned with get_file_rcu() to keep the destructor away. It is only
+ * taken off the lru and freed once its cache_lock is held, after checking it
+ * is still listed and idle: meanwhile it may have been picked up again, or
+ * evicted by another trim.
+ */
+static void dma_buf_cache_trim(void)
+{
+	struct dma_buf_cache_list *data;
+	struct dma_buf_cache *cache, *victim;
+	struct dma_buf *dmabuf;
+
+	while (true) {
+		spin_lock(&cache_lru_lock);
+
+		if (cache_lru_cnt <= READ_ONCE(max_entries)) {
+			spin_unlock(&cache_lru_lock);
+			break;
+		}
+
+		victim = list_first_entry(&cache_lru, struct dma_buf_cache, lru);
+		dmabuf = victim->dmabuf;
+		/* being released, the destructor will free it */
+		if (!get_file_rcu(dmabuf->file)) {
+			list_del_init(&victim->lru);
+			cache_lru_cnt--;
+			spin_unlock(&cache_lru_lock);
+			continue;
+		}
+
+		spin_unlock(&cache_lru_lock);
+
+		mutex_lock(&dmabuf->cache_lock);
+
+		data = dmabuf->dtor_data;
+		list_for_each_entry(cache, &data->head, list) {
+			if (cache != victim)
+				continue;
+
+			if (cache->users)
+				break;
+
+			spin_lock(&cache_lru_lock);
+			if (!list_empty(&cache->lru)) {
+				list_del_init(&cache->lru);
+				cache_lru_cnt--;
+			}
+			spin_unlock(&cache_lru_lock);
+
+			dma_buf_cache_account(cache->attach->dev, CACHE_EVICT);
+			dma_buf_cache_free(cache);
+			break;
+		}
+
+		mutex_unlock(&dmabuf->cache_lock);
+
+		dma_buf_put(dmabuf);
+	}
+}
+
 static int dma_buf_cache_destructor(struct dma_buf *dmabuf, void *dtor_data)
 {
 	struct dma_buf_cache_list *data;
@@ -31,14 +233,14 @@ static int dma_buf_cache_destructor(struct dma_buf *dmabuf, void *dtor_data)
 	data = dmabuf->dtor_data;
 
 	list_for_each_entry_safe(cache, tmp, &data->head, list) {
-		if (!IS_ERR_OR_NULL(cache->sg_table))
-			dma_buf_unmap_attachment(cache->attach,
-						 cache->sg_table,
-						 cache->direction);
-
-		dma_buf_detach(dmabuf, cache->attach);
-		list_del(&cache->list);
-		kfree(cache);
+		spin_lock(&cache_lru_lock);
+		if (!list_empty(&cache->lru)) {
+			list_del_init(&cache->lru);
+			cache_lru_cnt--;
+		}
+		spin_unlock(&cache_lru_lock);
+
+		dma_buf_cache_free(cache);
 	}
 
 	mutex_unlock(&dmabuf->cache_lock);
@@ -77,8 +279,13 @@ void dma_buf_cache_detach(struct dma_buf *dmabuf,
 	cache = dma_buf_cache_get_cache(attach);
 	if (!cache)
 		dma_buf_detach(dmabuf, attach);
+	else
+		dma_buf_cache_put(cache);
 
 	mutex_unlock(&dmabuf->cache_lock);
+
+	if (cache)
+		dma_buf_cache_trim();
 }
 EXPORT_SYMBOL(dma_buf_cache_detach);
 
@@ -111,8 +318,11 @@ struct dma_buf_attachment *dma_buf_cache_attach(struct dma_buf *dmabuf,
 	list_for_each_entry(cache, &data->head, list) {
 		if (cache->attach->dev == dev) {
 			/* Already attached */
+			dma_buf_cache_get(cache);
 			attach = cache->attach;
-			goto attach_done;
+			mutex_unlock(&dmabuf->cache_lock);
+			dma_buf_cache_account(dev, CACHE_ATTACH_HIT);
+			return attach;
 		}
 	}
 
@@ -126,9 +336,16 @@ struct dma_buf_attachment *dma_buf_cache_attach(struct dma_buf *dmabuf,
 	if (IS_ERR_OR_NULL(attach))
 		goto err_attach;
 
+	INIT_LIST_HEAD(&cache->lru);
+	cache->dmabuf = dmabuf;
 	cache->attach = attach;
+	cache->users = 1;
 	list_add(&cache->list, &data->head);
 
+	mutex_unlock(&dmabuf->cache_lock);
+	dma_buf_cache_account(dev, CACHE_ATTACH_MISS);
+	return attach;
+
 attach_done:
 	mutex_unlock(&dmabuf->cache_lock);
 	return attach;
@@ -136,8 +353,10 @@ attach_done:
 err_attach:
 	kfree(cache);
 err_cache:
-	kfree(data);
-	dma_buf_set_destructor(dmabuf, NULL, NULL);
+	if (list_empty(&data->head)) {
+		kfree(data);
+		dma_buf_set_destructor(dmabuf, NULL, NULL);
+	}
 err_data:
 	mutex_unlock(&dmabuf->cache_lock);
 	return attach;
@@ -154,7 +373,8 @@ void dma_buf_cache_unmap_attachment(struct dma_buf_attachment *attach,
 	mutex_lock(&dmabuf->cache_lock);
 
 	cache = dma_buf_cache_get_cache(attach);
-	if (!cache)
+	/* only the cached mapping outlives the unmap */
+	if (!cache || sg_table != cache->sg_table)
 		dma_buf_unmap_attachment(attach, sg_table, direction);
 
 	mutex_unlock(&dmabuf->cache_lock);
@@ -167,6 +387,7 @@ struct sg_table *dma_buf_cache_map_attachment(struct dma_buf_attachment *attach,
 	struct dma_buf *dmabuf = attach->dmabuf;
 	struct dma_buf_cache *cache;
 	struct sg_table *sg_table;
+	bool hit = false;
 
 	mutex_lock(&dmabuf->cache_lock);
 
@@ -179,11 +400,15 @@ struct sg_table *dma_buf_cache_map_attachment(struct dma_buf_attachment *attach,
 		/* Already mapped */
 		if (cache->direction == direction) {
 			sg_table = cache->sg_table;
+			hit = true;
 			goto map_done;
 		}
-		/* Different directions */
-		dma_buf_unmap_attachment(attach, cache->sg_table,
-					 cache->direction);
+		/*
+		 * Different directions. Other importers of the attachment may
+		 * still use the cached mapping, give this one its own.
+		 */
+		sg_table = dma_buf_map_attachment(attach, direction);
+		goto map_done;
 	}
 
 	/* Cache map */
@@ -193,6 +418,30 @@ struct sg_table *dma_buf_cache_map_attachment(struct dma_buf_attachment *attach,
 
 map_done:
 	mutex_unlock(&dmabuf->cache_lock);
+
+	if (cache)
+		dma_buf_cache_account(attach->dev, hit ? CACHE_MAP_HIT : CACHE_MAP_MISS);
+
 	return sg_table;
 }
 EXPORT_SYMBOL(dma_buf_cache_map_attachment);
+
+void dma_buf_cache_show(struct seq_file *s)
+{
+	struct dma_buf_cache_stat *stat;
+
+	spin_lock(&cache_lru_lock);
+	seq_printf(s, "Idle: %u/%u\n\n", cache_lru_cnt, READ_ONCE(max_entries));
+	spin_unlock(&cache_lru_lock);
+
+	seq_printf(s, "%-24s %12s %12s %12s %12s %12s\n",
+		   "DEVICE", "ATTACH_HIT", "ATTACH_MISS", "MAP_HIT", "MAP_MISS", "EVICT");
+
+	mutex_lock(&cache_stats_lock);
+	list_for_each_entry(stat, &cache_stats, list)
+		seq_printf(s, "%-24s %12lu %12lu %12lu %12lu %12lu\n",
+			   stat->name, stat->attach_hit, stat->attach_miss,
+			   stat->map_hit, stat->map_miss, stat->evict);
+	mutex_unlock(&cache_stats_lock);
+}
+EXPORT_SYMBOL(dma_buf_cache_show);
@@ -9,19 +9,37 @@
  */
 
 #include <linux/freezer.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/sched/signal.h>
 
 #include "deferred-free-helper.h"
 
+/* deferred_free_take() gives up after this many items of the list */
+#define DEFERRED_FREE_TAKE_SCAN	64
+
 static LIST_HEAD(free_list);
 static size_t list_nr_pages;
+static unsigned long list_nr_items;
+static unsigned long stat_freed;
+static unsigned long stat_recycled;
+static unsigned long stat_max_batch_us;
 wait_queue_head_t freelist_waitqueue;
 struct task_struct *freelist_task;
 static DEFINE_SPINLOCK(free_list_lock);
 
+/*
+ * The worker frees items back to back for at most batch_budget_us before
+ * it gives the CPU away, so an allocation racing a stream teardown waits
+ * for one batch rather than for the whole backlog.
+ */
+static unsigned int batch_budget_us = 2000;
+module_param(batch_budget_us, uint, 0644);
+MODULE_PARM_DESC(batch_budget_us, "time budget of one batch of the free worker");
+
 void deferred_free(struct deferred_freelist_item *item,
 		   void (*free)(struct deferred_freelist_item*,
 				enum df_reason),
@@ -36,11 +54,43 @@ void deferred_free(struct deferred_freelist_item *item,
 	spin_lock_irqsave(&free_list_lock, flags);
 	list_add(&item->list, &free_list);
 	list_nr_pages += nr_pages;
+	list_nr_items++;
 	spin_unlock_irqrestore(&free_list_lock, flags);
 	wake_up(&freelist_waitqueue);
 }
 EXPORT_SYMBOL_GPL(deferred_free);
 
+struct deferred_freelist_item *
+deferred_free_take(size_t nr_pages,
+		   bool (*match)(struct deferred_freelist_item *i, void *data),
+		   void *data)
+{
+	struct deferred_freelist_item *item, *found = NULL;
+	unsigned long flags;
+	int scanned = 0;
+
+	spin_lock_irqsave(&free_list_lock, flags);
+	/* newest first, the most likely to match a restarting stream */
+	list_for_each_entry(item, &free_list, list) {
+		if (item->nr_pages == nr_pages && match(item, data)) {
+			found = item;
+			break;
+		}
+		if (++scanned >= DEFERRED_FREE_TAKE_SCAN)
+			break;
+	}
+	if (found) {
+		list_del(&found->list);
+		list_nr_pages -= nr_pages;
+		list_nr_items--;
+		stat_recycled++;
+	}
+	spin_unlock_irqrestore(&free_list_lock, flags);
+
+	return found;
+}
+EXPORT_SYMBOL_GPL(deferred_free_take);
+
 static size_t free_one_item(enum df_reason reason)
 {
 	unsigned long flags;
@@ -52,10 +102,12 @@ static size_t free_one_item(enum df_reason reason)
 		spin_unlock_irqrestore(&free_list_lock, flags);
 		return 0;
 	}
-	item = list_first_entry(&free_list, struct deferred_freelist_item, list);
+	item = list_last_entry(&free_list, struct deferred_freelist_item, list);
 	list_del(&item->list);
 	nr_pages = item->nr_pages;
 	list_nr_pages -= nr_pages;
+	list_nr_items--;
+	stat_freed++;
 	spin_unlock_irqrestore(&free_list_lock, flags);
 
 	item->free(item, reason);
@@ -74,6 +126,20 @@ unsigned long get_freelist_nr_pages(void)
 }
 EXPORT_SYMBOL_GPL(get_freelist_nr_pages);
 
+void deferred_free_get_stats(struct deferred_free_stats *stats)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&free_list_lock, flags);
+	stats->nr_items = list_nr_items;
+	stats->nr_pages = list_nr_pages;
+	stats->freed = stat_freed;
+	stats->recycled = stat_recycled;
+	stats->max_batch_us = stat_max_batch_us;
+	spin_unlock_irqrestore(&free_list_lock, flags);
+}
+EXPORT_SYMBOL_GPL(deferred_free_get_stats);
+
 static unsigned long freelist_shrink_count(struct shrinker *shrinker,
 					   struct shrink_control *sc)
 {
@@ -107,13 +173,35 @@ static struct shrinker freelist_shrinker = {
 	.batch = 0,
 };
 
+static void deferred_free_batch(void)
+{
+	ktime_t start = ktime_get();
+	s64 budget_us = READ_ONCE(batch_budget_us);
+	unsigned long flags;
+	s64 elapsed_us;
+
+	do {
+		if (!free_one_item(DF_NORMAL))
+			break;
+		elapsed_us = ktime_us_delta(ktime_get(), start);
+	} while (elapsed_us < budget_us);
+
+	elapsed_us = ktime_us_delta(ktime_get(), start);
+
+	spin_lock_irqsave(&free_list_lock, flags);
+	if (elapsed_us > stat_max_batch_us)
+		stat_max_batch_us = elapsed_us;
+	spin_unlock_irqrestore(&free_list_lock, flags);
+}
+
 static int deferred_free_thread(void *data)
 {
 	while (true) {
 		wait_event_freezable(freelist_waitqueue,
 				     get_freelist_nr_pages() > 0);
 
-		free_one_item(DF_NORMAL);
+		deferred_free_batch();
+		cond_resched();
 	}
 
 	return 0;
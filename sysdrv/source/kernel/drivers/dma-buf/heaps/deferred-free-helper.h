@@ -53,5 +53,39 @@ void deferred_free(struct deferred_freelist_item *item,
 				enum df_reason reason),
 		   size_t nr_pages);
 
+/**
+ * deferred_free_take - take an item back from the deferred free list
+ *
+ * @nr_pages: number of pages of the wanted item
+ * @match: returns true if the item can be reused by the caller
+ * @data: passed to @match
+ *
+ * Lets an allocation recycle a buffer that is still waiting to be freed
+ * instead of allocating a new one. Returns NULL if there is none.
+ */
+struct deferred_freelist_item *
+deferred_free_take(size_t nr_pages,
+		   bool (*match)(struct deferred_freelist_item *i, void *data),
+		   void *data);
+
+/**
+ * deferred_free_stats - snapshot of the deferred free list
+ *
+ * @nr_items: number of items waiting to be freed
+ * @nr_pages: number of pages waiting to be freed
+ * @freed: number of items freed by the worker or the shrinker
+ * @recycled: number of items taken back by deferred_free_take()
+ * @max_batch_us: longest batch the worker ran since boot
+ */
+struct deferred_free_stats {
+	unsigned long nr_items;
+	unsigned long nr_pages;
+	unsigned long freed;
+	unsigned long recycled;
+	unsigned long max_batch_us;
+};
+
+void deferred_free_get_stats(struct deferred_free_stats *stats);
+
 unsigned long get_freelist_nr_pages(void);
 #endif
@@ -9,21 +9,38 @@
  */
 
 #include <linux/freezer.h>
+#include <linux/jiffies.h>
 #include <linux/list.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/swap.h>
 #include <linux/sched/signal.h>
+#include <linux/workqueue.h>
 #include "page_pool.h"
 
+/* don't refill right after the shrinker took pages back */
+#define POOL_REFILL_BACKOFF	(HZ)
+
 struct dmabuf_page_pool_with_spinlock {
 	struct dmabuf_page_pool pool;
 	struct spinlock spinlock;
+	const char *name;
+	unsigned int low;
+	unsigned int high;
+	atomic_long_t hit;
+	atomic_long_t miss;
 };
 
+#define to_container_pool(p) \
+	container_of(p, struct dmabuf_page_pool_with_spinlock, pool)
+
 static LIST_HEAD(pool_list);
 static DEFINE_MUTEX(pool_list_lock);
 
+static unsigned long pool_last_shrink;
+static void dmabuf_page_pool_refill_work(struct work_struct *work);
+static DECLARE_WORK(pool_refill_work, dmabuf_page_pool_refill_work);
+
 static inline
 struct page *dmabuf_page_pool_alloc_pages(struct dmabuf_page_pool *pool)
 {
@@ -90,14 +107,44 @@ static struct page *dmabuf_page_pool_fetch(struct dmabuf_page_pool *pool)
 	return page;
 }
 
+static int dmabuf_page_pool_count(struct dmabuf_page_pool *pool)
+{
+	return READ_ONCE(pool->count[POOL_LOWPAGE]) +
+	       READ_ONCE(pool->count[POOL_HIGHPAGE]);
+}
+
+static bool dmabuf_page_pool_below_low(struct dmabuf_page_pool *pool)
+{
+	unsigned int low = READ_ONCE(to_container_pool(pool)->low);
+
+	return low && dmabuf_page_pool_count(pool) < low;
+}
+
+static unsigned int dmabuf_page_pool_refill_target(struct dmabuf_page_pool *pool)
+{
+	struct dmabuf_page_pool_with_spinlock *container_pool = to_container_pool(pool);
+
+	return max(READ_ONCE(container_pool->low), READ_ONCE(container_pool->high));
+}
+
 struct page *dmabuf_page_pool_alloc(struct dmabuf_page_pool *pool)
 {
+	struct dmabuf_page_pool_with_spinlock *container_pool;
 	struct page *page = NULL;
 
 	if (WARN_ON(!pool))
 		return NULL;
 
+	container_pool = to_container_pool(pool);
+
 	page = dmabuf_page_pool_fetch(pool);
+	if (page)
+		atomic_long_inc(&container_pool->hit);
+	else
+		atomic_long_inc(&container_pool->miss);
+
+	if (dmabuf_page_pool_below_low(pool))
+		queue_work(system_unbound_wq, &pool_refill_work);
 
 	if (!page)
 		page = dmabuf_page_pool_alloc_pages(pool);
@@ -107,13 +154,144 @@ EXPORT_SYMBOL_GPL(dmabuf_page_pool_alloc);
 
 void dmabuf_page_pool_free(struct dmabuf_page_pool *pool, struct page *page)
 {
+	unsigned int high;
+
 	if (WARN_ON(pool->order != compound_order(page)))
 		return;
 
+	high = READ_ONCE(to_container_pool(pool)->high);
+	if (high && dmabuf_page_pool_count(pool) >= high) {
+		dmabuf_page_pool_free_pages(pool, page);
+		return;
+	}
+
 	dmabuf_page_pool_add(pool, page);
 }
 EXPORT_SYMBOL_GPL(dmabuf_page_pool_free);
 
+void dmabuf_page_pool_set_name(struct dmabuf_page_pool *pool, const char *name)
+{
+	to_container_pool(pool)->name = name;
+}
+EXPORT_SYMBOL_GPL(dmabuf_page_pool_set_name);
+
+/*
+ * @low and @high count pages of the pool order. Below @low the pool is
+ * refilled up to @high from a background work, so that allocations at
+ * stream start don't have to wait for direct compaction.
+ */
+void dmabuf_page_pool_set_watermark(struct dmabuf_page_pool *pool,
+				    unsigned int low, unsigned int high)
+{
+	struct dmabuf_page_pool_with_spinlock *container_pool = to_container_pool(pool);
+
+	WRITE_ONCE(container_pool->low, low);
+	WRITE_ONCE(container_pool->high, high);
+
+	if (dmabuf_page_pool_below_low(pool))
+		queue_work(system_unbound_wq, &pool_refill_work);
+}
+EXPORT_SYMBOL_GPL(dmabuf_page_pool_set_watermark);
+
+/* Allocate up to @nr pages into the pool, returns the number added. */
+int dmabuf_page_pool_fill(struct dmabuf_page_pool *pool, unsigned int nr)
+{
+	struct page *page;
+	int filled = 0;
+
+	while (filled < nr) {
+		page = alloc_pages(pool->gfp_mask | __GFP_NOWARN, pool->order);
+		if (!page)
+			break;
+
+		dmabuf_page_pool_add(pool, page);
+		filled++;
+	}
+
+	return filled;
+}
+EXPORT_SYMBOL_GPL(dmabuf_page_pool_fill);
+
+void dmabuf_page_pool_get_stats(struct dmabuf_page_pool *pool,
+				struct dmabuf_page_pool_stats *stats)
+{
+	struct dmabuf_page_pool_with_spinlock *container_pool = to_container_pool(pool);
+
+	stats->name  = container_pool->name;
+	stats->order = pool->order;
+	stats->count = dmabuf_page_pool_count(pool);
+	stats->low   = READ_ONCE(container_pool->low);
+	stats->high  = READ_ONCE(container_pool->high);
+	stats->hit   = atomic_long_read(&container_pool->hit);
+	stats->miss  = atomic_long_read(&container_pool->miss);
+}
+EXPORT_SYMBOL_GPL(dmabuf_page_pool_get_stats);
+
+int dmabuf_page_pool_for_each(int (*fn)(struct dmabuf_page_pool *pool, void *data),
+			      void *data)
+{
+	struct dmabuf_page_pool *pool;
+	int ret = 0;
+
+	mutex_lock(&pool_list_lock);
+	list_for_each_entry(pool, &pool_list, list) {
+		ret = fn(pool, data);
+		if (ret)
+			break;
+	}
+	mutex_unlock(&pool_list_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dmabuf_page_pool_for_each);
+
+/*
+ * Runs under pool_list_lock, so it must not enter direct reclaim, which
+ * would call back into our own shrinker.
+ */
+static bool dmabuf_page_pool_refill_one(struct dmabuf_page_pool *pool)
+{
+	struct page *page;
+
+	page = alloc_pages((pool->gfp_mask & ~__GFP_DIRECT_RECLAIM) | __GFP_NOWARN,
+			   pool->order);
+	if (!page)
+		return false;
+
+	dmabuf_page_pool_add(pool, page);
+
+	return true;
+}
+
+static void dmabuf_page_pool_refill_work(struct work_struct *work)
+{
+	struct dmabuf_page_pool *pool;
+	int count, target;
+
+	mutex_lock(&pool_list_lock);
+	list_for_each_entry(pool, &pool_list, list) {
+		if (!dmabuf_page_pool_below_low(pool))
+			continue;
+
+		target = dmabuf_page_pool_refill_target(pool);
+		count = dmabuf_page_pool_count(pool);
+
+		while (count < target) {
+			if (time_before(jiffies, READ_ONCE(pool_last_shrink) +
+					POOL_REFILL_BACKOFF))
+				goto out;
+
+			if (!dmabuf_page_pool_refill_one(pool))
+				break;
+
+			count = dmabuf_page_pool_count(pool);
+			cond_resched();
+		}
+	}
+out:
+	mutex_unlock(&pool_list_lock);
+}
+
 static int dmabuf_page_pool_total(struct dmabuf_page_pool *pool, bool high)
 {
 	int count = pool->count[POOL_LOWPAGE];
@@ -135,6 +313,11 @@ struct dmabuf_page_pool *dmabuf_page_pool_create(gfp_t gfp_mask, unsigned int or
 		return NULL;
 
 	spin_lock_init(&container_pool->spinlock);
+	container_pool->name = NULL;
+	container_pool->low = 0;
+	container_pool->high = 0;
+	atomic_long_set(&container_pool->hit, 0);
+	atomic_long_set(&container_pool->miss, 0);
 	pool = &container_pool->pool;
 
 	for (i = 0; i < POOL_TYPE_SIZE; i++) {
@@ -190,6 +373,8 @@ static int dmabuf_page_pool_do_shrink(struct dmabuf_page_pool *pool, gfp_t gfp_m
 	if (nr_to_scan == 0)
 		return dmabuf_page_pool_total(pool, high);
 
+	WRITE_ONCE(pool_last_shrink, jiffies);
+
 	while (freed < nr_to_scan) {
 		struct page *page;
 
@@ -262,6 +447,9 @@ struct shrinker pool_shrinker = {
 
 static int dmabuf_page_pool_init_shrinker(void)
 {
+	/* jiffies starts negative, 0 would hold the refill back for minutes */
+	pool_last_shrink = jiffies - POOL_REFILL_BACKOFF;
+
 	return register_shrinker(&pool_shrinker);
 }
 module_init(dmabuf_page_pool_init_shrinker);
@@ -46,10 +46,38 @@ struct dmabuf_page_pool {
 	struct list_head list;
 };
 
+/**
+ * struct dmabuf_page_pool_stats - snapshot of a pagepool
+ * @name:		name given by the pool owner, may be NULL
+ * @order:		order of pages in the pool
+ * @count:		number of pages of that order in the pool
+ * @low:		refill in background when count drops below it, 0 off
+ * @high:		free pages back to the system above it, 0 no limit
+ * @hit:		allocations served from the pool
+ * @miss:		allocations that had to go to the page allocator
+ */
+struct dmabuf_page_pool_stats {
+	const char *name;
+	unsigned int order;
+	int count;
+	unsigned int low;
+	unsigned int high;
+	unsigned long hit;
+	unsigned long miss;
+};
+
 struct dmabuf_page_pool *dmabuf_page_pool_create(gfp_t gfp_mask,
 						 unsigned int order);
 void dmabuf_page_pool_destroy(struct dmabuf_page_pool *pool);
 struct page *dmabuf_page_pool_alloc(struct dmabuf_page_pool *pool);
 void dmabuf_page_pool_free(struct dmabuf_page_pool *pool, struct page *page);
+void dmabuf_page_pool_set_name(struct dmabuf_page_pool *pool, const char *name);
+void dmabuf_page_pool_set_watermark(struct dmabuf_page_pool *pool,
+				    unsigned int low, unsigned int high);
+int dmabuf_page_pool_fill(struct dmabuf_page_pool *pool, unsigned int nr);
+void dmabuf_page_pool_get_stats(struct dmabuf_page_pool *pool,
+				struct dmabuf_page_pool_stats *stats);
+int dmabuf_page_pool_for_each(int (*fn)(struct dmabuf_page_pool *pool, void *data),
+			      void *data);
 
 #endif /* _DMABUF_PAGE_POOL_H */
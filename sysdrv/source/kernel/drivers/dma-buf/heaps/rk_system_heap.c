@@ -74,6 +74,23 @@ static unsigned int orders[] = {8, 4, 0};
 struct dmabuf_page_pool *pools[NUM_ORDERS];
 struct dmabuf_page_pool *dma32_pools[NUM_ORDERS];
 
+/*
+ * Per order pool setup of the "system" heap, counted in pages of each order,
+ * e.g. rk_system_heap.pool_prefill=64,0,0 puts 64MiB of 1MiB pages into the
+ * pool at boot. Watermarks can be changed later from /proc/rk_dmabuf/pool.
+ */
+static unsigned int pool_prefill[NUM_ORDERS];
+module_param_array(pool_prefill, uint, NULL, 0444);
+MODULE_PARM_DESC(pool_prefill, "pages of each order allocated into the pools at boot");
+
+static unsigned int pool_low[NUM_ORDERS];
+module_param_array(pool_low, uint, NULL, 0444);
+MODULE_PARM_DESC(pool_low, "refill the pools in background below these watermarks");
+
+static unsigned int pool_high[NUM_ORDERS];
+module_param_array(pool_high, uint, NULL, 0444);
+MODULE_PARM_DESC(pool_high, "free pages back to the system above these watermarks");
+
 static struct sg_table *dup_sg_table(struct sg_table *table)
 {
 	struct sg_table *new_table;
@@ -463,6 +480,63 @@ static void system_heap_buf_free(struct deferred_freelist_item *item,
 	kfree(buffer);
 }
 
+struct system_heap_recycle_key {
+	struct dma_heap *heap;
+	unsigned long len;
+	bool uncached;
+};
+
+static bool system_heap_buf_match(struct deferred_freelist_item *item, void *data)
+{
+	struct system_heap_recycle_key *key = data;
+	struct system_heap_buffer *buffer;
+
+	if (item->free != system_heap_buf_free)
+		return false;
+
+	buffer = container_of(item, struct system_heap_buffer, deferred_free);
+
+	return buffer->heap == key->heap && buffer->len == key->len &&
+	       buffer->uncached == key->uncached;
+}
+
+/*
+ * A stream that restarts usually asks for the very buffers it just
+ * released, take them back from the deferred free list instead of waiting
+ * for the worker to return them to the pool one by one.
+ */
+static struct system_heap_buffer *system_heap_recycle(struct dma_heap *heap,
+						      unsigned long len,
+						      bool uncached)
+{
+	struct system_heap_recycle_key key = {
+		.heap = heap,
+		.len = len,
+		.uncached = uncached,
+	};
+	struct deferred_freelist_item *item;
+	struct system_heap_buffer *buffer;
+
+	item = deferred_free_take(PAGE_ALIGN(len) / PAGE_SIZE,
+				  system_heap_buf_match, &key);
+	if (!item)
+		return NULL;
+
+	buffer = container_of(item, struct system_heap_buffer, deferred_free);
+
+	/* The pages still hold the data of the last user, never hand them out */
+	if (system_heap_zero_buffer(buffer)) {
+		system_heap_buf_free(item, DF_UNDER_PRESSURE);
+		return NULL;
+	}
+
+	INIT_LIST_HEAD(&buffer->attachments);
+	buffer->vmap_cnt = 0;
+	buffer->vaddr = NULL;
+
+	return buffer;
+}
+
 static void system_heap_dma_buf_release(struct dma_buf *dmabuf)
 {
 	struct system_heap_buffer *buffer = dmabuf->priv;
@@ -532,6 +606,16 @@ static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
 	unsigned int maximum;
 	int j;
 
+	INIT_LIST_HEAD(&pages);
+	for (i = 0; i < 8; i++)
+		INIT_LIST_HEAD(&lists[i]);
+
+	buffer = system_heap_recycle(heap, len, uncached);
+	if (buffer) {
+		table = &buffer->sg_table;
+		goto export;
+	}
+
 	buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
 	if (!buffer)
 		return ERR_PTR(-ENOMEM);
@@ -543,9 +627,6 @@ static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
 	buffer->uncached = uncached;
 	buffer->pools = strstr(dma_heap_get_name(heap), "dma32") ? dma32_pools : pools;
 
-	INIT_LIST_HEAD(&pages);
-	for (i = 0; i < 8; i++)
-		INIT_LIST_HEAD(&lists[i]);
 	i = 0;
 	while (size_remaining > 0) {
 		/*
@@ -603,6 +684,7 @@ static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
 		}
 	}
 
+export:
 	/* create the dmabuf */
 	exp_info.exp_name = dma_heap_get_name(heap);
 	exp_info.ops = &system_heap_buf_ops;
@@ -765,6 +847,13 @@ static int system_heap_create(void)
 				dmabuf_page_pool_destroy(pools[j]);
 			return -ENOMEM;
 		}
+
+		dmabuf_page_pool_set_name(pools[i], "system");
+		dmabuf_page_pool_set_watermark(pools[i], pool_low[i], pool_high[i]);
+		if (pool_prefill[i])
+			pr_info("system_heap: order %u prefill %d/%u\n", orders[i],
+				dmabuf_page_pool_fill(pools[i], pool_prefill[i]),
+				pool_prefill[i]);
 	}
 
 	for (i = 0; i < NUM_ORDERS; i++) {
@@ -778,6 +867,8 @@ static int system_heap_create(void)
 				dmabuf_page_pool_destroy(dma32_pools[j]);
 			goto err_dma32_pool;
 		}
+
+		dmabuf_page_pool_set_name(dma32_pools[i], "system-dma32");
 	}
 
 	exp_info.name = "system";
@@ -17,6 +17,7 @@
 #include <linux/dma-buf.h>
 #include <linux/dma-map-ops.h>
 #include <linux/err.h>
+#include <linux/genalloc.h>
 #include <linux/highmem.h>
 #include <linux/io.h>
 #include <linux/mm.h>
@@ -29,9 +30,23 @@
 #include "../../../mm/cma.h"
 #include "rk-dma-heap.h"
 
+/*
+ * Carve named partitions out of the rk cma at boot, one heap each, e.g.
+ * rk_cma_heap.partitions=isp:64M,venc:32M,npu:16M,rga:8M
+ * A partition is a size budget of its client: buffers are handed out from
+ * a bitmap over memory taken from cma once, so they never migrate pages
+ * and other clients can't fragment it.
+ */
+static char *partitions;
+module_param(partitions, charp, 0444);
+MODULE_PARM_DESC(partitions, "<client>:<size>[,...] carved from the cma heap");
+
 struct rk_cma_heap {
 	struct rk_dma_heap *heap;
 	struct cma *cma;
+	struct gen_pool *pool;	/* partition only */
+	struct page *pool_pages;
+	pgoff_t pool_pagecount;
 };
 
 struct rk_cma_heap_buffer {
@@ -55,6 +70,36 @@ struct rk_cma_heap_attachment {
 	bool mapped;
 };
 
+static struct page *rk_cma_heap_get_pages(struct rk_cma_heap *cma_heap,
+					  pgoff_t pagecount, unsigned long align)
+{
+	struct genpool_data_align data = {
+		.align = PAGE_SIZE << align,
+	};
+	unsigned long phys;
+
+	if (!cma_heap->pool)
+		return cma_alloc(cma_heap->cma, pagecount, align, GFP_KERNEL);
+
+	phys = gen_pool_alloc_algo(cma_heap->pool, pagecount << PAGE_SHIFT,
+				   gen_pool_first_fit_align, &data);
+	if (!phys)
+		return NULL;
+
+	return phys_to_page(phys);
+}
+
+static void rk_cma_heap_put_pages(struct rk_cma_heap *cma_heap,
+				  struct page *pages, pgoff_t pagecount)
+{
+	if (!cma_heap->pool) {
+		cma_release(cma_heap->cma, pages, pagecount);
+		return;
+	}
+
+	gen_pool_free(cma_heap->pool, page_to_phys(pages), pagecount << PAGE_SHIFT);
+}
+
 static int rk_cma_heap_attach(struct dma_buf *dmabuf,
 			      struct dma_buf_attachment *attachment)
 {
@@ -397,7 +442,7 @@ static void rk_cma_heap_dma_buf_release(struct dma_buf *dmabuf)
 	/* free page list */
 	kfree(buffer->pages);
 	/* release memory */
-	cma_release(cma_heap->cma, buffer->cma_pages, buffer->pagecount);
+	rk_cma_heap_put_pages(cma_heap, buffer->cma_pages, buffer->pagecount);
 	rk_dma_heap_total_dec(heap, buffer->len);
 
 	kfree(buffer);
@@ -447,7 +492,7 @@ static struct dma_buf *rk_cma_heap_allocate(struct rk_dma_heap *heap,
 	if (align > CONFIG_DMABUF_HEAPS_ROCKCHIP_CMA_ALIGNMENT)
 		align = CONFIG_DMABUF_HEAPS_ROCKCHIP_CMA_ALIGNMENT;
 
-	cma_pages = cma_alloc(cma_heap->cma, pagecount, align, GFP_KERNEL);
+	cma_pages = rk_cma_heap_get_pages(cma_heap, pagecount, align);
 	if (!cma_pages)
 		goto free_buffer;
 
@@ -518,7 +563,7 @@ fail_dma_buf:
 free_pages:
 	kfree(buffer->pages);
 free_cma:
-	cma_release(cma_heap->cma, cma_pages, pagecount);
+	rk_cma_heap_put_pages(cma_heap, cma_pages, pagecount);
 free_buffer:
 	kfree(buffer);
 
@@ -538,13 +583,13 @@ static struct page *rk_cma_heap_allocate_pages(struct rk_dma_heap *heap,
 	if (align > CONFIG_DMABUF_HEAPS_ROCKCHIP_CMA_ALIGNMENT)
 		align = CONFIG_DMABUF_HEAPS_ROCKCHIP_CMA_ALIGNMENT;
 
-	page = cma_alloc(cma_heap->cma, pagecount, align, GFP_KERNEL);
+	page = rk_cma_heap_get_pages(cma_heap, pagecount, align);
 	if (!page)
 		return ERR_PTR(-ENOMEM);
 
 	ret = rk_cma_heap_add_contig_list(heap, page, size, name);
 	if (ret) {
-		cma_release(cma_heap->cma, page, pagecount);
+		rk_cma_heap_put_pages(cma_heap, page, pagecount);
 		return ERR_PTR(-EINVAL);
 	}
 
@@ -562,7 +607,7 @@ static void rk_cma_heap_free_pages(struct rk_dma_heap *heap,
 
 	rk_cma_heap_remove_contig_list(heap, page, name);
 
-	cma_release(cma_heap->cma, page, pagecount);
+	rk_cma_heap_put_pages(cma_heap, page, pagecount);
 
 	rk_dma_heap_total_dec(heap, len);
 }
@@ -574,6 +619,7 @@ static const struct rk_dma_heap_ops rk_cma_heap_ops = {
 };
 
 static int cma_procfs_show(struct seq_file *s, void *private);
+static int cma_partition_procfs_show(struct seq_file *s, void *private);
 
 static int __rk_add_cma_heap(struct cma *cma, void *data)
 {
@@ -605,14 +651,115 @@ static int __rk_add_cma_heap(struct cma *cma, void *data)
 	return 0;
 }
 
+static int __rk_add_cma_partition(struct cma *cma, const char *client,
+				  unsigned long size)
+{
+	struct rk_dma_heap_export_info exp_info;
+	struct rk_cma_heap *cma_heap;
+	pgoff_t pagecount = PAGE_ALIGN(size) >> PAGE_SHIFT;
+	char *name;
+	int ret = -ENOMEM;
+
+	cma_heap = kzalloc(sizeof(*cma_heap), GFP_KERNEL);
+	if (!cma_heap)
+		return -ENOMEM;
+	cma_heap->cma = cma;
+
+	name = kasprintf(GFP_KERNEL, "%s-%s", cma_get_name(cma), client);
+	if (!name)
+		goto free_heap;
+
+	cma_heap->pool = gen_pool_create(PAGE_SHIFT, -1);
+	if (!cma_heap->pool)
+		goto free_name;
+
+	cma_heap->pool_pages = cma_alloc(cma, pagecount,
+					 CONFIG_DMABUF_HEAPS_ROCKCHIP_CMA_ALIGNMENT,
+					 GFP_KERNEL);
+	if (!cma_heap->pool_pages)
+		goto free_pool;
+	cma_heap->pool_pagecount = pagecount;
+
+	ret = gen_pool_add(cma_heap->pool, page_to_phys(cma_heap->pool_pages),
+			   pagecount << PAGE_SHIFT, -1);
+	if (ret)
+		goto free_cma;
+
+	exp_info.name = name;
+	exp_info.ops = &rk_cma_heap_ops;
+	exp_info.priv = cma_heap;
+	exp_info.support_cma = true;
+
+	cma_heap->heap = rk_dma_heap_add(&exp_info);
+	if (IS_ERR(cma_heap->heap)) {
+		ret = PTR_ERR(cma_heap->heap);
+		goto free_cma;
+	}
+
+	if (cma_heap->heap->procfs)
+		proc_create_single_data("partition", 0, cma_heap->heap->procfs,
+					cma_partition_procfs_show, cma_heap);
+
+	pr_info("%s: %lu KiB partition\n", name, pagecount << (PAGE_SHIFT - 10));
+
+	return 0;
+
+free_cma:
+	cma_release(cma, cma_heap->pool_pages, pagecount);
+free_pool:
+	gen_pool_destroy(cma_heap->pool);
+free_name:
+	kfree(name);
+free_heap:
+	kfree(cma_heap);
+
+	return ret;
+}
+
+static void __init rk_add_cma_partitions(struct cma *cma)
+{
+	char *buf, *opts, *opt, *client;
+	unsigned long size;
+
+	if (!partitions || !*partitions)
+		return;
+
+	buf = kstrdup(partitions, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	opts = buf;
+	while ((opt = strsep(&opts, ",")) != NULL) {
+		client = strsep(&opt, ":");
+		if (!opt || !*client) {
+			pr_err("%s: bad partition '%s'\n", cma_get_name(cma), client);
+			continue;
+		}
+
+		size = memparse(opt, NULL);
+		if (!size || __rk_add_cma_partition(cma, client, size))
+			pr_err("%s: failed to add %s partition\n",
+			       cma_get_name(cma), client);
+	}
+
+	kfree(buf);
+}
+
 static int __init rk_add_default_cma_heap(void)
 {
 	struct cma *cma = rk_dma_heap_get_cma();
+	int ret;
 
 	if (WARN_ON(!cma))
 		return -EINVAL;
 
-	return __rk_add_cma_heap(cma, NULL);
+	ret = __rk_add_cma_heap(cma, NULL);
+	if (ret)
+		return ret;
+
+	rk_add_cma_partitions(cma);
+
+	return 0;
 }
 
 #if defined(CONFIG_VIDEO_ROCKCHIP_THUNDER_BOOT_ISP) && !defined(CONFIG_INITCALL_ASYNC)
@@ -677,5 +824,21 @@ static int cma_procfs_show(struct seq_file *s, void *private)
 	return 0;
 }
 
+static int cma_partition_procfs_show(struct seq_file *s, void *private)
+{
+	struct rk_cma_heap *cma_heap = s->private;
+	size_t total = gen_pool_size(cma_heap->pool);
+	size_t avail = gen_pool_avail(cma_heap->pool);
+	phys_addr_t start = page_to_phys(cma_heap->pool_pages);
+	phys_addr_t end = start + total - 1;
+
+	seq_printf(s, "Range: %pa..%pa\n", &start, &end);
+	seq_printf(s, "Total: %zu KiB\n", total >> 10);
+	seq_printf(s, " Used: %zu KiB\n", (total - avail) >> 10);
+	seq_printf(s, "Avail: %zu KiB\n", avail >> 10);
+
+	return 0;
+}
+
 MODULE_DESCRIPTION("RockChip DMA-BUF CMA Heap");
 MODULE_LICENSE("GPL v2");
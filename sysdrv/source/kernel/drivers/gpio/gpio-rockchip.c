@@ -21,6 +21,7 @@
 #include <linux/platform_device.h>
 #include <linux/property.h>
 #include <linux/regmap.h>
+#include <linux/timekeeping.h>
 
 #include "../pinctrl/core.h"
 #include "../pinctrl/pinctrl-rockchip.h"
@@ -188,6 +189,47 @@ static int rockchip_gpio_get(struct gpio_chip *gc, unsigned int offset)
 	return data;
 }
 
+/*
+ * The v2 data register has a write-mask in its upper half, so the whole bank
+ * is updated without a read-modify-write: lines 0-15 and 16-31 each change
+ * together in a single write.
+ */
+static void rockchip_gpio_set_multiple(struct gpio_chip *gc,
+				       unsigned long *mask, unsigned long *bits)
+{
+	struct rockchip_pin_bank *bank = gpiochip_get_data(gc);
+	void __iomem *reg = bank->reg_base + bank->gpio_regs->port_dr;
+	u32 m = *mask, b = *bits & *mask;
+	unsigned long flags;
+	u32 data;
+
+	if (bank->gpio_type == GPIO_TYPE_V2) {
+		if (m & 0xffff)
+			writel((m & 0xffff) << 16 | (b & 0xffff), reg);
+		if (m >> 16)
+			writel((m & 0xffff0000) | b >> 16, reg + 0x4);
+		return;
+	}
+
+	raw_spin_lock_irqsave(&bank->slock, flags);
+	data = readl(reg);
+	data = (data & ~m) | b;
+	writel(data, reg);
+	raw_spin_unlock_irqrestore(&bank->slock, flags);
+}
+
+static int rockchip_gpio_get_multiple(struct gpio_chip *gc,
+				      unsigned long *mask, unsigned long *bits)
+{
+	struct rockchip_pin_bank *bank = gpiochip_get_data(gc);
+	u32 data;
+
+	data = readl(bank->reg_base + bank->gpio_regs->ext_port);
+	*bits = (*bits & ~*mask) | (data & *mask);
+
+	return 0;
+}
+
 static int rockchip_gpio_set_debounce(struct gpio_chip *gc,
 				      unsigned int offset,
 				      unsigned int debounce)
@@ -313,16 +355,31 @@ static int rockchip_gpio_to_irq(struct gpio_chip *gc, unsigned int offset)
 	return (virq) ? : -ENXIO;
 }
 
+/*
+ * The edges of a bank are all stamped when its interrupt is taken, before the
+ * demux loop and the both-edge polarity switching delay the line handlers.
+ */
+static u64 rockchip_gpio_get_event_time(struct gpio_chip *gc,
+					unsigned int offset)
+{
+	struct rockchip_pin_bank *bank = gpiochip_get_data(gc);
+
+	return bank->irq_timestamp;
+}
+
 static const struct gpio_chip rockchip_gpiolib_chip = {
 	.request = gpiochip_generic_request,
 	.free = gpiochip_generic_free,
 	.set = rockchip_gpio_set,
 	.get = rockchip_gpio_get,
+	.set_multiple = rockchip_gpio_set_multiple,
+	.get_multiple = rockchip_gpio_get_multiple,
 	.get_direction	= rockchip_gpio_get_direction,
 	.direction_input = rockchip_gpio_direction_input,
 	.direction_output = rockchip_gpio_direction_output,
 	.set_config = rockchip_gpio_set_config,
 	.to_irq = rockchip_gpio_to_irq,
+	.get_event_time = rockchip_gpio_get_event_time,
 	.owner = THIS_MODULE,
 };
 
@@ -336,6 +393,7 @@ static void rockchip_irq_demux(struct irq_desc *desc)
 
 	chained_irq_enter(chip, desc);
 
+	bank->irq_timestamp = ktime_get_ns();
 	pend = readl_relaxed(bank->reg_base + bank->gpio_regs->int_status);
 
 	while (pend) {
@@ -386,6 +444,7 @@ static void rockchip_irq_demux(struct irq_desc *desc)
 		generic_handle_irq(virq);
 	}
 
+	bank->irq_timestamp = 0;
 	chained_irq_exit(chip, desc);
 }
 
@@ -404,6 +404,22 @@ out_free_lh:
 }
 #endif /* CONFIG_GPIO_CDEV_V1 */
 
+/*
+ * Timestamp of the edge being handled, from hardirq context. Chips that latch
+ * the time of their pending edges before demuxing them can report it, which
+ * keeps the IRQ entry and demux latency out of the event timestamp.
+ */
+static u64 gpio_event_time(struct gpio_desc *desc)
+{
+	struct gpio_chip *gc = desc->gdev->chip;
+	u64 ts = 0;
+
+	if (gc && gc->get_event_time)
+		ts = gc->get_event_time(gc, gpio_chip_hwgpio(desc));
+
+	return ts ? ts : ktime_get_ns();
+}
+
 /**
  * struct line - contains the state of a requested line
  * @desc: the GPIO descriptor for this line.
@@ -590,7 +606,7 @@ static irqreturn_t edge_irq_handler(int irq, void *p)
 	 * Just store the timestamp in hardirq context so we get it as
 	 * close in time as possible to the actual event.
 	 */
-	line->timestamp_ns = ktime_get_ns();
+	line->timestamp_ns = gpio_event_time(line->desc);
 
 	if (lr->num_lines != 1)
 		line->req_seqno = atomic_inc_return(&lr->seqno);
@@ -1684,7 +1700,7 @@ static irqreturn_t lineevent_irq_handler(int irq, void *p)
 	 * Just store the timestamp in hardirq context so we get it as
 	 * close in time as possible to the actual event.
 	 */
-	le->timestamp = ktime_get_ns();
+	le->timestamp = gpio_event_time(le->desc);
 
 	return IRQ_WAKE_THREAD;
 }
@@ -23,6 +23,10 @@
  * DOC: Base kernel memory APIs
  */
 #include <linux/dma-buf.h>
+#ifdef CONFIG_DMABUF_CACHE
+/* keep the attachment and mapping of re-imported dma-bufs */
+#include <linux/dma-buf-cache.h>
+#endif
 #include <linux/kernel.h>
 #include <linux/bug.h>
 #include <linux/compat.h>
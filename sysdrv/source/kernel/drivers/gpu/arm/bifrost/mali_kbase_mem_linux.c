@@ -32,6 +32,10 @@
 #include <linux/version.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-buf.h>
+#ifdef CONFIG_DMABUF_CACHE
+/* keep the attachment and mapping of re-imported dma-bufs */
+#include <linux/dma-buf-cache.h>
+#endif
 #include <linux/shrinker.h>
 #include <linux/cache.h>
 #include <linux/memory_group_manager.h>
@@ -68,6 +68,36 @@ int ebc_remove_from_dsp_buf_list(struct ebc_buf_s *remove_buf)
 	return BUF_SUCCESS;
 }
 
+static int ebc_buf_is_full_mode(int buf_mode)
+{
+	return (buf_mode == EPD_FULL_GC16) ||
+	       (buf_mode == EPD_FULL_GL16) ||
+	       (buf_mode == EPD_FULL_GLR16) ||
+	       (buf_mode == EPD_FULL_GLD16) ||
+	       (buf_mode == EPD_FULL_GCC16);
+}
+
+static int ebc_buf_has_win(struct ebc_buf_s *buf)
+{
+	return (buf->win_x2 > buf->win_x1) && (buf->win_y2 > buf->win_y1);
+}
+
+/*
+ * A partial update that replaces a pending one must also refresh the area
+ * of the dropped update, so grow its window to cover both.
+ */
+static void ebc_buf_merge_win(struct ebc_buf_s *dsp_buf, struct ebc_buf_s *old_buf)
+{
+	if (ebc_buf_is_full_mode(dsp_buf->buf_mode) ||
+	    !ebc_buf_has_win(dsp_buf) || !ebc_buf_has_win(old_buf))
+		return;
+
+	dsp_buf->win_x1 = min(dsp_buf->win_x1, old_buf->win_x1);
+	dsp_buf->win_y1 = min(dsp_buf->win_y1, old_buf->win_y1);
+	dsp_buf->win_x2 = max(dsp_buf->win_x2, old_buf->win_x2);
+	dsp_buf->win_y2 = max(dsp_buf->win_y2, old_buf->win_y2);
+}
+
 int ebc_add_to_dsp_buf_list(struct ebc_buf_s *dsp_buf)
 {
 	struct ebc_buf_s *temp_buf;
@@ -90,17 +120,14 @@ int ebc_add_to_dsp_buf_list(struct ebc_buf_s *dsp_buf)
 				temp_pos = ebc_buf_info.dsp_buf_list->nb_elt;
 				while (--temp_pos) {
 					temp_buf = (struct ebc_buf_s *)buf_list_get(ebc_buf_info.dsp_buf_list, temp_pos);
-					if ((temp_buf->buf_mode != EPD_FULL_GC16) &&
-					    (temp_buf->buf_mode != EPD_FULL_GL16) &&
-					    (temp_buf->buf_mode != EPD_FULL_GLR16) &&
-					    (temp_buf->buf_mode != EPD_FULL_GLD16) &&
-					    (temp_buf->buf_mode != EPD_FULL_GCC16) &&
+					if (!ebc_buf_is_full_mode(temp_buf->buf_mode) &&
 					    (temp_buf->buf_mode != EPD_OVERLAY) &&
 					    (temp_buf->buf_mode != EPD_DU) &&
 					    (temp_buf->buf_mode != EPD_SUSPEND) &&
 					    (temp_buf->buf_mode != EPD_RESUME) &&
 					    (temp_buf->buf_mode != EPD_POWER_OFF)) {
 						buf_list_remove(ebc_buf_info.dsp_buf_list, temp_pos);
+						ebc_buf_merge_win(dsp_buf, temp_buf);
 						ebc_buf_release(temp_buf);
 					} else if ((1 == is_full_mode) &&
 						   (temp_buf->buf_mode != EPD_DU) &&
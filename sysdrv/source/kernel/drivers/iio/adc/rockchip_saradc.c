@@ -270,6 +270,7 @@ static const struct iio_chan_spec rockchip_saradc_iio_channels[] = {
 	SARADC_CHANNEL(0, "adc0", 10),
 	SARADC_CHANNEL(1, "adc1", 10),
 	SARADC_CHANNEL(2, "adc2", 10),
+	IIO_CHAN_SOFT_TIMESTAMP(3),
 };
 
 static const struct rockchip_saradc_data saradc_data = {
@@ -284,6 +285,7 @@ static const struct rockchip_saradc_data saradc_data = {
 static const struct iio_chan_spec rockchip_rk3066_tsadc_iio_channels[] = {
 	SARADC_CHANNEL(0, "adc0", 12),
 	SARADC_CHANNEL(1, "adc1", 12),
+	IIO_CHAN_SOFT_TIMESTAMP(2),
 };
 
 static const struct rockchip_saradc_data rk3066_tsadc_data = {
@@ -302,6 +304,7 @@ static const struct iio_chan_spec rockchip_rk3399_saradc_iio_channels[] = {
 	SARADC_CHANNEL(3, "adc3", 10),
 	SARADC_CHANNEL(4, "adc4", 10),
 	SARADC_CHANNEL(5, "adc5", 10),
+	IIO_CHAN_SOFT_TIMESTAMP(6),
 };
 
 static const struct rockchip_saradc_data rk3399_saradc_data = {
@@ -318,6 +321,7 @@ static const struct iio_chan_spec rockchip_rk3528_saradc_iio_channels[] = {
 	SARADC_CHANNEL(1, "adc1", 10),
 	SARADC_CHANNEL(2, "adc2", 10),
 	SARADC_CHANNEL(3, "adc3", 10),
+	IIO_CHAN_SOFT_TIMESTAMP(4),
 };
 
 static const struct rockchip_saradc_data rk3528_saradc_data = {
@@ -337,6 +341,7 @@ static const struct iio_chan_spec rockchip_rk3562_saradc_iio_channels[] = {
 	SARADC_CHANNEL(5, "adc5", 10),
 	SARADC_CHANNEL(6, "adc6", 10),
 	SARADC_CHANNEL(7, "adc7", 10),
+	IIO_CHAN_SOFT_TIMESTAMP(8),
 };
 
 static const struct rockchip_saradc_data rk3562_saradc_data = {
@@ -356,6 +361,7 @@ static const struct iio_chan_spec rockchip_rk3568_saradc_iio_channels[] = {
 	SARADC_CHANNEL(5, "adc5", 10),
 	SARADC_CHANNEL(6, "adc6", 10),
 	SARADC_CHANNEL(7, "adc7", 10),
+	IIO_CHAN_SOFT_TIMESTAMP(8),
 };
 
 static const struct rockchip_saradc_data rk3568_saradc_data = {
@@ -376,6 +382,7 @@ static const struct iio_chan_spec rockchip_rk3588_saradc_iio_channels[] = {
 	SARADC_CHANNEL(5, "adc5", 12),
 	SARADC_CHANNEL(6, "adc6", 12),
 	SARADC_CHANNEL(7, "adc7", 12),
+	IIO_CHAN_SOFT_TIMESTAMP(8),
 };
 
 static const struct rockchip_saradc_data rk3588_saradc_data = {
@@ -389,6 +396,7 @@ static const struct rockchip_saradc_data rk3588_saradc_data = {
 static const struct iio_chan_spec rockchip_rv1106_saradc_iio_channels[] = {
 	SARADC_CHANNEL(0, "adc0", 10),
 	SARADC_CHANNEL(1, "adc1", 10),
+	IIO_CHAN_SOFT_TIMESTAMP(2),
 };
 
 static const struct rockchip_saradc_data rv1106_saradc_data = {
@@ -478,9 +486,16 @@ static irqreturn_t rockchip_saradc_trigger_handler(int irq, void *p)
 
 	mutex_lock(&i_dev->mlock);
 
+	if (info->suspended)
+		goto out;
+
 	for_each_set_bit(i, i_dev->active_scan_mask, i_dev->masklength) {
 		const struct iio_chan_spec *chan = &i_dev->channels[i];
 
+		/* the timestamp is filled in by the core, not converted */
+		if (chan->type == IIO_TIMESTAMP)
+			continue;
+
 		ret = rockchip_saradc_conversion(info, chan);
 		if (ret) {
 			rockchip_saradc_power_down(info);
@@ -617,8 +632,11 @@ static int rockchip_saradc_probe(struct platform_device *pdev)
 
 	info->data = match->data;
 
-	/* Sanity check for possible later IP variants with more channels */
-	if (info->data->num_channels > SARADC_MAX_CHANNELS) {
+	/*
+	 * Sanity check for possible later IP variants with more channels,
+	 * the last channel is the timestamp
+	 */
+	if (info->data->num_channels - 1 > SARADC_MAX_CHANNELS) {
 		dev_err(&pdev->dev, "max channels exceeded");
 		return -EINVAL;
 	}
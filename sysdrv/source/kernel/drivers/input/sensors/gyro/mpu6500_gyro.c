@@ -149,6 +149,100 @@ static int sensor_report_value(struct i2c_client *client)
 	return ret;
 }
 
+/*
+ * gyro samples only, the accel side is always polled. The rate is 1kHz
+ * divided by SMPLRT_DIV + 1, the one actually set is returned.
+ */
+static int sensor_batch(struct i2c_client *client, int enable, int rate)
+{
+	int user_ctrl, dlpf, div, result;
+
+	user_ctrl = sensor_read_reg(client, MPU6500_USER_CTRL);
+
+	if (!enable) {
+		result = sensor_write_reg(client, MPU6500_FIFO_EN, 0);
+		if (result)
+			return result;
+		return sensor_write_reg(client, MPU6500_USER_CTRL, user_ctrl & ~BIT_FIFO_EN);
+	}
+
+	if (rate < 4 || rate > 1000)
+		return -EINVAL;
+
+	if (rate >= 368)
+		dlpf = DLPF_CFG_184HZ;
+	else if (rate >= 196)
+		dlpf = DLPF_CFG_98HZ;
+	else
+		dlpf = DLPF_CFG_41HZ;
+
+	/* internal sample rate is 1kHz with the DLPF on */
+	result = sensor_write_reg(client, MPU6500_CONFIG, dlpf);
+	if (result)
+		return result;
+	div = 1000 / rate - 1;
+	result = sensor_write_reg(client, MPU6500_SMPLRT_DIV, div);
+	if (result)
+		return result;
+	result = sensor_write_reg(client, MPU6500_FIFO_EN, BITS_GYRO_OUT);
+	if (result)
+		return result;
+	result = sensor_write_reg(client, MPU6500_USER_CTRL,
+				  user_ctrl | BIT_FIFO_EN | BIT_FIFO_RST);
+	if (result)
+		return result;
+
+	return 1000 / (div + 1);
+}
+
+#define MPU6500_FIFO_BURST	16
+
+static int sensor_read_fifo(struct i2c_client *client, struct sensor_axis *axis, int max)
+{
+	struct sensor_private_data *sensor =
+		(struct sensor_private_data *) i2c_get_clientdata(client);
+	struct sensor_platform_data *pdata = sensor->pdata;
+	u8 buffer[MPU6500_FIFO_BURST * SENSOR_PACKET];
+	int count, done, n, i, ret;
+	short x, y, z;
+	u8 *p;
+
+	if (sensor_read_reg(client, MPU6500_INT_STATUS) & BIT_FIFO_OVERLOW) {
+		ret = sensor_read_reg(client, MPU6500_USER_CTRL);
+		sensor_write_reg(client, MPU6500_USER_CTRL, ret | BIT_FIFO_RST);
+		return -EOVERFLOW;
+	}
+
+	buffer[0] = MPU6500_FIFO_COUNTH;
+	ret = sensor_rx_data(client, buffer, FIFO_COUNT_BYTE);
+	if (ret < 0)
+		return ret;
+
+	count = (((buffer[0] << 8) | buffer[1]) & 0x1fff) / SENSOR_PACKET;
+	count = min(count, max);
+
+	for (done = 0; done < count; done += n) {
+		n = min(count - done, MPU6500_FIFO_BURST);
+		buffer[0] = MPU6500_FIFO_R_W;
+		ret = sensor_rx_data(client, buffer, n * SENSOR_PACKET);
+		if (ret < 0)
+			return ret;
+
+		for (i = 0; i < n; i++) {
+			p = buffer + i * SENSOR_PACKET;
+			x = (p[0] << 8) | p[1];
+			y = (p[2] << 8) | p[3];
+			z = (p[4] << 8) | p[5];
+
+			axis[done + i].x = (pdata->orientation[0]) * x + (pdata->orientation[1]) * y + (pdata->orientation[2]) * z;
+			axis[done + i].y = (pdata->orientation[3]) * x + (pdata->orientation[4]) * y + (pdata->orientation[5]) * z;
+			axis[done + i].z = (pdata->orientation[6]) * x + (pdata->orientation[7]) * y + (pdata->orientation[8]) * z;
+		}
+	}
+
+	return count;
+}
+
 static struct sensor_operate gyro_mpu6500_ops = {
 	.name				= "mpu6500_gyro",
 	.type				= SENSOR_TYPE_GYROSCOPE,
@@ -165,6 +259,8 @@ static struct sensor_operate gyro_mpu6500_ops = {
 	.active				= sensor_active,
 	.init					= sensor_init,
 	.report 				= sensor_report_value,
+	.batch				= sensor_batch,
+	.read_fifo			= sensor_read_fifo,
 };
 
 /****************operate according to sensor chip:end************/
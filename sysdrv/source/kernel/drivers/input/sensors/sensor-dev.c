@@ -30,6 +30,7 @@
 #include <linux/gpio.h>
 #include <linux/of_gpio.h>
 #include <linux/of.h>
+#include <linux/poll.h>
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/earlysuspend.h>
 #endif
@@ -512,6 +513,59 @@ static int sensor_reset_rate(struct i2c_client *client, int rate)
 	return result;
 }
 
+static int sensor_poll_delay(struct sensor_private_data *sensor)
+{
+	return sensor->batch_ms ? sensor->batch_ms : sensor->pdata->poll_delay_ms;
+}
+
+/*
+ * Drain the hardware FIFO into the batch ring. The FIFO doesn't timestamp
+ * the samples, spread them evenly over the time since the previous drain.
+ */
+static int sensor_batch_report(struct sensor_private_data *sensor)
+{
+	struct i2c_client *client = sensor->client;
+	struct sensor_sample sample = {};
+	s64 now, span, period;
+	int n, i;
+
+	n = sensor->ops->read_fifo(client, sensor->batch_buf, SENSOR_BATCH_CHUNK);
+	if (n == -EOVERFLOW) {
+		dev_warn_ratelimited(&client->dev, "hardware fifo overflow\n");
+		sensor->batch_ts = 0;
+		return 0;
+	}
+	if (n <= 0)
+		return n;
+
+	now = ktime_get_ns();
+	period = NSEC_PER_SEC / sensor->batch_rate;
+	span = sensor->batch_ts ? now - sensor->batch_ts : 0;
+	if (span <= 0 || span > 2 * n * period)
+		span = n * period;
+
+	for (i = 0; i < n; i++) {
+		sample.timestamp = now - div_s64(span * (n - 1 - i), n);
+		sample.x = sensor->batch_buf[i].x;
+		sample.y = sensor->batch_buf[i].y;
+		sample.z = sensor->batch_buf[i].z;
+		if (!kfifo_put(&sensor->batch_fifo, sample)) {
+			dev_warn_ratelimited(&client->dev, "batch ring full, %d samples dropped\n",
+					     n - i);
+			break;
+		}
+	}
+	sensor->batch_ts = now;
+
+	mutex_lock(&sensor->data_mutex);
+	sensor->axis = sensor->batch_buf[n - 1];
+	mutex_unlock(&sensor->data_mutex);
+
+	wake_up_interruptible(&sensor->batch_wq);
+
+	return 0;
+}
+
 static void  sensor_delaywork_func(struct work_struct *work)
 {
 	struct delayed_work *delaywork = container_of(work, struct delayed_work, work);
@@ -520,13 +574,16 @@ static void  sensor_delaywork_func(struct work_struct *work)
 	int result;
 
 	mutex_lock(&sensor->sensor_mutex);
-	result = sensor->ops->report(client);
+	if (sensor->batch_ms)
+		result = sensor_batch_report(sensor);
+	else
+		result = sensor->ops->report(client);
 	if (result < 0)
 		dev_err(&client->dev, "%s: Get data failed\n", __func__);
 	mutex_unlock(&sensor->sensor_mutex);
 
 	if ((!sensor->pdata->irq_enable) && (sensor->stop_work == 0))
-		schedule_delayed_work(&sensor->delaywork, msecs_to_jiffies(sensor->pdata->poll_delay_ms));
+		schedule_delayed_work(&sensor->delaywork, msecs_to_jiffies(sensor_poll_delay(sensor)));
 }
 
 /*
@@ -676,13 +733,22 @@ static int sensor_enable(struct sensor_private_data *sensor, int enable)
 			dev_err(&client->dev, "%s:fail to active sensor,ret=%d\n", __func__, result);
 			return result;
 		}
+		if (sensor->batch_ms) {
+			result = sensor->ops->batch(client, 1, sensor->batch_rate);
+			if (result < 0)
+				dev_err(&client->dev, "%s:fail to start batch mode,ret=%d\n", __func__, result);
+			else if (result > 0)
+				sensor->batch_rate = result;
+			result = 0;
+			sensor->batch_ts = 0;
+		}
 		sensor->status_cur = SENSOR_ON;
 		sensor->stop_work = 0;
 		if (sensor->pdata->irq_enable)
 			enable_irq(client->irq);
 		else
-			schedule_delayed_work(&sensor->delaywork, msecs_to_jiffies(sensor->pdata->poll_delay_ms));
-		dev_info(&client->dev, "sensor on: starting poll sensor data %dms\n", sensor->pdata->poll_delay_ms);
+			schedule_delayed_work(&sensor->delaywork, msecs_to_jiffies(sensor_poll_delay(sensor)));
+		dev_info(&client->dev, "sensor on: starting poll sensor data %dms\n", sensor_poll_delay(sensor));
 	} else {
 		sensor->stop_work = 1;
 		if (sensor->pdata->irq_enable)
@@ -700,6 +766,112 @@ static int sensor_enable(struct sensor_private_data *sensor, int enable)
 	return result;
 }
 
+/*
+ * Switch batch mode, called with operation_mutex held. The samples are
+ * queued to a ring read from the misc device instead of being reported
+ * one by one as input events.
+ */
+static int sensor_set_batch(struct sensor_private_data *sensor,
+			    struct sensor_batch_config *config)
+{
+	struct i2c_client *client = sensor->client;
+	int rate = config->rate;
+	int result = 0;
+
+	if (!sensor->ops->batch || !sensor->ops->read_fifo)
+		return -EOPNOTSUPP;
+	if (sensor->pdata->irq_enable)
+		return -EINVAL;
+	if (config->rate < 0 || (config->rate && config->period_ms <= 0))
+		return -EINVAL;
+
+	if (config->rate && !sensor->batch_buf) {
+		sensor->batch_buf = devm_kcalloc(&client->dev, SENSOR_BATCH_CHUNK,
+						 sizeof(*sensor->batch_buf), GFP_KERNEL);
+		if (!sensor->batch_buf)
+			return -ENOMEM;
+		result = kfifo_alloc(&sensor->batch_fifo, SENSOR_BATCH_SAMPLES, GFP_KERNEL);
+		if (result) {
+			devm_kfree(&client->dev, sensor->batch_buf);
+			sensor->batch_buf = NULL;
+			return result;
+		}
+	}
+
+	if (sensor->status_cur == SENSOR_ON) {
+		sensor->stop_work = 1;
+		cancel_delayed_work_sync(&sensor->delaywork);
+		result = sensor->ops->batch(client, !!config->rate, config->rate);
+		/* timestamps follow the rate the hardware really samples at */
+		if (result > 0) {
+			rate = result;
+			result = 0;
+		}
+	}
+
+	if (!result) {
+		sensor->batch_rate = rate;
+		sensor->batch_ms = config->rate ? min(config->period_ms, 1000) : 0;
+		sensor->batch_ts = 0;
+		mutex_lock(&sensor->batch_mutex);
+		if (sensor->batch_buf)
+			kfifo_reset(&sensor->batch_fifo);
+		mutex_unlock(&sensor->batch_mutex);
+		wake_up_interruptible(&sensor->batch_wq);
+	}
+
+	if (sensor->status_cur == SENSOR_ON) {
+		sensor->stop_work = 0;
+		schedule_delayed_work(&sensor->delaywork, msecs_to_jiffies(sensor_poll_delay(sensor)));
+	}
+
+	return result;
+}
+
+static ssize_t sensor_batch_read(struct file *file, char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct sensor_private_data *sensor =
+		container_of(file->private_data, struct sensor_private_data, miscdev);
+	unsigned int copied;
+	int result;
+
+	if (count < sizeof(struct sensor_sample))
+		return -EINVAL;
+	if (!sensor->batch_buf)
+		return -ENODATA;
+
+	if (kfifo_is_empty(&sensor->batch_fifo)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		result = wait_event_interruptible(sensor->batch_wq,
+						  !kfifo_is_empty(&sensor->batch_fifo) ||
+						  !sensor->batch_ms);
+		if (result)
+			return result;
+	}
+
+	mutex_lock(&sensor->batch_mutex);
+	result = kfifo_to_user(&sensor->batch_fifo, buf,
+			       rounddown(count, sizeof(struct sensor_sample)), &copied);
+	mutex_unlock(&sensor->batch_mutex);
+
+	return result ? result : copied;
+}
+
+static __poll_t sensor_batch_poll(struct file *file, poll_table *wait)
+{
+	struct sensor_private_data *sensor =
+		container_of(file->private_data, struct sensor_private_data, miscdev);
+
+	poll_wait(file, &sensor->batch_wq, wait);
+
+	if (sensor->batch_buf && !kfifo_is_empty(&sensor->batch_fifo))
+		return EPOLLIN | EPOLLRDNORM;
+
+	return 0;
+}
+
 /* ioctl - I/O control */
 static long angle_dev_ioctl(struct file *file,
 			  unsigned int cmd, unsigned long arg)
@@ -1068,6 +1240,7 @@ static long gyro_dev_ioctl(struct file *file,
 	struct sensor_private_data *sensor = g_sensor[SENSOR_TYPE_GYROSCOPE];
 	struct i2c_client *client = sensor->client;
 	void __user *argp = (void __user *)arg;
+	struct sensor_batch_config batch;
 	int result = 0;
 	int rate;
 
@@ -1116,6 +1289,15 @@ static long gyro_dev_ioctl(struct file *file,
 		}
 		mutex_unlock(&sensor->operation_mutex);
 		break;
+	case L3G4200D_IOCTL_SET_BATCH:
+		if (copy_from_user(&batch, argp, sizeof(batch))) {
+			dev_err(&client->dev, "L3G4200D_IOCTL_SET_BATCH: copy from user failed\n");
+			return -EFAULT;
+		}
+		mutex_lock(&sensor->operation_mutex);
+		result = sensor_set_batch(sensor, &batch);
+		mutex_unlock(&sensor->operation_mutex);
+		break;
 	case L3G4200D_IOCTL_GET_CALIBRATION:
 		if (sensor_cali_data.is_gyro_calibrated != 1) {
 			if (sensor_calibration_data_read(&sensor_cali_data)) {
@@ -1478,6 +1660,8 @@ static int sensor_misc_device_register(struct sensor_private_data *sensor, int t
 			sensor->fops.unlocked_ioctl = gyro_dev_ioctl;
 			sensor->fops.open = gyro_dev_open;
 			sensor->fops.release = gyro_dev_release;
+			sensor->fops.read = sensor_batch_read;
+			sensor->fops.poll = sensor_batch_poll;
 
 			sensor->miscdev.minor = MISC_DYNAMIC_MINOR;
 			sensor->miscdev.name = "gyrosensor";
@@ -1794,6 +1978,8 @@ static int sensor_probe(struct i2c_client *client, const struct i2c_device_id *d
 	mutex_init(&sensor->operation_mutex);
 	mutex_init(&sensor->sensor_mutex);
 	mutex_init(&sensor->i2c_mutex);
+	mutex_init(&sensor->batch_mutex);
+	init_waitqueue_head(&sensor->batch_wq);
 
 	atomic_set(&sensor->is_factory, 0);
 	init_waitqueue_head(&sensor->is_factory_ok);
@@ -1970,6 +2156,8 @@ static int sensor_remove(struct i2c_client *client)
 	sensor->stop_work = 1;
 	cancel_delayed_work_sync(&sensor->delaywork);
 	misc_deregister(&sensor->miscdev);
+	if (sensor->batch_buf)
+		kfifo_free(&sensor->batch_fifo);
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	if ((sensor->ops->suspend) && (sensor->ops->resume))
 		unregister_early_suspend(&sensor->early_suspend);
@@ -8,6 +8,7 @@
 
 #include <linux/clk.h>
 #include <linux/compiler.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/dma-iommu.h>
@@ -17,7 +18,9 @@
 #include <linux/io.h>
 #include <linux/iommu.h>
 #include <linux/iopoll.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/init.h>
@@ -26,6 +29,7 @@
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <soc/rockchip/rockchip_iommu.h>
@@ -84,9 +88,20 @@
  /*
   * Support mapping any size that fits in one page table:
   *   4 KiB to 4 MiB
+  *
+  * This only lets the core hand us large chunks at once. Neither the v1 nor
+  * the v2 table format has a section or large page descriptor (DTE bits 3:1
+  * and PTE bits 11:9 are reserved), so the hardware always walks down to a
+  * 4 KiB PTE, however contiguous the buffer is.
   */
 #define RK_IOMMU_PGSIZE_BITMAP 0x007ff000
 
+/* iova range covered by one page table */
+#define RK_IOMMU_PT_SPAN (NUM_PT_ENTRIES * SPAGE_SIZE)
+
+/* Shoot down the entire iotlb rather than more lines than this */
+#define RK_IOMMU_ZAP_LINES_MAX 256
+
 struct rk_iommu_domain {
 	struct list_head iommus;
 	u32 *dt; /* page directory table */
@@ -134,8 +149,25 @@ struct rk_iommudata {
 	bool defer_attach;
 };
 
+enum rk_iommu_stat_type {
+	RK_IOMMU_STAT_MAP,
+	RK_IOMMU_STAT_UNMAP,
+	RK_IOMMU_STAT_SYNC_MAP,
+	RK_IOMMU_STAT_SYNC,
+	RK_IOMMU_STAT_NUM,
+};
+
+struct rk_iommu_stat {
+	atomic64_t count;
+	atomic64_t bytes;
+	atomic64_t total_ns;
+	atomic64_t max_ns;
+};
+
 static struct device *dma_dev;
 static const struct rk_iommu_ops *rk_ops;
+static struct rk_iommu_stat rk_iommu_stats[RK_IOMMU_STAT_NUM];
+static struct dentry *rk_iommu_debugfs;
 static struct rk_iommu *rk_iommu_from_dev(struct device *dev);
 static char reserve_range[PAGE_SIZE] __aligned(PAGE_SIZE);
 static phys_addr_t res_page;
@@ -377,10 +409,13 @@ static void rk_iommu_zap_lines(struct rk_iommu *iommu, dma_addr_t iova_start,
 {
 	int i;
 	dma_addr_t iova_end = iova_start + size;
-	/*
-	 * TODO(djkurtz): Figure out when it is more efficient to shootdown the
-	 * entire iotlb rather than iterate over individual iovas.
-	 */
+
+	/* Past a few hundred lines a full shootdown is cheaper */
+	if (size / SPAGE_SIZE > RK_IOMMU_ZAP_LINES_MAX) {
+		rk_iommu_command(iommu, RK_MMU_CMD_ZAP_CACHE);
+		return;
+	}
+
 	for (i = 0; i < iommu->num_mmu; i++) {
 		dma_addr_t iova;
 
@@ -389,6 +424,25 @@ static void rk_iommu_zap_lines(struct rk_iommu *iommu, dma_addr_t iova_start,
 	}
 }
 
+static void rk_iommu_stat_add(enum rk_iommu_stat_type type, size_t bytes,
+			      ktime_t start)
+{
+	struct rk_iommu_stat *stat = &rk_iommu_stats[type];
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	s64 max = atomic64_read(&stat->max_ns);
+
+	atomic64_inc(&stat->count);
+	atomic64_add(bytes, &stat->bytes);
+	atomic64_add(ns, &stat->total_ns);
+	while (ns > max) {
+		s64 old = atomic64_cmpxchg(&stat->max_ns, max, ns);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
 static bool rk_iommu_is_stall_active(struct rk_iommu *iommu)
 {
 	bool active = true;
@@ -975,14 +1029,6 @@ static int rk_iommu_map_iova(struct rk_iommu_domain *rk_domain, u32 *pte_addr,
 
 	rk_table_flush(rk_domain, pte_dma, pte_total);
 
-	/*
-	 * Zap the first and last iova to evict from iotlb any previously
-	 * mapped cachelines holding stale values for its dte and pte.
-	 * We only zap the first and last iova, since only they could have
-	 * dte or pte shared with an existing mapping.
-	 */
-	rk_iommu_zap_iova_first_last(rk_domain, iova, size);
-
 	return 0;
 unwind:
 	/* Unmap the range of iovas that we just mapped */
@@ -997,83 +1043,163 @@ unwind:
 	return -EADDRINUSE;
 }
 
-static int rk_iommu_map(struct iommu_domain *domain, unsigned long _iova,
-			phys_addr_t paddr, size_t size, int prot, gfp_t gfp)
+/*
+ * Map size bytes at iova, which must not cross a page table. Called with
+ * dt_lock held, the iotlb is left to rk_iommu_iotlb_sync_map().
+ */
+static int rk_iommu_map_pt(struct rk_iommu_domain *rk_domain, dma_addr_t iova,
+			   phys_addr_t paddr, size_t size, int prot)
 {
-	struct rk_iommu_domain *rk_domain = to_rk_domain(domain);
-	unsigned long flags;
-	dma_addr_t pte_dma, iova = (dma_addr_t)_iova;
+	dma_addr_t pte_dma;
 	u32 *page_table, *pte_addr;
 	u32 dte, pte_index;
-	int ret;
 
-	spin_lock_irqsave(&rk_domain->dt_lock, flags);
-
-	/*
-	 * pgsize_bitmap specifies iova sizes that fit in one page table
-	 * (1024 4-KiB pages = 4 MiB).
-	 * So, size will always be 4096 <= size <= 4194304.
-	 * Since iommu_map() guarantees that both iova and size will be
-	 * aligned, we will always only be mapping from a single dte here.
-	 */
 	page_table = rk_dte_get_page_table(rk_domain, iova);
-	if (IS_ERR(page_table)) {
-		spin_unlock_irqrestore(&rk_domain->dt_lock, flags);
+	if (IS_ERR(page_table))
 		return PTR_ERR(page_table);
-	}
 
 	dte = rk_domain->dt[rk_iova_dte_index(iova)];
 	pte_index = rk_iova_pte_index(iova);
 	pte_addr = &page_table[pte_index];
 	pte_dma = rk_ops->pt_address(dte) + pte_index * sizeof(u32);
-	ret = rk_iommu_map_iova(rk_domain, pte_addr, pte_dma, iova,
-				paddr, size, prot);
 
+	return rk_iommu_map_iova(rk_domain, pte_addr, pte_dma, iova,
+				 paddr, size, prot);
+}
+
+static int rk_iommu_map_pages(struct iommu_domain *domain, unsigned long _iova,
+			      phys_addr_t paddr, size_t pgsize, size_t pgcount,
+			      int prot, gfp_t gfp, size_t *mapped)
+{
+	struct rk_iommu_domain *rk_domain = to_rk_domain(domain);
+	dma_addr_t iova = (dma_addr_t)_iova;
+	size_t size = pgsize * pgcount;
+	ktime_t start = ktime_get();
+	unsigned long flags;
+	int ret = 0;
+
+	*mapped = 0;
+
+	/*
+	 * Walk the range one page table at a time, so a large buffer costs a
+	 * single lock round trip and one table flush per 4 MiB.
+	 */
+	spin_lock_irqsave(&rk_domain->dt_lock, flags);
+	while (*mapped < size) {
+		size_t len = min_t(size_t, size - *mapped, RK_IOMMU_PT_SPAN -
+				   (iova & (RK_IOMMU_PT_SPAN - 1)));
+
+		ret = rk_iommu_map_pt(rk_domain, iova, paddr, len, prot);
+		if (ret)
+			break;
+
+		iova += len;
+		paddr += len;
+		*mapped += len;
+	}
 	spin_unlock_irqrestore(&rk_domain->dt_lock, flags);
 
+	rk_iommu_stat_add(RK_IOMMU_STAT_MAP, *mapped, start);
+
 	return ret;
 }
 
-static size_t rk_iommu_unmap(struct iommu_domain *domain, unsigned long _iova,
-			     size_t size, struct iommu_iotlb_gather *gather)
+/*
+ * Zap the first and last iova to evict from iotlb any previously mapped
+ * cachelines holding stale values for its dte and pte. We only zap the first
+ * and last iova, since only they could have dte or pte shared with an
+ * existing mapping. The iommu core calls this once per iommu_map() or
+ * iommu_map_sg(), so a whole buffer gets two zaps.
+ */
+static void rk_iommu_iotlb_sync_map(struct iommu_domain *domain,
+				    unsigned long iova, size_t size)
+{
+	ktime_t start = ktime_get();
+
+	if (!size)
+		return;
+
+	rk_iommu_zap_iova_first_last(to_rk_domain(domain), iova, size);
+	rk_iommu_stat_add(RK_IOMMU_STAT_SYNC_MAP, size, start);
+}
+
+static void rk_iommu_gather_add(struct iommu_domain *domain,
+				struct iommu_iotlb_gather *gather,
+				unsigned long iova, size_t size)
+{
+	unsigned long end = iova + size - 1;
+
+	/* The lines are zapped by 4 KiB whatever the page size unmapped */
+	if (gather->pgsize &&
+	    (end + 1 < gather->start || iova > gather->end + 1))
+		iommu_iotlb_sync(domain, gather);
+
+	gather->pgsize = SPAGE_SIZE;
+	if (gather->start > iova)
+		gather->start = iova;
+	if (gather->end < end)
+		gather->end = end;
+}
+
+static size_t rk_iommu_unmap_pages(struct iommu_domain *domain,
+				   unsigned long _iova, size_t pgsize,
+				   size_t pgcount,
+				   struct iommu_iotlb_gather *gather)
 {
 	struct rk_iommu_domain *rk_domain = to_rk_domain(domain);
-	unsigned long flags;
 	dma_addr_t pte_dma, iova = (dma_addr_t)_iova;
+	size_t size = pgsize * pgcount, unmapped = 0;
+	ktime_t start = ktime_get();
+	unsigned long flags;
 	phys_addr_t pt_phys;
 	u32 dte;
 	u32 *pte_addr;
-	size_t unmap_size;
 	struct rk_iommu *iommu = rk_iommu_get(rk_domain);
 
 	spin_lock_irqsave(&rk_domain->dt_lock, flags);
+	while (unmapped < size) {
+		size_t len = min_t(size_t, size - unmapped, RK_IOMMU_PT_SPAN -
+				   (iova & (RK_IOMMU_PT_SPAN - 1)));
+		size_t unmap_size;
+
+		/* Stop at the first hole, as iommu_unmap() expects */
+		dte = rk_domain->dt[rk_iova_dte_index(iova)];
+		if (!rk_dte_is_pt_valid(dte))
+			break;
 
-	/*
-	 * pgsize_bitmap specifies iova sizes that fit in one page table
-	 * (1024 4-KiB pages = 4 MiB).
-	 * So, size will always be 4096 <= size <= 4194304.
-	 * Since iommu_unmap() guarantees that both iova and size will be
-	 * aligned, we will always only be unmapping from a single dte here.
-	 */
-	dte = rk_domain->dt[rk_iova_dte_index(iova)];
-	/* Just return 0 if iova is unmapped */
-	if (!rk_dte_is_pt_valid(dte)) {
-		spin_unlock_irqrestore(&rk_domain->dt_lock, flags);
-		return 0;
+		pt_phys = rk_ops->pt_address(dte);
+		pte_addr = (u32 *)phys_to_virt(pt_phys) + rk_iova_pte_index(iova);
+		pte_dma = pt_phys + rk_iova_pte_index(iova) * sizeof(u32);
+		unmap_size = rk_iommu_unmap_iova(rk_domain, pte_addr, pte_dma,
+						 len, iommu);
+		iova += unmap_size;
+		unmapped += unmap_size;
+		if (unmap_size < len)
+			break;
 	}
+	spin_unlock_irqrestore(&rk_domain->dt_lock, flags);
 
-	pt_phys = rk_ops->pt_address(dte);
-	pte_addr = (u32 *)phys_to_virt(pt_phys) + rk_iova_pte_index(iova);
-	pte_dma = pt_phys + rk_iova_pte_index(iova) * sizeof(u32);
-	unmap_size = rk_iommu_unmap_iova(rk_domain, pte_addr, pte_dma, size,
-					 iommu);
+	/* The iotlb is shot down by rk_iommu_iotlb_sync() */
+	if (unmapped)
+		rk_iommu_gather_add(domain, gather, _iova, unmapped);
 
-	spin_unlock_irqrestore(&rk_domain->dt_lock, flags);
+	rk_iommu_stat_add(RK_IOMMU_STAT_UNMAP, unmapped, start);
 
-	/* Shootdown iotlb entries for iova range that was just unmapped */
-	rk_iommu_zap_iova(rk_domain, iova, unmap_size);
+	return unmapped;
+}
+
+static void rk_iommu_iotlb_sync(struct iommu_domain *domain,
+				struct iommu_iotlb_gather *gather)
+{
+	ktime_t start = ktime_get();
+	size_t size;
+
+	if (!gather->pgsize)
+		return;
 
-	return unmap_size;
+	size = gather->end - gather->start + 1;
+	rk_iommu_zap_iova(to_rk_domain(domain), gather->start, size);
+	rk_iommu_stat_add(RK_IOMMU_STAT_SYNC, size, start);
 }
 
 static void rk_iommu_flush_tlb_all(struct iommu_domain *domain)
@@ -1504,9 +1630,11 @@ static const struct iommu_ops rk_iommu_ops = {
 	.domain_free = rk_iommu_domain_free,
 	.attach_dev = rk_iommu_attach_device,
 	.detach_dev = rk_iommu_detach_device,
-	.map = rk_iommu_map,
-	.unmap = rk_iommu_unmap,
+	.map_pages = rk_iommu_map_pages,
+	.unmap_pages = rk_iommu_unmap_pages,
 	.flush_iotlb_all = rk_iommu_flush_tlb_all,
+	.iotlb_sync_map = rk_iommu_iotlb_sync_map,
+	.iotlb_sync = rk_iommu_iotlb_sync,
 	.probe_device = rk_iommu_probe_device,
 	.release_device = rk_iommu_release_device,
 	.iova_to_phys = rk_iommu_iova_to_phys,
@@ -1516,6 +1644,33 @@ static const struct iommu_ops rk_iommu_ops = {
 	.of_xlate = rk_iommu_of_xlate,
 };
 
+static int rk_iommu_stats_show(struct seq_file *s, void *unused)
+{
+	static const char * const names[RK_IOMMU_STAT_NUM] = {
+		[RK_IOMMU_STAT_MAP] = "map",
+		[RK_IOMMU_STAT_UNMAP] = "unmap",
+		[RK_IOMMU_STAT_SYNC_MAP] = "sync_map",
+		[RK_IOMMU_STAT_SYNC] = "sync",
+	};
+	int i;
+
+	seq_printf(s, "%-10s %12s %14s %12s %10s\n",
+		   "op", "count", "bytes", "avg_ns", "max_ns");
+	for (i = 0; i < RK_IOMMU_STAT_NUM; i++) {
+		struct rk_iommu_stat *stat = &rk_iommu_stats[i];
+		u64 count = atomic64_read(&stat->count);
+		u64 total = atomic64_read(&stat->total_ns);
+
+		seq_printf(s, "%-10s %12llu %14llu %12llu %10lld\n", names[i],
+			   count, (u64)atomic64_read(&stat->bytes),
+			   count ? div64_u64(total, count) : 0,
+			   atomic64_read(&stat->max_ns));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(rk_iommu_stats);
+
 static int rk_iommu_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -1626,6 +1781,12 @@ static int rk_iommu_probe(struct platform_device *pdev)
 	if (!dma_dev)
 		dma_dev = &pdev->dev;
 
+	if (!rk_iommu_debugfs) {
+		rk_iommu_debugfs = debugfs_create_dir("rockchip_iommu", NULL);
+		debugfs_create_file("stats", 0444, rk_iommu_debugfs, NULL,
+				    &rk_iommu_stats_fops);
+	}
+
 	bus_set_iommu(&platform_bus_type, &rk_iommu_ops);
 
 	pm_runtime_enable(dev);
@@ -7,6 +7,7 @@
 #include <linux/module.h>
 #include <linux/mm.h>
 #include <linux/refcount.h>
+#include <linux/dma-buf-cache.h>
 #include <linux/rk-dma-heap.h>
 #include <linux/scatterlist.h>
 #include <linux/sched.h>
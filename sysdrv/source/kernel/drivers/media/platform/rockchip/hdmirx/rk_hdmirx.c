@@ -10,8 +10,10 @@
 #include <linux/cpufreq.h>
 #include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/dma-fence.h>
 #include <linux/dma-mapping.h>
 #include <linux/extcon-provider.h>
+#include <linux/file.h>
 #include <linux/fs.h>
 #include <linux/gpio/consumer.h>
 #include <linux/interrupt.h>
@@ -30,6 +32,8 @@
 #include <linux/rk_hdmirx_config.h>
 #include <linux/rockchip/rockchip_sip.h>
 #include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sync_file.h>
 #include <linux/v4l2-dv-timings.h>
 #include <linux/workqueue.h>
 #include <media/cec.h>
@@ -148,6 +152,7 @@ struct hdmirx_buffer {
 		u32 buff_addr[VIDEO_MAX_PLANES];
 		void *vaddr[VIDEO_MAX_PLANES];
 	};
+	struct dma_fence *fence;
 };
 
 struct hdmirx_output_fmt {
@@ -173,6 +178,11 @@ struct hdmirx_stream {
 	u32 frame_idx;
 	u32 line_flag_int_cnt;
 	u32 irq_stat;
+	u32 line_flag;
+	u32 line_flag_num;
+	u64 fence_context;
+	unsigned int fence_seqno;
+	spinlock_t fence_lock;
 };
 
 struct rk_hdmirx_dev {
@@ -468,6 +478,8 @@ static int hdmirx_subscribe_event(struct v4l2_fh *fh,
 		return v4l2_ctrl_subscribe_event(fh, sub);
 	case RK_HDMIRX_V4L2_EVENT_SIGNAL_LOST:
 		return v4l2_event_subscribe(fh, sub, 0, NULL);
+	case RK_HDMIRX_V4L2_EVENT_LINE_FLAG:
+		return v4l2_event_subscribe(fh, sub, 4, NULL);
 
 	default:
 		return v4l2_ctrl_subscribe_event(fh, sub);
@@ -1892,6 +1904,93 @@ static int hdmirx_queue_setup(struct vb2_queue *queue,
 	return 0;
 }
 
+static const char *hdmirx_fence_get_name(struct dma_fence *fence)
+{
+	return "rk_hdmirx";
+}
+
+static const struct dma_fence_ops hdmirx_fence_ops = {
+	.get_driver_name = hdmirx_fence_get_name,
+	.get_timeline_name = hdmirx_fence_get_name,
+};
+
+/*
+ * Signal the fence of a buffer leaving the driver, may be called from the
+ * DMA interrupt.
+ */
+static void hdmirx_buf_signal(struct hdmirx_stream *stream,
+			      struct hdmirx_buffer *buf, int error)
+{
+	struct dma_fence *fence;
+	unsigned long flags;
+
+	spin_lock_irqsave(&stream->vbq_lock, flags);
+	fence = buf->fence;
+	buf->fence = NULL;
+	spin_unlock_irqrestore(&stream->vbq_lock, flags);
+
+	if (!fence)
+		return;
+
+	if (error)
+		dma_fence_set_error(fence, error);
+	dma_fence_signal(fence);
+	dma_fence_put(fence);
+}
+
+/*
+ * Hand out a sync_file for a queued buffer, so that RGA or the encoder can
+ * be given the job before the frame is dequeued.
+ */
+static int hdmirx_get_buf_fence(struct hdmirx_stream *stream,
+				struct rk_hdmirx_fence *req)
+{
+	struct hdmirx_buffer *buf, *found = NULL;
+	struct dma_fence *fence = NULL;
+	struct sync_file *sync_file;
+	unsigned long flags;
+	int fd;
+
+	spin_lock_irqsave(&stream->vbq_lock, flags);
+	if (stream->curr_buf && stream->curr_buf->vb.vb2_buf.index == req->index)
+		found = stream->curr_buf;
+	else if (stream->next_buf &&
+		 stream->next_buf->vb.vb2_buf.index == req->index)
+		found = stream->next_buf;
+	else {
+		list_for_each_entry(buf, &stream->buf_head, queue) {
+			if (buf->vb.vb2_buf.index == req->index) {
+				found = buf;
+				break;
+			}
+		}
+	}
+	if (found && found->fence)
+		fence = dma_fence_get(found->fence);
+	spin_unlock_irqrestore(&stream->vbq_lock, flags);
+
+	if (!fence)
+		return -ENOENT;
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		dma_fence_put(fence);
+		return fd;
+	}
+
+	sync_file = sync_file_create(fence);
+	dma_fence_put(fence);
+	if (!sync_file) {
+		put_unused_fd(fd);
+		return -ENOMEM;
+	}
+
+	fd_install(fd, sync_file->file);
+	req->fd = fd;
+
+	return 0;
+}
+
 /*
  * The vb2_buffer are stored in hdmirx_buffer, in order to unify
  * mplane buffer and none-mplane buffer.
@@ -1940,6 +2039,12 @@ static void hdmirx_buf_queue(struct vb2_buffer *vb)
 		}
 	}
 
+	hdmirx_buf->fence = kzalloc(sizeof(*hdmirx_buf->fence), GFP_KERNEL);
+	if (hdmirx_buf->fence)
+		dma_fence_init(hdmirx_buf->fence, &hdmirx_fence_ops,
+			       &stream->fence_lock, stream->fence_context,
+			       ++stream->fence_seqno);
+
 	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
 	list_add_tail(&hdmirx_buf->queue, &stream->buf_head);
 	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
@@ -1964,6 +2069,7 @@ static void return_all_buffers(struct hdmirx_stream *stream,
 				       struct hdmirx_buffer, queue);
 		list_del(&buf->queue);
 		spin_unlock_irqrestore(&stream->vbq_lock, flags);
+		hdmirx_buf_signal(stream, buf, -ECANCELED);
 		vb2_buffer_done(&buf->vb.vb2_buf, state);
 		spin_lock_irqsave(&stream->vbq_lock, flags);
 	}
@@ -2060,8 +2166,11 @@ static int hdmirx_start_streaming(struct vb2_queue *queue, unsigned int count)
 	if (bt->height) {
 		if (bt->interlaced == V4L2_DV_INTERLACED)
 			line_flag = bt->height / 4;
+		else if (stream->line_flag && stream->line_flag < bt->height)
+			line_flag = stream->line_flag;
 		else
 			line_flag = bt->height / 2;
+		stream->line_flag_num = line_flag;
 		hdmirx_update_bits(hdmirx_dev, DMA_CONFIG7,
 				LINE_FLAG_NUM_MASK,
 				LINE_FLAG_NUM(line_flag));
@@ -2180,6 +2289,16 @@ static long hdmirx_ioctl_default(struct file *file, void *fh,
 		hdmirx_get_color_space(hdmirx_dev);
 		*(int *)arg = hdmirx_dev->cur_color_space;
 		break;
+	case RK_HDMIRX_CMD_SET_LINE_FLAG:
+		/* takes effect at the next stream on */
+		if (*(int *)arg < 0)
+			ret = -EINVAL;
+		else
+			stream->line_flag = *(int *)arg;
+		break;
+	case RK_HDMIRX_CMD_GET_BUF_FENCE:
+		ret = hdmirx_get_buf_fence(stream, arg);
+		break;
 
 	default:
 		ret = -EINVAL;
@@ -2276,6 +2395,8 @@ static int hdmirx_register_stream_vdev(struct hdmirx_stream *stream)
 	strscpy(vdev->name, vdev_name, sizeof(vdev->name));
 	INIT_LIST_HEAD(&stream->buf_head);
 	spin_lock_init(&stream->vbq_lock);
+	spin_lock_init(&stream->fence_lock);
+	stream->fence_context = dma_fence_context_alloc(1);
 	mutex_init(&stream->vlock);
 	init_waitqueue_head(&stream->wq_stopped);
 	stream->curr_buf = NULL;
@@ -2546,6 +2667,8 @@ static void hdmirx_vb_done(struct hdmirx_stream *stream,
 	const struct hdmirx_output_fmt *fmt = stream->out_fmt;
 	u32 i;
 
+	hdmirx_buf_signal(stream, to_hdmirx_buffer(vb_done), 0);
+
 	/* Dequeue a filled buffer */
 	for (i = 0; i < fmt->mplanes; i++) {
 		vb2_set_plane_payload(&vb_done->vb2_buf, i,
@@ -2622,6 +2745,20 @@ static void line_flag_int_handler(struct rk_hdmirx_dev *hdmirx_dev, bool *handle
 	if (stream->line_flag_int_cnt <= FILTER_FRAME_CNT)
 		goto LINE_FLAG_OUT;
 
+	/* the first line_flag_num lines of curr_buf are in memory */
+	if (bt->interlaced != V4L2_DV_INTERLACED && stream->curr_buf) {
+		struct v4l2_event ev = {
+			.type = RK_HDMIRX_V4L2_EVENT_LINE_FLAG,
+		};
+		struct rk_hdmirx_line_event *line_ev = (void *)ev.u.data;
+
+		line_ev->sequence = stream->frame_idx;
+		line_ev->index = stream->curr_buf->vb.vb2_buf.index;
+		line_ev->line = stream->line_flag_num;
+		line_ev->height = bt->height;
+		v4l2_event_queue(&stream->vdev, &ev);
+	}
+
 	if ((bt->interlaced != V4L2_DV_INTERLACED) ||
 			(stream->line_flag_int_cnt % 2 == 0)) {
 		if (!stream->next_buf) {
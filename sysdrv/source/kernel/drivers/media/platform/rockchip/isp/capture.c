@@ -13,9 +13,14 @@
 #include "regs.h"
 #include "rkisp_tb_helper.h"
 
+#define CREATE_TRACE_POINTS
+#include "rkisp_trace.h"
+
 #define STREAM_MIN_MP_SP_INPUT_WIDTH		STREAM_MIN_RSZ_OUTPUT_WIDTH
 #define STREAM_MIN_MP_SP_INPUT_HEIGHT		STREAM_MIN_RSZ_OUTPUT_HEIGHT
 
+#define RKISP_SLICE_EVENT_ELEMS			8
+
 static int hdr_dma_frame(struct rkisp_device *dev)
 {
 	int max_dma;
@@ -426,6 +431,81 @@ int rkisp_mbus_code_xysubs(u32 code, u32 *xsubs, u32 *ysubs)
 	return 0;
 }
 
+/* slice events done for this frame or stream off, mask line interrupt */
+void rkisp_stream_slice_stop(struct rkisp_device *dev)
+{
+	struct rkisp_capture_device *cap = &dev->cap_dev;
+
+	if (!cap->slice_next)
+		return;
+	cap->slice_next = 0;
+	if (!cap->wait_line)
+		rkisp_clear_bits(dev, CIF_ISP_IMSC, ISP3X_OUT_FRM_HALF, true);
+}
+
+/*
+ * Arm isp output line interrupt for the first slice of frame.
+ * It shares the line interrupt with wait-line, so only one of
+ * them and only one stream can work at a time.
+ */
+static void rkisp_stream_slice_start(struct rkisp_device *dev)
+{
+	struct rkisp_capture_device *cap = &dev->cap_dev;
+	struct rkisp_stream *stream = cap->slice_stream;
+	u32 h = dev->isp_sdev.out_crop.height;
+
+	rkisp_stream_slice_stop(dev);
+	if (!stream || !stream->streaming || stream->stopping ||
+	    cap->is_done_early || !stream->out_fmt.height)
+		return;
+
+	/* stream lines to isp output lines, stream maybe scaled */
+	cap->slice_step = DIV_ROUND_UP(stream->slice_line * h,
+				       stream->out_fmt.height);
+	if (!cap->slice_step || cap->slice_step >= h)
+		return;
+	cap->slice_next = cap->slice_step;
+	rkisp_write(dev, ISP32_ISP_IRQ_CFG0, cap->slice_next << 16, true);
+	rkisp_set_bits(dev, CIF_ISP_IMSC, 0, ISP3X_OUT_FRM_HALF, true);
+}
+
+void rkisp_stream_slice_ready(struct rkisp_device *dev)
+{
+	struct rkisp_capture_device *cap = &dev->cap_dev;
+	struct rkisp_stream *stream = cap->slice_stream;
+	struct rkisp_slice_info *info;
+	struct v4l2_event ev = {
+		.type = RKISP_V4L2_EVENT_SLICE_READY,
+	};
+	unsigned long lock_flags = 0;
+	u32 h = dev->isp_sdev.out_crop.height;
+	u32 seq;
+
+	if (!cap->slice_next)
+		return;
+	if (!stream || !stream->streaming) {
+		rkisp_stream_slice_stop(dev);
+		return;
+	}
+
+	info = (struct rkisp_slice_info *)ev.u.data;
+	rkisp_dmarx_get_frame(dev, &seq, NULL, NULL, true);
+	info->sequence = seq;
+	info->height = stream->out_fmt.height;
+	info->line = min_t(u32, info->height,
+			   cap->slice_next * info->height / h);
+	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+	info->index = stream->curr_buf ? stream->curr_buf->vb.vb2_buf.index : -1;
+	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+	v4l2_event_queue(&stream->vnode.vdev, &ev);
+
+	cap->slice_next += cap->slice_step;
+	if (cap->slice_next < h)
+		rkisp_write(dev, ISP32_ISP_IRQ_CFG0, cap->slice_next << 16, true);
+	else
+		rkisp_stream_slice_stop(dev);
+}
+
 int rkisp_stream_frame_start(struct rkisp_device *dev, u32 isp_mis)
 {
 	struct rkisp_stream *stream;
@@ -434,6 +514,8 @@ int rkisp_stream_frame_start(struct rkisp_device *dev, u32 isp_mis)
 	if (isp_mis)
 		rkisp_dvbm_event(dev, CIF_ISP_V_START);
 	rkisp_bridge_update_mi(dev, isp_mis);
+	if (dev->isp_ver == ISP_V32)
+		rkisp_stream_slice_start(dev);
 
 	for (i = 0; i < RKISP_MAX_STREAM; i++) {
 		if (i == RKISP_STREAM_VIR || i == RKISP_STREAM_LUMA)
@@ -1172,6 +1254,73 @@ static int rkisp_set_wrap_line(struct rkisp_stream *stream, struct rkisp_wrap_in
 	return stream->ops->set_wrap(stream, arg->height);
 }
 
+static int rkisp_get_slice_line(struct rkisp_stream *stream, int *line)
+{
+	if (stream->ispdev->isp_ver != ISP_V32)
+		return -EINVAL;
+
+	*line = stream->slice_line;
+	return 0;
+}
+
+static int rkisp_set_slice_line(struct rkisp_stream *stream, int *line)
+{
+	struct rkisp_device *dev = stream->ispdev;
+	struct rkisp_capture_device *cap = &dev->cap_dev;
+
+	if (dev->isp_ver != ISP_V32 ||
+	    (stream->id != RKISP_STREAM_MP &&
+	     stream->id != RKISP_STREAM_SP &&
+	     stream->id != RKISP_STREAM_BP) || *line < 0)
+		return -EINVAL;
+	if (stream->streaming)
+		return -EBUSY;
+	if (*line && cap->wait_line) {
+		v4l2_err(&dev->v4l2_dev, "slice event conflict with wait-line\n");
+		return -EBUSY;
+	}
+	if (*line && cap->slice_stream && cap->slice_stream != stream) {
+		v4l2_err(&dev->v4l2_dev, "slice event already for %s\n",
+			 cap->slice_stream->vnode.vdev.name);
+		return -EBUSY;
+	}
+
+	stream->slice_line = *line;
+	if (*line)
+		cap->slice_stream = stream;
+	else if (cap->slice_stream == stream)
+		cap->slice_stream = NULL;
+	return 0;
+}
+
+static int rkisp_get_starve_policy(struct rkisp_stream *stream, int *policy)
+{
+	struct rkisp_device *dev = stream->ispdev;
+
+	if (dev->isp_ver != ISP_V32 && dev->isp_ver != ISP_V32_L)
+		return -EINVAL;
+
+	*policy = stream->starve_policy;
+	return 0;
+}
+
+static int rkisp_set_starve_policy(struct rkisp_stream *stream, int *policy)
+{
+	struct rkisp_device *dev = stream->ispdev;
+
+	if ((dev->isp_ver != ISP_V32 && dev->isp_ver != ISP_V32_L) ||
+	    (stream->id != RKISP_STREAM_MP &&
+	     stream->id != RKISP_STREAM_SP &&
+	     stream->id != RKISP_STREAM_BP) ||
+	    *policy < RKISP_STARVE_GATE || *policy > RKISP_STARVE_DUMMY)
+		return -EINVAL;
+	if (stream->streaming)
+		return -EBUSY;
+
+	stream->starve_policy = *policy;
+	return 0;
+}
+
 static int rkisp_set_fps(struct rkisp_stream *stream, int *fps)
 {
 	struct rkisp_device *dev = stream->ispdev;
@@ -1315,6 +1464,27 @@ static long rkisp_ioctl_default(struct file *file, void *fh,
 	case RKISP_CMD_SET_IQTOOL_CONN_ID:
 		ret = rkisp_set_iqtool_connect_id(stream, *(int *)arg);
 		break;
+	case RKISP_CMD_GET_SLICE_LINE:
+		ret = rkisp_get_slice_line(stream, arg);
+		break;
+	case RKISP_CMD_SET_SLICE_LINE:
+		ret = rkisp_set_slice_line(stream, arg);
+		break;
+	case RKISP_CMD_SET_SHARE_BUF_NUM:
+		ret = rkisp_rockit_share_set(stream, *(int *)arg);
+		break;
+	case RKISP_CMD_SHARE_DQBUF:
+		ret = rkisp_rockit_share_dqbuf(stream, arg);
+		break;
+	case RKISP_CMD_SHARE_QBUF:
+		ret = rkisp_rockit_share_qbuf(stream, arg);
+		break;
+	case RKISP_CMD_GET_STARVE_POLICY:
+		ret = rkisp_get_starve_policy(stream, arg);
+		break;
+	case RKISP_CMD_SET_STARVE_POLICY:
+		ret = rkisp_set_starve_policy(stream, arg);
+		break;
 	default:
 		ret = -EINVAL;
 	}
@@ -1575,6 +1745,16 @@ static int rkisp_querycap(struct file *file, void *priv,
 	return 0;
 }
 
+static int rkisp_subscribe_event(struct v4l2_fh *fh,
+				 const struct v4l2_event_subscription *sub)
+{
+	if (sub->type != RKISP_V4L2_EVENT_SLICE_READY &&
+	    sub->type != RKISP_V4L2_EVENT_SHARE_READY)
+		return -EINVAL;
+
+	return v4l2_event_subscribe(fh, sub, RKISP_SLICE_EVENT_ELEMS, NULL);
+}
+
 static const struct v4l2_ioctl_ops rkisp_v4l2_ioctl_ops = {
 	.vidioc_reqbufs = vb2_ioctl_reqbufs,
 	.vidioc_querybuf = vb2_ioctl_querybuf,
@@ -1595,6 +1775,8 @@ static const struct v4l2_ioctl_ops rkisp_v4l2_ioctl_ops = {
 	.vidioc_querycap = rkisp_querycap,
 	.vidioc_enum_frameintervals = rkisp_enum_frameintervals,
 	.vidioc_enum_framesizes = rkisp_enum_framesizes,
+	.vidioc_subscribe_event = rkisp_subscribe_event,
+	.vidioc_unsubscribe_event = v4l2_event_unsubscribe,
 	.vidioc_default = rkisp_ioctl_default,
 };
 
@@ -1603,6 +1785,7 @@ static void rkisp_buf_done_task(unsigned long arg)
 	struct rkisp_stream *stream = (struct rkisp_stream *)arg;
 	struct rkisp_buffer *buf = NULL;
 	unsigned long lock_flags = 0;
+	u64 ns, lat;
 	LIST_HEAD(local_list);
 
 	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
@@ -1623,6 +1806,16 @@ static void rkisp_buf_done_task(unsigned long arg)
 			v4l2_dbg(0, rkisp_debug, &stream->ispdev->v4l2_dev,
 				 "seq:%d data no update:%llx %llx\n",
 				 buf->vb.sequence, *data, *(data + 1));
+		ns = rkisp_time_get_ns(stream->ispdev);
+		lat = 0;
+		if (buf->sof_ts) {
+			lat = ns - buf->sof_ts;
+			rkisp_latency_hist_add(stream->lat.sof_done, lat);
+			buf->sof_ts = 0;
+		}
+		buf->done_ts = stream->streaming ? ns : 0;
+		trace_rkisp_buf_done(stream->ispdev->dev_id, stream->id,
+				     buf->vb.sequence, ns, lat);
 		vb2_buffer_done(&buf->vb.vb2_buf,
 				stream->streaming ? VB2_BUF_STATE_DONE : VB2_BUF_STATE_ERROR);
 	}
@@ -293,9 +293,15 @@ struct rkisp_stream {
 	unsigned int burst;
 	atomic_t sequence;
 	struct frame_debug_info dbg;
+	struct rkisp_latency_hist lat;
 	int conn_id;
 	u32 memory;
 	u32 skip_frame;
+	u32 slice_line;
+	u32 starve_policy;
+	struct rkisp_starve_cnt starve_cnt;
+	struct rkisp_share share;
+	bool is_keep_buf;
 	union {
 		struct rkisp_stream_sp sp;
 		struct rkisp_stream_mp mp;
@@ -304,6 +310,55 @@ struct rkisp_stream {
 	} u;
 };
 
+/*
+ * struct rkisp_starve_cnt - frames absorbed by starve policy
+ * @gate: mi closed, no write
+ * @keep: last buffer rewritten
+ * @dummy: written to dummy buffer
+ */
+struct rkisp_starve_cnt {
+	u32 gate;
+	u32 keep;
+	u32 dummy;
+};
+
+/*
+ * struct rkisp_share - rockit buffers shared to v4l2 user
+ * @ready: buffers done by isp to dequeue
+ * @held: buffers dequeued by user
+ * @max: max buffers in ready and held, 0 to disable
+ * @cnt: buffers in ready and held
+ * @drop: frames no shared for max limit
+ */
+struct rkisp_share {
+	struct list_head ready;
+	struct list_head held;
+	u32 max;
+	u32 cnt;
+	u32 drop;
+};
+
+/* log2 buckets of microsecond, last one collects all the longer */
+#define RKISP_LAT_HIST_BUCKETS 20
+
+/*
+ * struct rkisp_latency_hist - per stream latency histogram
+ * @sof_done: frame start to vb2 buffer done
+ * @done_dqbuf: vb2 buffer done to userspace dequeue
+ */
+struct rkisp_latency_hist {
+	u32 sof_done[RKISP_LAT_HIST_BUCKETS];
+	u32 done_dqbuf[RKISP_LAT_HIST_BUCKETS];
+};
+
+static inline void rkisp_latency_hist_add(u32 *hist, u64 ns)
+{
+	u32 us = div_u64(ns, 1000);
+	u32 idx = us ? ilog2(us) + 1 : 0;
+
+	hist[min_t(u32, idx, RKISP_LAT_HIST_BUCKETS - 1)]++;
+}
+
 struct rkisp_vir_cpy {
 	struct work_struct work;
 	struct completion cmpl;
@@ -321,6 +376,10 @@ struct rkisp_capture_device {
 	u32 wait_line;
 	u32 wrap_width;
 	u32 wrap_line;
+	/* slice event, isp output line of next irq and irq step */
+	struct rkisp_stream *slice_stream;
+	u32 slice_next;
+	u32 slice_step;
 	bool is_done_early;
 	bool is_mirror;
 
@@ -332,6 +391,8 @@ extern struct stream_config rkisp_sp_stream_config;
 extern struct rockit_isp_ops rockit_isp_ops;
 
 void rkisp_stream_buf_done_early(struct rkisp_device *dev);
+void rkisp_stream_slice_ready(struct rkisp_device *dev);
+void rkisp_stream_slice_stop(struct rkisp_device *dev);
 void rkisp_stream_buf_done(struct rkisp_stream *stream,
 			   struct rkisp_buffer *buf);
 void rkisp_unregister_stream_vdev(struct rkisp_stream *stream);
@@ -12,6 +12,7 @@
 #include <media/videobuf2-dma-sg.h>
 #include "dev.h"
 #include "regs.h"
+#include "rkisp_trace.h"
 
 /*			ISP32
  *        |--mainpath----[wrap]--------->enc(or ddr)
@@ -1028,45 +1029,60 @@ static void update_mi(struct rkisp_stream *stream)
 	struct rkisp_device *dev = stream->ispdev;
 	struct rkisp_dummy_buffer *dummy_buf = &stream->dummy_buf;
 	struct v4l2_pix_format_mplane *out_fmt = &stream->out_fmt;
+	struct rkisp_buffer *buf = stream->next_buf;
 	u32 div = stream->out_isp_fmt.fourcc == V4L2_PIX_FMT_UYVY ? 1 : 2;
 	u32 val, reg;
 	bool is_cr_cfg = false;
 
-	if (dev->isp_ver == ISP_V32_L)
+	/*
+	 * isp32 lite always writes to the common dummy buf if there is one.
+	 * isp32 uses its wrap buf, else the common one only for starve dummy.
+	 */
+	if (dev->isp_ver == ISP_V32_L ||
+	    (!dummy_buf->mem_priv && stream->starve_policy == RKISP_STARVE_DUMMY))
 		dummy_buf = &dev->hw_dev->dummy_buf;
 	if (stream->id == RKISP_STREAM_MP || stream->id == RKISP_STREAM_SP)
 		is_cr_cfg = true;
 
-	if (stream->next_buf) {
+	/* no new buf, hw write to current buf again and it is held at frame end */
+	stream->is_keep_buf = false;
+	if (!buf && stream->curr_buf &&
+	    stream->starve_policy == RKISP_STARVE_KEEP &&
+	    dev->hw_dev->is_single && !dev->cap_dev.is_done_early) {
+		buf = stream->curr_buf;
+		stream->is_keep_buf = true;
+	}
+
+	if (buf) {
 		reg = stream->config->mi.y_base_ad_init;
-		val = stream->next_buf->buff_addr[RKISP_PLANE_Y];
+		val = buf->buff_addr[RKISP_PLANE_Y];
 		rkisp_write(dev, reg, val, false);
 
 		reg = stream->config->mi.cb_base_ad_init;
-		val = stream->next_buf->buff_addr[RKISP_PLANE_CB];
+		val = buf->buff_addr[RKISP_PLANE_CB];
 		rkisp_write(dev, reg, val, false);
 
 		if (is_cr_cfg) {
 			reg = stream->config->mi.cr_base_ad_init;
-			val = stream->next_buf->buff_addr[RKISP_PLANE_CR];
+			val = buf->buff_addr[RKISP_PLANE_CR];
 			rkisp_write(dev, reg, val, false);
 		}
 
 		if (dev->unite_div > ISP_UNITE_DIV1) {
 			/* right of image, or right top of image */
 			reg = stream->config->mi.y_base_ad_init;
-			val = stream->next_buf->buff_addr[RKISP_PLANE_Y];
+			val = buf->buff_addr[RKISP_PLANE_Y];
 			val += ((out_fmt->width / div) & ~0xf);
 			rkisp_idx_write(dev, reg, val, ISP_UNITE_RIGHT, false);
 
 			reg = stream->config->mi.cb_base_ad_init;
-			val = stream->next_buf->buff_addr[RKISP_PLANE_CB];
+			val = buf->buff_addr[RKISP_PLANE_CB];
 			val += ((out_fmt->width / div) & ~0xf);
 			rkisp_idx_write(dev, reg, val, ISP_UNITE_RIGHT, false);
 
 			if (is_cr_cfg) {
 				reg = stream->config->mi.cr_base_ad_init;
-				val = stream->next_buf->buff_addr[RKISP_PLANE_CR];
+				val = buf->buff_addr[RKISP_PLANE_CR];
 				val += ((out_fmt->width / div) & ~0xf);
 				rkisp_idx_write(dev, reg, val, ISP_UNITE_RIGHT, false);
 			}
@@ -1075,44 +1091,44 @@ static void update_mi(struct rkisp_stream *stream)
 		if (dev->unite_div == ISP_UNITE_DIV4) {
 			/* left bottom of image */
 			reg = stream->config->mi.y_base_ad_init;
-			val = stream->next_buf->buff_addr[RKISP_PLANE_Y];
+			val = buf->buff_addr[RKISP_PLANE_Y];
 			val += (out_fmt->plane_fmt[0].bytesperline * out_fmt->height / 2);
 			rkisp_idx_write(dev, reg, val, ISP_UNITE_LEFT_B, false);
 
 			reg = stream->config->mi.cb_base_ad_init;
-			val = stream->next_buf->buff_addr[RKISP_PLANE_CB];
+			val = buf->buff_addr[RKISP_PLANE_CB];
 			val += (out_fmt->plane_fmt[1].sizeimage / 2);
 			rkisp_idx_write(dev, reg, val, ISP_UNITE_LEFT_B, false);
 
 			if (is_cr_cfg) {
 				reg = stream->config->mi.cr_base_ad_init;
-				val = stream->next_buf->buff_addr[RKISP_PLANE_CR];
+				val = buf->buff_addr[RKISP_PLANE_CR];
 				val += (out_fmt->plane_fmt[2].sizeimage / 2);
 				rkisp_idx_write(dev, reg, val, ISP_UNITE_LEFT_B, false);
 			}
 			/* right bottom of image */
 			reg = stream->config->mi.y_base_ad_init;
-			val = stream->next_buf->buff_addr[RKISP_PLANE_Y];
+			val = buf->buff_addr[RKISP_PLANE_Y];
 			val += (out_fmt->plane_fmt[0].bytesperline * out_fmt->height / 2) +
 			       ((out_fmt->width / div) & ~0xf);
 			rkisp_idx_write(dev, reg, val, ISP_UNITE_RIGHT_B, false);
 
 			reg = stream->config->mi.cb_base_ad_init;
-			val = stream->next_buf->buff_addr[RKISP_PLANE_CB];
+			val = buf->buff_addr[RKISP_PLANE_CB];
 			val += (out_fmt->plane_fmt[1].sizeimage / 2) +
 			       ((out_fmt->width / div) & ~0xf);
 			rkisp_idx_write(dev, reg, val, ISP_UNITE_RIGHT_B, false);
 
 			if (is_cr_cfg) {
 				reg = stream->config->mi.cr_base_ad_init;
-				val = stream->next_buf->buff_addr[RKISP_PLANE_CR];
+				val = buf->buff_addr[RKISP_PLANE_CR];
 				val += (out_fmt->plane_fmt[2].sizeimage / 2) +
 				       ((out_fmt->width / div) & ~0xf);
 				rkisp_idx_write(dev, reg, val, ISP_UNITE_RIGHT_B, false);
 			}
 		}
 
-		if (stream->is_pause) {
+		if (stream->is_pause && stream->next_buf) {
 			/* single sensor mode with pingpong buffer:
 			 * if mi on, addr will auto update at frame end
 			 * else addr need update by SELF_UPD.
@@ -1149,7 +1165,7 @@ static void update_mi(struct rkisp_stream *stream)
 		}
 
 		/* single buf force updated at readback for multidevice */
-		if (!dev->hw_dev->is_single) {
+		if (!dev->hw_dev->is_single && stream->next_buf) {
 			stream->curr_buf = stream->next_buf;
 			stream->next_buf = NULL;
 		}
@@ -1445,8 +1461,10 @@ static int mi_frame_start(struct rkisp_stream *stream, u32 mis)
 			}
 		}
 		/* check frame loss */
-		if (stream->ops->is_stream_stopped(stream))
+		if (stream->ops->is_stream_stopped(stream)) {
 			stream->dbg.frameloss++;
+			stream->starve_cnt.gate++;
+		}
 	}
 	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
 
@@ -1464,6 +1482,7 @@ static int mi_frame_end(struct rkisp_stream *stream, u32 state)
 	struct capture_fmt *isp_fmt = &stream->out_isp_fmt;
 	unsigned long lock_flags = 0;
 	struct rkisp_buffer *buf = NULL;
+	bool is_keep = false;
 	u32 i;
 
 	/* STREAM_VIR or STREAM_MP wrap buf from rockit */
@@ -1490,6 +1509,17 @@ static int mi_frame_end(struct rkisp_stream *stream, u32 state)
 			goto end;
 	} else {
 		buf = stream->curr_buf;
+		if (!buf && stream->streaming &&
+		    stream->starve_policy == RKISP_STARVE_DUMMY)
+			stream->starve_cnt.dummy++;
+	}
+
+	/* hw is writing the buf again for next frame, hold it and drop this frame */
+	if (buf && stream->is_keep_buf) {
+		is_keep = true;
+		stream->starve_cnt.keep++;
+		stream->dbg.frameloss++;
+		goto end;
 	}
 
 	if (buf) {
@@ -1522,6 +1552,9 @@ static int mi_frame_end(struct rkisp_stream *stream, u32 state)
 		stream->dbg.delay = ns - dev->isp_sdev.frm_timestamp;
 		stream->dbg.timestamp = ns;
 		stream->dbg.id = i;
+		buf->sof_ts = dev->isp_sdev.frm_timestamp;
+		trace_rkisp_mi_frame_end(dev->dev_id, stream->id, i, ns,
+					 stream->dbg.delay);
 
 		if (vb2_buf->memory) {
 			if (vir->streaming && vir->conn_id == stream->id) {
@@ -1544,8 +1577,10 @@ end:
 		return 0;
 	set_mirror_flip(stream);
 	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
-	stream->curr_buf = stream->next_buf;
-	stream->next_buf = NULL;
+	if (!is_keep) {
+		stream->curr_buf = stream->next_buf;
+		stream->next_buf = NULL;
+	}
 	if (!list_empty(&stream->buf_queue)) {
 		stream->next_buf = list_first_entry(&stream->buf_queue,
 						    struct rkisp_buffer, queue);
@@ -1607,6 +1642,8 @@ static void rkisp_stream_stop(struct rkisp_stream *stream)
 		rkisp_disable_dcrop(stream, true);
 		rkisp_disable_rsz(stream, true);
 	}
+	if (dev->cap_dev.slice_stream == stream)
+		rkisp_stream_slice_stop(dev);
 	ret = get_stream_irq_mask(stream);
 	dev->irq_ends_mask &= ~ret;
 
@@ -1750,8 +1787,11 @@ static int rkisp_create_dummy_buf(struct rkisp_stream *stream)
 	int ret = 0;
 
 	/* mainpath for warp default */
-	if (!dev->cap_dev.wrap_line || stream->id != RKISP_STREAM_MP)
+	if (!dev->cap_dev.wrap_line || stream->id != RKISP_STREAM_MP) {
+		if (stream->starve_policy == RKISP_STARVE_DUMMY)
+			return rkisp_alloc_common_dummy_buf(dev);
 		return 0;
+	}
 
 	if (!buf->dma_addr) {
 		buf->size = dev->cap_dev.wrap_width * dev->cap_dev.wrap_line * 2;
@@ -1773,9 +1813,12 @@ static void rkisp_destroy_dummy_buf(struct rkisp_stream *stream)
 {
 	struct rkisp_device *dev = stream->ispdev;
 
-	if (!dev->cap_dev.wrap_line || stream->id != RKISP_STREAM_MP)
+	if (!dev->cap_dev.wrap_line || stream->id != RKISP_STREAM_MP) {
+		if (stream->starve_policy == RKISP_STARVE_DUMMY)
+			rkisp_free_common_dummy_buf(dev);
 		return;
-	rkisp_dvbm_deinit();
+	}
+	rkisp_dvbm_deinit(dev);
 	rkisp_free_buffer(dev, &stream->dummy_buf);
 	stream->dummy_buf.dma_addr = 0;
 }
@@ -2047,6 +2090,9 @@ rkisp_start_streaming(struct vb2_queue *queue, unsigned int count)
 	}
 
 	memset(&stream->dbg, 0, sizeof(stream->dbg));
+	memset(&stream->lat, 0, sizeof(stream->lat));
+	memset(&stream->starve_cnt, 0, sizeof(stream->starve_cnt));
+	stream->is_keep_buf = false;
 
 	if (stream->id == RKISP_STREAM_LUMA) {
 		tasklet_enable(&dev->cap_dev.rd_tasklet);
@@ -2137,9 +2183,28 @@ buffer_done:
 	return ret;
 }
 
+/* called at DQBUF, account buffer done to userspace latency */
+static void rkisp_buf_finish(struct vb2_buffer *vb)
+{
+	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
+	struct rkisp_buffer *buf = to_rkisp_buffer(vbuf);
+	struct rkisp_stream *stream = vb->vb2_queue->drv_priv;
+	u64 ns, lat;
+
+	if (vb->state != VB2_BUF_STATE_DONE || !buf->done_ts)
+		return;
+	ns = rkisp_time_get_ns(stream->ispdev);
+	lat = ns - buf->done_ts;
+	buf->done_ts = 0;
+	rkisp_latency_hist_add(stream->lat.done_dqbuf, lat);
+	trace_rkisp_buf_dqbuf(stream->ispdev->dev_id, stream->id,
+			      vbuf->sequence, ns, lat);
+}
+
 static const struct vb2_ops rkisp_vb2_ops = {
 	.queue_setup = rkisp_queue_setup,
 	.buf_queue = rkisp_buf_queue,
+	.buf_finish = rkisp_buf_finish,
 	.wait_prepare = vb2_ops_wait_prepare,
 	.wait_finish = vb2_ops_wait_finish,
 	.stop_streaming = rkisp_stop_streaming,
@@ -2182,6 +2247,8 @@ static int rkisp_stream_init(struct rkisp_device *dev, u32 id)
 	vdev = &stream->vnode.vdev;
 
 	INIT_LIST_HEAD(&stream->buf_queue);
+	INIT_LIST_HEAD(&stream->share.ready);
+	INIT_LIST_HEAD(&stream->share.held);
 	init_waitqueue_head(&stream->done);
 	spin_lock_init(&stream->vbq_lock);
 	stream->linked = true;
@@ -34,6 +34,9 @@ void rkisp_rockit_frame_start(struct rkisp_device *dev);
 int rkisp_rockit_fps_set(int *dst_fps, struct rkisp_stream *stream);
 int rkisp_rockit_fps_get(int *dst_fps, struct rkisp_stream *stream);
 int rkisp_rockit_buf_done(struct rkisp_stream *stream, int cmd);
+int rkisp_rockit_share_set(struct rkisp_stream *stream, int max);
+int rkisp_rockit_share_dqbuf(struct rkisp_stream *stream, struct rkisp_share_buf *buf);
+int rkisp_rockit_share_qbuf(struct rkisp_stream *stream, struct rkisp_share_buf *buf);
 #else
 static inline int rkisp_register_stream_v32(struct rkisp_device *dev) { return -EINVAL; }
 static inline void rkisp_unregister_stream_v32(struct rkisp_device *dev) {}
@@ -48,17 +51,20 @@ static inline void rkisp_rockit_frame_start(struct rkisp_device *dev) {}
 static inline int rkisp_rockit_fps_set(int *dst_fps, struct rkisp_stream *stream) { return -EINVAL; }
 static inline int rkisp_rockit_fps_get(int *dst_fps, struct rkisp_stream *stream) { return -EINVAL; }
 static inline int rkisp_rockit_buf_done(struct rkisp_stream *stream, int cmd) { return -EINVAL; }
+static inline int rkisp_rockit_share_set(struct rkisp_stream *stream, int max) { return -EINVAL; }
+static inline int rkisp_rockit_share_dqbuf(struct rkisp_stream *stream, struct rkisp_share_buf *buf) { return -EINVAL; }
+static inline int rkisp_rockit_share_qbuf(struct rkisp_stream *stream, struct rkisp_share_buf *buf) { return -EINVAL; }
 #endif
 
 #if IS_ENABLED(CONFIG_ROCKCHIP_DVBM)
 int rkisp_dvbm_get(struct rkisp_device *dev);
 int rkisp_dvbm_init(struct rkisp_stream *stream);
-void rkisp_dvbm_deinit(void);
+void rkisp_dvbm_deinit(struct rkisp_device *dev);
 int rkisp_dvbm_event(struct rkisp_device *dev, u32 event);
 #else
 static inline int rkisp_dvbm_get(struct rkisp_device *dev) { return -EINVAL; }
 static inline int rkisp_dvbm_init(struct rkisp_stream *stream) { return -EINVAL; }
-static inline void rkisp_dvbm_deinit(void) {}
+static inline void rkisp_dvbm_deinit(struct rkisp_device *dev) {}
 static inline int rkisp_dvbm_event(struct rkisp_device *dev, u32 event) { return -EINVAL; }
 #endif
 
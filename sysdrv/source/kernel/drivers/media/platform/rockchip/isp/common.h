@@ -118,6 +118,9 @@ struct rkisp_buffer {
 	u32 buff_addr[VIDEO_MAX_PLANES];
 	int dev_id;
 	void *other;
+	/* latency tracking: frame start and vb2 buffer done */
+	u64 sof_ts;
+	u64 done_ts;
 };
 
 struct rkisp_dummy_buffer {
@@ -139,6 +142,7 @@ extern bool rkisp_monitor;
 extern bool rkisp_irq_dbg;
 extern bool rkisp_buf_dbg;
 extern u64 rkisp_debug_reg;
+extern unsigned int rkisp_luma_ae;
 extern struct platform_driver rkisp_plat_drv;
 
 static inline
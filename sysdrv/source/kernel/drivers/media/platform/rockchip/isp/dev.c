@@ -96,6 +96,10 @@ static unsigned int rkisp_wrap_line;
 module_param_named(wrap_line, rkisp_wrap_line, uint, 0644);
 MODULE_PARM_DESC(wrap_line, "rkisp wrap line for mpp");
 
+unsigned int rkisp_luma_ae = 0x60;
+module_param_named(luma_ae, rkisp_luma_ae, uint, 0644);
+MODULE_PARM_DESC(luma_ae, "rkisp mipi luma target of thunderboot coarse ae, 0 to disable");
+
 static DEFINE_MUTEX(rkisp_dev_mutex);
 static LIST_HEAD(rkisp_device_list);
 
@@ -847,6 +851,45 @@ static int rkisp_get_reserved_mem(struct rkisp_device *isp_dev)
 	return ret;
 }
 
+/* reserved memory keep over suspend for warm resume snapshot */
+static int rkisp_get_warm_mem(struct rkisp_device *isp_dev)
+{
+	struct device *dev = isp_dev->dev;
+	struct device_node *np;
+	struct resource r;
+	size_t size;
+	void *va;
+	int ret;
+
+	np = of_parse_phandle(dev->of_node, "memory-region-warm", 0);
+	if (!np)
+		return 0;
+
+	ret = of_address_to_resource(np, 0, &r);
+	of_node_put(np);
+	if (ret) {
+		dev_err(dev, "No memory address assigned to the warm region\n");
+		return ret;
+	}
+
+	/* split to each virtual isp */
+	size = resource_size(&r) / DEV_MAX;
+	if (size <= sizeof(struct rkisp_warm_head)) {
+		dev_err(dev, "warm region size:%zu no enough\n", (size_t)resource_size(&r));
+		return -EINVAL;
+	}
+	va = devm_memremap(dev, r.start, resource_size(&r), MEMREMAP_WB);
+	if (IS_ERR(va)) {
+		dev_err(dev, "failed to map warm region\n");
+		return PTR_ERR(va);
+	}
+	isp_dev->warm.va = va + size * isp_dev->dev_id;
+	isp_dev->warm.size = size;
+	dev_info(dev, "warm resume memory, paddr: 0x%x size:%zu\n",
+		 (u32)(r.start + size * isp_dev->dev_id), size);
+	return 0;
+}
+
 static int rkisp_plat_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -896,6 +939,10 @@ static int rkisp_plat_probe(struct platform_device *pdev)
 	if (ret)
 		return ret;
 
+	ret = rkisp_get_warm_mem(isp_dev);
+	if (ret)
+		return ret;
+
 	mutex_init(&isp_dev->apilock);
 	mutex_init(&isp_dev->iqlock);
 	atomic_set(&isp_dev->pipe.power_cnt, 0);
@@ -1073,6 +1120,7 @@ static int rkisp_pm_prepare(struct device *dev)
 		wait_for_completion_timeout(&isp_dev->pm_cmpl, msecs_to_jiffies(time));
 		isp_dev->suspend_sync = false;
 	}
+	rkisp_warm_save(isp_dev);
 
 	if (rkisp_link_sensor(isp_dev->isp_inp)) {
 		for (i = p->num_subdevs - 1; i >= 0; i--)
@@ -190,6 +190,70 @@ struct rkisp_hdr {
 	struct rkisp_dummy_buffer dummy_buf[HDR_DMA_MAX][HDR_MAX_DUMMY_BUF];
 };
 
+/*
+ * struct rkisp_sched - readback schedule for multi device
+ *
+ * @prio: higher value first to readback
+ * @fps: target frame rate, 0 no limit
+ * @last_ns: last readback start time
+ * @fps_ns: start time of fps statistics
+ * @fps_cnt: readback count from fps_ns
+ * @fps_out: achieved fps x100 of last second
+ * @delay_ns: last delay of frame in readback fifo
+ * @delay_max_ns: max delay of frame in readback fifo
+ * @over_cnt: readback count over fps target
+ */
+struct rkisp_sched {
+	u32 prio;
+	u32 fps;
+	u64 last_ns;
+	u64 fps_ns;
+	u32 fps_cnt;
+	u32 fps_out;
+	u64 delay_ns;
+	u64 delay_max_ns;
+	u32 over_cnt;
+};
+
+#define RKISP_WARM_MAGIC	0x4d524157 /* "WARM" */
+#define RKISP_WARM_VERSION	1
+
+/*
+ * struct rkisp_warm_head - warm resume snapshot head in reserved memory
+ * @crc: crc32 from isp_ver to end of params
+ * @size: params size follow the head
+ */
+struct rkisp_warm_head {
+	u32 magic;
+	u32 version;
+	u32 crc;
+	u32 size;
+	u32 isp_ver;
+	u32 dev_id;
+	u32 width;
+	u32 height;
+	u32 mbus_code;
+	u32 rd_mode;
+	u32 frame_id;
+	struct rkisp_warm_ae ae;
+} __attribute__ ((packed));
+
+/*
+ * struct rkisp_warm - warm resume for suspend/wakeup
+ * @va: snapshot of this device in reserved memory
+ * @size: snapshot max size
+ * @ae: last ae result from userspace
+ * @frame_id: frame id of snapshot restored
+ * @is_valid: first params of current stream from snapshot
+ */
+struct rkisp_warm {
+	void *va;
+	size_t size;
+	struct rkisp_warm_ae ae;
+	u32 frame_id;
+	bool is_valid;
+};
+
 /*
  * struct rkisp_device - ISP platform device
  * @base_addr: base register address
@@ -274,6 +338,9 @@ struct rkisp_device {
 	u32 rd_mode;
 	int sw_rd_cnt;
 
+	struct rkisp_sched sched;
+	struct rkisp_warm warm;
+
 	struct rkisp_rx_buf_pool pv_pool[RKISP_RX_BUF_POOL_MAX];
 
 	struct mutex buf_lock;
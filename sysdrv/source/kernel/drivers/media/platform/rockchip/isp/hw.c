@@ -866,6 +866,9 @@ void rkisp_soft_reset(struct rkisp_hw_dev *dev, bool is_secure)
 	void __iomem *base = dev->base_addr;
 	u32 val, iccl0, iccl1, clk_ctrl0, clk_ctrl1;
 
+	/* isp sram lost after reset */
+	dev->sram_dev_id = -1;
+
 	/* record clk config and recover */
 	iccl0 = readl(base + CIF_ICCL);
 	clk_ctrl0 = readl(base + CTRL_VI_ISP_CLK_CTRL);
@@ -1216,6 +1219,7 @@ static int rkisp_hw_probe(struct platform_device *pdev)
 	hw_dev->cur_dev_id = 0;
 	hw_dev->mipi_dev_id = 0;
 	hw_dev->pre_dev_id = -1;
+	hw_dev->sram_dev_id = -1;
 	hw_dev->is_multi_overflow = false;
 	mutex_init(&hw_dev->dev_lock);
 	spin_lock_init(&hw_dev->rdbk_lock);
@@ -68,6 +68,8 @@ struct rkisp_hw_dev {
 	int dev_link_num;
 	int cur_dev_id;
 	int pre_dev_id;
+	/* isp dev id whose lut tables in isp sram, -1 for none */
+	int sram_dev_id;
 	int mipi_dev_id;
 	struct max_input max_in;
 	/* lock for multi dev */
@@ -3,6 +3,7 @@
 
 #include <linux/of.h>
 #include <linux/of_platform.h>
+#include <linux/spinlock.h>
 #include <soc/rockchip/rockchip_dvbm.h>
 
 #include "dev.h"
@@ -10,6 +11,17 @@
 
 static struct dvbm_port *g_dvbm;
 
+/*
+ * Several virtual isp devices can share the online path, time-multiplexed
+ * frame by frame. Each keeps its own wrap buffer config, the port is linked
+ * while at least one of them is online and switched over to the device that
+ * starts a frame.
+ */
+static DEFINE_SPINLOCK(g_dvbm_lock);
+static struct dvbm_isp_cfg_t g_dvbm_cfg[DEV_MAX];
+static unsigned long g_dvbm_online;
+static int g_dvbm_chan = -1;
+
 int rkisp_dvbm_get(struct rkisp_device *dev)
 {
 	struct device_node *np = dev->dev->of_node;
@@ -39,6 +51,8 @@ int rkisp_dvbm_init(struct rkisp_stream *stream)
 	struct rkisp_dummy_buffer *buf = &stream->dummy_buf;
 	struct dvbm_isp_cfg_t dvbm_cfg;
 	u32 width, height, wrap_line;
+	unsigned long flags;
+	bool link;
 
 	if (!g_dvbm)
 		return -EINVAL;
@@ -57,31 +71,65 @@ int rkisp_dvbm_init(struct rkisp_stream *stream)
 	dvbm_cfg.cbuf_fstd = dvbm_cfg.ybuf_fstd / 2;
 	dvbm_cfg.chan_id = dev->dev_id;
 
-	rk_dvbm_ctrl(g_dvbm, DVBM_ISP_SET_CFG, &dvbm_cfg);
-	rk_dvbm_link(g_dvbm);
+	spin_lock_irqsave(&g_dvbm_lock, flags);
+	g_dvbm_cfg[dev->dev_id] = dvbm_cfg;
+	link = !g_dvbm_online;
+	g_dvbm_online |= BIT(dev->dev_id);
+	if (link || g_dvbm_chan == dev->dev_id) {
+		rk_dvbm_ctrl(g_dvbm, DVBM_ISP_SET_CFG, &dvbm_cfg);
+		g_dvbm_chan = dev->dev_id;
+	}
+	spin_unlock_irqrestore(&g_dvbm_lock, flags);
+
+	if (link)
+		rk_dvbm_link(g_dvbm);
 	return 0;
 }
 
-void rkisp_dvbm_deinit(void)
+void rkisp_dvbm_deinit(struct rkisp_device *dev)
 {
-	if (g_dvbm)
+	unsigned long flags;
+	bool unlink;
+
+	if (!g_dvbm)
+		return;
+
+	spin_lock_irqsave(&g_dvbm_lock, flags);
+	unlink = g_dvbm_online == BIT(dev->dev_id);
+	g_dvbm_online &= ~BIT(dev->dev_id);
+	if (g_dvbm_chan == dev->dev_id)
+		g_dvbm_chan = -1;
+	spin_unlock_irqrestore(&g_dvbm_lock, flags);
+
+	if (unlink)
 		rk_dvbm_unlink(g_dvbm);
 }
 
 int rkisp_dvbm_event(struct rkisp_device *dev, u32 event)
 {
 	enum dvbm_cmd cmd;
+	unsigned long flags;
 	u32 seq;
 
 	if (!g_dvbm || dev->isp_ver != ISP_V32 ||
 	    !dev->cap_dev.wrap_line)
 		return -EINVAL;
 
+	if (!test_bit(dev->dev_id, &g_dvbm_online))
+		return -EINVAL;
+
 	rkisp_dmarx_get_frame(dev, &seq, NULL, NULL, true);
 
 	switch (event) {
 	case CIF_ISP_V_START:
 		cmd = DVBM_ISP_FRM_START;
+		spin_lock_irqsave(&g_dvbm_lock, flags);
+		if (g_dvbm_chan != dev->dev_id) {
+			rk_dvbm_ctrl(g_dvbm, DVBM_ISP_SET_CFG,
+				     &g_dvbm_cfg[dev->dev_id]);
+			g_dvbm_chan = dev->dev_id;
+		}
+		spin_unlock_irqrestore(&g_dvbm_lock, flags);
 		break;
 	case CIF_MI_MP_FRAME:
 		cmd = DVBM_ISP_FRM_END;
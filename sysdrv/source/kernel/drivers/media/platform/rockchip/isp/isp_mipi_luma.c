@@ -3,6 +3,7 @@
 
 #include <linux/kfifo.h>
 #include <media/v4l2-common.h>
+#include <media/v4l2-ctrls.h>
 #include <media/v4l2-ioctl.h>
 #include <media/videobuf2-core.h>
 #include <media/videobuf2-vmalloc.h>	/* for ISP statistics */
@@ -13,6 +14,12 @@
 #define RKISP_ISP_LUMA_REQ_BUFS_MIN 2
 #define RKISP_ISP_LUMA_REQ_BUFS_MAX 8
 
+/* frames for sensor new exposure to take effect */
+#define RKISP_LUMA_AE_SKIP	3
+/* step ratio in 1/16, limit to 4x once */
+#define RKISP_LUMA_AE_RATIO_MIN	4
+#define RKISP_LUMA_AE_RATIO_MAX	64
+
 static int rkisp_luma_enum_fmt_meta_cap(struct file *file, void *priv,
 					struct v4l2_fmtdesc *f)
 {
@@ -267,6 +274,87 @@ rkisp_stats_send_luma(struct rkisp_luma_vdev *vdev,
 	vb2_buffer_done(&cur_buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
 }
 
+static bool rkisp_luma_ae_set(struct v4l2_ctrl *ctrl, u32 ratio)
+{
+	s64 cur, val;
+
+	if (!ctrl)
+		return false;
+	cur = v4l2_ctrl_g_ctrl(ctrl);
+	val = div_s64(cur * ratio, 16);
+	if (ratio > 16 && val <= cur)
+		val = cur + ctrl->step;
+	val = clamp_t(s64, val, ctrl->minimum, ctrl->maximum);
+	if (val == cur)
+		return false;
+	v4l2_ctrl_s_ctrl(ctrl, val);
+	return true;
+}
+
+static void rkisp_luma_ae_work(struct work_struct *work)
+{
+	struct rkisp_luma_vdev *luma_vdev =
+		container_of(work, struct rkisp_luma_vdev, ae.work);
+	struct rkisp_device *dev = luma_vdev->dev;
+	struct v4l2_subdev *sensor = NULL;
+	struct v4l2_ctrl *exp, *gain;
+	u32 mean, ratio;
+
+	rkisp_get_remote_mipi_sensor(dev, &sensor, MEDIA_ENT_F_CAM_SENSOR);
+	if (!sensor || !sensor->ctrl_handler)
+		return;
+	exp = v4l2_ctrl_find(sensor->ctrl_handler, V4L2_CID_EXPOSURE);
+	gain = v4l2_ctrl_find(sensor->ctrl_handler, V4L2_CID_ANALOGUE_GAIN);
+	if (!exp && !gain) {
+		luma_vdev->ae.en = false;
+		return;
+	}
+
+	mean = max_t(u32, READ_ONCE(luma_vdev->ae.mean), 1);
+	ratio = clamp_t(u32, rkisp_luma_ae * 16 / mean,
+			RKISP_LUMA_AE_RATIO_MIN, RKISP_LUMA_AE_RATIO_MAX);
+	/* brighter by exposure first, darker by gain first */
+	if (ratio > 16) {
+		if (!rkisp_luma_ae_set(exp, ratio))
+			rkisp_luma_ae_set(gain, ratio);
+	} else {
+		if (!rkisp_luma_ae_set(gain, ratio))
+			rkisp_luma_ae_set(exp, ratio);
+	}
+	v4l2_dbg(1, rkisp_debug, &dev->v4l2_dev,
+		 "luma ae mean:%u target:%u exp:%d gain:%d\n",
+		 mean, rkisp_luma_ae,
+		 exp ? v4l2_ctrl_g_ctrl(exp) : -1,
+		 gain ? v4l2_ctrl_g_ctrl(gain) : -1);
+}
+
+/* coarse ae until aiq take over, call in isr */
+static void rkisp_luma_ae_run(struct rkisp_luma_vdev *luma_vdev)
+{
+	struct rkisp_luma_ae *ae = &luma_vdev->ae;
+	u32 i, mean = 0, target = rkisp_luma_ae;
+
+	if (luma_vdev->streamon || luma_vdev->dev->params_vdev.streamon || !target) {
+		ae->en = false;
+		v4l2_dbg(1, rkisp_debug, luma_vdev->vnode.vdev.v4l2_dev,
+			 "luma ae stop\n");
+		return;
+	}
+	if (ae->skip) {
+		ae->skip--;
+		return;
+	}
+
+	for (i = 0; i < ISP2X_MIPI_LUMA_MEAN_MAX; i++)
+		mean += luma_vdev->work.luma[2].exp_mean[i];
+	mean /= ISP2X_MIPI_LUMA_MEAN_MAX;
+	if (abs((int)mean - (int)target) <= target / 8)
+		return;
+	WRITE_ONCE(ae->mean, mean);
+	ae->skip = RKISP_LUMA_AE_SKIP;
+	schedule_work(&ae->work);
+}
+
 static void rkisp_luma_readout_task(unsigned long data)
 {
 	unsigned int out = 0;
@@ -296,7 +384,7 @@ void rkisp_luma_isr(struct rkisp_luma_vdev *luma_vdev, u32 isp_stat)
 	u32 i, value;
 
 	spin_lock(&luma_vdev->irq_lock);
-	if (!luma_vdev->streamon)
+	if (!luma_vdev->streamon && !luma_vdev->ae.en)
 		goto unlock;
 
 	switch (op_mode) {
@@ -394,7 +482,17 @@ void rkisp_luma_isr(struct rkisp_luma_vdev *luma_vdev, u32 isp_stat)
 			send_task = true;
 	}
 
-	if (send_task) {
+	/* sensor linear exposure only */
+	if (send_task && luma_vdev->ae.en && frm_mode == RKISP_LUMA_ONEFRM)
+		rkisp_luma_ae_run(luma_vdev);
+
+	if (send_task && !luma_vdev->streamon) {
+		for (i = 0; i < ISP2X_MIPI_RAW_MAX; i++) {
+			luma_vdev->ystat_isrcnt[i] = 0;
+			luma_vdev->ystat_rdflg[i] = false;
+		}
+		memset(&luma_vdev->work, 0, sizeof(luma_vdev->work));
+	} else if (send_task) {
 		luma_vdev->work.readout = RKISP_ISP_READOUT_LUMA;
 		luma_vdev->work.timestamp = rkisp_time_get_ns(luma_vdev->dev);
 		luma_vdev->work.frame_id = cur_frame_id;
@@ -501,6 +599,9 @@ int rkisp_register_luma_vdev(struct rkisp_luma_vdev *luma_vdev,
 		     (unsigned long)luma_vdev);
 	tasklet_disable(&luma_vdev->rd_tasklet);
 
+	INIT_WORK(&luma_vdev->ae.work, rkisp_luma_ae_work);
+	luma_vdev->ae.en = dev->is_thunderboot && rkisp_luma_ae;
+
 	return 0;
 
 err_unregister_video:
@@ -519,6 +620,8 @@ void rkisp_unregister_luma_vdev(struct rkisp_luma_vdev *luma_vdev)
 
 	if (luma_vdev->dev->isp_ver != ISP_V20)
 		return;
+	luma_vdev->ae.en = false;
+	cancel_work_sync(&luma_vdev->ae.work);
 	kfifo_free(&luma_vdev->rd_kfifo);
 	tasklet_kill(&luma_vdev->rd_tasklet);
 	video_unregister_device(vdev);
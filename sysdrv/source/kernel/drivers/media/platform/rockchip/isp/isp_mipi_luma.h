@@ -7,6 +7,7 @@
 #include <linux/rk-isp1-config.h>
 #include <linux/interrupt.h>
 #include <linux/kfifo.h>
+#include <linux/workqueue.h>
 #include "common.h"
 
 #define RKISP_LUMA_READOUT_WORK_SIZE	\
@@ -33,6 +34,20 @@ struct rkisp_luma_readout_work {
 	struct rkisp_mipi_luma luma[ISP2X_MIPI_RAW_MAX];
 };
 
+/*
+ * struct rkisp_luma_ae - coarse ae by mipi luma before aiq run
+ *
+ * @en: enable for thunderboot, off once aiq take over
+ * @mean: average luma of last frame
+ * @skip: frames to wait sensor exposure take effect
+ */
+struct rkisp_luma_ae {
+	struct work_struct work;
+	bool en;
+	u32 mean;
+	u32 skip;
+};
+
 /*
  * struct rkisp_isp_luma_vdev - ISP Statistics device
  *
@@ -56,6 +71,7 @@ struct rkisp_luma_vdev {
 	unsigned int ystat_isrcnt[ISP2X_MIPI_RAW_MAX];
 	bool ystat_rdflg[ISP2X_MIPI_RAW_MAX];
 	struct rkisp_luma_readout_work work;
+	struct rkisp_luma_ae ae;
 };
 
 #if IS_ENABLED(CONFIG_VIDEO_ROCKCHIP_ISP_VERSION_V20)
@@ -27,6 +27,7 @@ enum rkisp_params_type {
 struct rkisp_isp_params_vdev;
 struct rkisp_isp_params_ops {
 	void (*save_first_param)(struct rkisp_isp_params_vdev *params_vdev, void *param);
+	int (*get_last_param)(struct rkisp_isp_params_vdev *params_vdev, void *param, u32 size);
 	void (*clear_first_param)(struct rkisp_isp_params_vdev *params_vdev);
 	void (*get_param_size)(struct rkisp_isp_params_vdev *params_vdev, unsigned int sizes[]);
 	void (*first_cfg)(struct rkisp_isp_params_vdev *params_vdev);
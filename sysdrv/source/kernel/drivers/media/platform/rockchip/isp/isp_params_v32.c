@@ -4378,17 +4378,152 @@ void __isp_isr_meas_en(struct rkisp_isp_params_vdev *params_vdev,
 		ops->rawawb_enable(params_vdev, !!(module_ens & ISP32_MODULE_RAWAWB), id);
 }
 
+struct isp32_module_cfg_info {
+	u64 module;
+	u32 offset;
+	u32 size;
+};
+
+#define ISP32_MODULE_CFG(_module, _cfg) {				\
+	.module = (_module),						\
+	.offset = offsetof(struct isp32_isp_params_cfg, _cfg),		\
+	.size = sizeof_field(struct isp32_isp_params_cfg, _cfg),	\
+}
+
+/* ldch and cac refer to mesh buffer by fd, always to config */
+static const struct isp32_module_cfg_info isp32_module_cfg_tbl[] = {
+	ISP32_MODULE_CFG(ISP32_MODULE_RAWAF, meas.rawaf),
+	ISP32_MODULE_CFG(ISP32_MODULE_RAWAWB, meas.rawawb),
+	ISP32_MODULE_CFG(ISP32_MODULE_RAWAE0, meas.rawae0),
+	ISP32_MODULE_CFG(ISP32_MODULE_RAWAE1, meas.rawae1),
+	ISP32_MODULE_CFG(ISP32_MODULE_RAWAE2, meas.rawae2),
+	ISP32_MODULE_CFG(ISP32_MODULE_RAWAE3, meas.rawae3),
+	ISP32_MODULE_CFG(ISP32_MODULE_RAWHIST0, meas.rawhist0),
+	ISP32_MODULE_CFG(ISP32_MODULE_RAWHIST1, meas.rawhist1),
+	ISP32_MODULE_CFG(ISP32_MODULE_RAWHIST2, meas.rawhist2),
+	ISP32_MODULE_CFG(ISP32_MODULE_RAWHIST3, meas.rawhist3),
+	ISP32_MODULE_CFG(ISP32_MODULE_BLS, others.bls_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_DPCC, others.dpcc_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_LSC, others.lsc_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_AWB_GAIN, others.awb_gain_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_GIC, others.gic_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_DEBAYER, others.debayer_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_CCM, others.ccm_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_GOC, others.gammaout_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_CPROC, others.cproc_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_IE, others.ie_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_SDG, others.sdg_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_DRC, others.drc_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_HDRMGE, others.hdrmge_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_DHAZ, others.dhaz_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_3DLUT, others.isp3dlut_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_BAYNR, others.baynr_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_BAY3D, others.bay3d_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_YNR, others.ynr_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_CNR, others.cnr_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_SHARP, others.sharp_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_GAIN, others.gain_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_CSM, others.csm_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_CGC, others.cgc_cfg),
+	ISP32_MODULE_CFG(ISP32_MODULE_VSM, others.vsm_cfg),
+};
+
+/* modules with table in isp sram */
+#define ISP32_MODULE_SRAM (ISP32_MODULE_LSC | ISP32_MODULE_RAWAWB | \
+			   ISP32_MODULE_RAWHIST1 | ISP32_MODULE_RAWHIST2 | \
+			   ISP32_MODULE_RAWHIST3)
+
+static void
+isp_params_invalid_last(struct rkisp_isp_params_vdev *params_vdev)
+{
+	struct rkisp_isp_params_val_v32 *priv_val = params_vdev->priv_val;
+	int i;
+
+	for (i = 0; i < ISP_UNITE_MAX; i++) {
+		priv_val->last_cfg_valid[i] = 0;
+		priv_val->last_ens_valid[i] = 0;
+	}
+	priv_val->is_lut_dirty = true;
+}
+
+/*
+ * clear update bit of module which config or enable state is same
+ * as last applied, and record new one. call once before to apply.
+ */
+static void
+isp_params_check_dirty(struct rkisp_isp_params_vdev *params_vdev,
+		       struct isp32_isp_params_cfg *new_params, u32 id)
+{
+	struct rkisp_isp_params_val_v32 *priv_val = params_vdev->priv_val;
+	struct isp32_isp_params_cfg *last;
+	const struct isp32_module_cfg_info *info;
+	u64 cfg_update = new_params->module_cfg_update;
+	u64 en_update = new_params->module_en_update;
+	u64 ens = new_params->module_ens;
+	bool is_force = !!(cfg_update & ISP32_MODULE_FORCE);
+	u8 *src, *dst;
+	int i;
+
+	if (!priv_val->last_params)
+		return;
+
+	last = priv_val->last_params + id;
+	src = (u8 *)new_params;
+	dst = (u8 *)last;
+	for (i = 0; i < ARRAY_SIZE(isp32_module_cfg_tbl); i++) {
+		info = &isp32_module_cfg_tbl[i];
+		if (!(cfg_update & info->module))
+			continue;
+		if (!is_force &&
+		    (priv_val->last_cfg_valid[id] & info->module) &&
+		    !memcmp(src + info->offset, dst + info->offset, info->size)) {
+			cfg_update &= ~info->module;
+			continue;
+		}
+		memcpy(dst + info->offset, src + info->offset, info->size);
+		priv_val->last_cfg_valid[id] |= info->module;
+	}
+
+	if (!is_force)
+		en_update &= ~(priv_val->last_ens_valid[id] &
+			       ~(ens ^ priv_val->last_ens[id]));
+	priv_val->last_ens[id] &= ~en_update;
+	priv_val->last_ens[id] |= ens & en_update;
+	priv_val->last_ens_valid[id] |= en_update;
+
+	if ((cfg_update | en_update) & ISP32_MODULE_SRAM)
+		priv_val->is_lut_dirty = true;
+
+	v4l2_dbg(4, rkisp_debug, &params_vdev->dev->v4l2_dev,
+		 "%s id:%d seq:%d cfg_update:0x%llx->0x%llx en_update:0x%llx->0x%llx\n",
+		 __func__, id, new_params->frame_id,
+		 new_params->module_cfg_update, cfg_update,
+		 new_params->module_en_update, en_update);
+	new_params->module_cfg_update = cfg_update;
+	new_params->module_en_update = en_update;
+}
+
 static
 void rkisp_params_cfgsram_v32(struct rkisp_isp_params_vdev *params_vdev)
 {
-	u32 id = params_vdev->dev->unite_index;
+	struct rkisp_device *dev = params_vdev->dev;
+	struct rkisp_hw_dev *hw = dev->hw_dev;
+	struct rkisp_isp_params_val_v32 *priv_val = params_vdev->priv_val;
+	u32 id = dev->unite_index;
 	struct isp32_isp_params_cfg *params = params_vdev->isp32_params + id;
 
+	/* sram still keep this device tables */
+	if (dev->unite_div == ISP_UNITE_DIV1 &&
+	    hw->sram_dev_id == dev->dev_id && !priv_val->is_lut_dirty)
+		return;
+
 	isp_lsc_matrix_cfg_sram(params_vdev, &params->others.lsc_cfg, true, id);
 	isp_rawhstbig_cfg_sram(params_vdev, &params->meas.rawhist1, 1, true, id);
 	isp_rawhstbig_cfg_sram(params_vdev, &params->meas.rawhist2, 2, true, id);
 	isp_rawhstbig_cfg_sram(params_vdev, &params->meas.rawhist3, 0, true, id);
 	isp_rawawb_cfg_sram(params_vdev, &params->meas.rawawb, true, id);
+	priv_val->is_lut_dirty = false;
+	hw->sram_dev_id = dev->unite_div == ISP_UNITE_DIV1 ? dev->dev_id : -1;
 }
 
 static int
@@ -4957,7 +5092,9 @@ rkisp_params_first_cfg_v32(struct rkisp_isp_params_vdev *params_vdev)
 	if (dev->is_bigmode)
 		rkisp_unite_set_bits(dev, ISP3X_ISP_CTRL1, 0,
 				     ISP3X_BIGMODE_MANUAL | ISP3X_BIGMODE_FORCE_EN, false);
+	isp_params_invalid_last(params_vdev);
 	for (i = 0; i < dev->unite_div; i++) {
+		isp_params_check_dirty(params_vdev, params + i, i);
 		__isp_isr_meas_config(params_vdev, params + i, RKISP_PARAMS_ALL, i);
 		__isp_isr_other_config(params_vdev, params + i, RKISP_PARAMS_ALL, i);
 		__isp_isr_other_en(params_vdev, params + i, RKISP_PARAMS_ALL, i);
@@ -4987,6 +5124,29 @@ static void rkisp_save_first_param_v32(struct rkisp_isp_params_vdev *params_vdev
 	rkisp_alloc_internal_buf(params_vdev, params_vdev->isp32_params);
 }
 
+/* last applied config of each module, for warm resume snapshot */
+static int rkisp_get_last_param_v32(struct rkisp_isp_params_vdev *params_vdev,
+				    void *param, u32 size)
+{
+	struct rkisp_isp_params_val_v32 *priv_val = params_vdev->priv_val;
+	struct isp32_isp_params_cfg *cfg = param;
+	u32 i, mult = params_vdev->dev->unite_div;
+
+	if (!priv_val->last_params || !priv_val->last_cfg_valid[0])
+		return -EINVAL;
+	if (size < sizeof(*cfg) * mult)
+		return -ENOMEM;
+
+	for (i = 0; i < mult; i++) {
+		memcpy(&cfg[i], &priv_val->last_params[i], sizeof(*cfg));
+		cfg[i].module_cfg_update = priv_val->last_cfg_valid[i];
+		cfg[i].module_en_update = priv_val->last_ens_valid[i];
+		cfg[i].module_ens = priv_val->last_ens[i];
+		cfg[i].frame_id = 0;
+	}
+	return sizeof(*cfg) * mult;
+}
+
 static void rkisp_clear_first_param_v32(struct rkisp_isp_params_vdev *params_vdev)
 {
 	u32 mult = params_vdev->dev->hw_dev->unite ? ISP_UNITE_MAX : 1;
@@ -5352,6 +5512,7 @@ rkisp_params_disable_isp_v32(struct rkisp_isp_params_vdev *params_vdev)
 		__isp_isr_other_en(params_vdev, params_vdev->isp32_params, RKISP_PARAMS_ALL, i);
 		__isp_isr_meas_en(params_vdev, params_vdev->isp32_params, RKISP_PARAMS_ALL, i);
 	}
+	isp_params_invalid_last(params_vdev);
 }
 
 static void
@@ -5417,6 +5578,7 @@ rkisp_params_cfg_v32(struct rkisp_isp_params_vdev *params_vdev,
 				/* update en immediately */
 				if (new_params->module_en_update ||
 				    (new_params->module_cfg_update & ISP32_MODULE_FORCE)) {
+					isp_params_check_dirty(params_vdev, new_params, i);
 					__isp_isr_meas_config(params_vdev,
 							      new_params, RKISP_PARAMS_ALL, i);
 					__isp_isr_other_config(params_vdev,
@@ -5437,6 +5599,8 @@ rkisp_params_cfg_v32(struct rkisp_isp_params_vdev *params_vdev,
 			continue;
 		} else if (new_params->frame_id == frame_id) {
 			list_del(&cur_buf->queue);
+			for (i = 0; i < dev->unite_div; i++)
+				isp_params_check_dirty(params_vdev, new_params + i, i);
 		} else {
 			cur_buf = NULL;
 		}
@@ -5508,6 +5672,7 @@ rkisp_params_isr_v32(struct rkisp_isp_params_vdev *params_vdev,
 
 static struct rkisp_isp_params_ops rkisp_isp_params_ops_tbl = {
 	.save_first_param = rkisp_save_first_param_v32,
+	.get_last_param = rkisp_get_last_param_v32,
 	.clear_first_param = rkisp_clear_first_param_v32,
 	.get_param_size = rkisp_get_param_size_v32,
 	.first_cfg = rkisp_params_first_cfg_v32,
@@ -5542,6 +5707,13 @@ int rkisp_init_params_vdev_v32(struct rkisp_isp_params_vdev *params_vdev)
 		kfree(priv_val);
 		return -ENOMEM;
 	}
+	priv_val->last_params = vzalloc(size);
+	if (!priv_val->last_params) {
+		vfree(params_vdev->isp32_params);
+		params_vdev->isp32_params = NULL;
+		kfree(priv_val);
+		return -ENOMEM;
+	}
 
 	params_vdev->priv_val = (void *)priv_val;
 	params_vdev->ops = &rkisp_isp_params_ops_tbl;
@@ -5564,6 +5736,7 @@ void rkisp_uninit_params_vdev_v32(struct rkisp_isp_params_vdev *params_vdev)
 		vfree(params_vdev->isp32_params);
 	if (priv_val) {
 		tasklet_kill(&priv_val->lsc_tasklet);
+		vfree(priv_val->last_params);
 		kfree(priv_val);
 		params_vdev->priv_val = NULL;
 	}
@@ -203,6 +203,12 @@ struct rkisp_isp_params_val_v32 {
 
 	struct rkisp_dummy_buffer buf_frm;
 
+	/* last applied config, to skip module with same config */
+	struct isp32_isp_params_cfg *last_params;
+	u64 last_cfg_valid[ISP_UNITE_MAX];
+	u64 last_ens[ISP_UNITE_MAX];
+	u64 last_ens_valid[ISP_UNITE_MAX];
+
 	bool dhaz_en;
 	bool drc_en;
 	bool lsc_en;
@@ -212,6 +218,7 @@ struct rkisp_isp_params_val_v32 {
 	bool is_bigmode;
 	bool is_lo8x8;
 	bool is_sram;
+	bool is_lut_dirty;
 };
 
 #if IS_ENABLED(CONFIG_VIDEO_ROCKCHIP_ISP_VERSION_V32)
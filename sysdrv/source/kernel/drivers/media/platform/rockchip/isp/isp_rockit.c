@@ -3,6 +3,7 @@
 
 #define pr_fmt(fmt) "isp_rockit: %s:%d " fmt, __func__, __LINE__
 
+#include <linux/dma-buf.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <soc/rockchip/rockchip_rockit.h>
@@ -22,6 +23,9 @@ struct rkisp_rockit_buffer {
 	int buf_id;
 	u32 buff_addr;
 	void *vaddr;
+	/* hold by share user, and rockit queue it again when hold */
+	bool is_share;
+	bool is_share_wait;
 };
 
 static struct rkisp_stream *rkisp_rockit_get_stream(struct rockit_cfg *input_rockit_cfg)
@@ -128,6 +132,7 @@ int rkisp_rockit_buf_queue(struct rockit_cfg *input_rockit_cfg)
 					pr_err("rkisp_buff alloc failed!\n");
 					return -ENOMEM;
 				}
+				isprk_buf->buf_id = i;
 				break;
 			}
 		}
@@ -237,12 +242,137 @@ int rkisp_rockit_buf_queue(struct rockit_cfg *input_rockit_cfg)
 		 stream->id, isprk_buf,
 		 isprk_buf->isp_buf.buff_addr[0], isprk_buf->isp_buf.buff_addr[1]);
 
-	list_add_tail(&isprk_buf->isp_buf.queue, &stream->buf_queue);
+	/* share user still reading, queue to isp after share qbuf */
+	if (isprk_buf->is_share)
+		isprk_buf->is_share_wait = true;
+	else
+		list_add_tail(&isprk_buf->isp_buf.queue, &stream->buf_queue);
+	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+
+	return 0;
+}
+
+static void rkisp_rockit_share_frame(struct rkisp_stream *stream,
+				     struct rkisp_rockit_buffer *isprk_buf)
+{
+	struct rkisp_share *share = &stream->share;
+	struct v4l2_event ev = {
+		.type = RKISP_V4L2_EVENT_SHARE_READY,
+	};
+	unsigned long lock_flags = 0;
+
+	if (!share->max)
+		return;
+
+	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+	if (share->cnt >= share->max || isprk_buf->is_share) {
+		share->drop++;
+		spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+		return;
+	}
+	isprk_buf->is_share = true;
+	share->cnt++;
+	list_add_tail(&isprk_buf->queue, &share->ready);
+	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+
+	v4l2_event_queue(&stream->vnode.vdev, &ev);
+}
+
+/* release share buf, vbq_lock held */
+static void rkisp_rockit_share_put(struct rkisp_stream *stream,
+				   struct rkisp_rockit_buffer *isprk_buf,
+				   bool is_requeue)
+{
+	list_del_init(&isprk_buf->queue);
+	isprk_buf->is_share = false;
+	stream->share.cnt--;
+	if (isprk_buf->is_share_wait) {
+		isprk_buf->is_share_wait = false;
+		if (is_requeue)
+			list_add_tail(&isprk_buf->isp_buf.queue, &stream->buf_queue);
+	}
+}
+
+static void rkisp_rockit_share_clear(struct rkisp_stream *stream, bool is_requeue)
+{
+	struct rkisp_rockit_buffer *isprk_buf, *tmp;
+	unsigned long lock_flags = 0;
+
+	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+	list_for_each_entry_safe(isprk_buf, tmp, &stream->share.ready, queue)
+		rkisp_rockit_share_put(stream, isprk_buf, is_requeue);
+	list_for_each_entry_safe(isprk_buf, tmp, &stream->share.held, queue)
+		rkisp_rockit_share_put(stream, isprk_buf, is_requeue);
+	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+}
+
+int rkisp_rockit_share_set(struct rkisp_stream *stream, int max)
+{
+	if (max < 0 || max > ROCKIT_BUF_NUM_MAX ||
+	    stream->id >= ROCKIT_STREAM_NUM_MAX)
+		return -EINVAL;
+
+	stream->share.max = max;
+	stream->share.drop = 0;
+	if (!max)
+		rkisp_rockit_share_clear(stream, true);
+	return 0;
+}
+
+int rkisp_rockit_share_dqbuf(struct rkisp_stream *stream, struct rkisp_share_buf *buf)
+{
+	struct rkisp_rockit_buffer *isprk_buf;
+	unsigned long lock_flags = 0;
+	int fd;
+
+	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+	if (list_empty(&stream->share.ready)) {
+		spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+		return -EAGAIN;
+	}
+	isprk_buf = list_first_entry(&stream->share.ready,
+				     struct rkisp_rockit_buffer, queue);
+	list_move_tail(&isprk_buf->queue, &stream->share.held);
+	get_dma_buf(isprk_buf->dmabuf);
+	buf->index = isprk_buf->buf_id;
+	buf->sequence = isprk_buf->isp_buf.vb.sequence;
+	buf->timestamp = isprk_buf->isp_buf.vb.vb2_buf.timestamp;
+	buf->width = stream->out_fmt.width;
+	buf->height = stream->out_fmt.height;
+	buf->bytesperline = stream->out_fmt.plane_fmt[0].bytesperline;
+	buf->size = isprk_buf->dmabuf->size;
+	buf->offset[0] = isprk_buf->isp_buf.buff_addr[0] - isprk_buf->buff_addr;
+	buf->offset[1] = isprk_buf->isp_buf.buff_addr[1] - isprk_buf->buff_addr;
 	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
 
+	fd = dma_buf_fd(isprk_buf->dmabuf, O_CLOEXEC);
+	if (fd < 0) {
+		dma_buf_put(isprk_buf->dmabuf);
+		rkisp_rockit_share_qbuf(stream, buf);
+		return fd;
+	}
+	buf->fd = fd;
 	return 0;
 }
 
+int rkisp_rockit_share_qbuf(struct rkisp_stream *stream, struct rkisp_share_buf *buf)
+{
+	struct rkisp_rockit_buffer *isprk_buf;
+	unsigned long lock_flags = 0;
+	int ret = -EINVAL;
+
+	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+	list_for_each_entry(isprk_buf, &stream->share.held, queue) {
+		if (isprk_buf->buf_id == buf->index) {
+			rkisp_rockit_share_put(stream, isprk_buf, true);
+			ret = 0;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+	return ret;
+}
+
 int rkisp_rockit_buf_done(struct rkisp_stream *stream, int cmd)
 {
 	struct rkisp_device *dev = stream->ispdev;
@@ -262,6 +392,7 @@ int rkisp_rockit_buf_done(struct rkisp_stream *stream, int cmd)
 			container_of(stream->curr_buf, struct rkisp_rockit_buffer, isp_buf);
 
 		rockit_cfg->mpibuf = isprk_buf->mpi_buf;
+		rkisp_rockit_share_frame(stream, isprk_buf);
 
 		rockit_cfg->frame.u64PTS = stream->curr_buf->vb.vb2_buf.timestamp;
 
@@ -561,6 +692,8 @@ int rkisp_rockit_buf_free(struct rkisp_stream *stream)
 	if (!rockit_cfg || stream->id >= ROCKIT_STREAM_NUM_MAX)
 		return -EINVAL;
 
+	/* buffers to free, no requeue */
+	rkisp_rockit_share_clear(stream, false);
 	stream_cfg = &rockit_cfg->rkisp_dev_cfg[dev_id].rkisp_stream_cfg[stream->id];
 	mutex_lock(&stream_cfg->freebuf_lock);
 	for (i = 0; i < ROCKIT_BUF_NUM_MAX; i++) {
@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: GPL-2.0
 /* Copyright (c) 2019 Fuzhou Rockchip Electronics Co., Ltd. */
 
+#include <linux/eventfd.h>
 #include <linux/kfifo.h>
+#include <linux/vmalloc.h>
 #include <media/v4l2-common.h>
 #include <media/v4l2-ioctl.h>
 #include <media/videobuf2-core.h>
@@ -346,6 +348,145 @@ void rkisp_stats_isr(struct rkisp_isp_stats_vdev *stats_vdev,
 	stats_vdev->ops->isr_hdl(stats_vdev, isp_ris, isp3a_ris);
 }
 
+static void rkisp_stats_ring_free(struct rkisp_isp_stats_vdev *stats_vdev)
+{
+	struct rkisp_dummy_buffer ring_buf;
+	struct eventfd_ctx *efd;
+	unsigned long flags;
+	void *tmp;
+
+	spin_lock_irqsave(&stats_vdev->irq_lock, flags);
+	ring_buf = stats_vdev->ring_buf;
+	efd = stats_vdev->ring_efd;
+	tmp = stats_vdev->ring_tmp;
+	memset(&stats_vdev->ring_buf, 0, sizeof(stats_vdev->ring_buf));
+	stats_vdev->ring_efd = NULL;
+	stats_vdev->ring_tmp = NULL;
+	stats_vdev->ring_slot_num = 0;
+	stats_vdev->ring_slot_size = 0;
+	stats_vdev->ring_slot_offset = 0;
+	stats_vdev->ring_write_cnt = 0;
+	spin_unlock_irqrestore(&stats_vdev->irq_lock, flags);
+
+	if (ring_buf.mem_priv)
+		rkisp_free_buffer(stats_vdev->dev, &ring_buf);
+	if (efd)
+		eventfd_ctx_put(efd);
+	vfree(tmp);
+}
+
+int rkisp_stats_ring_cfg(struct rkisp_isp_stats_vdev *stats_vdev,
+			 struct rkisp_stats_ring_cfg *cfg)
+{
+	struct rkisp_device *dev = stats_vdev->dev;
+	struct rkisp_dummy_buffer ring_buf = { 0 };
+	struct rkisp_stats_ring_head *head;
+	struct eventfd_ctx *efd = NULL;
+	unsigned long flags;
+	u32 size = 0, slot_size;
+	void *tmp = NULL;
+	int ret;
+
+	if (dev->isp_ver != ISP_V32 && dev->isp_ver != ISP_V32_L)
+		return -EINVAL;
+
+	rkisp_stats_ring_free(stats_vdev);
+	cfg->buf_fd = -1;
+	cfg->buf_size = 0;
+	if (!cfg->slot_num)
+		return 0;
+	if (cfg->slot_num > RKISP_STATS_RING_SLOT_MAX)
+		cfg->slot_num = RKISP_STATS_RING_SLOT_MAX;
+
+	if (cfg->event_fd >= 0) {
+		efd = eventfd_ctx_fdget(cfg->event_fd);
+		if (IS_ERR(efd)) {
+			v4l2_err(&dev->v4l2_dev, "stats ring invalid eventfd:%d\n",
+				 cfg->event_fd);
+			return PTR_ERR(efd);
+		}
+	}
+
+	stats_vdev->ops->get_stat_size(stats_vdev, &size);
+	/* lite version no to ddr, read to tmp if no vb2 buffer */
+	if (dev->isp_ver == ISP_V32_L) {
+		tmp = vzalloc(size);
+		if (!tmp) {
+			ret = -ENOMEM;
+			goto err;
+		}
+	}
+
+	slot_size = ALIGN(sizeof(struct rkisp_stats_ring_slot) + size, 64);
+	ring_buf.size = ALIGN(sizeof(*head), 64) + slot_size * cfg->slot_num;
+	ring_buf.is_need_vaddr = true;
+	ring_buf.is_need_dbuf = true;
+	ring_buf.is_need_dmafd = true;
+	ret = rkisp_alloc_buffer(dev, &ring_buf);
+	if (ret)
+		goto err;
+	memset(ring_buf.vaddr, 0, ring_buf.size);
+	head = ring_buf.vaddr;
+	head->slot_num = cfg->slot_num;
+	head->slot_size = slot_size;
+	head->slot_offset = ALIGN(sizeof(*head), 64);
+	cfg->buf_fd = ring_buf.dma_fd;
+	cfg->buf_size = ring_buf.size;
+
+	spin_lock_irqsave(&stats_vdev->irq_lock, flags);
+	stats_vdev->ring_buf = ring_buf;
+	stats_vdev->ring_efd = efd;
+	stats_vdev->ring_tmp = tmp;
+	stats_vdev->ring_slot_num = head->slot_num;
+	stats_vdev->ring_slot_size = head->slot_size;
+	stats_vdev->ring_slot_offset = head->slot_offset;
+	stats_vdev->ring_write_cnt = 0;
+	spin_unlock_irqrestore(&stats_vdev->irq_lock, flags);
+	v4l2_dbg(1, rkisp_debug, &dev->v4l2_dev,
+		 "stats ring slot:%d size:%d fd:%d\n",
+		 cfg->slot_num, cfg->buf_size, cfg->buf_fd);
+	return 0;
+err:
+	vfree(tmp);
+	if (efd)
+		eventfd_ctx_put(efd);
+	return ret;
+}
+
+/* copy stats to ring, call with irq_lock held */
+void rkisp_stats_ring_push(struct rkisp_isp_stats_vdev *stats_vdev,
+			   const void *data, u32 size, u32 frame_id, u64 timestamp)
+{
+	struct rkisp_stats_ring_head *head = stats_vdev->ring_buf.vaddr;
+	struct rkisp_stats_ring_slot *slot;
+	u32 idx, seq;
+
+	if (!head || !data || !stats_vdev->ring_slot_num)
+		return;
+
+	if (size > stats_vdev->ring_slot_size - sizeof(*slot))
+		size = stats_vdev->ring_slot_size - sizeof(*slot);
+	idx = stats_vdev->ring_write_cnt % stats_vdev->ring_slot_num;
+	slot = (void *)head + stats_vdev->ring_slot_offset +
+	       idx * stats_vdev->ring_slot_size;
+	/* each slot is written every slot_num pushes, two seq steps per write */
+	seq = (stats_vdev->ring_write_cnt / stats_vdev->ring_slot_num) * 2;
+
+	WRITE_ONCE(slot->seq, seq + 1);
+	smp_wmb();
+	slot->frame_id = frame_id;
+	slot->timestamp = timestamp;
+	slot->size = size;
+	memcpy(slot + 1, data, size);
+	smp_wmb();
+	WRITE_ONCE(slot->seq, seq + 2);
+	stats_vdev->ring_write_cnt++;
+	WRITE_ONCE(head->write_cnt, stats_vdev->ring_write_cnt);
+
+	if (stats_vdev->ring_efd)
+		eventfd_signal(stats_vdev->ring_efd, 1);
+}
+
 int rkisp_register_stats_vdev(struct rkisp_isp_stats_vdev *stats_vdev,
 			      struct v4l2_device *v4l2_dev,
 			      struct rkisp_device *dev)
@@ -427,6 +568,7 @@ void rkisp_unregister_stats_vdev(struct rkisp_isp_stats_vdev *stats_vdev)
 
 	kfifo_free(&stats_vdev->rd_kfifo);
 	tasklet_kill(&stats_vdev->rd_tasklet);
+	rkisp_stats_ring_free(stats_vdev);
 	video_unregister_device(vdev);
 	media_entity_cleanup(&vdev->entity);
 	vb2_queue_release(vdev->queue);
@@ -5,6 +5,7 @@
 #define _RKISP_ISP_STATS_H
 
 #include <linux/rk-isp1-config.h>
+#include <linux/rk-isp2-config.h>
 #include <linux/interrupt.h>
 #include <linux/kfifo.h>
 #include "common.h"
@@ -77,6 +78,18 @@ struct rkisp_isp_stats_vdev {
 
 	bool af_meas_done_next;
 	bool ae_meas_done_next;
+
+	/* mmap ring for 3a stats, protect by irq_lock.
+	 * The ring is shared with userspace, so its geometry and write
+	 * count are kept here and never read back from the ring head.
+	 */
+	struct rkisp_dummy_buffer ring_buf;
+	struct eventfd_ctx *ring_efd;
+	void *ring_tmp;
+	u32 ring_slot_num;
+	u32 ring_slot_size;
+	u32 ring_slot_offset;
+	u32 ring_write_cnt;
 };
 
 void rkisp_stats_rdbk_enable(struct rkisp_isp_stats_vdev *stats_vdev, bool en);
@@ -87,6 +100,11 @@ void rkisp_stats_next_ddr_config(struct rkisp_isp_stats_vdev *stats_vdev);
 void rkisp_stats_isr(struct rkisp_isp_stats_vdev *stats_vdev,
 		     u32 isp_ris, u32 isp3a_ris);
 
+int rkisp_stats_ring_cfg(struct rkisp_isp_stats_vdev *stats_vdev,
+			 struct rkisp_stats_ring_cfg *cfg);
+void rkisp_stats_ring_push(struct rkisp_isp_stats_vdev *stats_vdev,
+			   const void *data, u32 size, u32 frame_id, u64 timestamp);
+
 int rkisp_register_stats_vdev(struct rkisp_isp_stats_vdev *stats_vdev,
 			       struct v4l2_device *v4l2_dev,
 			       struct rkisp_device *dev);
@@ -657,10 +657,16 @@ rkisp_stats_send_meas(struct rkisp_isp_stats_vdev *stats_vdev,
 		cur_stat_buf->params.info2ddr.owner = 0;
 		rkisp_stats_info2ddr(stats_vdev, cur_stat_buf);
 
+		rkisp_stats_ring_push(stats_vdev, cur_buf->vaddr[0], size,
+				      cur_frame_id, meas_work->timestamp);
 		vb2_set_plane_payload(&cur_buf->vb.vb2_buf, 0, size);
 		cur_buf->vb.sequence = cur_frame_id;
 		cur_buf->vb.vb2_buf.timestamp = meas_work->timestamp;
 		vb2_buffer_done(&cur_buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+	} else if (is_dummy) {
+		/* no vb2 buffer, stats in dummy buf still to ring */
+		rkisp_stats_ring_push(stats_vdev, stats_vdev->stats_buf[0].vaddr, size,
+				      cur_frame_id, meas_work->timestamp);
 	}
 	v4l2_dbg(4, rkisp_debug, &dev->v4l2_dev,
 		 "%s id:%d seq:%d params_id:%d ris:0x%x buf:%p meas_type:0x%x\n",
@@ -925,6 +931,7 @@ rkisp_stats_send_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 	struct rkisp_buffer *cur_buf = stats_vdev->cur_buf;
 	struct rkisp32_lite_stat_buffer *cur_stat_buf = NULL;
 	u32 size = stats_vdev->vdev_fmt.fmt.meta.buffersize;
+	bool is_tmp = false;
 
 	if (hw->unite != ISP_UNITE_ONE || dev->unite_index == ISP_UNITE_LEFT) {
 		spin_lock(&stats_vdev->rd_lock);
@@ -947,6 +954,17 @@ rkisp_stats_send_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 		cur_stat_buf->params_id = params_vdev->cur_frame_id;
 		cur_stat_buf->params.info2ddr.buf_fd = -1;
 		cur_stat_buf->params.info2ddr.owner = 0;
+	} else if (stats_vdev->ring_tmp) {
+		/* no vb2 buffer, read to tmp for stats ring */
+		cur_stat_buf = stats_vdev->ring_tmp;
+		if (dev->unite_index == ISP_UNITE_LEFT)
+			memset(cur_stat_buf, 0, size);
+		cur_stat_buf += dev->unite_index;
+		cur_stat_buf->frame_id = cur_frame_id;
+		cur_stat_buf->params_id = params_vdev->cur_frame_id;
+		cur_stat_buf->params.info2ddr.buf_fd = -1;
+		cur_stat_buf->params.info2ddr.owner = 0;
+		is_tmp = true;
 	}
 
 	if (meas_work->isp3a_ris & ISP3X_3A_RAWAWB)
@@ -976,11 +994,18 @@ rkisp_stats_send_meas_lite(struct rkisp_isp_stats_vdev *stats_vdev,
 
 	if (cur_buf) {
 		rkisp_stats_info2ddr(stats_vdev, cur_stat_buf);
+		rkisp_stats_ring_push(stats_vdev, cur_buf->vaddr[0], size,
+				      cur_frame_id, meas_work->timestamp);
 		vb2_set_plane_payload(&cur_buf->vb.vb2_buf, 0, size);
 		cur_buf->vb.sequence = cur_frame_id;
 		cur_buf->vb.vb2_buf.timestamp = meas_work->timestamp;
 		vb2_buffer_done(&cur_buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
 		stats_vdev->cur_buf = NULL;
+	} else if (is_tmp &&
+		   !((dev->unite_div == ISP_UNITE_DIV2 && dev->unite_index != ISP_UNITE_RIGHT) ||
+		     (dev->unite_div == ISP_UNITE_DIV4 && dev->unite_index != ISP_UNITE_RIGHT_B))) {
+		rkisp_stats_ring_push(stats_vdev, stats_vdev->ring_tmp, size,
+				      cur_frame_id, meas_work->timestamp);
 	}
 	v4l2_dbg(4, rkisp_debug, &dev->v4l2_dev,
 		 "%s seq:%d params_id:%d ris:0x%x buf:%p meas_type:0x%x\n",
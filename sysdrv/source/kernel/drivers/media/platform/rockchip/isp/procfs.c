@@ -828,6 +828,23 @@ static void isp32_show(struct rkisp_device *dev, struct seq_file *p)
 		   !!(val & BIT(3)), !!(val & BIT(2)), !!(val & BIT(1)), !!(val & BIT(0)));
 }
 
+static void rkisp_show_latency(struct seq_file *p, const char *name, u32 *hist)
+{
+	u32 i, cnt = 0;
+
+	for (i = 0; i < RKISP_LAT_HIST_BUCKETS; i++)
+		cnt += hist[i];
+	if (!cnt)
+		return;
+	/* bucket label is the lower bound in us */
+	seq_printf(p, "\t   %s(us) cnt:%d", name, cnt);
+	for (i = 0; i < RKISP_LAT_HIST_BUCKETS; i++) {
+		if (hist[i])
+			seq_printf(p, " %d:%d", i ? 1 << (i - 1) : 0, hist[i]);
+	}
+	seq_puts(p, "\n");
+}
+
 static int isp_show(struct seq_file *p, void *v)
 {
 	struct rkisp_device *dev = p->private;
@@ -883,6 +900,13 @@ static int isp_show(struct seq_file *p, void *v)
 		seq_printf(p, "\t   hw link:%d idle:%d vir(mode:%d index:%d)\n",
 			   dev->hw_dev->dev_link_num, dev->hw_dev->is_idle,
 			   dev->multi_mode, dev->multi_index);
+		if (!dev->hw_dev->is_single)
+			seq_printf(p, "\t   sched(prio:%d fps:%d) out:%d.%02dfps delay:%lluus max:%lluus over:%d\n",
+				   dev->sched.prio, dev->sched.fps,
+				   dev->sched.fps_out / 100, dev->sched.fps_out % 100,
+				   div_u64(dev->sched.delay_ns, 1000),
+				   div_u64(dev->sched.delay_max_ns, 1000),
+				   dev->sched.over_cnt);
 	} else {
 		seq_printf(p, "%-10s frame:%d state:%s time:%dms v-blank:%dus\n",
 			   "Isp online",
@@ -925,6 +949,19 @@ static int isp_show(struct seq_file *p, void *v)
 			   stream->dbg.delay / 1000 / 1000,
 			   stream->dbg.frameloss,
 			   rkisp_stream_buf_cnt(stream));
+		if (dev->isp_ver == ISP_V32 || dev->isp_ver == ISP_V32_L)
+			seq_printf(p, "\t   starve policy:%s gate:%d keep:%d dummy:%d\n",
+				   stream->starve_policy == RKISP_STARVE_KEEP ? "keep" :
+				   (stream->starve_policy == RKISP_STARVE_DUMMY ? "dummy" : "gate"),
+				   stream->starve_cnt.gate,
+				   stream->starve_cnt.keep,
+				   stream->starve_cnt.dummy);
+		if (stream->share.max)
+			seq_printf(p, "\t   share max:%d cnt:%d drop:%d\n",
+				   stream->share.max, stream->share.cnt,
+				   stream->share.drop);
+		rkisp_show_latency(p, "sof->done", stream->lat.sof_done);
+		rkisp_show_latency(p, "done->dqbuf", stream->lat.done_dqbuf);
 	}
 
 	switch (dev->isp_ver) {
@@ -34,6 +34,7 @@
 
 #include <linux/clk.h>
 #include <linux/compat.h>
+#include <linux/crc32.h>
 #include <linux/iopoll.h>
 #include <linux/pm_runtime.h>
 #include <linux/regmap.h>
@@ -52,6 +53,7 @@
 #include "isp_external.h"
 #include "regs.h"
 #include "rkisp_tb_helper.h"
+#include "rkisp_trace.h"
 
 #define ISP_V4L2_EVENT_ELEMS 4
 
@@ -908,16 +910,84 @@ static void rkisp_fast_switch_rx_buf(struct rkisp_device *dev, bool is_current)
 	}
 }
 
+/* readback over target fps of device */
+static bool rkisp_sched_is_over(struct rkisp_device *dev, u64 now)
+{
+	struct rkisp_sched *sched = &dev->sched;
+
+	if (!sched->fps || !sched->last_ns || now < sched->last_ns)
+		return false;
+	return now - sched->last_ns < div_u64(NSEC_PER_SEC, sched->fps);
+}
+
+/* deadline of the oldest frame in fifo is one frame interval after it ready */
+static u64 rkisp_sched_deadline(struct rkisp_device *dev, u64 frame_ns)
+{
+	u32 fps = dev->sched.fps ? dev->sched.fps : 30;
+
+	return frame_ns + div_u64(NSEC_PER_SEC, fps);
+}
+
+static void rkisp_sched_update(struct rkisp_device *dev, u64 frame_ns, u64 now, bool is_over)
+{
+	struct rkisp_sched *sched = &dev->sched;
+	u64 val;
+
+	sched->delay_ns = now > frame_ns ? now - frame_ns : 0;
+	if (sched->delay_ns > sched->delay_max_ns)
+		sched->delay_max_ns = sched->delay_ns;
+	if (is_over)
+		sched->over_cnt++;
+	sched->last_ns = now;
+	if (!sched->fps_ns)
+		sched->fps_ns = now;
+	sched->fps_cnt++;
+	val = now - sched->fps_ns;
+	if (val >= NSEC_PER_SEC) {
+		sched->fps_out = div64_u64((u64)sched->fps_cnt * NSEC_PER_SEC * 100, val);
+		sched->fps_ns = now;
+		sched->fps_cnt = 0;
+	}
+}
+
+static void rkisp_get_sched(struct rkisp_device *dev, struct rkisp_sched_cfg *cfg)
+{
+	struct rkisp_hw_dev *hw = dev->hw_dev;
+	unsigned long lock_flags = 0;
+
+	spin_lock_irqsave(&hw->rdbk_lock, lock_flags);
+	cfg->prio = dev->sched.prio;
+	cfg->fps = dev->sched.fps;
+	spin_unlock_irqrestore(&hw->rdbk_lock, lock_flags);
+}
+
+/* under rdbk_lock of hw, readback schedule may run for other device */
+static int rkisp_set_sched(struct rkisp_device *dev, struct rkisp_sched_cfg *cfg)
+{
+	struct rkisp_hw_dev *hw = dev->hw_dev;
+	unsigned long lock_flags = 0;
+
+	if (cfg->prio > RKISP_SCHED_PRIO_MAX || cfg->fps > RKISP_SCHED_FPS_MAX)
+		return -EINVAL;
+
+	spin_lock_irqsave(&hw->rdbk_lock, lock_flags);
+	dev->sched.prio = cfg->prio;
+	dev->sched.fps = cfg->fps;
+	spin_unlock_irqrestore(&hw->rdbk_lock, lock_flags);
+	return 0;
+}
+
 static void rkisp_rdbk_trigger_handle(struct rkisp_device *dev, u32 cmd)
 {
 	struct rkisp_hw_dev *hw = dev->hw_dev;
 	struct rkisp_device *isp = NULL;
 	struct isp2x_csi_trigger t = { 0 };
 	unsigned long lock_flags = 0;
-	int i, times = -1, max = 0, id = 0;
+	int i, times = -1, max = 0, id = -1;
 	int len[DEV_MAX] = { 0 };
+	u64 now, deadline, best_deadline = 0;
 	u32 mode = 0;
-	bool is_try = false;
+	bool is_try = false, is_over, best_over = false;
 
 	spin_lock_irqsave(&hw->rdbk_lock, lock_flags);
 	if (cmd == T_CMD_END) {
@@ -953,27 +1023,46 @@ static void rkisp_rdbk_trigger_handle(struct rkisp_device *dev, u32 cmd)
 		goto end;
 	}
 
+	/* pick order: under fps target, higher priority, earlier deadline */
+	now = rkisp_time_get_ns(dev);
 	for (i = 0; i < hw->dev_num; i++) {
 		isp = hw->isp[i];
 		if (!isp ||
 		    (isp && (!(isp->isp_state & ISP_START) || isp->is_suspend)))
 			continue;
 		rkisp_rdbk_trigger_event(isp, T_CMD_LEN, &len[i]);
-		if (max < len[i]) {
+		if (!len[i] || rkisp_rdbk_trigger_event(isp, T_CMD_PEEK, &t) < 0)
+			continue;
+		if (max < len[i])
 			max = len[i];
-			id = i;
+		is_over = rkisp_sched_is_over(isp, now);
+		deadline = rkisp_sched_deadline(isp, t.frame_timestamp);
+		if (id >= 0) {
+			if (is_over != best_over) {
+				if (is_over)
+					continue;
+			} else if (isp->sched.prio != hw->isp[id]->sched.prio) {
+				if (isp->sched.prio < hw->isp[id]->sched.prio)
+					continue;
+			} else if (deadline >= best_deadline) {
+				continue;
+			}
 		}
+		id = i;
+		best_over = is_over;
+		best_deadline = deadline;
 	}
 
 	/* wait 2 frame to start isp for fast */
 	if (dev->is_rtt_first && max == 1 && !atomic_read(&dev->isp_sdev.frm_sync_seq))
 		goto end;
 
-	if (max) {
+	if (max && id >= 0) {
 		isp = hw->isp[id];
 		v4l2_dbg(2, rkisp_debug, &isp->v4l2_dev,
-			 "trigger fifo len:%d\n", max);
+			 "trigger fifo len:%d over:%d\n", len[id], best_over);
 		rkisp_rdbk_trigger_event(isp, T_CMD_DEQUEUE, &t);
+		rkisp_sched_update(isp, t.frame_timestamp, now, best_over);
 		isp->dmarx_dev.pre_frame = isp->dmarx_dev.cur_frame;
 		if (t.frame_id > isp->dmarx_dev.pre_frame.id &&
 		    t.frame_id - isp->dmarx_dev.pre_frame.id > 1)
@@ -1062,6 +1151,12 @@ int rkisp_rdbk_trigger_event(struct rkisp_device *dev, u32 cmd, void *arg)
 		val = kfifo_len(fifo) / sizeof(struct isp2x_csi_trigger);
 		*(u32 *)arg = val;
 		break;
+	case T_CMD_PEEK:
+		if (!kfifo_is_empty(fifo))
+			ret = kfifo_out_peek(fifo, arg, sizeof(struct isp2x_csi_trigger));
+		if (!ret)
+			ret = -EINVAL;
+		break;
 	default:
 		break;
 	}
@@ -1972,6 +2067,9 @@ static void rkisp_start_3a_run(struct rkisp_device *dev)
 	/* thunderboot no need to wait aiq first param */
 	if (dev->is_pre_on)
 		return;
+	/* first param from warm snapshot, aiq param to apply as next */
+	if (rkisp_warm_restore(dev))
+		return;
 	/* rk3326/px30 require first params queued before
 	 * rkisp_params_configure_isp() called
 	 */
@@ -2123,6 +2221,14 @@ end:
 	dev->sw_rd_cnt = 0;
 	dev->stats_vdev.rdbk_drop = false;
 	rkisp_set_state(&dev->isp_state, ISP_STOP);
+	/* keep schedule config, statistics for next stream */
+	dev->sched.last_ns = 0;
+	dev->sched.fps_ns = 0;
+	dev->sched.fps_cnt = 0;
+	dev->sched.fps_out = 0;
+	dev->sched.delay_ns = 0;
+	dev->sched.delay_max_ns = 0;
+	dev->sched.over_cnt = 0;
 
 	if (dev->isp_ver >= ISP_V20)
 		kfifo_reset(&dev->rdbk_kfifo);
@@ -2923,6 +3029,7 @@ static int rkisp_isp_sd_s_stream(struct v4l2_subdev *sd, int on)
 			v4l2_warn(&isp_dev->v4l2_dev, "%s wait timeout, mode:%d state:0x%x\n",
 				  __func__, isp_dev->rd_mode, isp_dev->isp_state);
 		rkisp_isp_stop(isp_dev);
+		rkisp_warm_save(isp_dev);
 		atomic_dec(&hw_dev->refcnt);
 		rkisp_params_stream_stop(&isp_dev->params_vdev);
 		atomic_set(&isp_dev->isp_sdev.frm_sync_seq, 0);
@@ -3393,12 +3500,15 @@ static int rkisp_subdev_fmt_link_validate(struct v4l2_subdev *sd,
 void
 rkisp_isp_queue_event_sof(struct rkisp_isp_subdev *isp)
 {
+	struct rkisp_device *dev = container_of(isp, struct rkisp_device, isp_sdev);
 	struct v4l2_event event = {
 		.type = V4L2_EVENT_FRAME_SYNC,
 		.u.frame_sync.frame_sequence =
 			atomic_inc_return(&isp->frm_sync_seq) - 1,
 	};
 
+	trace_rkisp_frame_start(dev->dev_id, event.u.frame_sync.frame_sequence,
+				isp->frm_timestamp);
 	v4l2_event_queue(isp->sd.devnode, &event);
 }
 
@@ -3527,6 +3637,7 @@ static long rkisp_ioctl(struct v4l2_subdev *sd, unsigned int cmd, void *arg)
 	struct rkisp_thunderboot_shmem *shmem;
 	struct isp2x_buf_idxfd *idxfd;
 	struct rkisp_rx_buf *dbufs;
+	struct rkisp_warm_info *warm;
 	void *resmem_va;
 	long ret = 0;
 
@@ -3661,6 +3772,24 @@ static long rkisp_ioctl(struct v4l2_subdev *sd, unsigned int cmd, void *arg)
 	case RKISP_CMD_GET_BAY3D_BUFFD:
 		rkisp_params_get_bay3d_buffd(&isp_dev->params_vdev, arg);
 		break;
+	case RKISP_CMD_STATS_RING_CFG:
+		ret = rkisp_stats_ring_cfg(&isp_dev->stats_vdev, arg);
+		break;
+	case RKISP_CMD_GET_SCHED:
+		rkisp_get_sched(isp_dev, arg);
+		break;
+	case RKISP_CMD_SET_SCHED:
+		ret = rkisp_set_sched(isp_dev, arg);
+		break;
+	case RKISP_CMD_GET_WARM_INFO:
+		warm = arg;
+		warm->valid = isp_dev->warm.is_valid;
+		warm->frame_id = isp_dev->warm.frame_id;
+		warm->ae = isp_dev->warm.ae;
+		break;
+	case RKISP_CMD_SET_WARM_AE:
+		isp_dev->warm.ae = *(struct rkisp_warm_ae *)arg;
+		break;
 	default:
 		ret = -ENOIOCTLCMD;
 	}
@@ -3740,6 +3869,27 @@ static long rkisp_compat_ioctl32(struct v4l2_subdev *sd,
 		size = sizeof(struct rkisp_bay3dbuf_info);
 		cp_t_us = true;
 		break;
+	case RKISP_CMD_STATS_RING_CFG:
+		size = sizeof(struct rkisp_stats_ring_cfg);
+		cp_f_us = true;
+		cp_t_us = true;
+		break;
+	case RKISP_CMD_GET_SCHED:
+		size = sizeof(struct rkisp_sched_cfg);
+		cp_t_us = true;
+		break;
+	case RKISP_CMD_SET_SCHED:
+		size = sizeof(struct rkisp_sched_cfg);
+		cp_f_us = true;
+		break;
+	case RKISP_CMD_GET_WARM_INFO:
+		size = sizeof(struct rkisp_warm_info);
+		cp_t_us = true;
+		break;
+	case RKISP_CMD_SET_WARM_AE:
+		size = sizeof(struct rkisp_warm_ae);
+		cp_f_us = true;
+		break;
 	default:
 		return -ENOIOCTLCMD;
 	}
@@ -3961,6 +4111,92 @@ void rkisp_save_tb_info(struct rkisp_device *isp_dev)
 	memcpy(&isp_dev->tb_head, head, sizeof(*head));
 }
 
+static u32 rkisp_warm_crc(struct rkisp_warm_head *head)
+{
+	u32 offset = offsetof(struct rkisp_warm_head, isp_ver);
+
+	return crc32_le(~0, (u8 *)head + offset,
+			sizeof(*head) - offset + head->size);
+}
+
+/* save last applied params and ae to reserved memory for warm resume */
+void rkisp_warm_save(struct rkisp_device *isp_dev)
+{
+	struct rkisp_isp_params_vdev *params_vdev = &isp_dev->params_vdev;
+	struct rkisp_warm_head *head = isp_dev->warm.va;
+	int size;
+
+	if (!head || !params_vdev->ops || !params_vdev->ops->get_last_param)
+		return;
+
+	head->magic = 0;
+	size = params_vdev->ops->get_last_param(params_vdev, head + 1,
+						isp_dev->warm.size - sizeof(*head));
+	if (size <= 0)
+		return;
+	head->version = RKISP_WARM_VERSION;
+	head->size = size;
+	head->isp_ver = isp_dev->isp_ver;
+	head->dev_id = isp_dev->dev_id;
+	head->width = isp_dev->isp_sdev.in_crop.width;
+	head->height = isp_dev->isp_sdev.in_crop.height;
+	head->mbus_code = isp_dev->isp_sdev.in_fmt.mbus_code;
+	head->rd_mode = isp_dev->rd_mode;
+	head->frame_id = atomic_read(&isp_dev->isp_sdev.frm_sync_seq) - 1;
+	head->ae = isp_dev->warm.ae;
+	head->crc = rkisp_warm_crc(head);
+	wmb();
+	head->magic = RKISP_WARM_MAGIC;
+	v4l2_dbg(1, rkisp_debug, &isp_dev->v4l2_dev,
+		 "warm save seq:%u size:%d crc:0x%x\n",
+		 head->frame_id, size, head->crc);
+}
+
+/* first params from warm snapshot if it match current stream */
+bool rkisp_warm_restore(struct rkisp_device *isp_dev)
+{
+	struct rkisp_isp_params_vdev *params_vdev = &isp_dev->params_vdev;
+	struct rkisp_warm_head *head = isp_dev->warm.va;
+	struct rkisp_warm *warm = &isp_dev->warm;
+
+	warm->is_valid = false;
+	if (!head || !params_vdev->streamon || !params_vdev->first_params ||
+	    !params_vdev->ops || !params_vdev->ops->get_last_param)
+		return false;
+	if (head->magic != RKISP_WARM_MAGIC)
+		return false;
+
+	params_vdev->ops->get_param_size(params_vdev,
+		&params_vdev->vdev_fmt.fmt.meta.buffersize);
+	if (head->version != RKISP_WARM_VERSION ||
+	    head->isp_ver != isp_dev->isp_ver ||
+	    head->dev_id != isp_dev->dev_id ||
+	    head->size != params_vdev->vdev_fmt.fmt.meta.buffersize ||
+	    head->size > warm->size - sizeof(*head) ||
+	    head->width != isp_dev->isp_sdev.in_crop.width ||
+	    head->height != isp_dev->isp_sdev.in_crop.height ||
+	    head->mbus_code != isp_dev->isp_sdev.in_fmt.mbus_code ||
+	    head->rd_mode != isp_dev->rd_mode) {
+		v4l2_dbg(1, rkisp_debug, &isp_dev->v4l2_dev,
+			 "warm snapshot no match current stream\n");
+		return false;
+	}
+	if (head->crc != rkisp_warm_crc(head)) {
+		v4l2_warn(&isp_dev->v4l2_dev, "warm snapshot crc error\n");
+		head->magic = 0;
+		return false;
+	}
+
+	params_vdev->ops->save_first_param(params_vdev, head + 1);
+	params_vdev->is_first_cfg = true;
+	params_vdev->first_params = false;
+	warm->ae = head->ae;
+	warm->frame_id = head->frame_id;
+	warm->is_valid = true;
+	v4l2_info(&isp_dev->v4l2_dev, "warm resume from seq:%u\n", head->frame_id);
+	return true;
+}
+
 #ifdef CONFIG_VIDEO_ROCKCHIP_THUNDER_BOOT_ISP
 void rkisp_chk_tb_over(struct rkisp_device *isp_dev)
 {
@@ -4395,6 +4631,7 @@ vs_skip:
 		writel(ISP3X_OUT_FRM_HALF, base + CIF_ISP_ICR);
 		rkisp_dvbm_event(dev, ISP3X_OUT_FRM_HALF);
 		rkisp_stream_buf_done_early(dev);
+		rkisp_stream_slice_ready(dev);
 	}
 	if (isp_mis & ISP3X_OUT_FRM_END) {
 		writel(ISP3X_OUT_FRM_END, base + CIF_ISP_ICR);
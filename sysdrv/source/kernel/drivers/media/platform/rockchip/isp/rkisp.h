@@ -157,6 +157,9 @@ static inline void rkisp_chk_tb_over(struct rkisp_device *isp_dev) {}
 
 void rkisp_save_tb_info(struct rkisp_device *isp_dev);
 
+void rkisp_warm_save(struct rkisp_device *isp_dev);
+bool rkisp_warm_restore(struct rkisp_device *isp_dev);
+
 void rkisp_mipi_isr(unsigned int mipi_mis, struct rkisp_device *dev);
 
 void rkisp_mipi_v13_isr(unsigned int err1, unsigned int err2,
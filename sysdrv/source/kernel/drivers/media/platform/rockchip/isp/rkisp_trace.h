@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (c) 2023 Rockchip Electronics Co., Ltd. */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM rkisp
+
+#if !defined(_RKISP_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _RKISP_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(rkisp_frame_start,
+	TP_PROTO(int dev_id, u32 seq, u64 ts),
+	TP_ARGS(dev_id, seq, ts),
+	TP_STRUCT__entry(
+		__field(int, dev_id)
+		__field(u32, seq)
+		__field(u64, ts)
+	),
+	TP_fast_assign(
+		__entry->dev_id = dev_id;
+		__entry->seq = seq;
+		__entry->ts = ts;
+	),
+	TP_printk("isp%d seq:%u sof:%llu",
+		  __entry->dev_id, __entry->seq, __entry->ts)
+);
+
+DECLARE_EVENT_CLASS(rkisp_buf_class,
+	TP_PROTO(int dev_id, u32 stream_id, u32 seq, u64 ts, u64 latency),
+	TP_ARGS(dev_id, stream_id, seq, ts, latency),
+	TP_STRUCT__entry(
+		__field(int, dev_id)
+		__field(u32, stream_id)
+		__field(u32, seq)
+		__field(u64, ts)
+		__field(u64, latency)
+	),
+	TP_fast_assign(
+		__entry->dev_id = dev_id;
+		__entry->stream_id = stream_id;
+		__entry->seq = seq;
+		__entry->ts = ts;
+		__entry->latency = latency;
+	),
+	TP_printk("isp%d stream:%u seq:%u ts:%llu latency:%lluns",
+		  __entry->dev_id, __entry->stream_id, __entry->seq,
+		  __entry->ts, __entry->latency)
+);
+
+/* latency: since frame start */
+DEFINE_EVENT(rkisp_buf_class, rkisp_mi_frame_end,
+	TP_PROTO(int dev_id, u32 stream_id, u32 seq, u64 ts, u64 latency),
+	TP_ARGS(dev_id, stream_id, seq, ts, latency)
+);
+
+/* latency: since frame start */
+DEFINE_EVENT(rkisp_buf_class, rkisp_buf_done,
+	TP_PROTO(int dev_id, u32 stream_id, u32 seq, u64 ts, u64 latency),
+	TP_ARGS(dev_id, stream_id, seq, ts, latency)
+);
+
+/* latency: since buffer done */
+DEFINE_EVENT(rkisp_buf_class, rkisp_buf_dqbuf,
+	TP_PROTO(int dev_id, u32 stream_id, u32 seq, u64 ts, u64 latency),
+	TP_ARGS(dev_id, stream_id, seq, ts, latency)
+);
+
+#endif /* _RKISP_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE rkisp_trace
+
+#include <trace/define_trace.h>
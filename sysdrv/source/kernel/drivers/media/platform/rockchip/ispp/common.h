@@ -67,6 +67,11 @@ struct rkispp_buffer {
 		u32 buff_addr[VIDEO_MAX_PLANES];
 		void *vaddr[VIDEO_MAX_PLANES];
 	};
+	/* output shared to consumers, see struct rkispp_share */
+	struct list_head share_list;
+	u32 share_ref;
+	bool is_share_ready;
+	bool is_share_wait;
 };
 
 struct rkispp_dummy_buffer {
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 /* Copyright (c) 2019 Fuzhou Rockchip Electronics Co., Ltd. */
 
+#include <linux/dma-buf.h>
 #include <media/v4l2-common.h>
 #include <media/v4l2-ioctl.h>
 #include <media/videobuf2-core.h>
@@ -107,6 +108,15 @@ static const struct v4l2_ioctl_ops rkispp_params_ioctl = {
 	.vidioc_unsubscribe_event = rkispp_params_unsubs_evt,
 };
 
+static u32 rkispp_param_fecbuf_cnt(int buf_cnt)
+{
+	if (buf_cnt > FEC_MESH_BUF_MAX)
+		return FEC_MESH_BUF_MAX;
+	else if (buf_cnt > 0)
+		return buf_cnt;
+	return FEC_MESH_BUF_NUM;
+}
+
 static int
 rkispp_param_init_fecbuf(struct rkispp_params_vdev *params,
 			 struct rkispp_fecbuf_size *fecsize)
@@ -122,12 +132,7 @@ rkispp_param_init_fecbuf(struct rkispp_params_vdev *params,
 	buf_size = ALIGN(sizeof(struct rkispp_fec_head), 16);
 	buf_size += 2 * (ALIGN(mesh_size * 2, 16) + ALIGN(mesh_size, 16));
 
-	if (fecsize->buf_cnt > FEC_MESH_BUF_MAX)
-		params->buf_cnt = FEC_MESH_BUF_MAX;
-	else if (fecsize->buf_cnt > 0)
-		params->buf_cnt = fecsize->buf_cnt;
-	else
-		params->buf_cnt = FEC_MESH_BUF_NUM;
+	params->buf_cnt = rkispp_param_fecbuf_cnt(fecsize->buf_cnt);
 
 	params->buf_fec_idx = 0;
 	for (i = 0; i < params->buf_cnt; i++) {
@@ -180,6 +185,108 @@ rkispp_param_deinit_fecbuf(struct rkispp_params_vdev *params)
 		rkispp_free_buffer(params->dev, &params->buf_fec[i]);
 }
 
+/* keep current fec buffers to cache, replace the oldest if full */
+static void
+rkispp_param_park_fecbuf(struct rkispp_params_vdev *params)
+{
+	struct rkispp_fec_cache *cache = NULL;
+	int i;
+
+	if (!params->buf_fec[0].mem_priv)
+		return;
+
+	for (i = 0; i < RKISPP_FEC_CACHE_MAX; i++) {
+		if (!params->fec_cache[i].buf[0].mem_priv) {
+			cache = &params->fec_cache[i];
+			break;
+		}
+		if (!cache || params->fec_cache[i].used < cache->used)
+			cache = &params->fec_cache[i];
+	}
+	for (i = 0; i < FEC_MESH_BUF_MAX; i++)
+		rkispp_free_buffer(params->dev, &cache->buf[i]);
+
+	memcpy(cache->buf, params->buf_fec, sizeof(cache->buf));
+	cache->key = params->fec_key;
+	cache->used = ++params->fec_cache_seq;
+	memset(params->buf_fec, 0, sizeof(params->buf_fec));
+	params->buf_fec_idx = 0;
+}
+
+static bool
+rkispp_param_get_cached_fecbuf(struct rkispp_params_vdev *params,
+			       struct rkispp_fecbuf_size *key)
+{
+	struct rkispp_fec_cache *cache;
+	int i;
+
+	for (i = 0; i < RKISPP_FEC_CACHE_MAX; i++) {
+		cache = &params->fec_cache[i];
+		if (!cache->buf[0].mem_priv ||
+		    memcmp(&cache->key, key, sizeof(*key)))
+			continue;
+		memcpy(params->buf_fec, cache->buf, sizeof(params->buf_fec));
+		memset(cache->buf, 0, sizeof(cache->buf));
+		params->buf_cnt = key->buf_cnt;
+		params->fec_key = *key;
+		params->buf_fec_idx = 0;
+		return true;
+	}
+	return false;
+}
+
+/* reuse fec buffers with new fd, user may close old fd at size switch */
+static int
+rkispp_param_reuse_fecbuf(struct rkispp_params_vdev *params)
+{
+	struct rkispp_device *pp_dev = params->dev;
+	struct rkispp_dummy_buffer *buf;
+	struct rkispp_fec_head *fec_data;
+	u32 val, dma_addr;
+	int i, fd;
+
+	for (i = 0; i < params->buf_cnt; i++) {
+		buf = &params->buf_fec[i];
+		get_dma_buf(buf->dbuf);
+		fd = dma_buf_fd(buf->dbuf, O_CLOEXEC);
+		if (fd < 0) {
+			dma_buf_put(buf->dbuf);
+			dev_err(pp_dev->dev, "can not export fec buffer\n");
+			return fd;
+		}
+		buf->dma_fd = fd;
+		fec_data = (struct rkispp_fec_head *)buf->vaddr;
+		fec_data->stat = FEC_BUF_INIT;
+	}
+
+	fec_data = (struct rkispp_fec_head *)params->buf_fec[0].vaddr;
+	dma_addr = params->buf_fec[0].dma_addr;
+	val = dma_addr + fec_data->meshxf_oft;
+	rkispp_write(pp_dev, RKISPP_FEC_MESH_XFRA_BASE, val);
+	val = dma_addr + fec_data->meshyf_oft;
+	rkispp_write(pp_dev, RKISPP_FEC_MESH_YFRA_BASE, val);
+	val = dma_addr + fec_data->meshxi_oft;
+	rkispp_write(pp_dev, RKISPP_FEC_MESH_XINT_BASE, val);
+	val = dma_addr + fec_data->meshyi_oft;
+	rkispp_write(pp_dev, RKISPP_FEC_MESH_YINT_BASE, val);
+	v4l2_dbg(1, rkispp_debug, &pp_dev->v4l2_dev,
+		 "%s %dx%d mode:%d cnt:%d\n", __func__,
+		 params->fec_key.meas_width, params->fec_key.meas_height,
+		 params->fec_key.meas_mode, params->buf_cnt);
+	return 0;
+}
+
+static void
+rkispp_param_free_fec_cache(struct rkispp_params_vdev *params)
+{
+	int i, j;
+
+	for (i = 0; i < RKISPP_FEC_CACHE_MAX; i++) {
+		for (j = 0; j < FEC_MESH_BUF_MAX; j++)
+			rkispp_free_buffer(params->dev, &params->fec_cache[i].buf[j]);
+	}
+}
+
 static int rkispp_params_vb2_queue_setup(struct vb2_queue *vq,
 					 unsigned int *num_buffers,
 					 unsigned int *num_planes,
@@ -309,7 +416,7 @@ rkispp_param_fh_release(struct file *filp)
 	int ret;
 
 	if (filp->private_data == vdev->queue->owner)
-		rkispp_param_deinit_fecbuf(params);
+		rkispp_param_park_fecbuf(params);
 
 	ret = vb2_fop_release(filp);
 	if (!ret)
@@ -373,11 +480,25 @@ void rkispp_params_get_fecbuf_inf(struct rkispp_params_vdev *params_vdev,
 void rkispp_params_set_fecbuf_size(struct rkispp_params_vdev *params_vdev,
 				   struct rkispp_fecbuf_size *fecsize)
 {
+	struct rkispp_fecbuf_size key = *fecsize;
+
 	if (params_vdev->vdev_id != PARAM_VDEV_FEC)
 		return;
 
-	rkispp_param_deinit_fecbuf(params_vdev);
-	rkispp_param_init_fecbuf(params_vdev, fecsize);
+	key.buf_cnt = rkispp_param_fecbuf_cnt(fecsize->buf_cnt);
+	if (!params_vdev->buf_fec[0].mem_priv ||
+	    memcmp(&params_vdev->fec_key, &key, sizeof(key))) {
+		rkispp_param_park_fecbuf(params_vdev);
+		if (!rkispp_param_get_cached_fecbuf(params_vdev, &key)) {
+			if (rkispp_param_init_fecbuf(params_vdev, fecsize))
+				rkispp_param_deinit_fecbuf(params_vdev);
+			else
+				params_vdev->fec_key = key;
+			return;
+		}
+	}
+	if (rkispp_param_reuse_fecbuf(params_vdev))
+		rkispp_param_deinit_fecbuf(params_vdev);
 }
 
 static int rkispp_register_params_vdev(struct rkispp_device *dev,
@@ -455,6 +576,10 @@ static void rkispp_unregister_params_vdev(struct rkispp_device *dev,
 	struct rkispp_vdev_node *node = &params_vdev->vnode;
 	struct video_device *vdev = &node->vdev;
 
+	if (vdev_id == PARAM_VDEV_FEC) {
+		rkispp_param_deinit_fecbuf(params_vdev);
+		rkispp_param_free_fec_cache(params_vdev);
+	}
 	video_unregister_device(vdev);
 	media_entity_cleanup(&vdev->entity);
 	vb2_queue_release(vdev->queue);
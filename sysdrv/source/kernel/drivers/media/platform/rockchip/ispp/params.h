@@ -34,11 +34,26 @@ enum rkispp_paramvdev_id {
 
 #define ISPP_NOBIG_OVERFLOW_SIZE	(2560 * 1440)
 
+/* fec mesh buffer sets keep for resolution switch */
+#define RKISPP_FEC_CACHE_MAX		2
+
+/* fec mesh buffers of one measure size
+ * key: measure size and buf count of the buffers
+ * used: sequence of last used, to replace oldest
+ */
+struct rkispp_fec_cache {
+	struct rkispp_fecbuf_size key;
+	struct rkispp_dummy_buffer buf[FEC_MESH_BUF_MAX];
+	u32 used;
+};
+
 /* rkispp parameters device
  * config_lock: lock to protect config
  * params: queued buffer list
  * cur_buf: current buf of parameters
  * first_params: the first params should take effect immediately
+ * fec_key: measure size of current fec buffers
+ * fec_cache: fec buffers of previous measure size
  */
 struct rkispp_params_vdev {
 	struct rkispp_vdev_node vnode;
@@ -57,6 +72,9 @@ struct rkispp_params_vdev {
 	struct rkispp_dummy_buffer buf_fec[FEC_MESH_BUF_MAX];
 	u32 buf_fec_idx;
 	u32 buf_cnt;
+	struct rkispp_fecbuf_size fec_key;
+	struct rkispp_fec_cache fec_cache[RKISPP_FEC_CACHE_MAX];
+	u32 fec_cache_seq;
 	enum rkispp_paramvdev_id vdev_id;
 };
 
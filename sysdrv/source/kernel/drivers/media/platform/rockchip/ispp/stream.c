@@ -3,6 +3,7 @@
 
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/dma-buf.h>
 #include <linux/pm_runtime.h>
 #include <linux/slab.h>
 #include <media/v4l2-common.h>
@@ -336,6 +337,222 @@ void get_stream_buf(struct rkispp_stream *stream)
 	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
 }
 
+/* buffer done by hardware to share, call with vbq_lock */
+static void rkispp_share_ready(struct rkispp_stream *stream,
+			       struct rkispp_buffer *buf)
+{
+	struct rkispp_share *share = &stream->share;
+	struct rkispp_buffer *old;
+	struct v4l2_event ev = {
+		.type = RKISPP_V4L2_EVENT_SHARE_READY,
+	};
+	struct rkispp_share_buf *info = (struct rkispp_share_buf *)ev.u.data;
+
+	list_add_tail(&buf->share_list, &share->ready);
+	buf->is_share_ready = true;
+	share->cnt++;
+	while (share->cnt > share->max) {
+		old = list_first_entry(&share->ready, struct rkispp_buffer, share_list);
+		list_del(&old->share_list);
+		old->is_share_ready = false;
+		share->cnt--;
+	}
+
+	info->index = buf->vb.vb2_buf.index;
+	info->sequence = buf->vb.sequence;
+	info->timestamp = buf->vb.vb2_buf.timestamp;
+	info->fd = -1;
+	v4l2_event_queue(&stream->vnode.vdev, &ev);
+}
+
+/* buffer to hardware again if no consumer hold it, call with vbq_lock */
+static bool rkispp_share_recycle(struct rkispp_stream *stream,
+				 struct rkispp_buffer *buf)
+{
+	if (buf->share_ref) {
+		buf->is_share_wait = true;
+		return false;
+	}
+	if (buf->is_share_ready) {
+		list_del(&buf->share_list);
+		buf->is_share_ready = false;
+		stream->share.cnt--;
+	}
+	buf->is_share_wait = false;
+	return true;
+}
+
+static void rkispp_share_reset(struct rkispp_stream *stream)
+{
+	struct vb2_queue *queue = &stream->vnode.buf_queue;
+	struct rkispp_buffer *buf;
+	u32 i;
+
+	INIT_LIST_HEAD(&stream->share.ready);
+	stream->share.cnt = 0;
+	stream->share.gen++;
+	for (i = 0; i < queue->num_buffers; i++) {
+		buf = to_rkispp_buffer(to_vb2_v4l2_buffer(queue->bufs[i]));
+		buf->share_ref = 0;
+		buf->is_share_ready = false;
+		buf->is_share_wait = false;
+	}
+}
+
+/* drop a ref of @sfh on @buf, only the handle which got it can put it */
+static int rkispp_share_put(struct rkispp_stream *stream,
+			    struct rkispp_share_fh *sfh,
+			    struct rkispp_buffer *buf)
+{
+	u32 index = buf->vb.vb2_buf.index;
+	unsigned long lock_flags = 0;
+	int ret = 0;
+
+	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+	rkispp_share_fh_sync(stream, sfh);
+	if (!sfh->ref[index] || !buf->share_ref) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+	sfh->ref[index]--;
+	buf->share_ref--;
+	if (!buf->share_ref && buf->is_share_wait &&
+	    rkispp_share_recycle(stream, buf))
+		list_add_tail(&buf->queue, &stream->buf_queue);
+unlock:
+	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+	return ret;
+}
+
+static int rkispp_share_set(struct rkispp_stream *stream, int max)
+{
+	unsigned long lock_flags = 0;
+
+	if (stream->type != STREAM_OUTPUT || stream->id == STREAM_VIR ||
+	    stream->out_cap_fmt.mplanes > 1 || max < 0)
+		return -EINVAL;
+	if (stream->streaming)
+		return -EBUSY;
+
+	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+	stream->share.max = max;
+	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+	return 0;
+}
+
+static inline struct rkispp_share_fh *to_share_fh(struct file *file)
+{
+	return container_of(file->private_data, struct rkispp_share_fh, fh);
+}
+
+/* refs of a handle taken before the buffers were reset are gone, call with vbq_lock */
+static void rkispp_share_fh_sync(struct rkispp_stream *stream,
+				 struct rkispp_share_fh *sfh)
+{
+	if (sfh->gen != stream->share.gen) {
+		memset(sfh->ref, 0, sizeof(sfh->ref));
+		sfh->gen = stream->share.gen;
+	}
+}
+
+/* release all the shared buffers still held by a closing handle */
+static void rkispp_share_fh_release(struct rkispp_stream *stream,
+				    struct rkispp_share_fh *sfh)
+{
+	struct vb2_queue *queue = &stream->vnode.buf_queue;
+	struct rkispp_buffer *buf;
+	unsigned long lock_flags = 0;
+	u32 i;
+
+	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+	rkispp_share_fh_sync(stream, sfh);
+	for (i = 0; i < queue->num_buffers && i < VIDEO_MAX_FRAME; i++) {
+		if (!sfh->ref[i])
+			continue;
+		buf = to_rkispp_buffer(to_vb2_v4l2_buffer(queue->bufs[i]));
+		buf->share_ref -= min_t(u32, buf->share_ref, sfh->ref[i]);
+		sfh->ref[i] = 0;
+		if (!buf->share_ref && buf->is_share_wait &&
+		    rkispp_share_recycle(stream, buf))
+			list_add_tail(&buf->queue, &stream->buf_queue);
+	}
+	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+}
+
+static int rkispp_share_dqbuf(struct rkispp_stream *stream,
+			      struct rkispp_share_fh *sfh,
+			      struct rkispp_share_buf *info)
+{
+	struct rkispp_buffer *buf = NULL, *tmp;
+	struct vb2_buffer *vb;
+	struct dma_buf *dbuf;
+	unsigned long lock_flags = 0;
+	int fd;
+
+	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+	rkispp_share_fh_sync(stream, sfh);
+	/* oldest one after last got */
+	list_for_each_entry(tmp, &stream->share.ready, share_list) {
+		if (!info->sequence || tmp->vb.sequence > info->sequence) {
+			buf = tmp;
+			break;
+		}
+	}
+	fd = buf ? 0 : -EAGAIN;
+	if (buf && sfh->ref[buf->vb.vb2_buf.index] == U8_MAX)
+		fd = -EBUSY;
+	if (!fd) {
+		sfh->ref[buf->vb.vb2_buf.index]++;
+		buf->share_ref++;
+	}
+	spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+	if (fd)
+		return fd;
+
+	vb = &buf->vb.vb2_buf;
+	/* a new read only export for mmap, the owner's own dma-buf for dmabuf */
+	if (vb->memory == VB2_MEMORY_DMABUF) {
+		dbuf = vb->planes[0].dbuf;
+		get_dma_buf(dbuf);
+	} else if (vb->memory == VB2_MEMORY_MMAP) {
+		dbuf = vb->vb2_queue->mem_ops->get_dmabuf(vb->planes[0].mem_priv, O_RDONLY);
+	} else {
+		dbuf = NULL;
+	}
+	fd = -EINVAL;
+	if (!IS_ERR_OR_NULL(dbuf)) {
+		fd = dma_buf_fd(dbuf, O_CLOEXEC);
+		if (fd < 0)
+			dma_buf_put(dbuf);
+	}
+	if (fd < 0) {
+		info->fd = -1;
+		rkispp_share_put(stream, sfh, buf);
+		return fd;
+	}
+
+	info->fd = fd;
+	info->index = vb->index;
+	info->sequence = buf->vb.sequence;
+	info->timestamp = vb->timestamp;
+	return 0;
+}
+
+static int rkispp_share_qbuf(struct rkispp_stream *stream,
+			     struct rkispp_share_fh *sfh,
+			     struct rkispp_share_buf *info)
+{
+	struct vb2_queue *queue = &stream->vnode.buf_queue;
+	struct rkispp_buffer *buf;
+
+	if (info->index >= queue->num_buffers)
+		return -EINVAL;
+	buf = to_rkispp_buffer(to_vb2_v4l2_buffer(queue->bufs[info->index]));
+	if (buf->vb.sequence != info->sequence)
+		return -EINVAL;
+	return rkispp_share_put(stream, sfh, buf);
+}
+
 int rkispp_frame_end(struct rkispp_stream *stream, u32 state)
 {
 	struct rkispp_device *dev = stream->isppdev;
@@ -400,6 +617,11 @@ int rkispp_frame_end(struct rkispp_stream *stream, u32 state)
 				vb2_buffer_done(&stream->curr_buf->vb.vb2_buf,
 						VB2_BUF_STATE_DONE);
 		} else {
+			if (stream->share.max) {
+				spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+				rkispp_share_ready(stream, stream->curr_buf);
+				spin_unlock_irqrestore(&stream->vbq_lock, lock_flags);
+			}
 			vb2_buffer_done(&stream->curr_buf->vb.vb2_buf,
 					VB2_BUF_STATE_DONE);
 		}
@@ -947,7 +1169,8 @@ static void rkispp_buf_queue(struct vb2_buffer *vb)
 	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
 	if (stream->type == STREAM_OUTPUT ||
 	    (stream->id == STREAM_II && !stream->streaming)) {
-		list_add_tail(&isppbuf->queue, &stream->buf_queue);
+		if (!stream->share.max || rkispp_share_recycle(stream, isppbuf))
+			list_add_tail(&isppbuf->queue, &stream->buf_queue);
 	} else {
 		i = vb->index;
 		vdev->input[i].priv = isppbuf;
@@ -1003,6 +1226,7 @@ static void destroy_buf_queue(struct rkispp_stream *stream,
 	u32 i;
 
 	spin_lock_irqsave(&stream->vbq_lock, lock_flags);
+	rkispp_share_reset(stream);
 	if (stream->curr_buf) {
 		list_add_tail(&stream->curr_buf->queue, &stream->buf_queue);
 		stream->curr_buf = NULL;
@@ -1348,16 +1572,22 @@ static int rkispp_fh_open(struct file *filp)
 {
 	struct rkispp_stream *stream = video_drvdata(filp);
 	struct rkispp_device *isppdev = stream->isppdev;
+	struct rkispp_share_fh *sfh;
 	int ret;
 
-	ret = v4l2_fh_open(filp);
-	if (!ret) {
-		ret = v4l2_pipeline_pm_get(&stream->vnode.vdev.entity);
-		if (ret < 0) {
-			v4l2_err(&isppdev->v4l2_dev,
-				 "pipeline power on failed %d\n", ret);
-			vb2_fop_release(filp);
-		}
+	/* v4l2_fh_open() with room for the shared buffers held by the handle */
+	sfh = kzalloc(sizeof(*sfh), GFP_KERNEL);
+	if (!sfh)
+		return -ENOMEM;
+	v4l2_fh_init(&sfh->fh, video_devdata(filp));
+	filp->private_data = &sfh->fh;
+	v4l2_fh_add(&sfh->fh);
+
+	ret = v4l2_pipeline_pm_get(&stream->vnode.vdev.entity);
+	if (ret < 0) {
+		v4l2_err(&isppdev->v4l2_dev,
+			 "pipeline power on failed %d\n", ret);
+		vb2_fop_release(filp);
 	}
 	return ret;
 }
@@ -1367,6 +1597,7 @@ static int rkispp_fh_release(struct file *filp)
 	struct rkispp_stream *stream = video_drvdata(filp);
 	int ret;
 
+	rkispp_share_fh_release(stream, to_share_fh(filp));
 	ret = vb2_fop_release(filp);
 	if (!ret)
 		v4l2_pipeline_pm_put(&stream->vnode.vdev.entity);
@@ -1473,6 +1704,38 @@ static int rkispp_querycap(struct file *file, void *priv,
 	return 0;
 }
 
+static long rkispp_ioctl_default(struct file *file, void *fh,
+				 bool valid_prio, unsigned int cmd, void *arg)
+{
+	struct rkispp_stream *stream = video_drvdata(file);
+	long ret = 0;
+
+	switch (cmd) {
+	case RKISPP_CMD_SET_SHARE_BUF_NUM:
+		ret = rkispp_share_set(stream, *(int *)arg);
+		break;
+	case RKISPP_CMD_SHARE_DQBUF:
+		ret = rkispp_share_dqbuf(stream, to_share_fh(file), arg);
+		break;
+	case RKISPP_CMD_SHARE_QBUF:
+		ret = rkispp_share_qbuf(stream, to_share_fh(file), arg);
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static int rkispp_subscribe_event(struct v4l2_fh *fh,
+				  const struct v4l2_event_subscription *sub)
+{
+	if (sub->type != RKISPP_V4L2_EVENT_SHARE_READY)
+		return -EINVAL;
+
+	return v4l2_event_subscribe(fh, sub, 8, NULL);
+}
+
 static const struct v4l2_ioctl_ops rkispp_v4l2_ioctl_ops = {
 	.vidioc_reqbufs = vb2_ioctl_reqbufs,
 	.vidioc_querybuf = vb2_ioctl_querybuf,
@@ -1492,6 +1755,9 @@ static const struct v4l2_ioctl_ops rkispp_v4l2_ioctl_ops = {
 	.vidioc_s_fmt_vid_out_mplane = rkispp_s_fmt_vid_mplane,
 	.vidioc_g_fmt_vid_out_mplane = rkispp_g_fmt_vid_mplane,
 	.vidioc_querycap = rkispp_querycap,
+	.vidioc_default = rkispp_ioctl_default,
+	.vidioc_subscribe_event = rkispp_subscribe_event,
+	.vidioc_unsubscribe_event = v4l2_event_unsubscribe,
 };
 
 static void rkispp_unregister_stream_video(struct rkispp_stream *stream)
@@ -1967,6 +2233,7 @@ int rkispp_register_stream_vdevs(struct rkispp_device *dev)
 		stream->id = i;
 		stream->isppdev = dev;
 		INIT_LIST_HEAD(&stream->buf_queue);
+		INIT_LIST_HEAD(&stream->share.ready);
 		init_waitqueue_head(&stream->done);
 		spin_lock_init(&stream->vbq_lock);
 		vdev = &stream->vnode.vdev;
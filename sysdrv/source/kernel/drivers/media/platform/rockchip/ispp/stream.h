@@ -4,6 +4,7 @@
 #ifndef _RKISPP_STREAM_H
 #define _RKISPP_STREAM_H
 
+#include <media/v4l2-fh.h>
 #include "common.h"
 #include "params.h"
 
@@ -136,6 +137,32 @@ struct fec_module {
 	bool is_end;
 };
 
+/*
+ * struct rkispp_share - output buffers shared to more consumers
+ * @ready: latest done buffers to dequeue by consumers
+ * @max: max buffers in ready, 0 to disable
+ * @cnt: buffers in ready
+ * @gen: bumped when the buffers are reset, stale consumer refs are dropped
+ */
+struct rkispp_share {
+	struct list_head ready;
+	u32 max;
+	u32 cnt;
+	u32 gen;
+};
+
+/*
+ * struct rkispp_share_fh - file handle of a stream video device
+ * @fh: v4l2 file handle, must be first
+ * @gen: share generation the refs below belong to
+ * @ref: shared buffers held by this handle, per vb2 buffer index
+ */
+struct rkispp_share_fh {
+	struct v4l2_fh fh;
+	u32 gen;
+	u8 ref[VIDEO_MAX_FRAME];
+};
+
 /* struct rkispp_stream - ISPP stream video device
  * id: stream video identify
  * buf_queue: queued buffer list
@@ -166,6 +193,7 @@ struct rkispp_stream {
 	struct capture_fmt out_cap_fmt;
 	struct v4l2_pix_format_mplane out_fmt;
 	struct frame_debug_info dbg;
+	struct rkispp_share share;
 
 	u8 last_module;
 	u8 conn_id;
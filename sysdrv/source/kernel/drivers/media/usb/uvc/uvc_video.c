@@ -6,11 +6,13 @@
  *          Laurent Pinchart (laurent.pinchart@ideasonboard.com)
  */
 
+#include <linux/dma-mapping.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/usb.h>
+#include <linux/usb/hcd.h>
 #include <linux/videodev2.h>
 #include <linux/vmalloc.h>
 #include <linux/wait.h>
@@ -514,8 +516,8 @@ uvc_video_clock_decode(struct uvc_streaming *stream, struct uvc_buffer *buf,
 
 	stream->clock.last_sof = dev_sof;
 
-	host_sof = usb_get_current_frame_number(stream->dev->udev);
-	time = uvc_video_get_time();
+	host_sof = stream->decode_sof;
+	time = stream->decode_time;
 
 	/* The UVC specification allows device implementations that can't obtain
 	 * the USB frame number to keep their own frame counters as long as they
@@ -1096,7 +1098,7 @@ static int uvc_video_decode_start(struct uvc_streaming *stream,
 
 		buf->buf.field = V4L2_FIELD_NONE;
 		buf->buf.sequence = stream->sequence;
-		buf->buf.vb2_buf.timestamp = ktime_to_ns(uvc_video_get_time());
+		buf->buf.vb2_buf.timestamp = ktime_to_ns(stream->decode_time);
 
 		/* TODO: Handle PTS and SCR. */
 		buf->state = UVC_BUF_STATE_ACTIVE;
@@ -1130,16 +1132,14 @@ static int uvc_video_decode_start(struct uvc_streaming *stream,
 }
 
 /*
- * uvc_video_decode_data_work: Asynchronous memcpy processing
+ * uvc_video_copy_data: Deferred memcpy processing
  *
- * Copy URB data to video buffers in process context, releasing buffer
- * references and requeuing the URB when done.
+ * Copy URB data to video buffers once the URB headers have been decoded,
+ * releasing buffer references when done.
  */
-static void uvc_video_copy_data_work(struct work_struct *work)
+static void uvc_video_copy_data(struct uvc_urb *uvc_urb)
 {
-	struct uvc_urb *uvc_urb = container_of(work, struct uvc_urb, work);
 	unsigned int i;
-	int ret;
 
 	for (i = 0; i < uvc_urb->async_operations; i++) {
 		struct uvc_copy_op *op = &uvc_urb->copy_operations[i];
@@ -1149,11 +1149,6 @@ static void uvc_video_copy_data_work(struct work_struct *work)
 		/* Release reference taken on this buffer. */
 		uvc_queue_buffer_release(op->buf);
 	}
-
-	ret = usb_submit_urb(uvc_urb->urb, GFP_KERNEL);
-	if (ret < 0)
-		uvc_printk(KERN_ERR, "Failed to resubmit video URB (%d).\n",
-			   ret);
 }
 
 static void uvc_video_decode_data(struct uvc_urb *uvc_urb,
@@ -1263,9 +1258,6 @@ static void uvc_video_decode_meta(struct uvc_streaming *stream,
 	struct uvc_meta_buf *meta;
 	size_t len_std = 2;
 	bool has_pts, has_scr;
-	unsigned long flags;
-	unsigned int sof;
-	ktime_t time;
 	const u8 *scr;
 
 	if (!meta_buf || length == 2)
@@ -1298,12 +1290,8 @@ static void uvc_video_decode_meta(struct uvc_streaming *stream,
 		return;
 
 	meta = (struct uvc_meta_buf *)((u8 *)meta_buf->mem + meta_buf->bytesused);
-	local_irq_save(flags);
-	time = uvc_video_get_time();
-	sof = usb_get_current_frame_number(stream->dev->udev);
-	local_irq_restore(flags);
-	put_unaligned(ktime_to_ns(time), &meta->ns);
-	put_unaligned(sof, &meta->sof);
+	put_unaligned(ktime_to_ns(stream->decode_time), &meta->ns);
+	put_unaligned(stream->decode_sof, &meta->sof);
 
 	if (has_scr)
 		memcpy(stream->clock.last_scr, scr, 6);
@@ -1313,7 +1301,7 @@ static void uvc_video_decode_meta(struct uvc_streaming *stream,
 
 	uvc_trace(UVC_TRACE_FRAME,
 		  "%s(): t-sys %lluns, SOF %u, len %u, flags 0x%x, PTS %u, STC %u frame SOF %u\n",
-		  __func__, ktime_to_ns(time), meta->sof, meta->length,
+		  __func__, ktime_to_ns(stream->decode_time), meta->sof, meta->length,
 		  meta->flags,
 		  has_pts ? *(u32 *)meta->buf : 0,
 		  has_scr ? *(u32 *)scr : 0,
@@ -1522,9 +1510,31 @@ static void uvc_video_encode_bulk(struct uvc_urb *uvc_urb,
 	urb->transfer_buffer_length = stream->urb_size - len;
 }
 
-static void uvc_video_complete(struct urb *urb)
+static inline struct device *uvc_stream_to_dmadev(struct uvc_streaming *stream)
+{
+	return bus_to_hcd(stream->dev->udev->bus)->self.sysdev;
+}
+
+static inline enum dma_data_direction uvc_stream_dir(
+				struct uvc_streaming *stream)
+{
+	if (stream->type == V4L2_BUF_TYPE_VIDEO_CAPTURE)
+		return DMA_FROM_DEVICE;
+	else
+		return DMA_TO_DEVICE;
+}
+
+static int uvc_submit_urb(struct uvc_urb *uvc_urb, gfp_t mem_flags)
+{
+	struct uvc_streaming *stream = uvc_urb->stream;
+
+	dma_sync_single_for_device(uvc_stream_to_dmadev(stream), uvc_urb->dma,
+				   stream->urb_size, uvc_stream_dir(stream));
+	return usb_submit_urb(uvc_urb->urb, mem_flags);
+}
+
+static void uvc_video_decode_urb(struct uvc_urb *uvc_urb)
 {
-	struct uvc_urb *uvc_urb = urb->context;
 	struct uvc_streaming *stream = uvc_urb->stream;
 	struct uvc_video_queue *queue = &stream->queue;
 	struct uvc_video_queue *qmeta = &stream->meta.queue;
@@ -1534,6 +1544,78 @@ static void uvc_video_complete(struct urb *urb)
 	unsigned long flags;
 	int ret;
 
+	dma_sync_single_for_cpu(uvc_stream_to_dmadev(stream), uvc_urb->dma,
+				stream->urb_size, uvc_stream_dir(stream));
+
+	buf = uvc_queue_get_current_buffer(queue);
+
+	if (vb2_qmeta) {
+		spin_lock_irqsave(&qmeta->irqlock, flags);
+		if (!list_empty(&qmeta->irqqueue))
+			buf_meta = list_first_entry(&qmeta->irqqueue,
+						    struct uvc_buffer, queue);
+		spin_unlock_irqrestore(&qmeta->irqlock, flags);
+	}
+
+	/* Re-initialise the URB async work. */
+	uvc_urb->async_operations = 0;
+
+	/* Timestamp the payloads as received, not as decoded. */
+	stream->decode_time = uvc_urb->time;
+	stream->decode_sof = uvc_urb->sof;
+
+	/*
+	 * Process the URB headers, queuing the expensive memcpy tasks, and
+	 * copy once the whole URB has been parsed.
+	 */
+	stream->decode(uvc_urb, buf, buf_meta);
+	uvc_video_copy_data(uvc_urb);
+
+	/* Poisoned URBs are being stopped, don't complain about them. */
+	ret = uvc_submit_urb(uvc_urb, GFP_KERNEL);
+	if (ret < 0 && ret != -EPERM)
+		uvc_printk(KERN_ERR, "Failed to resubmit video URB (%d).\n",
+			   ret);
+}
+
+/*
+ * uvc_video_decode_work: Batched URB processing
+ *
+ * The completion handler only queues the URBs. They are decoded here in
+ * process context, in completion order, as many as have completed since the
+ * work last ran. The stream state used by the decode functions is therefore
+ * only ever touched by this work item.
+ */
+static void uvc_video_decode_work(struct work_struct *work)
+{
+	struct uvc_streaming *stream =
+		container_of(work, struct uvc_streaming, decode_work);
+	struct uvc_urb *uvc_urb;
+	unsigned long flags;
+
+	spin_lock_irqsave(&stream->done_lock, flags);
+	while (!list_empty(&stream->done_urbs)) {
+		uvc_urb = list_first_entry(&stream->done_urbs, struct uvc_urb,
+					   list);
+		list_del(&uvc_urb->list);
+		spin_unlock_irqrestore(&stream->done_lock, flags);
+
+		uvc_video_decode_urb(uvc_urb);
+
+		spin_lock_irqsave(&stream->done_lock, flags);
+	}
+	spin_unlock_irqrestore(&stream->done_lock, flags);
+}
+
+static void uvc_video_complete(struct urb *urb)
+{
+	struct uvc_urb *uvc_urb = urb->context;
+	struct uvc_streaming *stream = uvc_urb->stream;
+	struct uvc_video_queue *queue = &stream->queue;
+	struct uvc_video_queue *qmeta = &stream->meta.queue;
+	struct vb2_queue *vb2_qmeta = stream->meta.vdev.queue;
+	unsigned long flags;
+
 	switch (urb->status) {
 	case 0:
 		break;
@@ -1554,36 +1636,14 @@ static void uvc_video_complete(struct urb *urb)
 		return;
 	}
 
-	buf = uvc_queue_get_current_buffer(queue);
+	uvc_urb->time = uvc_video_get_time();
+	uvc_urb->sof = usb_get_current_frame_number(urb->dev);
 
-	if (vb2_qmeta) {
-		spin_lock_irqsave(&qmeta->irqlock, flags);
-		if (!list_empty(&qmeta->irqqueue))
-			buf_meta = list_first_entry(&qmeta->irqqueue,
-						    struct uvc_buffer, queue);
-		spin_unlock_irqrestore(&qmeta->irqlock, flags);
-	}
-
-	/* Re-initialise the URB async work. */
-	uvc_urb->async_operations = 0;
+	spin_lock_irqsave(&stream->done_lock, flags);
+	list_add_tail(&uvc_urb->list, &stream->done_urbs);
+	spin_unlock_irqrestore(&stream->done_lock, flags);
 
-	/*
-	 * Process the URB headers, and optionally queue expensive memcpy tasks
-	 * to be deferred to a work queue.
-	 */
-	stream->decode(uvc_urb, buf, buf_meta);
-
-	/* If no async work is needed, resubmit the URB immediately. */
-	if (!uvc_urb->async_operations) {
-		ret = usb_submit_urb(uvc_urb->urb, GFP_ATOMIC);
-		if (ret < 0)
-			uvc_printk(KERN_ERR,
-				   "Failed to resubmit video URB (%d).\n",
-				   ret);
-		return;
-	}
-
-	queue_work(stream->async_wq, &uvc_urb->work);
+	queue_work(stream->async_wq, &stream->decode_work);
 }
 
 /*
@@ -1597,12 +1657,9 @@ static void uvc_free_urb_buffers(struct uvc_streaming *stream)
 		if (!uvc_urb->buffer)
 			continue;
 
-#ifndef CONFIG_DMA_NONCOHERENT
-		usb_free_coherent(stream->dev->udev, stream->urb_size,
-				  uvc_urb->buffer, uvc_urb->dma);
-#else
-		kfree(uvc_urb->buffer);
-#endif
+		dma_free_noncoherent(uvc_stream_to_dmadev(stream),
+				     stream->urb_size, uvc_urb->buffer,
+				     uvc_urb->dma, uvc_stream_dir(stream));
 		uvc_urb->buffer = NULL;
 	}
 
@@ -1643,14 +1700,10 @@ static int uvc_alloc_urb_buffers(struct uvc_streaming *stream,
 			struct uvc_urb *uvc_urb = &stream->uvc_urb[i];
 
 			stream->urb_size = psize * npackets;
-#ifndef CONFIG_DMA_NONCOHERENT
-			uvc_urb->buffer = usb_alloc_coherent(
-				stream->dev->udev, stream->urb_size,
-				gfp_flags | __GFP_NOWARN, &uvc_urb->dma);
-#else
-			uvc_urb->buffer =
-			    kmalloc(stream->urb_size, gfp_flags | __GFP_NOWARN);
-#endif
+			uvc_urb->buffer = dma_alloc_noncoherent(
+				uvc_stream_to_dmadev(stream), stream->urb_size,
+				&uvc_urb->dma, uvc_stream_dir(stream),
+				gfp_flags | __GFP_NOWARN);
 			if (!uvc_urb->buffer) {
 				uvc_free_urb_buffers(stream);
 				break;
@@ -1760,12 +1813,8 @@ static int uvc_init_video_isoc(struct uvc_streaming *stream,
 		urb->context = uvc_urb;
 		urb->pipe = usb_rcvisocpipe(stream->dev->udev,
 				ep->desc.bEndpointAddress);
-#ifndef CONFIG_DMA_NONCOHERENT
 		urb->transfer_flags = URB_ISO_ASAP | URB_NO_TRANSFER_DMA_MAP;
 		urb->transfer_dma = uvc_urb->dma;
-#else
-		urb->transfer_flags = URB_ISO_ASAP;
-#endif
 		urb->interval = ep->desc.bInterval;
 		urb->transfer_buffer = uvc_urb->buffer;
 		urb->complete = uvc_video_complete;
@@ -1825,10 +1874,8 @@ static int uvc_init_video_bulk(struct uvc_streaming *stream,
 
 		usb_fill_bulk_urb(urb, stream->dev->udev, pipe,	uvc_urb->buffer,
 				  size, uvc_video_complete, uvc_urb);
-#ifndef CONFIG_DMA_NONCOHERENT
 		urb->transfer_flags = URB_NO_TRANSFER_DMA_MAP;
 		urb->transfer_dma = uvc_urb->dma;
-#endif
 
 		uvc_urb->urb = urb;
 	}
@@ -1927,7 +1974,7 @@ static int uvc_video_start_transfer(struct uvc_streaming *stream,
 
 	/* Submit the URBs. */
 	for_each_uvc_urb(uvc_urb, stream) {
-		ret = usb_submit_urb(uvc_urb->urb, gfp_flags);
+		ret = uvc_submit_urb(uvc_urb, gfp_flags);
 		if (ret < 0) {
 			uvc_printk(KERN_ERR, "Failed to submit URB %u (%d).\n",
 				   uvc_urb_index(uvc_urb), ret);
@@ -2020,7 +2067,6 @@ int uvc_video_init(struct uvc_streaming *stream)
 	struct uvc_streaming_control *probe = &stream->ctrl;
 	struct uvc_format *format = NULL;
 	struct uvc_frame *frame = NULL;
-	struct uvc_urb *uvc_urb;
 	unsigned int i;
 	int ret;
 
@@ -2106,9 +2152,10 @@ int uvc_video_init(struct uvc_streaming *stream)
 		}
 	}
 
-	/* Prepare asynchronous work items. */
-	for_each_uvc_urb(uvc_urb, stream)
-		INIT_WORK(&uvc_urb->work, uvc_video_copy_data_work);
+	/* Prepare the URB decoding work. */
+	INIT_WORK(&stream->decode_work, uvc_video_decode_work);
+	spin_lock_init(&stream->done_lock);
+	INIT_LIST_HEAD(&stream->done_urbs);
 
 	return 0;
 }
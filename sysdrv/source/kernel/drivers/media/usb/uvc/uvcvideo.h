@@ -524,10 +524,12 @@ struct uvc_copy_op {
  * @urb: the URB described by this context structure
  * @stream: UVC streaming context
  * @buffer: memory storage for the URB
- * @dma: DMA coherent addressing for the urb_buffer
+ * @dma: DMA address of the non-coherent urb_buffer
  * @async_operations: counter to indicate the number of copy operations
  * @copy_operations: work descriptors for asynchronous copy operations
- * @work: work queue entry for asynchronous decode
+ * @list: entry in the list of URBs waiting to be decoded
+ * @time: system time at URB completion
+ * @sof: host SOF counter at URB completion
  */
 struct uvc_urb {
 	struct urb *urb;
@@ -538,7 +540,9 @@ struct uvc_urb {
 
 	unsigned int async_operations;
 	struct uvc_copy_op copy_operations[UVC_MAX_PACKETS];
-	struct work_struct work;
+	struct list_head list;
+	ktime_t time;
+	u16 sof;
 };
 
 struct uvc_streaming {
@@ -575,6 +579,14 @@ struct uvc_streaming {
 	void (*decode)(struct uvc_urb *uvc_urb, struct uvc_buffer *buf,
 		       struct uvc_buffer *meta_buf);
 
+	/* Completed URBs, decoded in order by decode_work. */
+	struct work_struct decode_work;
+	spinlock_t done_lock;
+	struct list_head done_urbs;
+	/* Completion time and SOF of the URB being decoded. */
+	ktime_t decode_time;
+	u16 decode_sof;
+
 	struct {
 		struct video_device vdev;
 		struct uvc_video_queue queue;
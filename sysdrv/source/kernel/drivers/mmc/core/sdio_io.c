@@ -10,7 +10,11 @@
 #include <linux/mmc/host.h>
 #include <linux/mmc/card.h>
 #include <linux/mmc/sdio.h>
+#include <linux/mmc/sdio_batch.h>
 #include <linux/mmc/sdio_func.h>
+#include <linux/scatterlist.h>
+#include <linux/skbuff.h>
+#include <linux/slab.h>
 
 #include "sdio_ops.h"
 #include "core.h"
@@ -523,6 +527,167 @@ int sdio_writesb(struct sdio_func *func, unsigned int addr, void *src,
 }
 EXPORT_SYMBOL_GPL(sdio_writesb);
 
+/**
+ *	sdio_writesb_sg - write a scatterlist to a FIFO of a SDIO function
+ *	@func: SDIO function to access
+ *	@addr: address of (single byte) FIFO
+ *	@sgl: segments to write, back to back
+ *	@nents: number of entries of @sgl
+ *	@count: number of bytes to write
+ *
+ *	Writes the segments with a single IO_RW_EXTENDED command, so the
+ *	host gathers them straight into its scatter-gather descriptors.
+ *	Above sdio_max_byte_size() the command is in block mode and @count
+ *	must be a multiple of the function block size, the caller pads the
+ *	data. Fails with -EINVAL when the transfer doesn't fit one command
+ *	of the host. Return value indicates if the transfer succeeded or not.
+ */
+int sdio_writesb_sg(struct sdio_func *func, unsigned int addr,
+	struct scatterlist *sgl, unsigned int nents, unsigned int count)
+{
+	struct mmc_host *host;
+	unsigned int blksz, max_bytes;
+
+	if (!func || (func->num > 7) || !sgl || !nents || !count)
+		return -EINVAL;
+
+	host = func->card->host;
+	if (nents > host->max_segs)
+		return -EINVAL;
+
+	if (count <= sdio_max_byte_size(func))
+		/* Indicate byte mode by setting "blocks" = 0 */
+		return mmc_io_rw_extended_sg(func->card, 1, func->num, addr, 0,
+					     sgl, nents, 0, count);
+
+	blksz = func->cur_blksize;
+	max_bytes = min(host->max_blk_count, 511u) * blksz;
+	max_bytes = min(max_bytes, host->max_req_size);
+	if (!func->card->cccr.multi_block || count % blksz || count > max_bytes)
+		return -EINVAL;
+
+	return mmc_io_rw_extended_sg(func->card, 1, func->num, addr, 0,
+				     sgl, nents, count / blksz, blksz);
+}
+EXPORT_SYMBOL_GPL(sdio_writesb_sg);
+
+/**
+ *	sdio_writesb_skbs - write a list of packets to a FIFO of a SDIO function
+ *	@func: SDIO function to access
+ *	@addr: address of (single byte) FIFO
+ *	@list: linear skbs to write, back to back
+ *
+ *	Writes the packets with as few block mode IO_RW_EXTENDED commands as
+ *	the host allows, each one gathering several skbs straight from their
+ *	data, instead of one or more commands per packet. When a command
+ *	doesn't end on a block boundary it is padded with zeroes, so the
+ *	device must find the packet boundaries in the data itself, as for
+ *	sdio_align_size(). The skbs are left on @list. Return value
+ *	indicates if the transfer succeeded or not.
+ */
+int sdio_writesb_skbs(struct sdio_func *func, unsigned int addr,
+	struct sk_buff_head *list)
+{
+	struct mmc_host *host;
+	struct sg_table sgtable;
+	struct scatterlist *sg;
+	struct sk_buff *skb;
+	unsigned int blksz, max_bytes, max_segs, seg_size;
+	unsigned int nents, segs, bytes, off;
+	u8 *pad = NULL;
+	int ret = 0;
+
+	if (!func || (func->num > 7) || !list)
+		return -EINVAL;
+
+	host = func->card->host;
+	blksz = func->cur_blksize;
+	seg_size = host->max_seg_size;
+	/* keep one segment for the padding */
+	max_segs = host->max_segs - 1;
+
+	if (!func->card->cccr.multi_block || !max_segs) {
+		skb_queue_walk(list, skb) {
+			ret = sdio_writesb(func, addr, skb->data, skb->len);
+			if (ret)
+				return ret;
+		}
+		return 0;
+	}
+
+	max_bytes = min(host->max_blk_count, 511u) * blksz;
+	max_bytes = rounddown(min(max_bytes, host->max_req_size), blksz);
+
+	if (sg_alloc_table(&sgtable, max_segs + 1, GFP_KERNEL))
+		return -ENOMEM;
+
+	skb = skb_peek(list);
+	while (skb) {
+		sg = sgtable.sgl;
+		nents = 0;
+		bytes = 0;
+
+		for (; skb; skb = skb_peek_next(skb, list)) {
+			if (skb_is_nonlinear(skb)) {
+				ret = -EINVAL;
+				goto out;
+			}
+
+			segs = DIV_ROUND_UP(skb->len, seg_size);
+			if (segs > max_segs || skb->len > max_bytes) {
+				/* too big to share a command */
+				if (nents)
+					break;
+				ret = sdio_writesb(func, addr, skb->data,
+						   skb->len);
+				if (ret)
+					goto out;
+				continue;
+			}
+
+			if (nents + segs > max_segs ||
+			    bytes + skb->len > max_bytes)
+				break;
+
+			for (off = 0; off < skb->len; off += seg_size) {
+				sg_set_buf(sg, skb->data + off,
+					   min(seg_size, skb->len - off));
+				sg = sg_next(sg);
+			}
+			nents += segs;
+			bytes += skb->len;
+		}
+
+		if (!nents)
+			continue;
+
+		if (bytes > sdio_max_byte_size(func) &&
+		    bytes != roundup(bytes, blksz)) {
+			if (!pad) {
+				pad = kzalloc(blksz, GFP_KERNEL);
+				if (!pad) {
+					ret = -ENOMEM;
+					goto out;
+				}
+			}
+			sg_set_buf(sg, pad, roundup(bytes, blksz) - bytes);
+			nents++;
+			bytes = roundup(bytes, blksz);
+		}
+
+		ret = sdio_writesb_sg(func, addr, sgtable.sgl, nents, bytes);
+		if (ret)
+			goto out;
+	}
+
+out:
+	kfree(pad);
+	sg_free_table(&sgtable);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sdio_writesb_skbs);
+
 /**
  *	sdio_readw - read a 16 bit integer from a SDIO function
  *	@func: SDIO function to access
@@ -111,16 +111,17 @@ int mmc_io_rw_direct(struct mmc_card *card, int write, unsigned fn,
 	return mmc_io_rw_direct_host(card->host, write, fn, addr, in, out);
 }
 
-int mmc_io_rw_extended(struct mmc_card *card, int write, unsigned fn,
-	unsigned addr, int incr_addr, u8 *buf, unsigned blocks, unsigned blksz)
+/*
+ * Issue one IO_RW_EXTENDED command for a data buffer already described by a
+ * scatterlist, blocks == 0 selects byte mode.
+ */
+int mmc_io_rw_extended_sg(struct mmc_card *card, int write, unsigned fn,
+	unsigned addr, int incr_addr, struct scatterlist *sg,
+	unsigned int sg_len, unsigned blocks, unsigned blksz)
 {
 	struct mmc_request mrq = {};
 	struct mmc_command cmd = {};
 	struct mmc_data data = {};
-	struct scatterlist sg, *sg_ptr;
-	struct sg_table sgtable;
-	unsigned int nents, left_size, i;
-	unsigned int seg_size = card->host->max_seg_size;
 	int err;
 
 	WARN_ON(blksz == 0);
@@ -147,27 +148,8 @@ int mmc_io_rw_extended(struct mmc_card *card, int write, unsigned fn,
 	/* Code in host drivers/fwk assumes that "blocks" always is >=1 */
 	data.blocks = blocks ? blocks : 1;
 	data.flags = write ? MMC_DATA_WRITE : MMC_DATA_READ;
-
-	left_size = data.blksz * data.blocks;
-	nents = DIV_ROUND_UP(left_size, seg_size);
-	if (nents > 1) {
-		if (sg_alloc_table(&sgtable, nents, GFP_KERNEL))
-			return -ENOMEM;
-
-		data.sg = sgtable.sgl;
-		data.sg_len = nents;
-
-		for_each_sg(data.sg, sg_ptr, data.sg_len, i) {
-			sg_set_buf(sg_ptr, buf + i * seg_size,
-				   min(seg_size, left_size));
-			left_size -= seg_size;
-		}
-	} else {
-		data.sg = &sg;
-		data.sg_len = 1;
-
-		sg_init_one(&sg, buf, left_size);
-	}
+	data.sg = sg;
+	data.sg_len = sg_len;
 
 	mmc_set_data_timeout(&data, card);
 
@@ -193,8 +175,39 @@ int mmc_io_rw_extended(struct mmc_card *card, int write, unsigned fn,
 
 	mmc_post_req(card->host, &mrq, err);
 
-	if (nents > 1)
+	return err;
+}
+
+int mmc_io_rw_extended(struct mmc_card *card, int write, unsigned fn,
+	unsigned addr, int incr_addr, u8 *buf, unsigned blocks, unsigned blksz)
+{
+	struct scatterlist sg, *sg_ptr;
+	struct sg_table sgtable;
+	unsigned int nents, left_size, i;
+	unsigned int seg_size = card->host->max_seg_size;
+	int err;
+
+	left_size = blksz * (blocks ? blocks : 1);
+	nents = DIV_ROUND_UP(left_size, seg_size);
+	if (nents > 1) {
+		if (sg_alloc_table(&sgtable, nents, GFP_KERNEL))
+			return -ENOMEM;
+
+		for_each_sg(sgtable.sgl, sg_ptr, nents, i) {
+			sg_set_buf(sg_ptr, buf + i * seg_size,
+				   min(seg_size, left_size));
+			left_size -= seg_size;
+		}
+
+		err = mmc_io_rw_extended_sg(card, write, fn, addr, incr_addr,
+					    sgtable.sgl, nents, blocks, blksz);
 		sg_free_table(&sgtable);
+	} else {
+		sg_init_one(&sg, buf, left_size);
+
+		err = mmc_io_rw_extended_sg(card, write, fn, addr, incr_addr,
+					    &sg, 1, blocks, blksz);
+	}
 
 	return err;
 }
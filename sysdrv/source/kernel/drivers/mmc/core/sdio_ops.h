@@ -13,6 +13,7 @@
 
 struct mmc_host;
 struct mmc_card;
+struct scatterlist;
 struct work_struct;
 
 int mmc_send_io_op_cond(struct mmc_host *host, u32 ocr, u32 *rocr);
@@ -20,6 +21,9 @@ int mmc_io_rw_direct(struct mmc_card *card, int write, unsigned fn,
 	unsigned addr, u8 in, u8* out);
 int mmc_io_rw_extended(struct mmc_card *card, int write, unsigned fn,
 	unsigned addr, int incr_addr, u8 *buf, unsigned blocks, unsigned blksz);
+int mmc_io_rw_extended_sg(struct mmc_card *card, int write, unsigned fn,
+	unsigned addr, int incr_addr, struct scatterlist *sg,
+	unsigned int sg_len, unsigned blocks, unsigned blksz);
 int sdio_reset(struct mmc_host *host);
 void sdio_irq_work(struct work_struct *work);
 
@@ -74,8 +74,36 @@
 #include <linux/crc32.h>
 #include <linux/math64.h>
 #include <linux/random.h>
+#include <linux/workqueue.h>
 #include "ubi.h"
 
+/* Number of PEBs whose headers are read ahead of the scanner */
+#define UBI_SCAN_INFLIGHT 16
+
+/**
+ * struct ubi_scan_slot - headers of one PEB read ahead of the scanner.
+ * @work: reads the headers on an unbound worker
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number
+ * @bad_err: return value of 'ubi_io_is_bad()'
+ * @ec_err: return value of 'ubi_io_read_ec_hdr()'
+ * @vid_err: return value of 'ubi_io_read_vid_hdr()', valid if @vid_read
+ * @vid_read: the VID header was read
+ * @ech: EC header buffer
+ * @vidb: VID header buffer
+ */
+struct ubi_scan_slot {
+	struct work_struct work;
+	struct ubi_device *ubi;
+	int pnum;
+	int bad_err;
+	int ec_err;
+	int vid_err;
+	bool vid_read;
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_io_buf *vidb;
+};
+
 static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
 
 #define AV_FIND		BIT(0)
@@ -932,17 +960,19 @@ static bool vol_ignored(int vol_id)
  * @ai: attaching information
  * @pnum: the physical eraseblock number
  * @fast: true if we're scanning for a Fastmap
+ * @pre: headers read ahead by 'scan_read_hdrs()', or %NULL
  *
  * This function reads UBI headers of PEB @pnum, checks them, and adds
  * information about this PEB to the corresponding list or RB-tree in the
- * "attaching info" structure. Returns zero if the physical eraseblock was
+ * "attaching info" structure. If @pre is given, the headers it holds are used
+ * instead of reading them again. Returns zero if the physical eraseblock was
  * successfully handled and a negative error code in case of failure.
  */
 static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
-		    int pnum, bool fast)
+		    int pnum, bool fast, struct ubi_scan_slot *pre)
 {
-	struct ubi_ec_hdr *ech = ai->ech;
-	struct ubi_vid_io_buf *vidb = ai->vidb;
+	struct ubi_ec_hdr *ech = pre ? pre->ech : ai->ech;
+	struct ubi_vid_io_buf *vidb = pre ? pre->vidb : ai->vidb;
 	struct ubi_vid_hdr *vidh = ubi_get_vid_hdr(vidb);
 	long long ec;
 	int err, bitflips = 0, vol_id = -1, ec_err = 0;
@@ -950,7 +980,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	dbg_bld("scan PEB %d", pnum);
 
 	/* Skip bad physical eraseblocks */
-	err = ubi_io_is_bad(ubi, pnum);
+	err = pre ? pre->bad_err : ubi_io_is_bad(ubi, pnum);
 	if (err < 0)
 		return err;
 	else if (err) {
@@ -958,7 +988,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	err = pre ? pre->ec_err : ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1041,7 +1071,10 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
+	if (pre && pre->vid_read)
+		err = pre->vid_err;
+	else
+		err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1361,6 +1394,132 @@ static void destroy_ai(struct ubi_attach_info *ai)
 	kfree(ai);
 }
 
+/**
+ * scan_read_hdrs - read the headers of a PEB ahead of the scanner.
+ * @work: the &struct ubi_scan_slot work
+ *
+ * Only reads and validates, everything that touches the attaching
+ * information is left to 'scan_peb()' which runs in PEB order. The VID header
+ * is read whenever 'scan_peb()' would read it.
+ */
+static void scan_read_hdrs(struct work_struct *work)
+{
+	struct ubi_scan_slot *slot = container_of(work, struct ubi_scan_slot,
+						  work);
+	struct ubi_device *ubi = slot->ubi;
+
+	slot->vid_read = false;
+	slot->ec_err = 0;
+
+	slot->bad_err = ubi_io_is_bad(ubi, slot->pnum);
+	if (slot->bad_err)
+		return;
+
+	slot->ec_err = ubi_io_read_ec_hdr(ubi, slot->pnum, slot->ech, 0);
+	if (slot->ec_err < 0 || slot->ec_err == UBI_IO_FF ||
+	    slot->ec_err == UBI_IO_FF_BITFLIPS)
+		return;
+
+	slot->vid_err = ubi_io_read_vid_hdr(ubi, slot->pnum, slot->vidb, 0);
+	slot->vid_read = true;
+}
+
+static void free_scan_slots(struct ubi_scan_slot *slots, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		ubi_free_vid_buf(slots[i].vidb);
+		kfree(slots[i].ech);
+	}
+	kfree(slots);
+}
+
+static struct ubi_scan_slot *alloc_scan_slots(struct ubi_device *ubi, int cnt)
+{
+	struct ubi_scan_slot *slots;
+	int i;
+
+	slots = kcalloc(cnt, sizeof(*slots), GFP_KERNEL);
+	if (!slots)
+		return NULL;
+
+	for (i = 0; i < cnt; i++) {
+		INIT_WORK(&slots[i].work, scan_read_hdrs);
+		slots[i].ubi = ubi;
+		slots[i].ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+		slots[i].vidb = ubi_alloc_vid_buf(ubi, GFP_KERNEL);
+		if (!slots[i].ech || !slots[i].vidb) {
+			free_scan_slots(slots, i + 1);
+			return NULL;
+		}
+	}
+
+	return slots;
+}
+
+static void queue_scan_window(struct ubi_device *ubi,
+			      struct ubi_scan_slot *win, int pnum)
+{
+	int i;
+
+	for (i = 0; i < UBI_SCAN_INFLIGHT && pnum + i < ubi->peb_count; i++) {
+		win[i].pnum = pnum + i;
+		queue_work(system_unbound_wq, &win[i].work);
+	}
+}
+
+/**
+ * scan_parallel - scan PEBs with their headers read ahead.
+ * @ubi: UBI device description object
+ * @ai: attach info object
+ * @start: start scanning at this PEB
+ *
+ * Headers of the next %UBI_SCAN_INFLIGHT PEBs are read by unbound workers
+ * while 'scan_peb()' processes the current window, so the flash driver always
+ * has reads queued and header checking overlaps with media access. Returns
+ * %1 if the read-ahead buffers could not be allocated and the caller has to
+ * scan serially, zero on success and a negative error code on failure.
+ */
+static int scan_parallel(struct ubi_device *ubi, struct ubi_attach_info *ai,
+			 int start)
+{
+	struct ubi_scan_slot *slots, *cur, *next;
+	int i, err = 0, pnum;
+
+	slots = alloc_scan_slots(ubi, 2 * UBI_SCAN_INFLIGHT);
+	if (!slots)
+		return 1;
+
+	cur = slots;
+	next = slots + UBI_SCAN_INFLIGHT;
+	queue_scan_window(ubi, cur, start);
+
+	for (pnum = start; pnum < ubi->peb_count; pnum += UBI_SCAN_INFLIGHT) {
+		queue_scan_window(ubi, next, pnum + UBI_SCAN_INFLIGHT);
+
+		for (i = 0; i < UBI_SCAN_INFLIGHT && pnum + i < ubi->peb_count; i++) {
+			flush_work(&cur[i].work);
+			if (err)
+				continue;
+
+			dbg_gen("process PEB %d", pnum + i);
+			err = scan_peb(ubi, ai, pnum + i, false, &cur[i]);
+		}
+		if (err)
+			break;
+
+		cond_resched();
+		swap(cur, next);
+	}
+
+	for (i = 0; i < 2 * UBI_SCAN_INFLIGHT; i++)
+		flush_work(&slots[i].work);
+	free_scan_slots(slots, 2 * UBI_SCAN_INFLIGHT);
+
+	return err;
+}
+
 /**
  * scan_all - scan entire MTD device.
  * @ubi: UBI device description object
@@ -1389,13 +1548,20 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!ai->vidb)
 		goto out_ech;
 
-	for (pnum = start; pnum < ubi->peb_count; pnum++) {
-		cond_resched();
+	err = scan_parallel(ubi, ai, start);
+	if (err < 0)
+		goto out_vidh;
 
-		dbg_gen("process PEB %d", pnum);
-		err = scan_peb(ubi, ai, pnum, false);
-		if (err < 0)
-			goto out_vidh;
+	/* No memory for the read-ahead buffers, scan one PEB at a time */
+	if (err > 0) {
+		for (pnum = start; pnum < ubi->peb_count; pnum++) {
+			cond_resched();
+
+			dbg_gen("process PEB %d", pnum);
+			err = scan_peb(ubi, ai, pnum, false, NULL);
+			if (err < 0)
+				goto out_vidh;
+		}
 	}
 
 	ubi_msg(ubi, "scanning is finished");
@@ -1507,7 +1673,7 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 		cond_resched();
 
 		dbg_gen("process PEB %d", pnum);
-		err = scan_peb(ubi, scan_ai, pnum, true);
+		err = scan_peb(ubi, scan_ai, pnum, true, NULL);
 		if (err < 0)
 			goto out_vidh;
 	}
@@ -1574,6 +1740,13 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 		err = scan_fast(ubi, &ai);
 		if (err > 0 || mtd_is_eccerr(err)) {
 			if (err != UBI_NO_FASTMAP) {
+				/*
+				 * The image does use fastmap, keep it enabled
+				 * so that a valid one is written after this
+				 * scan even without fm_autoconvert.
+				 */
+				if (err == UBI_BAD_FASTMAP)
+					ubi->fm_disabled = 0;
 				destroy_ai(ai);
 				ai = alloc_ai();
 				if (!ai)
@@ -67,7 +67,7 @@ static int mtd_devs;
 static struct mtd_dev_param mtd_dev_param[UBI_MAX_DEVICES];
 #ifdef CONFIG_MTD_UBI_FASTMAP
 /* UBI module parameter to enable fastmap automatically on non-fastmap images */
-static bool fm_autoconvert;
+static bool fm_autoconvert = IS_ENABLED(CONFIG_MTD_UBI_FASTMAP_AUTOCONVERT);
 static bool fm_debug;
 #endif
 
@@ -1018,6 +1018,20 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 	spin_lock(&ubi->wl_lock);
 	ubi->thread_enabled = 1;
 	wake_up_process(ubi->bgt_thread);
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	/*
+	 * Attached by scanning although fastmap is enabled: there was no
+	 * fastmap or it was invalid. Write a new one now rather than at
+	 * detach time, which an unclean shutdown never reaches, so the next
+	 * attach does not have to scan again.
+	 */
+	if (!ubi->fm_disabled && !ubi->fast_attach && !ubi->ro_mode &&
+	    !ubi->fm_work_scheduled) {
+		ubi_msg(ubi, "attached by scanning, writing a new fastmap");
+		ubi->fm_work_scheduled = 1;
+		schedule_work(&ubi->fm_work);
+	}
+#endif
 	spin_unlock(&ubi->wl_lock);
 
 	ubi_devices[ubi_num] = ubi;
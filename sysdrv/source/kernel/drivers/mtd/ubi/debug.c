@@ -493,6 +493,46 @@ static const struct file_operations eraseblk_count_fops = {
 	.release = eraseblk_count_release,
 };
 
+static int pending_works_show(struct seq_file *s, void *v)
+{
+	ubi_wl_pending_show(s->private, s);
+	return 0;
+}
+
+static int pending_works_open(struct inode *inode, struct file *f)
+{
+	struct ubi_device *ubi;
+	int err;
+
+	ubi = ubi_get_device((unsigned long)inode->i_private);
+	if (!ubi)
+		return -ENODEV;
+
+	err = single_open(f, pending_works_show, ubi);
+	if (err)
+		ubi_put_device(ubi);
+
+	return err;
+}
+
+static int pending_works_release(struct inode *inode, struct file *f)
+{
+	struct seq_file *s = f->private_data;
+	struct ubi_device *ubi = s->private;
+
+	ubi_put_device(ubi);
+
+	return single_release(inode, f);
+}
+
+static const struct file_operations pending_works_fops = {
+	.owner = THIS_MODULE,
+	.open = pending_works_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = pending_works_release,
+};
+
 /**
  * ubi_debugfs_init_dev - initialize debugfs for an UBI device.
  * @ubi: UBI device description object
@@ -558,6 +598,9 @@ int ubi_debugfs_init_dev(struct ubi_device *ubi)
 	debugfs_create_file("detailed_erase_block_info", S_IRUSR, d->dfs_dir,
 			    (void *)ubi_num, &eraseblk_count_fops);
 
+	debugfs_create_file("pending_works", S_IRUSR, d->dfs_dir,
+			    (void *)ubi_num, &pending_works_fops);
+
 	return 0;
 }
 
@@ -456,6 +456,7 @@ int ubi_eba_unmap_leb(struct ubi_device *ubi, struct ubi_volume *vol,
 	if (ubi->ro_mode)
 		return -EROFS;
 
+	ubi_mark_fg_io(ubi);
 	err = leb_write_lock(ubi, vol_id, lnum);
 	if (err)
 		return err;
@@ -601,6 +602,7 @@ int ubi_eba_read_leb(struct ubi_device *ubi, struct ubi_volume *vol, int lnum,
 	struct ubi_vid_hdr *vid_hdr;
 	uint32_t crc;
 
+	ubi_mark_fg_io(ubi);
 	err = leb_read_lock(ubi, vol_id, lnum);
 	if (err)
 		return err;
@@ -1015,6 +1017,7 @@ int ubi_eba_write_leb(struct ubi_device *ubi, struct ubi_volume *vol, int lnum,
 	if (ubi->ro_mode)
 		return -EROFS;
 
+	ubi_mark_fg_io(ubi);
 	err = leb_write_lock(ubi, vol_id, lnum);
 	if (err)
 		return err;
@@ -1119,6 +1122,7 @@ int ubi_eba_write_leb_st(struct ubi_device *ubi, struct ubi_volume *vol,
 	if (ubi->ro_mode)
 		return -EROFS;
 
+	ubi_mark_fg_io(ubi);
 	if (lnum == used_ebs - 1)
 		/* If this is the last LEB @len may be unaligned */
 		len = ALIGN(data_size, ubi->min_io_size);
@@ -1197,6 +1201,7 @@ int ubi_eba_atomic_leb_change(struct ubi_device *ubi, struct ubi_volume *vol,
 	if (ubi->ro_mode)
 		return -EROFS;
 
+	ubi_mark_fg_io(ubi);
 	if (len == 0) {
 		/*
 		 * Special case when data length is zero. In this case the LEB
@@ -208,7 +208,7 @@ static int produce_free_peb(struct ubi_device *ubi)
 
 	while (!ubi->free.rb_node && ubi->works_count) {
 		dbg_wl("do one work synchronously");
-		err = do_work(ubi);
+		err = do_work(ubi, NULL);
 
 		if (err)
 			return err;
@@ -388,6 +388,52 @@ int ubi_wl_put_fm_peb(struct ubi_device *ubi, struct ubi_wl_entry *fm_e,
 	return schedule_erase(ubi, e, vol_id, lnum, torture, true);
 }
 
+/**
+ * fm_pool_low - check whether the user pool is close to running dry.
+ * @ubi: UBI device description object
+ *
+ * Once the pool is empty, 'ubi_wl_get_peb()' has to write a fastmap in the
+ * writer's context. Must be called with @ubi->wl_lock held.
+ */
+static bool fm_pool_low(struct ubi_device *ubi)
+{
+	struct ubi_fm_pool *pool = &ubi->fm_pool;
+
+	if (ubi->fm_disabled || ubi->ro_mode || ubi->fm_work_scheduled ||
+	    !pool->size)
+		return false;
+
+	return pool->size - pool->used <= pool->size / 4;
+}
+
+/**
+ * ubi_fm_idle_refill - refill the fastmap pools from the background.
+ * @ubi: UBI device description object
+ *
+ * Writes the fastmap, which refills both pools with erased PEBs, while the
+ * device is idle instead of on the next write that finds the pool empty.
+ * Must be called with @ubi->wl_lock held.
+ */
+static void ubi_fm_idle_refill(struct ubi_device *ubi)
+{
+	dbg_wl("refill fastmap pools in idle, %d of %d used",
+	       ubi->fm_pool.used, ubi->fm_pool.size);
+	ubi->fm_work_scheduled = 1;
+	schedule_work(&ubi->fm_work);
+}
+
+static void ubi_fm_pending_show(struct ubi_device *ubi, struct seq_file *m)
+{
+	spin_lock(&ubi->wl_lock);
+	seq_printf(m, "fm_pool: %d/%d\n", ubi->fm_pool.size - ubi->fm_pool.used,
+		   ubi->fm_pool.size);
+	seq_printf(m, "fm_wl_pool: %d/%d\n",
+		   ubi->fm_wl_pool.size - ubi->fm_wl_pool.used,
+		   ubi->fm_wl_pool.size);
+	seq_printf(m, "fm_work_scheduled: %d\n", ubi->fm_work_scheduled);
+	spin_unlock(&ubi->wl_lock);
+}
+
 /**
  * ubi_is_erase_work - checks whether a work is erase work.
  * @wrk: The work object to be checked
@@ -24,6 +24,7 @@
 #include <linux/string.h>
 #include <linux/vmalloc.h>
 #include <linux/notifier.h>
+#include <linux/seq_file.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/ubi.h>
 #include <linux/pgtable.h>
@@ -520,6 +521,9 @@ struct ubi_debug_info {
  * @bgt_thread: background thread description object
  * @thread_enabled: if the background thread is enabled
  * @bgt_name: background thread name
+ * @fg_io_jiffies: time of the last foreground LEB read or write
+ * @bgt_paced: how many times background work was paced behind foreground I/O
+ * @bgt_paced_ms: total time background work was paced
  *
  * @flash_size: underlying MTD device size (in bytes)
  * @peb_count: count of physical eraseblocks on the MTD device
@@ -625,6 +629,9 @@ struct ubi_device {
 	struct task_struct *bgt_thread;
 	int thread_enabled;
 	char bgt_name[sizeof(UBI_BGT_NAME_PATTERN)+2];
+	unsigned long fg_io_jiffies;
+	unsigned long bgt_paced;
+	unsigned long bgt_paced_ms;
 
 	/* I/O sub-system's stuff */
 	long long flash_size;
@@ -868,6 +875,15 @@ void ubi_update_reserved(struct ubi_device *ubi);
 void ubi_calculate_reserved(struct ubi_device *ubi);
 int ubi_check_pattern(const void *buf, uint8_t patt, int size);
 
+/**
+ * ubi_mark_fg_io - note foreground I/O for background work pacing.
+ * @ubi: UBI device description object
+ */
+static inline void ubi_mark_fg_io(struct ubi_device *ubi)
+{
+	WRITE_ONCE(ubi->fg_io_jiffies, jiffies);
+}
+
 static inline bool ubi_leb_valid(struct ubi_volume *vol, int lnum)
 {
 	return lnum >= 0 && lnum < vol->reserved_pebs;
@@ -919,6 +935,7 @@ int ubi_is_erase_work(struct ubi_work *wrk);
 void ubi_refill_pools(struct ubi_device *ubi);
 int ubi_ensure_anchor_pebs(struct ubi_device *ubi);
 int ubi_bitflip_check(struct ubi_device *ubi, int pnum, int force_scrub);
+void ubi_wl_pending_show(struct ubi_device *ubi, struct seq_file *m);
 
 /* io.c */
 int ubi_io_read(const struct ubi_device *ubi, void *buf, int pnum, int offset,
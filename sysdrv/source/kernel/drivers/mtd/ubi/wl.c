@@ -89,6 +89,7 @@
 #include <linux/crc32.h>
 #include <linux/freezer.h>
 #include <linux/kthread.h>
+#include <linux/module.h>
 #include "ubi.h"
 #include "wl.h"
 
@@ -122,6 +123,33 @@
  */
 #define WL_MAX_FAILURES 32
 
+/*
+ * An erase keeps the flash busy for roughly an eighth of the time it takes
+ * to program a whole eraseblock, charge it accordingly against the budget.
+ */
+#define WL_ERASE_COST_DIV 8
+
+/*
+ * While foreground I/O is seen, background works are paced so that they do
+ * not move more than this many KiB per second. Zero disables pacing.
+ */
+static unsigned int bgt_bw_kbps = 2048;
+module_param(bgt_bw_kbps, uint, 0644);
+MODULE_PARM_DESC(bgt_bw_kbps, "Background WL/erase bandwidth budget in KiB/s while foreground I/O is active, 0 to disable pacing");
+
+/* Foreground counts as active for this long after its last LEB access */
+static unsigned int bgt_idle_ms = 100;
+module_param(bgt_idle_ms, uint, 0644);
+MODULE_PARM_DESC(bgt_idle_ms, "Time after the last foreground I/O before background work runs unpaced");
+
+/*
+ * Below this many free PEBs erase works run ahead of other works and are
+ * never paced, writers are about to need the PEBs they produce.
+ */
+static unsigned int bgt_free_reserve = 8;
+module_param(bgt_free_reserve, uint, 0644);
+MODULE_PARM_DESC(bgt_free_reserve, "Free PEB count below which pending erasures are done first and unpaced");
+
 static int self_check_ec(struct ubi_device *ubi, int pnum, int ec);
 static int self_check_in_wl_tree(const struct ubi_device *ubi,
 				 struct ubi_wl_entry *e, struct rb_root *root);
@@ -178,14 +206,39 @@ static void wl_entry_destroy(struct ubi_device *ubi, struct ubi_wl_entry *e)
 	kmem_cache_free(ubi_wl_entry_slab, e);
 }
 
+static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
+			int shutdown);
+
+/**
+ * next_work - pick the pending work to do next.
+ * @ubi: UBI device description object
+ *
+ * Works are done in order, except that erasures go first while the free PEB
+ * count is below the reserve. Must be called with @ubi->wl_lock held and a
+ * non-empty works list.
+ */
+static struct ubi_work *next_work(struct ubi_device *ubi)
+{
+	struct ubi_work *wrk;
+
+	if (ubi->free_count < bgt_free_reserve)
+		list_for_each_entry(wrk, &ubi->works, list)
+			if (wrk->func == erase_worker)
+				return wrk;
+
+	return list_first_entry(&ubi->works, struct ubi_work, list);
+}
+
 /**
  * do_work - do one pending work.
  * @ubi: UBI device description object
+ * @cost: if not %NULL, returns the bytes to charge against the background
+ *        bandwidth budget, zero if the work must not be paced
  *
  * This function returns zero in case of success and a negative error code in
  * case of failure.
  */
-static int do_work(struct ubi_device *ubi)
+static int do_work(struct ubi_device *ubi, int *cost)
 {
 	int err;
 	struct ubi_work *wrk;
@@ -206,10 +259,18 @@ static int do_work(struct ubi_device *ubi)
 		return 0;
 	}
 
-	wrk = list_entry(ubi->works.next, struct ubi_work, list);
+	wrk = next_work(ubi);
 	list_del(&wrk->list);
 	ubi->works_count -= 1;
 	ubi_assert(ubi->works_count >= 0);
+	if (cost) {
+		if (wrk->func != erase_worker)
+			*cost = ubi->peb_size;
+		else if (ubi->free_count < bgt_free_reserve)
+			*cost = 0;
+		else
+			*cost = ubi->peb_size / WL_ERASE_COST_DIV;
+	}
 	spin_unlock(&ubi->wl_lock);
 
 	/*
@@ -565,9 +626,6 @@ static void schedule_ubi_work(struct ubi_device *ubi, struct ubi_work *wrk)
 	up_read(&ubi->work_sem);
 }
 
-static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
-			int shutdown);
-
 /**
  * schedule_erase - schedule an erase work.
  * @ubi: UBI device description object
@@ -1613,6 +1671,68 @@ static void tree_destroy(struct ubi_device *ubi, struct rb_root *root)
 	}
 }
 
+static bool fg_idle(struct ubi_device *ubi)
+{
+	return time_after_eq(jiffies, READ_ONCE(ubi->fg_io_jiffies) +
+			     msecs_to_jiffies(bgt_idle_ms));
+}
+
+/**
+ * bgt_pace - hold back background work behind foreground I/O.
+ * @ubi: UBI device description object
+ * @cost: bytes charged by the work just done
+ *
+ * Sleeps long enough that background works stay within @bgt_bw_kbps while
+ * foreground I/O is active, or until that I/O goes idle.
+ */
+static void bgt_pace(struct ubi_device *ubi, int cost)
+{
+	unsigned long start = jiffies, end;
+
+	if (!bgt_bw_kbps || !cost || fg_idle(ubi))
+		return;
+
+	end = start + msecs_to_jiffies(div_u64((u64)cost * MSEC_PER_SEC,
+					       bgt_bw_kbps * 1024));
+	/* new works wake us up, keep sleeping until the budget allows */
+	while (time_before(jiffies, end) && !kthread_should_stop() &&
+	       !fg_idle(ubi))
+		schedule_timeout_idle(end - jiffies);
+
+	ubi->bgt_paced++;
+	ubi->bgt_paced_ms += jiffies_to_msecs(jiffies - start);
+}
+
+/**
+ * ubi_wl_pending_show - print the pending background work depth.
+ * @ubi: UBI device description object
+ * @m: seq_file to print into
+ */
+void ubi_wl_pending_show(struct ubi_device *ubi, struct seq_file *m)
+{
+	struct ubi_work *wrk;
+	int works, erase = 0, free_count;
+
+	spin_lock(&ubi->wl_lock);
+	works = ubi->works_count;
+	list_for_each_entry(wrk, &ubi->works, list)
+		if (wrk->func == erase_worker)
+			erase++;
+	free_count = ubi->free_count;
+	spin_unlock(&ubi->wl_lock);
+
+	seq_printf(m, "works: %d\n", works);
+	seq_printf(m, "erase_works: %d\n", erase);
+	seq_printf(m, "other_works: %d\n", works - erase);
+	seq_printf(m, "wl_scheduled: %d\n", ubi->wl_scheduled);
+	seq_printf(m, "free_pebs: %d\n", free_count);
+	seq_printf(m, "free_reserve: %u\n", bgt_free_reserve);
+	seq_printf(m, "foreground_idle: %d\n", fg_idle(ubi));
+	seq_printf(m, "paced: %lu\n", ubi->bgt_paced);
+	seq_printf(m, "paced_ms: %lu\n", ubi->bgt_paced_ms);
+	ubi_fm_pending_show(ubi, m);
+}
+
 /**
  * ubi_thread - UBI background thread.
  * @u: the UBI device description object pointer
@@ -1627,7 +1747,7 @@ int ubi_thread(void *u)
 
 	set_freezable();
 	for (;;) {
-		int err;
+		int err, cost;
 
 		if (kthread_should_stop())
 			break;
@@ -1638,6 +1758,15 @@ int ubi_thread(void *u)
 		spin_lock(&ubi->wl_lock);
 		if (list_empty(&ubi->works) || ubi->ro_mode ||
 		    !ubi->thread_enabled || ubi_dbg_is_bgt_disabled(ubi)) {
+			bool refill = ubi->thread_enabled &&
+				      !ubi_dbg_is_bgt_disabled(ubi) &&
+				      fm_pool_low(ubi);
+
+			/* refill the fastmap pools while nobody is waiting */
+			if (refill && fg_idle(ubi)) {
+				ubi_fm_idle_refill(ubi);
+				refill = false;
+			}
 			set_current_state(TASK_INTERRUPTIBLE);
 			spin_unlock(&ubi->wl_lock);
 
@@ -1653,12 +1782,16 @@ int ubi_thread(void *u)
 				break;
 			}
 
-			schedule();
+			if (refill)
+				schedule_timeout(msecs_to_jiffies(bgt_idle_ms));
+			else
+				schedule();
 			continue;
 		}
 		spin_unlock(&ubi->wl_lock);
 
-		err = do_work(ubi);
+		cost = 0;
+		err = do_work(ubi, &cost);
 		if (err) {
 			ubi_err(ubi, "%s: work failed with error code %d",
 				ubi->bgt_name, err);
@@ -1676,6 +1809,7 @@ int ubi_thread(void *u)
 		} else
 			failures = 0;
 
+		bgt_pace(ubi, cost);
 		cond_resched();
 	}
 
@@ -2069,7 +2203,7 @@ static int produce_free_peb(struct ubi_device *ubi)
 		spin_unlock(&ubi->wl_lock);
 
 		dbg_wl("do one work synchronously");
-		err = do_work(ubi);
+		err = do_work(ubi, NULL);
 
 		spin_lock(&ubi->wl_lock);
 		if (err)
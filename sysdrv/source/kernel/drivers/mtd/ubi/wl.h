@@ -15,6 +15,9 @@ static inline void ubi_fastmap_init(struct ubi_device *ubi, int *count)
 static struct ubi_wl_entry *may_reserve_for_fm(struct ubi_device *ubi,
 					       struct ubi_wl_entry *e,
 					       struct rb_root *root);
+static bool fm_pool_low(struct ubi_device *ubi);
+static void ubi_fm_idle_refill(struct ubi_device *ubi);
+static void ubi_fm_pending_show(struct ubi_device *ubi, struct seq_file *m);
 #else /* !CONFIG_MTD_UBI_FASTMAP */
 static struct ubi_wl_entry *get_peb_for_wl(struct ubi_device *ubi);
 static inline void ubi_fastmap_close(struct ubi_device *ubi) { }
@@ -24,5 +27,9 @@ static struct ubi_wl_entry *may_reserve_for_fm(struct ubi_device *ubi,
 					       struct rb_root *root) {
 	return e;
 }
+static inline bool fm_pool_low(struct ubi_device *ubi) { return false; }
+static inline void ubi_fm_idle_refill(struct ubi_device *ubi) { }
+static inline void ubi_fm_pending_show(struct ubi_device *ubi,
+				       struct seq_file *m) { }
 #endif /* CONFIG_MTD_UBI_FASTMAP */
 #endif /* UBI_WL_H */
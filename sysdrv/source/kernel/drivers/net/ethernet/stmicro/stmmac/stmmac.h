@@ -13,6 +13,7 @@
 #define DRV_MODULE_VERSION	"Jan_2016"
 
 #include <linux/clk.h>
+#include <linux/dim.h>
 #include <linux/if_vlan.h>
 #include <linux/stmmac.h>
 #include <linux/phylink.h>
@@ -22,6 +23,7 @@
 #include <linux/net_tstamp.h>
 #include <linux/reset.h>
 #include <net/page_pool.h>
+#include <net/xdp_sock_drv.h>
 
 struct stmmac_resources {
 	void __iomem *addr;
@@ -31,12 +33,18 @@ struct stmmac_resources {
 	int irq;
 };
 
+enum stmmac_txbuf_type {
+	STMMAC_TXBUF_T_SKB,
+	STMMAC_TXBUF_T_XSK_TX,
+};
+
 struct stmmac_tx_info {
 	dma_addr_t buf;
 	bool map_as_page;
 	unsigned len;
 	bool last_segment;
 	bool is_jumbo;
+	enum stmmac_txbuf_type buf_type;
 };
 
 #define STMMAC_TBS_AVAIL	BIT(0)
@@ -59,6 +67,8 @@ struct stmmac_tx_queue {
 	dma_addr_t dma_tx_phy;
 	u32 tx_tail_addr;
 	u32 mss;
+	struct xsk_buff_pool *xsk_pool;
+	u32 xsk_frames_done;
 };
 
 struct stmmac_rx_buffer {
@@ -95,6 +105,15 @@ struct stmmac_channel {
 	struct stmmac_priv *priv_data;
 	spinlock_t lock;
 	u32 index;
+	/* Adaptive interrupt coalescing */
+	struct dim rx_dim;
+	struct dim tx_dim;
+	u16 rx_dim_events;
+	u16 tx_dim_events;
+	u64 rx_dim_packets;
+	u64 rx_dim_bytes;
+	u64 tx_dim_packets;
+	u64 tx_dim_bytes;
 };
 
 struct stmmac_tc_entry {
@@ -161,6 +180,8 @@ struct stmmac_priv {
 	unsigned int rx_copybreak;
 	u32 rx_riwt;
 	int hwts_rx_en;
+	bool rx_dim_enabled;
+	bool tx_dim_enabled;
 
 	void __iomem *ioaddr;
 	struct net_device *dev;
@@ -259,6 +280,7 @@ int stmmac_mdio_reset(struct mii_bus *mii);
 
 #ifdef CONFIG_STMMAC_ETHTOOL
 void stmmac_set_ethtool_ops(struct net_device *netdev);
+u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv);
 #else
 static inline void stmmac_set_ethtool_ops(struct net_device *netdev)
 {
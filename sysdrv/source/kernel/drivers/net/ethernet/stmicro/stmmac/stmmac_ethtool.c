@@ -746,7 +746,7 @@ static int stmmac_ethtool_op_set_eee(struct net_device *dev,
 	return 0;
 }
 
-static u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
+u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
 {
 	unsigned long clk = clk_get_rate(priv->plat->stmmac_clk);
 
@@ -779,6 +779,8 @@ static int stmmac_get_coalesce(struct net_device *dev,
 
 	ec->tx_coalesce_usecs = priv->tx_coal_timer;
 	ec->tx_max_coalesced_frames = priv->tx_coal_frames;
+	ec->use_adaptive_tx_coalesce = priv->tx_dim_enabled;
+	ec->use_adaptive_rx_coalesce = priv->rx_dim_enabled;
 
 	if (priv->use_riwt) {
 		ec->rx_max_coalesced_frames = priv->rx_coal_frames;
@@ -793,7 +795,13 @@ static int stmmac_set_coalesce(struct net_device *dev,
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
 	u32 rx_cnt = priv->plat->rx_queues_to_use;
+	u32 tx_cnt = priv->plat->tx_queues_to_use;
 	unsigned int rx_riwt;
+	u32 queue;
+
+	/* The RX profiles are applied through the RX watchdog */
+	if (ec->use_adaptive_rx_coalesce && !priv->use_riwt)
+		return -EOPNOTSUPP;
 
 	if (priv->use_riwt && (ec->rx_coalesce_usecs > 0)) {
 		rx_riwt = stmmac_usec2riwt(ec->rx_coalesce_usecs, priv);
@@ -813,6 +821,19 @@ static int stmmac_set_coalesce(struct net_device *dev,
 	    (ec->tx_max_coalesced_frames > STMMAC_TX_MAX_FRAMES))
 		return -EINVAL;
 
+	priv->rx_dim_enabled = !!ec->use_adaptive_rx_coalesce;
+	priv->tx_dim_enabled = !!ec->use_adaptive_tx_coalesce;
+
+	/* Don't let a pending profile change override the values below */
+	for (queue = 0; queue < rx_cnt; queue++) {
+		cancel_work_sync(&priv->channel[queue].rx_dim.work);
+		priv->channel[queue].rx_dim.state = DIM_START_MEASURE;
+	}
+	for (queue = 0; queue < tx_cnt; queue++) {
+		cancel_work_sync(&priv->channel[queue].tx_dim.work);
+		priv->channel[queue].tx_dim.state = DIM_START_MEASURE;
+	}
+
 	/* Only copy relevant parameters, ignore all others. */
 	priv->tx_coal_frames = ec->tx_max_coalesced_frames;
 	priv->tx_coal_timer = ec->tx_coalesce_usecs;
@@ -988,7 +1009,8 @@ static int stmmac_set_tunable(struct net_device *dev,
 
 static const struct ethtool_ops stmmac_ethtool_ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
-				     ETHTOOL_COALESCE_MAX_FRAMES,
+				     ETHTOOL_COALESCE_MAX_FRAMES |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE,
 	.begin = stmmac_check_if_running,
 	.get_drvinfo = stmmac_ethtool_getdrvinfo,
 	.get_msglevel = stmmac_ethtool_getmsglevel,
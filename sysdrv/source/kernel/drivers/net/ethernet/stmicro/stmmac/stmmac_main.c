@@ -94,6 +94,11 @@ MODULE_PARM_DESC(buf_sz, "DMA buffer size");
 
 #define	STMMAC_RX_COPYBREAK	256
 
+/* AF_XDP zero-copy transmit */
+#define STMMAC_XSK_TX_BUDGET_MAX	256
+#define STMMAC_XSK_DMA_ATTR	(DMA_ATTR_SKIP_CPU_SYNC | \
+				 DMA_ATTR_WEAK_ORDERING)
+
 static const u32 default_msg_level = (NETIF_MSG_DRV | NETIF_MSG_PROBE |
 				      NETIF_MSG_LINK | NETIF_MSG_IFUP |
 				      NETIF_MSG_IFDOWN | NETIF_MSG_TIMER);
@@ -178,10 +183,16 @@ static void stmmac_disable_all_queues(struct stmmac_priv *priv)
 	for (queue = 0; queue < maxq; queue++) {
 		struct stmmac_channel *ch = &priv->channel[queue];
 
-		if (queue < rx_queues_cnt)
+		if (queue < rx_queues_cnt) {
 			napi_disable(&ch->rx_napi);
-		if (queue < tx_queues_cnt)
+			cancel_work_sync(&ch->rx_dim.work);
+			ch->rx_dim.state = DIM_START_MEASURE;
+		}
+		if (queue < tx_queues_cnt) {
 			napi_disable(&ch->tx_napi);
+			cancel_work_sync(&ch->tx_dim.work);
+			ch->tx_dim.state = DIM_START_MEASURE;
+		}
 	}
 }
 
@@ -1414,6 +1425,11 @@ static void stmmac_free_tx_buffer(struct stmmac_priv *priv, u32 queue, int i)
 					 DMA_TO_DEVICE);
 	}
 
+	if (tx_q->tx_skbuff_dma[i].buf_type == STMMAC_TXBUF_T_XSK_TX) {
+		tx_q->xsk_frames_done++;
+		tx_q->tx_skbuff_dma[i].buf_type = STMMAC_TXBUF_T_SKB;
+	}
+
 	if (tx_q->tx_skbuff[i]) {
 		dev_kfree_skb_any(tx_q->tx_skbuff[i]);
 		tx_q->tx_skbuff[i] = NULL;
@@ -1546,6 +1562,7 @@ static int init_dma_tx_desc_rings(struct net_device *dev)
 			tx_q->tx_skbuff_dma[i].map_as_page = false;
 			tx_q->tx_skbuff_dma[i].len = 0;
 			tx_q->tx_skbuff_dma[i].last_segment = false;
+			tx_q->tx_skbuff_dma[i].buf_type = STMMAC_TXBUF_T_SKB;
 			tx_q->tx_skbuff[i] = NULL;
 		}
 
@@ -1606,10 +1623,19 @@ static void dma_free_rx_skbufs(struct stmmac_priv *priv, u32 queue)
  */
 static void dma_free_tx_skbufs(struct stmmac_priv *priv, u32 queue)
 {
+	struct stmmac_tx_queue *tx_q = &priv->tx_queue[queue];
 	int i;
 
+	tx_q->xsk_frames_done = 0;
+
 	for (i = 0; i < priv->dma_tx_size; i++)
 		stmmac_free_tx_buffer(priv, queue, i);
+
+	/* Give the frames which never went out back to the socket */
+	if (tx_q->xsk_pool && tx_q->xsk_frames_done) {
+		xsk_tx_completed(tx_q->xsk_pool, tx_q->xsk_frames_done);
+		tx_q->xsk_frames_done = 0;
+	}
 }
 
 /**
@@ -2036,6 +2062,135 @@ static void stmmac_dma_operation_mode(struct stmmac_priv *priv)
 	}
 }
 
+/**
+ * stmmac_flush_tx_descriptors - hand the prepared descriptors to the DMA
+ * @priv: driver private structure
+ * @queue: TX queue index
+ * Description: it rings the TX doorbell, moving the tail pointer up to
+ * cur_tx. The own bits must have been set and made visible already.
+ */
+static void stmmac_flush_tx_descriptors(struct stmmac_priv *priv, u32 queue)
+{
+	struct stmmac_tx_queue *tx_q = &priv->tx_queue[queue];
+	int desc_size;
+
+	stmmac_enable_dma_transmission(priv, priv->ioaddr);
+
+	if (likely(priv->extend_desc))
+		desc_size = sizeof(struct dma_extended_desc);
+	else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+		desc_size = sizeof(struct dma_edesc);
+	else
+		desc_size = sizeof(struct dma_desc);
+
+	tx_q->tx_tail_addr = tx_q->dma_tx_phy + (tx_q->cur_tx * desc_size);
+	stmmac_set_tx_tail_ptr(priv, priv->ioaddr, tx_q->tx_tail_addr, queue);
+}
+
+/**
+ * stmmac_xsk_xmit_zc - transmit frames queued on an AF_XDP socket
+ * @priv: driver private structure
+ * @queue: TX queue index
+ * @budget: maximum number of frames to send
+ * Description: it maps the frames of the socket TX ring straight into the
+ * DMA descriptors, one descriptor per frame, and kicks the DMA once for the
+ * whole batch. Called with the TX queue lock held, the ring is shared with
+ * the stack.
+ * Return: true if the socket TX ring has been drained.
+ */
+static bool stmmac_xsk_xmit_zc(struct stmmac_priv *priv, u32 queue,
+			       u32 budget)
+{
+	struct netdev_queue *nq = netdev_get_tx_queue(priv->dev, queue);
+	struct stmmac_tx_queue *tx_q = &priv->tx_queue[queue];
+	struct xsk_buff_pool *pool = tx_q->xsk_pool;
+	unsigned int entry = tx_q->cur_tx;
+	struct dma_desc *tx_desc = NULL;
+	struct xdp_desc xdp_desc;
+	bool work_done = true;
+
+	/* Avoid the TX timeout as the stack does not see these frames */
+	nq->trans_start = jiffies;
+
+	if (priv->tx_path_in_lpi_mode)
+		stmmac_disable_eee_mode(priv);
+
+	budget = min(budget, stmmac_tx_avail(priv, queue));
+
+	for (; budget; budget--) {
+		dma_addr_t dma_addr;
+		bool set_ic;
+
+		/* Leave room for the stack, the ring is shared with it */
+		if (unlikely(stmmac_tx_avail(priv, queue) <
+			     STMMAC_TX_THRESH(priv)) ||
+		    !netif_carrier_ok(priv->dev)) {
+			work_done = false;
+			break;
+		}
+
+		if (!xsk_tx_peek_desc(pool, &xdp_desc))
+			break;
+
+		if (likely(priv->extend_desc))
+			tx_desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+			tx_desc = &tx_q->dma_entx[entry].basic;
+		else
+			tx_desc = tx_q->dma_tx + entry;
+
+		dma_addr = xsk_buff_raw_get_dma(pool, xdp_desc.addr);
+		xsk_buff_raw_dma_sync_for_device(pool, dma_addr, xdp_desc.len);
+
+		/* The pool owns the mapping, nothing to unmap on completion */
+		tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_XSK_TX;
+		tx_q->tx_skbuff_dma[entry].buf = 0;
+		tx_q->tx_skbuff_dma[entry].len = xdp_desc.len;
+		tx_q->tx_skbuff_dma[entry].map_as_page = false;
+		tx_q->tx_skbuff_dma[entry].last_segment = true;
+		tx_q->tx_skbuff_dma[entry].is_jumbo = false;
+
+		stmmac_set_desc_addr(priv, tx_desc, dma_addr);
+
+		tx_q->tx_count_frames++;
+
+		if (!priv->tx_coal_frames)
+			set_ic = false;
+		else if (tx_q->tx_count_frames % priv->tx_coal_frames == 0)
+			set_ic = true;
+		else
+			set_ic = false;
+
+		if (set_ic) {
+			tx_q->tx_count_frames = 0;
+			stmmac_set_tx_ic(priv, tx_desc);
+			priv->xstats.tx_set_ic_bit++;
+		}
+
+		stmmac_prepare_tx_desc(priv, tx_desc, 1, xdp_desc.len,
+				       priv->plat->tx_coe, priv->mode, 1, 1,
+				       xdp_desc.len);
+
+		priv->dev->stats.tx_bytes += xdp_desc.len;
+
+		entry = STMMAC_GET_ENTRY(entry, priv->dma_tx_size);
+		tx_q->cur_tx = entry;
+	}
+
+	if (tx_desc) {
+		/* Make the descriptors visible before ringing the doorbell,
+		 * once for the whole batch.
+		 */
+		wmb();
+
+		stmmac_flush_tx_descriptors(priv, queue);
+		xsk_tx_release(pool);
+	}
+
+	/* An exhausted budget may have left frames in the socket ring */
+	return work_done && budget;
+}
+
 /**
  * stmmac_tx_clean - to manage the transmission completion
  * @priv: driver private structure
@@ -2047,7 +2202,7 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 {
 	struct stmmac_tx_queue *tx_q = &priv->tx_queue[queue];
 	unsigned int bytes_compl = 0, pkts_compl = 0;
-	unsigned int entry, count = 0;
+	unsigned int entry, count = 0, xsk_frames = 0;
 
 	__netif_tx_lock_bh(netdev_get_tx_queue(priv->dev, queue));
 
@@ -2112,6 +2267,11 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 		tx_q->tx_skbuff_dma[entry].last_segment = false;
 		tx_q->tx_skbuff_dma[entry].is_jumbo = false;
 
+		if (tx_q->tx_skbuff_dma[entry].buf_type == STMMAC_TXBUF_T_XSK_TX) {
+			xsk_frames++;
+			tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_SKB;
+		}
+
 		if (likely(skb != NULL)) {
 			pkts_compl++;
 			bytes_compl += skb->len;
@@ -2128,6 +2288,9 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 	netdev_tx_completed_queue(netdev_get_tx_queue(priv->dev, queue),
 				  pkts_compl, bytes_compl);
 
+	priv->channel[queue].tx_dim_packets += pkts_compl;
+	priv->channel[queue].tx_dim_bytes += bytes_compl;
+
 	if (unlikely(netif_tx_queue_stopped(netdev_get_tx_queue(priv->dev,
 								queue))) &&
 	    stmmac_tx_avail(priv, queue) > STMMAC_TX_THRESH(priv)) {
@@ -2137,6 +2300,18 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 		netif_tx_wake_queue(netdev_get_tx_queue(priv->dev, queue));
 	}
 
+	if (tx_q->xsk_pool) {
+		if (xsk_frames)
+			xsk_tx_completed(tx_q->xsk_pool, xsk_frames);
+
+		if (xsk_uses_need_wakeup(tx_q->xsk_pool))
+			xsk_set_tx_need_wakeup(tx_q->xsk_pool);
+
+		/* Keep polling while the socket has more frames to send */
+		if (!stmmac_xsk_xmit_zc(priv, queue, STMMAC_XSK_TX_BUDGET_MAX))
+			count = budget;
+	}
+
 	if ((priv->eee_enabled) && (!priv->tx_path_in_lpi_mode)) {
 		stmmac_enable_eee_mode(priv);
 		mod_timer(&priv->eee_ctrl_timer, STMMAC_LPI_T(priv->tx_lpi_timer));
@@ -2152,18 +2327,14 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 }
 
 /**
- * stmmac_tx_err - to manage the tx error
+ * stmmac_reset_tx_queue - drop the pending frames and restart a TX channel
  * @priv: driver private structure
  * @chan: channel index
- * Description: it cleans the descriptors and restarts the transmission
- * in case of transmission errors.
  */
-static void stmmac_tx_err(struct stmmac_priv *priv, u32 chan)
+static void stmmac_reset_tx_queue(struct stmmac_priv *priv, u32 chan)
 {
 	struct stmmac_tx_queue *tx_q = &priv->tx_queue[chan];
 
-	netif_tx_stop_queue(netdev_get_tx_queue(priv->dev, chan));
-
 	stmmac_stop_tx_dma(priv, chan);
 	dma_free_tx_skbufs(priv, chan);
 	stmmac_clear_tx_descriptors(priv, chan);
@@ -2174,6 +2345,20 @@ static void stmmac_tx_err(struct stmmac_priv *priv, u32 chan)
 	stmmac_init_tx_chan(priv, priv->ioaddr, priv->plat->dma_cfg,
 			    tx_q->dma_tx_phy, chan);
 	stmmac_start_tx_dma(priv, chan);
+}
+
+/**
+ * stmmac_tx_err - to manage the tx error
+ * @priv: driver private structure
+ * @chan: channel index
+ * Description: it cleans the descriptors and restarts the transmission
+ * in case of transmission errors.
+ */
+static void stmmac_tx_err(struct stmmac_priv *priv, u32 chan)
+{
+	netif_tx_stop_queue(netdev_get_tx_queue(priv->dev, chan));
+
+	stmmac_reset_tx_queue(priv, chan);
 
 	priv->dev->stats.tx_errors++;
 	netif_tx_wake_queue(netdev_get_tx_queue(priv->dev, chan));
@@ -3182,7 +3367,7 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	struct dma_desc *desc, *first, *mss_desc = NULL;
 	struct stmmac_priv *priv = netdev_priv(dev);
-	int desc_size, tmp_pay_len = 0, first_tx;
+	int tmp_pay_len = 0, first_tx;
 	int nfrags = skb_shinfo(skb)->nr_frags;
 	u32 queue = skb_get_queue_mapping(skb);
 	unsigned int first_entry, tx_packets;
@@ -3396,15 +3581,10 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 		print_pkt(skb->data, skb_headlen(skb));
 	}
 
-	netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len);
-
-	if (tx_q->tbs & STMMAC_TBS_AVAIL)
-		desc_size = sizeof(struct dma_edesc);
-	else
-		desc_size = sizeof(struct dma_desc);
-
-	tx_q->tx_tail_addr = tx_q->dma_tx_phy + (tx_q->cur_tx * desc_size);
-	stmmac_set_tx_tail_ptr(priv, priv->ioaddr, tx_q->tx_tail_addr, queue);
+	/* Ring the doorbell once for a burst of frames from the stack */
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len,
+				   netdev_xmit_more()))
+		stmmac_flush_tx_descriptors(priv, queue);
 	stmmac_tx_timer_arm(priv, queue);
 
 	return NETDEV_TX_OK;
@@ -3413,6 +3593,8 @@ dma_map_err:
 	dev_err(priv->device, "Tx dma map failed\n");
 	dev_kfree_skb(skb);
 	priv->dev->stats.tx_dropped++;
+	/* Don't hold back the frames batched before this one */
+	stmmac_flush_tx_descriptors(priv, queue);
 	return NETDEV_TX_OK;
 }
 
@@ -3434,7 +3616,7 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	int nfrags = skb_shinfo(skb)->nr_frags;
 	int gso = skb_shinfo(skb)->gso_type;
 	struct dma_edesc *tbs_desc = NULL;
-	int entry, desc_size, first_tx;
+	int entry, first_tx;
 	struct dma_desc *desc, *first;
 	struct stmmac_tx_queue *tx_q;
 	bool has_vlan, set_ic;
@@ -3644,19 +3826,12 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	 */
 	wmb();
 
-	netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len);
-
-	stmmac_enable_dma_transmission(priv, priv->ioaddr);
-
-	if (likely(priv->extend_desc))
-		desc_size = sizeof(struct dma_extended_desc);
-	else if (tx_q->tbs & STMMAC_TBS_AVAIL)
-		desc_size = sizeof(struct dma_edesc);
-	else
-		desc_size = sizeof(struct dma_desc);
-
-	tx_q->tx_tail_addr = tx_q->dma_tx_phy + (tx_q->cur_tx * desc_size);
-	stmmac_set_tx_tail_ptr(priv, priv->ioaddr, tx_q->tx_tail_addr, queue);
+	/* Ring the doorbell once for a burst of frames from the stack, the
+	 * software GSO segments of a frame come in as such a burst.
+	 */
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len,
+				   netdev_xmit_more()))
+		stmmac_flush_tx_descriptors(priv, queue);
 	stmmac_tx_timer_arm(priv, queue);
 
 	return NETDEV_TX_OK;
@@ -3665,6 +3840,8 @@ dma_map_err:
 	netdev_err(priv->dev, "Tx DMA map failed\n");
 	dev_kfree_skb(skb);
 	priv->dev->stats.tx_dropped++;
+	/* Don't hold back the frames batched before this one */
+	stmmac_flush_tx_descriptors(priv, queue);
 	return NETDEV_TX_OK;
 }
 
@@ -4010,6 +4187,8 @@ drain_data:
 
 		priv->dev->stats.rx_packets++;
 		priv->dev->stats.rx_bytes += len;
+		ch->rx_dim_packets++;
+		ch->rx_dim_bytes += len;
 		count++;
 	}
 
@@ -4027,6 +4206,83 @@ drain_data:
 	return count;
 }
 
+/**
+ * stmmac_rx_dim_work - apply a new adaptive RX coalescing profile
+ * @work: work item of the RX dim of a channel
+ * Description: the profiles are applied through the RX watchdog, which is
+ * programmed for all the RX channels at once.
+ */
+static void stmmac_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct stmmac_channel *ch =
+		container_of(dim, struct stmmac_channel, rx_dim);
+	struct stmmac_priv *priv = ch->priv_data;
+	struct dim_cq_moder moder;
+	u32 riwt;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	riwt = clamp_t(u32, stmmac_usec2riwt(moder.usec, priv),
+		       MIN_DMA_RIWT, MAX_DMA_RIWT);
+
+	if (riwt != priv->rx_riwt) {
+		priv->rx_riwt = riwt;
+		stmmac_rx_watchdog(priv, priv->ioaddr, riwt,
+				   priv->plat->rx_queues_to_use);
+	}
+
+	dim->state = DIM_START_MEASURE;
+}
+
+/**
+ * stmmac_tx_dim_work - apply a new adaptive TX coalescing profile
+ * @work: work item of the TX dim of a channel
+ * Description: the profiles set the frame count between two completion
+ * interrupts and the cleaning timer, which are shared by all the TX queues.
+ */
+static void stmmac_tx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct stmmac_priv *priv;
+	struct dim_cq_moder moder;
+
+	priv = container_of(dim, struct stmmac_channel, tx_dim)->priv_data;
+	moder = net_dim_get_tx_moderation(dim->mode, dim->profile_ix);
+
+	priv->tx_coal_frames = clamp_t(u32, moder.pkts, 1,
+				       STMMAC_TX_MAX_FRAMES);
+	priv->tx_coal_timer = clamp_t(u32, moder.usec, 1,
+				      STMMAC_MAX_COAL_TX_TICK);
+
+	dim->state = DIM_START_MEASURE;
+}
+
+static void stmmac_rx_dim_update(struct stmmac_priv *priv,
+				 struct stmmac_channel *ch)
+{
+	struct dim_sample sample = {};
+
+	if (!priv->rx_dim_enabled)
+		return;
+
+	dim_update_sample(ch->rx_dim_events++, ch->rx_dim_packets,
+			  ch->rx_dim_bytes, &sample);
+	net_dim(&ch->rx_dim, sample);
+}
+
+static void stmmac_tx_dim_update(struct stmmac_priv *priv,
+				 struct stmmac_channel *ch)
+{
+	struct dim_sample sample = {};
+
+	if (!priv->tx_dim_enabled)
+		return;
+
+	dim_update_sample(ch->tx_dim_events++, ch->tx_dim_packets,
+			  ch->tx_dim_bytes, &sample);
+	net_dim(&ch->tx_dim, sample);
+}
+
 static int stmmac_napi_poll_rx(struct napi_struct *napi, int budget)
 {
 	struct stmmac_channel *ch =
@@ -4041,6 +4297,8 @@ static int stmmac_napi_poll_rx(struct napi_struct *napi, int budget)
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
 		unsigned long flags;
 
+		stmmac_rx_dim_update(priv, ch);
+
 		spin_lock_irqsave(&ch->lock, flags);
 		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 1, 0);
 		spin_unlock_irqrestore(&ch->lock, flags);
@@ -4065,6 +4323,8 @@ static int stmmac_napi_poll_tx(struct napi_struct *napi, int budget)
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
 		unsigned long flags;
 
+		stmmac_tx_dim_update(priv, ch);
+
 		spin_lock_irqsave(&ch->lock, flags);
 		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 0, 1);
 		spin_unlock_irqrestore(&ch->lock, flags);
@@ -4745,6 +5005,102 @@ del_vlan_error:
 	return ret;
 }
 
+static int stmmac_xsk_pool_setup(struct stmmac_priv *priv,
+				 struct xsk_buff_pool *pool, u16 queue)
+{
+	bool running = netif_running(priv->dev);
+	struct stmmac_tx_queue *tx_q;
+	struct xsk_buff_pool *old;
+	struct stmmac_channel *ch;
+	struct netdev_queue *nq;
+	int ret;
+
+	if (queue >= priv->plat->tx_queues_to_use)
+		return -EINVAL;
+
+	tx_q = &priv->tx_queue[queue];
+	ch = &priv->channel[queue];
+	nq = netdev_get_tx_queue(priv->dev, queue);
+	old = tx_q->xsk_pool;
+
+	if (pool) {
+		if (old)
+			return -EBUSY;
+
+		ret = xsk_pool_dma_map(pool, priv->device, STMMAC_XSK_DMA_ATTR);
+		if (ret)
+			return ret;
+	} else if (!old) {
+		return -EINVAL;
+	}
+
+	if (running)
+		napi_disable(&ch->tx_napi);
+
+	/* Frames of the old pool may still sit in the ring, return them */
+	if (running && !pool) {
+		__netif_tx_lock_bh(nq);
+		netif_tx_stop_queue(nq);
+		stmmac_reset_tx_queue(priv, queue);
+		netif_tx_wake_queue(nq);
+		__netif_tx_unlock_bh(nq);
+	}
+
+	tx_q->xsk_pool = pool;
+
+	if (running)
+		napi_enable(&ch->tx_napi);
+
+	if (!pool)
+		xsk_pool_dma_unmap(old, STMMAC_XSK_DMA_ATTR);
+
+	netdev_info(priv->dev, "AF_XDP zero-copy TX %s on queue %d\n",
+		    pool ? "enabled" : "disabled", queue);
+
+	return 0;
+}
+
+static int stmmac_bpf(struct net_device *dev, struct netdev_bpf *bpf)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+
+	switch (bpf->command) {
+	case XDP_SETUP_XSK_POOL:
+		return stmmac_xsk_pool_setup(priv, bpf->xsk.pool,
+					     bpf->xsk.queue_id);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int stmmac_xsk_wakeup(struct net_device *dev, u32 queue, u32 flags)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	struct stmmac_channel *ch;
+
+	if (test_bit(STMMAC_DOWN, &priv->state) || !netif_carrier_ok(dev))
+		return -ENETDOWN;
+
+	if (queue >= priv->plat->tx_queues_to_use ||
+	    !priv->tx_queue[queue].xsk_pool)
+		return -EINVAL;
+
+	ch = &priv->channel[queue];
+
+	/* The TX napi sends the frames queued on the socket */
+	if (!napi_if_scheduled_mark_missed(&ch->tx_napi) &&
+	    napi_schedule_prep(&ch->tx_napi)) {
+		unsigned long irqflags;
+
+		spin_lock_irqsave(&ch->lock, irqflags);
+		stmmac_disable_dma_irq(priv, priv->ioaddr, ch->index, 0, 1);
+		spin_unlock_irqrestore(&ch->lock, irqflags);
+		__napi_schedule(&ch->tx_napi);
+	}
+
+	return 0;
+}
+
 static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_open = stmmac_open,
 	.ndo_start_xmit = stmmac_xmit,
@@ -4763,6 +5119,8 @@ static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_set_mac_address = stmmac_set_mac_address,
 	.ndo_vlan_rx_add_vid = stmmac_vlan_rx_add_vid,
 	.ndo_vlan_rx_kill_vid = stmmac_vlan_rx_kill_vid,
+	.ndo_bpf = stmmac_bpf,
+	.ndo_xsk_wakeup = stmmac_xsk_wakeup,
 };
 
 static void stmmac_reset_subtask(struct stmmac_priv *priv)
@@ -4918,6 +5276,11 @@ static void stmmac_napi_add(struct net_device *dev)
 		ch->index = queue;
 		spin_lock_init(&ch->lock);
 
+		INIT_WORK(&ch->rx_dim.work, stmmac_rx_dim_work);
+		ch->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+		INIT_WORK(&ch->tx_dim.work, stmmac_tx_dim_work);
+		ch->tx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+
 		if (queue < priv->plat->rx_queues_to_use) {
 			netif_napi_add(dev, &ch->rx_napi, stmmac_napi_poll_rx,
 				       rx_budget);
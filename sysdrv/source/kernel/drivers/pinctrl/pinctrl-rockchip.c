@@ -1175,7 +1175,70 @@ static int rockchip_verify_mux(struct rockchip_pin_bank *bank,
  * @pin: pin to change
  * @mux: new mux function to set
  */
-static int rockchip_set_mux(struct rockchip_pin_bank *bank, int pin, int mux)
+/*
+ * Iomux, pull, drive and friends live in registers where the upper half is a
+ * write-enable mask for the lower half. Only the fields with their mask bits
+ * set change, so these are written directly instead of going through a
+ * read-modify-write, and the fields of several pins sharing a register can be
+ * merged into a single write.
+ */
+#define ROCKCHIP_MUX_BATCH_MAX	16
+
+struct rockchip_mux_batch {
+	unsigned int nr;
+	struct {
+		struct regmap *regmap;
+		u32 reg;
+		u32 data;
+	} w[ROCKCHIP_MUX_BATCH_MAX];
+};
+
+static int rockchip_mux_batch_flush(struct rockchip_mux_batch *batch)
+{
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < batch->nr && !ret; i++)
+		ret = regmap_write(batch->w[i].regmap, batch->w[i].reg,
+				   batch->w[i].data);
+	batch->nr = 0;
+
+	return ret;
+}
+
+static int rockchip_hiword_write(struct rockchip_mux_batch *batch,
+				 struct regmap *regmap, u32 reg, u32 data)
+{
+	unsigned int i;
+	int ret;
+
+	if (!batch)
+		return regmap_write(regmap, reg, data);
+
+	for (i = 0; i < batch->nr; i++) {
+		if (batch->w[i].regmap == regmap && batch->w[i].reg == reg) {
+			batch->w[i].data &= ~(data >> 16);
+			batch->w[i].data |= data;
+			return 0;
+		}
+	}
+
+	if (batch->nr == ROCKCHIP_MUX_BATCH_MAX) {
+		ret = rockchip_mux_batch_flush(batch);
+		if (ret)
+			return ret;
+	}
+
+	batch->w[batch->nr].regmap = regmap;
+	batch->w[batch->nr].reg = reg;
+	batch->w[batch->nr].data = data;
+	batch->nr++;
+
+	return 0;
+}
+
+static int __rockchip_set_mux(struct rockchip_pin_bank *bank, int pin, int mux,
+			      struct rockchip_mux_batch *batch)
 {
 	struct rockchip_pinctrl *info = bank->drvdata;
 	struct rockchip_pin_ctrl *ctrl = info->ctrl;
@@ -1315,14 +1378,18 @@ static int rockchip_set_mux(struct rockchip_pin_bank *bank, int pin, int mux)
 		ret = regmap_write(regmap, reg, data);
 	} else {
 		data = (mask << (bit + 16));
-		rmask = data | (data >> 16);
 		data |= (mux & mask) << bit;
-		ret = regmap_update_bits(regmap, reg, rmask, data);
+		ret = rockchip_hiword_write(batch, regmap, reg, data);
 	}
 
 	return ret;
 }
 
+static int rockchip_set_mux(struct rockchip_pin_bank *bank, int pin, int mux)
+{
+	return __rockchip_set_mux(bank, pin, mux, NULL);
+}
+
 #define PX30_PULL_PMU_OFFSET		0x10
 #define PX30_PULL_GRF_OFFSET		0x60
 #define PX30_PULL_BITS_PER_PIN		2
@@ -3067,10 +3134,9 @@ static int rockchip_set_drive_perpin(struct rockchip_pin_bank *bank,
 config:
 	/* enable the write to the equivalent lower bits */
 	data = ((1 << rmask_bits) - 1) << (bit + 16);
-	rmask = data | (data >> 16);
 	data |= (ret << bit);
 
-	err = regmap_update_bits(regmap, reg, rmask, data);
+	err = rockchip_hiword_write(NULL, regmap, reg, data);
 	if (err)
 		return err;
 
@@ -3187,7 +3253,7 @@ static int rockchip_set_pull(struct rockchip_pin_bank *bank,
 	struct regmap *regmap;
 	int reg, ret, i, pull_type;
 	u8 bit;
-	u32 data, rmask;
+	u32 data;
 
 	dev_dbg(dev, "setting pull of GPIO%d-%d to %d\n", bank->bank_num, pin_num, pull);
 
@@ -3246,10 +3312,9 @@ static int rockchip_set_pull(struct rockchip_pin_bank *bank,
 
 		/* enable the write to the equivalent lower bits */
 		data = ((1 << RK3188_PULL_BITS_PER_PIN) - 1) << (bit + 16);
-		rmask = data | (data >> 16);
 		data |= (ret << bit);
 
-		ret = regmap_update_bits(regmap, reg, rmask, data);
+		ret = rockchip_hiword_write(NULL, regmap, reg, data);
 		break;
 	default:
 		dev_err(dev, "unsupported pinctrl type\n");
@@ -3348,7 +3413,7 @@ static int rockchip_set_schmitt(struct rockchip_pin_bank *bank,
 	struct regmap *regmap;
 	int reg, ret;
 	u8 bit;
-	u32 data, rmask;
+	u32 data;
 
 	dev_dbg(dev, "setting input schmitt of GPIO%d-%d to %d\n",
 		bank->bank_num, pin_num, enable);
@@ -3362,16 +3427,14 @@ static int rockchip_set_schmitt(struct rockchip_pin_bank *bank,
 	case RK3562:
 	case RK3568:
 		data = ((1 << RK3568_SCHMITT_BITS_PER_PIN) - 1) << (bit + 16);
-		rmask = data | (data >> 16);
 		data |= ((enable ? 0x2 : 0x1) << bit);
 		break;
 	default:
 		data = BIT(bit + 16) | (enable << bit);
-		rmask = BIT(bit + 16) | BIT(bit);
 		break;
 	}
 
-	return regmap_update_bits(regmap, reg, rmask, data);
+	return rockchip_hiword_write(NULL, regmap, reg, data);
 }
 
 #define PX30_SLEW_RATE_PMU_OFFSET		0x30
@@ -3437,7 +3500,7 @@ static int rockchip_set_slew_rate(struct rockchip_pin_bank *bank,
 	struct regmap *regmap;
 	int reg, ret;
 	u8 bit;
-	u32 data, rmask;
+	u32 data;
 	int drv_type = bank->drv[pin_num / 8].drv_type;
 
 	if (drv_type == DRV_TYPE_IO_SMIC)
@@ -3452,9 +3515,8 @@ static int rockchip_set_slew_rate(struct rockchip_pin_bank *bank,
 
 	/* enable the write to the equivalent lower bits */
 	data = BIT(bit + 16) | (speed << bit);
-	rmask = BIT(bit + 16) | BIT(bit);
 
-	return regmap_update_bits(regmap, reg, rmask, data);
+	return rockchip_hiword_write(NULL, regmap, reg, data);
 }
 
 /*
@@ -3496,6 +3558,7 @@ static int rockchip_pmx_set(struct pinctrl_dev *pctldev, unsigned selector,
 	const struct rockchip_pin_config *data = info->groups[group].data;
 	struct device *dev = info->dev;
 	struct rockchip_pin_bank *bank;
+	struct rockchip_mux_batch batch;
 	int cnt, ret = 0;
 
 	dev_dbg(dev, "enable function %s group %s\n",
@@ -3503,16 +3566,23 @@ static int rockchip_pmx_set(struct pinctrl_dev *pctldev, unsigned selector,
 
 	/*
 	 * for each pin in the pin group selected, program the corresponding
-	 * pin function number in the config register.
+	 * pin function number in the config register. Pins sharing a register
+	 * are written together once the whole group is done.
 	 */
+	batch.nr = 0;
 	for (cnt = 0; cnt < info->groups[group].npins; cnt++) {
 		bank = pin_to_bank(info, pins[cnt]);
-		ret = rockchip_set_mux(bank, pins[cnt] - bank->pin_base,
-				       data[cnt].func);
+		ret = __rockchip_set_mux(bank, pins[cnt] - bank->pin_base,
+					 data[cnt].func, &batch);
 		if (ret)
 			break;
 	}
 
+	if (!ret)
+		ret = rockchip_mux_batch_flush(&batch);
+	else
+		rockchip_mux_batch_flush(&batch);
+
 	if (ret && cnt) {
 		/* revert the already done pin settings */
 		for (cnt--; cnt >= 0 && !data[cnt].func; cnt--)
@@ -313,6 +313,7 @@ struct rockchip_drv {
  * @grange: gpio range
  * @slock: spinlock for the gpio bank
  * @toggle_edge_mode: bit mask to toggle (falling/rising) edge mode
+ * @irq_timestamp: time in ns the pending interrupts being handled were read
  * @recalced_mask: bit mask to indicate a need to recalulate the mask
  * @route_mask: bits describing the routing pins of per bank
  * @deferred_output: gpio output settings to be done after gpio bank probed
@@ -343,6 +344,7 @@ struct rockchip_pin_bank {
 	const struct rockchip_gpio_regs	*gpio_regs;
 	u32				gpio_type;
 	u32				toggle_edge_mode;
+	u64				irq_timestamp;
 	u32				recalced_mask;
 	u32				route_mask;
 	struct list_head		deferred_pins;
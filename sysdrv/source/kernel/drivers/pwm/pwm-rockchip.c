@@ -7,15 +7,20 @@
  */
 
 #include <linux/clk.h>
+#include <linux/ctype.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/irq.h>
+#include <linux/kfifo.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/pinctrl/consumer.h>
 #include <linux/platform_device.h>
 #include <linux/pwm.h>
+#include <linux/spinlock.h>
+#include <linux/sysfs.h>
 #include <linux/time.h>
 #include "pwm-rockchip.h"
 
@@ -26,6 +31,8 @@
 
 #define PWM_ENABLE		(1 << 0)
 #define PWM_CONTINUOUS		(1 << 1)
+#define PWM_CAPTURE		(2 << 1)
+#define PWM_MODE_MASK		(3 << 1)
 #define PWM_DUTY_POSITIVE	(1 << 3)
 #define PWM_DUTY_NEGATIVE	(0 << 3)
 #define PWM_INACTIVE_NEGATIVE	(0 << 4)
@@ -44,6 +51,24 @@
 #define PWM_REG_INT_EN(n)	((3 - (n)) * 0x10 + 0x14)
 
 #define PWM_CH_INT(n)		BIT(n)
+#define PWM_CH_POL(n)		BIT((n) + 8)
+
+#define PWM_WAVE_FIFO_SIZE	64
+#define PWM_CAPTURE_FIFO_SIZE	128
+
+/* A waveform segment, in clock cycles */
+struct rockchip_pwm_segment {
+	u32 period;
+	u32 duty;
+	u32 count;
+};
+
+/* A captured pulse, in clock cycles, stamped with CLOCK_MONOTONIC */
+struct rockchip_pwm_sample {
+	u64 timestamp;
+	u32 high;
+	u32 low;
+};
 
 struct rockchip_pwm_chip {
 	struct pwm_chip chip;
@@ -59,6 +84,23 @@ struct rockchip_pwm_chip {
 	bool oneshot;
 	int channel_id;
 	int irq;
+
+	/*
+	 * Waveform playback and capture, both driven from the channel IRQ.
+	 * wave_lock protects the playback state and the segment queue.
+	 */
+	spinlock_t wave_lock;
+	DECLARE_KFIFO(wave_fifo, struct rockchip_pwm_segment, PWM_WAVE_FIFO_SIZE);
+	struct rockchip_pwm_segment wave_seg;
+	u32 wave_left;
+	bool wave_running;
+
+	struct mutex capture_lock;
+	DECLARE_KFIFO(capture_fifo, struct rockchip_pwm_sample,
+		      PWM_CAPTURE_FIFO_SIZE);
+	struct kernfs_node *capture_kn;
+	unsigned int capture_dropped;
+	bool capturing;
 };
 
 struct rockchip_pwm_regs {
@@ -116,6 +158,61 @@ static void rockchip_pwm_get_state(struct pwm_chip *chip,
 	clk_disable(pc->pclk);
 }
 
+/*
+ * Load the next chunk of the current segment, or of the next queued one. The
+ * oneshot counter only goes up to PWM_ONESHOT_COUNT_MAX periods, longer
+ * segments are played in several chunks. Called with wave_lock held.
+ */
+static void rockchip_pwm_wave_next(struct rockchip_pwm_chip *pc)
+{
+	struct rockchip_pwm_segment *seg = &pc->wave_seg;
+	u32 ctrl, int_ctrl, n;
+
+	ctrl = readl_relaxed(pc->base + pc->data->regs.ctrl);
+	ctrl &= ~(PWM_ENABLE | PWM_MODE_MASK | PWM_ONESHOT_COUNT_MASK);
+	writel_relaxed(ctrl, pc->base + pc->data->regs.ctrl);
+
+	if (!pc->wave_left && kfifo_get(&pc->wave_fifo, seg))
+		pc->wave_left = seg->count;
+
+	if (!pc->wave_left) {
+		int_ctrl = readl_relaxed(pc->base + PWM_REG_INT_EN(pc->channel_id));
+		int_ctrl &= ~PWM_CH_INT(pc->channel_id);
+		writel_relaxed(int_ctrl, pc->base + PWM_REG_INT_EN(pc->channel_id));
+
+		pc->wave_running = false;
+		clk_disable(pc->clk);
+		clk_disable(pc->pclk);
+		return;
+	}
+
+	n = min_t(u32, pc->wave_left, PWM_ONESHOT_COUNT_MAX);
+	pc->wave_left -= n;
+
+	writel_relaxed(seg->period, pc->base + pc->data->regs.period);
+	writel_relaxed(seg->duty, pc->base + pc->data->regs.duty);
+	ctrl |= ((n - 1) << PWM_ONESHOT_COUNT_SHIFT) | PWM_ENABLE;
+	writel(ctrl, pc->base + pc->data->regs.ctrl);
+}
+
+static void rockchip_pwm_capture_sample(struct rockchip_pwm_chip *pc, u32 sts)
+{
+	struct rockchip_pwm_sample sample;
+
+	/* The high and low times are only both valid on a falling edge */
+	if (sts & PWM_CH_POL(pc->channel_id))
+		return;
+
+	sample.timestamp = ktime_get_ns();
+	sample.high = readl_relaxed(pc->base + pc->data->regs.period);
+	sample.low = readl_relaxed(pc->base + pc->data->regs.duty);
+
+	if (!kfifo_put(&pc->capture_fifo, sample))
+		pc->capture_dropped++;
+
+	sysfs_notify_dirent(pc->capture_kn);
+}
+
 static irqreturn_t rockchip_pwm_oneshot_irq(int irq, void *data)
 {
 	struct rockchip_pwm_chip *pc = data;
@@ -130,8 +227,22 @@ static irqreturn_t rockchip_pwm_oneshot_irq(int irq, void *data)
 	if ((val & PWM_CH_INT(id)) == 0)
 		return IRQ_NONE;
 
+	if (READ_ONCE(pc->capturing)) {
+		rockchip_pwm_capture_sample(pc, val);
+		writel_relaxed(PWM_CH_INT(id), pc->base + PWM_REG_INTSTS(id));
+		return IRQ_HANDLED;
+	}
+
 	writel_relaxed(PWM_CH_INT(id), pc->base + PWM_REG_INTSTS(id));
 
+	spin_lock(&pc->wave_lock);
+	if (pc->wave_running) {
+		rockchip_pwm_wave_next(pc);
+		spin_unlock(&pc->wave_lock);
+		return IRQ_HANDLED;
+	}
+	spin_unlock(&pc->wave_lock);
+
 	/*
 	 * Set pwm state to disabled when the oneshot mode finished.
 	 */
@@ -281,6 +392,9 @@ static int rockchip_pwm_apply(struct pwm_chip *chip, struct pwm_device *pwm,
 	bool enabled;
 	int ret = 0;
 
+	if (READ_ONCE(pc->wave_running) || READ_ONCE(pc->capturing))
+		return -EBUSY;
+
 	ret = clk_enable(pc->pclk);
 	if (ret)
 		return ret;
@@ -317,6 +431,305 @@ static const struct pwm_ops rockchip_pwm_ops = {
 	.owner = THIS_MODULE,
 };
 
+/*
+ * Buffered waveform output and capture
+ *
+ * Writing "period_ns duty_ns count" lines to the waveform attribute queues
+ * segments that are played back to back from the oneshot IRQ, so the output
+ * of an IR LED or a stepper driver doesn't need a userspace update per
+ * segment. Writing "stop" drops the queue and stops the output. Segments are
+ * restarted from the IRQ, the output sits at its inactive level for the IRQ
+ * latency in between.
+ *
+ * Writing 1 to capture_enable switches the channel to capture mode. Each
+ * pulse is stamped in the IRQ and queued, reading capture returns them as
+ * "timestamp_ns high_ns low_ns" lines and poll() on it wakes up when new
+ * pulses come in.
+ *
+ * Both modes take the channel over, the PWM API gets -EBUSY meanwhile.
+ */
+static bool rockchip_pwm_hw_enabled(struct rockchip_pwm_chip *pc)
+{
+	return readl_relaxed(pc->base + pc->data->regs.ctrl) & PWM_ENABLE;
+}
+
+static u32 rockchip_pwm_ns_to_cycles(struct rockchip_pwm_chip *pc, u64 ns)
+{
+	return DIV_ROUND_CLOSEST_ULL((u64)pc->clk_rate * ns,
+				     pc->data->prescaler * NSEC_PER_SEC);
+}
+
+static u32 rockchip_pwm_cycles_to_ns(struct rockchip_pwm_chip *pc, u32 cycles)
+{
+	return DIV_ROUND_CLOSEST_ULL((u64)cycles * pc->data->prescaler * NSEC_PER_SEC,
+				     pc->clk_rate);
+}
+
+/* Called with wave_lock held */
+static int rockchip_pwm_wave_start(struct rockchip_pwm_chip *pc)
+{
+	u32 int_ctrl;
+	int ret;
+
+	ret = clk_enable(pc->pclk);
+	if (ret)
+		return ret;
+
+	ret = clk_enable(pc->clk);
+	if (ret) {
+		clk_disable(pc->pclk);
+		return ret;
+	}
+
+	if (pc->capturing || rockchip_pwm_hw_enabled(pc)) {
+		clk_disable(pc->clk);
+		clk_disable(pc->pclk);
+		return -EBUSY;
+	}
+
+	int_ctrl = readl_relaxed(pc->base + PWM_REG_INT_EN(pc->channel_id));
+	int_ctrl |= PWM_CH_INT(pc->channel_id);
+	writel_relaxed(int_ctrl, pc->base + PWM_REG_INT_EN(pc->channel_id));
+
+	pc->wave_running = true;
+	rockchip_pwm_wave_next(pc);
+
+	return 0;
+}
+
+static void rockchip_pwm_wave_stop(struct rockchip_pwm_chip *pc)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pc->wave_lock, flags);
+	kfifo_reset(&pc->wave_fifo);
+	pc->wave_left = 0;
+	if (pc->wave_running)
+		rockchip_pwm_wave_next(pc);
+	spin_unlock_irqrestore(&pc->wave_lock, flags);
+}
+
+static ssize_t waveform_store(struct device *dev, struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct rockchip_pwm_chip *pc = dev_get_drvdata(dev);
+	struct rockchip_pwm_segment segs[PWM_WAVE_FIFO_SIZE];
+	const char *p = buf, *end = buf + count;
+	unsigned long flags;
+	unsigned int n = 0, queued;
+	int ret = 0;
+
+	if (sysfs_streq(buf, "stop")) {
+		rockchip_pwm_wave_stop(pc);
+		return count;
+	}
+
+	while (p < end) {
+		u64 period, duty;
+		u32 cnt;
+		int len;
+
+		if (isspace(*p)) {
+			p++;
+			continue;
+		}
+
+		if (n == ARRAY_SIZE(segs) ||
+		    sscanf(p, "%llu %llu %u%n", &period, &duty, &cnt, &len) != 3)
+			return -EINVAL;
+		p += len;
+
+		if (!period || duty > period || !cnt)
+			return -EINVAL;
+
+		segs[n].period = rockchip_pwm_ns_to_cycles(pc, period);
+		segs[n].duty = rockchip_pwm_ns_to_cycles(pc, duty);
+		segs[n].count = cnt;
+		if (!segs[n].period)
+			return -EINVAL;
+		n++;
+	}
+
+	if (!n)
+		return -EINVAL;
+
+	spin_lock_irqsave(&pc->wave_lock, flags);
+	if (kfifo_avail(&pc->wave_fifo) < n) {
+		ret = -ENOSPC;
+	} else {
+		queued = kfifo_in(&pc->wave_fifo, segs, n);
+		WARN_ON(queued != n);
+		if (!pc->wave_running)
+			ret = rockchip_pwm_wave_start(pc);
+		if (ret)
+			kfifo_reset(&pc->wave_fifo);
+	}
+	spin_unlock_irqrestore(&pc->wave_lock, flags);
+
+	if (!ret)
+		pinctrl_select_state(pc->pinctrl, pc->active_state);
+
+	return ret ? ret : count;
+}
+
+static ssize_t waveform_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct rockchip_pwm_chip *pc = dev_get_drvdata(dev);
+	unsigned long flags;
+	unsigned int len;
+	bool running;
+
+	spin_lock_irqsave(&pc->wave_lock, flags);
+	len = kfifo_len(&pc->wave_fifo);
+	running = pc->wave_running;
+	spin_unlock_irqrestore(&pc->wave_lock, flags);
+
+	return sysfs_emit(buf, "%s %u\n", running ? "running" : "idle", len);
+}
+static DEVICE_ATTR_RW(waveform);
+
+static int rockchip_pwm_capture_start(struct rockchip_pwm_chip *pc)
+{
+	unsigned long flags;
+	u32 ctrl, int_ctrl;
+	int ret;
+
+	ret = clk_enable(pc->pclk);
+	if (ret)
+		return ret;
+
+	ret = clk_enable(pc->clk);
+	if (ret) {
+		clk_disable(pc->pclk);
+		return ret;
+	}
+
+	spin_lock_irqsave(&pc->wave_lock, flags);
+	if (pc->wave_running || rockchip_pwm_hw_enabled(pc)) {
+		spin_unlock_irqrestore(&pc->wave_lock, flags);
+		clk_disable(pc->clk);
+		clk_disable(pc->pclk);
+		return -EBUSY;
+	}
+
+	kfifo_reset(&pc->capture_fifo);
+	pc->capture_dropped = 0;
+	WRITE_ONCE(pc->capturing, true);
+
+	ctrl = readl_relaxed(pc->base + pc->data->regs.ctrl);
+	ctrl &= ~(PWM_ENABLE | PWM_MODE_MASK);
+	ctrl |= PWM_CAPTURE;
+	writel_relaxed(ctrl, pc->base + pc->data->regs.ctrl);
+
+	int_ctrl = readl_relaxed(pc->base + PWM_REG_INT_EN(pc->channel_id));
+	int_ctrl |= PWM_CH_INT(pc->channel_id);
+	writel_relaxed(int_ctrl, pc->base + PWM_REG_INT_EN(pc->channel_id));
+
+	writel(ctrl | PWM_ENABLE, pc->base + pc->data->regs.ctrl);
+	spin_unlock_irqrestore(&pc->wave_lock, flags);
+
+	return pinctrl_select_state(pc->pinctrl, pc->active_state);
+}
+
+static void rockchip_pwm_capture_stop(struct rockchip_pwm_chip *pc)
+{
+	unsigned long flags;
+	u32 ctrl, int_ctrl;
+
+	spin_lock_irqsave(&pc->wave_lock, flags);
+	if (!pc->capturing) {
+		spin_unlock_irqrestore(&pc->wave_lock, flags);
+		return;
+	}
+
+	ctrl = readl_relaxed(pc->base + pc->data->regs.ctrl);
+	ctrl &= ~(PWM_ENABLE | PWM_MODE_MASK);
+	writel_relaxed(ctrl, pc->base + pc->data->regs.ctrl);
+
+	int_ctrl = readl_relaxed(pc->base + PWM_REG_INT_EN(pc->channel_id));
+	int_ctrl &= ~PWM_CH_INT(pc->channel_id);
+	writel(int_ctrl, pc->base + PWM_REG_INT_EN(pc->channel_id));
+
+	WRITE_ONCE(pc->capturing, false);
+	spin_unlock_irqrestore(&pc->wave_lock, flags);
+
+	synchronize_irq(pc->irq);
+	clk_disable(pc->clk);
+	clk_disable(pc->pclk);
+}
+
+static ssize_t capture_enable_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct rockchip_pwm_chip *pc = dev_get_drvdata(dev);
+	bool enable;
+	int ret;
+
+	ret = kstrtobool(buf, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&pc->capture_lock);
+	if (enable && !pc->capturing)
+		ret = rockchip_pwm_capture_start(pc);
+	else if (!enable)
+		rockchip_pwm_capture_stop(pc);
+	mutex_unlock(&pc->capture_lock);
+
+	return ret ? ret : count;
+}
+
+static ssize_t capture_enable_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct rockchip_pwm_chip *pc = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n", READ_ONCE(pc->capturing));
+}
+static DEVICE_ATTR_RW(capture_enable);
+
+static ssize_t capture_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct rockchip_pwm_chip *pc = dev_get_drvdata(dev);
+	struct rockchip_pwm_sample sample;
+	int len = 0;
+
+	/* Samples are consumed, keep room for a full line */
+	mutex_lock(&pc->capture_lock);
+	while (len < PAGE_SIZE - 48 && kfifo_get(&pc->capture_fifo, &sample))
+		len += sysfs_emit_at(buf, len, "%llu %u %u\n", sample.timestamp,
+				     rockchip_pwm_cycles_to_ns(pc, sample.high),
+				     rockchip_pwm_cycles_to_ns(pc, sample.low));
+	mutex_unlock(&pc->capture_lock);
+
+	return len;
+}
+static DEVICE_ATTR_RO(capture);
+
+static ssize_t capture_dropped_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct rockchip_pwm_chip *pc = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(pc->capture_dropped));
+}
+static DEVICE_ATTR_RO(capture_dropped);
+
+static struct attribute *rockchip_pwm_attrs[] = {
+	&dev_attr_waveform.attr,
+	&dev_attr_capture_enable.attr,
+	&dev_attr_capture.attr,
+	&dev_attr_capture_dropped.attr,
+	NULL
+};
+
+static const struct attribute_group rockchip_pwm_group = {
+	.attrs = rockchip_pwm_attrs,
+};
+
 static const struct rockchip_pwm_data pwm_data_v1 = {
 	.regs = {
 		.duty = 0x04,
@@ -460,6 +873,12 @@ static int rockchip_pwm_probe(struct platform_device *pdev)
 		goto err_pclk;
 	}
 
+	/* The shared oneshot IRQ may fire as soon as it is requested */
+	spin_lock_init(&pc->wave_lock);
+	INIT_KFIFO(pc->wave_fifo);
+	mutex_init(&pc->capture_lock);
+	INIT_KFIFO(pc->capture_fifo);
+
 	if (IS_ENABLED(CONFIG_PWM_ROCKCHIP_ONESHOT)) {
 		pc->irq = platform_get_irq(pdev, 0);
 		if (pc->irq < 0) {
@@ -518,6 +937,16 @@ static int rockchip_pwm_probe(struct platform_device *pdev)
 		goto err_pclk;
 	}
 
+	/* Waveform and capture need the oneshot IRQ and a v2 or later block */
+	if (IS_ENABLED(CONFIG_PWM_ROCKCHIP_ONESHOT) &&
+	    pc->data->supports_polarity && !pc->data->vop_pwm) {
+		if (device_add_group(&pdev->dev, &rockchip_pwm_group))
+			dev_warn(&pdev->dev, "Failed to add waveform attributes\n");
+		else
+			pc->capture_kn = sysfs_get_dirent(pdev->dev.kobj.sd,
+							  "capture");
+	}
+
 	/* Keep the PWM clk enabled if the PWM appears to be up and running. */
 	if (!enabled)
 		clk_disable(pc->clk);
@@ -538,6 +967,13 @@ static int rockchip_pwm_remove(struct platform_device *pdev)
 {
 	struct rockchip_pwm_chip *pc = platform_get_drvdata(pdev);
 
+	if (pc->capture_kn) {
+		device_remove_group(&pdev->dev, &rockchip_pwm_group);
+		rockchip_pwm_capture_stop(pc);
+		rockchip_pwm_wave_stop(pc);
+		sysfs_put(pc->capture_kn);
+	}
+
 	clk_unprepare(pc->pclk);
 	clk_unprepare(pc->clk);
 
@@ -12,6 +12,7 @@
 #include <linux/hdreg.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
+#include <linux/jiffies.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
 #include <linux/list.h>
@@ -63,6 +64,31 @@ static unsigned long totle_write_count;
 
 static char *mtd_read_temp_buffer;
 #define MTD_RW_SECTORS (512)
+/* Consecutive queued requests handed to the ftl as one transfer */
+#define RKFLASH_MERGE_MAX (16)
+#define RKFLASH_DISCARD_SEGS (64)
+
+enum {
+	RKFLASH_LAT_READ,
+	RKFLASH_LAT_WRITE,
+	RKFLASH_LAT_DISCARD,
+	RKFLASH_LAT_MAX
+};
+
+struct rkflash_lat_stat {
+	unsigned long count;
+	u64 total_ns;
+	u64 max_ns;
+};
+
+static const char * const rkflash_lat_name[RKFLASH_LAT_MAX] = {
+	"read", "write", "discard"
+};
+
+/* Updated under g_flash_ops_mutex */
+static struct rkflash_lat_stat rkflash_lat[RKFLASH_LAT_MAX];
+static unsigned long rkflash_merged_count;
+static unsigned long rkflash_discard_extents;
 
 #define DISABLE_WRITE _IO('V', 0)
 #define ENABLE_WRITE _IO('V', 1)
@@ -73,6 +99,20 @@ static char *mtd_read_temp_buffer;
 static DECLARE_WAIT_QUEUE_HEAD(nand_gc_thread_wait);
 static unsigned long nand_gc_do;
 static struct task_struct *nand_gc_thread __read_mostly;
+static atomic_t nand_fg_inflight = ATOMIC_INIT(0);
+static unsigned long nand_fg_last;
+static unsigned long nand_gc_runs;
+static unsigned long nand_gc_yields;
+
+/* gc waits this long after the last foreground request */
+static unsigned int gc_idle_ms = 50;
+module_param(gc_idle_ms, uint, 0644);
+MODULE_PARM_DESC(gc_idle_ms, "Foreground idle time before gc runs");
+
+/* after this much idle time gc runs back to back to catch up */
+static unsigned int gc_catchup_ms = 1000;
+module_param(gc_catchup_ms, uint, 0644);
+MODULE_PARM_DESC(gc_catchup_ms, "Foreground idle time before gc catches up");
 
 /* For rkflash dev private data, including mtd dev and block dev */
 static int rkflash_dev_initialised;
@@ -123,6 +163,7 @@ static unsigned int rk_partition_init(struct flash_part *part)
 static int rkflash_blk_proc_show(struct seq_file *m, void *v)
 {
 	char *ftl_buf = kzalloc(4096, GFP_KERNEL);
+	int i;
 
 #if IS_ENABLED(CONFIG_RK_SFTL)
 	int real_size = 0;
@@ -135,6 +176,17 @@ static int rkflash_blk_proc_show(struct seq_file *m, void *v)
 	seq_printf(m, "Totle Write %ld KB\n", totle_write_data >> 1);
 	seq_printf(m, "totle_write_count %ld\n", totle_write_count);
 	seq_printf(m, "totle_read_count %ld\n", totle_read_count);
+	for (i = 0; i < RKFLASH_LAT_MAX; i++) {
+		struct rkflash_lat_stat *lat = &rkflash_lat[i];
+
+		seq_printf(m, "%s_latency count %lu avg %llu us max %llu us\n",
+			   rkflash_lat_name[i], lat->count,
+			   lat->count ? div64_ul(lat->total_ns, lat->count) / 1000 : 0,
+			   lat->max_ns / 1000);
+	}
+	seq_printf(m, "merged_requests %lu\n", rkflash_merged_count);
+	seq_printf(m, "discard_extents %lu\n", rkflash_discard_extents);
+	seq_printf(m, "gc_runs %lu gc_yields %lu\n", nand_gc_runs, nand_gc_yields);
 	kfree(ftl_buf);
 	return 0;
 }
@@ -175,6 +227,52 @@ static int rkflash_blk_discard(u32 sec, u32 n_sec)
 	return ret;
 };
 
+/*
+ * Discard every bio of @n requests, contiguous ranges are coalesced so the
+ * ftl sees one call per extent instead of one per bio.
+ */
+static int rkflash_blk_discard_reqs(struct flash_blk_dev *dev,
+				    struct request **reqs, int n)
+{
+	struct bio *bio;
+	u32 start = 0, len = 0;
+	int i;
+
+	if (dev->disable_access || dev->readonly)
+		return -EIO;
+
+	for (i = 0; i < n; i++) {
+		__rq_for_each_bio(bio, reqs[i]) {
+			u32 sec = bio->bi_iter.bi_sector + dev->off_size;
+			u32 nr = bio_sectors(bio);
+
+			if (bio_end_sector(bio) > get_capacity(reqs[i]->rq_disk))
+				return -EIO;
+
+			if (len && start + len == sec) {
+				len += nr;
+				continue;
+			}
+
+			if (len) {
+				rkflash_discard_extents++;
+				if (rkflash_blk_discard(start, len))
+					return -EIO;
+			}
+			start = sec;
+			len = nr;
+		}
+	}
+
+	if (len) {
+		rkflash_discard_extents++;
+		if (rkflash_blk_discard(start, len))
+			return -EIO;
+	}
+
+	return 0;
+}
+
 static int rkflash_blk_xfer(struct flash_blk_dev *dev,
 			    unsigned long start,
 			    unsigned long nsector,
@@ -248,19 +346,48 @@ static int rkflash_blk_check_buffer_align(struct request *req, char **pbuf)
 	return 1;
 }
 
+static char *rkflash_blk_copy_to_req(struct request *req, char *p)
+{
+	struct req_iterator rq_iter;
+	struct bio_vec bvec;
+	char *page_buf;
+
+	rq_for_each_segment(bvec, req, rq_iter) {
+		page_buf = kmap_atomic(bvec.bv_page);
+		memcpy(page_buf + bvec.bv_offset, p, bvec.bv_len);
+		p += bvec.bv_len;
+		kunmap_atomic(page_buf);
+	}
+
+	return p;
+}
+
+static char *rkflash_blk_copy_from_req(struct request *req, char *p)
+{
+	struct req_iterator rq_iter;
+	struct bio_vec bvec;
+	char *page_buf;
+
+	rq_for_each_segment(bvec, req, rq_iter) {
+		page_buf = kmap_atomic(bvec.bv_page);
+		memcpy(p, page_buf + bvec.bv_offset, bvec.bv_len);
+		p += bvec.bv_len;
+		kunmap_atomic(page_buf);
+	}
+
+	return p;
+}
+
 static blk_status_t do_blktrans_all_request(struct flash_blk_ops *tr,
 			       struct flash_blk_dev *dev,
 			       struct request *req)
 {
-	unsigned long block, nsect;
-	char *buf = NULL, *page_buf;
-	struct req_iterator rq_iter;
-	struct bio_vec bvec;
+	unsigned long block;
+	char *buf = NULL;
 	int ret;
 	unsigned long totle_nsect;
 
 	block = blk_rq_pos(req);
-	nsect = blk_rq_cur_bytes(req) >> 9;
 	totle_nsect = (req->__data_len) >> 9;
 
 	if (blk_rq_pos(req) + blk_rq_cur_sectors(req) >
@@ -270,7 +397,7 @@ static blk_status_t do_blktrans_all_request(struct flash_blk_ops *tr,
 	switch (req_op(req)) {
 	case REQ_OP_DISCARD:
 		rkflash_print_bio("%s discard\n", __func__);
-		if (rkflash_blk_discard(block, nsect))
+		if (rkflash_blk_discard_reqs(dev, &req, 1))
 			return BLK_STS_IOERR;
 		return BLK_STS_OK;
 	case REQ_OP_READ:
@@ -282,19 +409,8 @@ static blk_status_t do_blktrans_all_request(struct flash_blk_ops *tr,
 				       totle_nsect,
 				       buf,
 				       REQ_OP_READ);
-		if (buf == mtd_read_temp_buffer) {
-			char *p = buf;
-
-			rq_for_each_segment(bvec, req, rq_iter) {
-				page_buf = kmap_atomic(bvec.bv_page);
-				memcpy(page_buf +
-				       bvec.bv_offset,
-				       p,
-				       bvec.bv_len);
-				p += bvec.bv_len;
-				kunmap_atomic(page_buf);
-			}
-		}
+		if (buf == mtd_read_temp_buffer)
+			rkflash_blk_copy_to_req(req, buf);
 
 		if (ret)
 			return BLK_STS_IOERR;
@@ -305,19 +421,8 @@ static blk_status_t do_blktrans_all_request(struct flash_blk_ops *tr,
 
 		buf = mtd_read_temp_buffer;
 		rkflash_blk_check_buffer_align(req, &buf);
-		if (buf == mtd_read_temp_buffer) {
-			char *p = buf;
-
-			rq_for_each_segment(bvec, req, rq_iter) {
-				page_buf = kmap_atomic(bvec.bv_page);
-				memcpy(p,
-					page_buf +
-					bvec.bv_offset,
-					bvec.bv_len);
-				p += bvec.bv_len;
-				kunmap_atomic(page_buf);
-			}
-		}
+		if (buf == mtd_read_temp_buffer)
+			rkflash_blk_copy_from_req(req, buf);
 		ret = rkflash_blk_xfer(dev,
 					block,
 					totle_nsect,
@@ -333,19 +438,117 @@ static blk_status_t do_blktrans_all_request(struct flash_blk_ops *tr,
 	}
 }
 
-static struct request *rkflash_next_request(struct flash_blk_dev *dev)
+/*
+ * @reqs are consecutive on the queue, of one op and, for read and write,
+ * sector contiguous, so they go to the ftl through the bounce buffer as a
+ * single transfer.
+ */
+static blk_status_t do_blktrans_merged_request(struct flash_blk_ops *tr,
+					       struct flash_blk_dev *dev,
+					       struct request **reqs, int n)
+{
+	unsigned long block = blk_rq_pos(reqs[0]);
+	unsigned long totle_nsect = 0;
+	char *p = mtd_read_temp_buffer;
+	int i, ret;
+
+	if (n == 1)
+		return do_blktrans_all_request(tr, dev, reqs[0]);
+
+	rkflash_merged_count += n - 1;
+	if (req_op(reqs[0]) == REQ_OP_DISCARD)
+		return rkflash_blk_discard_reqs(dev, reqs, n) ?
+			BLK_STS_IOERR : BLK_STS_OK;
+
+	for (i = 0; i < n; i++)
+		totle_nsect += blk_rq_sectors(reqs[i]);
+	if (block + totle_nsect > get_capacity(reqs[0]->rq_disk))
+		return BLK_STS_IOERR;
+
+	rkflash_print_bio("%s op=%d block=%lx nsec=%lx nr=%d\n", __func__,
+			  req_op(reqs[0]), block, totle_nsect, n);
+	if (req_op(reqs[0]) == REQ_OP_WRITE) {
+		for (i = 0; i < n; i++)
+			p = rkflash_blk_copy_from_req(reqs[i], p);
+		ret = rkflash_blk_xfer(dev, block, totle_nsect,
+				       mtd_read_temp_buffer, REQ_OP_WRITE);
+	} else {
+		ret = rkflash_blk_xfer(dev, block, totle_nsect,
+				       mtd_read_temp_buffer, REQ_OP_READ);
+		if (!ret)
+			for (i = 0; i < n; i++)
+				p = rkflash_blk_copy_to_req(reqs[i], p);
+	}
+
+	return ret ? BLK_STS_IOERR : BLK_STS_OK;
+}
+
+static bool rkflash_can_merge(struct request *last, struct request *rq,
+			      unsigned int nsect)
+{
+	if (req_op(rq) != req_op(last) || rq->rq_disk != last->rq_disk)
+		return false;
+
+	switch (req_op(rq)) {
+	case REQ_OP_DISCARD:
+		return true;
+	case REQ_OP_READ:
+	case REQ_OP_WRITE:
+		return blk_rq_pos(rq) == blk_rq_pos(last) + blk_rq_sectors(last) &&
+		       nsect + blk_rq_sectors(rq) <= MTD_RW_SECTORS;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Pop the head of the queue plus the requests right behind it that can ride
+ * along in the same ftl call. Only the consecutive run is taken, so requests
+ * are never reordered against each other.
+ */
+static int rkflash_next_requests(struct flash_blk_dev *dev,
+				 struct request **reqs)
 {
 	struct request *rq;
 	struct flash_blk_ops *tr = dev->blk_ops;
+	unsigned int nsect = 0;
+	int n = 0;
+
+	while (n < RKFLASH_MERGE_MAX) {
+		rq = list_first_entry_or_null(&tr->rq_list, struct request, queuelist);
+		if (!rq || (n && !rkflash_can_merge(reqs[n - 1], rq, nsect)))
+			break;
 
-	rq = list_first_entry_or_null(&tr->rq_list, struct request, queuelist);
-	if (rq) {
 		list_del_init(&rq->queuelist);
-		blk_mq_start_request(rq);
-		return rq;
+		nsect += blk_rq_sectors(rq);
+		reqs[n++] = rq;
 	}
 
-	return NULL;
+	return n;
+}
+
+static void rkflash_blk_account(struct request *req, u64 ns)
+{
+	struct rkflash_lat_stat *lat;
+
+	switch (req_op(req)) {
+	case REQ_OP_READ:
+		lat = &rkflash_lat[RKFLASH_LAT_READ];
+		break;
+	case REQ_OP_WRITE:
+		lat = &rkflash_lat[RKFLASH_LAT_WRITE];
+		break;
+	case REQ_OP_DISCARD:
+		lat = &rkflash_lat[RKFLASH_LAT_DISCARD];
+		break;
+	default:
+		return;
+	}
+
+	lat->count++;
+	lat->total_ns += ns;
+	if (ns > lat->max_ns)
+		lat->max_ns = ns;
 }
 
 static void rkflash_blktrans_work(struct flash_blk_dev *dev)
@@ -353,56 +556,78 @@ static void rkflash_blktrans_work(struct flash_blk_dev *dev)
 	__acquires(&dev->blk_ops->queue_lock)
 {
 	struct flash_blk_ops *tr = dev->blk_ops;
-	struct request *req = NULL;
+	struct request *reqs[RKFLASH_MERGE_MAX];
+	int i, n;
 
 	while (1) {
 		blk_status_t res;
+		u64 start;
 
-		req = rkflash_next_request(dev);
-		if (!req)
+		n = rkflash_next_requests(dev, reqs);
+		if (!n)
 			break;
 
 		spin_unlock_irq(&dev->blk_ops->queue_lock);
 
 		mutex_lock(&g_flash_ops_mutex);
-		res = do_blktrans_all_request(tr, dev, req);
+		start = ktime_get_ns();
+		res = do_blktrans_merged_request(tr, dev, reqs, n);
+		rkflash_blk_account(reqs[0], ktime_get_ns() - start);
 		mutex_unlock(&g_flash_ops_mutex);
 
-		if (!blk_update_request(req, res, req->__data_len)) {
-			__blk_mq_end_request(req, res);
-			req = NULL;
+		for (i = 0; i < n; i++) {
+			if (!blk_update_request(reqs[i], res, reqs[i]->__data_len))
+				__blk_mq_end_request(reqs[i], res);
 		}
 
+		WRITE_ONCE(nand_fg_last, jiffies);
+		atomic_sub(n, &nand_fg_inflight);
 		spin_lock_irq(&dev->blk_ops->queue_lock);
 	}
 }
 
+static void rkflash_commit_rqs(struct blk_mq_hw_ctx *hctx)
+{
+	struct flash_blk_dev *dev = hctx->queue->queuedata;
+
+	if (!dev)
+		return;
+
+	spin_lock_irq(&dev->blk_ops->queue_lock);
+	rkflash_blktrans_work(dev);
+	spin_unlock_irq(&dev->blk_ops->queue_lock);
+
+	/* wake up gc thread */
+	nand_gc_do = 1;
+	wake_up(&nand_gc_thread_wait);
+}
+
 static blk_status_t rkflash_queue_rq(struct blk_mq_hw_ctx *hctx,
 				     const struct blk_mq_queue_data *bd)
 {
 	struct flash_blk_dev *dev;
 
 	dev = hctx->queue->queuedata;
-	if (!dev) {
-		blk_mq_start_request(bd->rq);
+	blk_mq_start_request(bd->rq);
+	if (!dev)
 		return BLK_STS_IOERR;
-	}
 
-	nand_gc_do = 0;
+	atomic_inc(&nand_fg_inflight);
+	WRITE_ONCE(nand_fg_last, jiffies);
 	spin_lock_irq(&dev->blk_ops->queue_lock);
 	list_add_tail(&bd->rq->queuelist, &dev->blk_ops->rq_list);
-	rkflash_blktrans_work(dev);
 	spin_unlock_irq(&dev->blk_ops->queue_lock);
 
-	/* wake up gc thread */
-	nand_gc_do = 1;
-	wake_up(&nand_gc_thread_wait);
+	/* hold back until the last request of the batch so runs can merge */
+	if (bd->last)
+		rkflash_commit_rqs(hctx);
 
 	return BLK_STS_OK;
 }
 
 static const struct blk_mq_ops rkflash_mq_ops = {
 	.queue_rq	= rkflash_queue_rq,
+	.commit_rqs	= rkflash_commit_rqs,
 };
 
 static int nand_gc_has_work(void)
@@ -410,14 +635,26 @@ static int nand_gc_has_work(void)
 	return nand_gc_do;
 }
 
+static bool nand_gc_fg_idle_for(unsigned int ms)
+{
+	return !atomic_read(&nand_fg_inflight) &&
+	       time_after_eq(jiffies, READ_ONCE(nand_fg_last) + msecs_to_jiffies(ms));
+}
+
 static int nand_gc_do_work(void)
 {
 	int ret = nand_gc_has_work();
 
 	/* do garbage collect at idle state */
 	if (ret) {
+		if (!nand_gc_fg_idle_for(gc_idle_ms)) {
+			nand_gc_yields++;
+			return -EBUSY;
+		}
+
 		mutex_lock(&g_flash_ops_mutex);
 		ret = g_boot_ops->gc();
+		nand_gc_runs++;
 		rkflash_print_bio("%s gc result= %d\n", __func__, ret);
 		mutex_unlock(&g_flash_ops_mutex);
 	}
@@ -425,35 +662,51 @@ static int nand_gc_do_work(void)
 	return ret;
 }
 
-static void nand_gc_wait_work(void)
+static void nand_gc_wait_work(int last)
 {
 	unsigned long nand_gc_jiffies = HZ / 20;
+	unsigned long idle_end;
 
-	if (nand_gc_has_work())
-		wait_event_freezable_timeout(nand_gc_thread_wait,
-					     kthread_should_stop(),
-					     nand_gc_jiffies);
-	else
+	if (!nand_gc_has_work()) {
 		wait_event_freezable(nand_gc_thread_wait,
 				     kthread_should_stop() || nand_gc_has_work());
+		return;
+	}
+
+	if (last == -EBUSY) {
+		/* foreground is active, come back once it has been quiet */
+		idle_end = READ_ONCE(nand_fg_last) + msecs_to_jiffies(gc_idle_ms);
+		nand_gc_jiffies = time_after(idle_end, jiffies) ?
+				  idle_end - jiffies : 1;
+	} else if (last && nand_gc_fg_idle_for(gc_catchup_ms)) {
+		/* long idle and gc still finds work, run it back to back */
+		cond_resched();
+		return;
+	}
+
+	wait_event_freezable_timeout(nand_gc_thread_wait,
+				     kthread_should_stop(),
+				     nand_gc_jiffies);
 }
 
 static int nand_gc_mythread(void *arg)
 {
 	int gc_done_times = 0;
+	int ret;
 
 	set_freezable();
 
 	while (!kthread_should_stop()) {
-		if (nand_gc_do_work() == 0) {
+		ret = nand_gc_do_work();
+		if (ret == 0) {
 			gc_done_times++;
 			if (gc_done_times > 10)
 				nand_gc_do = 0;
-		} else {
+		} else if (ret != -EBUSY) {
 			gc_done_times = 0;
 		}
 
-		nand_gc_wait_work();
+		nand_gc_wait_work(ret);
 	}
 	pr_info("nand gc quited\n");
 
@@ -634,6 +887,7 @@ static int rkflash_blk_register(struct flash_blk_ops *blk_ops)
 
 	blk_queue_flag_set(QUEUE_FLAG_DISCARD, blk_ops->rq);
 	blk_queue_max_discard_sectors(blk_ops->rq, UINT_MAX >> 9);
+	blk_queue_max_discard_segments(blk_ops->rq, RKFLASH_DISCARD_SEGS);
 	blk_ops->rq->limits.discard_granularity = 64 << 9;
 
 	if (g_flash_type == FLASH_TYPE_SFC_NAND || g_flash_type == FLASH_TYPE_NANDC_NAND)
@@ -77,7 +77,7 @@ static int rksfc_irq_config(int mode, void *pfun)
 		ret = request_irq(irq, pfun, 0, "rksfc",
 				  g_sfc_info.reg_base);
 	else
-		free_irq(irq,  NULL);
+		free_irq(irq, g_sfc_info.reg_base);
 	return ret;
 }
 
@@ -220,6 +220,8 @@ static int rksfc_probe(struct platform_device *pdev)
 		dev_err(g_sfc_dev, "Wait for SFC idle timeout!\n");
 #endif
 
+	/* the flash drivers below already transfer pages by DMA while probing */
+	dma_set_mask(g_sfc_dev, DMA_BIT_MASK(32));
 	sfc_init(g_sfc_info.reg_base);
 	if (sfc_get_version() >= SFC_VER_4 && g_sfc_info.clk_rate > RKSFC_DLL_THRESHOLD_RATE)
 		rksfc_delay_lines_tuning();
@@ -234,10 +236,7 @@ static int rksfc_probe(struct platform_device *pdev)
 		dev_result = rkflash_dev_init(g_sfc_info.reg_base, FLASH_TYPE_SFC_NAND, &sfc_nand_ops);
 #endif
 
-	if (dev_result)
-		return dev_result;
-
-	return dma_set_mask(g_sfc_dev, DMA_BIT_MASK(32));
+	return dev_result;
 }
 
 static int __maybe_unused rksfc_suspend(struct device *dev)
@@ -6,13 +6,34 @@
 
 #include <linux/bug.h>
 #include <linux/delay.h>
+#include <linux/dma-mapping.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/module.h>
 #include <linux/slab.h>
 
 #include "rkflash_debug.h"
 #include "rk_sftl.h"
 #include "sfc_nand.h"
 
+/* Transfers shorter than this are cheaper through the fifo */
+#define SFC_NAND_DMA_MIN_LEN		512
+/* Busy polls spun before sleeping between polls, then the sleep step */
+#define SFC_NAND_BUSY_SPIN_US		200
+#define SFC_NAND_BUSY_SLEEP_US		20
+
+static bool sfc_nand_dma = true;
+module_param_named(dma, sfc_nand_dma, bool, 0644);
+MODULE_PARM_DESC(dma, "Use the SFC DMA for page sized transfers");
+
+/*
+ * Not every SPI-NAND implements 0x31/0x3F and a device that ignores them
+ * returns the previous page with a clean ecc status, so this is opt in.
+ */
+static bool sfc_nand_cache_read;
+module_param_named(cache_read, sfc_nand_cache_read, bool, 0644);
+MODULE_PARM_DESC(cache_read, "Use read cache sequential for multi page reads");
+
 static u32 sfc_nand_get_ecc_status0(void);
 static u32 sfc_nand_get_ecc_status1(void);
 static u32 sfc_nand_get_ecc_status2(void);
@@ -248,6 +269,42 @@ static int sfc_nand_write_en(void)
 	return ret;
 }
 
+static int sfc_nand_cmd(u8 cmd)
+{
+	struct rk_sfc_op op;
+
+	op.sfcmd.d32 = 0;
+	op.sfcmd.b.cmd = cmd;
+
+	op.sfctrl.d32 = 0;
+
+	return sfc_request(&op, 0, NULL, 0);
+}
+
+/*
+ * sfc_request() maps the buffer with dma_map_single(), so only take the
+ * DMA path for linear map buffers, read buffers must also own whole cache
+ * lines. vmalloc buffers such as the UBI LEB buffers stay on the fifo.
+ */
+static void sfc_nand_dma_prepare(struct rk_sfc_op *op, void *buf, u32 len)
+{
+	unsigned long align = 4;
+
+	if (!sfc_nand_dma || len < SFC_NAND_DMA_MIN_LEN)
+		return;
+
+	if (!virt_addr_valid(buf) || !virt_addr_valid((u8 *)buf + len - 1))
+		return;
+
+	if (op->sfcmd.b.rw == SFC_READ)
+		align = max_t(unsigned long, align, dma_get_cache_alignment());
+
+	if (!IS_ALIGNED((unsigned long)buf | len, align))
+		return;
+
+	op->sfctrl.b.enbledma = 1;
+}
+
 static int sfc_nand_rw_preset(void)
 {
 	int ret;
@@ -330,7 +387,14 @@ static int sfc_nand_wait_busy(u8 *data, int timeout)
 		if (!(status & (1 << 0)))
 			return SFC_OK;
 
-		sfc_delay(1);
+		/* tR finishes while spinning, sleep through prog and erase */
+		if (i < SFC_NAND_BUSY_SPIN_US) {
+			sfc_delay(1);
+		} else {
+			usleep_range(SFC_NAND_BUSY_SLEEP_US,
+				     SFC_NAND_BUSY_SLEEP_US * 2);
+			i += SFC_NAND_BUSY_SLEEP_US - 1;
+		}
 	}
 
 	return SFC_NAND_WAIT_TIME_OUT;
@@ -817,6 +881,8 @@ static u32 sfc_nand_read_cache(u32 row, u32 *p_page_buf, u32 column, u32 len)
 	op.sfctrl.b.datalines = sfc_nand_dev.read_lines;
 	op.sfctrl.b.addrbits = 16;
 
+	sfc_nand_dma_prepare(&op, p_page_buf, len);
+
 	plane = p_nand_info->plane_per_die == 2 ? ((row >> 6) & 0x1) << 12 : 0;
 
 	ret = sfc_request(&op, plane | column, p_page_buf, len);
@@ -851,6 +917,7 @@ u32 sfc_nand_prog_page_raw(u8 cs, u32 addr, u32 *p_page_buf)
 	op.sfctrl.d32 = 0;
 	op.sfctrl.b.datalines = sfc_nand_dev.prog_lines;
 	op.sfctrl.b.addrbits = 16;
+	sfc_nand_dma_prepare(&op, p_page_buf, page_size);
 	plane = p_nand_info->plane_per_die == 2 ? ((addr >> 6) & 0x1) << 12 : 0;
 	sfc_request(&op, plane, p_page_buf, page_size);
 
@@ -909,12 +976,17 @@ u32 sfc_nand_prog_page(u8 cs, u32 addr, u32 *p_data, u32 *p_spare)
 	return ret;
 }
 
-u32 sfc_nand_read(u32 row, u32 *p_page_buf, u32 column, u32 len)
+static void sfc_nand_read_preset(void)
+{
+	if (sfc_nand_dev.read_lines == DATA_LINES_X4 &&
+	    p_nand_info->feature & FEA_SOFT_QOP_BIT &&
+	    sfc_get_version() < SFC_VER_3)
+		sfc_nand_rw_preset();
+}
+
+static int sfc_nand_page_read(u32 row)
 {
-	int ret;
-	u32 plane;
 	struct rk_sfc_op op;
-	u32 ecc_result;
 	u8 status;
 
 	op.sfcmd.d32 = 0;
@@ -924,27 +996,21 @@ u32 sfc_nand_read(u32 row, u32 *p_page_buf, u32 column, u32 len)
 
 	op.sfctrl.d32 = 0;
 
-	sfc_request(&op, row, p_page_buf, 0);
-
-	if (sfc_nand_dev.read_lines == DATA_LINES_X4 &&
-	    p_nand_info->feature & FEA_SOFT_QOP_BIT &&
-	    sfc_get_version() < SFC_VER_3)
-		sfc_nand_rw_preset();
+	sfc_request(&op, row, NULL, 0);
+	sfc_nand_read_preset();
 
-	sfc_nand_wait_busy(&status, 1000 * 1000);
-	ecc_result = p_nand_info->ecc_status();
+	return sfc_nand_wait_busy(&status, 1000 * 1000);
+}
 
-	op.sfcmd.d32 = 0;
-	op.sfcmd.b.cmd = sfc_nand_dev.page_read_cmd;
-	op.sfcmd.b.addrbits = SFC_ADDR_XBITS;
-	op.sfcmd.b.dummybits = 8;
+u32 sfc_nand_read(u32 row, u32 *p_page_buf, u32 column, u32 len)
+{
+	int ret;
+	u32 ecc_result;
 
-	op.sfctrl.d32 = 0;
-	op.sfctrl.b.datalines = sfc_nand_dev.read_lines;
-	op.sfctrl.b.addrbits = 16;
+	sfc_nand_page_read(row);
+	ecc_result = p_nand_info->ecc_status();
 
-	plane = p_nand_info->plane_per_die == 2 ? ((row >> 6) & 0x1) << 12 : 0;
-	ret = sfc_request(&op, plane | column, p_page_buf, len);
+	ret = sfc_nand_read_cache(row, p_page_buf, column, len);
 	rkflash_print_dio("%s %x %x\n", __func__, row, p_page_buf[0]);
 
 	if (ret != SFC_OK)
@@ -953,6 +1019,64 @@ u32 sfc_nand_read(u32 row, u32 *p_page_buf, u32 column, u32 len)
 	return ecc_result;
 }
 
+/*
+ * Read @nr_pages whole pages from @row on with read cache sequential: 0x31
+ * hands page N to the cache and starts the array read of page N + 1, so tR
+ * of the next page overlaps the bus transfer of the current one. 0x3F ends
+ * the sequence without loading a further page. The caller keeps the range
+ * inside one block and gets the ecc result of each page in @p_ecc.
+ */
+u32 sfc_nand_read_seq(u32 row, u32 nr_pages, u8 *p_buf, u32 len, u32 *p_ecc)
+{
+	int ret;
+	u32 i;
+	u8 status;
+	u8 cmd = CMD_READ_CACHE_SEQ;
+
+	if (!sfc_nand_cache_read || nr_pages < 2) {
+		for (i = 0; i < nr_pages; i++) {
+			p_ecc[i] = sfc_nand_read(row + i, (u32 *)(p_buf + i * len),
+						 0, len);
+			if (p_ecc[i] == SFC_NAND_HW_ERROR)
+				return SFC_NAND_HW_ERROR;
+		}
+
+		return SFC_OK;
+	}
+
+	rkflash_print_dio("%s %x %x\n", __func__, row, nr_pages);
+	ret = sfc_nand_page_read(row);
+	if (ret != SFC_OK)
+		return SFC_NAND_HW_ERROR;
+
+	for (i = 0; i < nr_pages; i++) {
+		cmd = i == nr_pages - 1 ? CMD_READ_CACHE_END : CMD_READ_CACHE_SEQ;
+		sfc_nand_cmd(cmd);
+		sfc_nand_read_preset();
+		ret = sfc_nand_wait_busy(&status, 1000 * 1000);
+		if (ret != SFC_OK)
+			goto abort;
+
+		p_ecc[i] = p_nand_info->ecc_status();
+		ret = sfc_nand_read_cache(row + i, (u32 *)(p_buf + i * len),
+					  0, len);
+		if (ret != SFC_OK)
+			goto abort;
+	}
+
+	return SFC_OK;
+
+abort:
+	/* the device may still be loading the next page, end the sequence */
+	rkflash_print_error("%s %x abort at %d\n", __func__, row, i);
+	if (cmd != CMD_READ_CACHE_END) {
+		sfc_nand_cmd(CMD_READ_CACHE_END);
+		sfc_nand_wait_busy(&status, 1000 * 1000);
+	}
+
+	return SFC_NAND_HW_ERROR;
+}
+
 u32 sfc_nand_read_page_raw(u8 cs, u32 addr, u32 *p_page_buf)
 {
 	u32 page_size = SFC_NAND_SECTOR_FULL_SIZE * p_nand_info->sec_per_page;
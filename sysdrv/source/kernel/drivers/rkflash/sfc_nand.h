@@ -18,6 +18,7 @@
 #define SFC_NAND_PAGE_MAX_SIZE		4224
 #define SFC_NAND_SECTOR_FULL_SIZE	528
 #define SFC_NAND_SECTOR_SIZE		512
+#define SFC_NAND_SEQ_MAX_PAGES		32
 
 #define FEA_READ_STATUE_MASK    (0x3 << 0)
 #define FEA_STATUE_MODE1        0
@@ -66,6 +67,8 @@
 /* X1 cmd, X4 addr, X4 data, SUPPORT MARCONIX */
 #define CMD_PAGE_PROG_A4        (0x38)
 #define CMD_RESET_NAND          (0xFF)
+#define CMD_READ_CACHE_SEQ      (0x31)
+#define CMD_READ_CACHE_END      (0x3F)
 
 #define CMD_ENTER_4BYTE_MODE    (0xB7)
 #define CMD_EXIT_4BYTE_MODE     (0xE9)
@@ -129,5 +132,6 @@ void sfc_nand_ftl_ops_init(void);
 struct SFNAND_DEV *sfc_nand_get_private_dev(void);
 struct nand_info *sfc_nand_get_nand_info(void);
 u32 sfc_nand_read(u32 row, u32 *p_page_buf, u32 column, u32 len);
+u32 sfc_nand_read_seq(u32 row, u32 nr_pages, u8 *p_buf, u32 len, u32 *p_ecc);
 
 #endif
@@ -75,6 +75,28 @@ static int sfc_nand_write_mtd(struct mtd_info *mtd, loff_t to,
 	return ret;
 }
 
+static int sfc_nand_mtd_ecc(struct mtd_info *mtd, loff_t from, u32 ret,
+			    bool *ecc_failed, int *max_bitflips)
+{
+	if (ret == SFC_NAND_HW_ERROR) {
+		rkflash_print_error("%s addr %llx ret= %d\n",
+				    __func__, from, ret);
+		return -EIO;
+	} else if (ret == SFC_NAND_ECC_ERROR) {
+		rkflash_print_error("%s addr %llx ret= %d\n",
+				    __func__, from, ret);
+		*ecc_failed = true;
+		mtd->ecc_stats.failed++;
+	} else if (ret == SFC_NAND_ECC_REFRESH) {
+		rkflash_print_dio("%s addr %llx ret= %d\n",
+				  __func__, from, ret);
+		mtd->ecc_stats.corrected += 1;
+		*max_bitflips = 1;
+	}
+
+	return 0;
+}
+
 static int sfc_nand_read_mtd(struct mtd_info *mtd, loff_t from,
 			     struct mtd_oob_ops *ops)
 {
@@ -83,6 +105,9 @@ static int sfc_nand_read_mtd(struct mtd_info *mtd, loff_t from,
 	u32 ret = 0;
 	bool ecc_failed = false;
 	size_t page, off, real_size;
+	u32 ecc[SFC_NAND_SEQ_MAX_PAGES];
+	u32 page_per_blk = mtd->erasesize >> mtd->writesize_shift;
+	u32 i, nr_pages;
 	int max_bitflips = 0;
 
 	rkflash_print_dio("%s addr= %llx len= %x\n", __func__, from, (u32)remaining);
@@ -97,24 +122,31 @@ static int sfc_nand_read_mtd(struct mtd_info *mtd, loff_t from,
 	while (remaining) {
 		page = from >> mtd->writesize_shift;
 		off = from & mtd->writesize_mask;
-		real_size = min_t(u32, remaining, mtd->writesize - off);
 
-		ret = sfc_nand_read(page, (u32 *)data, off, real_size);
-		if (ret == SFC_NAND_HW_ERROR) {
-			rkflash_print_error("%s addr %llx ret= %d\n",
-					    __func__, from, ret);
-			ret = -EIO;
-			break;
-		} else if (ret == SFC_NAND_ECC_ERROR) {
-			rkflash_print_error("%s addr %llx ret= %d\n",
-					    __func__, from, ret);
-			ecc_failed = true;
-			mtd->ecc_stats.failed++;
-		} else if (ret == SFC_NAND_ECC_REFRESH) {
-			rkflash_print_dio("%s addr %llx ret= %d\n",
-					  __func__, from, ret);
-			mtd->ecc_stats.corrected += 1;
-			max_bitflips = 1;
+		/* whole pages inside one block go through the cache read sequence */
+		nr_pages = off ? 0 : remaining >> mtd->writesize_shift;
+		nr_pages = min_t(u32, nr_pages, page_per_blk - (page % page_per_blk));
+		nr_pages = min_t(u32, nr_pages, SFC_NAND_SEQ_MAX_PAGES);
+		if (nr_pages > 1) {
+			real_size = nr_pages << mtd->writesize_shift;
+			ret = sfc_nand_read_seq(page, nr_pages, data,
+						mtd->writesize, ecc);
+			if (ret == SFC_NAND_HW_ERROR) {
+				ret = sfc_nand_mtd_ecc(mtd, from, ret,
+						       &ecc_failed, &max_bitflips);
+				break;
+			}
+
+			for (i = 0; i < nr_pages; i++)
+				sfc_nand_mtd_ecc(mtd, from + (i << mtd->writesize_shift),
+						 ecc[i], &ecc_failed, &max_bitflips);
+		} else {
+			real_size = min_t(u32, remaining, mtd->writesize - off);
+			ret = sfc_nand_read(page, (u32 *)data, off, real_size);
+			ret = sfc_nand_mtd_ecc(mtd, from, ret, &ecc_failed,
+					       &max_bitflips);
+			if (ret)
+				break;
 		}
 
 		ret = 0;
@@ -22,6 +22,7 @@
 #include <soc/rockchip/rockchip_opp_select.h>
 #endif
 #endif
+#include <soc/rockchip/rockchip_autogate.h>
 
 #include "rknpu_job.h"
 #include "rknpu_fence.h"
@@ -83,6 +84,37 @@ struct rknpu_timer {
 	__u32 busy_time_record;
 };
 
+#define RKNPU_MAX_WAIT_STATS 16
+
+/* queue wait time of the jobs of a process at a priority class */
+struct rknpu_wait_stat {
+	pid_t pid;
+	int priority;
+	uint64_t job_count;
+	uint64_t preempt_count;
+	uint64_t wait_time_total;
+	int64_t wait_time_max;
+	ktime_t last_time;
+};
+
+/* adaptive power off tunables */
+#define RKNPU_POWER_PERIOD_MIN_US 1000
+#define RKNPU_POWER_PERIOD_MAX_US 2000000
+#define RKNPU_POWER_BREAK_EVEN_US 20000
+#define RKNPU_POWER_ON_MARGIN_US 2000
+#define RKNPU_POWER_BUSY_RECHECK_MS 5
+
+#define RKNPU_MAX_BW_STATS 16
+
+/* DDR read/write amount of the jobs of a process */
+struct rknpu_bw_stat {
+	pid_t pid;
+	uint64_t job_count;
+	uint64_t rw_amount_total;
+	uint64_t rw_amount_max;
+	ktime_t last_time;
+};
+
 struct rknpu_subcore_data {
 	struct list_head todo_list;
 	wait_queue_head_t job_done_wq;
@@ -115,6 +147,15 @@ struct rknpu_device {
 	struct mutex power_lock;
 	struct mutex reset_lock;
 	struct rknpu_subcore_data subcore_datas[RKNPU_MAX_CORES];
+	/* protected by irq_lock */
+	struct rknpu_wait_stat wait_stats[RKNPU_MAX_WAIT_STATS];
+	struct rknpu_bw_stat bw_stats[RKNPU_MAX_BW_STATS];
+	uint32_t rw_amount_last;
+#ifdef CONFIG_ROCKCHIP_RKNPU_DRM_GEM
+	/* read-only buffers published by RKNPU_MEM_SHARE */
+	struct mutex share_lock;
+	struct list_head share_list;
+#endif
 	const struct rknpu_config *config;
 	void __iomem *bw_priority_base;
 	struct rknpu_fence_context *fence_ctx;
@@ -123,6 +164,7 @@ struct rknpu_device {
 	struct reset_control *srst_h[RKNPU_MAX_CORES];
 	struct clk_bulk_data *clks;
 	int num_clks;
+	struct rockchip_autogate autogate;
 	struct regulator *vdd;
 	struct regulator *mem;
 	struct monitor_dev_info *mdev_info;
@@ -161,6 +203,13 @@ struct rknpu_device {
 	void __iomem *nbuf_base_io;
 	struct rknpu_mm *sram_mm;
 	unsigned long power_put_delay;
+	/* adaptive power off, times in us, protected by power_lock */
+	bool power_put_adaptive;
+	struct delayed_work power_on_work;
+	ktime_t job_arrive_time;
+	int64_t job_period;
+	int64_t job_period_dev;
+	int64_t power_on_time;
 };
 
 struct rknpu_session {
@@ -170,5 +219,6 @@ struct rknpu_session {
 
 int rknpu_power_get(struct rknpu_device *rknpu_dev);
 int rknpu_power_put(struct rknpu_device *rknpu_dev);
+void rknpu_power_job_arrive(struct rknpu_device *rknpu_dev);
 
 #endif /* __LINUX_RKNPU_DRV_H_ */
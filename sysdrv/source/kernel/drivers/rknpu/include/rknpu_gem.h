@@ -19,6 +19,7 @@
 #include <drm/drm_mem_util.h>
 #endif
 
+#include "rknpu_ioctl.h"
 #include "rknpu_mm.h"
 
 #define to_rknpu_obj(x) container_of(x, struct rknpu_gem_object, base)
@@ -39,6 +40,10 @@
  *	device address with IOMMU.
  * @pages: Array of backing pages.
  * @sgt: Imported sg_table.
+ * @shared: kernel-owned copy published by RKNPU_MEM_SHARE_PUBLISH,
+ *	never mapped writable or exported.
+ * @share_node: entry in the shared buffer list of the device.
+ * @share_digest: SHA-256 of the content when published.
  *
  * P.S. this object would be transferred to user as kms_bo.handle so
  *	user can access the buffer through kms_bo.handle.
@@ -60,6 +65,9 @@ struct rknpu_gem_object {
 	struct page **pages;
 	struct sg_table *sgt;
 	struct drm_mm_node mm_node;
+	bool shared;
+	struct list_head share_node;
+	u8 share_digest[RKNPU_MEM_SHARE_DIGEST_SIZE];
 };
 
 enum rknpu_cache_type {
@@ -173,6 +181,12 @@ int rknpu_gem_mmap(struct file *filp, struct vm_area_struct *vma);
 struct drm_gem_object *rknpu_gem_prime_import(struct drm_device *dev,
 					      struct dma_buf *dma_buf);
 #endif
+#if KERNEL_VERSION(5, 4, 0) <= LINUX_VERSION_CODE
+struct dma_buf *rknpu_gem_prime_export(struct drm_gem_object *obj, int flags);
+#else
+struct dma_buf *rknpu_gem_prime_export(struct drm_device *dev,
+				       struct drm_gem_object *obj, int flags);
+#endif
 struct sg_table *rknpu_gem_prime_get_sg_table(struct drm_gem_object *obj);
 struct drm_gem_object *
 rknpu_gem_prime_import_sg_table(struct drm_device *dev,
@@ -191,6 +205,9 @@ int rknpu_gem_prime_mmap(struct drm_gem_object *obj,
 int rknpu_gem_sync_ioctl(struct drm_device *dev, void *data,
 			 struct drm_file *file_priv);
 
+int rknpu_gem_share_ioctl(struct drm_device *dev, void *data,
+			  struct drm_file *file_priv);
+
 static inline void *rknpu_gem_alloc_page(size_t nr_pages)
 {
 #if KERNEL_VERSION(4, 13, 0) <= LINUX_VERSION_CODE
@@ -108,6 +108,18 @@ enum e_rknpu_job_mode {
 			 RKNPU_JOB_FENCE_OUT
 };
 
+/*
+ * job priority definitions, rknpu_submit priority is clamped to this range.
+ * Single core jobs of a higher class are served first and may take over a
+ * core between two task submissions of a running lower class job.
+ */
+enum e_rknpu_job_priority {
+	RKNPU_JOB_PRIORITY_LOW = -1,
+	RKNPU_JOB_PRIORITY_NORMAL = 0,
+	RKNPU_JOB_PRIORITY_HIGH = 1,
+	RKNPU_JOB_PRIORITY_REALTIME = 2,
+};
+
 /* action definitions */
 enum e_rknpu_action {
 	RKNPU_GET_HW_VERSION = 0,
@@ -157,6 +169,44 @@ struct rknpu_mem_create {
 	__u64 sram_size;
 };
 
+#define RKNPU_MEM_SHARE_DIGEST_SIZE 32
+
+/* shared memory operations. */
+enum e_rknpu_mem_share_flag {
+	/* register the content of a buffer under its digest */
+	RKNPU_MEM_SHARE_PUBLISH = 1 << 0,
+	/* get a handle to the buffer registered under a digest */
+	RKNPU_MEM_SHARE_LOOKUP = 1 << 1,
+};
+
+/**
+ * A structure for sharing read-only buffers, such as model weights, between
+ * processes.
+ *
+ * @flags: RKNPU_MEM_SHARE_PUBLISH or RKNPU_MEM_SHARE_LOOKUP.
+ * @handle: the handle of gem object, input for publish, output for lookup.
+ *	- on publish, replaced by the handle of the published copy.
+ * @digest: SHA-256 of the buffer content.
+ *	- checked against the content on publish.
+ * @size: size of the shared buffer.
+ * @obj_addr: address of RKNPU memory object.
+ * @dma_addr: dma address that access by rknpu.
+ *
+ * Publish copies the buffer into a new buffer owned by the kernel, which can
+ * not be mapped writable or exported as a dma-buf. The buffer passed in is
+ * left untouched. The NPU is given read-write access to the copy like to any
+ * other buffer, jobs must not write to it. It stays registered until its
+ * last handle or mapping is released.
+ */
+struct rknpu_mem_share {
+	__u32 flags;
+	__u32 handle;
+	__u8 digest[RKNPU_MEM_SHARE_DIGEST_SIZE];
+	__u64 size;
+	__u64 obj_addr;
+	__u64 dma_addr;
+};
+
 /**
  * A structure for getting a fake-offset that can be used with mmap.
  *
@@ -273,6 +323,30 @@ struct rknpu_submit {
 	struct rknpu_subcore_task subcore_task[5];
 };
 
+#define RKNPU_SUBMIT_BATCH_MAX 16
+
+/**
+ * struct rknpu_submit_batch structure for batched job submit
+ *
+ * @flags: flags for batched submit, reserved and must be 0
+ * @job_number: number of rknpu_submit entries, up to RKNPU_SUBMIT_BATCH_MAX
+ * @job_submitted: number of entries queued to the scheduler
+ * @reserved: reserved for future use
+ * @submit_obj_addr: user address of the rknpu_submit array
+ *
+ * Every entry is an independent job committed as RKNPU_JOB_NONBLOCK with its
+ * own core_mask, priority and fences. Entries with RKNPU_CORE_AUTO_MASK are
+ * spread over the idle or least loaded cores. The out fence fd of each entry
+ * is written back to the array.
+ */
+struct rknpu_submit_batch {
+	__u32 flags;
+	__u32 job_number;
+	__u32 job_submitted;
+	__u32 reserved;
+	__u64 submit_obj_addr;
+};
+
 /**
  * struct rknpu_task structure for action (GET, SET or ACT)
  *
@@ -291,6 +365,8 @@ struct rknpu_action {
 #define RKNPU_MEM_MAP 0x03
 #define RKNPU_MEM_DESTROY 0x04
 #define RKNPU_MEM_SYNC 0x05
+#define RKNPU_SUBMIT_BATCH 0x06
+#define RKNPU_MEM_SHARE 0x07
 
 #define RKNPU_IOC_MAGIC 'r'
 #define RKNPU_IOW(nr, type) _IOW(RKNPU_IOC_MAGIC, nr, type)
@@ -311,6 +387,11 @@ struct rknpu_action {
 	DRM_IOWR(DRM_COMMAND_BASE + RKNPU_MEM_DESTROY, struct rknpu_mem_destroy)
 #define DRM_IOCTL_RKNPU_MEM_SYNC                                               \
 	DRM_IOWR(DRM_COMMAND_BASE + RKNPU_MEM_SYNC, struct rknpu_mem_sync)
+#define DRM_IOCTL_RKNPU_SUBMIT_BATCH                                           \
+	DRM_IOWR(DRM_COMMAND_BASE + RKNPU_SUBMIT_BATCH,                        \
+		 struct rknpu_submit_batch)
+#define DRM_IOCTL_RKNPU_MEM_SHARE                                              \
+	DRM_IOWR(DRM_COMMAND_BASE + RKNPU_MEM_SHARE, struct rknpu_mem_share)
 
 #define IOCTL_RKNPU_ACTION RKNPU_IOWR(RKNPU_ACTION, struct rknpu_action)
 #define IOCTL_RKNPU_SUBMIT RKNPU_IOWR(RKNPU_SUBMIT, struct rknpu_submit)
@@ -320,5 +401,7 @@ struct rknpu_action {
 #define IOCTL_RKNPU_MEM_DESTROY                                                \
 	RKNPU_IOWR(RKNPU_MEM_DESTROY, struct rknpu_mem_destroy)
 #define IOCTL_RKNPU_MEM_SYNC RKNPU_IOWR(RKNPU_MEM_SYNC, struct rknpu_mem_sync)
+#define IOCTL_RKNPU_SUBMIT_BATCH                                               \
+	RKNPU_IOWR(RKNPU_SUBMIT_BATCH, struct rknpu_submit_batch)
 
 #endif
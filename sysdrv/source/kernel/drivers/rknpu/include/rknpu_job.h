@@ -47,6 +47,12 @@ struct rknpu_job {
 	ktime_t hw_recoder_time;
 	ktime_t commit_pc_time;
 	atomic_t submit_count[RKNPU_MAX_CORES];
+	int priority;
+	pid_t pid;
+	ktime_t wait_start;
+	int64_t wait_time;
+	uint32_t preempt_count;
+	uint64_t rw_amount;
 };
 
 irqreturn_t rknpu_core0_irq_handler(int irq, void *data);
@@ -56,9 +62,13 @@ irqreturn_t rknpu_core2_irq_handler(int irq, void *data);
 #ifdef CONFIG_ROCKCHIP_RKNPU_DRM_GEM
 int rknpu_submit_ioctl(struct drm_device *dev, void *data,
 		       struct drm_file *file_priv);
+int rknpu_submit_batch_ioctl(struct drm_device *dev, void *data,
+			     struct drm_file *file_priv);
 #endif
 #ifdef CONFIG_ROCKCHIP_RKNPU_DMA_HEAP
 int rknpu_submit_ioctl(struct rknpu_device *rknpu_dev, unsigned long data);
+int rknpu_submit_batch_ioctl(struct rknpu_device *rknpu_dev,
+			     unsigned long data);
 #endif
 
 int rknpu_get_hw_version(struct rknpu_device *rknpu_dev, uint32_t *version);
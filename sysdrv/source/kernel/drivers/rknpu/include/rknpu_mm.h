@@ -7,6 +7,7 @@
 #ifndef __LINUX_RKNPU_MM_H
 #define __LINUX_RKNPU_MM_H
 
+#include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/seq_file.h>
 #include <linux/iommu.h>
@@ -14,17 +15,32 @@
 
 #include "rknpu_drv.h"
 
+/* percentage of the SRAM a single process may hold, 100 means no limit */
+#define RKNPU_MM_QUOTA_MAX 100
+
+struct rknpu_mm_owner {
+	struct list_head head;
+	pid_t pid;
+	unsigned int used_chunks;
+	unsigned int peak_chunks;
+};
+
 struct rknpu_mm {
 	void *bitmap;
 	struct mutex lock;
 	unsigned int chunk_size;
 	unsigned int total_chunks;
 	unsigned int free_chunks;
+	unsigned int quota;
+	struct list_head owner_list;
+	unsigned long alloc_count;
+	unsigned long fail_count;
 };
 
 struct rknpu_mm_obj {
 	uint32_t range_start;
 	uint32_t range_end;
+	pid_t owner;
 };
 
 int rknpu_mm_create(unsigned int mem_size, unsigned int chunk_size,
@@ -37,6 +53,11 @@ int rknpu_mm_alloc(struct rknpu_mm *mm, unsigned int size,
 
 int rknpu_mm_free(struct rknpu_mm *mm, struct rknpu_mm_obj *mm_obj);
 
+unsigned int rknpu_mm_get_avail_size(struct rknpu_mm *mm);
+
+ssize_t rknpu_mm_quota_set(struct file *file, const char __user *ubuf,
+			   size_t len, loff_t *offp);
+
 int rknpu_mm_dump(struct seq_file *m, void *data);
 
 #endif
@@ -75,6 +75,77 @@ static int rknpu_load_show(struct seq_file *m, void *data)
 	return 0;
 }
 
+static int rknpu_wait_show(struct seq_file *m, void *data)
+{
+	struct rknpu_debugger_node *node = m->private;
+	struct rknpu_debugger *debugger = node->debugger;
+	struct rknpu_device *rknpu_dev =
+		container_of(debugger, struct rknpu_device, debugger);
+	struct rknpu_wait_stat stats[RKNPU_MAX_WAIT_STATS];
+	unsigned long flags;
+	uint64_t wait_time_avg;
+	int i;
+
+	spin_lock_irqsave(&rknpu_dev->irq_lock, flags);
+	memcpy(stats, rknpu_dev->wait_stats, sizeof(stats));
+	spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
+
+	seq_puts(m, "NPU job wait time:\n");
+	for (i = 0; i < RKNPU_MAX_WAIT_STATS; i++) {
+		if (!stats[i].job_count)
+			continue;
+
+		wait_time_avg = stats[i].wait_time_total;
+		do_div(wait_time_avg, stats[i].job_count);
+
+		seq_printf(m,
+			   "  pid: %d, priority: %d, jobs: %llu, preempted: %llu, wait avg: %lluus, max: %lldus\n",
+			   stats[i].pid, stats[i].priority, stats[i].job_count,
+			   stats[i].preempt_count, wait_time_avg,
+			   stats[i].wait_time_max);
+	}
+
+	return 0;
+}
+
+static int rknpu_bw_show(struct seq_file *m, void *data)
+{
+	struct rknpu_debugger_node *node = m->private;
+	struct rknpu_debugger *debugger = node->debugger;
+	struct rknpu_device *rknpu_dev =
+		container_of(debugger, struct rknpu_device, debugger);
+	struct rknpu_bw_stat stats[RKNPU_MAX_BW_STATS];
+	unsigned long flags;
+	uint64_t rw_amount_avg;
+	int i;
+
+	if (!rknpu_dev->config->bw_enable) {
+		seq_puts(m, "unsupported\n");
+		return 0;
+	}
+
+	spin_lock_irqsave(&rknpu_dev->irq_lock, flags);
+	memcpy(stats, rknpu_dev->bw_stats, sizeof(stats));
+	spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
+
+	seq_puts(m, "NPU DDR read/write amount:\n");
+	for (i = 0; i < RKNPU_MAX_BW_STATS; i++) {
+		if (!stats[i].job_count)
+			continue;
+
+		rw_amount_avg = stats[i].rw_amount_total;
+		do_div(rw_amount_avg, stats[i].job_count);
+
+		seq_printf(m,
+			   "  pid: %d, jobs: %llu, total: %lluKB, avg: %lluKB, max: %lluKB\n",
+			   stats[i].pid, stats[i].job_count,
+			   stats[i].rw_amount_total >> 10, rw_amount_avg >> 10,
+			   stats[i].rw_amount_max >> 10);
+	}
+
+	return 0;
+}
+
 static int rknpu_power_show(struct seq_file *m, void *data)
 {
 	struct rknpu_debugger_node *node = m->private;
@@ -136,7 +207,13 @@ static int rknpu_power_put_delay_show(struct seq_file *m, void *data)
 	struct rknpu_device *rknpu_dev =
 		container_of(debugger, struct rknpu_device, debugger);
 
-	seq_printf(m, "%lu\n", rknpu_dev->power_put_delay);
+	if (rknpu_dev->power_put_adaptive)
+		seq_printf(m,
+			   "auto, fallback: %lums, period: %lldus, deviation: %lldus, power on: %lldus\n",
+			   rknpu_dev->power_put_delay, rknpu_dev->job_period,
+			   rknpu_dev->job_period_dev, rknpu_dev->power_on_time);
+	else
+		seq_printf(m, "%lu\n", rknpu_dev->power_put_delay);
 
 	return 0;
 }
@@ -160,12 +237,20 @@ static ssize_t rknpu_power_put_delay_set(struct file *file,
 		return -EFAULT;
 	buf[len - 1] = '\0';
 
+	/* "auto" learns the job period, the fixed delay is kept as fallback */
+	if (strcmp(buf, "auto") == 0) {
+		rknpu_dev->power_put_adaptive = true;
+		LOG_INFO("set rknpu power put delay adaptive\n");
+		return len;
+	}
+
 	ret = kstrtoul(buf, 10, &power_put_delay);
 	if (ret) {
 		LOG_ERROR("failed to parse power put delay string: %s\n", buf);
 		return -EFAULT;
 	}
 
+	rknpu_dev->power_put_adaptive = false;
 	rknpu_dev->power_put_delay = power_put_delay;
 
 	LOG_INFO("set rknpu power put delay time %lums\n",
@@ -291,7 +376,8 @@ static ssize_t rknpu_reset_set(struct file *file, const char __user *ubuf,
 	buf[len - 1] = '\0';
 
 	if (strcmp(buf, "1") == 0 &&
-	    atomic_read(&rknpu_dev->power_refcount) > 0)
+	    atomic_read(&rknpu_dev->power_refcount) > 0 &&
+	    !rockchip_autogate_ungate(&rknpu_dev->autogate))
 		rknpu_soft_reset(rknpu_dev);
 	else if (strcmp(buf, "on") == 0)
 		rknpu_dev->bypass_soft_reset = 0;
@@ -304,6 +390,8 @@ static ssize_t rknpu_reset_set(struct file *file, const char __user *ubuf,
 static struct rknpu_debugger_list rknpu_debugger_root_list[] = {
 	{ "version", rknpu_version_show, NULL, NULL },
 	{ "load", rknpu_load_show, NULL, NULL },
+	{ "wait", rknpu_wait_show, NULL, NULL },
+	{ "bw", rknpu_bw_show, NULL, NULL },
 	{ "power", rknpu_power_show, rknpu_power_set, NULL },
 	{ "freq", rknpu_freq_show, rknpu_freq_set, NULL },
 	{ "volt", rknpu_volt_show, NULL, NULL },
@@ -311,7 +399,7 @@ static struct rknpu_debugger_list rknpu_debugger_root_list[] = {
 	  NULL },
 	{ "reset", rknpu_reset_show, rknpu_reset_set, NULL },
 #ifdef CONFIG_ROCKCHIP_RKNPU_SRAM
-	{ "mm", rknpu_mm_dump, NULL, NULL },
+	{ "mm", rknpu_mm_dump, rknpu_mm_quota_set, NULL },
 #endif
 };
 
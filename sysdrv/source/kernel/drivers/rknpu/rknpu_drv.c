@@ -213,24 +213,103 @@ static int rknpu_get_drv_version(uint32_t *version)
 static int rknpu_power_on(struct rknpu_device *rknpu_dev);
 static int rknpu_power_off(struct rknpu_device *rknpu_dev);
 
+static bool rknpu_job_busy(struct rknpu_device *rknpu_dev)
+{
+	unsigned long flags;
+	bool busy = false;
+	int i = 0;
+
+	spin_lock_irqsave(&rknpu_dev->irq_lock, flags);
+	for (i = 0; i < rknpu_dev->config->num_irqs; i++) {
+		if (rknpu_dev->subcore_datas[i].job ||
+		    !list_empty(&rknpu_dev->subcore_datas[i].todo_list)) {
+			busy = true;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
+
+	return busy;
+}
+
 static void rknpu_power_off_delay_work(struct work_struct *power_off_work)
 {
 	struct rknpu_device *rknpu_dev =
 		container_of(to_delayed_work(power_off_work),
 			     struct rknpu_device, power_off_work);
 	mutex_lock(&rknpu_dev->power_lock);
+	/*
+	 * the adaptive delay may expire while a non-blocking job is still
+	 * running, keep the power until it is done
+	 */
+	if (rknpu_dev->power_put_adaptive && rknpu_job_busy(rknpu_dev)) {
+		queue_delayed_work(
+			rknpu_dev->power_off_wq, &rknpu_dev->power_off_work,
+			msecs_to_jiffies(RKNPU_POWER_BUSY_RECHECK_MS));
+		mutex_unlock(&rknpu_dev->power_lock);
+		return;
+	}
 	if (atomic_dec_if_positive(&rknpu_dev->power_refcount) == 0)
 		rknpu_power_off(rknpu_dev);
 	mutex_unlock(&rknpu_dev->power_lock);
 }
 
+/* called with power_lock held */
+static int rknpu_power_on_timed(struct rknpu_device *rknpu_dev)
+{
+	ktime_t start = ktime_get();
+	int64_t cost = 0;
+	int ret = 0;
+
+	ret = rknpu_power_on(rknpu_dev);
+	if (ret)
+		return ret;
+
+	cost = ktime_us_delta(ktime_get(), start);
+	rknpu_dev->power_on_time = rknpu_dev->power_on_time ?
+					   (rknpu_dev->power_on_time * 7 + cost) / 8 :
+					   cost;
+
+	return 0;
+}
+
+static void rknpu_power_on_predict_work(struct work_struct *power_on_work)
+{
+	struct rknpu_device *rknpu_dev =
+		container_of(to_delayed_work(power_on_work),
+			     struct rknpu_device, power_on_work);
+	int64_t hold = 0;
+
+	mutex_lock(&rknpu_dev->power_lock);
+	if (!rknpu_dev->power_put_adaptive ||
+	    atomic_read(&rknpu_dev->power_refcount) > 0) {
+		mutex_unlock(&rknpu_dev->power_lock);
+		return;
+	}
+
+	if (rknpu_power_on_timed(rknpu_dev)) {
+		mutex_unlock(&rknpu_dev->power_lock);
+		return;
+	}
+
+	/* the reference is owned by the pending power off work */
+	atomic_set(&rknpu_dev->power_refcount, 1);
+	hold = rknpu_dev->power_on_time + RKNPU_POWER_ON_MARGIN_US +
+	       rknpu_dev->job_period / 4;
+	queue_delayed_work(rknpu_dev->power_off_wq, &rknpu_dev->power_off_work,
+			   usecs_to_jiffies(hold));
+	mutex_unlock(&rknpu_dev->power_lock);
+}
+
 int rknpu_power_get(struct rknpu_device *rknpu_dev)
 {
 	int ret = 0;
 
 	mutex_lock(&rknpu_dev->power_lock);
 	if (atomic_inc_return(&rknpu_dev->power_refcount) == 1)
-		ret = rknpu_power_on(rknpu_dev);
+		ret = rknpu_power_on_timed(rknpu_dev);
+	else
+		ret = rockchip_autogate_ungate(&rknpu_dev->autogate);
 	mutex_unlock(&rknpu_dev->power_lock);
 
 	return ret;
@@ -248,18 +327,113 @@ int rknpu_power_put(struct rknpu_device *rknpu_dev)
 	return ret;
 }
 
+/*
+ * Learn the period of the incoming jobs, jobs closer than
+ * RKNPU_POWER_PERIOD_MIN_US to the previous one belong to the same burst.
+ */
+void rknpu_power_job_arrive(struct rknpu_device *rknpu_dev)
+{
+	ktime_t now = ktime_get();
+	int64_t gap = 0;
+
+	mutex_lock(&rknpu_dev->power_lock);
+
+	gap = ktime_us_delta(now, rknpu_dev->job_arrive_time);
+	if (gap < RKNPU_POWER_PERIOD_MIN_US) {
+		mutex_unlock(&rknpu_dev->power_lock);
+		return;
+	}
+
+	rknpu_dev->job_arrive_time = now;
+
+	if (gap > RKNPU_POWER_PERIOD_MAX_US) {
+		/* idle for a long time, start learning again */
+		rknpu_dev->job_period = 0;
+		rknpu_dev->job_period_dev = 0;
+	} else if (rknpu_dev->job_period == 0) {
+		rknpu_dev->job_period = gap;
+		rknpu_dev->job_period_dev = gap;
+	} else {
+		rknpu_dev->job_period_dev =
+			(rknpu_dev->job_period_dev * 3 +
+			 abs(gap - rknpu_dev->job_period)) /
+			4;
+		rknpu_dev->job_period = (rknpu_dev->job_period * 7 + gap) / 8;
+	}
+
+	mutex_unlock(&rknpu_dev->power_lock);
+}
+
+/*
+ * Power off delay in us for the adaptive mode, called with power_lock held.
+ * Returns a negative value when the jobs are not periodic, then the fixed
+ * power_put_delay is used.
+ */
+static int64_t rknpu_power_adaptive_delay(struct rknpu_device *rknpu_dev)
+{
+	int64_t period = rknpu_dev->job_period;
+	int64_t break_even = 0, gap = 0, lead = 0;
+
+	if (period == 0 || rknpu_dev->job_period_dev > period / 4)
+		return -1;
+
+	gap = ktime_us_delta(ktime_add_us(rknpu_dev->job_arrive_time, period),
+			     ktime_get());
+	if (gap <= 0)
+		return period / 4;
+
+	break_even = max_t(int64_t, RKNPU_POWER_BREAK_EVEN_US,
+			   rknpu_dev->power_on_time * 4);
+	if (gap <= break_even)
+		return gap + period / 4;
+
+	/* power down now and come back up just before the next job */
+	lead = rknpu_dev->power_on_time + RKNPU_POWER_ON_MARGIN_US;
+	if (gap > lead)
+		mod_delayed_work(rknpu_dev->power_off_wq,
+				 &rknpu_dev->power_on_work,
+				 usecs_to_jiffies(gap - lead));
+
+	return 0;
+}
+
 static int rknpu_power_put_delay(struct rknpu_device *rknpu_dev)
 {
-	if (rknpu_dev->power_put_delay == 0)
+	unsigned long delay = 0;
+	int64_t adaptive_delay = -1;
+
+	if (rknpu_dev->power_put_delay == 0 && !rknpu_dev->power_put_adaptive)
 		return rknpu_power_put(rknpu_dev);
 
 	mutex_lock(&rknpu_dev->power_lock);
-	if (atomic_read(&rknpu_dev->power_refcount) == 1)
-		queue_delayed_work(
-			rknpu_dev->power_off_wq, &rknpu_dev->power_off_work,
-			msecs_to_jiffies(rknpu_dev->power_put_delay));
+	if (rknpu_dev->power_put_adaptive)
+		adaptive_delay = rknpu_power_adaptive_delay(rknpu_dev);
+
+	if (adaptive_delay >= 0)
+		delay = usecs_to_jiffies(adaptive_delay);
 	else
+		delay = msecs_to_jiffies(rknpu_dev->power_put_delay);
+
+	if (atomic_read(&rknpu_dev->power_refcount) == 1) {
+		queue_delayed_work(rknpu_dev->power_off_wq,
+				   &rknpu_dev->power_off_work, delay);
+	} else {
+		/* the pending power off work owns one reference */
+		if (rknpu_dev->power_put_adaptive &&
+		    delayed_work_pending(&rknpu_dev->power_off_work))
+			mod_delayed_work(rknpu_dev->power_off_wq,
+					 &rknpu_dev->power_off_work, delay);
 		atomic_dec_if_positive(&rknpu_dev->power_refcount);
+	}
+
+	/*
+	 * Only the pending power off work holds the power now, gate the clocks
+	 * until the next rknpu_power_get() unless a non-blocking job still runs
+	 */
+	if (atomic_read(&rknpu_dev->power_refcount) == 1 &&
+	    delayed_work_pending(&rknpu_dev->power_off_work) &&
+	    !rknpu_job_busy(rknpu_dev))
+		rockchip_autogate_gate(&rknpu_dev->autogate);
 	mutex_unlock(&rknpu_dev->power_lock);
 
 	return 0;
@@ -475,6 +649,9 @@ static long rknpu_ioctl(struct file *file, uint32_t cmd, unsigned long arg)
 	case IOCTL_RKNPU_MEM_SYNC:
 		ret = rknpu_mem_sync_ioctl(rknpu_dev, arg);
 		break;
+	case IOCTL_RKNPU_SUBMIT_BATCH:
+		ret = rknpu_submit_batch_ioctl(rknpu_dev, arg);
+		break;
 	default:
 		break;
 	}
@@ -529,6 +706,8 @@ RKNPU_IOCTL(rknpu_gem_create_ioctl);
 RKNPU_IOCTL(rknpu_gem_map_ioctl);
 RKNPU_IOCTL(rknpu_gem_destroy_ioctl);
 RKNPU_IOCTL(rknpu_gem_sync_ioctl);
+RKNPU_IOCTL(rknpu_submit_batch_ioctl);
+RKNPU_IOCTL(rknpu_gem_share_ioctl);
 
 static const struct drm_ioctl_desc rknpu_ioctls[] = {
 	DRM_IOCTL_DEF_DRV(RKNPU_ACTION, __rknpu_action_ioctl, DRM_RENDER_ALLOW),
@@ -541,6 +720,10 @@ static const struct drm_ioctl_desc rknpu_ioctls[] = {
 			  DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(RKNPU_MEM_SYNC, __rknpu_gem_sync_ioctl,
 			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(RKNPU_SUBMIT_BATCH, __rknpu_submit_batch_ioctl,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(RKNPU_MEM_SHARE, __rknpu_gem_share_ioctl,
+			  DRM_RENDER_ALLOW),
 };
 
 #if KERNEL_VERSION(6, 1, 0) <= LINUX_VERSION_CODE
@@ -571,7 +754,7 @@ static struct drm_driver rknpu_drm_driver = {
 	.gem_free_object_unlocked = rknpu_gem_free_object,
 	.gem_vm_ops = &rknpu_gem_vm_ops,
 	.dumb_destroy = drm_gem_dumb_destroy,
-	.gem_prime_export = drm_gem_prime_export,
+	.gem_prime_export = rknpu_gem_prime_export,
 	.gem_prime_get_sg_table = rknpu_gem_prime_get_sg_table,
 	.gem_prime_vmap = rknpu_gem_prime_vmap,
 	.gem_prime_vunmap = rknpu_gem_prime_vunmap,
@@ -799,6 +982,7 @@ static int rknpu_power_on(struct rknpu_device *rknpu_dev)
 			      ret);
 		return ret;
 	}
+	rockchip_autogate_arm(&rknpu_dev->autogate);
 
 #ifndef FPGA_PLATFORM
 #if KERNEL_VERSION(5, 10, 0) <= LINUX_VERSION_CODE &&                          \
@@ -886,6 +1070,8 @@ static int rknpu_power_off(struct rknpu_device *rknpu_dev)
 #endif
 #endif
 
+	rockchip_autogate_disarm(&rknpu_dev->autogate);
+
 	pm_runtime_put_sync(dev);
 
 	if (rknpu_dev->multiple_domains) {
@@ -1832,6 +2018,8 @@ static int rknpu_probe(struct platform_device *pdev)
 		return -ENODEV;
 #endif
 	}
+	rockchip_autogate_init(&rknpu_dev->autogate, rknpu_dev->clks,
+			       rknpu_dev->num_clks);
 
 #ifndef FPGA_PLATFORM
 #if KERNEL_VERSION(5, 10, 0) <= LINUX_VERSION_CODE &&                          \
@@ -1871,6 +2059,10 @@ static int rknpu_probe(struct platform_device *pdev)
 	spin_lock_init(&rknpu_dev->irq_lock);
 	mutex_init(&rknpu_dev->power_lock);
 	mutex_init(&rknpu_dev->reset_lock);
+#ifdef CONFIG_ROCKCHIP_RKNPU_DRM_GEM
+	mutex_init(&rknpu_dev->share_lock);
+	INIT_LIST_HEAD(&rknpu_dev->share_list);
+#endif
 	for (i = 0; i < config->num_irqs; i++) {
 		INIT_LIST_HEAD(&rknpu_dev->subcore_datas[i].todo_list);
 		init_waitqueue_head(&rknpu_dev->subcore_datas[i].job_done_wq);
@@ -1993,6 +2185,8 @@ static int rknpu_probe(struct platform_device *pdev)
 	}
 	INIT_DEFERRABLE_WORK(&rknpu_dev->power_off_work,
 			     rknpu_power_off_delay_work);
+	INIT_DELAYED_WORK(&rknpu_dev->power_on_work,
+			  rknpu_power_on_predict_work);
 
 	if (IS_ENABLED(CONFIG_NO_GKI) &&
 	    IS_ENABLED(CONFIG_ROCKCHIP_RKNPU_SRAM) && rknpu_dev->iommu_en) {
@@ -2043,6 +2237,7 @@ static int rknpu_remove(struct platform_device *pdev)
 	struct rknpu_device *rknpu_dev = platform_get_drvdata(pdev);
 	int i = 0;
 
+	cancel_delayed_work_sync(&rknpu_dev->power_on_work);
 	cancel_delayed_work_sync(&rknpu_dev->power_off_work);
 	destroy_workqueue(rknpu_dev->power_off_wq);
 
@@ -15,12 +15,19 @@
 #include <linux/iommu.h>
 #include <linux/pfn_t.h>
 #include <linux/version.h>
+#include <linux/highmem.h>
 #include <asm/cacheflush.h>
 
 #if KERNEL_VERSION(5, 10, 0) <= LINUX_VERSION_CODE
 #include <linux/dma-map-ops.h>
 #endif
 
+#if KERNEL_VERSION(5, 11, 0) <= LINUX_VERSION_CODE
+#include <crypto/sha2.h>
+#else
+#include <crypto/sha.h>
+#endif
+
 #include "rknpu_drv.h"
 #include "rknpu_ioctl.h"
 #include "rknpu_gem.h"
@@ -351,7 +358,7 @@ static const struct vm_operations_struct vm_ops = {
 
 static const struct drm_gem_object_funcs rknpu_gem_object_funcs = {
 	.free = rknpu_gem_free_object,
-	.export = drm_gem_prime_export,
+	.export = rknpu_gem_prime_export,
 	.get_sg_table = rknpu_gem_prime_get_sg_table,
 	.vmap = rknpu_gem_prime_vmap,
 	.vunmap = rknpu_gem_prime_vunmap,
@@ -386,6 +393,7 @@ static struct rknpu_gem_object *rknpu_gem_init(struct drm_device *drm,
 	}
 
 	rknpu_obj->size = rknpu_obj->base.size;
+	INIT_LIST_HEAD(&rknpu_obj->share_node);
 
 	gfp_mask = mapping_gfp_mask(obj->filp->f_mapping);
 
@@ -654,8 +662,11 @@ struct rknpu_gem_object *rknpu_gem_object_create(struct drm_device *drm,
 		/* set memory type and cache attribute from user side. */
 		rknpu_obj->flags = flags;
 
-		sram_free_size = rknpu_dev->sram_mm->free_chunks *
-				 rknpu_dev->sram_mm->chunk_size;
+		/*
+		 * bounded by both the largest free extent and the remaining
+		 * sram quota of the calling process
+		 */
+		sram_free_size = rknpu_mm_get_avail_size(rknpu_dev->sram_mm);
 		if (sram_free_size > 0) {
 			real_sram_size = remain_ddr_size;
 			if (sram_size != 0 && remain_ddr_size > sram_size)
@@ -754,6 +765,14 @@ void rknpu_gem_object_destroy(struct rknpu_gem_object *rknpu_obj)
 		&rknpu_obj->dma_addr, rknpu_obj->cookie, rknpu_obj->size,
 		rknpu_obj->dma_attrs, rknpu_obj->flags, obj->handle_count);
 
+	if (rknpu_obj->shared) {
+		struct rknpu_device *rknpu_dev = obj->dev->dev_private;
+
+		mutex_lock(&rknpu_dev->share_lock);
+		list_del_init(&rknpu_obj->share_node);
+		mutex_unlock(&rknpu_dev->share_lock);
+	}
+
 	/*
 	 * do not release memory region from exporter.
 	 *
@@ -1187,6 +1206,15 @@ int rknpu_gem_mmap_obj(struct drm_gem_object *obj, struct vm_area_struct *vma)
 
 	LOG_DEBUG("flags: %#x\n", rknpu_obj->flags);
 
+	/* shared buffers are read-only for everybody */
+	if (rknpu_obj->shared) {
+		if (vma->vm_flags & VM_WRITE) {
+			ret = -EACCES;
+			goto err_close_vm;
+		}
+		vma->vm_flags &= ~VM_MAYWRITE;
+	}
+
 	/* non-cacheable as default. */
 	if (rknpu_obj->flags & RKNPU_MEM_CACHEABLE) {
 		vma->vm_page_prot = vm_get_page_prot(vma->vm_flags);
@@ -1239,6 +1267,26 @@ struct drm_gem_object *rknpu_gem_prime_import(struct drm_device *dev,
 }
 #endif
 
+/* published buffers can not be handed to other devices, they may write */
+#if KERNEL_VERSION(5, 4, 0) <= LINUX_VERSION_CODE
+struct dma_buf *rknpu_gem_prime_export(struct drm_gem_object *obj, int flags)
+{
+	if (to_rknpu_obj(obj)->shared)
+		return ERR_PTR(-EPERM);
+
+	return drm_gem_prime_export(obj, flags);
+}
+#else
+struct dma_buf *rknpu_gem_prime_export(struct drm_device *dev,
+				       struct drm_gem_object *obj, int flags)
+{
+	if (to_rknpu_obj(obj)->shared)
+		return ERR_PTR(-EPERM);
+
+	return drm_gem_prime_export(dev, obj, flags);
+}
+#endif
+
 struct sg_table *rknpu_gem_prime_get_sg_table(struct drm_gem_object *obj)
 {
 	struct rknpu_gem_object *rknpu_obj = to_rknpu_obj(obj);
@@ -1503,3 +1551,220 @@ int rknpu_gem_sync_ioctl(struct drm_device *dev, void *data,
 
 	return 0;
 }
+
+/* Make CPU reads or writes through the kernel page mappings coherent */
+static void rknpu_gem_share_sync(struct rknpu_gem_object *rknpu_obj,
+				 bool for_device)
+{
+	struct drm_device *drm = rknpu_obj->base.dev;
+	struct rknpu_device *rknpu_dev = drm->dev_private;
+	struct scatterlist *sg;
+	int i;
+
+	if (!(rknpu_obj->flags & RKNPU_MEM_NON_CONTIGUOUS)) {
+		if (for_device)
+			dma_sync_single_for_device(drm->dev,
+						   rknpu_obj->dma_addr,
+						   rknpu_obj->size,
+						   DMA_TO_DEVICE);
+		else
+			dma_sync_single_for_cpu(drm->dev, rknpu_obj->dma_addr,
+						rknpu_obj->size,
+						DMA_FROM_DEVICE);
+		return;
+	}
+
+	WARN_ON(!rknpu_dev->fake_dev);
+
+	for_each_sg(rknpu_obj->sgt->sgl, sg, rknpu_obj->sgt->nents, i) {
+		if (for_device)
+			dma_sync_single_for_device(rknpu_dev->fake_dev,
+						   sg_phys(sg), sg->length,
+						   DMA_TO_DEVICE);
+		else
+			dma_sync_single_for_cpu(rknpu_dev->fake_dev,
+						sg_phys(sg), sg->length,
+						DMA_FROM_DEVICE);
+	}
+}
+
+static void rknpu_gem_share_copy(struct rknpu_gem_object *dst,
+				 struct rknpu_gem_object *src)
+{
+	unsigned long i, nr_pages = src->size >> PAGE_SHIFT;
+
+	for (i = 0; i < nr_pages; i++) {
+		void *d = kmap(dst->pages[i]);
+		void *s = kmap(src->pages[i]);
+
+		memcpy(d, s, PAGE_SIZE);
+		kunmap(src->pages[i]);
+		kunmap(dst->pages[i]);
+	}
+}
+
+static void rknpu_gem_digest(struct rknpu_gem_object *rknpu_obj, u8 *digest)
+{
+	unsigned long i, nr_pages = rknpu_obj->size >> PAGE_SHIFT;
+	struct sha256_state sctx;
+
+	sha256_init(&sctx);
+
+	for (i = 0; i < nr_pages; i++) {
+		void *vaddr = kmap(rknpu_obj->pages[i]);
+
+		sha256_update(&sctx, vaddr, PAGE_SIZE);
+		kunmap(rknpu_obj->pages[i]);
+	}
+
+	sha256_final(&sctx, digest);
+}
+
+/* Caller must hold rknpu_dev->share_lock, returns a referenced object */
+static struct rknpu_gem_object *
+rknpu_gem_share_find(struct rknpu_device *rknpu_dev, const u8 *digest)
+{
+	struct rknpu_gem_object *rknpu_obj = NULL;
+
+	list_for_each_entry(rknpu_obj, &rknpu_dev->share_list, share_node) {
+		if (memcmp(rknpu_obj->share_digest, digest,
+			   RKNPU_MEM_SHARE_DIGEST_SIZE))
+			continue;
+
+		/* the last reference may be going away right now */
+		if (kref_get_unless_zero(&rknpu_obj->base.refcount))
+			return rknpu_obj;
+	}
+
+	return NULL;
+}
+
+/*
+ * The content is copied into a new object that only the kernel has access
+ * to, so no mapping, dma-buf or job set up on the caller's buffer can change
+ * it once its digest is taken. The caller gets a handle to the copy.
+ */
+static int rknpu_gem_share_publish(struct drm_device *drm,
+				   struct rknpu_mem_share *args,
+				   struct drm_file *file_priv)
+{
+	struct rknpu_device *rknpu_dev = drm->dev_private;
+	struct rknpu_gem_object *rknpu_obj = NULL;
+	struct rknpu_gem_object *share_obj = NULL;
+	struct rknpu_gem_object *found = NULL;
+	u8 digest[RKNPU_MEM_SHARE_DIGEST_SIZE];
+	unsigned int flags;
+	int ret = -EINVAL;
+
+	rknpu_obj = rknpu_gem_object_find(file_priv, args->handle);
+	if (!rknpu_obj)
+		return -EINVAL;
+
+	if (rknpu_obj->base.import_attach || rknpu_obj->sram_size > 0 ||
+	    rknpu_obj->nbuf_size > 0 || !rknpu_obj->pages) {
+		LOG_ERROR("can not share imported or cache buffers\n");
+		return -EINVAL;
+	}
+
+	flags = rknpu_obj->flags & ~(RKNPU_MEM_ZEROING |
+				     RKNPU_MEM_TRY_ALLOC_SRAM |
+				     RKNPU_MEM_TRY_ALLOC_NBUF);
+	share_obj = rknpu_gem_object_create(drm, flags, rknpu_obj->size, 0);
+	if (IS_ERR(share_obj))
+		return PTR_ERR(share_obj);
+
+	rknpu_gem_share_sync(rknpu_obj, false);
+	rknpu_gem_share_copy(share_obj, rknpu_obj);
+	rknpu_gem_share_sync(share_obj, true);
+
+	/* the digest is the name, make sure it matches the content */
+	rknpu_gem_digest(share_obj, digest);
+	if (memcmp(digest, args->digest, RKNPU_MEM_SHARE_DIGEST_SIZE)) {
+		LOG_ERROR("shared buffer digest mismatch\n");
+		ret = -EINVAL;
+		goto err_destroy;
+	}
+
+	mutex_lock(&rknpu_dev->share_lock);
+
+	found = rknpu_gem_share_find(rknpu_dev, digest);
+	if (found) {
+		mutex_unlock(&rknpu_dev->share_lock);
+		rknpu_gem_object_put(&found->base);
+		ret = -EEXIST;
+		goto err_destroy;
+	}
+
+	memcpy(share_obj->share_digest, digest, RKNPU_MEM_SHARE_DIGEST_SIZE);
+	share_obj->shared = true;
+	list_add_tail(&share_obj->share_node, &rknpu_dev->share_list);
+
+	mutex_unlock(&rknpu_dev->share_lock);
+
+	/* the handle takes over the allocation reference */
+	ret = rknpu_gem_handle_create(&share_obj->base, file_priv,
+				      &args->handle);
+	if (ret) {
+		rknpu_gem_object_put(&share_obj->base);
+		return ret;
+	}
+
+	args->size = share_obj->size;
+	args->obj_addr = (__u64)(uintptr_t)share_obj;
+	args->dma_addr = share_obj->dma_addr;
+
+	return 0;
+
+err_destroy:
+	rknpu_gem_object_destroy(share_obj);
+
+	return ret;
+}
+
+static int rknpu_gem_share_lookup(struct rknpu_device *rknpu_dev,
+				  struct rknpu_mem_share *args,
+				  struct drm_file *file_priv)
+{
+	struct rknpu_gem_object *rknpu_obj = NULL;
+	int ret = -EINVAL;
+
+	mutex_lock(&rknpu_dev->share_lock);
+	rknpu_obj = rknpu_gem_share_find(rknpu_dev, args->digest);
+	mutex_unlock(&rknpu_dev->share_lock);
+
+	if (!rknpu_obj)
+		return -ENOENT;
+
+	/* the new handle takes over the lookup reference */
+	ret = rknpu_gem_handle_create(&rknpu_obj->base, file_priv,
+				      &args->handle);
+	if (ret) {
+		rknpu_gem_object_put(&rknpu_obj->base);
+		return ret;
+	}
+
+	args->size = rknpu_obj->size;
+	args->obj_addr = (__u64)(uintptr_t)rknpu_obj;
+	args->dma_addr = rknpu_obj->dma_addr;
+
+	return 0;
+}
+
+int rknpu_gem_share_ioctl(struct drm_device *dev, void *data,
+			  struct drm_file *file_priv)
+{
+	struct rknpu_device *rknpu_dev = dev->dev_private;
+	struct rknpu_mem_share *args = data;
+
+	switch (args->flags) {
+	case RKNPU_MEM_SHARE_PUBLISH:
+		return rknpu_gem_share_publish(dev, args, file_priv);
+	case RKNPU_MEM_SHARE_LOOKUP:
+		return rknpu_gem_share_lookup(rknpu_dev, args, file_priv);
+	default:
+		LOG_ERROR("invalid mem share flags: %#x\n", args->flags);
+		break;
+	}
+
+	return -EINVAL;
+}
@@ -8,6 +8,7 @@
 #include <linux/delay.h>
 #include <linux/sync_file.h>
 #include <linux/io.h>
+#include <asm/div64.h>
 
 #include "rknpu_ioctl.h"
 #include "rknpu_drv.h"
@@ -139,6 +140,10 @@ static inline struct rknpu_job *rknpu_job_alloc(struct rknpu_device *rknpu_dev,
 		return NULL;
 
 	job->timestamp = ktime_get();
+	job->wait_start = job->timestamp;
+	job->pid = current->tgid;
+	job->priority = clamp_t(int, args->priority, RKNPU_JOB_PRIORITY_LOW,
+				RKNPU_JOB_PRIORITY_REALTIME);
 	job->rknpu_dev = rknpu_dev;
 	job->use_core_num = (args->core_mask & RKNPU_CORE0_MASK) +
 			    ((args->core_mask & RKNPU_CORE1_MASK) >> 1) +
@@ -409,6 +414,51 @@ static void rknpu_job_commit(struct rknpu_job *job)
 	}
 }
 
+/*
+ * The read/write amount counters are shared by all the cores, so split the
+ * amount moved since the last sample evenly between the cores busy with a
+ * job. Sampled whenever a core starts or stops a job, with irq_lock held.
+ */
+static void rknpu_job_sample_rw_amount(struct rknpu_device *rknpu_dev)
+{
+	void __iomem *rknpu_core_base = rknpu_dev->base[0];
+	struct rknpu_job *job = NULL;
+	uint32_t amount = 0, delta = 0;
+	uint64_t share = 0;
+	int busy_cores = 0;
+	int i = 0;
+
+	if (!rknpu_dev->config->bw_enable)
+		return;
+
+	amount = REG_READ(RKNPU_OFFSET_DT_WR_AMOUNT) +
+		 REG_READ(RKNPU_OFFSET_DT_RD_AMOUNT) +
+		 REG_READ(RKNPU_OFFSET_WT_RD_AMOUNT);
+
+	/* counters went back to zero after a clear or a power cycle */
+	delta = amount >= rknpu_dev->rw_amount_last ?
+			amount - rknpu_dev->rw_amount_last :
+			amount;
+	rknpu_dev->rw_amount_last = amount;
+
+	for (i = 0; i < rknpu_dev->config->num_irqs; i++) {
+		if (rknpu_dev->subcore_datas[i].job)
+			busy_cores++;
+	}
+
+	if (!busy_cores || !delta)
+		return;
+
+	share = (uint64_t)delta * rknpu_dev->config->pc_data_amount_scale;
+	do_div(share, busy_cores);
+
+	for (i = 0; i < rknpu_dev->config->num_irqs; i++) {
+		job = rknpu_dev->subcore_datas[i].job;
+		if (job)
+			job->rw_amount += share;
+	}
+}
+
 static void rknpu_job_next(struct rknpu_device *rknpu_dev, int core_index)
 {
 	struct rknpu_job *job = NULL;
@@ -431,14 +481,178 @@ static void rknpu_job_next(struct rknpu_device *rknpu_dev, int core_index)
 			       head[core_index]);
 
 	list_del_init(&job->head[core_index]);
+	rknpu_job_sample_rw_amount(rknpu_dev);
 	subcore_data->job = job;
 	job->hw_recoder_time = ktime_get();
 	job->commit_pc_time = job->hw_recoder_time;
-	spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
 
 	if (atomic_dec_and_test(&job->run_count)) {
+		job->wait_time +=
+			ktime_us_delta(job->hw_recoder_time, job->wait_start);
+		spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
+
 		rknpu_job_commit(job);
+		return;
+	}
+
+	spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
+}
+
+/*
+ * Queue a job by priority class, in submission order inside a class, or at
+ * the front of its class when @front is set for a job given back by
+ * rknpu_job_preempt().
+ *
+ * Multi core jobs are dispatched once every core took them from its own
+ * todo list, so they must show up in the same order in all of them: they
+ * are always queued at the tail, only single core jobs overtake.
+ */
+static void rknpu_job_insert_todo(struct rknpu_job *job, int core_index,
+				  bool front)
+{
+	struct rknpu_subcore_data *subcore_data =
+		&job->rknpu_dev->subcore_datas[core_index];
+	struct rknpu_job *entry = NULL;
+
+	if (job->use_core_num == 1) {
+		list_for_each_entry(entry, &subcore_data->todo_list,
+				    head[core_index]) {
+			if (entry->priority < job->priority ||
+			    (front && entry->priority == job->priority)) {
+				list_add_tail(&job->head[core_index],
+					      &entry->head[core_index]);
+				return;
+			}
+		}
+	}
+
+	list_add_tail(&job->head[core_index], &subcore_data->todo_list);
+}
+
+/*
+ * Called between two task submissions of a running single core job: give
+ * the core to a queued job of a higher class, the remaining tasks of @job
+ * are committed from the next submission once it is dispatched again.
+ */
+static bool rknpu_job_preempt(struct rknpu_job *job, int core_index)
+{
+	struct rknpu_device *rknpu_dev = job->rknpu_dev;
+	struct rknpu_subcore_data *subcore_data =
+		&rknpu_dev->subcore_datas[core_index];
+	struct rknpu_job *next = NULL;
+	unsigned long flags;
+	ktime_t now;
+
+	if (job->use_core_num != 1 || rknpu_dev->soft_reseting)
+		return false;
+
+	spin_lock_irqsave(&rknpu_dev->irq_lock, flags);
+
+	if (list_empty(&subcore_data->todo_list)) {
+		spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
+		return false;
+	}
+
+	next = list_first_entry(&subcore_data->todo_list, struct rknpu_job,
+				head[core_index]);
+	if (next->priority <= job->priority) {
+		spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
+		return false;
+	}
+
+	now = ktime_get();
+	rknpu_job_sample_rw_amount(rknpu_dev);
+	subcore_data->job = NULL;
+	subcore_data->timer.busy_time +=
+		ktime_us_delta(now, job->hw_recoder_time);
+
+	atomic_set(&job->run_count, 1);
+	job->irq_entry[core_index] = false;
+	/* not committed anymore, rknpu_job_wait() keeps waiting */
+	job->commit_pc_time = 0;
+	job->wait_start = now;
+	job->preempt_count++;
+	rknpu_job_insert_todo(job, core_index, true);
+
+	spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
+
+	return true;
+}
+
+static void rknpu_job_update_wait_stat(struct rknpu_job *job)
+{
+	struct rknpu_device *rknpu_dev = job->rknpu_dev;
+	struct rknpu_wait_stat *stat = NULL;
+	unsigned long flags;
+	int i = 0;
+
+	spin_lock_irqsave(&rknpu_dev->irq_lock, flags);
+
+	for (i = 0; i < RKNPU_MAX_WAIT_STATS; i++) {
+		if (rknpu_dev->wait_stats[i].pid == job->pid &&
+		    rknpu_dev->wait_stats[i].priority == job->priority &&
+		    rknpu_dev->wait_stats[i].job_count) {
+			stat = &rknpu_dev->wait_stats[i];
+			break;
+		}
+
+		/* reuse the least recently updated slot */
+		if (!stat || ktime_before(rknpu_dev->wait_stats[i].last_time,
+					  stat->last_time))
+			stat = &rknpu_dev->wait_stats[i];
+	}
+
+	if (i == RKNPU_MAX_WAIT_STATS) {
+		memset(stat, 0, sizeof(*stat));
+		stat->pid = job->pid;
+		stat->priority = job->priority;
+	}
+
+	stat->job_count++;
+	stat->preempt_count += job->preempt_count;
+	stat->wait_time_total += job->wait_time;
+	stat->wait_time_max = max(stat->wait_time_max, job->wait_time);
+	stat->last_time = ktime_get();
+
+	spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
+}
+
+static void rknpu_job_update_bw_stat(struct rknpu_job *job)
+{
+	struct rknpu_device *rknpu_dev = job->rknpu_dev;
+	struct rknpu_bw_stat *stat = NULL;
+	unsigned long flags;
+	int i = 0;
+
+	if (!rknpu_dev->config->bw_enable)
+		return;
+
+	spin_lock_irqsave(&rknpu_dev->irq_lock, flags);
+
+	for (i = 0; i < RKNPU_MAX_BW_STATS; i++) {
+		if (rknpu_dev->bw_stats[i].pid == job->pid &&
+		    rknpu_dev->bw_stats[i].job_count) {
+			stat = &rknpu_dev->bw_stats[i];
+			break;
+		}
+
+		/* reuse the least recently updated slot */
+		if (!stat || ktime_before(rknpu_dev->bw_stats[i].last_time,
+					  stat->last_time))
+			stat = &rknpu_dev->bw_stats[i];
 	}
+
+	if (i == RKNPU_MAX_BW_STATS) {
+		memset(stat, 0, sizeof(*stat));
+		stat->pid = job->pid;
+	}
+
+	stat->job_count++;
+	stat->rw_amount_total += job->rw_amount;
+	stat->rw_amount_max = max(stat->rw_amount_max, job->rw_amount);
+	stat->last_time = ktime_get();
+
+	spin_unlock_irqrestore(&rknpu_dev->irq_lock, flags);
 }
 
 static void rknpu_job_done(struct rknpu_job *job, int ret, int core_index)
@@ -451,6 +665,11 @@ static void rknpu_job_done(struct rknpu_job *job, int ret, int core_index)
 	if (atomic_inc_return(&job->submit_count[core_index]) <
 	    (rknpu_get_task_number(job, core_index) + max_submit_number - 1) /
 		    max_submit_number) {
+		if (rknpu_job_preempt(job, core_index)) {
+			rknpu_job_next(rknpu_dev, core_index);
+			return;
+		}
+
 		rknpu_job_commit(job);
 		return;
 	}
@@ -458,6 +677,7 @@ static void rknpu_job_done(struct rknpu_job *job, int ret, int core_index)
 	subcore_data = &rknpu_dev->subcore_datas[core_index];
 
 	spin_lock_irqsave(&rknpu_dev->irq_lock, flags);
+	rknpu_job_sample_rw_amount(rknpu_dev);
 	subcore_data->job = NULL;
 	subcore_data->task_num -= rknpu_get_task_number(job, core_index);
 	subcore_data->timer.busy_time +=
@@ -467,6 +687,9 @@ static void rknpu_job_done(struct rknpu_job *job, int ret, int core_index)
 	if (atomic_dec_and_test(&job->interrupt_count)) {
 		int use_core_num = job->use_core_num;
 
+		rknpu_job_update_wait_stat(job);
+		rknpu_job_update_bw_stat(job);
+
 		job->flags |= RKNPU_JOB_DONE;
 		job->ret = ret;
 
@@ -533,7 +756,7 @@ static void rknpu_job_schedule(struct rknpu_job *job)
 	for (i = 0; i < rknpu_dev->config->num_irqs; i++) {
 		if (job->args->core_mask & rknpu_core_mask(i)) {
 			subcore_data = &rknpu_dev->subcore_datas[i];
-			list_add_tail(&job->head[i], &subcore_data->todo_list);
+			rknpu_job_insert_todo(job, i, false);
 			subcore_data->task_num += rknpu_get_task_number(job, i);
 		}
 	}
@@ -739,6 +962,8 @@ static int rknpu_submit(struct rknpu_device *rknpu_dev,
 		return -EINVAL;
 	}
 
+	rknpu_power_job_arrive(rknpu_dev);
+
 	job = rknpu_job_alloc(rknpu_dev, args);
 	if (!job) {
 		LOG_ERROR("failed to allocate rknpu job!\n");
@@ -754,6 +979,7 @@ static int rknpu_submit(struct rknpu_device *rknpu_dev,
 		if (!in_fence) {
 			LOG_ERROR("invalid fence in fd, fd: %d\n",
 				  args->fence_fd);
+			rknpu_job_free(job);
 			return -EINVAL;
 		}
 		args->fence_fd = -1;
@@ -773,6 +999,7 @@ static int rknpu_submit(struct rknpu_device *rknpu_dev,
 				LOG_ERROR("Error (%d) waiting for fence!\n",
 					  ret);
 
+			rknpu_job_free(job);
 			return ret;
 		}
 #else
@@ -862,6 +1089,107 @@ int rknpu_submit_ioctl(struct rknpu_device *rknpu_dev, unsigned long data)
 }
 #endif
 
+static int rknpu_submit_batch(struct rknpu_device *rknpu_dev,
+			      struct rknpu_submit_batch *batch)
+{
+	struct rknpu_submit *submits = NULL;
+	int ret = 0;
+	int i = 0;
+
+	batch->job_submitted = 0;
+
+	if (batch->flags) {
+		LOG_ERROR("invalid rknpu batch flags: %#x\n", batch->flags);
+		return -EINVAL;
+	}
+
+	if (batch->job_number == 0 ||
+	    batch->job_number > RKNPU_SUBMIT_BATCH_MAX) {
+		LOG_ERROR("invalid rknpu batch job number: %u, max: %d\n",
+			  batch->job_number, RKNPU_SUBMIT_BATCH_MAX);
+		return -EINVAL;
+	}
+
+	submits = kcalloc(batch->job_number, sizeof(*submits), GFP_KERNEL);
+	if (!submits)
+		return -ENOMEM;
+
+	if (unlikely(copy_from_user(
+		    submits, u64_to_user_ptr(batch->submit_obj_addr),
+		    batch->job_number * sizeof(*submits)))) {
+		LOG_ERROR("%s: copy_from_user failed\n", __func__);
+		ret = -EFAULT;
+		goto out;
+	}
+
+	/*
+	 * The jobs are independent, queue them all without waiting so the
+	 * auto core selection of rknpu_job_schedule() sees the cores being
+	 * filled and spreads the following jobs over the other ones.
+	 */
+	for (i = 0; i < batch->job_number; i++) {
+		submits[i].flags |= RKNPU_JOB_NONBLOCK;
+
+		ret = rknpu_submit(rknpu_dev, &submits[i]);
+		if (ret) {
+			LOG_ERROR("failed to submit batch job %d, ret: %d\n",
+				  i, ret);
+			break;
+		}
+	}
+
+	batch->job_submitted = i;
+
+	if (unlikely(copy_to_user(u64_to_user_ptr(batch->submit_obj_addr),
+				  submits,
+				  batch->job_number * sizeof(*submits)))) {
+		LOG_ERROR("%s: copy_to_user failed\n", __func__);
+		ret = -EFAULT;
+	}
+
+out:
+	kfree(submits);
+
+	return ret;
+}
+
+#ifdef CONFIG_ROCKCHIP_RKNPU_DRM_GEM
+int rknpu_submit_batch_ioctl(struct drm_device *dev, void *data,
+			     struct drm_file *file_priv)
+{
+	struct rknpu_device *rknpu_dev = dev_get_drvdata(dev->dev);
+	struct rknpu_submit_batch *batch = data;
+
+	return rknpu_submit_batch(rknpu_dev, batch);
+}
+#endif
+
+#ifdef CONFIG_ROCKCHIP_RKNPU_DMA_HEAP
+int rknpu_submit_batch_ioctl(struct rknpu_device *rknpu_dev, unsigned long data)
+{
+	struct rknpu_submit_batch batch;
+	int ret = -EINVAL;
+
+	if (unlikely(copy_from_user(&batch, (struct rknpu_submit_batch *)data,
+				    sizeof(struct rknpu_submit_batch)))) {
+		LOG_ERROR("%s: copy_from_user failed\n", __func__);
+		ret = -EFAULT;
+		return ret;
+	}
+
+	ret = rknpu_submit_batch(rknpu_dev, &batch);
+
+	if (unlikely(copy_to_user((struct rknpu_submit_batch *)data, &batch,
+				  sizeof(struct rknpu_submit_batch)))) {
+		LOG_ERROR("%s: copy_to_user failed\n", __func__);
+		ret = -EFAULT;
+		return ret;
+	}
+
+	return ret;
+}
+#endif
+
 int rknpu_get_hw_version(struct rknpu_device *rknpu_dev, uint32_t *version)
 {
 	void __iomem *rknpu_core_base = rknpu_dev->base[0];
@@ -4,6 +4,9 @@
  * Author: Felix Zeng <felix.zeng@rock-chips.com>
  */
 
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+
 #include "rknpu_debugger.h"
 #include "rknpu_mm.h"
 
@@ -38,6 +41,8 @@ int rknpu_mm_create(unsigned int mem_size, unsigned int chunk_size,
 	}
 
 	mutex_init(&(*mm)->lock);
+	INIT_LIST_HEAD(&(*mm)->owner_list);
+	(*mm)->quota = RKNPU_MM_QUOTA_MAX;
 
 	LOG_DEBUG("total_chunks: %d, bitmap: %p\n", (*mm)->total_chunks,
 		  (*mm)->bitmap);
@@ -45,23 +50,86 @@ int rknpu_mm_create(unsigned int mem_size, unsigned int chunk_size,
 	return 0;
 
 free_mm:
-	kfree(mm);
+	kfree(*mm);
 	return ret;
 }
 
 void rknpu_mm_destroy(struct rknpu_mm *mm)
 {
+	struct rknpu_mm_owner *owner = NULL, *next = NULL;
+
 	if (mm != NULL) {
+		list_for_each_entry_safe(owner, next, &mm->owner_list, head) {
+			list_del(&owner->head);
+			kfree(owner);
+		}
 		mutex_destroy(&mm->lock);
 		kfree(mm->bitmap);
 		kfree(mm);
 	}
 }
 
+static struct rknpu_mm_owner *rknpu_mm_find_owner(struct rknpu_mm *mm,
+						   pid_t pid)
+{
+	struct rknpu_mm_owner *owner = NULL;
+
+	list_for_each_entry(owner, &mm->owner_list, head) {
+		if (owner->pid == pid)
+			return owner;
+	}
+
+	return NULL;
+}
+
+static unsigned int rknpu_mm_quota_chunks(struct rknpu_mm *mm)
+{
+	return (unsigned long)mm->total_chunks * mm->quota / RKNPU_MM_QUOTA_MAX;
+}
+
+/*
+ * Walk the free extents of the bitmap, return the number of extents and the
+ * length of the largest one; if @need is not zero, also return the start of
+ * the smallest extent that can hold @need chunks in @best_start.
+ */
+static unsigned int rknpu_mm_scan_free(struct rknpu_mm *mm, unsigned int need,
+				       unsigned int *best_start,
+				       unsigned int *largest)
+{
+	unsigned int start = 0, end = 0, len = 0;
+	unsigned int best_len = UINT_MAX;
+	unsigned int extents = 0;
+
+	*largest = 0;
+	if (best_start)
+		*best_start = mm->total_chunks;
+
+	start = find_next_zero_bit(mm->bitmap, mm->total_chunks, 0);
+	while (start < mm->total_chunks) {
+		end = find_next_bit(mm->bitmap, mm->total_chunks, start);
+		len = end - start;
+		extents++;
+
+		if (len > *largest)
+			*largest = len;
+
+		if (best_start && need > 0 && len >= need && len < best_len) {
+			*best_start = start;
+			best_len = len;
+		}
+
+		start = find_next_zero_bit(mm->bitmap, mm->total_chunks, end);
+	}
+
+	return extents;
+}
+
 int rknpu_mm_alloc(struct rknpu_mm *mm, unsigned int size,
 		   struct rknpu_mm_obj **mm_obj)
 {
-	unsigned int found, start_search, cur_size;
+	struct rknpu_mm_owner *owner = NULL;
+	unsigned int need = 0, found = 0, largest = 0;
+	pid_t pid = current->tgid;
 
 	if (size == 0)
 		return -EINVAL;
@@ -69,68 +137,55 @@ int rknpu_mm_alloc(struct rknpu_mm *mm, unsigned int size,
 	if (size > mm->total_chunks * mm->chunk_size)
 		return -ENOMEM;
 
+	need = DIV_ROUND_UP(size, mm->chunk_size);
+
 	*mm_obj = kzalloc(sizeof(struct rknpu_mm_obj), GFP_KERNEL);
 	if (!(*mm_obj))
 		return -ENOMEM;
 
-	start_search = 0;
-
 	mutex_lock(&mm->lock);
 
-mm_restart_search:
-	/* Find the first chunk that is free */
-	found = find_next_zero_bit(mm->bitmap, mm->total_chunks, start_search);
-
-	/* If there wasn't any free chunk, bail out */
-	if (found == mm->total_chunks)
+	owner = rknpu_mm_find_owner(mm, pid);
+	if ((owner ? owner->used_chunks : 0) + need >
+	    rknpu_mm_quota_chunks(mm)) {
+		LOG_DEBUG("pid %d exceeds sram quota, used: %u, need: %u\n",
+			  pid, owner ? owner->used_chunks : 0, need);
 		goto mm_no_free_chunk;
+	}
 
-	/* Update fields of mm_obj */
-	(*mm_obj)->range_start = found;
-	(*mm_obj)->range_end = found;
-
-	/* If we need only one chunk, mark it as allocated and get out */
-	if (size <= mm->chunk_size) {
-		set_bit(found, mm->bitmap);
-		goto mm_out;
+	if (!owner) {
+		owner = kzalloc(sizeof(*owner), GFP_KERNEL);
+		if (!owner)
+			goto mm_no_free_chunk;
+		owner->pid = pid;
+		list_add_tail(&owner->head, &mm->owner_list);
 	}
 
-	/* Otherwise, try to see if we have enough contiguous chunks */
-	cur_size = size - mm->chunk_size;
-	do {
-		(*mm_obj)->range_end = find_next_zero_bit(
-			mm->bitmap, mm->total_chunks, ++found);
-		/*
-		 * If next free chunk is not contiguous than we need to
-		 * restart our search from the last free chunk we found (which
-		 * wasn't contiguous to the previous ones
-		 */
-		if ((*mm_obj)->range_end != found) {
-			start_search = found;
-			goto mm_restart_search;
+	/*
+	 * Best fit, so that small per-layer buffers do not split the large
+	 * extents other models still need.
+	 */
+	rknpu_mm_scan_free(mm, need, &found, &largest);
+	if (found == mm->total_chunks) {
+		if (owner->used_chunks == 0) {
+			list_del(&owner->head);
+			kfree(owner);
 		}
+		goto mm_no_free_chunk;
+	}
 
-		/*
-		 * If we reached end of buffer, bail out with error
-		 */
-		if (found == mm->total_chunks)
-			goto mm_no_free_chunk;
-
-		/* Check if we don't need another chunk */
-		if (cur_size <= mm->chunk_size)
-			cur_size = 0;
-		else
-			cur_size -= mm->chunk_size;
+	bitmap_set(mm->bitmap, found, need);
 
-	} while (cur_size > 0);
+	(*mm_obj)->range_start = found;
+	(*mm_obj)->range_end = found + need - 1;
+	(*mm_obj)->owner = pid;
 
-	/* Mark the chunks as allocated */
-	for (found = (*mm_obj)->range_start; found <= (*mm_obj)->range_end;
-	     found++)
-		set_bit(found, mm->bitmap);
+	owner->used_chunks += need;
+	if (owner->used_chunks > owner->peak_chunks)
+		owner->peak_chunks = owner->used_chunks;
 
-mm_out:
-	mm->free_chunks -= ((*mm_obj)->range_end - (*mm_obj)->range_start + 1);
+	mm->free_chunks -= need;
+	mm->alloc_count++;
 	mutex_unlock(&mm->lock);
 
 	LOG_DEBUG("mm allocate, mm_obj: %p, range_start: %d, range_end: %d\n",
@@ -139,15 +194,18 @@ mm_out:
 	return 0;
 
 mm_no_free_chunk:
+	mm->fail_count++;
 	mutex_unlock(&mm->lock);
 	kfree(*mm_obj);
+	*mm_obj = NULL;
 
 	return -ENOMEM;
 }
 
 int rknpu_mm_free(struct rknpu_mm *mm, struct rknpu_mm_obj *mm_obj)
 {
-	unsigned int bit;
+	struct rknpu_mm_owner *owner = NULL;
+	unsigned int chunks = 0;
 
 	/* Act like kfree when trying to free a NULL object */
 	if (!mm_obj)
@@ -156,13 +214,23 @@ int rknpu_mm_free(struct rknpu_mm *mm, struct rknpu_mm_obj *mm_obj)
 	LOG_DEBUG("mm free, mem_obj: %p, range_start: %d, range_end: %d\n",
 		  mm_obj, mm_obj->range_start, mm_obj->range_end);
 
+	chunks = mm_obj->range_end - mm_obj->range_start + 1;
+
 	mutex_lock(&mm->lock);
 
 	/* Mark the chunks as free */
-	for (bit = mm_obj->range_start; bit <= mm_obj->range_end; bit++)
-		clear_bit(bit, mm->bitmap);
+	bitmap_clear(mm->bitmap, mm_obj->range_start, chunks);
+
+	mm->free_chunks += chunks;
 
-	mm->free_chunks += (mm_obj->range_end - mm_obj->range_start + 1);
+	owner = rknpu_mm_find_owner(mm, mm_obj->owner);
+	if (owner) {
+		owner->used_chunks -= min(owner->used_chunks, chunks);
+		if (owner->used_chunks == 0) {
+			list_del(&owner->head);
+			kfree(owner);
+		}
+	}
 
 	mutex_unlock(&mm->lock);
 
@@ -171,6 +239,69 @@ int rknpu_mm_free(struct rknpu_mm *mm, struct rknpu_mm_obj *mm_obj)
 	return 0;
 }
 
+/*
+ * Size in bytes the calling process can get in one allocation right now,
+ * bounded by both the largest free extent and its remaining quota.
+ */
+unsigned int rknpu_mm_get_avail_size(struct rknpu_mm *mm)
+{
+	struct rknpu_mm_owner *owner = NULL;
+	unsigned int largest = 0, quota = 0, used = 0;
+
+	mutex_lock(&mm->lock);
+
+	rknpu_mm_scan_free(mm, 0, NULL, &largest);
+
+	owner = rknpu_mm_find_owner(mm, current->tgid);
+	if (owner)
+		used = owner->used_chunks;
+
+	quota = rknpu_mm_quota_chunks(mm);
+	quota = quota > used ? quota - used : 0;
+
+	mutex_unlock(&mm->lock);
+
+	return min(largest, quota) * mm->chunk_size;
+}
+
+ssize_t rknpu_mm_quota_set(struct file *file, const char __user *ubuf,
+			   size_t len, loff_t *offp)
+{
+	struct seq_file *priv = file->private_data;
+	struct rknpu_debugger_node *node = priv->private;
+	struct rknpu_debugger *debugger = node->debugger;
+	struct rknpu_device *rknpu_dev =
+		container_of(debugger, struct rknpu_device, debugger);
+	struct rknpu_mm *mm = rknpu_dev->sram_mm;
+	char buf[16];
+	unsigned long quota = 0;
+	int ret = 0;
+
+	if (mm == NULL)
+		return -EINVAL;
+
+	if (len > sizeof(buf) - 1)
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len - 1] = '\0';
+
+	ret = kstrtoul(buf, 10, &quota);
+	if (ret || quota == 0 || quota > RKNPU_MM_QUOTA_MAX) {
+		LOG_ERROR("invalid sram quota string: %s, range: 1-%d\n", buf,
+			  RKNPU_MM_QUOTA_MAX);
+		return -EINVAL;
+	}
+
+	mutex_lock(&mm->lock);
+	mm->quota = quota;
+	mutex_unlock(&mm->lock);
+
+	LOG_INFO("set rknpu sram quota per process %lu%%\n", quota);
+
+	return len;
+}
+
 int rknpu_mm_dump(struct seq_file *m, void *data)
 {
 	struct rknpu_debugger_node *node = m->private;
@@ -178,6 +309,8 @@ int rknpu_mm_dump(struct seq_file *m, void *data)
 	struct rknpu_device *rknpu_dev =
 		container_of(debugger, struct rknpu_device, debugger);
 	struct rknpu_mm *mm = NULL;
+	struct rknpu_mm_owner *owner = NULL;
+	unsigned int extents = 0, largest = 0;
 	int cur = 0, rbot = 0, rtop = 0;
 	size_t ret = 0;
 	char buf[64];
@@ -190,6 +323,8 @@ int rknpu_mm_dump(struct seq_file *m, void *data)
 	if (mm == NULL)
 		return 0;
 
+	mutex_lock(&mm->lock);
+
 	seq_printf(m, "SRAM bitmap: \"*\" - used, \".\" - free (1bit = %dKB)\n",
 		   mm->chunk_size / 1024);
 
@@ -234,5 +369,22 @@ int rknpu_mm_dump(struct seq_file *m, void *data)
 		   rknpu_dev->sram_size, rknpu_dev->sram_size - free_size,
 		   free_size);
 
+	extents = rknpu_mm_scan_free(mm, 0, NULL, &largest);
+	seq_printf(m,
+		   "SRAM free extents: %u, largest: %u, fragmentation: %u%%\n",
+		   extents, largest * mm->chunk_size,
+		   mm->free_chunks ?
+			   100 - largest * 100 / mm->free_chunks :
+			   0);
+	seq_printf(m, "SRAM alloc: %lu, failed: %lu, quota per process: %u%%\n",
+		   mm->alloc_count, mm->fail_count, mm->quota);
+
+	list_for_each_entry(owner, &mm->owner_list, head)
+		seq_printf(m, "  pid: %d, used: %u, peak: %u\n", owner->pid,
+			   owner->used_chunks * mm->chunk_size,
+			   owner->peak_chunks * mm->chunk_size);
+
+	mutex_unlock(&mm->lock);
+
 	return 0;
 }
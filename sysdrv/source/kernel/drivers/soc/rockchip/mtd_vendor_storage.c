@@ -16,6 +16,7 @@
 #include <linux/soc/rockchip/rk_vendor_storage.h>
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 #define MTD_VENDOR_PART_START		0
 #define MTD_VENDOR_PART_SIZE		8
@@ -68,6 +69,7 @@ struct mtd_nand_info {
 #define VENDOR_REQ_TAG		0x56524551
 #define VENDOR_READ_IO		_IOW('v', 0x01, unsigned int)
 #define VENDOR_WRITE_IO		_IOW('v', 0x02, unsigned int)
+#define VENDOR_FLUSH_IO		_IOW('v', 0x03, unsigned int)
 
 static u8 *g_idb_buffer;
 static struct vendor_info *g_vendor;
@@ -77,6 +79,20 @@ static const char *vendor_mtd_name = "vnvm";
 static struct mtd_nand_info nand_info;
 static struct platform_device *g_pdev;
 
+/*
+ * The whole table lives in g_vendor, so reads never touch the flash. Writes
+ * normally go to the flash right away; with a commit delay they only update
+ * g_vendor and the table is written once, at most commit_delay_ms after the
+ * first change, on VENDOR_FLUSH_IO or at shutdown.
+ */
+static unsigned int commit_delay_ms;
+module_param(commit_delay_ms, uint, 0644);
+MODULE_PARM_DESC(commit_delay_ms, "delay before writing changes to flash, 0 to write through");
+
+static bool commit_pending;
+static void mtd_vendor_commit_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(commit_work, mtd_vendor_commit_work);
+
 static int mtd_vendor_nand_write(void)
 {
 	size_t bytes_write;
@@ -114,6 +130,42 @@ re_write:
 	return 0;
 }
 
+/* Called with vendor_ops_mutex held */
+static int mtd_vendor_flush(void)
+{
+	int ret;
+
+	if (!commit_pending)
+		return 0;
+
+	ret = mtd_vendor_nand_write();
+	if (!ret)
+		commit_pending = false;
+
+	return ret;
+}
+
+static void mtd_vendor_commit_work(struct work_struct *work)
+{
+	mutex_lock(&vendor_ops_mutex);
+	mtd_vendor_flush();
+	mutex_unlock(&vendor_ops_mutex);
+}
+
+static int mtd_vendor_commit(void)
+{
+	commit_pending = true;
+
+	if (!commit_delay_ms)
+		return mtd_vendor_flush();
+
+	/* Already queued work keeps its deadline, a write storm can't delay it */
+	queue_delayed_work(system_wq, &commit_work,
+			   msecs_to_jiffies(commit_delay_ms));
+
+	return 0;
+}
+
 static int mtd_vendor_storage_init(void)
 {
 	int err, offset;
@@ -199,7 +251,8 @@ static int mtd_vendor_storage_init(void)
 	return 0;
 }
 
-static int mtd_vendor_read(u32 id, void *pbuf, u32 size)
+/* Called with vendor_ops_mutex held */
+static int __mtd_vendor_read(u32 id, void *pbuf, u32 size)
 {
 	u32 i;
 
@@ -219,7 +272,8 @@ static int mtd_vendor_read(u32 id, void *pbuf, u32 size)
 	return (-1);
 }
 
-static int mtd_vendor_write(u32 id, void *pbuf, u32 size)
+/* Called with vendor_ops_mutex held */
+static int __mtd_vendor_write(u32 id, void *pbuf, u32 size)
 {
 	u32 i, j, align_size, alloc_size, item_num;
 	u32 offset, next_size;
@@ -269,8 +323,7 @@ static int mtd_vendor_write(u32 id, void *pbuf, u32 size)
 			}
 			g_vendor->version++;
 			g_vendor->version2 = g_vendor->version;
-			mtd_vendor_nand_write();
-			return 0;
+			return mtd_vendor_commit();
 		}
 	}
 
@@ -285,12 +338,33 @@ static int mtd_vendor_write(u32 id, void *pbuf, u32 size)
 		g_vendor->item_num++;
 		g_vendor->version++;
 		g_vendor->version2 = g_vendor->version;
-		mtd_vendor_nand_write();
-		return 0;
+		return mtd_vendor_commit();
 	}
 	return(-1);
 }
 
+static int mtd_vendor_read(u32 id, void *pbuf, u32 size)
+{
+	int ret;
+
+	mutex_lock(&vendor_ops_mutex);
+	ret = __mtd_vendor_read(id, pbuf, size);
+	mutex_unlock(&vendor_ops_mutex);
+
+	return ret;
+}
+
+static int mtd_vendor_write(u32 id, void *pbuf, u32 size)
+{
+	int ret;
+
+	mutex_lock(&vendor_ops_mutex);
+	ret = __mtd_vendor_write(id, pbuf, size);
+	mutex_unlock(&vendor_ops_mutex);
+
+	return ret;
+}
+
 static int vendor_storage_open(struct inode *inode, struct file *file)
 {
 	return 0;
@@ -325,7 +399,7 @@ static long vendor_storage_ioctl(struct file *file, unsigned int cmd,
 			break;
 		}
 		if (v_req->tag == VENDOR_REQ_TAG) {
-			size = mtd_vendor_read(v_req->id, v_req->data,
+			size = __mtd_vendor_read(v_req->id, v_req->data,
 						v_req->len);
 			if (size != -1) {
 				v_req->len = size;
@@ -350,12 +424,18 @@ static long vendor_storage_ioctl(struct file *file, unsigned int cmd,
 				ret = -EFAULT;
 				break;
 			}
-			ret = mtd_vendor_write(v_req->id,
-						v_req->data,
-						v_req->len);
+			ret = __mtd_vendor_write(v_req->id,
+						  v_req->data,
+						  v_req->len);
 		}
 	} break;
 
+	case VENDOR_FLUSH_IO:
+	{
+		cancel_delayed_work(&commit_work);
+		ret = mtd_vendor_flush();
+	} break;
+
 	default:
 		ret = -EINVAL;
 		goto exit;
@@ -406,8 +486,20 @@ static int vendor_storage_probe(struct platform_device *pdev)
 	return ret;
 }
 
+static void vendor_storage_sync(void)
+{
+	cancel_delayed_work_sync(&commit_work);
+
+	mutex_lock(&vendor_ops_mutex);
+	if (g_vendor)
+		mtd_vendor_flush();
+	mutex_unlock(&vendor_ops_mutex);
+}
+
 static int vendor_storage_remove(struct platform_device *pdev)
 {
+	vendor_storage_sync();
+
 	if (g_vendor) {
 		misc_deregister(&vendor_storage_dev);
 		g_vendor = NULL;
@@ -416,6 +508,11 @@ static int vendor_storage_remove(struct platform_device *pdev)
 	return 0;
 }
 
+static void vendor_storage_shutdown(struct platform_device *pdev)
+{
+	vendor_storage_sync();
+}
+
 static const struct platform_device_id vendor_storage_ids[] = {
 	{ "mtd_vendor_storage", },
 	{ }
@@ -424,6 +521,7 @@ static const struct platform_device_id vendor_storage_ids[] = {
 static struct platform_driver vendor_storage_driver = {
 	.probe  = vendor_storage_probe,
 	.remove = vendor_storage_remove,
+	.shutdown = vendor_storage_shutdown,
 	.driver = {
 		.name	= "mtd_vendor_storage",
 	},
@@ -4,12 +4,18 @@
  */
 
 #include <linux/dma-buf.h>
+#include <linux/dma-buf-cache.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/proc_fs.h>
 #include <linux/scatterlist.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+
+#include "deferred-free-helper.h"
+#include "page_pool.h"
 
 #define K(size) ((unsigned long)((size) >> 10))
 static struct device *dmabuf_dev;
@@ -113,6 +119,108 @@ static int rk_dmabuf_cb3(const struct dma_buf *dmabuf, void *private)
 	return 0;
 }
 
+#define RK_DMABUF_HOLDERS_MAX	64
+
+struct rk_dmabuf_holder {
+	char name[32];
+	unsigned long count;
+	size_t size;
+};
+
+struct rk_dmabuf_holders {
+	struct rk_dmabuf_holder names[RK_DMABUF_HOLDERS_MAX];
+	struct rk_dmabuf_holder devs[RK_DMABUF_HOLDERS_MAX];
+	int nr_names, nr_devs;
+	size_t other;
+};
+
+static void rk_dmabuf_holder_add(struct rk_dmabuf_holder *h, int *nr,
+				 const char *name, size_t size, size_t *other)
+{
+	int i;
+
+	for (i = 0; i < *nr; i++) {
+		if (!strncmp(h[i].name, name, sizeof(h[i].name) - 1))
+			break;
+	}
+
+	if (i == *nr) {
+		if (*nr == RK_DMABUF_HOLDERS_MAX) {
+			*other += size;
+			return;
+		}
+		strscpy(h[i].name, name, sizeof(h[i].name));
+		(*nr)++;
+	}
+
+	h[i].count++;
+	h[i].size += size;
+}
+
+static int rk_dmabuf_holders_cb(const struct dma_buf *dmabuf, void *private)
+{
+	struct rk_dmabuf_holders *hs = private;
+	struct dma_buf_attachment *a;
+
+	rk_dmabuf_holder_add(hs->names, &hs->nr_names,
+			     dmabuf->name ? dmabuf->name : dmabuf->exp_name,
+			     dmabuf->size, &hs->other);
+	list_for_each_entry(a, &dmabuf->attachments, node)
+		rk_dmabuf_holder_add(hs->devs, &hs->nr_devs, dev_name(a->dev),
+				     dmabuf->size, &hs->other);
+
+	return 0;
+}
+
+static int rk_dmabuf_holder_cmp(const void *a, const void *b)
+{
+	const struct rk_dmabuf_holder *ha = a, *hb = b;
+
+	if (ha->size == hb->size)
+		return 0;
+
+	return ha->size < hb->size ? 1 : -1;
+}
+
+static void rk_dmabuf_holders_dump(struct seq_file *s, const char *title,
+				   struct rk_dmabuf_holder *h, int nr)
+{
+	int i;
+
+	sort(h, nr, sizeof(*h), rk_dmabuf_holder_cmp, NULL);
+
+	seq_printf(s, "%-32s %8s %14s\n\n", title, "COUNT", "SIZE:KiB");
+	for (i = 0; i < nr; i++)
+		seq_printf(s, "%-32s %8lu %14lu\n", h[i].name, h[i].count,
+			   K(h[i].size));
+	seq_puts(s, "\n");
+}
+
+/*
+ * Who holds the dmabufs: totals by buffer name (the exporter if unnamed) and
+ * by attached device. A buffer shared by several devices counts for each.
+ */
+static int rk_dmabuf_holders_show(struct seq_file *s, void *v)
+{
+	struct rk_dmabuf_holders *hs;
+	int ret;
+
+	hs = kzalloc(sizeof(*hs), GFP_KERNEL);
+	if (!hs)
+		return -ENOMEM;
+
+	ret = get_each_dmabuf(rk_dmabuf_holders_cb, hs);
+	if (!ret) {
+		rk_dmabuf_holders_dump(s, "NAME", hs->names, hs->nr_names);
+		rk_dmabuf_holders_dump(s, "DEVICE", hs->devs, hs->nr_devs);
+		if (hs->other)
+			seq_printf(s, "Untracked: %lu KiB\n", K(hs->other));
+	}
+	kfree(hs);
+
+	return ret;
+}
+
 static int rk_dmabuf_sgt_show(struct seq_file *s, void *v)
 {
 	seq_printf(s, "%16s %-16s %-16s %14s %8s\n\n",
@@ -175,6 +283,121 @@ static const struct proc_ops rk_dmabuf_peak_ops = {
 	.proc_write	= rk_dmabuf_peak_write,
 };
 
+#if IS_ENABLED(CONFIG_DMABUF_HEAPS_DEFERRED_FREE)
+static int rk_dmabuf_deferred_show(struct seq_file *s, void *v)
+{
+	struct deferred_free_stats st;
+
+	deferred_free_get_stats(&st);
+
+	seq_printf(s, "Backlog: %lu buffers, %lu KiB\n",
+		   st.nr_items, K(st.nr_pages << PAGE_SHIFT));
+	seq_printf(s, "Freed: %lu\n", st.freed);
+	seq_printf(s, "Recycled: %lu\n", st.recycled);
+	seq_printf(s, "Max batch: %lu us\n", st.max_batch_us);
+
+	return 0;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_DMABUF_CACHE)
+static int rk_dmabuf_cache_show(struct seq_file *s, void *v)
+{
+	dma_buf_cache_show(s);
+
+	return 0;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_DMABUF_HEAPS_PAGE_POOL)
+static int rk_dmabuf_pool_cb(struct dmabuf_page_pool *pool, void *private)
+{
+	struct dmabuf_page_pool_stats st;
+	struct seq_file *s = private;
+	unsigned long total;
+
+	dmabuf_page_pool_get_stats(pool, &st);
+	total = st.hit + st.miss;
+
+	seq_printf(s, "%-16.16s %5u %10lu %8u %8u %12lu %12lu %5lu%%\n",
+		   st.name ? st.name : "-", st.order,
+		   K((unsigned long)st.count << (PAGE_SHIFT + st.order)),
+		   st.low, st.high, st.hit, st.miss,
+		   total ? st.hit * 100 / total : 0);
+
+	return 0;
+}
+
+static int rk_dmabuf_pool_show(struct seq_file *s, void *v)
+{
+	seq_printf(s, "%-16s %5s %10s %8s %8s %12s %12s %6s\n\n",
+		   "POOL", "ORDER", "SIZE:KiB", "LOW", "HIGH", "HIT", "MISS", "RATE");
+
+	return dmabuf_page_pool_for_each(rk_dmabuf_pool_cb, s);
+}
+
+struct rk_dmabuf_pool_wm {
+	char name[32];
+	unsigned int order;
+	unsigned int low;
+	unsigned int high;
+	bool found;
+};
+
+static int rk_dmabuf_pool_wm_cb(struct dmabuf_page_pool *pool, void *private)
+{
+	struct rk_dmabuf_pool_wm *wm = private;
+	struct dmabuf_page_pool_stats st;
+
+	dmabuf_page_pool_get_stats(pool, &st);
+	if (!st.name || strcmp(st.name, wm->name) || st.order != wm->order)
+		return 0;
+
+	dmabuf_page_pool_set_watermark(pool, wm->low, wm->high);
+	wm->found = true;
+
+	return 1;
+}
+
+/* echo "<pool> <order> <low> <high>" > /proc/rk_dmabuf/pool */
+static ssize_t rk_dmabuf_pool_write(struct file *file,
+				    const char __user *buffer,
+				    size_t count, loff_t *ppos)
+{
+	struct rk_dmabuf_pool_wm wm = { };
+	char buf[64];
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+
+	if (copy_from_user(buf, buffer, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%31s %u %u %u", wm.name, &wm.order, &wm.low, &wm.high) != 4)
+		return -EINVAL;
+
+	dmabuf_page_pool_for_each(rk_dmabuf_pool_wm_cb, &wm);
+	if (!wm.found)
+		return -ENODEV;
+
+	return count;
+}
+
+static int rk_dmabuf_pool_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rk_dmabuf_pool_show, NULL);
+}
+
+static const struct proc_ops rk_dmabuf_pool_ops = {
+	.proc_open	= rk_dmabuf_pool_open,
+	.proc_read	= seq_read,
+	.proc_lseek	= seq_lseek,
+	.proc_release	= single_release,
+	.proc_write	= rk_dmabuf_pool_write,
+};
+#endif
+
 static int __init rk_dmabuf_init(void)
 {
 	struct platform_device *pdev;
@@ -191,8 +414,18 @@ static int __init rk_dmabuf_init(void)
 
 	proc_create_single("sgt", 0, root, rk_dmabuf_sgt_show);
 	proc_create_single("dev", 0, root, rk_dmabuf_dev_show);
+	proc_create_single("holders", 0, root, rk_dmabuf_holders_show);
 	proc_create_single("size", 0, root, rk_dmabuf_size_show);
 	proc_create("peak", 0644, root, &rk_dmabuf_peak_ops);
+#if IS_ENABLED(CONFIG_DMABUF_HEAPS_DEFERRED_FREE)
+	proc_create_single("deferred", 0, root, rk_dmabuf_deferred_show);
+#endif
+#if IS_ENABLED(CONFIG_DMABUF_CACHE)
+	proc_create_single("cache", 0, root, rk_dmabuf_cache_show);
+#endif
+#if IS_ENABLED(CONFIG_DMABUF_HEAPS_PAGE_POOL)
+	proc_create("pool", 0644, root, &rk_dmabuf_pool_ops);
+#endif
 
 	return 0;
 }
@@ -0,0 +1,625 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Rockchip AMP shared memory message rings.
+ *
+ * Copyright (C) 2023 Rockchip Electronics Co., Ltd.
+ *
+ * Two single producer single consumer rings in a reserved memory region,
+ * with a mailbox doorbell in each direction. Messages are written in place,
+ * there is no copy on the kernel API or mmap() paths. See
+ * include/uapi/linux/rk-amp-ring.h for the layout and the protocol the
+ * remote side has to follow.
+ *
+ * A ring has a single owner at a time, either a kernel user from
+ * rk_amp_ring_get() or an open file. The owner is the only Linux producer
+ * and consumer so no locking is needed on the rings themselves.
+ */
+
+#include <linux/fs.h>
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/mailbox_client.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/of_address.h>
+#include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/soc/rockchip/rockchip_amp_ring.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <soc/rockchip/rockchip-mailbox.h>
+#include <uapi/linux/rk-amp-ring.h>
+
+#define RK_AMP_RING_SLOT_SIZE	256
+
+struct rk_amp_ring {
+	struct device *dev;
+	struct list_head node;
+	const char *name;
+	struct miscdevice miscdev;
+
+	phys_addr_t phys;
+	size_t size;
+	void *base;
+	struct rk_amp_ring_ctrl *tx;
+	struct rk_amp_ring_ctrl *rx;
+	void *tx_slots;
+	void *rx_slots;
+	u32 slot_size;
+	u32 slot_num;
+
+	u32 link_id;
+	struct mbox_client mbox_cl;
+	struct mbox_chan *mbox_tx_chan;
+	struct mbox_chan *mbox_rx_chan;
+	struct rockchip_mbox_msg tx_msg;
+
+	atomic_t busy;
+	/* Protects notify and notify_data */
+	spinlock_t notify_lock;
+	void (*notify)(void *data);
+	void *notify_data;
+	wait_queue_head_t wait;
+	/* Serialises read() and write() */
+	struct mutex lock;
+};
+
+static LIST_HEAD(rk_amp_ring_list);
+static DEFINE_MUTEX(rk_amp_ring_list_lock);
+
+static inline struct rk_amp_ring_slot *rk_amp_ring_slot(struct rk_amp_ring *ring,
+							void *slots, u32 idx)
+{
+	return slots + (idx & (ring->slot_num - 1)) * ring->slot_size;
+}
+
+static bool rk_amp_ring_rx_pending(struct rk_amp_ring *ring)
+{
+	return READ_ONCE(ring->rx->head) != READ_ONCE(ring->rx->tail);
+}
+
+static bool rk_amp_ring_tx_space(struct rk_amp_ring *ring)
+{
+	return READ_ONCE(ring->tx->head) - READ_ONCE(ring->tx->tail) <
+	       ring->slot_num;
+}
+
+/**
+ * rk_amp_ring_get - Claim a ring
+ * @name: label of the ring in the device tree
+ * @notify: called on every doorbell from the remote side, in atomic context
+ * @data: passed to @notify
+ *
+ * Returns the ring, ERR_PTR(-ENODEV) if there is no such ring or
+ * ERR_PTR(-EBUSY) if it's already owned.
+ */
+struct rk_amp_ring *rk_amp_ring_get(const char *name,
+				    void (*notify)(void *data), void *data)
+{
+	struct rk_amp_ring *ring, *found = ERR_PTR(-ENODEV);
+	unsigned long flags;
+
+	mutex_lock(&rk_amp_ring_list_lock);
+	list_for_each_entry(ring, &rk_amp_ring_list, node) {
+		if (strcmp(ring->name, name))
+			continue;
+
+		if (atomic_cmpxchg(&ring->busy, 0, 1)) {
+			found = ERR_PTR(-EBUSY);
+			break;
+		}
+
+		spin_lock_irqsave(&ring->notify_lock, flags);
+		ring->notify = notify;
+		ring->notify_data = data;
+		spin_unlock_irqrestore(&ring->notify_lock, flags);
+		found = ring;
+		break;
+	}
+	mutex_unlock(&rk_amp_ring_list_lock);
+
+	return found;
+}
+EXPORT_SYMBOL_GPL(rk_amp_ring_get);
+
+void rk_amp_ring_put(struct rk_amp_ring *ring)
+{
+	unsigned long flags;
+
+	if (IS_ERR_OR_NULL(ring))
+		return;
+
+	spin_lock_irqsave(&ring->notify_lock, flags);
+	ring->notify = NULL;
+	ring->notify_data = NULL;
+	spin_unlock_irqrestore(&ring->notify_lock, flags);
+
+	atomic_set(&ring->busy, 0);
+}
+EXPORT_SYMBOL_GPL(rk_amp_ring_put);
+
+size_t rk_amp_ring_max_msg(struct rk_amp_ring *ring)
+{
+	return ring->slot_size - sizeof(struct rk_amp_ring_slot);
+}
+EXPORT_SYMBOL_GPL(rk_amp_ring_max_msg);
+
+int rk_amp_ring_kick(struct rk_amp_ring *ring)
+{
+	int ret;
+
+	ring->tx_msg.cmd = ring->link_id & 0xFFU;
+	ring->tx_msg.data = RK_AMP_RING_MAGIC;
+
+	ret = mbox_send_message(ring->mbox_tx_chan, &ring->tx_msg);
+	if (ret < 0)
+		return ret;
+	mbox_chan_txdone(ring->mbox_tx_chan, 0);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(rk_amp_ring_kick);
+
+/**
+ * rk_amp_ring_tx_reserve - Get the next free tx slot
+ * @ring: the ring
+ * @len: size of the message that will be written
+ *
+ * Returns a pointer to write the message to, ERR_PTR(-EMSGSIZE) if @len
+ * doesn't fit in a slot or ERR_PTR(-ENOSPC) if the ring is full. The slot
+ * becomes visible to the remote side with rk_amp_ring_tx_commit().
+ */
+void *rk_amp_ring_tx_reserve(struct rk_amp_ring *ring, size_t len)
+{
+	if (len > rk_amp_ring_max_msg(ring))
+		return ERR_PTR(-EMSGSIZE);
+
+	if (!rk_amp_ring_tx_space(ring))
+		return ERR_PTR(-ENOSPC);
+
+	return rk_amp_ring_slot(ring, ring->tx_slots,
+				READ_ONCE(ring->tx->head))->data;
+}
+EXPORT_SYMBOL_GPL(rk_amp_ring_tx_reserve);
+
+/**
+ * rk_amp_ring_tx_commit - Publish the slot returned by rk_amp_ring_tx_reserve()
+ * @ring: the ring
+ * @len: size of the message
+ * @kick: ring the doorbell if the remote side may be waiting
+ *
+ * Callers pushing a batch can pass @kick only for the last message, as long
+ * as the first one was committed with it too.
+ */
+int rk_amp_ring_tx_commit(struct rk_amp_ring *ring, size_t len, bool kick)
+{
+	struct rk_amp_ring_slot *slot;
+	u32 head = READ_ONCE(ring->tx->head);
+
+	if (len > rk_amp_ring_max_msg(ring))
+		return -EMSGSIZE;
+
+	if (!rk_amp_ring_tx_space(ring))
+		return -ENOSPC;
+
+	slot = rk_amp_ring_slot(ring, ring->tx_slots, head);
+	WRITE_ONCE(slot->len, len);
+	WRITE_ONCE(slot->flags, 0);
+	/* The message must be visible before the new head */
+	dma_wmb();
+	WRITE_ONCE(ring->tx->head, head + 1);
+
+	if (!kick)
+		return 0;
+
+	/* Pairs with the barrier the remote consumer issues after tail */
+	mb();
+	if (READ_ONCE(ring->tx->tail) == head)
+		return rk_amp_ring_kick(ring);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(rk_amp_ring_tx_commit);
+
+/**
+ * rk_amp_ring_rx_peek - Get the oldest message from the remote side
+ * @ring: the ring
+ * @len: returns the size of the message
+ *
+ * Returns NULL if the ring is empty. The message stays valid until
+ * rk_amp_ring_rx_release().
+ */
+const void *rk_amp_ring_rx_peek(struct rk_amp_ring *ring, size_t *len)
+{
+	struct rk_amp_ring_slot *slot;
+
+	if (!rk_amp_ring_rx_pending(ring))
+		return NULL;
+
+	/* Read the message only after seeing the head that published it */
+	dma_rmb();
+	slot = rk_amp_ring_slot(ring, ring->rx_slots, READ_ONCE(ring->rx->tail));
+	*len = min_t(size_t, READ_ONCE(slot->len), rk_amp_ring_max_msg(ring));
+
+	return slot->data;
+}
+EXPORT_SYMBOL_GPL(rk_amp_ring_rx_peek);
+
+void rk_amp_ring_rx_release(struct rk_amp_ring *ring)
+{
+	u32 tail = READ_ONCE(ring->rx->tail);
+	bool full = READ_ONCE(ring->rx->head) - tail >= ring->slot_num;
+
+	/* Done with the slot before handing it back */
+	mb();
+	WRITE_ONCE(ring->rx->tail, tail + 1);
+
+	/* The remote producer may be waiting for space */
+	if (full)
+		rk_amp_ring_kick(ring);
+}
+EXPORT_SYMBOL_GPL(rk_amp_ring_rx_release);
+
+static void rk_amp_ring_rx_callback(struct mbox_client *client, void *message)
+{
+	struct rk_amp_ring *ring = container_of(client, struct rk_amp_ring, mbox_cl);
+	unsigned long flags;
+
+	wake_up_interruptible(&ring->wait);
+
+	spin_lock_irqsave(&ring->notify_lock, flags);
+	if (ring->notify)
+		ring->notify(ring->notify_data);
+	spin_unlock_irqrestore(&ring->notify_lock, flags);
+}
+
+static int rk_amp_ring_open(struct inode *inode, struct file *file)
+{
+	struct rk_amp_ring *ring = container_of(file->private_data,
+						struct rk_amp_ring, miscdev);
+
+	if (atomic_cmpxchg(&ring->busy, 0, 1))
+		return -EBUSY;
+
+	file->private_data = ring;
+
+	return nonseekable_open(inode, file);
+}
+
+static int rk_amp_ring_release(struct inode *inode, struct file *file)
+{
+	struct rk_amp_ring *ring = file->private_data;
+
+	atomic_set(&ring->busy, 0);
+
+	return 0;
+}
+
+static ssize_t rk_amp_ring_read(struct file *file, char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct rk_amp_ring *ring = file->private_data;
+	const void *data;
+	size_t len;
+	ssize_t ret;
+
+	mutex_lock(&ring->lock);
+	while (!(data = rk_amp_ring_rx_peek(ring, &len))) {
+		mutex_unlock(&ring->lock);
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (wait_event_interruptible(ring->wait,
+					     rk_amp_ring_rx_pending(ring)))
+			return -ERESTARTSYS;
+		mutex_lock(&ring->lock);
+	}
+
+	if (count < len) {
+		ret = -EMSGSIZE;
+		goto out;
+	}
+
+	if (copy_to_user(buf, data, len)) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	rk_amp_ring_rx_release(ring);
+	ret = len;
+out:
+	mutex_unlock(&ring->lock);
+
+	return ret;
+}
+
+static ssize_t rk_amp_ring_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct rk_amp_ring *ring = file->private_data;
+	void *data;
+	ssize_t ret;
+
+	if (count > rk_amp_ring_max_msg(ring))
+		return -EMSGSIZE;
+
+	mutex_lock(&ring->lock);
+	while (IS_ERR(data = rk_amp_ring_tx_reserve(ring, count))) {
+		mutex_unlock(&ring->lock);
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (wait_event_interruptible(ring->wait,
+					     rk_amp_ring_tx_space(ring)))
+			return -ERESTARTSYS;
+		mutex_lock(&ring->lock);
+	}
+
+	if (copy_from_user(data, buf, count)) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	ret = rk_amp_ring_tx_commit(ring, count, true);
+	if (!ret)
+		ret = count;
+out:
+	mutex_unlock(&ring->lock);
+
+	return ret;
+}
+
+static __poll_t rk_amp_ring_poll(struct file *file, poll_table *wait)
+{
+	struct rk_amp_ring *ring = file->private_data;
+	__poll_t mask = 0;
+
+	poll_wait(file, &ring->wait, wait);
+
+	if (rk_amp_ring_rx_pending(ring))
+		mask |= EPOLLIN | EPOLLRDNORM;
+	if (rk_amp_ring_tx_space(ring))
+		mask |= EPOLLOUT | EPOLLWRNORM;
+
+	return mask;
+}
+
+/*
+ * Map the whole region so that userspace can drive the rings itself. It
+ * then must not mix direct accesses and read()/write() on the same ring.
+ */
+static int rk_amp_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct rk_amp_ring *ring = file->private_data;
+	size_t size = vma->vm_end - vma->vm_start;
+
+	if (vma->vm_pgoff || size > ring->size)
+		return -EINVAL;
+
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+	vma->vm_flags |= VM_IO | VM_DONTEXPAND | VM_DONTDUMP;
+
+	return remap_pfn_range(vma, vma->vm_start, PHYS_PFN(ring->phys), size,
+			       vma->vm_page_prot);
+}
+
+static long rk_amp_ring_ioctl(struct file *file, unsigned int cmd,
+			      unsigned long arg)
+{
+	struct rk_amp_ring *ring = file->private_data;
+	struct rk_amp_ring_info info;
+
+	switch (cmd) {
+	case RK_AMP_RING_IOC_INFO:
+		memset(&info, 0, sizeof(info));
+		info.size = ring->size;
+		info.slot_size = ring->slot_size;
+		info.slot_num = ring->slot_num;
+		info.tx_offset = (void *)ring->tx - ring->base;
+		info.rx_offset = (void *)ring->rx - ring->base;
+		if (copy_to_user((void __user *)arg, &info, sizeof(info)))
+			return -EFAULT;
+		return 0;
+	case RK_AMP_RING_IOC_KICK:
+		return rk_amp_ring_kick(ring);
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations rk_amp_ring_fops = {
+	.owner = THIS_MODULE,
+	.open = rk_amp_ring_open,
+	.release = rk_amp_ring_release,
+	.read = rk_amp_ring_read,
+	.write = rk_amp_ring_write,
+	.poll = rk_amp_ring_poll,
+	.mmap = rk_amp_ring_mmap,
+	.unlocked_ioctl = rk_amp_ring_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+	.llseek = no_llseek,
+};
+
+static int rk_amp_ring_format(struct rk_amp_ring *ring)
+{
+	struct rk_amp_ring_hdr *hdr = ring->base;
+	size_t ctrl = ALIGN(sizeof(struct rk_amp_ring_ctrl), RK_AMP_RING_ALIGN);
+	size_t start = ALIGN(sizeof(*hdr), RK_AMP_RING_ALIGN);
+	size_t per_ring, slots;
+
+	if (ring->size < start + 2 * (ctrl + ring->slot_size))
+		return -EINVAL;
+
+	per_ring = (ring->size - start) / 2;
+	slots = (per_ring - ctrl) / ring->slot_size;
+	ring->slot_num = rounddown_pow_of_two(slots);
+	per_ring = ctrl + ring->slot_num * ring->slot_size;
+
+	ring->tx = ring->base + start;
+	ring->tx_slots = (void *)ring->tx + ctrl;
+	ring->rx = ring->base + start + per_ring;
+	ring->rx_slots = (void *)ring->rx + ctrl;
+
+	memset(ring->base, 0, ring->size);
+	hdr->version = RK_AMP_RING_VERSION;
+	hdr->slot_size = ring->slot_size;
+	hdr->slot_num = ring->slot_num;
+	hdr->tx_offset = (void *)ring->tx - ring->base;
+	hdr->rx_offset = (void *)ring->rx - ring->base;
+	/* The remote side waits for the magic before touching the rings */
+	dma_wmb();
+	WRITE_ONCE(hdr->magic, RK_AMP_RING_MAGIC);
+
+	return 0;
+}
+
+static int rk_amp_ring_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct device_node *mem;
+	struct rk_amp_ring *ring;
+	struct resource reg;
+	int ret;
+
+	ring = devm_kzalloc(dev, sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->dev = dev;
+	atomic_set(&ring->busy, 0);
+	spin_lock_init(&ring->notify_lock);
+	init_waitqueue_head(&ring->wait);
+	mutex_init(&ring->lock);
+
+	mem = of_parse_phandle(dev->of_node, "memory-region", 0);
+	if (!mem) {
+		dev_err(dev, "missing \"memory-region\" property\n");
+		return -ENODEV;
+	}
+
+	ret = of_address_to_resource(mem, 0, &reg);
+	of_node_put(mem);
+	if (ret) {
+		dev_err(dev, "missing \"reg\" property\n");
+		return -ENODEV;
+	}
+
+	ring->phys = reg.start;
+	ring->size = resource_size(&reg);
+	/* mmap() hands out whole pages, none may spill past the region */
+	if (!PAGE_ALIGNED(ring->phys) || !PAGE_ALIGNED(ring->size)) {
+		dev_err(dev, "memory region must be page aligned\n");
+		return -EINVAL;
+	}
+
+	if (of_property_read_string(dev->of_node, "label", &ring->name))
+		ring->name = dev->of_node->name;
+
+	ring->slot_size = RK_AMP_RING_SLOT_SIZE;
+	device_property_read_u32(dev, "rockchip,slot-size", &ring->slot_size);
+	if (ring->slot_size < RK_AMP_RING_ALIGN ||
+	    !IS_ALIGNED(ring->slot_size, RK_AMP_RING_ALIGN)) {
+		dev_err(dev, "invalid slot size %u\n", ring->slot_size);
+		return -EINVAL;
+	}
+
+	device_property_read_u32(dev, "rockchip,link-id", &ring->link_id);
+
+	ring->base = devm_memremap(dev, ring->phys, ring->size, MEMREMAP_WC);
+	if (IS_ERR(ring->base))
+		return PTR_ERR(ring->base);
+
+	ret = rk_amp_ring_format(ring);
+	if (ret) {
+		dev_err(dev, "memory region too small %zu\n", ring->size);
+		return ret;
+	}
+
+	ring->mbox_cl.dev = dev;
+	ring->mbox_cl.rx_callback = rk_amp_ring_rx_callback;
+	ring->mbox_tx_chan = mbox_request_channel_byname(&ring->mbox_cl, "amp-tx");
+	if (IS_ERR(ring->mbox_tx_chan)) {
+		ret = PTR_ERR(ring->mbox_tx_chan);
+		dev_err(dev, "failed to request mbox tx chan, ret %d\n", ret);
+		return ret;
+	}
+	ring->mbox_rx_chan = mbox_request_channel_byname(&ring->mbox_cl, "amp-rx");
+	if (IS_ERR(ring->mbox_rx_chan)) {
+		ret = PTR_ERR(ring->mbox_rx_chan);
+		dev_err(dev, "failed to request mbox rx chan, ret %d\n", ret);
+		goto free_tx_chan;
+	}
+
+	ring->miscdev.minor = MISC_DYNAMIC_MINOR;
+	ring->miscdev.name = devm_kasprintf(dev, GFP_KERNEL, "amp-%s", ring->name);
+	ring->miscdev.fops = &rk_amp_ring_fops;
+	ring->miscdev.parent = dev;
+	if (!ring->miscdev.name) {
+		ret = -ENOMEM;
+		goto free_rx_chan;
+	}
+
+	ret = misc_register(&ring->miscdev);
+	if (ret) {
+		dev_err(dev, "failed to register misc device, ret %d\n", ret);
+		goto free_rx_chan;
+	}
+
+	platform_set_drvdata(pdev, ring);
+
+	mutex_lock(&rk_amp_ring_list_lock);
+	list_add_tail(&ring->node, &rk_amp_ring_list);
+	mutex_unlock(&rk_amp_ring_list_lock);
+
+	dev_info(dev, "%s: %u slots of %u bytes per direction\n",
+		 ring->name, ring->slot_num, ring->slot_size);
+
+	return 0;
+
+free_rx_chan:
+	mbox_free_channel(ring->mbox_rx_chan);
+free_tx_chan:
+	mbox_free_channel(ring->mbox_tx_chan);
+	return ret;
+}
+
+static int rk_amp_ring_remove(struct platform_device *pdev)
+{
+	struct rk_amp_ring *ring = platform_get_drvdata(pdev);
+
+	mutex_lock(&rk_amp_ring_list_lock);
+	list_del(&ring->node);
+	mutex_unlock(&rk_amp_ring_list_lock);
+
+	misc_deregister(&ring->miscdev);
+	mbox_free_channel(ring->mbox_rx_chan);
+	mbox_free_channel(ring->mbox_tx_chan);
+
+	return 0;
+}
+
+static const struct of_device_id rk_amp_ring_match[] = {
+	{ .compatible = "rockchip,amp-ring" },
+	{ /* sentinel */ },
+};
+MODULE_DEVICE_TABLE(of, rk_amp_ring_match);
+
+static struct platform_driver rk_amp_ring_driver = {
+	.probe = rk_amp_ring_probe,
+	.remove = rk_amp_ring_remove,
+	.driver = {
+		.name = "rockchip-amp-ring",
+		.of_match_table = rk_amp_ring_match,
+		/*
+		 * An open file or a rk_amp_ring_get() user keeps using the ring,
+		 * only allow remove on module unload, which they pin.
+		 */
+		.suppress_bind_attrs = true,
+	},
+};
+module_platform_driver(rk_amp_ring_driver);
+
+MODULE_DESCRIPTION("Rockchip AMP shared memory message rings");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2023 Rockchip Electronics Co., Ltd
+ *
+ * Idle clock gating for media blocks. A block whose driver delays the
+ * power-off for a while after the last job keeps its clocks running (and
+ * burning dynamic power) for that whole delay. The driver asks the helper to
+ * gate the clocks as soon as it sees the block idle and to ungate them before
+ * touching the block again. Only clk_enable()/clk_disable() are used, so both
+ * calls are cheap and safe from atomic context.
+ */
+
+#include <linux/clk.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <soc/rockchip/rockchip_autogate.h>
+
+static bool autogate = true;
+module_param(autogate, bool, 0644);
+MODULE_PARM_DESC(autogate, "Gate media block clocks while the block is idle");
+
+void rockchip_autogate_init(struct rockchip_autogate *ag,
+			    struct clk_bulk_data *clks, int num_clks)
+{
+	spin_lock_init(&ag->lock);
+	ag->clks = clks;
+	ag->num_clks = num_clks;
+	ag->armed = false;
+	ag->gated = false;
+}
+EXPORT_SYMBOL_GPL(rockchip_autogate_init);
+
+/**
+ * rockchip_autogate_arm - allow gating once the clocks have been enabled
+ * @ag: the autogate
+ */
+void rockchip_autogate_arm(struct rockchip_autogate *ag)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ag->lock, flags);
+	ag->armed = ag->num_clks > 0;
+	ag->gated = false;
+	spin_unlock_irqrestore(&ag->lock, flags);
+}
+EXPORT_SYMBOL_GPL(rockchip_autogate_arm);
+
+/**
+ * rockchip_autogate_disarm - restore the clocks before the driver disables them
+ * @ag: the autogate
+ *
+ * Leaves the clocks enabled as the driver last left them, so that its own
+ * clk_bulk_disable_unprepare() stays balanced.
+ */
+void rockchip_autogate_disarm(struct rockchip_autogate *ag)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ag->lock, flags);
+	if (ag->gated && clk_bulk_enable(ag->num_clks, ag->clks))
+		pr_warn("autogate: failed to ungate clocks\n");
+	ag->gated = false;
+	ag->armed = false;
+	spin_unlock_irqrestore(&ag->lock, flags);
+}
+EXPORT_SYMBOL_GPL(rockchip_autogate_disarm);
+
+/**
+ * rockchip_autogate_gate - gate the clocks of an idle block
+ * @ag: the autogate
+ *
+ * The caller guarantees the block has no job in flight and that nobody
+ * accesses its registers until rockchip_autogate_ungate() is called.
+ */
+void rockchip_autogate_gate(struct rockchip_autogate *ag)
+{
+	unsigned long flags;
+
+	if (!READ_ONCE(autogate))
+		return;
+
+	spin_lock_irqsave(&ag->lock, flags);
+	if (ag->armed && !ag->gated) {
+		clk_bulk_disable(ag->num_clks, ag->clks);
+		ag->gated = true;
+	}
+	spin_unlock_irqrestore(&ag->lock, flags);
+}
+EXPORT_SYMBOL_GPL(rockchip_autogate_gate);
+
+/**
+ * rockchip_autogate_ungate - ungate the clocks before using the block
+ * @ag: the autogate
+ *
+ * Returns 0 on success or the clk_bulk_enable() error, in which case the
+ * clocks stay gated.
+ */
+int rockchip_autogate_ungate(struct rockchip_autogate *ag)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&ag->lock, flags);
+	if (ag->gated) {
+		ret = clk_bulk_enable(ag->num_clks, ag->clks);
+		if (!ret)
+			ag->gated = false;
+	}
+	spin_unlock_irqrestore(&ag->lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(rockchip_autogate_ungate);
+
+MODULE_DESCRIPTION("Rockchip media block idle clock gating");
+MODULE_LICENSE("GPL");
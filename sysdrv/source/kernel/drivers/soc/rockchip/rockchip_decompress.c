@@ -9,6 +9,7 @@
 #include <linux/kernel.h>
 #include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/of_device.h>
@@ -98,6 +99,31 @@ static bool g_decom_complete;
 static bool g_decom_noblocking;
 static u64 g_decom_data_len;
 
+/*
+ * The engine state above is global and rk_decom_wait_done() can't tell whose
+ * job completed, so every user holds this lock from rk_decom_start() until
+ * its rk_decom_wait_done() returns.
+ */
+static DEFINE_MUTEX(g_decom_lock);
+
+void rk_decom_lock(void)
+{
+	mutex_lock(&g_decom_lock);
+}
+EXPORT_SYMBOL(rk_decom_lock);
+
+int rk_decom_trylock(void)
+{
+	return mutex_trylock(&g_decom_lock);
+}
+EXPORT_SYMBOL(rk_decom_trylock);
+
+void rk_decom_unlock(void)
+{
+	mutex_unlock(&g_decom_lock);
+}
+EXPORT_SYMBOL(rk_decom_unlock);
+
 void __init wait_initrd_hw_decom_done(void)
 {
 	wait_event(g_decom_wait, g_decom_complete);
@@ -145,10 +171,7 @@ int rk_decom_start(u32 mode, phys_addr_t src, phys_addr_t dst, u32 dst_max_size)
 	if (ret)
 		return ret;
 
-	g_decom_complete   = false;
-	g_decom_data_len   = 0;
-	g_decom_noblocking = rk_get_noblocking_flag(mode);
-
+	/* a job is running, leave its state alone */
 	decom_enr = readl(g_decom->regs + DECOM_ENR);
 	if (decom_enr & 0x1) {
 		pr_err("decompress busy\n");
@@ -156,6 +179,10 @@ int rk_decom_start(u32 mode, phys_addr_t src, phys_addr_t dst, u32 dst_max_size)
 		goto error;
 	}
 
+	g_decom_complete   = false;
+	g_decom_data_len   = 0;
+	g_decom_noblocking = rk_get_noblocking_flag(mode);
+
 	if (g_decom->reset) {
 		reset_control_assert(g_decom->reset);
 		udelay(10);
@@ -16,25 +16,70 @@
 #include <linux/dma-mapping.h>
 #include <linux/fs.h>
 #include <linux/ioctl.h>
+#include <linux/kref.h>
+#include <linux/list.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/poll.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <linux/soc/rockchip/rockchip_decompress.h>
 #include <uapi/linux/rk-decom.h>
 
 #define RK_DECOME_TIMEOUT	3 /* 3 seconds */
+#define RK_DECOM_QUEUE_MAX	16 /* jobs in flight per file */
 
 struct rk_decom_dev {
 	struct miscdevice miscdev;
 	struct device *dev;
 	struct mutex mutex;
+
+	/* Submitted jobs, run one after the other by work */
+	spinlock_t lock;
+	struct list_head queue;
+	struct work_struct work;
+};
+
+/* Per open file, collects the finished jobs for read() */
+struct rk_decom_ctx {
+	struct rk_decom_dev *rk_decom;
+	struct kref kref;
+	spinlock_t lock;
+	struct list_head done;
+	unsigned int pending;
+	wait_queue_head_t wait;
+};
+
+struct rk_decom_bufs {
+	struct sg_table *sg_tbl_in, *sg_tbl_out;
+	struct dma_buf *dma_buf_in, *dma_buf_out;
+	struct dma_buf_attachment *dma_attach_in, *dma_attach_out;
+};
+
+struct rk_decom_work {
+	struct list_head node;
+	struct rk_decom_ctx *ctx;
+	struct rk_decom_job job;
+	struct rk_decom_bufs bufs;
 };
 
 static long rk_decom_misc_ioctl(struct file *fptr, unsigned int cmd, unsigned long arg);
+static int rk_decom_misc_open(struct inode *inode, struct file *fptr);
+static int rk_decom_misc_release(struct inode *inode, struct file *fptr);
+static ssize_t rk_decom_misc_read(struct file *fptr, char __user *buf,
+				  size_t count, loff_t *ppos);
+static __poll_t rk_decom_misc_poll(struct file *fptr, poll_table *wait);
 
 static const struct file_operations rk_decom_fops = {
 	.owner           = THIS_MODULE,
+	.open            = rk_decom_misc_open,
+	.release         = rk_decom_misc_release,
+	.read            = rk_decom_misc_read,
+	.poll            = rk_decom_misc_poll,
 	.unlocked_ioctl  = rk_decom_misc_ioctl,
 };
 
@@ -137,12 +182,26 @@ static int put_dmafd_sgtbl(struct device *dev, int dma_fd, enum dma_data_directi
 	return 0;
 }
 
-static int rk_decom_for_user(struct device *dev, struct rk_decom_param *param)
+static void rk_decom_unmap(struct device *dev, struct rk_decom_param *param,
+			   struct rk_decom_bufs *bufs)
+{
+	if (bufs->sg_tbl_in && bufs->dma_buf_in && bufs->dma_attach_in)
+		put_dmafd_sgtbl(dev, param->src_fd, DMA_TO_DEVICE,
+				bufs->sg_tbl_in, bufs->dma_attach_in, bufs->dma_buf_in);
+
+	if (bufs->sg_tbl_out && bufs->dma_buf_out && bufs->dma_attach_out)
+		put_dmafd_sgtbl(dev, param->dst_fd, DMA_FROM_DEVICE,
+				bufs->sg_tbl_out, bufs->dma_attach_out, bufs->dma_buf_out);
+
+	memset(bufs, 0, sizeof(*bufs));
+}
+
+static int rk_decom_map(struct device *dev, struct rk_decom_param *param,
+			struct rk_decom_bufs *bufs)
 {
 	int ret;
-	struct sg_table *sg_tbl_in = NULL, *sg_tbl_out = NULL;
-	struct dma_buf *dma_buf_in = NULL, *dma_buf_out = NULL;
-	struct dma_buf_attachment *dma_attach_in = NULL, *dma_attach_out = NULL;
+
+	memset(bufs, 0, sizeof(*bufs));
 
 	if (param->mode != RK_GZIP_MOD && param->mode != RK_ZLIB_MOD) {
 		dev_err(dev, "unsupported mode %u for decompress.\n", param->mode);
@@ -150,60 +209,185 @@ static int rk_decom_for_user(struct device *dev, struct rk_decom_param *param)
 	}
 
 	ret = get_dmafd_sgtbl(dev, param->src_fd, DMA_TO_DEVICE,
-			      &sg_tbl_in, &dma_attach_in, &dma_buf_in);
+			      &bufs->sg_tbl_in, &bufs->dma_attach_in, &bufs->dma_buf_in);
 	if (unlikely(ret)) {
 		dev_err(dev, "src_fd[%d] get_dmafd_sgtbl error.", (int)param->src_fd);
-		goto exit;
+		goto error;
 	}
 
 	ret = get_dmafd_sgtbl(dev, param->dst_fd, DMA_FROM_DEVICE,
-			      &sg_tbl_out, &dma_attach_out, &dma_buf_out);
+			      &bufs->sg_tbl_out, &bufs->dma_attach_out, &bufs->dma_buf_out);
 	if (unlikely(ret)) {
 		dev_err(dev, "dst_fd[%d] get_dmafd_sgtbl error.", (int)param->dst_fd);
-		goto exit;
+		goto error;
 	}
 
-	if (!check_scatter_list(0, sg_tbl_in)) {
+	if (!check_scatter_list(0, bufs->sg_tbl_in)) {
 		dev_err(dev, "Input dma_fd not a continuous buffer.\n");
 		ret = -EINVAL;
-		goto exit;
+		goto error;
 	}
 
-	if (!check_scatter_list(param->dst_max_size, sg_tbl_out)) {
+	if (!check_scatter_list(param->dst_max_size, bufs->sg_tbl_out)) {
 		dev_err(dev, "Output dma_fd not a continuous buffer or dst_max_size too big.\n");
 		ret = -EINVAL;
-		goto exit;
+		goto error;
 	}
 
-	ret = rk_decom_start(param->mode | DECOM_NOBLOCKING, sg_dma_address(sg_tbl_in->sgl),
-			     sg_dma_address(sg_tbl_out->sgl), param->dst_max_size);
+	return 0;
+error:
+	rk_decom_unmap(dev, param, bufs);
+
+	return ret;
+}
+
+/* The engine runs one job at a time, shared with the in-kernel users */
+static int rk_decom_run(struct device *dev, struct rk_decom_param *param,
+			struct rk_decom_bufs *bufs)
+{
+	int ret;
+
+	rk_decom_lock();
+
+	ret = rk_decom_start(param->mode | DECOM_NOBLOCKING,
+			     sg_dma_address(bufs->sg_tbl_in->sgl),
+			     sg_dma_address(bufs->sg_tbl_out->sgl), param->dst_max_size);
 
 	if (ret) {
 		dev_err(dev, "rk_decom_start failed[%d].", ret);
-		goto exit;
+		goto out;
 	}
 
 	ret = rk_decom_wait_done(RK_DECOME_TIMEOUT, &param->decom_data_len);
+out:
+	rk_decom_unlock();
 
-exit:
-	if (sg_tbl_in && dma_buf_in && dma_attach_in)
-		put_dmafd_sgtbl(dev, param->src_fd, DMA_TO_DEVICE,
-				sg_tbl_in, dma_attach_in, dma_buf_in);
+	return ret;
+}
 
-	if (sg_tbl_out && dma_buf_out && dma_attach_out)
-		put_dmafd_sgtbl(dev, param->dst_fd, DMA_FROM_DEVICE,
-				sg_tbl_out, dma_attach_out, dma_buf_out);
+static int rk_decom_for_user(struct device *dev, struct rk_decom_param *param)
+{
+	struct rk_decom_bufs bufs;
+	int ret;
+
+	ret = rk_decom_map(dev, param, &bufs);
+	if (ret)
+		return ret;
+
+	ret = rk_decom_run(dev, param, &bufs);
+	rk_decom_unmap(dev, param, &bufs);
+
+	return ret;
+}
+
+static void rk_decom_ctx_release(struct kref *kref)
+{
+	struct rk_decom_ctx *ctx = container_of(kref, struct rk_decom_ctx, kref);
+	struct rk_decom_work *w, *tmp;
+
+	list_for_each_entry_safe(w, tmp, &ctx->done, node) {
+		list_del(&w->node);
+		kfree(w);
+	}
+
+	kfree(ctx);
+}
+
+/*
+ * Run the queued jobs back to back. The buffers were mapped at submit time,
+ * so the engine is restarted as soon as the previous job completes.
+ */
+static void rk_decom_work_fn(struct work_struct *work)
+{
+	struct rk_decom_dev *rk_decom = container_of(work, struct rk_decom_dev, work);
+	struct rk_decom_ctx *ctx;
+	struct rk_decom_work *w;
+	unsigned long flags;
+
+	for (;;) {
+		spin_lock_irqsave(&rk_decom->lock, flags);
+		w = list_first_entry_or_null(&rk_decom->queue, struct rk_decom_work, node);
+		if (w)
+			list_del(&w->node);
+		spin_unlock_irqrestore(&rk_decom->lock, flags);
+
+		if (!w)
+			break;
+
+		w->job.ret = rk_decom_run(rk_decom->dev, &w->job.param, &w->bufs);
+
+		rk_decom_unmap(rk_decom->dev, &w->job.param, &w->bufs);
+
+		ctx = w->ctx;
+		spin_lock_irqsave(&ctx->lock, flags);
+		list_add_tail(&w->node, &ctx->done);
+		spin_unlock_irqrestore(&ctx->lock, flags);
+		wake_up_interruptible(&ctx->wait);
+
+		kref_put(&ctx->kref, rk_decom_ctx_release);
+	}
+}
+
+static int rk_decom_submit(struct rk_decom_ctx *ctx, struct rk_decom_job __user *arg)
+{
+	struct rk_decom_dev *rk_decom = ctx->rk_decom;
+	struct rk_decom_work *w;
+	unsigned long flags;
+	int ret;
+
+	w = kzalloc(sizeof(*w), GFP_KERNEL);
+	if (!w)
+		return -ENOMEM;
+
+	if (copy_from_user(&w->job, arg, sizeof(w->job))) {
+		ret = -EFAULT;
+		goto error;
+	}
+
+	spin_lock_irqsave(&ctx->lock, flags);
+	if (ctx->pending >= RK_DECOM_QUEUE_MAX) {
+		spin_unlock_irqrestore(&ctx->lock, flags);
+		ret = -EBUSY;
+		goto error;
+	}
+	ctx->pending++;
+	spin_unlock_irqrestore(&ctx->lock, flags);
+
+	ret = rk_decom_map(rk_decom->dev, &w->job.param, &w->bufs);
+	if (ret) {
+		spin_lock_irqsave(&ctx->lock, flags);
+		ctx->pending--;
+		spin_unlock_irqrestore(&ctx->lock, flags);
+		goto error;
+	}
+
+	w->job.ret = 0;
+	w->job.param.decom_data_len = 0;
+	w->ctx = ctx;
+	kref_get(&ctx->kref);
+
+	spin_lock_irqsave(&rk_decom->lock, flags);
+	list_add_tail(&w->node, &rk_decom->queue);
+	spin_unlock_irqrestore(&rk_decom->lock, flags);
+
+	queue_work(system_unbound_wq, &rk_decom->work);
+
+	return 0;
+error:
+	kfree(w);
 
 	return ret;
 }
 
 static long rk_decom_misc_ioctl(struct file *fptr, unsigned int cmd, unsigned long arg)
 {
+	struct rk_decom_ctx *ctx = fptr->private_data;
 	struct rk_decom_param param;
-	struct rk_decom_dev *rk_decom = NULL;
+	struct rk_decom_dev *rk_decom = ctx->rk_decom;
 	int ret = -EINVAL;
 
-	rk_decom = container_of(fptr->private_data, struct rk_decom_dev, miscdev);
+	if (cmd == RK_DECOM_SUBMIT)
+		return rk_decom_submit(ctx, (struct rk_decom_job __user *)arg);
 
 	mutex_lock(&rk_decom->mutex);
 
@@ -238,6 +422,95 @@ exit:
 	return ret;
 }
 
+static int rk_decom_misc_open(struct inode *inode, struct file *fptr)
+{
+	struct rk_decom_ctx *ctx;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	/* misc_open() left the miscdevice in private_data */
+	ctx->rk_decom = container_of(fptr->private_data, struct rk_decom_dev, miscdev);
+	kref_init(&ctx->kref);
+	spin_lock_init(&ctx->lock);
+	INIT_LIST_HEAD(&ctx->done);
+	init_waitqueue_head(&ctx->wait);
+
+	fptr->private_data = ctx;
+
+	return 0;
+}
+
+/* Jobs still queued keep the context alive and are dropped once done */
+static int rk_decom_misc_release(struct inode *inode, struct file *fptr)
+{
+	struct rk_decom_ctx *ctx = fptr->private_data;
+
+	kref_put(&ctx->kref, rk_decom_ctx_release);
+
+	return 0;
+}
+
+static ssize_t rk_decom_misc_read(struct file *fptr, char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	struct rk_decom_ctx *ctx = fptr->private_data;
+	struct rk_decom_work *w;
+	unsigned long flags;
+	ssize_t done = 0;
+	int ret;
+
+	if (count < sizeof(struct rk_decom_job))
+		return -EINVAL;
+
+	while (count - done >= sizeof(struct rk_decom_job)) {
+		spin_lock_irqsave(&ctx->lock, flags);
+		w = list_first_entry_or_null(&ctx->done, struct rk_decom_work, node);
+		if (w) {
+			list_del(&w->node);
+			ctx->pending--;
+		}
+		spin_unlock_irqrestore(&ctx->lock, flags);
+
+		if (!w) {
+			if (done || (fptr->f_flags & O_NONBLOCK))
+				break;
+
+			ret = wait_event_interruptible(ctx->wait,
+						       !list_empty(&ctx->done));
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		ret = copy_to_user(buf + done, &w->job, sizeof(w->job));
+		kfree(w);
+		if (ret)
+			return -EFAULT;
+
+		done += sizeof(struct rk_decom_job);
+	}
+
+	return done ? done : -EAGAIN;
+}
+
+static __poll_t rk_decom_misc_poll(struct file *fptr, poll_table *wait)
+{
+	struct rk_decom_ctx *ctx = fptr->private_data;
+	__poll_t mask = 0;
+	unsigned long flags;
+
+	poll_wait(fptr, &ctx->wait, wait);
+
+	spin_lock_irqsave(&ctx->lock, flags);
+	if (!list_empty(&ctx->done))
+		mask |= EPOLLIN | EPOLLRDNORM;
+	spin_unlock_irqrestore(&ctx->lock, flags);
+
+	return mask;
+}
+
 static int __init rk_decom_misc_init(void)
 {
 	int ret;
@@ -262,6 +535,9 @@ static int __init rk_decom_misc_init(void)
 	}
 
 	mutex_init(&rk_decom->mutex);
+	spin_lock_init(&rk_decom->lock);
+	INIT_LIST_HEAD(&rk_decom->queue);
+	INIT_WORK(&rk_decom->work, rk_decom_work_fn);
 
 	dev_info(rk_decom->dev, "misc device %s register success.\n", RK_DECOM_NAME);
 
@@ -276,6 +552,7 @@ error:
 static void __exit rk_decom_misc_exit(void)
 {
 	misc_deregister(&g_rk_decom.miscdev);
+	flush_work(&g_rk_decom.work);
 }
 
 module_init(rk_decom_misc_init)
@@ -2,12 +2,16 @@
 /*
  * Copyright (c) 2018 Fuzhou Rockchip Electronics Co., Ltd
  */
+#include <linux/clk.h>
 #include <linux/kernel.h>
 #include <linux/of.h>
 #include <linux/module.h>
+#include <linux/pm_opp.h>
+#include <linux/pm_runtime.h>
 #include <linux/slab.h>
 #include <linux/thermal.h>
 #include <soc/rockchip/rockchip_ipa.h>
+#include <soc/rockchip/rockchip_ipa_cooling.h>
 #include <soc/rockchip/rockchip_opp_select.h>
 #include <trace/events/thermal.h>
 
@@ -227,6 +231,264 @@ rockchip_ipa_get_static_power(struct ipa_power_model_data *data,
 }
 EXPORT_SYMBOL(rockchip_ipa_get_static_power);
 
+/*
+ * Power aware cooling device for blocks that scale a clock along their OPP
+ * table without a devfreq device, like the video encoder. Each cooling state
+ * caps the clock at one OPP, so that the power allocator can trade them
+ * against the CPU and NPU by the weights in the thermal zone.
+ */
+struct rockchip_ipa_cooling {
+	struct device *dev;
+	struct clk *clk;
+	struct ipa_power_model_data *model_data;
+	u32 dyn_power_coeff;
+	unsigned long *freq_table;
+	unsigned long *volt_table;
+	unsigned int num_states;
+	unsigned long cur_state;
+};
+
+static u32 rockchip_ipa_cooling_dyn_power(struct rockchip_ipa_cooling *ipa,
+					  unsigned long state)
+{
+	u64 power;
+
+	/* mW = coeff * MHz * mV^2 / 10^9 */
+	power = (u64)ipa->dyn_power_coeff * (ipa->freq_table[state] / 1000000) *
+		ipa->volt_table[state] * ipa->volt_table[state];
+
+	return div_u64(power, 1000000000);
+}
+
+static u32 rockchip_ipa_cooling_static_power(struct rockchip_ipa_cooling *ipa,
+					     unsigned long state)
+{
+	if (!ipa->model_data)
+		return 0;
+
+	return rockchip_ipa_get_static_power(ipa->model_data,
+					     ipa->volt_table[state]);
+}
+
+static int rockchip_ipa_cooling_get_max_state(struct thermal_cooling_device *cdev,
+					      unsigned long *state)
+{
+	struct rockchip_ipa_cooling *ipa = cdev->devdata;
+
+	*state = ipa->num_states - 1;
+
+	return 0;
+}
+
+static int rockchip_ipa_cooling_get_cur_state(struct thermal_cooling_device *cdev,
+					      unsigned long *state)
+{
+	struct rockchip_ipa_cooling *ipa = cdev->devdata;
+
+	*state = ipa->cur_state;
+
+	return 0;
+}
+
+static int rockchip_ipa_cooling_set_cur_state(struct thermal_cooling_device *cdev,
+					      unsigned long state)
+{
+	struct rockchip_ipa_cooling *ipa = cdev->devdata;
+	int ret;
+
+	if (state >= ipa->num_states)
+		return -EINVAL;
+
+	if (state == ipa->cur_state)
+		return 0;
+
+	ret = clk_set_max_rate(ipa->clk, ipa->freq_table[state]);
+	if (ret)
+		return ret;
+
+	ipa->cur_state = state;
+
+	return 0;
+}
+
+static int rockchip_ipa_cooling_get_requested_power(struct thermal_cooling_device *cdev,
+						    u32 *power)
+{
+	struct rockchip_ipa_cooling *ipa = cdev->devdata;
+	unsigned long rate = clk_get_rate(ipa->clk);
+	unsigned long state;
+
+	for (state = 0; state < ipa->num_states - 1; state++) {
+		if (ipa->freq_table[state] <= rate)
+			break;
+	}
+
+	/* There is no load tracking, an active block is assumed busy */
+	*power = rockchip_ipa_cooling_static_power(ipa, state);
+	if (pm_runtime_active(ipa->dev))
+		*power += rockchip_ipa_cooling_dyn_power(ipa, state);
+
+	return 0;
+}
+
+static int rockchip_ipa_cooling_state2power(struct thermal_cooling_device *cdev,
+					    unsigned long state, u32 *power)
+{
+	struct rockchip_ipa_cooling *ipa = cdev->devdata;
+
+	if (state >= ipa->num_states)
+		return -EINVAL;
+
+	*power = rockchip_ipa_cooling_dyn_power(ipa, state) +
+		 rockchip_ipa_cooling_static_power(ipa, state);
+
+	return 0;
+}
+
+static int rockchip_ipa_cooling_power2state(struct thermal_cooling_device *cdev,
+					    u32 power, unsigned long *state)
+{
+	struct rockchip_ipa_cooling *ipa = cdev->devdata;
+	unsigned long i;
+
+	for (i = 0; i < ipa->num_states - 1; i++) {
+		if (rockchip_ipa_cooling_dyn_power(ipa, i) +
+		    rockchip_ipa_cooling_static_power(ipa, i) <= power)
+			break;
+	}
+	*state = i;
+
+	return 0;
+}
+
+static const struct thermal_cooling_device_ops rockchip_ipa_cooling_ops = {
+	.get_max_state = rockchip_ipa_cooling_get_max_state,
+	.get_cur_state = rockchip_ipa_cooling_get_cur_state,
+	.set_cur_state = rockchip_ipa_cooling_set_cur_state,
+	.get_requested_power = rockchip_ipa_cooling_get_requested_power,
+	.state2power = rockchip_ipa_cooling_state2power,
+	.power2state = rockchip_ipa_cooling_power2state,
+};
+
+static int rockchip_ipa_cooling_init_tables(struct rockchip_ipa_cooling *ipa)
+{
+	struct dev_pm_opp *opp;
+	unsigned long freq = ULONG_MAX;
+	int i, count;
+
+	count = dev_pm_opp_get_opp_count(ipa->dev);
+	if (count <= 0)
+		return count ? count : -ENODATA;
+
+	ipa->freq_table = kcalloc(count, sizeof(*ipa->freq_table), GFP_KERNEL);
+	ipa->volt_table = kcalloc(count, sizeof(*ipa->volt_table), GFP_KERNEL);
+	if (!ipa->freq_table || !ipa->volt_table)
+		return -ENOMEM;
+
+	/* State 0 is the highest OPP */
+	for (i = 0; i < count; i++, freq--) {
+		opp = dev_pm_opp_find_freq_floor(ipa->dev, &freq);
+		if (IS_ERR(opp))
+			return PTR_ERR(opp);
+
+		ipa->freq_table[i] = freq;
+		ipa->volt_table[i] = dev_pm_opp_get_voltage(opp) / 1000;
+		dev_pm_opp_put(opp);
+	}
+	ipa->num_states = count;
+
+	return 0;
+}
+
+static void rockchip_ipa_cooling_free(struct rockchip_ipa_cooling *ipa)
+{
+	kfree(ipa->freq_table);
+	kfree(ipa->volt_table);
+	kfree(ipa->model_data);
+	kfree(ipa);
+}
+
+/**
+ * rockchip_ipa_cooling_register() - register a power aware cooling device
+ * @dev:	device with an OPP table, its node is the cooling device node
+ * @clk:	clock scaled along the OPP table
+ * @lkg_name:	nvmem cell name of the leakage, for the static power model
+ *
+ * The dynamic power comes from "dynamic-power-coefficient" in the node of
+ * @dev, or from the simple-power-model child which also gives the static
+ * power, as for the NPU and GPU.
+ *
+ * Return: the cooling device, or a corresponding ERR_PTR() on failure.
+ */
+struct thermal_cooling_device *
+rockchip_ipa_cooling_register(struct device *dev, struct clk *clk,
+			      char *lkg_name)
+{
+	struct thermal_cooling_device *cdev;
+	struct rockchip_ipa_cooling *ipa;
+	int ret;
+
+	if (!clk)
+		return ERR_PTR(-EINVAL);
+
+	ipa = kzalloc(sizeof(*ipa), GFP_KERNEL);
+	if (!ipa)
+		return ERR_PTR(-ENOMEM);
+
+	ipa->dev = dev;
+	ipa->clk = clk;
+
+	ret = rockchip_ipa_cooling_init_tables(ipa);
+	if (ret)
+		goto err;
+
+	of_property_read_u32(dev->of_node, "dynamic-power-coefficient",
+			     &ipa->dyn_power_coeff);
+	ipa->model_data = rockchip_ipa_power_model_init(dev, lkg_name);
+	if (IS_ERR(ipa->model_data)) {
+		ret = PTR_ERR(ipa->model_data);
+		ipa->model_data = NULL;
+		if (ret == -EPROBE_DEFER)
+			goto err;
+	} else if (ipa->model_data->dynamic_coefficient) {
+		ipa->dyn_power_coeff = ipa->model_data->dynamic_coefficient;
+	}
+	if (!ipa->dyn_power_coeff) {
+		dev_err(dev, "failed to get dynamic-coefficient\n");
+		ret = -EINVAL;
+		goto err;
+	}
+
+	cdev = thermal_of_cooling_device_register(dev->of_node,
+						  (char *)dev_name(dev), ipa,
+						  &rockchip_ipa_cooling_ops);
+	if (IS_ERR(cdev)) {
+		ret = PTR_ERR(cdev);
+		goto err;
+	}
+
+	return cdev;
+err:
+	rockchip_ipa_cooling_free(ipa);
+
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL(rockchip_ipa_cooling_register);
+
+void rockchip_ipa_cooling_unregister(struct thermal_cooling_device *cdev)
+{
+	struct rockchip_ipa_cooling *ipa;
+
+	if (IS_ERR_OR_NULL(cdev))
+		return;
+
+	ipa = cdev->devdata;
+	thermal_cooling_device_unregister(cdev);
+	clk_set_max_rate(ipa->clk, ULONG_MAX);
+	rockchip_ipa_cooling_free(ipa);
+}
+EXPORT_SYMBOL(rockchip_ipa_cooling_unregister);
+
 MODULE_DESCRIPTION("Rockchip IPA driver");
 MODULE_AUTHOR("Finley Xiao <finley.xiao@rock-chips.com>");
 MODULE_LICENSE("GPL");
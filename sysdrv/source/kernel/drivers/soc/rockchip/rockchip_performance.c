@@ -3,8 +3,10 @@
  * Copyright (C) 2022 Rockchip Electronics Co., Ltd.
  */
 #include <linux/kernel.h>
+#include <linux/pid.h>
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
+#include <linux/slab.h>
 #include <soc/rockchip/rockchip_performance.h>
 #include <../../kernel/sched/sched.h>
 
@@ -95,6 +97,250 @@ static const struct kernel_param_ops level_param_ops = {
 };
 module_param_cb(level, &level_param_ops, &perf_level, 0644);
 
+/*
+ * Per-task profiles
+ *
+ * A profile is a named uclamp range plus a cpu mask. Latency critical media
+ * threads (ISP/VENC irq threads, mpp workers, the RTSP sender) can get their
+ * own profile while background threads stay on a cheap one:
+ *
+ *   echo "venc 512 1024 4-7" > /sys/module/rockchip_performance/parameters/profile
+ *   echo "1234 venc" > /sys/module/rockchip_performance/parameters/task
+ *
+ * An empty cpu list keeps the task affinity untouched. Writing "<pid>" alone
+ * to the task parameter forgets the binding, the task keeps its settings.
+ * Updating a profile reapplies it to the tasks still bound to it.
+ */
+#define PERF_PROFILE_MAX	8
+#define PERF_PROFILE_NAME_LEN	16
+
+struct perf_profile {
+	char name[PERF_PROFILE_NAME_LEN];
+	unsigned int uclamp_min;
+	unsigned int uclamp_max;
+	cpumask_t cpus;
+};
+
+struct perf_task {
+	struct list_head node;
+	struct pid *pid;
+	struct perf_profile *profile;
+};
+
+static struct perf_profile perf_profiles[PERF_PROFILE_MAX];
+static LIST_HEAD(perf_tasks);
+static DEFINE_MUTEX(profile_mutex);
+
+static struct perf_profile *perf_profile_find_locked(const char *name)
+{
+	int i;
+
+	for (i = 0; i < PERF_PROFILE_MAX; i++) {
+		if (perf_profiles[i].name[0] &&
+		    !strcmp(perf_profiles[i].name, name))
+			return &perf_profiles[i];
+	}
+
+	return NULL;
+}
+
+static int perf_profile_apply(struct pid *pid, struct perf_profile *profile)
+{
+	struct task_struct *p;
+	int ret = 0;
+
+	p = get_pid_task(pid, PIDTYPE_PID);
+	if (!p)
+		return -ESRCH;
+
+#ifdef CONFIG_UCLAMP_TASK
+	{
+		struct sched_attr attr = {
+			.sched_flags = SCHED_FLAG_KEEP_ALL | SCHED_FLAG_UTIL_CLAMP,
+			.sched_util_min = profile->uclamp_min,
+			.sched_util_max = profile->uclamp_max,
+		};
+
+		ret = sched_setattr_nocheck(p, &attr);
+	}
+#endif
+	if (!ret && !cpumask_empty(&profile->cpus))
+		ret = set_cpus_allowed_ptr(p, &profile->cpus);
+
+	put_task_struct(p);
+
+	return ret;
+}
+
+/* Forget bindings to tasks that have exited */
+static void perf_task_prune_locked(void)
+{
+	struct perf_task *t, *tmp;
+
+	list_for_each_entry_safe(t, tmp, &perf_tasks, node) {
+		if (pid_has_task(t->pid, PIDTYPE_PID))
+			continue;
+		list_del(&t->node);
+		put_pid(t->pid);
+		kfree(t);
+	}
+}
+
+static int param_set_profile(const char *buf, const struct kernel_param *kp)
+{
+	char name[PERF_PROFILE_NAME_LEN];
+	char cpus[64] = "";
+	struct perf_profile *profile;
+	struct perf_task *t;
+	unsigned int min, max;
+	cpumask_t mask;
+	int i, ret;
+
+	ret = sscanf(buf, "%15s %u %u %63s", name, &min, &max, cpus);
+	if (ret < 3 || min > max || max > SCHED_CAPACITY_SCALE)
+		return -EINVAL;
+
+	if (cpulist_parse(cpus, &mask))
+		return -EINVAL;
+	if (!cpumask_empty(&mask) && !cpumask_subset(&mask, cpu_possible_mask))
+		return -EINVAL;
+
+	mutex_lock(&profile_mutex);
+	profile = perf_profile_find_locked(name);
+	for (i = 0; !profile && i < PERF_PROFILE_MAX; i++) {
+		if (!perf_profiles[i].name[0])
+			profile = &perf_profiles[i];
+	}
+	if (!profile) {
+		mutex_unlock(&profile_mutex);
+		return -ENOSPC;
+	}
+
+	strscpy(profile->name, name, sizeof(profile->name));
+	profile->uclamp_min = min;
+	profile->uclamp_max = max;
+	cpumask_copy(&profile->cpus, &mask);
+
+	perf_task_prune_locked();
+	list_for_each_entry(t, &perf_tasks, node) {
+		if (t->profile == profile)
+			perf_profile_apply(t->pid, profile);
+	}
+	mutex_unlock(&profile_mutex);
+
+	return 0;
+}
+
+static int param_get_profile(char *buf, const struct kernel_param *kp)
+{
+	struct perf_profile *profile;
+	int i, len = 0;
+
+	mutex_lock(&profile_mutex);
+	for (i = 0; i < PERF_PROFILE_MAX; i++) {
+		profile = &perf_profiles[i];
+		if (!profile->name[0])
+			continue;
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s %u %u %*pbl\n",
+				 profile->name, profile->uclamp_min,
+				 profile->uclamp_max,
+				 cpumask_pr_args(&profile->cpus));
+	}
+	mutex_unlock(&profile_mutex);
+
+	return len;
+}
+
+static const struct kernel_param_ops profile_param_ops = {
+	.set = param_set_profile,
+	.get = param_get_profile,
+};
+module_param_cb(profile, &profile_param_ops, NULL, 0644);
+
+static int param_set_task(const char *buf, const struct kernel_param *kp)
+{
+	char name[PERF_PROFILE_NAME_LEN] = "";
+	struct perf_profile *profile = NULL;
+	struct perf_task *t, *found = NULL;
+	struct pid *pid;
+	int nr, ret;
+
+	ret = sscanf(buf, "%d %15s", &nr, name);
+	if (ret < 1 || nr <= 0)
+		return -EINVAL;
+
+	pid = find_get_pid(nr);
+	if (!pid)
+		return -ESRCH;
+
+	mutex_lock(&profile_mutex);
+	perf_task_prune_locked();
+	list_for_each_entry(t, &perf_tasks, node) {
+		if (t->pid == pid) {
+			found = t;
+			break;
+		}
+	}
+
+	if (!name[0]) {
+		if (found) {
+			list_del(&found->node);
+			put_pid(found->pid);
+			kfree(found);
+		}
+		ret = 0;
+		goto out;
+	}
+
+	profile = perf_profile_find_locked(name);
+	if (!profile) {
+		ret = -ENOENT;
+		goto out;
+	}
+
+	ret = perf_profile_apply(pid, profile);
+	if (ret)
+		goto out;
+
+	if (!found) {
+		found = kzalloc(sizeof(*found), GFP_KERNEL);
+		if (!found) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		found->pid = get_pid(pid);
+		list_add_tail(&found->node, &perf_tasks);
+	}
+	found->profile = profile;
+
+out:
+	mutex_unlock(&profile_mutex);
+	put_pid(pid);
+
+	return ret;
+}
+
+static int param_get_task(char *buf, const struct kernel_param *kp)
+{
+	struct perf_task *t;
+	int len = 0;
+
+	mutex_lock(&profile_mutex);
+	perf_task_prune_locked();
+	list_for_each_entry(t, &perf_tasks, node)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%d %s\n",
+				 pid_nr(t->pid), t->profile->name);
+	mutex_unlock(&profile_mutex);
+
+	return len;
+}
+
+static const struct kernel_param_ops task_param_ops = {
+	.set = param_set_task,
+	.get = param_get_task,
+};
+module_param_cb(task, &task_param_ops, NULL, 0644);
+
 static __init int rockchip_perf_init(void)
 {
 	int cpu;
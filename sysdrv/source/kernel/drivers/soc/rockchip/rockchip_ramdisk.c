@@ -194,7 +194,11 @@ static long rd_dax_direct_access(struct dax_device *dax_dev, pgoff_t pgoff,
 	struct rd_device *rd = dax_get_private(dax_dev);
 
 	phys_addr_t offset = PFN_PHYS(pgoff);
-	size_t max_nr_pages = rd->mem_pages - pgoff;
+	size_t max_nr_pages;
+
+	if (pgoff >= rd->mem_pages)
+		return -ERANGE;
+	max_nr_pages = rd->mem_pages - pgoff;
 
 	if (kaddr)
 		*kaddr = rd->mem_kaddr + offset;
@@ -208,7 +212,8 @@ static bool rd_dax_supported(struct dax_device *dax_dev,
 			     struct block_device *bdev, int blocksize,
 			     sector_t start, sector_t sectors)
 {
-	return true;
+	/* DAX mappings are built from whole pages of the reserved memory */
+	return blocksize == PAGE_SIZE;
 }
 
 static size_t rd_dax_copy_from_iter(struct dax_device *dax_dev, pgoff_t pgoff,
@@ -244,10 +249,35 @@ static const struct dax_operations rd_dax_ops = {
 	.zero_page_range = rd_dax_zero_page_range,
 };
 
+/*
+ * The block I/O path needs a struct page for every page of the reserved
+ * memory, so a "no-map" region can't be used. DAX additionally needs the
+ * memory in the linear map, which highmem isn't.
+ */
+static int rd_check_mem(struct rd_device *rd)
+{
+	unsigned long pfn = PHYS_PFN(rd->mem_addr);
+	unsigned long last = PHYS_PFN(rd->mem_addr + rd->mem_size - 1);
+
+	if (!PAGE_ALIGNED(rd->mem_addr) || !PAGE_ALIGNED(rd->mem_size) ||
+	    !pfn_valid(pfn) || !pfn_valid(last))
+		return -EINVAL;
+
+	return !PageHighMem(pfn_to_page(last));
+}
+
 static int rd_init(struct rd_device *rd, int major, int minor)
 {
 	int ret;
 	struct gendisk *disk;
+	bool lowmem;
+
+	ret = rd_check_mem(rd);
+	if (ret < 0) {
+		dev_err(rd->dev, "memory must be page aligned and mapped\n");
+		return ret;
+	}
+	lowmem = ret;
 
 	rd->rd_queue = blk_alloc_queue(NUMA_NO_NODE);
 	if (!rd->rd_queue)
@@ -274,14 +304,19 @@ static int rd_init(struct rd_device *rd, int major, int minor)
 	set_capacity(disk, rd->mem_size >> SECTOR_SHIFT);
 	rd->rd_disk = disk;
 
-	rd->mem_kaddr = phys_to_virt(rd->mem_addr);
 	rd->mem_pages = PHYS_PFN(rd->mem_size);
-	rd->dax_dev = alloc_dax(rd, disk->disk_name, &rd_dax_ops, DAXDEV_F_SYNC);
-	if (IS_ERR(rd->dax_dev)) {
-		ret = PTR_ERR(rd->dax_dev);
-		dev_err(rd->dev, "alloc_dax failed %d\n", ret);
-		rd->dax_dev = NULL;
-		goto out_free_queue;
+	if (lowmem) {
+		rd->mem_kaddr = phys_to_virt(rd->mem_addr);
+		rd->dax_dev = alloc_dax(rd, disk->disk_name, &rd_dax_ops,
+					DAXDEV_F_SYNC);
+		if (IS_ERR(rd->dax_dev)) {
+			ret = PTR_ERR(rd->dax_dev);
+			dev_err(rd->dev, "alloc_dax failed %d\n", ret);
+			rd->dax_dev = NULL;
+			goto out_free_disk;
+		}
+	} else {
+		dev_info(rd->dev, "memory is in highmem, DAX disabled\n");
 	}
 
 	/* Tell the block layer that this is not a rotational device */
@@ -295,6 +330,8 @@ static int rd_init(struct rd_device *rd, int major, int minor)
 
 	return 0;
 
+out_free_disk:
+	put_disk(disk);
 out_free_queue:
 	blk_cleanup_queue(rd->rd_queue);
 	return ret;
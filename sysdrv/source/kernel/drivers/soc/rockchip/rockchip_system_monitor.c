@@ -32,6 +32,7 @@
 #include <linux/delay.h>
 #include <soc/rockchip/rockchip_opp_select.h>
 #include <soc/rockchip/rockchip_system_monitor.h>
+#include <soc/rockchip/rockchip_system_monitor_video.h>
 #include <soc/rockchip/rockchip-system-status.h>
 
 #include "../../gpu/drm/rockchip/ebc-dev/ebc_dev.h"
@@ -42,6 +43,7 @@
 #define CPU_REBOOT_FREQ		816000 /* kHz */
 #define VIDEO_1080P_SIZE	(1920 * 1080)
 #define THERMAL_POLLING_DELAY	200 /* milliseconds */
+#define VIDEO_DEFAULT_FRAMERATE	30
 
 struct video_info {
 	unsigned int width;
@@ -52,6 +54,22 @@ struct video_info {
 	struct list_head node;
 };
 
+/* Minimum frequency needed from a video load up */
+struct video_load_freq {
+	unsigned int load; /* Mpixel/s */
+	unsigned int freq; /* kHz */
+};
+
+struct monitor_load_info {
+	struct list_head node;
+	struct monitor_dev_info *info;
+	struct video_load_freq *table;
+	int count;
+	unsigned int min_freq;
+	struct freq_qos_request min_freq_req;
+	struct dev_pm_qos_request dev_min_freq_req;
+};
+
 struct system_monitor_attr {
 	struct attribute attr;
 	ssize_t (*show)(struct kobject *kobj, struct kobj_attribute *attr,
@@ -83,13 +101,16 @@ static unsigned long ref_count[32] = {0};
 
 static DEFINE_MUTEX(system_status_mutex);
 static DEFINE_MUTEX(video_info_mutex);
+static DEFINE_MUTEX(video_load_mutex);
 static DEFINE_MUTEX(cpu_on_off_mutex);
 
 static DECLARE_RWSEM(mdev_list_sem);
 
 static LIST_HEAD(video_info_list);
+static LIST_HEAD(monitor_load_list);
 static LIST_HEAD(monitor_dev_list);
 static struct system_monitor *system_monitor;
+static unsigned int video_load; /* Mpixel/s of all active video streams */
 static atomic_t monitor_in_suspend;
 
 static BLOCKING_NOTIFIER_HEAD(system_monitor_notifier_list);
@@ -293,15 +314,66 @@ static void rockchip_del_video_info(struct video_info *video_info)
 	}
 }
 
+static unsigned int rockchip_video_load_to_freq(struct monitor_load_info *mload,
+						unsigned int load)
+{
+	unsigned int freq = 0;
+	int i;
+
+	if (!load)
+		return 0;
+
+	for (i = 0; i < mload->count; i++) {
+		if (load >= mload->table[i].load)
+			freq = mload->table[i].freq;
+	}
+
+	return freq;
+}
+
+static void rockchip_video_load_set_freq(struct monitor_load_info *mload)
+{
+	unsigned int freq = rockchip_video_load_to_freq(mload, video_load);
+
+	if (freq == mload->min_freq)
+		return;
+	mload->min_freq = freq;
+
+	dev_dbg(mload->info->dev, "video load %u Mpixel/s, min freq %u kHz\n",
+		video_load, freq);
+	if (mload->info->devp->type == MONITOR_TPYE_CPU)
+		freq_qos_update_request(&mload->min_freq_req, freq);
+	else
+		dev_pm_qos_update_request(&mload->dev_min_freq_req, freq);
+}
+
+/*
+ * Devices with a rockchip,video-load-freq table get a minimum frequency that
+ * follows the pixel rate of the active streams, rather than the fixed rate of
+ * the SYS_STATUS_VIDEO_* profile they fall in.
+ */
+static void rockchip_update_video_load(unsigned int load)
+{
+	struct monitor_load_info *mload;
+
+	mutex_lock(&video_load_mutex);
+	video_load = load;
+	list_for_each_entry(mload, &monitor_load_list, node)
+		rockchip_video_load_set_freq(mload);
+	mutex_unlock(&video_load_mutex);
+}
+
 static void rockchip_update_video_info(void)
 {
 	struct video_info *video_info;
 	unsigned int max_res = 0, max_stream_bitrate = 0, res = 0;
 	unsigned int max_video_framerate = 0;
+	u64 load = 0;
 
 	mutex_lock(&video_info_mutex);
 	if (list_empty(&video_info_list)) {
 		mutex_unlock(&video_info_mutex);
+		rockchip_update_video_load(0);
 		rockchip_clear_system_status(SYS_STATUS_VIDEO);
 		return;
 	}
@@ -314,9 +386,13 @@ static void rockchip_update_video_info(void)
 			max_stream_bitrate = video_info->streamBitrate;
 		if (video_info->videoFramerate > max_video_framerate)
 			max_video_framerate = video_info->videoFramerate;
+		load += (u64)res * (video_info->videoFramerate ?:
+				    VIDEO_DEFAULT_FRAMERATE);
 	}
 	mutex_unlock(&video_info_mutex);
 
+	rockchip_update_video_load(DIV_ROUND_UP_ULL(load, 1000000));
+
 	if (max_res <= VIDEO_1080P_SIZE) {
 		rockchip_set_system_status(SYS_STATUS_VIDEO_1080P);
 	} else {
@@ -382,6 +458,57 @@ void rockchip_update_system_status(const char *buf)
 }
 EXPORT_SYMBOL(rockchip_update_system_status);
 
+/**
+ * rockchip_system_monitor_add_video - declare an active video stream
+ * @width: frame width in pixels
+ * @height: frame height in pixels
+ * @framerate: frames per second, 0 if unknown
+ * @ishevc: the stream is HEVC coded
+ *
+ * The in-kernel counterpart of writing "1,width=..." to system_status, for
+ * drivers that know what they are processing. Returns a handle to pass to
+ * rockchip_system_monitor_del_video(), or NULL.
+ */
+struct video_info *rockchip_system_monitor_add_video(unsigned int width,
+						     unsigned int height,
+						     unsigned int framerate,
+						     bool ishevc)
+{
+	struct video_info *video_info;
+
+	video_info = kzalloc(sizeof(*video_info), GFP_KERNEL);
+	if (!video_info)
+		return NULL;
+
+	INIT_LIST_HEAD(&video_info->node);
+	video_info->width = width;
+	video_info->height = height;
+	video_info->videoFramerate = framerate;
+	video_info->ishevc = ishevc;
+
+	rockchip_add_video_info(video_info);
+	rockchip_update_video_info();
+
+	return video_info;
+}
+EXPORT_SYMBOL(rockchip_system_monitor_add_video);
+
+void rockchip_system_monitor_del_video(struct video_info *video_info)
+{
+	if (!video_info)
+		return;
+
+	rockchip_del_video_info(video_info);
+	rockchip_update_video_info();
+}
+EXPORT_SYMBOL(rockchip_system_monitor_del_video);
+
+unsigned int rockchip_system_monitor_get_video_load(void)
+{
+	return READ_ONCE(video_load);
+}
+EXPORT_SYMBOL(rockchip_system_monitor_get_video_load);
+
 static ssize_t status_show(struct kobject *kobj, struct kobj_attribute *attr,
 			   char *buf)
 {
@@ -404,6 +531,25 @@ static ssize_t status_store(struct kobject *kobj, struct kobj_attribute *attr,
 static struct system_monitor_attr status =
 	__ATTR(system_status, 0644, status_show, status_store);
 
+static ssize_t video_load_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	struct monitor_load_info *mload;
+	ssize_t len;
+
+	mutex_lock(&video_load_mutex);
+	len = sprintf(buf, "load: %u Mpixel/s\n", video_load);
+	list_for_each_entry(mload, &monitor_load_list, node)
+		len += sprintf(buf + len, "%s: %u kHz\n",
+			       dev_name(mload->info->dev), mload->min_freq);
+	mutex_unlock(&video_load_mutex);
+
+	return len;
+}
+
+static struct system_monitor_attr video_load_attr =
+	__ATTR(video_load, 0444, video_load_show, NULL);
+
 static int rockchip_get_temp_freq_table(struct device_node *np,
 					char *porp_name,
 					struct temp_freq_table **freq_table)
@@ -744,6 +890,14 @@ static int monitor_device_parse_scmi_clk(struct device_node *np,
 	return -EINVAL;
 }
 
+static int monitor_device_parse_video_load(struct device_node *np,
+					   struct monitor_dev_info *info)
+{
+	if (of_find_property(np, "rockchip,video-load-freq", NULL))
+		return 0;
+	return -EINVAL;
+}
+
 static int monitor_device_parse_dt(struct device *dev,
 				   struct monitor_dev_info *info)
 {
@@ -761,6 +915,7 @@ static int monitor_device_parse_dt(struct device *dev,
 	ret &= monitor_device_parse_early_min_volt(np, info);
 	ret &= monitor_device_parse_read_margin(np, info);
 	ret &= monitor_device_parse_scmi_clk(np, info);
+	ret &= monitor_device_parse_video_load(np, info);
 
 	of_node_put(np);
 
@@ -1406,6 +1561,98 @@ unlock:
 }
 EXPORT_SYMBOL(rockchip_monitor_check_rate_volt);
 
+/*
+ * rockchip,video-load-freq = <load freq ...>, load in Mpixel/s sorted
+ * ascending, freq in kHz.
+ */
+static int rockchip_system_monitor_video_load_init(struct monitor_dev_info *info)
+{
+	struct monitor_load_info *mload;
+	struct device_node *np;
+	struct devfreq *devfreq;
+	struct cpufreq_policy *policy;
+	int count, ret;
+
+	if (!info->devp->data)
+		return 0;
+
+	np = of_parse_phandle(info->dev->of_node, "operating-points-v2", 0);
+	if (!np)
+		return 0;
+
+	count = of_property_count_u32_elems(np, "rockchip,video-load-freq");
+	if (count <= 0 || count % 2) {
+		of_node_put(np);
+		return 0;
+	}
+
+	mload = kzalloc(sizeof(*mload), GFP_KERNEL);
+	if (!mload)
+		goto err_put_node;
+	mload->table = kcalloc(count / 2, sizeof(*mload->table), GFP_KERNEL);
+	if (!mload->table)
+		goto err_free;
+	ret = of_property_read_u32_array(np, "rockchip,video-load-freq",
+					 (u32 *)mload->table, count);
+	if (ret)
+		goto err_free;
+	of_node_put(np);
+	mload->count = count / 2;
+	mload->info = info;
+
+	if (info->devp->type == MONITOR_TPYE_CPU) {
+		policy = (struct cpufreq_policy *)info->devp->data;
+		ret = freq_qos_add_request(&policy->constraints,
+					   &mload->min_freq_req, FREQ_QOS_MIN,
+					   FREQ_QOS_MIN_DEFAULT_VALUE);
+	} else {
+		devfreq = (struct devfreq *)info->devp->data;
+		ret = dev_pm_qos_add_request(devfreq->dev.parent,
+					     &mload->dev_min_freq_req,
+					     DEV_PM_QOS_MIN_FREQUENCY,
+					     PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+	}
+	if (ret < 0) {
+		dev_info(info->dev, "failed to add video load constraint\n");
+		kfree(mload->table);
+		kfree(mload);
+		return ret;
+	}
+
+	mutex_lock(&video_load_mutex);
+	list_add(&mload->node, &monitor_load_list);
+	rockchip_video_load_set_freq(mload);
+	mutex_unlock(&video_load_mutex);
+
+	return 0;
+
+err_free:
+	kfree(mload->table);
+	kfree(mload);
+err_put_node:
+	of_node_put(np);
+	return -ENOMEM;
+}
+
+static void rockchip_system_monitor_video_load_exit(struct monitor_dev_info *info)
+{
+	struct monitor_load_info *mload, *tmp;
+
+	mutex_lock(&video_load_mutex);
+	list_for_each_entry_safe(mload, tmp, &monitor_load_list, node) {
+		if (mload->info != info)
+			continue;
+		list_del(&mload->node);
+		if (info->devp->type == MONITOR_TPYE_CPU)
+			freq_qos_remove_request(&mload->min_freq_req);
+		else
+			dev_pm_qos_remove_request(&mload->dev_min_freq_req);
+		kfree(mload->table);
+		kfree(mload);
+	}
+	mutex_unlock(&video_load_mutex);
+}
+
 struct monitor_dev_info *
 rockchip_system_monitor_register(struct device *dev,
 				 struct monitor_dev_profile *devp)
@@ -1440,6 +1687,7 @@ rockchip_system_monitor_register(struct device *dev,
 	rockchip_monitor_check_rate_volt(info);
 	devp->is_checked = true;
 	rockchip_system_monitor_freq_qos_requset(info);
+	rockchip_system_monitor_video_load_init(info);
 
 	down_write(&mdev_list_sem);
 	list_add(&info->node, &monitor_dev_list);
@@ -1458,6 +1706,8 @@ void rockchip_system_monitor_unregister(struct monitor_dev_info *info)
 	list_del(&info->node);
 	up_write(&mdev_list_sem);
 
+	rockchip_system_monitor_video_load_exit(info);
+
 	if (info->devp->type == MONITOR_TPYE_CPU) {
 		if (freq_qos_request_active(&info->max_temp_freq_req))
 			freq_qos_remove_request(&info->max_temp_freq_req);
@@ -1875,6 +2125,8 @@ static int rockchip_system_monitor_probe(struct platform_device *pdev)
 		return -ENOMEM;
 	if (sysfs_create_file(system_monitor->kobj, &status.attr))
 		dev_err(dev, "failed to create system status sysfs\n");
+	if (sysfs_create_file(system_monitor->kobj, &video_load_attr.attr))
+		dev_err(dev, "failed to create video load sysfs\n");
 
 	cpumask_clear(&system_monitor->status_offline_cpus);
 	cpumask_clear(&system_monitor->offline_cpus);
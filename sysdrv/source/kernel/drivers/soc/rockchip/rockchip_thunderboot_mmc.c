@@ -14,6 +14,7 @@
 #include <linux/platform_device.h>
 #include <linux/soc/rockchip/rockchip_decompress.h>
 #include <linux/soc/rockchip/rockchip_thunderboot_crypto.h>
+#include <linux/soc/rockchip/rockchip_thunderboot_preload.h>
 
 #define SDMMC_RINTSTS		0x044
 #define SDMMC_STATUS		0x048
@@ -36,6 +37,7 @@ static int rk_tb_mmc_thread(void *p)
 	regs = ioremap(res->start, resource_size(res));
 	if (!regs) {
 		dev_err(dev, "ioremap failed for resource %pR\n", res);
+		rk_tb_preload_storage_done(dev->of_node, -ENOMEM);
 		return -ENOMEM;
 	}
 
@@ -48,10 +50,12 @@ static int rk_tb_mmc_thread(void *p)
 		ret = clk_bulk_prepare_enable(clk_num, clk_bulks);
 		if (ret) {
 			dev_err(&pdev->dev, "failed to enable clocks\n");
+			rk_tb_preload_storage_done(dev->of_node, ret);
 			return ret;
 		}
 	} else {
 		dev_err(&pdev->dev, "failed to get clks property\\n");
+		rk_tb_preload_storage_done(dev->of_node, clk_num);
 		return clk_num;
 	}
 
@@ -68,6 +72,7 @@ static int rk_tb_mmc_thread(void *p)
 	status = readl_relaxed(regs + SDMMC_RINTSTS);
 	if (status & SDMMC_INTR_ERROR) {
 		dev_err(dev, "SDMMC_INTR_ERROR status: 0x%08x\n", status);
+		rk_tb_preload_storage_done(dev->of_node, -EIO);
 		goto out;
 	}
 
@@ -98,6 +103,9 @@ static int rk_tb_mmc_thread(void *p)
 		}
 	}
 
+	/* The ramdisk is started, preloaded images may use the decompressor */
+	rk_tb_preload_storage_done(dev->of_node, 0);
+
 	/* Release idmac descriptor */
 	if (dma) {
 		struct resource idmac;
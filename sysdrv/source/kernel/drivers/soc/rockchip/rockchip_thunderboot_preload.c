@@ -0,0 +1,442 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2023 Rockchip Electronics Co., Ltd.
+ *
+ * Thunder boot preload manifest.
+ *
+ * The loader streams images from storage to reserved memory while the
+ * kernel boots, and the thunder boot storage drivers report when their
+ * controller has finished. This driver keeps a manifest of those images,
+ * resolves their dependencies, decompresses them with the hardware
+ * decompressor when asked to and notifies consumers per image, so e.g. the
+ * ISP can start as soon as its IQ file is in place without waiting for the
+ * rest.
+ *
+ *	thunder-boot-preload {
+ *		compatible = "rockchip,thunder-boot-preload";
+ *
+ *		iq: iq {
+ *			memory-region = <&iq_reserved>;
+ *			rockchip,storage = <&thunder_boot_sfc>;
+ *		};
+ *
+ *		model {
+ *			memory-region = <&model_gz>;
+ *			memory-region-dst = <&model>;
+ *			rockchip,decompress = "gzip";
+ *			rockchip,storage = <&thunder_boot_sfc>;
+ *			depends-on = <&iq>;
+ *		};
+ *	};
+ *
+ * Items without "rockchip,storage" are ready at once. "depends-on" may only
+ * reference items listed before, which keeps the graph acyclic. Items are
+ * completed as soon as their storage and dependencies are done, so images
+ * on different storage don't wait for each other.
+ */
+#include <linux/delay.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/of_address.h>
+#include <linux/slab.h>
+#include <linux/soc/rockchip/rockchip_decompress.h>
+#include <linux/soc/rockchip/rockchip_thunderboot_preload.h>
+
+#undef pr_fmt
+#define pr_fmt(fmt)	"rk_tb_preload: " fmt
+
+/*
+ * The storage drivers start the ramdisk job without rk_decom_lock(), as it is
+ * waited for by the initramfs code, so the engine may still be busy with it.
+ * A start refused with -EBUSY leaves the running job alone, poll until it is
+ * done.
+ */
+#define RK_TB_PRELOAD_BUSY_MS	5000
+#define RK_TB_PRELOAD_POLL_MS	20
+/* seconds */
+#define RK_TB_PRELOAD_TIMEOUT	5
+
+struct rk_tb_preload_item {
+	struct list_head node;
+	struct device_node *np;
+	struct device_node *storage;
+	struct rk_tb_preload_item **deps;
+	int nr_deps;
+	struct resource src;
+	struct resource dst;
+	u32 mode;
+	bool decompress;
+	bool src_no_free;
+	bool ready;
+	bool running;
+	/* -EINPROGRESS until the item is completed */
+	int status;
+	struct list_head clients;
+};
+
+static LIST_HEAD(items_list);
+static DEFINE_MUTEX(preload_lock);
+static bool parsed;
+
+static struct rk_tb_preload_item *rk_tb_preload_find_np(struct device_node *np)
+{
+	struct rk_tb_preload_item *item;
+
+	list_for_each_entry(item, &items_list, node)
+		if (item->np == np)
+			return item;
+
+	return NULL;
+}
+
+static struct rk_tb_preload_item *rk_tb_preload_find(const char *name)
+{
+	struct rk_tb_preload_item *item;
+
+	list_for_each_entry(item, &items_list, node)
+		if (of_node_name_eq(item->np, name))
+			return item;
+
+	return NULL;
+}
+
+static int rk_tb_preload_parse_mem(struct device_node *np, const char *prop,
+				   struct resource *res)
+{
+	struct device_node *mem;
+	int ret;
+
+	mem = of_parse_phandle(np, prop, 0);
+	if (!mem)
+		return -ENODEV;
+
+	ret = of_address_to_resource(mem, 0, res);
+	of_node_put(mem);
+
+	return ret;
+}
+
+static int rk_tb_preload_parse_mode(struct rk_tb_preload_item *item)
+{
+	const char *str;
+
+	if (of_property_read_string(item->np, "rockchip,decompress", &str))
+		return 0;
+
+	if (!strcmp(str, "gzip"))
+		item->mode = GZIP_MOD;
+	else if (!strcmp(str, "zlib"))
+		item->mode = ZLIB_MOD;
+	else if (!strcmp(str, "lz4"))
+		item->mode = LZ4_MOD;
+	else
+		return -EINVAL;
+
+	item->decompress = true;
+	return 0;
+}
+
+static int rk_tb_preload_parse_deps(struct rk_tb_preload_item *item)
+{
+	struct device_node *np;
+	int i, n;
+
+	n = of_count_phandle_with_args(item->np, "depends-on", NULL);
+	if (n <= 0)
+		return 0;
+
+	item->deps = kcalloc(n, sizeof(*item->deps), GFP_KERNEL);
+	if (!item->deps)
+		return -ENOMEM;
+
+	for (i = 0; i < n; i++) {
+		np = of_parse_phandle(item->np, "depends-on", i);
+		item->deps[i] = rk_tb_preload_find_np(np);
+		of_node_put(np);
+		if (!item->deps[i])
+			return -EINVAL;
+	}
+	item->nr_deps = n;
+
+	return 0;
+}
+
+static int rk_tb_preload_add(struct device_node *np)
+{
+	struct rk_tb_preload_item *item;
+	int ret;
+
+	item = kzalloc(sizeof(*item), GFP_KERNEL);
+	if (!item)
+		return -ENOMEM;
+
+	item->np = of_node_get(np);
+	item->status = -EINPROGRESS;
+	INIT_LIST_HEAD(&item->clients);
+
+	ret = rk_tb_preload_parse_mode(item);
+	if (ret) {
+		pr_err("%pOFn: unknown decompress mode\n", np);
+		goto err;
+	}
+
+	if (item->decompress) {
+		if (rk_tb_preload_parse_mem(np, "memory-region", &item->src) ||
+		    rk_tb_preload_parse_mem(np, "memory-region-dst", &item->dst)) {
+			pr_err("%pOFn: missing memory regions\n", np);
+			ret = -EINVAL;
+			goto err;
+		}
+		item->src_no_free = of_property_read_bool(np, "memory-no-free");
+	}
+
+	item->storage = of_parse_phandle(np, "rockchip,storage", 0);
+	if (!item->storage) {
+		/* the engine must not race with the storage drivers' ramdisk */
+		if (item->decompress) {
+			pr_err("%pOFn: decompression needs a storage\n", np);
+			ret = -EINVAL;
+			goto err;
+		}
+		item->ready = true;
+	}
+
+	ret = rk_tb_preload_parse_deps(item);
+	if (ret) {
+		pr_err("%pOFn: dependencies must be listed before\n", np);
+		goto err;
+	}
+
+	list_add_tail(&item->node, &items_list);
+	return 0;
+
+err:
+	of_node_put(item->storage);
+	of_node_put(item->np);
+	kfree(item->deps);
+	kfree(item);
+	return ret;
+}
+
+static void rk_tb_preload_parse(void)
+{
+	struct device_node *root, *child;
+
+	lockdep_assert_held(&preload_lock);
+	if (parsed)
+		return;
+	parsed = true;
+
+	root = of_find_compatible_node(NULL, NULL, "rockchip,thunder-boot-preload");
+	if (!root)
+		return;
+
+	for_each_available_child_of_node(root, child)
+		rk_tb_preload_add(child);
+	of_node_put(root);
+}
+
+/* Returns -EINPROGRESS if a dependency is pending, or its first error */
+static int rk_tb_preload_deps_status(struct rk_tb_preload_item *item)
+{
+	int i, err = 0;
+
+	for (i = 0; i < item->nr_deps; i++) {
+		int status = item->deps[i]->status;
+
+		if (status == -EINPROGRESS)
+			return status;
+		if (status && !err)
+			err = status;
+	}
+
+	return err;
+}
+
+static struct rk_tb_preload_item *rk_tb_preload_next(void)
+{
+	struct rk_tb_preload_item *item;
+
+	list_for_each_entry(item, &items_list, node)
+		if (item->ready && !item->running &&
+		    item->status == -EINPROGRESS &&
+		    rk_tb_preload_deps_status(item) != -EINPROGRESS)
+			return item;
+
+	return NULL;
+}
+
+static int rk_tb_preload_decompress(struct rk_tb_preload_item *item)
+{
+	unsigned long timeout = jiffies + msecs_to_jiffies(RK_TB_PRELOAD_BUSY_MS);
+	u64 len = 0;
+	int ret;
+
+	rk_decom_lock();
+	for (;;) {
+		ret = rk_decom_start(item->mode | DECOM_NOBLOCKING,
+				     item->src.start, item->dst.start,
+				     resource_size(&item->dst));
+		if (ret != -EBUSY || time_after(jiffies, timeout))
+			break;
+		msleep(RK_TB_PRELOAD_POLL_MS);
+	}
+	if (ret)
+		goto out;
+
+	ret = rk_decom_wait_done(RK_TB_PRELOAD_TIMEOUT, &len);
+	if (!ret && !len)
+		ret = -EIO;
+	if (ret)
+		goto out;
+
+	pr_info("%pOFn: decompressed %llu bytes to %pa\n", item->np, len,
+		&item->dst.start);
+	if (!item->src_no_free) {
+		void *start = phys_to_virt(item->src.start);
+
+		free_reserved_area(start, start + resource_size(&item->src), -1,
+				   item->np->name);
+	}
+out:
+	rk_decom_unlock();
+	return ret;
+}
+
+static void rk_tb_preload_notify(struct rk_tb_preload_item *item)
+{
+	struct rk_tb_client *client;
+
+	lockdep_assert_held(&preload_lock);
+	while (!list_empty(&item->clients)) {
+		client = list_first_entry(&item->clients, struct rk_tb_client, node);
+		list_del(&client->node);
+		mutex_unlock(&preload_lock);
+		client->cb(client->data);
+		mutex_lock(&preload_lock);
+	}
+}
+
+/* Completes every item that can be completed, may be called concurrently */
+static void rk_tb_preload_run(void)
+{
+	struct rk_tb_preload_item *item;
+	int ret;
+
+	mutex_lock(&preload_lock);
+	while ((item = rk_tb_preload_next())) {
+		item->running = true;
+		ret = rk_tb_preload_deps_status(item);
+		mutex_unlock(&preload_lock);
+
+		if (!ret && item->decompress)
+			ret = rk_tb_preload_decompress(item);
+		if (ret)
+			pr_err("%pOFn: failed (%d)\n", item->np, ret);
+
+		mutex_lock(&preload_lock);
+		item->running = false;
+		item->status = ret;
+		rk_tb_preload_notify(item);
+	}
+	mutex_unlock(&preload_lock);
+}
+
+/**
+ * rk_tb_preload_storage_done - report that a storage has finished loading
+ * @storage: node of the thunder boot storage device
+ * @err: 0, or the error which made the transfer fail
+ */
+void rk_tb_preload_storage_done(struct device_node *storage, int err)
+{
+	struct rk_tb_preload_item *item;
+
+	mutex_lock(&preload_lock);
+	rk_tb_preload_parse();
+	list_for_each_entry(item, &items_list, node) {
+		if (item->storage != storage || item->ready)
+			continue;
+		item->ready = true;
+		if (err && item->status == -EINPROGRESS) {
+			item->status = err;
+			rk_tb_preload_notify(item);
+		}
+	}
+	mutex_unlock(&preload_lock);
+
+	rk_tb_preload_run();
+}
+
+/**
+ * rk_tb_preload_register_cb - get notified when an item is completed
+ * @name: node name of the item
+ * @client: @client->cb is called once the item succeeded or failed, right
+ *	    away if it already is completed
+ *
+ * Use rk_tb_preload_status() in the callback to tell success from failure.
+ */
+int rk_tb_preload_register_cb(const char *name, struct rk_tb_client *client)
+{
+	struct rk_tb_preload_item *item;
+
+	if (!name || !client || !client->cb)
+		return -EINVAL;
+
+	mutex_lock(&preload_lock);
+	rk_tb_preload_parse();
+	item = rk_tb_preload_find(name);
+	if (!item) {
+		mutex_unlock(&preload_lock);
+		return -ENOENT;
+	}
+
+	if (item->status != -EINPROGRESS) {
+		mutex_unlock(&preload_lock);
+		client->cb(client->data);
+		return 0;
+	}
+
+	list_add_tail(&client->node, &item->clients);
+	mutex_unlock(&preload_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(rk_tb_preload_register_cb);
+
+/**
+ * rk_tb_preload_status - get the state of an item
+ * @name: node name of the item
+ *
+ * Returns 0 if the item is in place, -EINPROGRESS if it is not yet, or the
+ * error which made it fail.
+ */
+int rk_tb_preload_status(const char *name)
+{
+	struct rk_tb_preload_item *item;
+	int ret;
+
+	mutex_lock(&preload_lock);
+	rk_tb_preload_parse();
+	item = rk_tb_preload_find(name);
+	ret = item ? item->status : -ENOENT;
+	mutex_unlock(&preload_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(rk_tb_preload_status);
+
+static int __init rk_tb_preload_init(void)
+{
+	mutex_lock(&preload_lock);
+	rk_tb_preload_parse();
+	mutex_unlock(&preload_lock);
+
+	/* complete the items which don't wait for any storage */
+	rk_tb_preload_run();
+
+	return 0;
+}
+
+pure_initcall(rk_tb_preload_init);
@@ -13,6 +13,7 @@
 #include <linux/platform_device.h>
 #include <linux/soc/rockchip/rockchip_decompress.h>
 #include <linux/soc/rockchip/rockchip_thunderboot_crypto.h>
+#include <linux/soc/rockchip/rockchip_thunderboot_preload.h>
 
 #define SFC_ICLR	0x08
 #define SFC_SR		0x24
@@ -38,6 +39,7 @@ static int rk_tb_sfc_thread(void *p)
 	regs = ioremap(res->start, resource_size(res));
 	if (!regs) {
 		dev_err(dev, "ioremap failed for resource %pR\n", res);
+		rk_tb_preload_storage_done(dev->of_node, -ENOMEM);
 		return -ENOMEM;
 	}
 
@@ -53,6 +55,7 @@ static int rk_tb_sfc_thread(void *p)
 				 5000 * USEC_PER_MSEC);
 	if (ret) {
 		dev_err(dev, "Wait for SFC idle timeout!\n");
+		rk_tb_preload_storage_done(dev->of_node, ret);
 		goto out;
 	} else {
 		if (likely(readl(regs + SFC_RAWISR) & DMA_INT))
@@ -88,6 +91,9 @@ static int rk_tb_sfc_thread(void *p)
 		}
 	}
 
+	/* The ramdisk is started, preloaded images may use the decompressor */
+	rk_tb_preload_storage_done(dev->of_node, 0);
+
 out:
 	of_node_put(rds);
 	of_node_put(rdd);
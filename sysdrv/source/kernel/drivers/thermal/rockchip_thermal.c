@@ -8,6 +8,7 @@
 #include <linux/delay.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
@@ -67,6 +68,16 @@ enum adc_sort_mode {
  */
 #define SOC_MAX_SENSORS	7
 
+/*
+ * Temperature trend: the slope is a running average of dT/dt in mC/s, taken
+ * from samples at least TREND_MIN_MS apart, and the trend is the change it
+ * predicts over the horizon.
+ */
+#define TREND_MIN_MS			100
+#define TREND_HORIZON_MS		1000
+#define TREND_STABLE_MC			500
+#define TREND_FULL_MC			5000
+
 /**
  * struct chip_tsadc_table - hold information about chip-specific differences
  * @id: conversion table
@@ -152,6 +163,9 @@ struct rockchip_tsadc_chip {
  * @id: identifier of the thermal sensor
  * @trim_temp: the trim temp of the thermal sensor
  * @tshut_temp: the hardware-controlled shutdown temperature value
+ * @last_temp: the last temperature read, for the trend
+ * @last_time: when @last_temp was read, 0 before the first read
+ * @slope: the averaged temperature change rate in mC/s
  */
 struct rockchip_thermal_sensor {
 	struct rockchip_thermal_data *thermal;
@@ -159,6 +173,9 @@ struct rockchip_thermal_sensor {
 	int id;
 	int trim_temp;
 	int tshut_temp;
+	int last_temp;
+	ktime_t last_time;
+	int slope;
 };
 
 /**
@@ -177,6 +194,10 @@ struct rockchip_thermal_sensor {
  * @gpio_state: pinctrl select gpio function
  * @otp_state: pinctrl select otp out function
  * @panic_nb: panic notifier block
+ * @alarm_window: if set, the alarm is armed at most this far above the
+ *		  current temperature so that the trend stays fresh without
+ *		  polling
+ * @trend_horizon_ms: how far ahead the trend looks
  */
 struct rockchip_thermal_data {
 	const struct rockchip_tsadc_chip *chip;
@@ -198,6 +219,9 @@ struct rockchip_thermal_data {
 	struct pinctrl_state *otp_state;
 
 	struct notifier_block panic_nb;
+
+	u32 alarm_window;
+	u32 trend_horizon_ms;
 };
 
 /**
@@ -2085,12 +2109,73 @@ static int rockchip_thermal_set_trips(void *_sensor, int low, int high)
 	dev_dbg(&thermal->pdev->dev, "%s: sensor %d: low: %d, high %d\n",
 		__func__, sensor->id, low, high);
 
-	high += sensor->trim_temp;
+	/*
+	 * The tsadc only has a high alarm. Arming it a window above the
+	 * current temperature gets an update, and a trend sample, for every
+	 * window of rise even with polling disabled.
+	 */
+	if (thermal->alarm_window && sensor->last_time &&
+	    sensor->last_temp < high - (int)thermal->alarm_window)
+		high = sensor->last_temp + thermal->alarm_window;
+
+	if (high != INT_MAX)
+		high += sensor->trim_temp;
 
 	return tsadc->set_alarm_temp(&tsadc->table,
 				     sensor->id, thermal->regs, high);
 }
 
+static void rockchip_thermal_update_trend(struct rockchip_thermal_sensor *sensor,
+					  int temp)
+{
+	ktime_t now = ktime_get();
+	s64 dt = ktime_ms_delta(now, sensor->last_time);
+	int rate;
+
+	if (sensor->last_time) {
+		if (dt < TREND_MIN_MS)
+			return;
+
+		rate = div_s64((s64)(temp - sensor->last_temp) * MSEC_PER_SEC,
+			       dt);
+		sensor->slope = (sensor->slope * 3 + rate) / 4;
+	}
+
+	sensor->last_temp = temp;
+	sensor->last_time = now;
+}
+
+static int rockchip_thermal_get_trend(void *_sensor, int trip,
+				      enum thermal_trend *trend)
+{
+	struct rockchip_thermal_sensor *sensor = _sensor;
+	struct thermal_zone_device *tzd = sensor->tzd;
+	int trip_temp, delta, ret;
+
+	/* Let the core compare the last two readings until we have a slope */
+	if (!sensor->last_time || !tzd)
+		return -EAGAIN;
+
+	ret = tzd->ops->get_trip_temp(tzd, trip, &trip_temp);
+	if (ret)
+		return ret;
+
+	delta = div_s64((s64)sensor->slope * sensor->thermal->trend_horizon_ms,
+			MSEC_PER_SEC);
+
+	if (abs(delta) < TREND_STABLE_MC)
+		*trend = THERMAL_TREND_STABLE;
+	else if (delta < 0)
+		*trend = THERMAL_TREND_DROPPING;
+	else if (sensor->last_temp + delta >= trip_temp + TREND_FULL_MC)
+		/* Heading well past the trip, don't step up one by one */
+		*trend = THERMAL_TREND_RAISE_FULL;
+	else
+		*trend = THERMAL_TREND_RAISING;
+
+	return 0;
+}
+
 static int rockchip_thermal_get_temp(void *_sensor, int *out_temp)
 {
 	struct rockchip_thermal_sensor *sensor = _sensor;
@@ -2104,11 +2189,15 @@ static int rockchip_thermal_get_temp(void *_sensor, int *out_temp)
 	dev_dbg(&thermal->pdev->dev, "sensor %d - temp: %d, retval: %d\n",
 		sensor->id, *out_temp, retval);
 
+	if (!retval)
+		rockchip_thermal_update_trend(sensor, *out_temp);
+
 	return retval;
 }
 
 static const struct thermal_zone_of_device_ops rockchip_of_thermal_ops = {
 	.get_temp = rockchip_thermal_get_temp,
+	.get_trend = rockchip_thermal_get_trend,
 	.set_trips = rockchip_thermal_set_trips,
 };
 
@@ -2291,6 +2380,12 @@ static int rockchip_configure_from_dt(struct device *dev,
 
 	rockchip_get_trim_configure(dev, np, thermal);
 
+	of_property_read_u32(np, "rockchip,alarm-window-millicelsius",
+			     &thermal->alarm_window);
+	thermal->trend_horizon_ms = TREND_HORIZON_MS;
+	of_property_read_u32(np, "rockchip,trend-horizon-ms",
+			     &thermal->trend_horizon_ms);
+
 	return 0;
 }
 
@@ -50,6 +50,12 @@ struct uart_8250_dma {
 	unsigned char		rx_running;
 #if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
 	size_t			rx_index;
+
+	/* Statistics, protected by the port lock */
+	unsigned long		rx_periods;
+	unsigned long		rx_timeouts;
+	unsigned long		rx_dropped;
+	unsigned long		tx_xfers;
 #endif
 };
 
@@ -55,7 +55,7 @@ static void __dma_rx_complete(void *param)
 	struct uart_8250_dma	*dma = p->dma;
 	struct tty_port		*tty_port = &p->port.state->port;
 	struct dma_tx_state	state;
-	unsigned int		count = 0, cur_index = 0;
+	unsigned int		count = 0, cur_index = 0, copied;
 
 	dmaengine_tx_status(dma->rxchan, dma->rx_cookie, &state);
 	cur_index = dma->rx_size - state.residue;
@@ -67,17 +67,40 @@ static void __dma_rx_complete(void *param)
 	else
 		count = dma->rx_size - dma->rx_index;
 
-	tty_insert_flip_string(tty_port, dma->rx_buf + dma->rx_index, count);
+	copied = tty_insert_flip_string(tty_port, dma->rx_buf + dma->rx_index,
+					count);
 
 	if (cur_index < dma->rx_index) {
-		tty_insert_flip_string(tty_port, dma->rx_buf, cur_index);
+		copied += tty_insert_flip_string(tty_port, dma->rx_buf,
+						 cur_index);
 		count += cur_index;
 	}
 
 	p->port.icount.rx += count;
+	if (copied < count) {
+		p->port.icount.buf_overrun += count - copied;
+		dma->rx_dropped += count - copied;
+	}
 	dma->rx_index = cur_index;
 }
 
+/*
+ * The ring is split in two periods so that a continuous stream, which never
+ * raises the character timeout, is still drained before the DMA wraps over it.
+ */
+static void __dma_rx_period(void *param)
+{
+	struct uart_8250_port	*p = param;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&p->port.lock, flags);
+	p->dma->rx_periods++;
+	__dma_rx_complete(p);
+	spin_unlock_irqrestore(&p->port.lock, flags);
+
+	tty_flip_buffer_push(&p->port.state->port);
+}
+
 #else
 
 static void __dma_rx_complete(void *param)
@@ -145,6 +168,9 @@ int serial8250_tx_dma(struct uart_8250_port *p)
 	dma->tx_running = 1;
 	desc->callback = __dma_tx_complete;
 	desc->callback_param = p;
+#if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
+	dma->tx_xfers++;
+#endif
 
 	dma->tx_cookie = dmaengine_submit(desc);
 
@@ -170,7 +196,7 @@ err:
 
 int serial8250_rx_dma(struct uart_8250_port *p)
 {
-	unsigned int rfl, i = 0, fcr = 0, cur_index = 0;
+	unsigned int rfl, i = 0, fcr = 0, cur_index = 0, copied;
 	unsigned char buf[MAX_FIFO_SIZE];
 	struct uart_port	*port = &p->port;
 	struct tty_port		*tty_port = &p->port.state->port;
@@ -189,10 +215,15 @@ int serial8250_rx_dma(struct uart_8250_port *p)
 	while (i < rfl)
 		buf[i++] = serial_port_in(port, UART_RX);
 
+	dma->rx_timeouts++;
 	__dma_rx_complete(p);
 
-	tty_insert_flip_string(tty_port, buf, i);
+	copied = tty_insert_flip_string(tty_port, buf, i);
 	p->port.icount.rx += i;
+	if (copied < i) {
+		p->port.icount.buf_overrun += i - copied;
+		dma->rx_dropped += i - copied;
+	}
 	tty_flip_buffer_push(tty_port);
 
 	if (fcr)
@@ -206,15 +237,15 @@ int serial8250_start_rx_dma(struct uart_8250_port *p)
 	struct dma_async_tx_descriptor	*desc;
 
 	desc = dmaengine_prep_dma_cyclic(dma->rxchan, dma->rx_addr,
-					 dma->rx_size, dma->rx_size,
+					 dma->rx_size, dma->rx_size / 2,
 					 DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT |
 					 DMA_CTRL_ACK);
 	if (!desc)
 		return -EBUSY;
 
 	dma->rx_running = 1;
-	desc->callback = NULL;
-	desc->callback_param = NULL;
+	desc->callback = __dma_rx_period;
+	desc->callback_param = p;
 
 	dma->rx_cookie = dmaengine_submit(desc);
 	dma_async_issue_pending(dma->rxchan);
@@ -315,8 +346,10 @@ int serial8250_request_dma(struct uart_8250_port *p)
 
 	/* RX buffer */
 #if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
+	/* Both halves of the cyclic ring must be whole bursts */
 	if (!dma->rx_size)
 		dma->rx_size = PAGE_SIZE * 2;
+	dma->rx_size = roundup(dma->rx_size, 2 * dma->rxconf.src_maxburst);
 #else
 	if (!dma->rx_size)
 		dma->rx_size = PAGE_SIZE;
@@ -492,6 +492,44 @@ static void dw8250_quirks(struct uart_port *p, struct dw8250_data *data)
 	}
 }
 
+#if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
+static ssize_t dma_stats_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct dw8250_data *data = dev_get_drvdata(dev);
+	struct uart_8250_port *up = serial8250_get_port(data->data.line);
+	struct uart_8250_dma *dma = up->dma;
+	struct uart_icount icount;
+	unsigned long rx_periods = 0, rx_timeouts = 0, rx_dropped = 0;
+	unsigned long tx_xfers = 0, flags;
+	bool rx_dma, tx_dma;
+
+	spin_lock_irqsave(&up->port.lock, flags);
+	icount = up->port.icount;
+	rx_dma = dma && dma->rxchan;
+	tx_dma = dma && dma->txchan;
+	if (dma) {
+		rx_periods = dma->rx_periods;
+		rx_timeouts = dma->rx_timeouts;
+		rx_dropped = dma->rx_dropped;
+		tx_xfers = dma->tx_xfers;
+	}
+	spin_unlock_irqrestore(&up->port.lock, flags);
+
+	return sysfs_emit(buf,
+			  "rx_dma: %d\ntx_dma: %d\nrx: %u\ntx: %u\n"
+			  "rx_periods: %lu\nrx_timeouts: %lu\n"
+			  "rx_dropped: %lu\ntx_xfers: %lu\n"
+			  "overrun: %u\nbuf_overrun: %u\nframe: %u\n"
+			  "parity: %u\nbrk: %u\n",
+			  rx_dma, tx_dma, icount.rx, icount.tx,
+			  rx_periods, rx_timeouts, rx_dropped, tx_xfers,
+			  icount.overrun, icount.buf_overrun, icount.frame,
+			  icount.parity, icount.brk);
+}
+static DEVICE_ATTR_RO(dma_stats);
+#endif
+
 static int dw8250_probe(struct platform_device *pdev)
 {
 	struct uart_8250_port uart = {}, *up = &uart;
@@ -586,6 +624,12 @@ static int dw8250_probe(struct platform_device *pdev)
 		data->enable_wakeup = 0;
 #endif
 
+#if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
+	/* High rate links want more than the default two pages of RX ring */
+	if (!device_property_read_u32(dev, "rockchip,rx-dma-size", &val))
+		data->data.dma.rx_size = PAGE_ALIGN(val);
+#endif
+
 	/* Always ask for fixed clock rate from a property. */
 	device_property_read_u32(dev, "clock-frequency", &p->uartclk);
 
@@ -671,6 +715,10 @@ static int dw8250_probe(struct platform_device *pdev)
 		device_init_wakeup(&pdev->dev, true);
 #endif
 	platform_set_drvdata(pdev, data);
+#if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
+	if (up->dma && device_create_file(dev, &dev_attr_dma_stats))
+		dev_warn(dev, "failed to create dma_stats\n");
+#endif
 
 	pm_runtime_set_active(dev);
 	pm_runtime_enable(dev);
@@ -696,6 +744,10 @@ static int dw8250_remove(struct platform_device *pdev)
 
 	pm_runtime_get_sync(dev);
 
+#if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
+	device_remove_file(dev, &dev_attr_dma_stats);
+#endif
+
 	if (data->clk) {
 		clk_notifier_unregister(data->clk, &data->clk_notifier);
 
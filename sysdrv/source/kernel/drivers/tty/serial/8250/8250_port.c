@@ -1910,6 +1910,8 @@ int serial8250_handle_irq(struct uart_port *port, unsigned int iir)
 	struct uart_8250_port *up = up_to_u8250p(port);
 #ifndef CONFIG_ARCH_ROCKCHIP
 	bool skip_rx = false;
+#else
+	bool dma_rx = up->dma && up->dma->rxchan;
 #endif
 
 	if (iir & UART_IIR_NO_INT)
@@ -1926,8 +1928,10 @@ int serial8250_handle_irq(struct uart_port *port, unsigned int iir)
 		if (up->dma && up->dma->rxchan)
 			dma_err = handle_rx_dma(up, iir);
 
-		if (!up->dma || dma_err)
+		if (!up->dma || dma_err) {
 			status = serial8250_rx_chars(up, status);
+			dma_rx = false;
+		}
 	}
 #else
 	/*
@@ -1961,6 +1965,17 @@ int serial8250_handle_irq(struct uart_port *port, unsigned int iir)
 
 #ifdef CONFIG_ARCH_ROCKCHIP
 	if (status & UART_LSR_BRK_ERROR_BITS) {
+		/* serial8250_rx_chars() accounts for them when it runs */
+		if (dma_rx) {
+			if (status & UART_LSR_OE)
+				port->icount.overrun++;
+			if (status & UART_LSR_PE)
+				port->icount.parity++;
+			if (status & UART_LSR_FE)
+				port->icount.frame++;
+			if (status & UART_LSR_BI)
+				port->icount.brk++;
+		}
 
 		if (status & UART_LSR_OE)
 			pr_err("%s: Overrun error!\n", port->name);
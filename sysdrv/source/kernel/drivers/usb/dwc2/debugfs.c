@@ -13,6 +13,7 @@
 
 #include "core.h"
 #include "debug.h"
+#include "hcd.h"
 
 #if IS_ENABLED(CONFIG_USB_DWC2_PERIPHERAL) || \
 	IS_ENABLED(CONFIG_USB_DWC2_DUAL_ROLE)
@@ -322,6 +323,38 @@ static void dwc2_hsotg_create_debug(struct dwc2_hsotg *hsotg)
 static inline void dwc2_hsotg_create_debug(struct dwc2_hsotg *hsotg) {}
 #endif
 
+#if IS_ENABLED(CONFIG_USB_DWC2_HOST) || \
+	IS_ENABLED(CONFIG_USB_DWC2_DUAL_ROLE)
+
+/**
+ * periodic_budget_show() - show how the host periodic schedule is used.
+ * @seq: The seq_file to write to.
+ * @v: Unused parameter.
+ *
+ * Each character of a uFrame bar stands for 4 us of the 100 us budget.
+ */
+static int periodic_budget_show(struct seq_file *seq, void *v)
+{
+	struct dwc2_hsotg *hsotg = seq->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&hsotg->lock, flags);
+	dwc2_hcd_show_periodic_budget(hsotg, seq);
+	spin_unlock_irqrestore(&hsotg->lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(periodic_budget);
+
+static void dwc2_hcd_create_debug(struct dwc2_hsotg *hsotg)
+{
+	debugfs_create_file("periodic_budget", 0444, hsotg->debug_root, hsotg,
+			    &periodic_budget_fops);
+}
+#else
+static inline void dwc2_hcd_create_debug(struct dwc2_hsotg *hsotg) {}
+#endif
+
 /* dwc2_hsotg_delete_debug is removed as cleanup in done in dwc2_debugfs_exit */
 
 #define dump_register(nm)	\
@@ -781,6 +814,9 @@ int dwc2_debugfs_init(struct dwc2_hsotg *hsotg)
 	/* Add gadget debugfs nodes */
 	dwc2_hsotg_create_debug(hsotg);
 
+	/* Add host debugfs nodes */
+	dwc2_hcd_create_debug(hsotg);
+
 	hsotg->regset = devm_kzalloc(hsotg->dev, sizeof(*hsotg->regset),
 								GFP_KERNEL);
 	if (!hsotg->regset) {
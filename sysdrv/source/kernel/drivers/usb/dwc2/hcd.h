@@ -48,6 +48,7 @@
  */
 
 struct dwc2_qh;
+struct seq_file;
 
 /**
  * struct dwc2_host_chan - Software host channel descriptor
@@ -571,6 +572,9 @@ void dwc2_hcd_qh_unlink(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh);
 void dwc2_hcd_qh_deactivate(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh,
 			    int sched_csplit);
 
+void dwc2_hcd_show_periodic_budget(struct dwc2_hsotg *hsotg,
+				   struct seq_file *seq);
+
 void dwc2_hcd_qtd_init(struct dwc2_qtd *qtd, struct dwc2_hcd_urb *urb);
 int dwc2_hcd_qtd_add(struct dwc2_hsotg *hsotg, struct dwc2_qtd *qtd,
 		     struct dwc2_qh *qh);
@@ -47,6 +47,7 @@
 #include <linux/dma-mapping.h>
 #include <linux/io.h>
 #include <linux/slab.h>
+#include <linux/seq_file.h>
 #include <linux/usb.h>
 
 #include <linux/usb/hcd.h>
@@ -358,6 +359,85 @@ static void pmap_unschedule(unsigned long *map, int bits_per_period,
 	}
 }
 
+/**
+ * pmap_used() - Count the bits already taken in one period of a map
+ *
+ * @map:             See pmap_schedule().
+ * @bits_per_period: See pmap_schedule().
+ * @period:          The period to look at.
+ */
+static int pmap_used(unsigned long *map, int bits_per_period, int period)
+{
+	int start = period * bits_per_period;
+	int used = 0;
+	int i;
+
+	for (i = start; i < start + bits_per_period; i++)
+		used += test_bit(i, map);
+
+	return used;
+}
+
+/**
+ * pmap_largest_free() - Find the longest free run in one period of a map
+ *
+ * @map:             See pmap_schedule().
+ * @bits_per_period: See pmap_schedule().
+ * @period:          The period to look at.
+ *
+ * This is the biggest reservation that could still go in this period.
+ */
+static int pmap_largest_free(unsigned long *map, int bits_per_period,
+			     int period)
+{
+	int start = period * bits_per_period;
+	int end = start + bits_per_period;
+	int largest = 0;
+	int run = 0;
+	int i;
+
+	for (i = start; i < end; i++) {
+		if (test_bit(i, map)) {
+			run = 0;
+			continue;
+		}
+		largest = max(largest, ++run);
+	}
+
+	return largest;
+}
+
+/**
+ * dwc2_hs_peak_load() - Find the busiest uFrame used by a scheduled qh
+ *
+ * @hsotg: The HCD state structure for the DWC OTG controller.
+ * @qh:    QH that currently holds a reservation in hs_periodic_bitmap.
+ *
+ * Looks at every repetition of every high speed transfer of the QH.
+ *
+ * Returns: the time in us claimed in the most loaded of those uFrames.
+ */
+static int dwc2_hs_peak_load(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh)
+{
+	int interval = gcd(qh->host_interval, DWC2_HS_SCHEDULE_UFRAMES);
+	int peak = 0;
+	int i;
+
+	for (i = 0; i < qh->num_hs_transfers; i++) {
+		int uframe = qh->hs_transfers[i].start_schedule_us /
+			     DWC2_HS_PERIODIC_US_PER_UFRAME;
+
+		for (uframe %= interval; uframe < DWC2_HS_SCHEDULE_UFRAMES;
+		     uframe += interval)
+			peak = max(peak,
+				   pmap_used(hsotg->hs_periodic_bitmap,
+					     DWC2_HS_PERIODIC_US_PER_UFRAME,
+					     uframe));
+	}
+
+	return peak;
+}
+
 /**
  * dwc2_get_ls_map() - Get the map used for the given qh
  *
@@ -693,7 +773,7 @@ static void dwc2_hs_pmap_unschedule(struct dwc2_hsotg *hsotg,
 }
 
 /**
- * dwc2_uframe_schedule_split - Schedule a QH for a periodic split xfer.
+ * dwc2_uframe_schedule_split_from - Schedule a split xfer at the first fit.
  *
  * This is the most complicated thing in USB.  We have to find matching time
  * in both the global high speed schedule for the port and the low speed
@@ -702,14 +782,15 @@ static void dwc2_hs_pmap_unschedule(struct dwc2_hsotg *hsotg,
  * Being here means that the host must be running in high speed mode and the
  * device is in low or full speed mode (and behind a hub).
  *
- * @hsotg:       The HCD state structure for the DWC OTG controller.
- * @qh:          QH for the periodic transfer.
+ * @hsotg:           The HCD state structure for the DWC OTG controller.
+ * @qh:              QH for the periodic transfer.
+ * @ls_search_slice: The first slice of the low speed schedule to try.
  */
-static int dwc2_uframe_schedule_split(struct dwc2_hsotg *hsotg,
-				      struct dwc2_qh *qh)
+static int dwc2_uframe_schedule_split_from(struct dwc2_hsotg *hsotg,
+					   struct dwc2_qh *qh,
+					   int ls_search_slice)
 {
 	int bytecount = qh->maxp_mult * qh->maxp;
-	int ls_search_slice;
 	int err = 0;
 	int host_interval_in_sched;
 
@@ -724,21 +805,8 @@ static int dwc2_uframe_schedule_split(struct dwc2_hsotg *hsotg,
 	 * We always try to find space in the low speed schedule first, then
 	 * try to find high speed time that matches.  If we don't, we'll bump
 	 * up the place we start searching in the low speed schedule and try
-	 * again.  To start we'll look right at the beginning of the low speed
-	 * schedule.
-	 *
-	 * Note that this will tend to front-load the high speed schedule.
-	 * We may eventually want to try to avoid this by either considering
-	 * both schedules together or doing some sort of round robin.
-	 *
-	 * For isoc split out, start schedule at the 2 * DWC2_SLICES_PER_UFRAME
-	 * to transfer SSPLIT-begin OUT transaction like EHCI controller.
+	 * again.
 	 */
-	if (qh->ep_type == USB_ENDPOINT_XFER_ISOC && !qh->ep_is_in)
-		ls_search_slice = 2 * DWC2_SLICES_PER_UFRAME;
-	else
-		ls_search_slice = 0;
-
 	while (ls_search_slice < DWC2_LS_SCHEDULE_SLICES) {
 		int start_s_uframe;
 		int ssplit_s_uframe;
@@ -984,27 +1052,118 @@ static int dwc2_uframe_schedule_split(struct dwc2_hsotg *hsotg,
 	return 0;
 }
 
+/**
+ * dwc2_uframe_schedule_split - Schedule a QH for a periodic split xfer.
+ *
+ * Taking the first fit from dwc2_uframe_schedule_split_from() front-loads the
+ * high speed schedule, so with a couple of full speed audio devices behind a
+ * hub the first uFrames fill up and a high speed camera that needs the same
+ * time in every uFrame no longer fits.  Instead we try every start on the
+ * low speed schedule that fits and keep the one whose busiest high speed
+ * uFrame ends up least loaded.  The earliest start wins a tie, which is the
+ * old behavior on an empty schedule.
+ *
+ * @hsotg:       The HCD state structure for the DWC OTG controller.
+ * @qh:          QH for the periodic transfer.
+ */
+static int dwc2_uframe_schedule_split(struct dwc2_hsotg *hsotg,
+				      struct dwc2_qh *qh)
+{
+	int best_load = INT_MAX;
+	int best_slice = -1;
+	int ls_search_slice;
+	int i;
+
+	/*
+	 * For isoc split out, start schedule at the 2 * DWC2_SLICES_PER_UFRAME
+	 * to transfer SSPLIT-begin OUT transaction like EHCI controller.
+	 */
+	if (qh->ep_type == USB_ENDPOINT_XFER_ISOC && !qh->ep_is_in)
+		ls_search_slice = 2 * DWC2_SLICES_PER_UFRAME;
+	else
+		ls_search_slice = 0;
+
+	while (ls_search_slice < DWC2_LS_SCHEDULE_SLICES) {
+		int load;
+
+		if (dwc2_uframe_schedule_split_from(hsotg, qh, ls_search_slice))
+			break;
+
+		load = dwc2_hs_peak_load(hsotg, qh);
+		if (load < best_load) {
+			best_load = load;
+			best_slice = ls_search_slice;
+		}
+
+		/* Give the time back and look from the next uFrame on */
+		for (i = 0; i < qh->num_hs_transfers; i++)
+			dwc2_hs_pmap_unschedule(hsotg, qh, i);
+		if (qh->schedule_low_speed)
+			dwc2_ls_pmap_unschedule(hsotg, qh);
+
+		ls_search_slice = (qh->ls_start_schedule_slice /
+				   DWC2_SLICES_PER_UFRAME + 1) *
+				  DWC2_SLICES_PER_UFRAME;
+	}
+
+	if (best_slice < 0)
+		return -ENOSPC;
+
+	/* Same maps as when we tried it, so we'll get the same result again */
+	return dwc2_uframe_schedule_split_from(hsotg, qh, best_slice);
+}
+
 /**
  * dwc2_uframe_schedule_hs - Schedule a QH for a periodic high speed xfer.
  *
- * Basically this just wraps dwc2_hs_pmap_schedule() to provide a clean
- * interface.
+ * Basically this wraps dwc2_hs_pmap_schedule() to provide a clean interface
+ * and to pick the uFrame.
  *
  * @hsotg:       The HCD state structure for the DWC OTG controller.
  * @qh:          QH for the periodic transfer.
  */
 static int dwc2_uframe_schedule_hs(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh)
 {
+	int interval = gcd(qh->host_interval, DWC2_HS_SCHEDULE_UFRAMES);
+	int best_load = INT_MAX;
+	int best_us = -1;
+	int uframe;
+
 	/* In non-split host and device time are the same */
 	WARN_ON(qh->host_us != qh->device_us);
 	WARN_ON(qh->host_interval != qh->device_interval);
 	WARN_ON(qh->num_hs_transfers != 1);
 
-	/* We'll have one transfer; init start to 0 before calling scheduler */
-	qh->hs_transfers[0].start_schedule_us = 0;
 	qh->hs_transfers[0].duration_us = qh->host_us;
 
-	return dwc2_hs_pmap_schedule(hsotg, qh, false, 0);
+	/*
+	 * Anything that doesn't repeat every uFrame can go in one of several
+	 * uFrames.  The first fit would stack them all in the first uFrame and
+	 * leave the others empty, which then rules out the big every-uFrame
+	 * isoc endpoints of cameras.  Spread them out by picking the uFrame that
+	 * ends up least loaded instead, the earliest one on a tie.
+	 */
+	for (uframe = 0; uframe < interval; uframe++) {
+		int load;
+
+		qh->hs_transfers[0].start_schedule_us =
+			uframe * DWC2_HS_PERIODIC_US_PER_UFRAME;
+		if (dwc2_hs_pmap_schedule(hsotg, qh, true, 0))
+			continue;
+
+		load = dwc2_hs_peak_load(hsotg, qh);
+		if (load < best_load) {
+			best_load = load;
+			best_us = qh->hs_transfers[0].start_schedule_us;
+		}
+		dwc2_hs_pmap_unschedule(hsotg, qh, 0);
+	}
+
+	if (best_us < 0)
+		return -ENOSPC;
+
+	qh->hs_transfers[0].start_schedule_us = best_us;
+	return dwc2_hs_pmap_schedule(hsotg, qh, true, 0);
 }
 
 /**
@@ -2103,3 +2262,121 @@ int dwc2_hcd_qtd_add(struct dwc2_hsotg *hsotg, struct dwc2_qtd *qtd,
 fail:
 	return retval;
 }
+
+static void dwc2_qh_show_budget(struct dwc2_hsotg *hsotg,
+				struct seq_file *seq, struct dwc2_qh *qh,
+				const char *state)
+{
+	static const char * const types[] = {
+		[USB_ENDPOINT_XFER_CONTROL] = "ctrl",
+		[USB_ENDPOINT_XFER_ISOC] = "isoc",
+		[USB_ENDPOINT_XFER_BULK] = "bulk",
+		[USB_ENDPOINT_XFER_INT] = "intr",
+	};
+	struct dwc2_qtd *qtd;
+	int i;
+
+	qtd = list_first_entry_or_null(&qh->qtd_list, struct dwc2_qtd,
+				       qtd_list_entry);
+	if (qtd && qtd->urb)
+		seq_printf(seq, "dev %3d ep%-2d", qtd->urb->pipe_info.dev_addr,
+			   qtd->urb->pipe_info.ep_num);
+	else
+		seq_puts(seq, "dev   - ep- ");
+
+	seq_printf(seq, " %s %-3s %s %4dx%d intv %3d %-8s",
+		   types[qh->ep_type & USB_ENDPOINT_XFERTYPE_MASK],
+		   qh->ep_is_in ? "in" : "out", usb_speed_string(qh->dev_speed),
+		   qh->maxp, qh->maxp_mult, qh->host_interval, state);
+
+	if (hsotg->params.uframe_sched) {
+		for (i = 0; i < qh->num_hs_transfers; i++) {
+			struct dwc2_hs_transfer_time *trans_time =
+				qh->hs_transfers + i;
+
+			seq_printf(seq, " uF%d+%d/%d",
+				   trans_time->start_schedule_us /
+				   DWC2_HS_PERIODIC_US_PER_UFRAME,
+				   trans_time->start_schedule_us %
+				   DWC2_HS_PERIODIC_US_PER_UFRAME,
+				   trans_time->duration_us);
+		}
+
+		if (qh->schedule_low_speed && qh->dwc_tt) {
+			unsigned long *map = dwc2_get_ls_map(hsotg, qh);
+			int used = 0;
+
+			for (i = 0; i < DWC2_LS_SCHEDULE_FRAMES; i++)
+				used += pmap_used(map,
+					DWC2_LS_PERIODIC_SLICES_PER_FRAME, i);
+			seq_printf(seq, " tt%d slice %d+%d (%d/%d used)",
+				   qh->ttport, qh->ls_start_schedule_slice,
+				   DIV_ROUND_UP(qh->device_us,
+						DWC2_US_PER_SLICE),
+				   used, DWC2_LS_SCHEDULE_SLICES);
+		}
+	} else {
+		seq_printf(seq, " %d us", qh->host_us);
+	}
+
+	seq_puts(seq, "\n");
+}
+
+/**
+ * dwc2_hcd_show_periodic_budget() - Show how the periodic schedule is used
+ *
+ * Draws the time claimed in each uFrame of the high speed schedule and lists
+ * the periodic QHs with where they got placed.  "largest" is the longest
+ * transfer that would still fit in a uFrame; an isoc endpoint which needs
+ * every uFrame only fits if it's below the smallest of them.  QHs waiting to
+ * be unreserved hold on to their time but are not listed.
+ *
+ * @hsotg: The HCD state structure for the DWC OTG controller.
+ * @seq:   The seq_file to show the schedule in.
+ *
+ * Must be called with the hsotg lock held.
+ */
+void dwc2_hcd_show_periodic_budget(struct dwc2_hsotg *hsotg,
+				   struct seq_file *seq)
+{
+	struct {
+		struct list_head *list;
+		const char *name;
+	} scheds[] = {
+		{ &hsotg->periodic_sched_inactive, "inactive" },
+		{ &hsotg->periodic_sched_ready, "ready" },
+		{ &hsotg->periodic_sched_assigned, "assigned" },
+		{ &hsotg->periodic_sched_queued, "queued" },
+	};
+	struct dwc2_qh *qh;
+	int i;
+
+	seq_printf(seq, "periodic: %d us claimed, %d QHs, %d channels\n",
+		   hsotg->periodic_usecs, hsotg->periodic_qh_count,
+		   hsotg->periodic_channels);
+
+	if (hsotg->params.uframe_sched) {
+		seq_printf(seq, "uFrame used largest (of %d us)\n",
+			   DWC2_HS_PERIODIC_US_PER_UFRAME);
+
+		for (i = 0; i < DWC2_HS_SCHEDULE_UFRAMES; i++) {
+			int used = pmap_used(hsotg->hs_periodic_bitmap,
+					     DWC2_HS_PERIODIC_US_PER_UFRAME, i);
+			int largest = pmap_largest_free(hsotg->hs_periodic_bitmap,
+						DWC2_HS_PERIODIC_US_PER_UFRAME,
+						i);
+			int j;
+
+			seq_printf(seq, "%6d %4d %7d |", i, used, largest);
+			for (j = 0; j < DWC2_HS_PERIODIC_US_PER_UFRAME; j += 4)
+				seq_putc(seq, test_bit(i *
+					DWC2_HS_PERIODIC_US_PER_UFRAME + j,
+					hsotg->hs_periodic_bitmap) ? '#' : '.');
+			seq_puts(seq, "|\n");
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(scheds); i++)
+		list_for_each_entry(qh, scheds[i].list, qh_list_entry)
+			dwc2_qh_show_budget(hsotg, seq, qh, scheds[i].name);
+}
@@ -677,7 +677,7 @@ struct dwc3_event_buffer {
 #define DWC3_EP_DIRECTION_TX	true
 #define DWC3_EP_DIRECTION_RX	false
 
-#define DWC3_TRB_NUM		256
+#define DWC3_TRB_NUM		CONFIG_USB_DWC3_TRB_NUM
 
 /**
  * struct dwc3_ep - device side endpoint representation
@@ -739,16 +739,12 @@ struct dwc3_ep {
 #define DWC3_EP0_DIR_IN		BIT(31)
 
 	/*
-	 * IMPORTANT: we *know* we have 256 TRBs in our @trb_pool, so we will
-	 * use a u8 type here. If anybody decides to increase number of TRBs to
-	 * anything larger than 256 - I can't see why people would want to do
-	 * this though - then this type needs to be changed.
-	 *
-	 * By using u8 types we ensure that our % operator when incrementing
-	 * enqueue and dequeue get optimized away by the compiler.
+	 * @trb_pool holds up to 1024 TRBs (USB_DWC3_TRB_NUM), so a u16 is
+	 * enough here. The ring size is a power of 2, which keeps the wrap
+	 * around arithmetic a simple mask.
 	 */
-	u8			trb_enqueue;
-	u8			trb_dequeue;
+	u16			trb_enqueue;
+	u16			trb_dequeue;
 
 	u8			number;
 	u8			type;
@@ -15,6 +15,9 @@
 /* #define VERBOSE_DEBUG */
 
 #include <linux/blkdev.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-fence.h>
+#include <linux/dma-resv.h>
 #include <linux/pagemap.h>
 #include <linux/export.h>
 #include <linux/fs_parser.h>
@@ -191,6 +194,11 @@ struct ffs_epfile {
 	struct ffs_buffer		*read_buffer;
 #define READ_BUFFER_DROP ((struct ffs_buffer *)ERR_PTR(-ESHUTDOWN))
 
+	/* Attached dma-bufs, see ffs_dmabuf_attach() */
+	struct list_head		dmabufs;	/* P: dmabufs_mutex */
+	struct mutex			dmabufs_mutex;
+	atomic_t			seqno;
+
 	char				name[5];
 
 	unsigned char			in;	/* P: ffs->eps_lock */
@@ -1277,13 +1285,412 @@ static ssize_t ffs_epfile_read_iter(struct kiocb *kiocb, struct iov_iter *to)
 	return res;
 }
 
+/* dma-buf transfers *********************************************************/
+
+/*
+ * Applications attach dma-bufs to an endpoint file and queue transfers
+ * straight from or into them, instead of copying through kernel buffers.
+ * Each transfer puts a fence on the dma-buf, signalled when its request
+ * completes, so any number of them may be in flight and the application
+ * waits for them by polling the dma-buf.
+ */
+
+#define FFS_DMABUF_ENQUEUE_TIMEOUT_MS	5000
+
+struct ffs_dmabuf_priv {
+	struct list_head entry;			/* P: epfile->dmabufs_mutex */
+	struct kref ref;
+	struct ffs_data *ffs;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+	spinlock_t lock;			/* fence lock */
+	u64 context;
+};
+
+struct ffs_dma_fence {
+	struct dma_fence base;
+	struct ffs_dmabuf_priv *priv;
+	struct usb_ep *ep;
+	struct usb_request *req;
+	struct work_struct work;
+};
+
+static void ffs_dmabuf_release(struct kref *ref)
+{
+	struct ffs_dmabuf_priv *priv = container_of(ref, struct ffs_dmabuf_priv,
+						    ref);
+	struct dma_buf_attachment *attach = priv->attach;
+	struct dma_buf *dmabuf = attach->dmabuf;
+
+	dma_resv_lock(dmabuf->resv, NULL);
+	dma_buf_unmap_attachment(attach, priv->sgt, DMA_BIDIRECTIONAL);
+	dma_resv_unlock(dmabuf->resv);
+
+	dma_buf_detach(dmabuf, attach);
+	dma_buf_put(dmabuf);
+	kfree(priv);
+}
+
+static void ffs_dmabuf_put(struct ffs_dmabuf_priv *priv)
+{
+	kref_put(&priv->ref, ffs_dmabuf_release);
+}
+
+static const char *ffs_dmabuf_get_driver_name(struct dma_fence *fence)
+{
+	return "functionfs";
+}
+
+static const char *ffs_dmabuf_get_timeline_name(struct dma_fence *fence)
+{
+	return "";
+}
+
+static void ffs_dmabuf_fence_release(struct dma_fence *fence)
+{
+	kfree(container_of(fence, struct ffs_dma_fence, base));
+}
+
+static const struct dma_fence_ops ffs_dmabuf_fence_ops = {
+	.get_driver_name	= ffs_dmabuf_get_driver_name,
+	.get_timeline_name	= ffs_dmabuf_get_timeline_name,
+	.release		= ffs_dmabuf_fence_release,
+};
+
+static void ffs_dmabuf_cleanup(struct work_struct *work)
+{
+	struct ffs_dma_fence *dma_fence = container_of(work,
+						       struct ffs_dma_fence,
+						       work);
+
+	usb_ep_free_request(dma_fence->ep, dma_fence->req);
+	ffs_dmabuf_put(dma_fence->priv);
+	dma_fence_put(&dma_fence->base);
+}
+
+static void ffs_dmabuf_signal_done(struct ffs_dma_fence *dma_fence, int ret)
+{
+	struct dma_fence *fence = &dma_fence->base;
+	bool cookie = dma_fence_begin_signalling();
+
+	if (ret)
+		dma_fence_set_error(fence, ret);
+	dma_fence_signal(fence);
+	dma_fence_end_signalling(cookie);
+
+	/* The request can't be freed from its completion handler */
+	INIT_WORK(&dma_fence->work, ffs_dmabuf_cleanup);
+	queue_work(dma_fence->priv->ffs->io_completion_wq, &dma_fence->work);
+}
+
+static void ffs_epfile_dmabuf_io_complete(struct usb_ep *ep,
+					  struct usb_request *req)
+{
+	ENTER();
+
+	pr_vdebug("FFS: dma-buf transfer complete, status=%d\n", req->status);
+	ffs_dmabuf_signal_done(req->context, req->status);
+}
+
+static int ffs_dma_resv_lock(struct dma_buf *dmabuf, bool nonblock)
+{
+	if (nonblock)
+		return dma_resv_trylock(dmabuf->resv) ? 0 : -EBUSY;
+
+	return dma_resv_lock_interruptible(dmabuf->resv, NULL);
+}
+
+/* Takes a reference to the attachment of @dmabuf to @epfile */
+static struct ffs_dmabuf_priv *ffs_dmabuf_find(struct ffs_epfile *epfile,
+					       struct dma_buf *dmabuf)
+{
+	struct ffs_dmabuf_priv *priv;
+
+	mutex_lock(&epfile->dmabufs_mutex);
+	list_for_each_entry(priv, &epfile->dmabufs, entry) {
+		if (priv->attach->dmabuf == dmabuf) {
+			kref_get(&priv->ref);
+			mutex_unlock(&epfile->dmabufs_mutex);
+			return priv;
+		}
+	}
+	mutex_unlock(&epfile->dmabufs_mutex);
+
+	return ERR_PTR(-EPERM);
+}
+
+/* Number of DMA segments covering the first @len bytes of @sgt */
+static int ffs_dmabuf_nents(struct sg_table *sgt, u64 len)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sgtable_dma_sg(sgt, sg, i) {
+		if (len <= sg_dma_len(sg))
+			return i + 1;
+		len -= sg_dma_len(sg);
+	}
+
+	return -EINVAL;
+}
+
+static int ffs_dmabuf_attach(struct file *file, int fd)
+{
+	bool nonblock = !!(file->f_flags & O_NONBLOCK);
+	struct ffs_epfile *epfile = file->private_data;
+	struct usb_gadget *gadget = epfile->ffs->gadget;
+	struct dma_buf_attachment *attach;
+	struct ffs_dmabuf_priv *priv;
+	struct sg_table *sg_table;
+	struct dma_buf *dmabuf;
+	int err;
+
+	if (!gadget || !gadget->sg_supported)
+		return -EPERM;
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	attach = dma_buf_attach(dmabuf, gadget->dev.parent);
+	if (IS_ERR(attach)) {
+		err = PTR_ERR(attach);
+		goto err_dmabuf_put;
+	}
+
+	priv = kzalloc(sizeof(*priv), GFP_KERNEL);
+	if (!priv) {
+		err = -ENOMEM;
+		goto err_dmabuf_detach;
+	}
+
+	/* The direction of the endpoint is only known once it is enabled */
+	err = ffs_dma_resv_lock(dmabuf, nonblock);
+	if (err)
+		goto err_free_priv;
+
+	sg_table = dma_buf_map_attachment(attach, DMA_BIDIRECTIONAL);
+	dma_resv_unlock(dmabuf->resv);
+
+	if (IS_ERR(sg_table)) {
+		err = PTR_ERR(sg_table);
+		goto err_free_priv;
+	}
+
+	attach->importer_priv = priv;
+
+	priv->sgt = sg_table;
+	priv->attach = attach;
+	priv->ffs = epfile->ffs;
+	spin_lock_init(&priv->lock);
+	kref_init(&priv->ref);
+	priv->context = dma_fence_context_alloc(1);
+
+	mutex_lock(&epfile->dmabufs_mutex);
+	list_add(&priv->entry, &epfile->dmabufs);
+	mutex_unlock(&epfile->dmabufs_mutex);
+
+	return 0;
+
+err_free_priv:
+	kfree(priv);
+err_dmabuf_detach:
+	dma_buf_detach(dmabuf, attach);
+err_dmabuf_put:
+	dma_buf_put(dmabuf);
+
+	return err;
+}
+
+static int ffs_dmabuf_detach(struct file *file, int fd)
+{
+	struct ffs_epfile *epfile = file->private_data;
+	struct ffs_dmabuf_priv *priv, *tmp;
+	struct dma_buf *dmabuf;
+	int ret = -EPERM;
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	mutex_lock(&epfile->dmabufs_mutex);
+	list_for_each_entry_safe(priv, tmp, &epfile->dmabufs, entry) {
+		if (priv->attach->dmabuf == dmabuf) {
+			/* Transfers in flight hold their own reference */
+			list_del(&priv->entry);
+			ffs_dmabuf_put(priv);
+			ret = 0;
+			break;
+		}
+	}
+	mutex_unlock(&epfile->dmabufs_mutex);
+
+	dma_buf_put(dmabuf);
+
+	return ret;
+}
+
+static int ffs_dmabuf_transfer(struct file *file,
+			       const struct usb_ffs_dmabuf_transfer_req *req)
+{
+	bool nonblock = !!(file->f_flags & O_NONBLOCK);
+	struct ffs_epfile *epfile = file->private_data;
+	struct ffs_dmabuf_priv *priv;
+	struct ffs_dma_fence *fence;
+	struct usb_request *usb_req;
+	struct dma_buf *dmabuf;
+	struct ffs_ep *ep;
+	bool cookie, in;
+	long retl;
+	int nents;
+	int ret;
+
+	if (req->flags)
+		return -EINVAL;
+
+	dmabuf = dma_buf_get(req->fd);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	if (req->length > dmabuf->size || req->length == 0) {
+		dma_buf_put(dmabuf);
+		return -EINVAL;
+	}
+
+	/* The attachment holds a reference to the dma-buf from now on */
+	priv = ffs_dmabuf_find(epfile, dmabuf);
+	dma_buf_put(dmabuf);
+	if (IS_ERR(priv))
+		return PTR_ERR(priv);
+
+	nents = ffs_dmabuf_nents(priv->sgt, req->length);
+	if (nents < 0) {
+		ret = nents;
+		goto err_priv_put;
+	}
+
+	/* Wait for endpoint to be enabled */
+	ep = epfile->ep;
+	if (!ep) {
+		if (nonblock) {
+			ret = -EAGAIN;
+			goto err_priv_put;
+		}
+
+		ret = wait_event_interruptible(epfile->ffs->wait,
+					       (ep = epfile->ep));
+		if (ret) {
+			ret = -EINTR;
+			goto err_priv_put;
+		}
+	}
+
+	fence = kmalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence) {
+		ret = -ENOMEM;
+		goto err_priv_put;
+	}
+
+	spin_lock_irq(&epfile->ffs->eps_lock);
+	in = epfile->in;
+	spin_unlock_irq(&epfile->ffs->eps_lock);
+
+	ret = ffs_dma_resv_lock(dmabuf, nonblock);
+	if (ret)
+		goto err_fence_free;
+
+	/* Sending waits for the writers of the buffer, receiving for all */
+	retl = dma_resv_wait_timeout_rcu(dmabuf->resv, !in, true,
+			nonblock ? 0 :
+			msecs_to_jiffies(FFS_DMABUF_ENQUEUE_TIMEOUT_MS));
+	if (retl == 0)
+		retl = -EBUSY;
+	if (retl < 0) {
+		ret = (int)retl;
+		goto err_resv_unlock;
+	}
+
+	if (in) {
+		ret = dma_resv_reserve_shared(dmabuf->resv, 1);
+		if (ret)
+			goto err_resv_unlock;
+	}
+
+	spin_lock_irq(&epfile->ffs->eps_lock);
+
+	/* In the meantime, endpoint got disabled or changed. */
+	if (epfile->ep != ep) {
+		ret = -ESHUTDOWN;
+		goto err_eps_unlock;
+	}
+
+	usb_req = usb_ep_alloc_request(ep->ep, GFP_ATOMIC);
+	if (!usb_req) {
+		ret = -ENOMEM;
+		goto err_eps_unlock;
+	}
+
+	fence->priv = priv;
+	fence->ep = ep->ep;
+	fence->req = usb_req;
+	dma_fence_init(&fence->base, &ffs_dmabuf_fence_ops, &priv->lock,
+		       priv->context, atomic_add_return(1, &epfile->seqno));
+
+	if (in)
+		dma_resv_add_shared_fence(dmabuf->resv, &fence->base);
+	else
+		dma_resv_add_excl_fence(dmabuf->resv, &fence->base);
+	dma_resv_unlock(dmabuf->resv);
+
+	/* Now that the fence is in place, queue the transfer */
+	usb_req->length = req->length;
+	usb_req->buf = NULL;
+	usb_req->sg = priv->sgt->sgl;
+	usb_req->num_sgs = nents;
+	usb_req->sg_was_mapped = true;
+	usb_req->context = fence;
+	usb_req->complete = ffs_epfile_dmabuf_io_complete;
+
+	cookie = dma_fence_begin_signalling();
+	ret = usb_ep_queue(ep->ep, usb_req, GFP_ATOMIC);
+	dma_fence_end_signalling(cookie);
+
+	if (ret) {
+		pr_warn("FFS: Failed to queue dma-buf transfer: %d\n", ret);
+		ffs_dmabuf_signal_done(fence, ret);
+	}
+
+	spin_unlock_irq(&epfile->ffs->eps_lock);
+
+	return ret;
+
+err_eps_unlock:
+	spin_unlock_irq(&epfile->ffs->eps_lock);
+err_resv_unlock:
+	dma_resv_unlock(dmabuf->resv);
+err_fence_free:
+	kfree(fence);
+err_priv_put:
+	ffs_dmabuf_put(priv);
+
+	return ret;
+}
+
 static int
 ffs_epfile_release(struct inode *inode, struct file *file)
 {
 	struct ffs_epfile *epfile = inode->i_private;
+	struct ffs_dmabuf_priv *priv, *tmp;
 
 	ENTER();
 
+	mutex_lock(&epfile->dmabufs_mutex);
+	list_for_each_entry_safe(priv, tmp, &epfile->dmabufs, entry) {
+		list_del(&priv->entry);
+		ffs_dmabuf_put(priv);
+	}
+	mutex_unlock(&epfile->dmabufs_mutex);
+
 	__ffs_epfile_read_buffer_free(epfile);
 	ffs_data_closed(epfile->ffs);
 
@@ -1302,6 +1709,38 @@ static long ffs_epfile_ioctl(struct file *file, unsigned code,
 	if (WARN_ON(epfile->ffs->state != FFS_ACTIVE))
 		return -ENODEV;
 
+	switch (code) {
+	case FUNCTIONFS_DMABUF_ATTACH:
+	{
+		int fd;
+
+		if (copy_from_user(&fd, (void __user *)value, sizeof(fd)))
+			return -EFAULT;
+
+		return ffs_dmabuf_attach(file, fd);
+	}
+	case FUNCTIONFS_DMABUF_DETACH:
+	{
+		int fd;
+
+		if (copy_from_user(&fd, (void __user *)value, sizeof(fd)))
+			return -EFAULT;
+
+		return ffs_dmabuf_detach(file, fd);
+	}
+	case FUNCTIONFS_DMABUF_TRANSFER:
+	{
+		struct usb_ffs_dmabuf_transfer_req req;
+
+		if (copy_from_user(&req, (void __user *)value, sizeof(req)))
+			return -EFAULT;
+
+		return ffs_dmabuf_transfer(file, &req);
+	}
+	default:
+		break;
+	}
+
 	/* Wait for endpoint to be enabled */
 	ep = epfile->ep;
 	if (!ep) {
@@ -1924,6 +2363,8 @@ static int ffs_epfiles_create(struct ffs_data *ffs)
 	for (i = 1; i <= count; ++i, ++epfile) {
 		epfile->ffs = ffs;
 		mutex_init(&epfile->mutex);
+		mutex_init(&epfile->dmabufs_mutex);
+		INIT_LIST_HEAD(&epfile->dmabufs);
 		if (ffs->user_flags & FUNCTIONFS_VIRTUAL_ADDR)
 			sprintf(epfile->name, "ep%02x", ffs->eps_addrmap[i]);
 		else
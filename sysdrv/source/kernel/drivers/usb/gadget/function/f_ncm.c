@@ -71,7 +71,9 @@ struct f_ncm {
 	/* For multi-frame NDP TX */
 	struct sk_buff			*skb_tx_data;
 	struct sk_buff			*skb_tx_ndp;
+	struct sk_buff			*skb_tx_last;
 	u16				ndp_dgram_count;
+	bool				tx_chain;
 	bool				timer_force_tx;
 	struct hrtimer			task_timer;
 	bool				timer_stopping;
@@ -106,18 +108,30 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
 #define NTB_DEFAULT_IN_SIZE	16384
 #define NTB_OUT_SIZE		16384
 
-/* Allocation for storing the NDP, 32 should suffice for a
- * 16k packet. This allows a maximum of 32 * 507 Byte packets to
- * be transmitted in a single 16kB skb, though when sending full size
+/*
+ * When the UDC does scatter-gather the datagrams are chained to the NTB
+ * instead of being copied into one buffer, so the host may pick bigger
+ * NTBs without the gadget allocating them in one piece.
+ */
+#define NTB_CHAIN_IN_SIZE	32768
+
+/* Allocation for storing the NDP, 64 should suffice for a
+ * 32k packet. This allows a maximum of 64 * 507 Byte packets to
+ * be transmitted in a single 32kB NTB, though when sending full size
  * packets this limit will be plenty.
  * Smaller packets are not likely to be trying to maximize the
  * throughput and will be mstly sending smaller infrequent frames.
  */
-#define TX_MAX_NUM_DPE		32
+#define TX_MAX_NUM_DPE		64
 
 /* Delay for the transmit to wait before sending an unfilled NTB frame. */
 #define TX_TIMEOUT_NSECS	300000
 
+/* Received datagrams up to this size are copied, longer ones only have
+ * their headers copied and the rest attached as a page fragment.
+ */
+#define NCM_RX_COPYBREAK	128
+
 #define FORMATS_SUPPORTED	(USB_CDC_NCM_NTB16_SUPPORTED |	\
 				 USB_CDC_NCM_NTB32_SUPPORTED)
 
@@ -524,6 +538,11 @@ static inline unsigned get_ncm(__le16 **p, unsigned size)
 
 /*-------------------------------------------------------------------------*/
 
+static inline unsigned ncm_ntb_in_max(struct f_ncm *ncm)
+{
+	return ncm->tx_chain ? NTB_CHAIN_IN_SIZE : NTB_DEFAULT_IN_SIZE;
+}
+
 static inline void ncm_reset_values(struct f_ncm *ncm)
 {
 	ncm->parser_opts = &ndp16_opts;
@@ -669,7 +688,7 @@ static void ncm_ep0out_complete(struct usb_ep *ep, struct usb_request *req)
 
 	in_size = get_unaligned_le32(req->buf);
 	if (in_size < USB_CDC_NCM_NTB_MIN_IN_SIZE ||
-	    in_size > le32_to_cpu(ntb_parameters.dwNtbInMaxSize)) {
+	    in_size > ncm_ntb_in_max(ncm)) {
 		DBG(cdev, "Got wrong INPUT SIZE (%d) from host\n", in_size);
 		goto invalid;
 	}
@@ -726,15 +745,18 @@ static int ncm_setup(struct usb_function *f, const struct usb_ctrlrequest *ctrl)
 	 */
 
 	case ((USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE) << 8)
-		| USB_CDC_GET_NTB_PARAMETERS:
+		| USB_CDC_GET_NTB_PARAMETERS: {
+		struct usb_cdc_ncm_ntb_parameters params = ntb_parameters;
 
 		if (w_length == 0 || w_value != 0 || w_index != ncm->ctrl_id)
 			goto invalid;
-		value = w_length > sizeof ntb_parameters ?
-			sizeof ntb_parameters : w_length;
-		memcpy(req->buf, &ntb_parameters, value);
+		params.dwNtbInMaxSize = cpu_to_le32(ncm_ntb_in_max(ncm));
+		value = w_length > sizeof params ?
+			sizeof params : w_length;
+		memcpy(req->buf, &params, value);
 		VDBG(cdev, "Host asked NTB parameters\n");
 		break;
+	}
 
 	case ((USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE) << 8)
 		| USB_CDC_GET_NTB_INPUT_SIZE:
@@ -955,6 +977,22 @@ static int ncm_get_alt(struct usb_function *f, unsigned intf)
 	return ncm->port.in_ep->enabled ? 1 : 0;
 }
 
+/* Append @skb to the frag_list of the NTB being built */
+static void ncm_tx_chain(struct f_ncm *ncm, struct sk_buff *skb)
+{
+	struct sk_buff	*head = ncm->skb_tx_data;
+
+	if (ncm->skb_tx_last)
+		ncm->skb_tx_last->next = skb;
+	else
+		skb_shinfo(head)->frag_list = skb;
+	ncm->skb_tx_last = skb;
+
+	head->len += skb->len;
+	head->data_len += skb->len;
+	head->truesize += skb->truesize;
+}
+
 static struct sk_buff *package_for_tx(struct f_ncm *ncm)
 {
 	__le16		*ntb_iter;
@@ -991,6 +1029,17 @@ static struct sk_buff *package_for_tx(struct f_ncm *ncm)
 	ntb_iter += 2;
 	put_unaligned_le16(new_len, ntb_iter);
 
+	/* Chain the NDP after the datagrams */
+	if (ncm->tx_chain) {
+		memset(skb_push(ncm->skb_tx_ndp, ndp_pad), 0, ndp_pad);
+		skb_put_zero(ncm->skb_tx_ndp, dgram_idx_len);
+		ncm_tx_chain(ncm, ncm->skb_tx_ndp);
+		ncm->skb_tx_ndp = NULL;
+		ncm->skb_tx_last = NULL;
+		swap(skb2, ncm->skb_tx_data);
+		return skb2;
+	}
+
 	/* Merge the skbs */
 	swap(skb2, ncm->skb_tx_data);
 	if (ncm->skb_tx_data) {
@@ -1066,8 +1115,12 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 			dgram_pad = ALIGN(ncb_len, div) + rem - ncb_len;
 			ncb_len += dgram_pad;
 
-			/* Create a new skb for the NTH and datagrams. */
-			ncm->skb_tx_data = alloc_skb(max_size, GFP_ATOMIC);
+			/* Create a new skb for the NTH and datagrams,
+			 * datagrams chained to it need only the NTH.
+			 */
+			ncm->skb_tx_data = alloc_skb(ncm->tx_chain ?
+						     ncb_len : max_size,
+						     GFP_ATOMIC);
 			if (!ncm->skb_tx_data)
 				goto err;
 
@@ -1083,13 +1136,16 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 			 * TX_MAX_NUM_DPE should easily suffice for a
 			 * 16k packet.
 			 */
-			ncm->skb_tx_ndp = alloc_skb((int)(opts->ndp_size
+			ncm->skb_tx_ndp = alloc_skb((int)(ndp_align
+						    + opts->ndp_size
 						    + opts->dpe_size
 						    * TX_MAX_NUM_DPE),
 						    GFP_ATOMIC);
 			if (!ncm->skb_tx_ndp)
 				goto err;
 
+			/* Headroom for the NDP alignment when chained */
+			skb_reserve(ncm->skb_tx_ndp, ndp_align);
 			ncm->skb_tx_ndp->dev = ncm->netdev;
 			ntb_ndp = skb_put(ncm->skb_tx_ndp, opts->ndp_size);
 			memset(ntb_ndp, 0, ncb_len);
@@ -1121,9 +1177,16 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		ncm->ndp_dgram_count++;
 
 		/* Add the new data to the skb */
-		skb_put_zero(ncm->skb_tx_data, dgram_pad);
-		skb_put_data(ncm->skb_tx_data, skb->data, skb->len);
-		dev_consume_skb_any(skb);
+		if (ncm->tx_chain) {
+			if (skb_cow_head(skb, dgram_pad))
+				goto err;
+			memset(skb_push(skb, dgram_pad), 0, dgram_pad);
+			ncm_tx_chain(ncm, skb);
+		} else {
+			skb_put_zero(ncm->skb_tx_data, dgram_pad);
+			skb_put_data(ncm->skb_tx_data, skb->data, skb->len);
+			dev_consume_skb_any(skb);
+		}
 		skb = NULL;
 
 	} else if (ncm->skb_tx_data && ncm->timer_force_tx) {
@@ -1140,10 +1203,15 @@ err:
 
 	if (skb)
 		dev_kfree_skb_any(skb);
-	if (ncm->skb_tx_data)
+	if (ncm->skb_tx_data) {
 		dev_kfree_skb_any(ncm->skb_tx_data);
-	if (ncm->skb_tx_ndp)
+		ncm->skb_tx_data = NULL;
+	}
+	if (ncm->skb_tx_ndp) {
 		dev_kfree_skb_any(ncm->skb_tx_ndp);
+		ncm->skb_tx_ndp = NULL;
+	}
+	ncm->skb_tx_last = NULL;
 
 	return NULL;
 }
@@ -1173,6 +1241,35 @@ static enum hrtimer_restart ncm_tx_timeout(struct hrtimer *data)
 	return HRTIMER_NORESTART;
 }
 
+/*
+ * Build the skb of a received datagram. The RX buffer is page backed, see
+ * gether.rx_frags, so the payload of long datagrams is referenced in place.
+ */
+static struct sk_buff *ncm_rx_dgram(struct f_ncm *ncm, struct sk_buff *skb,
+				    unsigned index, unsigned len)
+{
+	unsigned	hlen = len;
+	struct sk_buff	*skb2;
+
+	if (skb->head_frag && len > NCM_RX_COPYBREAK)
+		hlen = NCM_RX_COPYBREAK;
+
+	skb2 = netdev_alloc_skb_ip_align(ncm->netdev, hlen);
+	if (skb2 == NULL)
+		return NULL;
+	skb_put_data(skb2, skb->data + index, hlen);
+
+	if (hlen < len) {
+		void		*data = skb->data + index + hlen;
+		struct page	*page = virt_to_head_page(data);
+
+		get_page(page);
+		skb_add_rx_frag(skb2, 0, page, data - page_address(page),
+				len - hlen, len - hlen);
+	}
+	return skb2;
+}
+
 static int ncm_unwrap_ntb(struct gether *port,
 			  struct sk_buff *skb,
 			  struct sk_buff_head *list)
@@ -1318,15 +1415,12 @@ static int ncm_unwrap_ntb(struct gether *port,
 			}
 
 			/*
-			 * Copy the data into a new skb.
-			 * This ensures the truesize is correct
+			 * Copy the headers into a new skb and reference
+			 * the rest, the truesize is that of the datagram.
 			 */
-			skb2 = netdev_alloc_skb_ip_align(ncm->netdev,
-							 dg_len - crc_len);
+			skb2 = ncm_rx_dgram(ncm, skb, index, dg_len - crc_len);
 			if (skb2 == NULL)
 				goto err;
-			skb_put_data(skb2, skb->data + index,
-				     dg_len - crc_len);
 
 			skb_queue_tail(list, skb2);
 
@@ -1428,6 +1522,8 @@ static int ncm_bind(struct usb_configuration *c, struct usb_function *f)
 	if (!can_support_ecm(cdev->gadget))
 		return -EINVAL;
 
+	ncm->tx_chain = cdev->gadget->sg_supported;
+
 	ncm_opts = container_of(f->fi, struct f_ncm_opts, func_inst);
 
 	if (cdev->use_os_string) {
@@ -1726,6 +1822,7 @@ static struct usb_function *ncm_alloc(struct usb_function_instance *fi)
 	mutex_unlock(&opts->lock);
 	ncm->port.is_fixed = true;
 	ncm->port.supports_multi_frame = true;
+	ncm->port.rx_frags = true;
 
 	ncm->port.func.name = "cdc_network";
 	/* descriptors are per-instance copies */
@@ -1714,6 +1714,8 @@ static int f_audio_bind(struct usb_configuration *c, struct usb_function *f)
 	}
 	audio->params.req_number = audio_opts->req_number;
 	audio->params.fb_max = FBACK_FAST_MAX;
+	audio->params.p_zero_copy = audio_opts->p_zero_copy;
+	audio->params.pitch_auto = audio_opts->pitch_auto;
 	if (FUOUT_EN(audio_opts) || FUIN_EN(audio_opts))
 		audio->notify = audio_notify;
 
@@ -1908,6 +1910,8 @@ UAC1_ATTRIBUTE(u32, p_chmask);
 UAC1_RATE_ATTRIBUTE(p_srate);
 UAC1_ATTRIBUTE(u32, p_ssize);
 UAC1_ATTRIBUTE(u32, req_number);
+UAC1_ATTRIBUTE(bool, p_zero_copy);
+UAC1_ATTRIBUTE(bool, pitch_auto);
 
 UAC1_ATTRIBUTE(bool, p_mute_present);
 UAC1_ATTRIBUTE(bool, p_volume_present);
@@ -1930,6 +1934,8 @@ static struct configfs_attribute *f_uac1_attrs[] = {
 	&f_uac1_opts_attr_p_srate,
 	&f_uac1_opts_attr_p_ssize,
 	&f_uac1_opts_attr_req_number,
+	&f_uac1_opts_attr_p_zero_copy,
+	&f_uac1_opts_attr_pitch_auto,
 
 	&f_uac1_opts_attr_p_mute_present,
 	&f_uac1_opts_attr_p_volume_present,
@@ -1322,6 +1322,8 @@ afunc_bind(struct usb_configuration *cfg, struct usb_function *fn)
 	}
 	agdev->params.req_number = uac2_opts->req_number;
 	agdev->params.fb_max = uac2_opts->fb_max;
+	agdev->params.p_zero_copy = uac2_opts->p_zero_copy;
+	agdev->params.pitch_auto = uac2_opts->pitch_auto;
 
 	if (FUOUT_EN(uac2_opts) || FUIN_EN(uac2_opts))
     agdev->notify = afunc_notify;
@@ -2092,6 +2094,8 @@ UAC2_ATTRIBUTE(s16, c_volume_min);
 UAC2_ATTRIBUTE(s16, c_volume_max);
 UAC2_ATTRIBUTE(s16, c_volume_res);
 UAC2_ATTRIBUTE(u32, fb_max);
+UAC2_ATTRIBUTE(bool, p_zero_copy);
+UAC2_ATTRIBUTE(bool, pitch_auto);
 UAC2_ATTRIBUTE_STRING(function_name);
 
 static struct configfs_attribute *f_uac2_attrs[] = {
@@ -2106,6 +2110,8 @@ static struct configfs_attribute *f_uac2_attrs[] = {
 	&f_uac2_opts_attr_c_sync,
 	&f_uac2_opts_attr_req_number,
 	&f_uac2_opts_attr_fb_max,
+	&f_uac2_opts_attr_p_zero_copy,
+	&f_uac2_opts_attr_pitch_auto,
 
 	&f_uac2_opts_attr_p_mute_present,
 	&f_uac2_opts_attr_p_volume_present,
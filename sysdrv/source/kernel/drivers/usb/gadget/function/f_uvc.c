@@ -6,6 +6,7 @@
  *	    Laurent Pinchart (laurent.pinchart@ideasonboard.com)
  */
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/errno.h>
 #include <linux/fs.h>
@@ -14,6 +15,7 @@
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/string.h>
+#include <linux/usb.h>
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
 #include <linux/usb/g_uvc.h>
@@ -26,6 +28,7 @@
 
 #include "u_uvc.h"
 #include "uvc.h"
+#include "uvc_bind.h"
 #include "uvc_configfs.h"
 #include "uvc_v4l2.h"
 #include "uvc_video.h"
@@ -579,6 +582,32 @@ static ssize_t function_name_show(struct device *dev,
 
 static DEVICE_ATTR_RO(function_name);
 
+/*
+ * Cumulative "<requests> <bytes> <underruns> <errors>" of the video stream,
+ * for applications that adapt the encoder bitrate to what the host takes.
+ */
+static ssize_t stream_stats_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct uvc_device *uvc = dev_get_drvdata(dev);
+	struct uvc_video *video = &uvc->video;
+	unsigned long flags;
+	u64 req_done, bytes_done;
+	u32 underruns, req_errors;
+
+	spin_lock_irqsave(&video->req_lock, flags);
+	req_done = video->req_done;
+	bytes_done = video->bytes_done;
+	underruns = video->underruns;
+	req_errors = video->req_errors;
+	spin_unlock_irqrestore(&video->req_lock, flags);
+
+	return sprintf(buf, "%llu %llu %u %u\n", req_done, bytes_done,
+		       underruns, req_errors);
+}
+
+static DEVICE_ATTR_RO(stream_stats);
+
 static int
 uvc_register_video(struct uvc_device *uvc)
 {
@@ -607,6 +636,17 @@ uvc_register_video(struct uvc_device *uvc)
 		return ret;
 	}
 
+	ret = device_create_file(&uvc->vdev.dev, &dev_attr_stream_stats);
+	if (ret < 0) {
+		device_remove_file(&uvc->vdev.dev, &dev_attr_function_name);
+		video_unregister_device(&uvc->vdev);
+		return ret;
+	}
+
+	uvc->debugfs = debugfs_create_dir(dev_name(&uvc->vdev.dev),
+					  usb_debug_root);
+	uvcg_video_debugfs_init(&uvc->video, uvc->debugfs);
+
 	return 0;
 }
 
@@ -1043,6 +1083,7 @@ static void uvc_free_inst(struct usb_function_instance *f)
 {
 	struct f_uvc_opts *opts = fi_to_f_uvc_opts(f);
 
+	uvcg_bind_destroy(opts->bind);
 	mutex_destroy(&opts->lock);
 
 #if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
@@ -1175,8 +1216,15 @@ static struct usb_function_instance *uvc_alloc_inst(void)
 	opts->pm_qos_latency = 0;
 	snprintf(opts->function_name, sizeof(opts->function_name), "UVC Camera");
 
+	opts->bind = uvcg_bind_create(&opts->func_inst);
+	if (!opts->bind) {
+		kfree(opts);
+		return ERR_PTR(-ENOMEM);
+	}
+
 	ret = uvcg_attach_configfs(opts);
 	if (ret < 0) {
+		uvcg_bind_destroy(opts->bind);
 		kfree(opts);
 		return ERR_PTR(ret);
 	}
@@ -1189,6 +1237,8 @@ static void uvc_free(struct usb_function *f)
 	struct uvc_device *uvc = to_uvc(f);
 	struct f_uvc_opts *opts = container_of(f->fi, struct f_uvc_opts,
 					       func_inst);
+
+	uvcg_bind_detach(opts->bind, uvc);
 	--opts->refcnt;
 	kfree(uvc);
 }
@@ -1214,6 +1264,9 @@ static void uvc_function_unbind(struct usb_configuration *c,
 		uvcg_dbg(f, "done waiting with ret: %ld\n", wait_ret);
 	}
 
+	debugfs_remove_recursive(uvc->debugfs);
+	uvc->debugfs = NULL;
+	device_remove_file(&uvc->vdev.dev, &dev_attr_stream_stats);
 	device_remove_file(&uvc->vdev.dev, &dev_attr_function_name);
 	video_unregister_device(&uvc->vdev);
 	v4l2_device_unregister(&uvc->v4l2_dev);
@@ -1288,6 +1341,8 @@ static struct usb_function *uvc_alloc(struct usb_function_instance *fi)
 	uvc->func.resume = uvc_function_resume;
 	uvc->func.bind_deactivated = true;
 
+	uvcg_bind_attach(opts->bind, uvc);
+
 	return &uvc->func;
 }
 
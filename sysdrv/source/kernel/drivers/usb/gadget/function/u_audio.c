@@ -13,7 +13,9 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/module.h>
+#include <linux/wait.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -57,6 +59,14 @@ struct uac_rtd_params {
 	struct usb_request *req_fback; /* Feedback endpoint request */
 	bool fb_ep_enabled; /* if the ep is enabled */
 
+	/* Zero copy playback, see u_audio_iso_complete_zero_copy() */
+	bool zero_copy;
+	ssize_t q_ptr;	/* ring position of the next request */
+	unsigned int *slot_bytes; /* ring bytes in flight per request slot */
+	unsigned int slot; /* slot of the next request to complete */
+	atomic_t ring_reqs; /* requests sending from the ring */
+	wait_queue_head_t ring_wq;
+
   /* Volume/Mute controls and their state */
   int fu_id; /* Feature Unit ID */
   struct snd_kcontrol *snd_kctl_volume;
@@ -150,6 +160,157 @@ static void u_audio_set_fback_frequency(enum usb_device_speed speed,
 	*(__le32 *)buf = cpu_to_le32(ff);
 }
 
+/*
+ * Pitch matching the host clock measured by ppm_calculate_work(). A host
+ * running ppm faster than us carries that much less of our audio per frame.
+ */
+static unsigned int u_audio_ppm_pitch(struct uac_params *params)
+{
+	s64 pitch;
+
+	if (!params->pitch_auto || !params->ppm)
+		return 1000000;
+
+	pitch = div_s64(1000000LL * 1000000, 1000000 + params->ppm);
+
+	return clamp_t(s64, pitch, (1000 - FBACK_SLOW_MAX) * 1000,
+		       (1000 + params->fb_max) * 1000);
+}
+
+/* Size of the next IN packet, following the pitched playback rate */
+static unsigned int u_audio_p_pktsize(struct snd_uac_chip *uac,
+				      struct uac_rtd_params *prm,
+				      struct usb_ep *ep)
+{
+	unsigned long long p_interval_mil = uac->p_interval * 1000000ULL;
+	unsigned long long pitched_rate_mil, p_pktsize_residue_mil,
+			residue_frames_mil, div_result;
+	unsigned int frames, p_pktsize;
+
+	/*
+	 * For each IN packet, take the quotient of the current data
+	 * rate and the endpoint's interval as the base packet size.
+	 * If there is a residue from this division, add it to the
+	 * residue accumulator.
+	 */
+	pitched_rate_mil = (unsigned long long) prm->srate * prm->pitch;
+	div_result = pitched_rate_mil;
+	do_div(div_result, uac->p_interval);
+	do_div(div_result, 1000000);
+	frames = (unsigned int) div_result;
+
+	pr_debug("p_srate %d, pitch %d, interval_mil %llu, frames %d\n",
+			prm->srate, prm->pitch, p_interval_mil, frames);
+
+	p_pktsize = min_t(unsigned int,
+				uac->p_framesize * frames,
+				ep->maxpacket);
+
+	if (p_pktsize < ep->maxpacket) {
+		residue_frames_mil = pitched_rate_mil - frames * p_interval_mil;
+		p_pktsize_residue_mil = uac->p_framesize * residue_frames_mil;
+	} else
+		p_pktsize_residue_mil = 0;
+
+	uac->p_residue_mil += p_pktsize_residue_mil;
+
+	/*
+	 * Whenever there are more bytes in the accumulator p_residue_mil than we
+	 * need to add one more sample frame, increase this packet's
+	 * size and decrease the accumulator.
+	 */
+	div_result = uac->p_residue_mil;
+	do_div(div_result, uac->p_interval);
+	do_div(div_result, 1000000);
+	if ((unsigned int) div_result >= uac->p_framesize) {
+		p_pktsize += uac->p_framesize;
+		uac->p_residue_mil -= uac->p_framesize * p_interval_mil;
+		pr_debug("increased req length to %d\n", p_pktsize);
+	}
+	pr_debug("remains uac->p_residue_mil %llu\n", uac->p_residue_mil);
+
+	return p_pktsize;
+}
+
+/*
+ * Zero copy playback: IN requests are sent straight from the ALSA ring and
+ * their data is only consumed from it once they complete, so the application
+ * can't overwrite it while the controller reads it. A packet wrapping around
+ * the end of the ring is copied to the buffer of its request slot instead.
+ *
+ * Isochronous requests complete in the order they were queued, so every
+ * request is requeued in the slot it completes from.
+ */
+static void u_audio_iso_complete_zero_copy(struct usb_ep *ep,
+					   struct usb_request *req)
+{
+	struct uac_rtd_params *prm = req->context;
+	struct snd_uac_chip *uac = prm->uac;
+	struct snd_pcm_substream *substream;
+	struct snd_pcm_runtime *runtime;
+	unsigned int slot = prm->slot;
+	void *slot_buf = prm->rbuf + slot * ep->maxpacket;
+	unsigned int done, pending;
+	bool elapsed = false;
+
+	prm->slot = (slot + 1) % uac->audio_dev->params.req_number;
+	done = prm->slot_bytes[slot];
+	prm->slot_bytes[slot] = 0;
+	if (done && atomic_dec_and_test(&prm->ring_reqs))
+		wake_up(&prm->ring_wq);
+
+	/* Send silence, the slot buffers are cleared when playback stops */
+	req->buf = slot_buf;
+
+	substream = prm->ss;
+	if (!substream)
+		goto exit;
+
+	snd_pcm_stream_lock(substream);
+
+	runtime = substream->runtime;
+	if (!runtime || !snd_pcm_running(substream)) {
+		snd_pcm_stream_unlock(substream);
+		goto exit;
+	}
+
+	if (done) {
+		prm->hw_ptr = (prm->hw_ptr + done) % runtime->dma_bytes;
+		elapsed = (prm->hw_ptr % snd_pcm_lib_period_bytes(substream)) <
+			  done;
+	}
+
+	req->length = u_audio_p_pktsize(uac, prm, ep);
+	req->actual = req->length;
+
+	pending = runtime->dma_bytes - prm->q_ptr;
+	if (unlikely(pending < req->length)) {
+		memcpy(slot_buf, runtime->dma_area + prm->q_ptr, pending);
+		memcpy(slot_buf + pending, runtime->dma_area,
+		       req->length - pending);
+	} else {
+		req->buf = runtime->dma_area + prm->q_ptr;
+	}
+	prm->q_ptr = (prm->q_ptr + req->length) % runtime->dma_bytes;
+
+	prm->slot_bytes[slot] = req->length;
+	atomic_inc(&prm->ring_reqs);
+	snd_pcm_stream_unlock(substream);
+
+	if (elapsed)
+		snd_pcm_period_elapsed(substream);
+
+exit:
+	if (usb_ep_queue(ep, req, GFP_ATOMIC)) {
+		dev_err(uac->card->dev, "%d Error!\n", __LINE__);
+		if (prm->slot_bytes[slot]) {
+			prm->slot_bytes[slot] = 0;
+			if (atomic_dec_and_test(&prm->ring_reqs))
+				wake_up(&prm->ring_wq);
+		}
+	}
+}
+
 static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	unsigned int pending;
@@ -159,9 +320,6 @@ static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 	struct snd_pcm_runtime *runtime;
 	struct uac_rtd_params *prm = req->context;
 	struct snd_uac_chip *uac = prm->uac;
-	unsigned int frames, p_pktsize;
-	unsigned long long pitched_rate_mil, p_pktsize_residue_mil,
-			residue_frames_mil, div_result;
 
 	/* i/f shutting down */
 	if (!prm->ep_enabled) {
@@ -180,6 +338,11 @@ static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 		pr_debug("%s: iso_complete status(%d) %d/%d\n",
 			__func__, status, req->actual, req->length);
 
+	if (prm->zero_copy) {
+		u_audio_iso_complete_zero_copy(ep, req);
+		return;
+	}
+
 	substream = prm->ss;
 
 	/* Do nothing if ALSA isn't active */
@@ -195,51 +358,7 @@ static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 	}
 
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
-		/*
-		 * For each IN packet, take the quotient of the current data
-		 * rate and the endpoint's interval as the base packet size.
-		 * If there is a residue from this division, add it to the
-		 * residue accumulator.
-		 */
-		unsigned long long p_interval_mil = uac->p_interval * 1000000ULL;
-
-		pitched_rate_mil = (unsigned long long) prm->srate * prm->pitch;
-		div_result = pitched_rate_mil;
-		do_div(div_result, uac->p_interval);
-		do_div(div_result, 1000000);
-		frames = (unsigned int) div_result;
-
-		pr_debug("p_srate %d, pitch %d, interval_mil %llu, frames %d\n",
-				prm->srate, prm->pitch, p_interval_mil, frames);
-
-		p_pktsize = min_t(unsigned int,
-					uac->p_framesize * frames,
-					ep->maxpacket);
-
-		if (p_pktsize < ep->maxpacket) {
-			residue_frames_mil = pitched_rate_mil - frames * p_interval_mil;
-			p_pktsize_residue_mil = uac->p_framesize * residue_frames_mil;
-		} else
-			p_pktsize_residue_mil = 0;
-
-		req->length = p_pktsize;
-		uac->p_residue_mil += p_pktsize_residue_mil;
-
-		/*
-		 * Whenever there are more bytes in the accumulator p_residue_mil than we
-		 * need to add one more sample frame, increase this packet's
-		 * size and decrease the accumulator.
-		 */
-		div_result = uac->p_residue_mil;
-		do_div(div_result, uac->p_interval);
-		do_div(div_result, 1000000);
-		if ((unsigned int) div_result >= uac->p_framesize) {
-			req->length += uac->p_framesize;
-			uac->p_residue_mil -= uac->p_framesize * p_interval_mil;
-			pr_debug("increased req length to %d\n", req->length);
-		}
-		pr_debug("remains uac->p_residue_mil %llu\n", uac->p_residue_mil);
-
+		req->length = u_audio_p_pktsize(uac, prm, ep);
 		req->actual = req->length;
 	}
 
@@ -333,6 +452,7 @@ static int uac_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 
 	/* Reset */
 	prm->hw_ptr = 0;
+	prm->q_ptr = 0;
 
 	switch (cmd) {
 	case SNDRV_PCM_TRIGGER_START:
@@ -427,6 +547,22 @@ static int uac_pcm_open(struct snd_pcm_substream *substream)
 	return 0;
 }
 
+/* The ring must not be freed while zero copy requests are sending from it */
+static int uac_pcm_sync_stop(struct snd_pcm_substream *substream)
+{
+	struct snd_uac_chip *uac = snd_pcm_substream_chip(substream);
+	struct uac_rtd_params *prm = &uac->p_prm;
+
+	if (substream->stream != SNDRV_PCM_STREAM_PLAYBACK || !prm->zero_copy)
+		return 0;
+
+	if (!wait_event_timeout(prm->ring_wq, !atomic_read(&prm->ring_reqs),
+				msecs_to_jiffies(100)))
+		dev_warn(uac->card->dev, "playback requests still pending\n");
+
+	return 0;
+}
+
 /* ALSA cries without these function pointers */
 static int uac_pcm_null(struct snd_pcm_substream *substream)
 {
@@ -439,6 +575,7 @@ static const struct snd_pcm_ops uac_pcm_ops = {
 	.trigger = uac_pcm_trigger,
 	.pointer = uac_pcm_pointer,
 	.prepare = uac_pcm_null,
+	.sync_stop = uac_pcm_sync_stop,
 };
 
 static inline void free_ep(struct uac_rtd_params *prm, struct usb_ep *ep)
@@ -673,9 +810,9 @@ int u_audio_start_capture(struct g_audio *audio_dev)
 	/*
 	 * Configure the feedback endpoint's reported frequency.
 	 * Always start with original frequency since its deviation can't
-	 * be meauserd at start of playback
+	 * be meauserd at start of playback, unless it follows the ppm
 	 */
-	prm->pitch = 1000000;
+	prm->pitch = u_audio_ppm_pitch(params);
 	u_audio_set_fback_frequency(audio_dev->gadget->speed, ep,
 				    prm->srate, prm->pitch,
 				    req_fback->buf);
@@ -736,9 +873,9 @@ int u_audio_start_playback(struct g_audio *audio_dev)
 
 	ep_desc = ep->desc;
 	/*
-	 * Always start with original frequency
+	 * Always start with original frequency, unless it follows the ppm
 	 */
-	prm->pitch = 1000000;
+	prm->pitch = u_audio_ppm_pitch(params);
 
 	/* pre-calculate the playback endpoint's interval */
 	if (gadget->speed == USB_SPEED_FULL)
@@ -758,6 +895,13 @@ int u_audio_start_playback(struct g_audio *audio_dev)
 	req_len = p_pktsize;
 	uac->p_residue_mil = 0;
 
+	if (prm->zero_copy) {
+		prm->slot = 0;
+		memset(prm->slot_bytes, 0,
+		       params->req_number * sizeof(*prm->slot_bytes));
+		atomic_set(&prm->ring_reqs, 0);
+	}
+
 	prm->ep_enabled = true;
 	usb_ep_enable(ep);
 
@@ -793,6 +937,12 @@ void u_audio_stop_playback(struct g_audio *audio_dev)
 	set_active(&uac->p_prm, false);
 	free_ep(&uac->p_prm, audio_dev->in_ep);
 
+	/* The requests are gone, don't wait for them in sync_stop */
+	if (uac->p_prm.zero_copy) {
+		atomic_set(&uac->p_prm.ring_reqs, 0);
+		wake_up(&uac->p_prm.ring_wq);
+	}
+
 	audio_dev->usb_state[SET_INTERFACE_IN] = true;
 	audio_dev->stream_state[STATE_IN] = false;
 	schedule_work(&audio_dev->work);
@@ -1305,6 +1455,7 @@ static void ppm_calculate_work(struct work_struct *data)
 	struct frame_number_data *fn = g_audio->fn;
 	uint64_t time_now, time_msec_tmp;
 	int32_t ppm;
+	unsigned int pitch;
 	static int32_t ppms[CLK_PPM_GROUP_SIZE];
 	static int32_t ppm_sum;
 	int32_t cnt = fn->second % CLK_PPM_GROUP_SIZE;
@@ -1390,6 +1541,12 @@ static void ppm_calculate_work(struct work_struct *data)
 			g_audio->params.ppm = ppm;
 			g_audio->usb_state[SET_AUDIO_CLK] = true;
 			schedule_work(&g_audio->work);
+
+			if (g_audio->params.pitch_auto) {
+				pitch = u_audio_ppm_pitch(&g_audio->params);
+				g_audio->uac->p_prm.pitch = pitch;
+				g_audio->uac->c_prm.pitch = pitch;
+			}
 		}
 	}
 
@@ -1475,6 +1632,18 @@ int g_audio_setup(struct g_audio *g_audio, const char *pcm_name,
 			err = -ENOMEM;
 			goto fail;
 		}
+
+		if (params->p_zero_copy) {
+			prm->slot_bytes = kcalloc(params->req_number,
+						  sizeof(*prm->slot_bytes),
+						  GFP_KERNEL);
+			if (!prm->slot_bytes) {
+				err = -ENOMEM;
+				goto fail;
+			}
+			init_waitqueue_head(&prm->ring_wq);
+			prm->zero_copy = true;
+		}
 	}
 
 	/* Choose any slot, with no id */
@@ -1669,6 +1838,7 @@ fail:
 	kfree(uac->c_prm.reqs);
 	kfree(uac->p_prm.rbuf);
 	kfree(uac->c_prm.rbuf);
+	kfree(uac->p_prm.slot_bytes);
 	kfree(uac);
 	kfree(g_audio->fn);
 
@@ -1698,6 +1868,7 @@ void g_audio_cleanup(struct g_audio *g_audio)
 	kfree(uac->c_prm.reqs);
 	kfree(uac->p_prm.rbuf);
 	kfree(uac->c_prm.rbuf);
+	kfree(uac->p_prm.slot_bytes);
 	kfree(uac);
 	kfree(g_audio->fn);
 }
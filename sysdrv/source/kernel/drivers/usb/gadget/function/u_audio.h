@@ -57,6 +57,8 @@ struct uac_params {
 
 	int req_number; /* number of preallocated requests */
 	int fb_max;	/* upper frequency drift feedback limit per-mil */
+	bool p_zero_copy;	/* playback requests point into the ALSA ring */
+	bool pitch_auto;	/* set the pitches from the measured ppm */
 };
 
 enum usb_state_index {
@@ -17,6 +17,7 @@
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
 #include <linux/if_vlan.h>
+#include <linux/scatterlist.h>
 
 #include "u_ether.h"
 
@@ -173,6 +174,33 @@ static void defer_kevent(struct eth_dev *dev, int flag)
 
 static void rx_complete(struct usb_ep *ep, struct usb_request *req);
 
+/*
+ * RX buffer in its own (compound) pages, so that unwrap can hand parts of it
+ * up the stack as page fragments instead of copying them out.
+ */
+static struct sk_buff *rx_alloc_frag_skb(struct eth_dev *dev, size_t size,
+					 gfp_t gfp_flags)
+{
+	unsigned int	truesize = SKB_DATA_ALIGN(NET_SKB_PAD + size) +
+				   SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+	unsigned int	order = get_order(truesize);
+	struct sk_buff	*skb;
+	struct page	*page;
+
+	page = alloc_pages(gfp_flags | __GFP_COMP | __GFP_NOWARN, order);
+	if (!page)
+		return NULL;
+
+	skb = build_skb(page_address(page), PAGE_SIZE << order);
+	if (!skb) {
+		__free_pages(page, order);
+		return NULL;
+	}
+	skb_reserve(skb, NET_SKB_PAD);
+	skb->dev = dev->net;
+	return skb;
+}
+
 static int
 rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 {
@@ -182,6 +210,7 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	size_t		size = 0;
 	struct usb_ep	*out;
 	unsigned long	flags;
+	bool		rx_frags;
 
 	spin_lock_irqsave(&dev->lock, flags);
 	if (dev->port_usb)
@@ -217,9 +246,14 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 
 	if (dev->port_usb->is_fixed)
 		size = max_t(size_t, size, dev->port_usb->fixed_out_len);
+	rx_frags = dev->port_usb->rx_frags;
 	spin_unlock_irqrestore(&dev->lock, flags);
 
-	skb = __netdev_alloc_skb(dev->net, size + NET_IP_ALIGN, gfp_flags);
+	if (rx_frags)
+		skb = rx_alloc_frag_skb(dev, size + NET_IP_ALIGN, gfp_flags);
+	else
+		skb = __netdev_alloc_skb(dev->net, size + NET_IP_ALIGN,
+					 gfp_flags);
 	if (skb == NULL) {
 		DBG(dev, "no rx skb\n");
 		goto enomem;
@@ -437,11 +471,47 @@ static void eth_work(struct work_struct *work)
 		DBG(dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
+/*
+ * Map a nonlinear skb, such as an NCM NTB with its datagrams chained on the
+ * frag_list, for the UDC instead of copying it into one buffer.
+ */
+static int tx_map_sg(struct usb_request *req, struct sk_buff *skb)
+{
+	struct sk_buff	*iter;
+	int		nents = skb_shinfo(skb)->nr_frags + 1;
+
+	skb_walk_frags(skb, iter)
+		nents += skb_shinfo(iter)->nr_frags + 1;
+
+	req->sg = kmalloc_array(nents, sizeof(*req->sg), GFP_ATOMIC);
+	if (!req->sg)
+		return -ENOMEM;
+
+	sg_init_table(req->sg, nents);
+	nents = skb_to_sgvec(skb, req->sg, 0, skb->len);
+	if (nents < 0) {
+		kfree(req->sg);
+		req->sg = NULL;
+		return nents;
+	}
+	req->num_sgs = nents;
+	return 0;
+}
+
+static void tx_unmap_sg(struct usb_request *req)
+{
+	kfree(req->sg);
+	req->sg = NULL;
+	req->num_sgs = 0;
+}
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
 	struct eth_dev	*dev = ep->driver_data;
 
+	tx_unmap_sg(req);
+
 	switch (req->status) {
 	default:
 		dev->net->stats.tx_errors++;
@@ -562,9 +632,6 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 	}
 
 	length = skb->len;
-	req->buf = skb->data;
-	req->context = skb;
-	req->complete = tx_complete;
 
 	/* NCM requires no zlp if transfer is dwNtbInMaxSize */
 	if (dev->port_usb &&
@@ -575,6 +642,24 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 	else
 		req->zero = 1;
 
+	/* chained skbs go out as a scatterlist when the UDC can do it and
+	 * no padding byte has to be added below, else they are copied
+	 */
+	if (skb_is_nonlinear(skb)) {
+		if (!dev->gadget->sg_supported ||
+		    (req->zero && !dev->zlp && (length % in->maxpacket) == 0) ||
+		    tx_map_sg(req, skb)) {
+			if (skb_linearize(skb)) {
+				dev_kfree_skb_any(skb);
+				goto drop;
+			}
+		}
+	}
+
+	req->buf = skb->data;
+	req->context = skb;
+	req->complete = tx_complete;
+
 	/* use zlp framing on tx for strict CDC-Ether conformance,
 	 * though any robust network rx path ignores extra padding.
 	 * and some hardware doesn't like to write zlps.
@@ -595,6 +680,7 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 	}
 
 	if (retval) {
+		tx_unmap_sg(req);
 		dev_kfree_skb_any(skb);
 drop:
 		dev->net->stats.tx_dropped++;
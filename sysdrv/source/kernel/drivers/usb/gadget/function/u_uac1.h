@@ -50,6 +50,8 @@ struct f_uac1_opts {
 	s16				c_volume_res;
 
 	int				req_number;
+	bool			p_zero_copy;
+	bool			pitch_auto;
 	unsigned			bound:1;
 
 	char			function_name[32];
@@ -61,6 +61,8 @@ struct f_uac2_opts {
 
 	int				req_number;
 	int				fb_max;
+	bool			p_zero_copy;
+	bool			pitch_auto;
 	bool			bound;
 
 	char			function_name[32];
@@ -18,6 +18,9 @@
 #include <linux/usb/video.h>
 
 #define fi_to_f_uvc_opts(f)	container_of(f, struct f_uvc_opts, func_inst)
+
+struct uvcg_bind;
+
 DECLARE_UVC_EXTENSION_UNIT_DESCRIPTOR(1, 1);
 
 struct f_uvc_opts {
@@ -26,6 +29,8 @@ struct f_uvc_opts {
 	unsigned int					streaming_interval;
 	unsigned int					streaming_maxpacket;
 	unsigned int					streaming_maxburst;
+	unsigned int					streaming_bulk_req_size;
+	unsigned int					streaming_timestamps;
 #if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
 	bool						device_name_allocated;
 	const char					*device_name;
@@ -92,6 +97,10 @@ struct f_uvc_opts {
 	struct mutex			lock;
 	int				refcnt;
 	int				pm_qos_latency;
+	/* Requests queued per completion interrupt, 0 for a quarter of them */
+	unsigned int			req_int_interval;
+	/* In-kernel frame source lookup handle */
+	struct uvcg_bind		*bind;
 };
 
 #endif /* U_UVC_H */
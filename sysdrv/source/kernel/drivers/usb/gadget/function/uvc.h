@@ -69,6 +69,7 @@ extern unsigned int uvc_gadget_trace_param;
 
 #define UVC_MAX_REQUEST_SIZE			64
 #define UVC_MAX_EVENTS				4
+#define UVC_LATENCY_BUCKETS			11
 
 /* ------------------------------------------------------------------------
  * Structures
@@ -76,6 +77,10 @@ extern unsigned int uvc_gadget_trace_param;
 struct uvc_request {
 	struct usb_request *req;
 	u8 *req_buffer;
+	struct scatterlist *sg;
+	unsigned int num_sgs;
+	/* Timestamp of the frame this request ends, 0 if none */
+	u64 frame_ts;
 	struct uvc_video *video;
 #if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
 	struct completion req_done;
@@ -100,10 +105,37 @@ struct uvc_video {
 
 	/* Requests */
 	unsigned int req_size;
+	unsigned int req_buf_size;
 	struct uvc_request *ureq;
 	struct list_head req_free;
+	unsigned int req_free_count;
 	spinlock_t req_lock;
 
+	/* Completion interrupts, protected by the video queue irqlock */
+	unsigned int req_int_interval;
+	unsigned int req_int_count;
+
+	/*
+	 * Times all requests completed with no video data to refill them, and
+	 * the requests and bytes the host took, protected by req_lock
+	 */
+	u32 underruns;
+	u32 req_errors;
+	u64 req_done;
+	u64 bytes_done;
+
+	/*
+	 * Payload header PTS and SCR, in dwClockFrequency ticks. The PTS is
+	 * latched from the buffer timestamp at the first header of a frame.
+	 */
+	bool timestamps;
+	u32 clock_freq;
+	u32 pts;
+
+	/* Buffer timestamp to last request completion, log2 of ms buckets */
+	u32 latency_hist[UVC_LATENCY_BUCKETS];
+
+	bool use_sg;
 	void (*encode) (struct usb_request *req, struct uvc_video *video,
 			struct uvc_buffer *buf);
 
@@ -148,6 +180,8 @@ struct uvc_device {
 
 	unsigned int streaming_intf;
 
+	struct dentry *debugfs;
+
 	/* Events */
 	unsigned int event_length;
 	unsigned int event_setup_out : 1;
@@ -0,0 +1,312 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ *	uvc_bind.c  --  USB Video Class Gadget driver - In-kernel frame source
+ *
+ *	Copyright (C) 2023 Rockchip Electronics Co., Ltd.
+ */
+
+#include <linux/dma-buf.h>
+#include <linux/kernel.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/usb/uvc_bind.h>
+
+#include "uvc.h"
+#include "uvc_bind.h"
+#include "uvc_queue.h"
+#include "u_uvc.h"
+
+/* ------------------------------------------------------------------------
+ * In-kernel frame source
+ *
+ * A driver that produces encoded or raw frames can feed them to a UVC
+ * function without going through userspace. It looks the function up by its
+ * configfs name with uvcg_bind_get() and queues dma-bufs with
+ * uvcg_bind_queue(). The frames join the vb2 buffers on the IRQ queue and are
+ * sent the same way, the application keeps handling the control requests and
+ * starts and stops the stream as usual.
+ *
+ * Mapping a dma-buf costs too much to do it per frame, so the mappings are
+ * kept until the stream stops. Frame sources are expected to recycle a small
+ * pool of buffers.
+ */
+
+#define UVCG_BIND_MAX_MAPS	16
+
+struct uvcg_bind_map {
+	struct dma_buf *dbuf;
+	void *vaddr;
+	bool vmapped;
+};
+
+struct uvcg_bind {
+	struct kref kref;
+	struct list_head list;
+	struct usb_function_instance *fi;
+
+	/* Protects uvc and maps */
+	struct mutex lock;
+	struct uvc_device *uvc;
+	struct uvcg_bind_map maps[UVCG_BIND_MAX_MAPS];
+};
+
+struct uvcg_bind_frame {
+	struct uvc_buffer buf;
+	struct uvcg_bind_buffer *src;
+};
+
+static LIST_HEAD(uvcg_bind_list);
+static DEFINE_MUTEX(uvcg_bind_list_lock);
+
+static void uvcg_bind_release(struct kref *kref)
+{
+	struct uvcg_bind *bind = container_of(kref, struct uvcg_bind, kref);
+
+	mutex_destroy(&bind->lock);
+	kfree(bind);
+}
+
+static void *uvcg_bind_map(struct uvcg_bind *bind, struct dma_buf *dbuf)
+{
+	struct uvc_device *uvc = bind->uvc;
+	struct uvcg_bind_map *map = NULL;
+	void *vaddr;
+	unsigned int i;
+
+	for (i = 0; i < UVCG_BIND_MAX_MAPS; ++i) {
+		if (bind->maps[i].dbuf == dbuf)
+			return bind->maps[i].vaddr;
+		if (!map && !bind->maps[i].dbuf)
+			map = &bind->maps[i];
+	}
+
+	if (!map)
+		return ERR_PTR(-ENOSPC);
+
+#if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
+	if (fi_to_f_uvc_opts(uvc->func.fi)->uvc_zero_copy &&
+	    uvc->video.fcc != V4L2_PIX_FMT_YUYV) {
+		vaddr = uvc_dma_buf_phys_to_virt(uvc, dbuf);
+		if (IS_ERR(vaddr))
+			return vaddr;
+		map->vmapped = false;
+		goto done;
+	}
+#endif
+
+	vaddr = dma_buf_vmap(dbuf);
+	if (!vaddr)
+		return ERR_PTR(-ENOMEM);
+	map->vmapped = true;
+
+#if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
+done:
+#endif
+	get_dma_buf(dbuf);
+	map->dbuf = dbuf;
+	map->vaddr = vaddr;
+
+	return vaddr;
+}
+
+static void uvcg_bind_frame_release(struct uvc_buffer *buf)
+{
+	struct uvcg_bind_frame *frame =
+		container_of(buf, struct uvcg_bind_frame, buf);
+	struct uvcg_bind_buffer *src = frame->src;
+
+	src->error = buf->state == UVC_BUF_STATE_ERROR;
+	dma_buf_put(src->dbuf);
+	kfree(frame);
+
+	src->release(src);
+}
+
+/**
+ * uvcg_bind_get - Look up a UVC function by name
+ * @name: configfs name of the function instance, e.g. "uvc.0"
+ *
+ * Returns a reference to release with uvcg_bind_put(), or NULL if no such
+ * function exists.
+ */
+struct uvcg_bind *uvcg_bind_get(const char *name)
+{
+	struct uvcg_bind *bind, *found = NULL;
+
+	mutex_lock(&uvcg_bind_list_lock);
+	list_for_each_entry(bind, &uvcg_bind_list, list) {
+		const char *ci_name = bind->fi->group.cg_item.ci_name;
+
+		if (ci_name && !strcmp(ci_name, name)) {
+			kref_get(&bind->kref);
+			found = bind;
+			break;
+		}
+	}
+	mutex_unlock(&uvcg_bind_list_lock);
+
+	return found;
+}
+EXPORT_SYMBOL_GPL(uvcg_bind_get);
+
+void uvcg_bind_put(struct uvcg_bind *bind)
+{
+	if (bind)
+		kref_put(&bind->kref, uvcg_bind_release);
+}
+EXPORT_SYMBOL_GPL(uvcg_bind_put);
+
+/**
+ * uvcg_bind_queue - Queue a frame for transmission
+ * @bind: the UVC function
+ * @buf: the frame
+ *
+ * Must be called from process context. On success @buf->release is called
+ * once the frame has been sent or dropped. Returns -EAGAIN if the host isn't
+ * streaming, -ENOSPC if too many distinct dma-bufs have been queued since
+ * the stream started.
+ */
+int uvcg_bind_queue(struct uvcg_bind *bind, struct uvcg_bind_buffer *buf)
+{
+	struct uvcg_bind_frame *frame;
+	struct uvc_video_queue *queue;
+	struct uvc_device *uvc;
+	unsigned long flags;
+	void *vaddr;
+	int ret = 0;
+
+	if (!buf->dbuf || !buf->release || !buf->bytesused ||
+	    buf->offset > buf->dbuf->size ||
+	    buf->bytesused > buf->dbuf->size - buf->offset)
+		return -EINVAL;
+
+	frame = kzalloc(sizeof(*frame), GFP_KERNEL);
+	if (!frame)
+		return -ENOMEM;
+
+	mutex_lock(&bind->lock);
+	uvc = bind->uvc;
+	if (!uvc) {
+		ret = -ENODEV;
+		goto error;
+	}
+
+	queue = &uvc->video.queue;
+	if (!vb2_is_streaming(&queue->queue)) {
+		ret = -EAGAIN;
+		goto error;
+	}
+
+	vaddr = uvcg_bind_map(bind, buf->dbuf);
+	if (IS_ERR(vaddr)) {
+		ret = PTR_ERR(vaddr);
+		goto error;
+	}
+
+	get_dma_buf(buf->dbuf);
+	buf->error = false;
+	frame->src = buf;
+	frame->buf.release = uvcg_bind_frame_release;
+	frame->buf.state = UVC_BUF_STATE_QUEUED;
+	frame->buf.mem = vaddr + buf->offset;
+	frame->buf.length = buf->bytesused;
+	frame->buf.bytesused = buf->bytesused;
+	frame->buf.buf.vb2_buf.timestamp = buf->timestamp;
+
+	spin_lock_irqsave(&queue->irqlock, flags);
+	if (!vb2_is_streaming(&queue->queue) ||
+	    (queue->flags & UVC_QUEUE_DISCONNECTED)) {
+		spin_unlock_irqrestore(&queue->irqlock, flags);
+		dma_buf_put(buf->dbuf);
+		ret = -EAGAIN;
+		goto error;
+	}
+	list_add_tail(&frame->buf.queue, &queue->irqqueue);
+	spin_unlock_irqrestore(&queue->irqlock, flags);
+	mutex_unlock(&bind->lock);
+
+	schedule_work(&uvc->video.pump);
+	return 0;
+
+error:
+	mutex_unlock(&bind->lock);
+	kfree(frame);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(uvcg_bind_queue);
+
+/* ------------------------------------------------------------------------
+ * Function side
+ */
+
+struct uvcg_bind *uvcg_bind_create(struct usb_function_instance *fi)
+{
+	struct uvcg_bind *bind;
+
+	bind = kzalloc(sizeof(*bind), GFP_KERNEL);
+	if (!bind)
+		return NULL;
+
+	kref_init(&bind->kref);
+	mutex_init(&bind->lock);
+	bind->fi = fi;
+
+	mutex_lock(&uvcg_bind_list_lock);
+	list_add_tail(&bind->list, &uvcg_bind_list);
+	mutex_unlock(&uvcg_bind_list_lock);
+
+	return bind;
+}
+
+void uvcg_bind_destroy(struct uvcg_bind *bind)
+{
+	mutex_lock(&uvcg_bind_list_lock);
+	list_del(&bind->list);
+	mutex_unlock(&uvcg_bind_list_lock);
+
+	uvcg_bind_put(bind);
+}
+
+void uvcg_bind_attach(struct uvcg_bind *bind, struct uvc_device *uvc)
+{
+	mutex_lock(&bind->lock);
+	bind->uvc = uvc;
+	mutex_unlock(&bind->lock);
+}
+
+void uvcg_bind_detach(struct uvcg_bind *bind, struct uvc_device *uvc)
+{
+	uvcg_bind_flush(bind);
+
+	mutex_lock(&bind->lock);
+	if (bind->uvc == uvc)
+		bind->uvc = NULL;
+	mutex_unlock(&bind->lock);
+}
+
+/*
+ * Drop the cached mappings. Called once the stream is off and no frame
+ * references them anymore.
+ */
+void uvcg_bind_flush(struct uvcg_bind *bind)
+{
+	struct uvcg_bind_map *map;
+	unsigned int i;
+
+	mutex_lock(&bind->lock);
+	for (i = 0; i < UVCG_BIND_MAX_MAPS; ++i) {
+		map = &bind->maps[i];
+		if (!map->dbuf)
+			continue;
+
+		if (map->vmapped)
+			dma_buf_vunmap(map->dbuf, map->vaddr);
+		dma_buf_put(map->dbuf);
+		memset(map, 0, sizeof(*map));
+	}
+	mutex_unlock(&bind->lock);
+}
@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ *	uvc_bind.h  --  USB Video Class Gadget driver - In-kernel frame source
+ *
+ *	Copyright (C) 2023 Rockchip Electronics Co., Ltd.
+ */
+
+#ifndef __UVC_BIND_H__
+#define __UVC_BIND_H__
+
+struct usb_function_instance;
+struct uvc_device;
+struct uvcg_bind;
+
+struct uvcg_bind *uvcg_bind_create(struct usb_function_instance *fi);
+void uvcg_bind_destroy(struct uvcg_bind *bind);
+void uvcg_bind_attach(struct uvcg_bind *bind, struct uvc_device *uvc);
+void uvcg_bind_detach(struct uvcg_bind *bind, struct uvc_device *uvc);
+void uvcg_bind_flush(struct uvcg_bind *bind);
+
+#endif /* __UVC_BIND_H__ */
@@ -10,6 +10,7 @@
  * Author: Andrzej Pietrasiewicz <andrzejtp2010@gmail.com>
  */
 
+#include <linux/sizes.h>
 #include <linux/sort.h>
 
 #include "uvc.h"
@@ -2766,9 +2767,12 @@ UVCG_OPTS_ATTR(streaming_bulk, streaming_bulk, 1);
 UVCG_OPTS_ATTR(streaming_interval, streaming_interval, 16);
 UVCG_OPTS_ATTR(streaming_maxpacket, streaming_maxpacket, 3072);
 UVCG_OPTS_ATTR(streaming_maxburst, streaming_maxburst, 15);
+UVCG_OPTS_ATTR(streaming_bulk_req_size, streaming_bulk_req_size, SZ_1M);
+UVCG_OPTS_ATTR(streaming_timestamps, streaming_timestamps, 1);
 UVCG_OPTS_ATTR(pm_qos_latency, pm_qos_latency, PM_QOS_LATENCY_ANY);
+UVCG_OPTS_ATTR(req_int_interval, req_int_interval, 128);
 #if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
-UVCG_OPTS_ATTR(uvc_num_request, uvc_num_request, 64);
+UVCG_OPTS_ATTR(uvc_num_request, uvc_num_request, 128);
 UVCG_OPTS_ATTR(uvc_zero_copy, uvc_zero_copy, 1);
 #endif
 
@@ -2877,7 +2881,10 @@ static struct configfs_attribute *uvc_attrs[] = {
 	&f_uvc_opts_attr_streaming_interval,
 	&f_uvc_opts_attr_streaming_maxpacket,
 	&f_uvc_opts_attr_streaming_maxburst,
+	&f_uvc_opts_attr_streaming_bulk_req_size,
+	&f_uvc_opts_attr_streaming_timestamps,
 	&f_uvc_opts_attr_pm_qos_latency,
+	&f_uvc_opts_attr_req_int_interval,
 #if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
 	&f_uvc_opts_attr_device_name,
 	&f_uvc_opts_attr_uvc_num_request,
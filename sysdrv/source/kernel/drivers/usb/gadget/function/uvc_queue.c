@@ -92,8 +92,7 @@ static int uvc_queue_setup(struct vb2_queue *vq,
  * Returns:
  * The virtual addresses of the dma_buf.
  */
-static void *uvc_dma_buf_phys_to_virt(struct uvc_device *uvc,
-				      struct dma_buf *dbuf)
+void *uvc_dma_buf_phys_to_virt(struct uvc_device *uvc, struct dma_buf *dbuf)
 {
 	struct usb_gadget *gadget = uvc->func.config->cdev->gadget;
 	struct dma_buf_attachment *attachment;
@@ -219,8 +218,11 @@ int uvcg_queue_init(struct uvc_video_queue *queue, enum v4l2_buf_type type,
 	queue->queue.ops = &uvc_queue_qops;
 	queue->queue.lock = lock;
 	queue->queue.mem_ops = &vb2_vmalloc_memops;
-	queue->queue.timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
-				     | V4L2_BUF_FLAG_TSTAMP_SRC_EOF;
+	/*
+	 * The application passes the capture timestamp of each frame, e.g.
+	 * the start of frame time of the ISP buffer, for the payload PTS.
+	 */
+	queue->queue.timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
 	/*
 	 * For rockchip platform, the userspace uvc application
 	 * use bytesused == 0 as a way to indicate that the data
@@ -334,7 +336,10 @@ void uvcg_queue_cancel(struct uvc_video_queue *queue, int disconnect)
 				       queue);
 		list_del(&buf->queue);
 		buf->state = UVC_BUF_STATE_ERROR;
-		vb2_buffer_done(&buf->buf.vb2_buf, VB2_BUF_STATE_ERROR);
+		if (buf->release)
+			buf->release(buf);
+		else
+			vb2_buffer_done(&buf->buf.vb2_buf, VB2_BUF_STATE_ERROR);
 	}
 	queue->buf_used = 0;
 
@@ -379,6 +384,24 @@ int uvcg_queue_enable(struct uvc_video_queue *queue, int enable)
 		queue->sequence = 0;
 		queue->buf_used = 0;
 	} else {
+		struct uvc_buffer *buf, *tmp;
+
+		/*
+		 * Hand the queued buffers back before vb2 tears the queue down,
+		 * bound ones to their source and the rest to vb2 as errors.
+		 */
+		spin_lock_irqsave(&queue->irqlock, flags);
+		list_for_each_entry_safe(buf, tmp, &queue->irqqueue, queue) {
+			list_del(&buf->queue);
+			buf->state = UVC_BUF_STATE_ERROR;
+			if (buf->release)
+				buf->release(buf);
+			else
+				vb2_buffer_done(&buf->buf.vb2_buf,
+						VB2_BUF_STATE_ERROR);
+		}
+		spin_unlock_irqrestore(&queue->irqlock, flags);
+
 		ret = vb2_streamoff(&queue->queue, queue->queue.type);
 		if (ret < 0)
 			return ret;
@@ -419,6 +442,12 @@ struct uvc_buffer *uvcg_queue_next_buffer(struct uvc_video_queue *queue,
 	else
 		nextbuf = NULL;
 
+	if (buf->release) {
+		queue->sequence++;
+		buf->release(buf);
+		return nextbuf;
+	}
+
 	buf->buf.field = V4L2_FIELD_NONE;
 	buf->buf.sequence = queue->sequence++;
 	buf->buf.vb2_buf.timestamp = ktime_get_ns();
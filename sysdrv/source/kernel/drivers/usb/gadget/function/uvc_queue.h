@@ -8,8 +8,10 @@
 
 #include <media/videobuf2-v4l2.h>
 
+struct dma_buf;
 struct file;
 struct mutex;
+struct uvc_device;
 
 /* Maximum frame size in bytes, for sanity checking. */
 #define UVC_MAX_FRAME_SIZE	(16*1024*1024)
@@ -36,6 +38,9 @@ struct uvc_buffer {
 	void *mem;
 	unsigned int length;
 	unsigned int bytesused;
+
+	/* Gives back a buffer that isn't a vb2 buffer, see uvc_bind.c */
+	void (*release)(struct uvc_buffer *buf);
 };
 
 #define UVC_QUEUE_DISCONNECTED		(1 << 0)
@@ -92,5 +97,9 @@ struct uvc_buffer *uvcg_queue_next_buffer(struct uvc_video_queue *queue,
 
 struct uvc_buffer *uvcg_queue_head(struct uvc_video_queue *queue);
 
+#if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
+void *uvc_dma_buf_phys_to_virt(struct uvc_device *uvc, struct dma_buf *dbuf);
+#endif
+
 #endif /* _UVC_QUEUE_H_ */
 
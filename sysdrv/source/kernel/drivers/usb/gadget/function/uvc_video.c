@@ -7,16 +7,24 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/errno.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
 #include <linux/usb/video.h>
 #include <linux/pm_qos.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/vmalloc.h>
+#include <asm/unaligned.h>
 
 #include <media/v4l2-dev.h>
 
 #include "uvc.h"
+#include "uvc_bind.h"
 #include "uvc_queue.h"
 #include "uvc_video.h"
 #include "u_uvc.h"
@@ -74,10 +82,49 @@ static inline void uvc_wait_req_complete(struct uvc_video *video, struct uvc_req
  * Video codecs
  */
 
+static u32 uvc_video_clock(struct uvc_video *video, u64 ns)
+{
+	return (u32)mul_u64_u32_div(ns, video->clock_freq, NSEC_PER_SEC);
+}
+
+/*
+ * The PTS is the buffer timestamp, the same in all the payloads of a frame.
+ * The SCR pairs the same clock sampled now with the current USB frame number.
+ * Frames queued without a timestamp are stamped when they start to be sent.
+ */
+static int
+uvc_video_encode_timestamps(struct uvc_video *video, struct uvc_buffer *buf,
+		u8 *data)
+{
+	struct usb_gadget *gadget = video->uvc->func.config->cdev->gadget;
+	u64 now = ktime_get_ns();
+	int sof;
+
+	if (video->queue.buf_used == 0)
+		video->pts = uvc_video_clock(video,
+					     buf->buf.vb2_buf.timestamp ?: now);
+
+	/* UDCs count microframes at high speed and above */
+	sof = usb_gadget_frame_number(gadget);
+	if (sof < 0)
+		sof = 0;
+	else if (gadget->speed >= USB_SPEED_HIGH)
+		sof >>= 3;
+
+	put_unaligned_le32(video->pts, &data[2]);
+	put_unaligned_le32(uvc_video_clock(video, now), &data[6]);
+	put_unaligned_le16(sof & 0x7ff, &data[10]);
+	data[1] |= UVC_STREAM_PTS | UVC_STREAM_SCR;
+
+	return 12;
+}
+
 static int
 uvc_video_encode_header(struct uvc_video *video, struct uvc_buffer *buf,
 		u8 *data, int len)
 {
+	int header_len = 2;
+
 	if (uvc_using_zero_copy(video)) {
 		u8 *mem;
 
@@ -92,13 +139,31 @@ uvc_video_encode_header(struct uvc_video *video, struct uvc_buffer *buf,
 		return 2;
 	}
 
-	data[0] = 2;
 	data[1] = UVC_STREAM_EOH | video->fid;
+	if (video->timestamps)
+		header_len = uvc_video_encode_timestamps(video, buf, data);
+	data[0] = header_len;
 
-	if (buf->bytesused - video->queue.buf_used <= len - 2)
+	if (buf->bytesused - video->queue.buf_used <= len - header_len)
 		data[1] |= UVC_STREAM_EOF;
 
-	return 2;
+	return header_len;
+}
+
+/* Complete the buffer whose last data @req carries */
+static void
+uvc_video_buffer_done(struct uvc_video *video, struct usb_request *req,
+		struct uvc_buffer *buf)
+{
+	struct uvc_request *ureq = req->context;
+
+	/* The buffer timestamp is overwritten when it is given back */
+	ureq->frame_ts = buf->buf.vb2_buf.timestamp;
+
+	video->queue.buf_used = 0;
+	buf->state = UVC_BUF_STATE_DONE;
+	uvcg_queue_next_buffer(&video->queue, buf);
+	video->fid ^= UVC_STREAM_FID;
 }
 
 static int
@@ -125,7 +190,7 @@ uvc_video_encode_bulk(struct usb_request *req, struct uvc_video *video,
 		struct uvc_buffer *buf)
 {
 	void *mem = req->buf;
-	int len = video->req_size;
+	int len = video->req_buf_size;
 	int ret;
 
 	/* Add a header at the beginning of the payload. */
@@ -143,15 +208,11 @@ uvc_video_encode_bulk(struct usb_request *req, struct uvc_video *video,
 	video->payload_size += ret;
 	len -= ret;
 
-	req->length = video->req_size - len;
+	req->length = video->req_buf_size - len;
 	req->zero = video->payload_size == video->max_payload_size;
 
 	if (buf->bytesused == video->queue.buf_used) {
-		video->queue.buf_used = 0;
-		buf->state = UVC_BUF_STATE_DONE;
-		uvcg_queue_next_buffer(&video->queue, buf);
-		video->fid ^= UVC_STREAM_FID;
-
+		uvc_video_buffer_done(video, req, buf);
 		video->payload_size = 0;
 		req->zero = 1;
 	}
@@ -184,12 +245,159 @@ uvc_video_encode_isoc(struct usb_request *req, struct uvc_video *video,
 
 	req->length = video->req_size - len;
 
+	if (buf->bytesused == video->queue.buf_used)
+		uvc_video_buffer_done(video, req, buf);
+}
+
+/* --------------------------------------------------------------------------
+ * Scatter-gather codecs
+ *
+ * When the UDC can do scatter-gather, each request is sent as the header from
+ * the request buffer followed by the video data in place in the video buffer,
+ * so the payload is never copied. This works for any layout of the data, as
+ * opposed to the zero copy mode above.
+ */
+
+/* Header plus the pages a request worth of data may span */
+#define UVC_REQ_MAX_SGS(size)	(DIV_ROUND_UP(size, PAGE_SIZE) + 2)
+
+static struct page *uvc_video_mem_page(void *mem)
+{
+	unsigned long pfn;
+
+	if (!is_vmalloc_addr(mem))
+		return virt_addr_valid(mem) ? virt_to_page(mem) : NULL;
+
+	/* io memory mapped by USERPTR has no struct page */
+	pfn = vmalloc_to_pfn(mem);
+	return pfn_valid(pfn) ? pfn_to_page(pfn) : NULL;
+}
+
+static unsigned int
+uvc_video_encode_data_sg(struct uvc_video *video, struct uvc_buffer *buf,
+		struct scatterlist *sg, unsigned int len, unsigned int *nents)
+{
+	struct uvc_video_queue *queue = &video->queue;
+	unsigned int nbytes, left, part;
+	void *mem;
+
+	mem = buf->mem + queue->buf_used;
+	nbytes = min(len, buf->bytesused - queue->buf_used);
+
+	*nents = 0;
+	for (left = nbytes; left; left -= part, mem += part) {
+		part = min_t(unsigned int, left, PAGE_SIZE - offset_in_page(mem));
+		sg_set_page(sg++, uvc_video_mem_page(mem), part,
+			    offset_in_page(mem));
+		(*nents)++;
+	}
+	queue->buf_used += nbytes;
+
+	return nbytes;
+}
+
+static void uvc_video_req_sg(struct usb_request *req, unsigned int nents)
+{
+	struct uvc_request *ureq = req->context;
+
+	sg_mark_end(&ureq->sg[nents - 1]);
+	req->sg = ureq->sg;
+	req->num_sgs = nents;
+}
+
+static void uvc_video_req_linear(struct usb_request *req)
+{
+	struct uvc_request *ureq = req->context;
+
+	req->buf = ureq->req_buffer;
+	req->sg = NULL;
+	req->num_sgs = 0;
+}
+
+static void
+uvc_video_encode_bulk_sg(struct usb_request *req, struct uvc_video *video,
+		struct uvc_buffer *buf)
+{
+	struct uvc_request *ureq = req->context;
+	struct scatterlist *sg = ureq->sg;
+	int len = min(video->req_size,
+		      video->max_payload_size - video->payload_size);
+	int header_len = 0;
+	unsigned int nents;
+	int ret;
+
+	/* Buffers without struct pages behind them are copied */
+	if (!uvc_video_mem_page(buf->mem)) {
+		uvc_video_req_linear(req);
+		uvc_video_encode_bulk(req, video, buf);
+		return;
+	}
+
+	sg_init_table(sg, ureq->num_sgs);
+
+	/* Add a header at the beginning of the payload. */
+	if (video->payload_size == 0) {
+		header_len = uvc_video_encode_header(video, buf,
+						     ureq->req_buffer, len);
+		sg_set_buf(sg++, ureq->req_buffer, header_len);
+		video->payload_size += header_len;
+		len -= header_len;
+	}
+
+	/* Process video data. */
+	len = min((int)(video->max_payload_size - video->payload_size), len);
+	ret = uvc_video_encode_data_sg(video, buf, sg, len, &nents);
+	nents += header_len ? 1 : 0;
+	video->payload_size += ret;
+
+	uvc_video_req_sg(req, nents);
+	req->length = header_len + ret;
+	req->zero = video->payload_size == video->max_payload_size;
+
 	if (buf->bytesused == video->queue.buf_used) {
-		video->queue.buf_used = 0;
-		buf->state = UVC_BUF_STATE_DONE;
-		uvcg_queue_next_buffer(&video->queue, buf);
-		video->fid ^= UVC_STREAM_FID;
+		uvc_video_buffer_done(video, req, buf);
+		video->payload_size = 0;
+		req->zero = 1;
+	}
+
+	if (video->payload_size == video->max_payload_size ||
+	    buf->bytesused == video->queue.buf_used)
+		video->payload_size = 0;
+}
+
+static void
+uvc_video_encode_isoc_sg(struct usb_request *req, struct uvc_video *video,
+		struct uvc_buffer *buf)
+{
+	struct uvc_request *ureq = req->context;
+	struct scatterlist *sg = ureq->sg;
+	unsigned int nents;
+	int header_len;
+	int ret;
+
+	/* Buffers without struct pages behind them are copied */
+	if (!uvc_video_mem_page(buf->mem)) {
+		uvc_video_req_linear(req);
+		uvc_video_encode_isoc(req, video, buf);
+		return;
 	}
+
+	sg_init_table(sg, ureq->num_sgs);
+
+	/* Add the header. */
+	header_len = uvc_video_encode_header(video, buf, ureq->req_buffer,
+					     video->req_size);
+	sg_set_buf(sg, ureq->req_buffer, header_len);
+
+	/* Process video data. */
+	ret = uvc_video_encode_data_sg(video, buf, sg + 1,
+				       video->req_size - header_len, &nents);
+
+	uvc_video_req_sg(req, nents + 1);
+	req->length = header_len + ret;
+
+	if (buf->bytesused == video->queue.buf_used)
+		uvc_video_buffer_done(video, req, buf);
 }
 
 /* --------------------------------------------------------------------------
@@ -216,6 +424,21 @@ static int uvcg_video_ep_queue(struct uvc_video *video, struct usb_request *req)
 	return ret;
 }
 
+static void uvcg_video_pump_reqs(struct uvc_video *video);
+
+static void uvc_video_account_latency(struct uvc_video *video, u64 frame_ts)
+{
+	u64 now = ktime_get_ns();
+	unsigned int ms;
+
+	if (!frame_ts || frame_ts > now)
+		return;
+
+	ms = div_u64(now - frame_ts, NSEC_PER_MSEC);
+	video->latency_hist[min_t(unsigned int, ms ? fls(ms) : 0,
+				  UVC_LATENCY_BUCKETS - 1)]++;
+}
+
 static void
 uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 {
@@ -227,6 +450,7 @@ uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 
 	switch (req->status) {
 	case 0:
+		uvc_video_account_latency(video, ureq->frame_ts);
 		break;
 
 	case -ESHUTDOWN:	/* disconnect from host. */
@@ -241,15 +465,37 @@ uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 		uvcg_queue_cancel(queue, 0);
 	}
 
+	ureq->frame_ts = 0;
+
 	spin_lock_irqsave(&video->req_lock, flags);
 	list_add_tail(&req->list, &video->req_free);
+	video->req_free_count++;
+	if (!req->status) {
+		video->req_done++;
+		video->bytes_done += req->actual;
+	} else if (req->status != -ESHUTDOWN) {
+		video->req_errors++;
+	}
 #if defined(CONFIG_ARCH_ROCKCHIP) && defined(CONFIG_NO_GKI)
 	complete(&ureq->req_done);
 #endif
 	spin_unlock_irqrestore(&video->req_lock, flags);
 
-	if (uvc->state == UVC_STATE_STREAMING)
+	if (uvc->state != UVC_STATE_STREAMING)
+		return;
+
+	if (req->status) {
 		schedule_work(&video->pump);
+		return;
+	}
+
+	/* Refill the ring from here rather than waking up the worker */
+	uvcg_video_pump_reqs(video);
+
+	spin_lock_irqsave(&video->req_lock, flags);
+	if (video->req_free_count == video->uvc_num_requests)
+		video->underruns++;
+	spin_unlock_irqrestore(&video->req_lock, flags);
 }
 
 static int
@@ -269,6 +515,9 @@ uvc_video_free_requests(struct uvc_video *video)
 				kfree(video->ureq[i].req_buffer);
 				video->ureq[i].req_buffer = NULL;
 			}
+
+			kfree(video->ureq[i].sg);
+			video->ureq[i].sg = NULL;
 		}
 
 		kfree(video->ureq);
@@ -276,13 +525,17 @@ uvc_video_free_requests(struct uvc_video *video)
 	}
 
 	INIT_LIST_HEAD(&video->req_free);
+	video->req_free_count = 0;
 	video->req_size = 0;
+	video->req_buf_size = 0;
 	return 0;
 }
 
 static int
 uvc_video_alloc_requests(struct uvc_video *video)
 {
+	struct f_uvc_opts *opts = fi_to_f_uvc_opts(video->uvc->func.fi);
+	unsigned int req_buf_size;
 	unsigned int req_size;
 	unsigned int i;
 	int ret = -ENOMEM;
@@ -297,16 +550,35 @@ uvc_video_alloc_requests(struct uvc_video *video)
 		req_size = video->ep->maxpacket
 			 * max_t(unsigned int, video->ep->maxburst, 1);
 	}
+	req_buf_size = req_size;
+
+	/*
+	 * Scatter-gather bulk requests don't need a buffer of their size, so
+	 * they may carry streaming_bulk_req_size bytes of a payload at once.
+	 */
+	if (video->use_sg && video->max_payload_size &&
+	    opts->streaming_bulk_req_size > req_size)
+		req_size = rounddown(opts->streaming_bulk_req_size,
+				     video->ep->maxpacket);
 
 	video->ureq = kcalloc(video->uvc_num_requests, sizeof(struct uvc_request), GFP_KERNEL);
 	if (video->ureq == NULL)
 		return -ENOMEM;
 
 	for (i = 0; i < video->uvc_num_requests; ++i) {
-		video->ureq[i].req_buffer = kmalloc(req_size, GFP_KERNEL);
+		video->ureq[i].req_buffer = kmalloc(req_buf_size, GFP_KERNEL);
 		if (video->ureq[i].req_buffer == NULL)
 			goto error;
 
+		if (video->use_sg) {
+			video->ureq[i].num_sgs = UVC_REQ_MAX_SGS(req_size);
+			video->ureq[i].sg = kmalloc_array(video->ureq[i].num_sgs,
+							  sizeof(struct scatterlist),
+							  GFP_KERNEL);
+			if (video->ureq[i].sg == NULL)
+				goto error;
+		}
+
 		video->ureq[i].req = usb_ep_alloc_request(video->ep, GFP_KERNEL);
 		if (video->ureq[i].req == NULL)
 			goto error;
@@ -321,9 +593,11 @@ uvc_video_alloc_requests(struct uvc_video *video)
 		init_completion(&video->ureq[i].req_done);
 #endif
 		list_add_tail(&video->ureq[i].req->list, &video->req_free);
+		video->req_free_count++;
 	}
 
 	video->req_size = req_size;
+	video->req_buf_size = req_buf_size;
 
 	return 0;
 
@@ -337,18 +611,19 @@ error:
  */
 
 /*
- * uvcg_video_pump - Pump video data into the USB requests
+ * uvcg_video_pump_reqs - Pump video data into the USB requests
  *
  * This function fills the available USB requests (listed in req_free) with
- * video data from the queued buffers.
+ * video data from the queued buffers. It runs from the request completion
+ * handler and from the pump worker, which only primes the ring.
  */
-static void uvcg_video_pump(struct work_struct *work)
+static void uvcg_video_pump_reqs(struct uvc_video *video)
 {
-	struct uvc_video *video = container_of(work, struct uvc_video, pump);
 	struct uvc_video_queue *queue = &video->queue;
 	struct usb_request *req = NULL;
 	struct uvc_buffer *buf;
 	unsigned long flags;
+	bool last_free;
 	int ret;
 
 	while (video->ep->enabled) {
@@ -363,6 +638,8 @@ static void uvcg_video_pump(struct work_struct *work)
 		req = list_first_entry(&video->req_free, struct usb_request,
 					list);
 		list_del(&req->list);
+		video->req_free_count--;
+		last_free = list_empty(&video->req_free);
 		spin_unlock_irqrestore(&video->req_lock, flags);
 
 		/* Retrieve the first available video buffer and fill the
@@ -377,6 +654,21 @@ static void uvcg_video_pump(struct work_struct *work)
 
 		video->encode(req, video, buf);
 
+		/*
+		 * Only every req_int_interval-th request interrupts on
+		 * completion, the others are given back with it. The last free
+		 * request and the end of a frame always interrupt, to refill
+		 * the ring and to return the buffer in time.
+		 */
+		if (last_free ||
+		    buf->state == UVC_BUF_STATE_DONE ||
+		    ++video->req_int_count >= video->req_int_interval) {
+			video->req_int_count = 0;
+			req->no_interrupt = 0;
+		} else {
+			req->no_interrupt = 1;
+		}
+
 		/* Queue the USB request */
 		ret = uvcg_video_ep_queue(video, req);
 		spin_unlock_irqrestore(&queue->irqlock, flags);
@@ -395,10 +687,18 @@ static void uvcg_video_pump(struct work_struct *work)
 
 	spin_lock_irqsave(&video->req_lock, flags);
 	list_add_tail(&req->list, &video->req_free);
+	video->req_free_count++;
 	spin_unlock_irqrestore(&video->req_lock, flags);
 	return;
 }
 
+static void uvcg_video_pump(struct work_struct *work)
+{
+	struct uvc_video *video = container_of(work, struct uvc_video, pump);
+
+	uvcg_video_pump_reqs(video);
+}
+
 /*
  * Enable or disable the video stream.
  */
@@ -408,6 +708,7 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 	int ret;
 	struct uvc_device *uvc;
 	struct f_uvc_opts *opts;
+	struct uvc_header_descriptor *header;
 
 	if (video->ep == NULL) {
 		uvcg_info(&video->uvc->func,
@@ -428,6 +729,7 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 
 		uvc_video_free_requests(video);
 		uvcg_queue_enable(&video->queue, 0);
+		uvcg_bind_flush(opts->bind);
 		if (cpu_latency_qos_request_active(&uvc->pm_qos))
 			cpu_latency_qos_remove_request(&uvc->pm_qos);
 		return 0;
@@ -437,20 +739,57 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 	if ((ret = uvcg_queue_enable(&video->queue, 1)) < 0)
 		return ret;
 
+	video->use_sg = uvc->func.config->cdev->gadget->sg_supported &&
+			!uvc_using_zero_copy(video);
+
 	if ((ret = uvc_video_alloc_requests(video)) < 0)
 		return ret;
 
+	video->req_int_interval = opts->req_int_interval ?:
+				  DIV_ROUND_UP(video->uvc_num_requests, 4);
+	video->req_int_count = 0;
+
+	header = (struct uvc_header_descriptor *)uvc->desc.fs_control[0];
+	video->clock_freq = le32_to_cpu(header->dwClockFrequency);
+	/* Zero copy leaves room for 2 byte headers only */
+	video->timestamps = opts->streaming_timestamps && video->clock_freq &&
+			    !uvc_using_zero_copy(video);
+
 	if (video->max_payload_size) {
-		video->encode = uvc_video_encode_bulk;
+		video->encode = video->use_sg ? uvc_video_encode_bulk_sg :
+						uvc_video_encode_bulk;
 		video->payload_size = 0;
 	} else
-		video->encode = uvc_video_encode_isoc;
+		video->encode = video->use_sg ? uvc_video_encode_isoc_sg :
+						uvc_video_encode_isoc;
 
 	schedule_work(&video->pump);
 
 	return ret;
 }
 
+static int uvc_video_latency_show(struct seq_file *s, void *unused)
+{
+	struct uvc_video *video = s->private;
+	unsigned int i;
+
+	seq_printf(s, "<1ms: %u\n", video->latency_hist[0]);
+	for (i = 1; i < UVC_LATENCY_BUCKETS - 1; i++)
+		seq_printf(s, "<%ums: %u\n", 1U << i, video->latency_hist[i]);
+	seq_printf(s, ">=%ums: %u\n", 1U << (UVC_LATENCY_BUCKETS - 2),
+		   video->latency_hist[i]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(uvc_video_latency);
+
+void uvcg_video_debugfs_init(struct uvc_video *video, struct dentry *root)
+{
+	debugfs_create_u32("underruns", 0444, root, &video->underruns);
+	debugfs_create_file("latency", 0444, root, video,
+			    &uvc_video_latency_fops);
+}
+
 /*
  * Initialize the UVC video stream.
  */
@@ -12,10 +12,13 @@
 #ifndef __UVC_VIDEO_H__
 #define __UVC_VIDEO_H__
 
+struct dentry;
 struct uvc_video;
 
 int uvcg_video_enable(struct uvc_video *video, int enable);
 
 int uvcg_video_init(struct uvc_video *video, struct uvc_device *uvc);
 
+void uvcg_video_debugfs_init(struct uvc_video *video, struct dentry *root);
+
 #endif /* __UVC_VIDEO_H__ */
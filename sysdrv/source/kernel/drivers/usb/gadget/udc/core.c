@@ -823,6 +823,11 @@ int usb_gadget_map_request_by_dev(struct device *dev,
 	if (req->length == 0)
 		return 0;
 
+	if (req->sg_was_mapped) {
+		req->num_mapped_sgs = req->num_sgs;
+		return 0;
+	}
+
 	if (req->num_sgs) {
 		int     mapped;
 
@@ -871,6 +876,11 @@ void usb_gadget_unmap_request_by_dev(struct device *dev,
 	if (req->length == 0)
 		return;
 
+	if (req->sg_was_mapped) {
+		req->num_mapped_sgs = 0;
+		return;
+	}
+
 	if (req->num_mapped_sgs) {
 		dma_unmap_sg(dev, req->sg, req->num_sgs,
 				is_in ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
@@ -1432,6 +1432,21 @@ static int iep_bufid_to_iova(iep_service_info *pservice, u8 *tbl,
 	return 0;
 }
 
+static void iep_reg_release_mem(iep_service_info *pservice, struct iep_reg *reg)
+{
+	struct iep_mem_region *mem_region = NULL, *n;
+
+	list_for_each_entry_safe(mem_region, n, &reg->mem_region_list,
+				 reg_lnk) {
+		iep_iommu_unmap_iommu(pservice->iommu_info,
+				      reg->session, mem_region->hdl);
+		iep_iommu_free(pservice->iommu_info,
+			       reg->session, mem_region->hdl);
+		list_del_init(&mem_region->reg_lnk);
+		kfree(mem_region);
+	}
+}
+
 static u8 addr_tbl_iep[] = {
 	32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55
 };
@@ -1444,15 +1459,16 @@ static int iep_reg_address_translate(iep_service_info *pservice, struct iep_reg
 /**
  * generating a series of registers copy from iep message
  */
-void iep_config(iep_session *session, struct IEP_MSG *iep_msg)
+int iep_config(iep_session *session, struct IEP_MSG *iep_msg)
 {
 	struct iep_reg *reg = NULL;
 	int w;
 	int h;
+	int ret;
 
 	reg = kzalloc(sizeof(*reg), GFP_KERNEL);
 	if (!reg)
-		return;
+		return -ENOMEM;
 	reg->session = session;
 	iep_msg->base = reg->reg;
 	atomic_set(&reg->session->done, 0);
@@ -1503,10 +1519,12 @@ void iep_config(iep_session *session, struct IEP_MSG *iep_msg)
 	}
 
 	if (iep_service.iommu_dev) {
-		if (0 > iep_reg_address_translate(&iep_service, reg)) {
+		ret = iep_reg_address_translate(&iep_service, reg);
+		if (ret < 0) {
 			IEP_ERR("error: translate reg address failed\n");
+			iep_reg_release_mem(&iep_service, reg);
 			kfree(reg);
-			return;
+			return ret;
 		}
 	}
 
@@ -1526,5 +1544,7 @@ void iep_config(iep_session *session, struct IEP_MSG *iep_msg)
 	list_add_tail(&reg->status_link, &iep_service.waiting);
 	list_add_tail(&reg->session_link, &session->waiting);
 	mutex_unlock(&iep_service.lock);
+
+	return 0;
 }
 
@@ -519,7 +519,7 @@ void iep_set_deinterlace_mode(int mode, void *base);
 void iep_switch_input_address(void *base);
 
 /* generating a series of iep registers copy to the session private buffer */
-void iep_config(iep_session *session, struct IEP_MSG *iep_msg);
+int iep_config(iep_session *session, struct IEP_MSG *iep_msg);
 
 /*#define IEP_PRINT_INFO*/
 #endif
@@ -33,6 +33,7 @@ struct IEP_CAP {
 #define IEP_RELEASE_CURRENT_TASK	_IOW(IEP_IOC_MAGIC, 9, unsigned long)
 #define IEP_GET_IOMMU_STATE		_IOR(IEP_IOC_MAGIC,10, unsigned long)
 #define IEP_QUERY_CAP			_IOR(IEP_IOC_MAGIC,11, struct IEP_CAP)
+#define IEP_GET_RESULT_NUM		_IOWR(IEP_IOC_MAGIC, 12, u32)
 
 #ifdef CONFIG_COMPAT
 #define COMPAT_IEP_SET_PARAMETER_REQ		_IOW(IEP_IOC_MAGIC, 1, u32)
@@ -46,6 +47,7 @@ struct IEP_CAP {
 #define COMPAT_IEP_RELEASE_CURRENT_TASK		_IOW(IEP_IOC_MAGIC, 9, u32)
 #define COMPAT_IEP_GET_IOMMU_STATE		_IOR(IEP_IOC_MAGIC,10, u32)
 #define COMPAT_IEP_QUERY_CAP			_IOR(IEP_IOC_MAGIC,11, struct IEP_CAP)
+#define COMPAT_IEP_GET_RESULT_NUM		_IOWR(IEP_IOC_MAGIC, 12, u32)
 #endif
 
 /* Driver information */
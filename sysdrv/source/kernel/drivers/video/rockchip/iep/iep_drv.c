@@ -122,6 +122,15 @@ static void iep_reg_from_ready_to_running(struct iep_reg *reg)
 	list_add_tail(&reg->session_link, &reg->session->running);
 }
 
+/*
+ * A task may leave a following one of the same session in the ready
+ * list, the session is only done once nothing of it is queued anymore.
+ */
+static inline bool iep_session_idle(iep_session *session)
+{
+	return list_empty(&session->waiting) && list_empty(&session->ready);
+}
+
 static void iep_del_running_list(void)
 {
 	struct iep_reg *reg;
@@ -136,12 +145,11 @@ static void iep_del_running_list(void)
 
 		atomic_dec(&reg->session->task_running);
 		atomic_dec(&iep_service.total_running);
+		atomic_inc(&reg->session->num_done);
 
-		if (list_empty(&reg->session->waiting)) {
+		if (iep_session_idle(reg->session))
 			atomic_set(&reg->session->done, 1);
-			atomic_inc(&reg->session->num_done);
-			wake_up(&reg->session->wait);
-		}
+		wake_up(&reg->session->wait);
 
 		iep_reg_deinit(reg);
 		cnt++;
@@ -191,10 +199,11 @@ static void iep_del_running_list_timeout(void)
 
 		iep_dump();
 
-		if (list_empty(&reg->session->waiting)) {
+		atomic_inc(&reg->session->num_done);
+
+		if (iep_session_idle(reg->session))
 			atomic_set(&reg->session->done, 1);
-			wake_up(&reg->session->wait);
-		}
+		wake_up(&reg->session->wait);
 
 		iep_reg_deinit(reg);
 	}
@@ -671,6 +680,38 @@ static int iep_get_result_sync(iep_session *session)
 	return ret;
 }
 
+/*
+ * Wait until @num tasks of the session have been processed since it was
+ * opened, so a stream of fields can be queued and retired in order with
+ * a bounded number of tasks in flight.
+ */
+static int iep_get_result_num(iep_session *session, u32 *num)
+{
+	int ret = 0;
+
+	iep_try_start_frm();
+
+	ret = wait_event_timeout(session->wait,
+		(u32)atomic_read(&session->num_done) >= *num,
+		IEP_TIMEOUT_DELAY);
+
+	if (unlikely(ret < 0)) {
+		IEP_ERR("pid %d wait task num %u ret %d\n",
+			session->pid, *num, ret);
+	} else if (0 == ret) {
+		IEP_ERR("pid %d wait task num %u timeout, done %d\n",
+			session->pid, *num, atomic_read(&session->num_done));
+		iep_del_running_list_timeout();
+		iep_try_set_reg();
+		iep_try_start_frm();
+		ret = -ETIMEDOUT;
+	}
+
+	*num = atomic_read(&session->num_done);
+
+	return ret;
+}
+
 static void iep_get_result_async(iep_session *session)
 {
 	iep_try_start_frm();
@@ -706,8 +747,9 @@ static long iep_ioctl(struct file *filp, uint32_t cmd, unsigned long arg)
 			if (ret == 0) {
 				if (atomic_read(&iep_service.waitcnt) < 10) {
 					iep_power_on();
-					iep_config(session, msg);
-					atomic_inc(&iep_service.waitcnt);
+					ret = iep_config(session, msg);
+					if (ret == 0)
+						atomic_inc(&iep_service.waitcnt);
 				} else {
 					IEP_ERR("iep task queue full\n");
 					ret = -EFAULT;
@@ -729,6 +771,26 @@ static long iep_ioctl(struct file *filp, uint32_t cmd, unsigned long arg)
 	case IEP_GET_RESULT_ASYNC:
 		iep_get_result_async(session);
 		break;
+	case IEP_GET_RESULT_NUM:
+		{
+			u32 num;
+
+			if (copy_from_user(&num, (void __user *)arg, sizeof(num))) {
+				IEP_ERR("copy_from_user failure\n");
+				ret = -EFAULT;
+				break;
+			}
+
+			ret = iep_get_result_num(session, &num);
+			if (ret > 0)
+				ret = 0;
+
+			if (copy_to_user((void __user *)arg, &num, sizeof(num))) {
+				IEP_ERR("error: copy_to_user failed\n");
+				ret = -EFAULT;
+			}
+		}
+		break;
 	case IEP_RELEASE_CURRENT_TASK:
 		iep_del_running_list_timeout();
 		iep_try_set_reg();
@@ -797,8 +859,9 @@ static long compat_iep_ioctl(struct file *filp, uint32_t cmd,
 			if (ret == 0) {
 				if (atomic_read(&iep_service.waitcnt) < 10) {
 					iep_power_on();
-					iep_config(session, msg);
-					atomic_inc(&iep_service.waitcnt);
+					ret = iep_config(session, msg);
+					if (ret == 0)
+						atomic_inc(&iep_service.waitcnt);
 				} else {
 					IEP_ERR("iep task queue full\n");
 					ret = -EFAULT;
@@ -819,6 +882,26 @@ static long compat_iep_ioctl(struct file *filp, uint32_t cmd,
 	case COMPAT_IEP_GET_RESULT_ASYNC:
 		iep_get_result_async(session);
 		break;
+	case COMPAT_IEP_GET_RESULT_NUM:
+		{
+			u32 num;
+
+			if (copy_from_user(&num, compat_ptr((compat_uptr_t)arg), sizeof(num))) {
+				IEP_ERR("copy_from_user failure\n");
+				ret = -EFAULT;
+				break;
+			}
+
+			ret = iep_get_result_num(session, &num);
+			if (ret > 0)
+				ret = 0;
+
+			if (copy_to_user(compat_ptr((compat_uptr_t)arg), &num, sizeof(num))) {
+				IEP_ERR("error: copy_to_user failed\n");
+				ret = -EFAULT;
+			}
+		}
+		break;
 	case COMPAT_IEP_RELEASE_CURRENT_TASK:
 		iep_del_running_list_timeout();
 		iep_try_set_reg();
@@ -315,6 +315,44 @@ iep_drm_clear_session(struct iep_iommu_session_info *session_info)
 	}
 }
 
+/*
+ * Drop the least recently used buffer which is not referenced by any
+ * pending register table, so that a long running session recycling its
+ * buffers keeps at most BUFFER_LIST_MAX_NUMS mappings.
+ */
+static void iep_drm_evict_idle(struct iep_iommu_session_info *session_info)
+{
+	struct iep_drm_buffer *drm_buffer = NULL, *n, *victim = NULL;
+
+	mutex_lock(&session_info->list_mutex);
+	if (session_info->buffer_nums < BUFFER_LIST_MAX_NUMS) {
+		mutex_unlock(&session_info->list_mutex);
+		return;
+	}
+
+	list_for_each_entry_safe(drm_buffer, n, &session_info->buffer_list,
+				 list) {
+		if (kref_read(&drm_buffer->ref) == 1) {
+			victim = drm_buffer;
+			list_del_init(&victim->list);
+			session_info->buffer_nums--;
+			break;
+		}
+	}
+	mutex_unlock(&session_info->list_mutex);
+
+	if (!victim)
+		return;
+
+	vpu_iommu_debug(session_info->debug_level, DEBUG_IOMMU_NORMAL,
+			"evict index %d, buffer nums %d\n",
+			victim->index, session_info->buffer_nums);
+
+	kref_put(&victim->ref, iep_drm_clear_map);
+	dma_buf_put(victim->dma_buf);
+	kfree(victim);
+}
+
 static int iep_drm_import(struct iep_iommu_session_info *session_info,
 			  int fd)
 {
@@ -334,16 +372,25 @@ static int iep_drm_import(struct iep_iommu_session_info *session_info,
 		return ret;
 	}
 
+	/* the mapping is kept across tasks, recycled buffers just reuse it */
+	mutex_lock(&session_info->list_mutex);
 	list_for_each_entry_safe(drm_buffer, n,
 				 &session_info->buffer_list, list) {
 		if (drm_buffer->dma_buf == dma_buf) {
+			list_move_tail(&drm_buffer->list,
+				       &session_info->buffer_list);
+			mutex_unlock(&session_info->list_mutex);
 			dma_buf_put(dma_buf);
 			return drm_buffer->index;
 		}
 	}
+	mutex_unlock(&session_info->list_mutex);
+
+	iep_drm_evict_idle(session_info);
 
 	drm_buffer = kzalloc(sizeof(*drm_buffer), GFP_KERNEL);
 	if (!drm_buffer) {
+		dma_buf_put(dma_buf);
 		ret = -ENOMEM;
 		return ret;
 	}
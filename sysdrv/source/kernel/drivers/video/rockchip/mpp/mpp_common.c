@@ -13,6 +13,8 @@
 
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/eventfd.h>
+#include <linux/file.h>
 #include <linux/interrupt.h>
 #include <linux/iopoll.h>
 #include <linux/module.h>
@@ -27,6 +29,7 @@
 #include <linux/mfd/syscon.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/sync_file.h>
 #include <linux/uaccess.h>
 #include <linux/nospec.h>
 
@@ -37,6 +40,8 @@
 #include "mpp_iommu.h"
 
 #define MPP_WAIT_TIMEOUT_DELAY		(2000)
+/* pending task waited over it (ms) runs next whatever its priority */
+#define MPP_SCHED_STARVE_DELAY		(200)
 
 /* Use 'v' as magic number */
 #define MPP_IOC_MAGIC		'v'
@@ -114,20 +119,79 @@ mpp_taskqueue_pop_pending(struct mpp_taskqueue *queue,
 	return 0;
 }
 
+/* whether task a should run before task b */
+static bool mpp_task_sched_before(struct mpp_task *a, struct mpp_task *b)
+{
+	if (a->session->sched_prio != b->session->sched_prio)
+		return a->session->sched_prio > b->session->sched_prio;
+	if (a->deadline && b->deadline)
+		return ktime_before(a->deadline, b->deadline);
+
+	return a->deadline && !b->deadline;
+}
+
+/*
+ * Pick the pending task by session priority and then the earliest
+ * deadline. Only the first pending task of each session is candidate
+ * to keep task order in session. The oldest pending task bypasses the
+ * pick once it waited MPP_SCHED_STARVE_DELAY, so that low priority
+ * sessions are not starved by a busy high priority one.
+ */
 static struct mpp_task *
 mpp_taskqueue_get_pending_task(struct mpp_taskqueue *queue)
 {
 	struct mpp_task *task = NULL;
+	struct mpp_task *pos, *prev;
+	bool first;
 
 	mutex_lock(&queue->pending_lock);
 	task = list_first_entry_or_null(&queue->pending_list,
 					struct mpp_task,
 					queue_link);
+	if (task && task->on_queue &&
+	    ktime_ms_delta(ktime_get(), task->on_queue) >= MPP_SCHED_STARVE_DELAY)
+		goto done;
+	task = NULL;
+	list_for_each_entry(pos, &queue->pending_list, queue_link) {
+		/* also holds later tasks of same session by the check below */
+		if (pos->in_fence && !dma_fence_is_signaled(pos->in_fence))
+			continue;
+		if (task && !mpp_task_sched_before(pos, task))
+			continue;
+		first = true;
+		list_for_each_entry(prev, &queue->pending_list, queue_link) {
+			if (prev == pos)
+				break;
+			if (prev->session == pos->session) {
+				first = false;
+				break;
+			}
+		}
+		if (first)
+			task = pos;
+	}
+done:
 	mutex_unlock(&queue->pending_lock);
 
 	return task;
 }
 
+static void mpp_task_sched_update(struct mpp_task *task)
+{
+	struct mpp_session *session = task->session;
+	ktime_t now = ktime_get();
+	u32 wait_us = ktime_us_delta(now, task->on_queue);
+
+	session->sched_cnt++;
+	session->sched_wait_us += wait_us;
+	if (wait_us > session->sched_wait_max_us)
+		session->sched_wait_max_us = wait_us;
+	if (task->deadline && ktime_after(now, task->deadline))
+		session->sched_miss++;
+	if (wait_us >= MPP_SCHED_STARVE_DELAY * USEC_PER_MSEC)
+		session->sched_starve++;
+}
+
 static bool
 mpp_taskqueue_is_running(struct mpp_taskqueue *queue)
 {
@@ -231,6 +295,13 @@ static void task_msgs_reset(struct mpp_task_msgs *msgs)
 	msgs->req_cnt = 0;
 	msgs->set_cnt = 0;
 	msgs->poll_cnt = 0;
+	msgs->timing_req = NULL;
+	msgs->out_fence_req = NULL;
+	/* in fence not taken by any task */
+	if (msgs->in_fence) {
+		dma_fence_put(msgs->in_fence);
+		msgs->in_fence = NULL;
+	}
 }
 
 static void task_msgs_init(struct mpp_task_msgs *msgs, struct mpp_session *session)
@@ -388,6 +459,8 @@ static struct mpp_session *mpp_session_init(void)
 		return NULL;
 
 	session->pid = current->pid;
+	session->sched_prio = MPP_SCHED_PRIO_NORMAL;
+	session->fence_context = dma_fence_context_alloc(1);
 
 	mutex_init(&session->pending_lock);
 	INIT_LIST_HEAD(&session->pending_list);
@@ -521,6 +594,142 @@ mpp_session_get_pending_task(struct mpp_session *session)
 	return task;
 }
 
+static struct mpp_batch *mpp_batch_create(int fd)
+{
+	struct mpp_batch *batch;
+	struct eventfd_ctx *ctx;
+
+	ctx = eventfd_ctx_fdget(fd);
+	if (IS_ERR(ctx)) {
+		mpp_err("fd %d get eventfd failed\n", fd);
+		return ERR_CAST(ctx);
+	}
+
+	batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+	if (!batch) {
+		eventfd_ctx_put(ctx);
+		return ERR_PTR(-ENOMEM);
+	}
+	/* hold by ioctl until all tasks are triggered */
+	atomic_set(&batch->remain, 1);
+	batch->ctx = ctx;
+
+	return batch;
+}
+
+static void mpp_batch_put(struct mpp_batch *batch)
+{
+	if (!atomic_dec_and_test(&batch->remain))
+		return;
+
+	eventfd_signal(batch->ctx, 1);
+	eventfd_ctx_put(batch->ctx);
+	kfree(batch);
+}
+
+static void mpp_task_batch_done(struct mpp_task *task)
+{
+	struct mpp_batch *batch = xchg(&task->batch, NULL);
+
+	if (batch)
+		mpp_batch_put(batch);
+}
+
+static const char *mpp_fence_get_name(struct dma_fence *fence)
+{
+	return "mpp";
+}
+
+static const struct dma_fence_ops mpp_fence_ops = {
+	.get_driver_name = mpp_fence_get_name,
+	.get_timeline_name = mpp_fence_get_name,
+};
+
+static void mpp_task_in_fence_cb(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct mpp_task *task = container_of(cb, struct mpp_task, in_fence_cb);
+
+	mpp_taskqueue_trigger_work(mpp_get_task_used_device(task, task->session));
+}
+
+static void mpp_task_attach_in_fence(struct mpp_task *task, struct mpp_task_msgs *msgs)
+{
+	struct dma_fence *fence = msgs->in_fence;
+
+	if (!fence)
+		return;
+
+	msgs->in_fence = NULL;
+	task->in_fence = fence;
+	/* already signaled, no need to wait */
+	if (dma_fence_add_callback(fence, &task->in_fence_cb, mpp_task_in_fence_cb)) {
+		task->in_fence = NULL;
+		dma_fence_put(fence);
+	}
+}
+
+static int mpp_task_attach_out_fence(struct mpp_task *task, struct mpp_task_msgs *msgs,
+				     struct mpp_taskqueue *queue)
+{
+	struct mpp_request *req = msgs->out_fence_req;
+	struct sync_file *sync_file;
+	struct dma_fence *fence;
+	int fd, ret;
+
+	if (!req)
+		return 0;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence)
+		return -ENOMEM;
+
+	dma_fence_init(fence, &mpp_fence_ops, &queue->fence_lock,
+		       task->session->fence_context, task->task_id);
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		ret = fd;
+		goto fail_put;
+	}
+
+	sync_file = sync_file_create(fence);
+	if (!sync_file) {
+		ret = -ENOMEM;
+		goto fail_fd;
+	}
+
+	if (copy_to_user(req->data, &fd, sizeof(fd))) {
+		mpp_err("copy_to_user failed.\n");
+		fput(sync_file->file);
+		ret = -EFAULT;
+		goto fail_fd;
+	}
+
+	fd_install(fd, sync_file->file);
+	task->out_fence = fence;
+
+	return 0;
+
+fail_fd:
+	put_unused_fd(fd);
+fail_put:
+	dma_fence_put(fence);
+	return ret;
+}
+
+static void mpp_task_signal_fence(struct mpp_task *task, int error)
+{
+	struct dma_fence *fence = xchg(&task->out_fence, NULL);
+
+	if (!fence)
+		return;
+
+	if (error)
+		dma_fence_set_error(fence, error);
+	dma_fence_signal(fence);
+	dma_fence_put(fence);
+}
+
 void mpp_free_task(struct kref *ref)
 {
 	struct mpp_dev *mpp;
@@ -532,6 +741,14 @@ void mpp_free_task(struct kref *ref)
 		return;
 	}
 	session = task->session;
+	/* task aborted or not done by common path, still release batch */
+	mpp_task_batch_done(task);
+	mpp_task_signal_fence(task, -ECANCELED);
+	if (task->in_fence) {
+		dma_fence_remove_callback(task->in_fence, &task->in_fence_cb);
+		dma_fence_put(task->in_fence);
+		task->in_fence = NULL;
+	}
 
 	mpp_debug_func(DEBUG_TASK_INFO, "task %d:%d free state 0x%lx abort %d\n",
 		       session->index, task->task_id, task->state,
@@ -593,6 +810,8 @@ static void mpp_task_timeout_work(struct work_struct *work_s)
 	set_bit(TASK_STATE_DONE, &task->state);
 	/* Wake up the GET thread */
 	wake_up(&task->wait);
+	mpp_task_batch_done(task);
+	mpp_task_signal_fence(task, -ETIMEDOUT);
 
 	/* remove task from taskqueue running list */
 	mpp_taskqueue_pop_running(mpp->queue, task);
@@ -612,6 +831,7 @@ static int mpp_process_task_default(struct mpp_session *session,
 	struct mpp_task *task = NULL;
 	struct mpp_dev *mpp = session->mpp;
 	u32 timing_en;
+	int ret;
 	ktime_t on_create;
 
 	if (unlikely(!mpp)) {
@@ -648,6 +868,16 @@ static int mpp_process_task_default(struct mpp_session *session,
 	task->task_id = atomic_fetch_inc(&mpp->queue->task_id);
 	INIT_DELAYED_WORK(&task->timeout_work, mpp_task_timeout_work);
 
+	/* no task without the fence userspace asked for */
+	ret = mpp_task_attach_out_fence(task, msgs, mpp->queue);
+	if (ret) {
+		mpp_err("task %d create out fence failed\n", task->task_id);
+		if (mpp->dev_ops->free_task)
+			mpp->dev_ops->free_task(session, task);
+		return ret;
+	}
+	mpp_task_attach_in_fence(task, msgs);
+
 	if (mpp->auto_freq_en && mpp->hw_ops->get_freq)
 		mpp->hw_ops->get_freq(mpp, task);
 
@@ -772,6 +1002,7 @@ void mpp_task_run_begin(struct mpp_task *task, u32 timing_en, u32 timeout)
 	set_bit(TASK_STATE_START, &task->state);
 
 	mpp_time_record(task);
+	task->on_hw_run = ktime_get();
 	schedule_delayed_work(&task->timeout_work, msecs_to_jiffies(timeout));
 
 	if (timing_en) {
@@ -896,6 +1127,7 @@ again:
 		struct mpp_dev *task_mpp = mpp_get_task_used_device(task, task->session);
 
 		atomic_inc(&task_mpp->task_count);
+		mpp_task_sched_update(task);
 		mpp_taskqueue_pending_to_run(queue, task);
 		set_bit(TASK_STATE_RUNNING, &task->state);
 		if (mpp_task_run(task_mpp, task))
@@ -929,6 +1161,8 @@ static int mpp_wait_result_default(struct mpp_session *session,
 	if (ret > 0) {
 		if (mpp->dev_ops->result)
 			ret = mpp->dev_ops->result(mpp, task, msgs);
+		if (!ret)
+			ret = mpp_task_export_timing(task, msgs);
 	} else {
 		atomic_inc(&task->abort_request);
 		set_bit(TASK_STATE_ABORT, &task->state);
@@ -1044,6 +1278,7 @@ struct mpp_taskqueue *mpp_taskqueue_init(struct device *dev)
 	atomic_set(&queue->reset_request, 0);
 	atomic_set(&queue->detach_count, 0);
 	atomic_set(&queue->task_id, 0);
+	spin_lock_init(&queue->fence_lock);
 	queue->dev_active_flags = 0;
 
 	return queue;
@@ -1323,6 +1558,37 @@ static int mpp_process_request(struct mpp_session *session,
 			msgs->poll_req = NULL;
 		}
 	} break;
+	case MPP_CMD_SET_IN_FENCE: {
+		struct dma_fence *fence;
+		int fd;
+
+		if (req->size < sizeof(fd))
+			return -EINVAL;
+		if (copy_from_user(&fd, req->data, sizeof(fd))) {
+			mpp_err("copy_from_user failed.\n");
+			return -EINVAL;
+		}
+		fence = sync_file_get_fence(fd);
+		if (!fence) {
+			mpp_err("fd %d is not a sync file\n", fd);
+			return -EINVAL;
+		}
+		if (msgs->in_fence)
+			dma_fence_put(msgs->in_fence);
+		msgs->in_fence = fence;
+	} break;
+	case MPP_CMD_SET_OUT_FENCE: {
+		if (req->size < sizeof(int))
+			return -EINVAL;
+		/* fence fd written back when the task of same msgs created */
+		msgs->out_fence_req = req;
+	} break;
+	case MPP_CMD_POLL_TASK_TIMING: {
+		if (req->size < sizeof(struct mpp_task_timing))
+			return -EINVAL;
+		/* write back with the result of task polled in same msgs */
+		msgs->timing_req = req;
+	} break;
 	case MPP_CMD_RESET_SESSION: {
 		int ret;
 		int val;
@@ -1408,6 +1674,20 @@ static int mpp_process_request(struct mpp_session *session,
 			}
 		}
 	} break;
+	case MPP_CMD_SET_SESSION_SCHED: {
+		struct mpp_sched_info info;
+
+		if (req->size < sizeof(info))
+			return -EINVAL;
+		if (copy_from_user(&info, req->data, sizeof(info))) {
+			mpp_err("copy_from_user failed.\n");
+			return -EINVAL;
+		}
+		if (info.prio >= MPP_SCHED_PRIO_BUTT)
+			return -EINVAL;
+		session->sched_prio = info.prio;
+		session->sched_deadline_us = info.deadline_us;
+	} break;
 	default: {
 		mpp = session->mpp;
 		if (!mpp) {
@@ -1425,7 +1705,8 @@ static int mpp_process_request(struct mpp_session *session,
 	return 0;
 }
 
-static void task_msgs_add(struct mpp_task_msgs *msgs, struct list_head *head)
+static void task_msgs_add(struct mpp_task_msgs *msgs, struct list_head *head,
+			  struct mpp_batch *batch)
 {
 	struct mpp_session *session = msgs->session;
 	int ret = 0;
@@ -1438,6 +1719,11 @@ static void task_msgs_add(struct mpp_task_msgs *msgs, struct list_head *head)
 	}
 
 	if (!ret) {
+		/* only task from default process could be tracked by batch */
+		if (batch && msgs->set_cnt && msgs->task) {
+			atomic_inc(&batch->remain);
+			msgs->task->batch = batch;
+		}
 		INIT_LIST_HEAD(&msgs->list);
 		list_add_tail(&msgs->list, head);
 	} else {
@@ -1446,7 +1732,8 @@ static void task_msgs_add(struct mpp_task_msgs *msgs, struct list_head *head)
 }
 
 static int mpp_collect_msgs(struct list_head *head, struct mpp_session *session,
-			    unsigned int cmd, void __user *msg)
+			    unsigned int cmd, void __user *msg,
+			    struct mpp_batch **batch)
 {
 	struct mpp_msg_v1 msg_v1;
 	struct mpp_request *req;
@@ -1509,7 +1796,7 @@ next:
 		/* NOTE: add previous ready task to queue and drop empty task */
 		if (msgs) {
 			if (msgs->req_cnt)
-				task_msgs_add(msgs, head);
+				task_msgs_add(msgs, head, *batch);
 			else
 				put_task_msgs(msgs);
 
@@ -1536,6 +1823,33 @@ session_switch_done:
 		goto next;
 	}
 
+	/* check cmd for all following tasks in this ioctl as one batch */
+	if (msg_v1.cmd == MPP_CMD_SET_BATCH_EVENTFD) {
+		struct mpp_batch *bat;
+		int fd;
+
+		if (*batch) {
+			mpp_err("batch eventfd can only be set once\n");
+			return -EINVAL;
+		}
+		if (msg_v1.size < sizeof(fd))
+			return -EINVAL;
+		if (copy_from_user(&fd, (void __user *)(unsigned long)msg_v1.data_ptr,
+				   sizeof(fd)))
+			return -EFAULT;
+
+		bat = mpp_batch_create(fd);
+		if (IS_ERR(bat))
+			return PTR_ERR(bat);
+		*batch = bat;
+
+		/* batch eventfd should NOT be the last message */
+		if (last)
+			return 0;
+
+		goto next;
+	}
+
 	if (!msgs)
 		msgs = get_task_msgs(session);
 
@@ -1568,7 +1882,7 @@ session_switch_done:
 	if (!last)
 		goto next;
 
-	task_msgs_add(msgs, head);
+	task_msgs_add(msgs, head, *batch);
 	msgs = NULL;
 
 	return 0;
@@ -1610,6 +1924,9 @@ static void mpp_msgs_trigger(struct list_head *msgs_list)
 			pr_info("try to trigger abort task %d\n", task->task_id);
 
 		set_bit(TASK_STATE_PENDING, &task->state);
+		task->on_queue = ktime_get();
+		task->deadline = msgs->session->sched_deadline_us ?
+			ktime_add_us(task->on_queue, msgs->session->sched_deadline_us) : 0;
 		list_add_tail(&task->queue_link, &queue->pending_list);
 	}
 
@@ -1646,6 +1963,7 @@ static long mpp_dev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
 	struct mpp_service *srv;
 	struct mpp_session *session = (struct mpp_session *)filp->private_data;
 	struct list_head msgs_list;
+	struct mpp_batch *batch = NULL;
 	int ret = 0;
 
 	mpp_debug_enter();
@@ -1668,12 +1986,16 @@ static long mpp_dev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
 
 	INIT_LIST_HEAD(&msgs_list);
 
-	ret = mpp_collect_msgs(&msgs_list, session, cmd, (void __user *)arg);
+	ret = mpp_collect_msgs(&msgs_list, session, cmd, (void __user *)arg, &batch);
 	if (ret)
 		mpp_err("collect msgs failed %d\n", ret);
 
 	mpp_msgs_trigger(&msgs_list);
 
+	/* drop ioctl hold, eventfd signal here if all tasks already done */
+	if (batch)
+		mpp_batch_put(batch);
+
 	mpp_msgs_wait(&msgs_list);
 
 	mpp_debug_leave();
@@ -1788,6 +2110,8 @@ mpp_task_attach_fd(struct mpp_task *task, int fd)
 		mem_region->len = buffer->size;
 		mem_region->fd = fd;
 		mem_region->is_dup = false;
+		mem_region->is_borrow =
+			!!(task->session->msg_flags & MPP_FLAGS_BORROW_FD);
 	}
 	task->mem_count++;
 	INIT_LIST_HEAD(&mem_region->reg_link);
@@ -1954,6 +2278,9 @@ int mpp_task_init(struct mpp_session *session, struct mpp_task *task)
 	task->state = 0;
 	task->mem_count = 0;
 	task->session = session;
+	task->batch = NULL;
+	task->in_fence = NULL;
+	task->out_fence = NULL;
 
 	return 0;
 }
@@ -1988,6 +2315,8 @@ int mpp_task_finish(struct mpp_session *session,
 
 	/* Wake up the GET thread */
 	wake_up(&task->wait);
+	mpp_task_batch_done(task);
+	mpp_task_signal_fence(task, 0);
 	mpp_taskqueue_pop_running(mpp->queue, task);
 
 	return 0;
@@ -2005,7 +2334,10 @@ int mpp_task_finalize(struct mpp_session *session,
 				 reg_link) {
 		if (!mem_region->is_dup) {
 			mpp_iommu_down_read(mpp->iommu_info);
-			mpp_dma_release(session->dma, mem_region->hdl);
+			if (mem_region->is_borrow)
+				mpp_dma_release_borrow(session->dma, mem_region->hdl);
+			else
+				mpp_dma_release(session->dma, mem_region->hdl);
 			mpp_iommu_up_read(mpp->iommu_info);
 		}
 		list_del_init(&mem_region->reg_link);
@@ -2282,6 +2614,7 @@ irqreturn_t mpp_dev_irq(int irq, void *param)
 				set_bit(TASK_TIMING_TO_CANCEL, &task->state);
 			}
 			cancel_delayed_work(&task->timeout_work);
+			task->on_hw_irq = ktime_get();
 			/* normal condition, set state and wake up isr thread */
 			set_bit(TASK_STATE_IRQ, &task->state);
 		}
@@ -2442,6 +2775,37 @@ void mpp_task_dump_timing(struct mpp_task *task, s64 time_diff)
 	LOG_TIMING(state, TASK_TIMING_FINISH,     "finish",         task->on_finish, s);
 }
 
+int mpp_task_export_timing(struct mpp_task *task, struct mpp_task_msgs *msgs)
+{
+	struct mpp_task_timing timing;
+	struct mpp_request *req = msgs ? msgs->timing_req : NULL;
+	ktime_t now;
+
+	if (!req)
+		return 0;
+
+	now = ktime_get();
+	memset(&timing, 0, sizeof(timing));
+	if (task->on_queue && task->on_hw_run)
+		timing.wait_us = ktime_us_delta(task->on_hw_run, task->on_queue);
+	if (task->on_hw_run && task->on_hw_irq) {
+		timing.run_us = ktime_us_delta(task->on_hw_irq, task->on_hw_run);
+		timing.wakeup_us = ktime_us_delta(now, task->on_hw_irq);
+	}
+	timing.hw_cycles = task->hw_cycles;
+
+	mpp_debug(DEBUG_TIMING, "task %d wait %u run %u wakeup %u us cycles %u\n",
+		  task->task_id, timing.wait_us, timing.run_us,
+		  timing.wakeup_us, timing.hw_cycles);
+
+	if (copy_to_user(req->data, &timing, sizeof(timing))) {
+		mpp_err("copy_to_user failed.\n");
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
 int mpp_write_req(struct mpp_dev *mpp, u32 *regs,
 		  u32 start_idx, u32 end_idx, u32 en_idx)
 {
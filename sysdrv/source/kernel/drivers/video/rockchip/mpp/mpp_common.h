@@ -37,6 +37,8 @@
 #define MPP_FLAGS_REG_FD_NO_TRANS	(0x00000004)
 #define MPP_FLAGS_SCL_FD_NO_TRANS	(0x00000008)
 #define MPP_FLAGS_REG_NO_OFFSET		(0x00000010)
+/* buffer borrowed from other pool, do not keep it mapped after task done */
+#define MPP_FLAGS_BORROW_FD		(0x00000020)
 #define MPP_FLAGS_SECURE_MODE		(0x00010000)
 
 /* grf mask for get value */
@@ -115,11 +117,14 @@ enum MPP_DEV_COMMAND_TYPE {
 	MPP_CMD_SET_REG_ADDR_OFFSET	= MPP_CMD_SEND_BASE + 2,
 	MPP_CMD_SET_RCB_INFO		= MPP_CMD_SEND_BASE + 3,
 	MPP_CMD_SET_SESSION_FD		= MPP_CMD_SEND_BASE + 4,
+	MPP_CMD_SET_IN_FENCE		= MPP_CMD_SEND_BASE + 5,
+	MPP_CMD_SET_OUT_FENCE		= MPP_CMD_SEND_BASE + 6,
 	MPP_CMD_SEND_BUTT,
 
 	MPP_CMD_POLL_BASE		= 0x300,
 	MPP_CMD_POLL_HW_FINISH		= MPP_CMD_POLL_BASE + 0,
 	MPP_CMD_POLL_HW_IRQ		= MPP_CMD_POLL_BASE + 1,
+	MPP_CMD_POLL_TASK_TIMING	= MPP_CMD_POLL_BASE + 2,
 	MPP_CMD_POLL_BUTT,
 
 	MPP_CMD_CONTROL_BASE		= 0x400,
@@ -127,6 +132,8 @@ enum MPP_DEV_COMMAND_TYPE {
 	MPP_CMD_TRANS_FD_TO_IOVA	= MPP_CMD_CONTROL_BASE + 1,
 	MPP_CMD_RELEASE_FD		= MPP_CMD_CONTROL_BASE + 2,
 	MPP_CMD_SEND_CODEC_INFO		= MPP_CMD_CONTROL_BASE + 3,
+	MPP_CMD_SET_SESSION_SCHED	= MPP_CMD_CONTROL_BASE + 4,
+	MPP_CMD_SET_BATCH_EVENTFD	= MPP_CMD_CONTROL_BASE + 5,
 	MPP_CMD_CONTROL_BUTT,
 
 	MPP_CMD_BUTT,
@@ -194,6 +201,7 @@ struct mpp_session;
 struct mpp_dma_session;
 struct mpp_taskqueue;
 struct iommu_domain;
+struct eventfd_ctx;
 
 /* data common struct for parse out */
 struct mpp_request {
@@ -204,6 +212,49 @@ struct mpp_request {
 	void __user *data;
 };
 
+/* session priority class, higher one run first */
+enum MPP_SCHED_PRIO {
+	MPP_SCHED_PRIO_LOW	= 0,
+	MPP_SCHED_PRIO_NORMAL	= 1,
+	MPP_SCHED_PRIO_HIGH	= 2,
+	MPP_SCHED_PRIO_BUTT,
+};
+
+/*
+ * struct use to set session schedule by MPP_CMD_SET_SESSION_SCHED
+ * prio: enum MPP_SCHED_PRIO
+ * deadline_us: deadline of next tasks since queued, 0 for none,
+ *		the earliest one run first in the same priority
+ */
+struct mpp_sched_info {
+	__u32 prio;
+	__u32 deadline_us;
+};
+
+/*
+ * batch of tasks set in one ioctl by MPP_CMD_SET_BATCH_EVENTFD
+ * remain: tasks not done yet, plus one hold by the ioctl itself
+ * ctx: eventfd signaled once when all tasks in batch are done
+ */
+struct mpp_batch {
+	atomic_t remain;
+	struct eventfd_ctx *ctx;
+};
+
+/*
+ * struct use to return task timing by MPP_CMD_POLL_TASK_TIMING
+ * wait_us: from task queued to hardware start
+ * run_us: from hardware start to hardware irq
+ * wakeup_us: from hardware irq to the poll thread getting result
+ * hw_cycles: hardware cycles if device reports, otherwise 0
+ */
+struct mpp_task_timing {
+	__u32 wait_us;
+	__u32 run_us;
+	__u32 wakeup_us;
+	__u32 hw_cycles;
+};
+
 /* struct use to collect task set and poll message */
 struct mpp_task_msgs {
 	/* for ioctl msgs bat process */
@@ -226,6 +277,10 @@ struct mpp_task_msgs {
 
 	struct mpp_request reqs[MPP_MAX_MSG_NUM];
 	struct mpp_request *poll_req;
+	struct mpp_request *timing_req;
+	/* fence from MPP_CMD_SET_IN_FENCE, moved to task when task created */
+	struct dma_fence *in_fence;
+	struct mpp_request *out_fence_req;
 };
 
 struct mpp_grf_info {
@@ -310,6 +365,8 @@ struct mpp_mem_region {
 	int fd;
 	/* whether is dup import entity */
 	bool is_dup;
+	/* whether is borrowed buffer to drop from session after task */
+	bool is_borrow;
 };
 
 
@@ -388,6 +445,8 @@ struct mpp_session {
 	pid_t pid;
 	atomic_t task_count;
 	atomic_t release_request;
+	/* timeline of task out fences, tasks of a session finish in order */
+	u64 fence_context;
 	/* trans info set by user */
 	int trans_count;
 	u16 trans_table[MPP_MAX_REG_TRANS_NUM];
@@ -416,6 +475,16 @@ struct mpp_session {
 	struct list_head list_msgs;
 	struct list_head list_msgs_idle;
 	spinlock_t lock_msgs;
+
+	/* schedule in taskqueue and task wait time from queued to run */
+	u32 sched_prio;
+	u32 sched_deadline_us;
+	u64 sched_wait_us;
+	u32 sched_wait_max_us;
+	u32 sched_cnt;
+	u32 sched_miss;
+	/* tasks waited over the starvation bound */
+	u32 sched_starve;
 };
 
 /* task state in work thread */
@@ -499,6 +568,19 @@ struct mpp_task {
 	s32 core_id;
 	/* hw cycles */
 	u32 hw_cycles;
+	/* time queued to taskqueue and deadline to run, 0 for none */
+	ktime_t on_queue;
+	ktime_t deadline;
+	/* batch to notify when task done */
+	struct mpp_batch *batch;
+	/* always recorded for timing export */
+	ktime_t on_hw_run;
+	ktime_t on_hw_irq;
+	/* task stays pending until in_fence signaled */
+	struct dma_fence *in_fence;
+	struct dma_fence_cb in_fence_cb;
+	/* signaled when task done */
+	struct dma_fence *out_fence;
 };
 
 struct mpp_taskqueue {
@@ -516,6 +598,8 @@ struct mpp_taskqueue {
 	atomic_t detach_count;
 
 	atomic_t task_id;
+	/* lock of task out fences, outlives the sessions */
+	spinlock_t fence_lock;
 	/* lock for pending list */
 	struct mutex pending_lock;
 	struct list_head pending_list;
@@ -684,6 +768,7 @@ int mpp_task_dump_reg(struct mpp_dev *mpp,
 		      struct mpp_task *task);
 int mpp_task_dump_hw_reg(struct mpp_dev *mpp);
 void mpp_task_dump_timing(struct mpp_task *task, s64 time_diff);
+int mpp_task_export_timing(struct mpp_task *task, struct mpp_task_msgs *msgs);
 
 void mpp_reg_show(struct mpp_dev *mpp, u32 offset);
 void mpp_reg_show_range(struct mpp_dev *mpp, u32 start, u32 end);
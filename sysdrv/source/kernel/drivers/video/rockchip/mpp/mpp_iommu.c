@@ -99,8 +99,10 @@ mpp_dma_remove_extra_buffer(struct mpp_dma_session *dma)
 				oldest = buffer;
 			}
 		}
-		if (oldest && kref_read(&oldest->ref) <= 1)
+		if (oldest && kref_read(&oldest->ref) <= 1) {
 			kref_put(&oldest->ref, mpp_dma_release_buffer);
+			dma->evict_cnt++;
+		}
 		mutex_unlock(&dma->list_mutex);
 	}
 
@@ -117,6 +119,23 @@ int mpp_dma_release(struct mpp_dma_session *dma,
 	return 0;
 }
 
+/*
+ * Release the task reference of a borrowed buffer, and also drop it from
+ * the session list when nobody else uses it, so that the buffer owner pool
+ * is not pinned by the session cache after the task.
+ */
+int mpp_dma_release_borrow(struct mpp_dma_session *dma,
+			   struct mpp_dma_buffer *buffer)
+{
+	mutex_lock(&dma->list_mutex);
+	if (!kref_put(&buffer->ref, mpp_dma_release_buffer) &&
+	    kref_read(&buffer->ref) == 1)
+		kref_put(&buffer->ref, mpp_dma_release_buffer);
+	mutex_unlock(&dma->list_mutex);
+
+	return 0;
+}
+
 int mpp_dma_release_fd(struct mpp_dma_session *dma, int fd)
 {
 	struct device *dev = dma->dev;
@@ -198,6 +217,7 @@ struct mpp_dma_buffer *mpp_dma_import_fd(struct mpp_iommu_info *iommu_info,
 	if (!IS_ERR_OR_NULL(buffer)) {
 		if (kref_get_unless_zero(&buffer->ref)) {
 			buffer->last_used = ktime_get();
+			dma->hit_cnt++;
 			return buffer;
 		}
 		dev_dbg(dma->dev, "missing the fd %d\n", fd);
@@ -253,6 +273,7 @@ struct mpp_dma_buffer *mpp_dma_import_fd(struct mpp_iommu_info *iommu_info,
 
 	mutex_lock(&dma->list_mutex);
 	dma->buffer_count++;
+	dma->miss_cnt++;
 	list_add_tail(&buffer->link, &dma->used_list);
 	mutex_unlock(&dma->list_mutex);
 
@@ -341,6 +362,29 @@ int mpp_dma_session_destroy(struct mpp_dma_session *dma)
 	return 0;
 }
 
+/* total size of buffers imported in session, for memory accounting */
+unsigned long mpp_dma_session_size(struct mpp_dma_session *dma, u32 *count)
+{
+	struct mpp_dma_buffer *buffer = NULL;
+	unsigned long size = 0;
+	u32 cnt = 0;
+
+	if (!dma)
+		return 0;
+
+	mutex_lock(&dma->list_mutex);
+	list_for_each_entry(buffer, &dma->used_list, link) {
+		size += buffer->size;
+		cnt++;
+	}
+	mutex_unlock(&dma->list_mutex);
+
+	if (count)
+		*count = cnt;
+
+	return size;
+}
+
 struct mpp_dma_session *
 mpp_dma_session_create(struct device *dev, u32 max_buffers)
 {
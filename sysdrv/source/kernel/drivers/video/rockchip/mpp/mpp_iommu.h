@@ -51,6 +51,10 @@ struct mpp_dma_session {
 	u32 max_buffers;
 	/* the count for the buffer list */
 	int buffer_count;
+	/* import statistic: found in list, new mapped and evicted */
+	u32 hit_cnt;
+	u32 miss_cnt;
+	u32 evict_cnt;
 
 	struct device *dev;
 };
@@ -88,6 +92,7 @@ struct mpp_iommu_info {
 struct mpp_dma_session *
 mpp_dma_session_create(struct device *dev, u32 max_buffers);
 int mpp_dma_session_destroy(struct mpp_dma_session *dma);
+unsigned long mpp_dma_session_size(struct mpp_dma_session *dma, u32 *count);
 
 struct mpp_dma_buffer *
 mpp_dma_alloc(struct device *dev, size_t size);
@@ -99,6 +104,8 @@ mpp_dma_import_fd(struct mpp_iommu_info *iommu_info,
 int mpp_dma_release(struct mpp_dma_session *dma,
 		    struct mpp_dma_buffer *buffer);
 int mpp_dma_release_fd(struct mpp_dma_session *dma, int fd);
+int mpp_dma_release_borrow(struct mpp_dma_session *dma,
+			   struct mpp_dma_buffer *buffer);
 
 int mpp_dma_unmap_kernel(struct mpp_dma_session *dma,
 			 struct mpp_dma_buffer *buffer);
@@ -9,6 +9,7 @@
 #include <linux/delay.h>
 #include <linux/interrupt.h>
 #include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <soc/rockchip/pm_domains.h>
 #include <soc/rockchip/rockchip_dmc.h>
@@ -971,6 +972,26 @@ err_free_node:
 }
 
 #ifdef CONFIG_ROCKCHIP_MPP_PROC_FS
+static int rkvdec2_link_show_ring(struct seq_file *seq, void *offset)
+{
+	struct rkvdec_link_dev *link_dec = seq->private;
+	u32 batch_cnt = link_dec->batch_cnt;
+
+	seq_printf(seq, "size %d running %u prepared %u\n",
+		   link_dec->task_size, link_dec->task_running,
+		   link_dec->task_prepared);
+	seq_printf(seq, "write %d read %d send %d recv %d\n",
+		   link_dec->task_write, link_dec->task_read,
+		   link_dec->task_send, link_dec->task_recv);
+	seq_printf(seq, "total %u decoded %u error %u\n",
+		   link_dec->total, link_dec->decoded, link_dec->error);
+	seq_printf(seq, "batch %u tasks %u avg %u\n", batch_cnt,
+		   link_dec->batch_task_cnt,
+		   batch_cnt ? link_dec->batch_task_cnt / batch_cnt : 0);
+
+	return 0;
+}
+
 int rkvdec2_link_procfs_init(struct mpp_dev *mpp)
 {
 	struct rkvdec2_dev *dec = to_rkvdec2_dev(mpp);
@@ -981,9 +1002,14 @@ int rkvdec2_link_procfs_init(struct mpp_dev *mpp)
 
 	link_dec->statistic_count = 0;
 
-	if (dec->procfs)
+	if (dec->procfs) {
 		mpp_procfs_create_u32("statistic_count", 0644,
 				      dec->procfs, &link_dec->statistic_count);
+		mpp_procfs_create_u32("link_batch", 0644,
+				      dec->procfs, &link_dec->batch_max);
+		proc_create_single_data("link_ring", 0444, dec->procfs,
+					rkvdec2_link_show_ring, link_dec);
+	}
 
 	return 0;
 }
@@ -1284,8 +1310,6 @@ static int mpp_task_queue(struct mpp_dev *mpp, struct mpp_task *task)
 {
 	struct rkvdec2_dev *dec = to_rkvdec2_dev(mpp);
 	struct rkvdec_link_dev *link_dec = dec->link_dec;
-	u32 task_to_run = 0;
-	int slot_idx = 0;
 
 	mpp_debug_enter();
 
@@ -1298,23 +1322,36 @@ static int mpp_task_queue(struct mpp_dev *mpp, struct mpp_task *task)
 		mpp_err("task %d has been prepare twice\n", task->task_id);
 
 	rkvdec2_link_prepare(mpp, task);
-
-	task_to_run = link_dec->task_to_run;
-	if (!task_to_run) {
+	if (!link_dec->task_to_run)
 		dev_err(link_dec->dev, "nothing to run\n");
-		goto done;
-	}
+
+	mpp_debug_leave();
+
+	return 0;
+}
+
+/*
+ * Send all tasks prepared in ring to hardware by one config, then the
+ * hardware chains through them without cpu between frames.
+ */
+static void rkvdec2_link_send_prepared(struct mpp_dev *mpp)
+{
+	struct rkvdec2_dev *dec = to_rkvdec2_dev(mpp);
+	struct rkvdec_link_dev *link_dec = dec->link_dec;
+	u32 task_to_run = link_dec->task_to_run;
+	int slot_idx;
+
+	if (!task_to_run)
+		return;
 
 	mpp_reset_down_read(mpp->reset_group);
 	link_dec->task_to_run = 0;
 	slot_idx = rkvdec_link_get_task_send(link_dec);
 	link_dec->task_running += task_to_run;
-	rkvdec_link_send_task_to_hw(link_dec, task, slot_idx, task_to_run, 0);
-
-done:
-	mpp_debug_leave();
+	rkvdec_link_send_task_to_hw(link_dec, NULL, slot_idx, task_to_run, 0);
 
-	return 0;
+	link_dec->batch_cnt++;
+	link_dec->batch_task_cnt += task_to_run;
 }
 
 irqreturn_t rkvdec2_link_irq_proc(int irq, void *param)
@@ -1502,9 +1539,11 @@ again:
 	}
 
 	/*
-	 * if target device can accept more task send the task to run.
+	 * if target device can accept more task fill the task to ring,
+	 * all tasks filled are sent to hardware together.
 	 */
-	if (link_dec->task_running >= link_dec->task_capacity - 2)
+	if (link_dec->task_running + link_dec->task_to_run >=
+	    link_dec->task_capacity - 2)
 		goto done;
 
 	if (mpp_task_queue(mpp, task)) {
@@ -1516,9 +1555,14 @@ again:
 		set_bit(TASK_STATE_RUNNING, &task->state);
 		list_move_tail(&task->queue_link, &queue->running_list);
 		mutex_unlock(&queue->pending_lock);
+
+		if (link_dec->batch_max &&
+		    link_dec->task_to_run >= link_dec->batch_max)
+			rkvdec2_link_send_prepared(mpp);
 		goto again;
 	}
 done:
+	rkvdec2_link_send_prepared(mpp);
 	mpp_debug_leave();
 
 	if (link_dec->task_irq != link_dec->task_irq_prev ||
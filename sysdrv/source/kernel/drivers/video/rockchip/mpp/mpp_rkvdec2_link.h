@@ -183,6 +183,12 @@ struct rkvdec_link_dev {
 	u32 task_cnt;
 	u64 stuff_cycle_sum;
 	u32 stuff_cnt;
+
+	/* max tasks filled in ring per hardware config, 0 for no limit */
+	u32 batch_max;
+	/* batch statistic */
+	u32 batch_cnt;
+	u32 batch_task_cnt;
 };
 
 enum RKVDEC2_CCU_MODE {
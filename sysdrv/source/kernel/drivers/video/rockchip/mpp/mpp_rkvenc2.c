@@ -30,6 +30,7 @@
 #include <linux/dma-iommu.h>
 #include <soc/rockchip/pm_domains.h>
 #include <soc/rockchip/rockchip_ipa.h>
+#include <soc/rockchip/rockchip_ipa_cooling.h>
 #include <soc/rockchip/rockchip_opp_select.h>
 #include <soc/rockchip/rockchip_system_monitor.h>
 
@@ -187,6 +188,15 @@ union rkvenc2_slice_len_info {
 	};
 };
 
+/*
+ * poll_type of rkvenc_poll_slice_cfg
+ * WAIT_MAX: return after count_max slices or the last slice
+ * ANY: return once at least one slice is ready, with all slices ready so far,
+ *	so that userspace can send out slices while encoding the rest of frame
+ */
+#define RKVENC_POLL_SLICE_WAIT_MAX	(0)
+#define RKVENC_POLL_SLICE_ANY		(1)
+
 struct rkvenc_poll_slice_cfg {
 	s32 poll_type;
 	s32 poll_ret;
@@ -210,6 +220,8 @@ struct rkvenc_task {
 	struct reg_offset_info off_inf;
 
 	enum MPP_CLOCK_MODE clk_mode;
+	/* workload in pixels at 30 fps for clock predict */
+	u32 load;
 	u32 irq_status;
 	/* req for current task */
 	u32 w_req_cnt;
@@ -256,6 +268,9 @@ struct rkvenc2_session_priv {
 	} codec_info[ENC_INFO_BUTT];
 	/* rcb_info for sram */
 	struct rkvenc2_rcb_info rcb_inf;
+	/* rcb size of last task placed in shared sram pool and left in ddr */
+	u32 rcb_sram_size;
+	u32 rcb_ddr_size;
 };
 
 struct rkvenc_dev {
@@ -286,6 +301,7 @@ struct rkvenc_dev {
 #ifdef CONFIG_PM_DEVFREQ
 	struct rockchip_opp_info opp_info;
 	struct monitor_dev_info *mdev_info;
+	struct thermal_cooling_device *cdev;
 #endif
 };
 
@@ -805,16 +821,24 @@ static int rkvenc2_set_rcbbuf(struct mpp_dev *mpp, struct mpp_session *session,
 		int i;
 		u32 *reg;
 		u32 reg_idx, rcb_size, rcb_offset;
+		u32 ddr_size = 0;
 		struct rkvenc2_rcb_info *rcb_inf = &priv->rcb_inf;
 
+		/*
+		 * The sram pool is shared by all sessions on this core and
+		 * re-arbitrated per task, since tasks run one by one. The rcb
+		 * not fit in pool keeps the ddr buffer set by userspace.
+		 */
 		rcb_offset = 0;
 		for (i = 0; i < rcb_inf->cnt; i++) {
 			reg_idx = rcb_inf->elem[i].index;
 			rcb_size = rcb_inf->elem[i].size;
 
 			if (rcb_offset > enc->sram_size ||
-			    (rcb_offset + rcb_size) > enc->sram_used)
+			    (rcb_offset + rcb_size) > enc->sram_used) {
+				ddr_size += rcb_size;
 				continue;
+			}
 
 			mpp_debug(DEBUG_SRAM_INFO, "rcb: reg %d offset %d, size %d\n",
 				  reg_idx, rcb_offset, rcb_size);
@@ -826,6 +850,8 @@ static int rkvenc2_set_rcbbuf(struct mpp_dev *mpp, struct mpp_session *session,
 			rcb_offset += rcb_size;
 			sram_enabled = 1;
 		}
+		priv->rcb_sram_size = rcb_offset;
+		priv->rcb_ddr_size = ddr_size;
 	}
 	if (enc->sram_enabled != sram_enabled) {
 		mpp_debug(DEBUG_SRAM_INFO, "sram %s\n", sram_enabled ? "enabled" : "disabled");
@@ -858,6 +884,28 @@ static void rkvenc2_setup_task_id(u32 session_id, struct rkvenc_task *task)
 	task->dchs_id.rxe_map = task->dchs_id.rxe;
 }
 
+/* session workload from codec info, pixels of one frame scaled to 30 fps */
+static u32 rkvenc2_session_load(struct mpp_session *session)
+{
+	struct rkvenc2_session_priv *priv = session->priv;
+	u64 load;
+	u32 fps;
+
+	if (!priv)
+		return 0;
+
+	down_read(&priv->rw_sem);
+	load = (u64)priv->codec_info[ENC_INFO_WIDTH].val *
+	       priv->codec_info[ENC_INFO_HEIGHT].val;
+	fps = priv->codec_info[ENC_INFO_FPS_IN].val;
+	up_read(&priv->rw_sem);
+
+	if (fps)
+		load = div_u64(load * fps, 30);
+
+	return min_t(u64, load, U32_MAX);
+}
+
 static void rkvenc2_check_split_task(struct rkvenc_task *task)
 {
 	u32 slen_fifo_en = 0;
@@ -965,6 +1013,7 @@ static void *rkvenc_alloc_task(struct mpp_session *session,
 	}
 	rkvenc2_setup_task_id(session->index, task);
 	task->clk_mode = CLK_MODE_NORMAL;
+	task->load = rkvenc2_session_load(session);
 	rkvenc2_check_split_task(task);
 
 	mpp_debug_leave();
@@ -1553,6 +1602,8 @@ static int rkvenc_dump_session(struct mpp_session *session, struct seq_file *seq
 {
 	int i;
 	struct rkvenc2_session_priv *priv = session->priv;
+	unsigned long buf_size;
+	u32 buf_cnt = 0;
 
 	down_read(&priv->rw_sem);
 	/* item name */
@@ -1588,6 +1639,11 @@ static int rkvenc_dump_session(struct mpp_session *session, struct seq_file *seq
 		}
 	}
 	seq_puts(seq, "\n");
+	/* memory accounting */
+	buf_size = mpp_dma_session_size(session->dma, &buf_cnt);
+	seq_printf(seq, "|%8s| buffers %u size %lu KB, rcb sram %u KB ddr %u KB\n",
+		   (const char *)"memory", buf_cnt, buf_size >> 10,
+		   priv->rcb_sram_size >> 10, priv->rcb_ddr_size >> 10);
 	up_read(&priv->rw_sem);
 
 	return 0;
@@ -1758,6 +1814,13 @@ static int rkvenc_devfreq_init(struct mpp_dev *mpp)
 		enc->mdev_info = NULL;
 	}
 
+	/* Let the power allocator cap the core clock along the OPP table */
+	enc->cdev = rockchip_ipa_cooling_register(dev, clk_core, "venc_leakage");
+	if (IS_ERR(enc->cdev)) {
+		dev_dbg(dev, "without cooling device\n");
+		enc->cdev = NULL;
+	}
+
 	return ret;
 }
 
@@ -1765,6 +1828,7 @@ static int rkvenc_devfreq_remove(struct mpp_dev *mpp)
 {
 	struct rkvenc_dev *enc = to_rkvenc_dev(mpp);
 
+	rockchip_ipa_cooling_unregister(enc->cdev);
 	if (enc->mdev_info)
 		rockchip_system_monitor_unregister(enc->mdev_info);
 
@@ -1905,6 +1969,46 @@ static int rkvenc_clk_off(struct mpp_dev *mpp)
 	return 0;
 }
 
+/*
+ * Predict clock from tasks queued but not run yet, so the clock is raised
+ * before a burst of frames lands on hardware instead of after, and falls
+ * back to normal once the queue drains.
+ */
+static int rkvenc2_get_freq(struct mpp_dev *mpp, struct mpp_task *mpp_task)
+{
+	struct rkvenc_dev *enc = to_rkvenc_dev(mpp);
+	struct rkvenc_task *task = to_rkvenc_task(mpp_task);
+	struct mpp_taskqueue *queue = mpp->queue;
+	struct mpp_task *loop = NULL;
+	u32 task_cnt = 1;
+	u64 workload;
+
+	/* if not set max load, consider not have advanced mode */
+	if (!enc->default_max_load)
+		return 0;
+
+	workload = task->load;
+	/* calc workload in pending list */
+	mutex_lock(&queue->pending_lock);
+	list_for_each_entry(loop, &queue->pending_list, queue_link) {
+		workload += to_rkvenc_task(loop)->load;
+		task_cnt++;
+	}
+	mutex_unlock(&queue->pending_lock);
+
+	/* multi-core share the queue */
+	if (queue->core_count > 1)
+		workload = div_u64(workload, queue->core_count);
+
+	task->clk_mode = (workload > enc->default_max_load) ?
+			 CLK_MODE_ADVANCED : CLK_MODE_NORMAL;
+
+	mpp_debug(DEBUG_TASK_INFO, "pending task %d, workload %llu, clk_mode=%d\n",
+		  task_cnt, workload, task->clk_mode);
+
+	return 0;
+}
+
 static int rkvenc_set_freq(struct mpp_dev *mpp, struct mpp_task *mpp_task)
 {
 	struct rkvenc_dev *enc = to_rkvenc_dev(mpp);
@@ -2008,8 +2112,13 @@ task_done_ret:
 					 test_bit(TASK_STATE_DONE, &task->state),
 					 msecs_to_jiffies(RKVENC2_WAIT_TIMEOUT_DELAY));
 
-		if (ret > 0)
-			return rkvenc2_task_default_process(mpp, task);
+		if (ret > 0) {
+			/* pop the task even if the timing copy failed */
+			int err = mpp_task_export_timing(task, msgs);
+
+			ret = rkvenc2_task_default_process(mpp, task);
+			return ret ? ret : err;
+		}
 
 		rkvenc2_task_timeout_process(session, task);
 		return ret;
@@ -2044,8 +2153,8 @@ task_done_ret:
 		return -EINVAL;
 	}
 
-	mpp_dbg_slice("task %d poll irq %d:%d\n", task->task_id,
-		      cfg.count_max, cfg.count_ret);
+	mpp_dbg_slice("task %d poll irq type %d %d:%d\n", task->task_id,
+		      cfg.poll_type, cfg.count_max, cfg.count_ret);
 	cfg.count_ret = 0;
 
 	/* handle slice mode poll return */
@@ -2082,6 +2191,11 @@ task_done_ret:
 
 			if (ret < 0)
 				return ret;
+
+			/* return slices ready so far, do not wait for next one */
+			if (cfg.poll_type == RKVENC_POLL_SLICE_ANY &&
+			    kfifo_is_empty(&enc_task->slice_info))
+				return 0;
 		}
 	} while (ret > 0);
 
@@ -2095,6 +2209,7 @@ static struct mpp_hw_ops rkvenc_hw_ops = {
 	.exit = rkvenc_exit,
 	.clk_on = rkvenc_clk_on,
 	.clk_off = rkvenc_clk_off,
+	.get_freq = rkvenc2_get_freq,
 	.set_freq = rkvenc_set_freq,
 	.reset = rkvenc_reset,
 };
@@ -12,6 +12,7 @@
 
 #include <linux/completion.h>
 #include <linux/delay.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/of_platform.h>
 #include <linux/proc_fs.h>
@@ -190,6 +191,7 @@ static int mpp_dump_session(struct mpp_session *session, struct seq_file *s)
 	struct mpp_dma_buffer *buffer;
 	phys_addr_t end;
 	unsigned long z = 0, t = 0;
+	u64 total;
 	int i = 0;
 #define K(size) ((unsigned long)((size) >> 10))
 
@@ -228,6 +230,15 @@ static int mpp_dump_session(struct mpp_session *session, struct seq_file *s)
 	seq_printf(s, "session: pid=%d index=%d\n", session->pid, session->index);
 	seq_printf(s, " device: %s\n", dev_name(session->mpp->dev));
 	seq_printf(s, " memory: %lu MiB\n", K(K(t)));
+	total = (u64)dma->hit_cnt + dma->miss_cnt;
+	seq_printf(s, " dma map: hit=%u miss=%u evict=%u rate=%llu%%\n",
+		   dma->hit_cnt, dma->miss_cnt, dma->evict_cnt,
+		   total ? div64_u64((u64)dma->hit_cnt * 100, total) : 0);
+	seq_printf(s, " sched: prio=%u deadline=%uus wait avg=%lluus max=%uus cnt=%u miss=%u starve=%u\n",
+		   session->sched_prio, session->sched_deadline_us,
+		   session->sched_cnt ? div_u64(session->sched_wait_us, session->sched_cnt) : 0,
+		   session->sched_wait_max_us, session->sched_cnt, session->sched_miss,
+		   session->sched_starve);
 
 	return 0;
 }
@@ -275,15 +286,20 @@ static int mpp_show_support_cmd(struct seq_file *file, void *v)
 	seq_printf(file, "SET_REG_WRITE:        0x%08x\n", MPP_CMD_SET_REG_WRITE);
 	seq_printf(file, "SET_REG_READ:         0x%08x\n", MPP_CMD_SET_REG_READ);
 	seq_printf(file, "SET_REG_ADDR_OFFSET:  0x%08x\n", MPP_CMD_SET_REG_ADDR_OFFSET);
+	seq_printf(file, "SET_IN_FENCE:         0x%08x\n", MPP_CMD_SET_IN_FENCE);
+	seq_printf(file, "SET_OUT_FENCE:        0x%08x\n", MPP_CMD_SET_OUT_FENCE);
 	seq_printf(file, "SEND_BUTT:            0x%08x\n", MPP_CMD_SEND_BUTT);
 	seq_puts(file, "----\n");
 	seq_printf(file, "POLL_HW_FINISH:       0x%08x\n", MPP_CMD_POLL_HW_FINISH);
+	seq_printf(file, "POLL_TASK_TIMING:     0x%08x\n", MPP_CMD_POLL_TASK_TIMING);
 	seq_printf(file, "POLL_BUTT:            0x%08x\n", MPP_CMD_POLL_BUTT);
 	seq_puts(file, "----\n");
 	seq_printf(file, "RESET_SESSION:        0x%08x\n", MPP_CMD_RESET_SESSION);
 	seq_printf(file, "TRANS_FD_TO_IOVA:     0x%08x\n", MPP_CMD_TRANS_FD_TO_IOVA);
 	seq_printf(file, "RELEASE_FD:           0x%08x\n", MPP_CMD_RELEASE_FD);
 	seq_printf(file, "SEND_CODEC_INFO:      0x%08x\n", MPP_CMD_SEND_CODEC_INFO);
+	seq_printf(file, "SET_SESSION_SCHED:    0x%08x\n", MPP_CMD_SET_SESSION_SCHED);
+	seq_printf(file, "SET_BATCH_EVENTFD:    0x%08x\n", MPP_CMD_SET_BATCH_EVENTFD);
 	seq_printf(file, "CONTROL_BUTT:         0x%08x\n", MPP_CMD_CONTROL_BUTT);
 
 	return 0;
@@ -936,7 +936,13 @@ struct rga_user_request {
 
 	uint32_t acquire_fence_fd;
 
-	uint8_t reservr[120];
+	/*
+	 * Optional user array of task_num int32_t, filled with the result of
+	 * each task when a sync request returns.
+	 */
+	uint64_t task_ret_ptr;
+
+	uint8_t reservr[112];
 };
 
 int rga_mpi_commit(struct rga_mpi_job_t *mpi_job);
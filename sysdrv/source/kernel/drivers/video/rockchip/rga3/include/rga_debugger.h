@@ -25,6 +25,34 @@ extern int RGA_DEBUG_DUMP_IMAGE;
 
 #define DEBUGGER_EN(name) (unlikely(RGA_DEBUG_##name ? true : false))
 
+/* must be power of 2 */
+#define RGA_TELEMETRY_RING_SIZE 256
+
+/*
+ * struct rga_job_telemetry - statistics of one finished job
+ */
+struct rga_job_telemetry {
+	/* time of job done, in us */
+	u64 done_us;
+	pid_t tgid;
+	int session_id;
+	int request_id;
+	int core;
+	/* from job commit to hardware start */
+	u32 queue_us;
+	u32 hw_us;
+	u32 pixels;
+	u32 read_bytes;
+	u32 write_bytes;
+};
+
+struct rga_telemetry {
+	spinlock_t lock;
+	/* jobs recorded, the latest is in ring[(count - 1) % SIZE] */
+	u64 count;
+	struct rga_job_telemetry ring[RGA_TELEMETRY_RING_SIZE];
+};
+
 /*
  * struct rga_debugger - RGA debugger information
  *
@@ -45,6 +73,8 @@ struct rga_debugger {
 	struct list_head procfs_entry_list;
 	struct mutex procfs_lock;
 #endif
+
+	struct rga_telemetry telemetry;
 };
 
 /*
@@ -125,10 +155,16 @@ static inline int rga_procfs_init(void)
 }
 #endif /* #ifdef CONFIG_ROCKCHIP_RGA_PROC_FS */
 
+void rga_telemetry_record(struct rga_job *job, ktime_t now);
+
 #else
 
 #define DEBUGGER_EN(name) (unlikely(false))
 
+static inline void rga_telemetry_record(struct rga_job *job, ktime_t now)
+{
+}
+
 #endif /* #ifdef CONFIG_ROCKCHIP_RGA_DEBUGGER */
 
 void rga_cmd_print_debug_info(struct rga_req *req);
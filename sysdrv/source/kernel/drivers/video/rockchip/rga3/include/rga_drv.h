@@ -33,6 +33,7 @@
 #include <linux/regulator/consumer.h>
 #include <linux/scatterlist.h>
 #include <linux/sched.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/syscalls.h>
@@ -41,6 +42,7 @@
 #include <linux/uaccess.h>
 #include <linux/version.h>
 #include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <linux/pm_runtime.h>
 #include <linux/sched/mm.h>
 #include <linux/string_helpers.h>
@@ -59,6 +61,8 @@
 
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0))
 #include <linux/dma-map-ops.h>
+#include <linux/mmu_notifier.h>
+#define RGA_MM_CACHE_VIRT_ADDR
 #endif
 
 #include <linux/hrtimer.h>
@@ -227,6 +231,20 @@ struct rga_internal_buffer {
 
 	struct kref refcount;
 	struct rga_session *session;
+
+	/* node in rga_session.mm_cache, for buffers reused across jobs */
+	struct list_head cache_node;
+#ifdef RGA_MM_CACHE_VIRT_ADDR
+	/* invalidates a cached virtual address when the range is changed */
+	struct mmu_interval_notifier notifier;
+#endif
+	/* jiffies of the last job that used the cached mapping */
+	unsigned long cache_used;
+	/* cached virtual address pages are pinned for write */
+	bool cache_write;
+	bool cache_stale;
+	/* current_mm is only grabbed, mm_users is not held */
+	bool cache_mm_weak;
 };
 
 struct rga_scheduler_t;
@@ -237,6 +255,24 @@ struct rga_session {
 	pid_t tgid;
 
 	char *pname;
+
+	/* LRU (most recent first) of buffer mappings kept across jobs */
+	struct list_head mm_cache;
+	spinlock_t mm_cache_lock;
+	int mm_cache_count;
+	/* bytes pinned by the cached mappings */
+	u64 mm_cache_size;
+	/* drops the mappings left unused for RGA_MM_CACHE_IDLE_MS */
+	struct delayed_work mm_cache_work;
+	u32 mm_cache_hit;
+	u32 mm_cache_miss;
+
+	/* rollup of the job telemetry, updated at job done */
+	u32 stat_job_count;
+	u64 stat_hw_us;
+	u64 stat_pixels;
+	u64 stat_read_bytes;
+	u64 stat_write_bytes;
 };
 
 struct rga_job_buffer {
@@ -297,6 +333,10 @@ struct rga_job {
 	int ret;
 	pid_t pid;
 	bool use_batch_mode;
+	/* pixels read and written by this job, used to balance the cores */
+	u32 workload;
+	/* index in rga_request.task_list, -1 if not from the task list */
+	int task_index;
 
 	struct kref refcount;
 	unsigned long state;
@@ -338,6 +378,8 @@ struct rga_scheduler_t {
 	const struct rga_backend_ops *ops;
 	const struct rga_hw_data *data;
 	int job_count;
+	/* sum of the workload of the jobs in todo_list */
+	u64 job_load;
 	int irq;
 	struct rga_version_t version;
 	int core;
@@ -350,6 +392,9 @@ struct rga_request {
 	int task_count;
 	uint32_t finished_task_count;
 	uint32_t failed_task_count;
+	/* result of each task, -ECANCELED until the task is done */
+	int32_t task_ret[RGA_TASK_NUM_MAX];
+	uint64_t task_ret_ptr;
 
 	bool use_batch_mode;
 	bool is_running;
@@ -60,6 +60,8 @@ int rga_mm_import_buffer(struct rga_external_buffer *external_buffer,
 			 struct rga_session *session);
 int rga_mm_release_buffer(uint32_t handle);
 int rga_mm_session_release_buffer(struct rga_session *session);
+void rga_mm_session_init_cache(struct rga_session *session);
+void rga_mm_session_release_cache(struct rga_session *session);
 
 int rga_mm_init(struct rga_mm **session);
 int rga_mm_remove(struct rga_mm **session);
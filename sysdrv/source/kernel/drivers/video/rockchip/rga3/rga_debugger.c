@@ -206,9 +206,13 @@ static int rga_load_show(struct seq_file *m, void *data)
 
 	mutex_lock(&session_manager->lock);
 
-	idr_for_each_entry(&session_manager->ctx_id_idr, session, id)
+	idr_for_each_entry(&session_manager->ctx_id_idr, session, id) {
 		seq_printf(m, "\t process %d: pid = %d, name: %s\n", id,
 			session->tgid, session->pname);
+		seq_printf(m, "\t\t mm cache: count = %d, size = %llu KiB, hit = %u, miss = %u\n",
+			session->mm_cache_count, session->mm_cache_size >> 10,
+			session->mm_cache_hit, session->mm_cache_miss);
+	}
 
 	mutex_unlock(&session_manager->lock);
 
@@ -462,6 +466,121 @@ static int rga_hardware_show(struct seq_file *m, void *data)
 	return 0;
 }
 
+static u32 rga_telemetry_channel_bytes(struct rga_img_info_t *img)
+{
+	int bits = rga_get_format_bits(img->format);
+
+	if (bits <= 0)
+		return 0;
+
+	return (u32)img->act_w * img->act_h * bits / 8;
+}
+
+void rga_telemetry_record(struct rga_job *job, ktime_t now)
+{
+	struct rga_telemetry *telemetry;
+	struct rga_job_telemetry *entry;
+	struct rga_req *req = &job->rga_command_base;
+	struct rga_session *session = job->session;
+	u32 read_bytes, write_bytes, hw_us = 0, queue_us = 0;
+	unsigned long flags;
+
+	if (rga_drvdata->debugger == NULL)
+		return;
+
+	telemetry = &rga_drvdata->debugger->telemetry;
+
+	read_bytes = rga_telemetry_channel_bytes(&req->src);
+	if (job->src1_buffer.addr)
+		read_bytes += rga_telemetry_channel_bytes(&req->pat);
+	write_bytes = rga_telemetry_channel_bytes(&req->dst);
+
+	if (job->hw_running_time) {
+		queue_us = ktime_us_delta(job->hw_running_time, job->timestamp);
+		hw_us = ktime_us_delta(now, job->hw_running_time);
+	}
+
+	spin_lock_irqsave(&telemetry->lock, flags);
+
+	entry = &telemetry->ring[telemetry->count & (RGA_TELEMETRY_RING_SIZE - 1)];
+	entry->done_us = ktime_to_us(now);
+	entry->tgid = session ? session->tgid : job->pid;
+	entry->session_id = session ? session->id : 0;
+	entry->request_id = job->request_id;
+	entry->core = job->core;
+	entry->queue_us = queue_us;
+	entry->hw_us = hw_us;
+	entry->pixels = job->workload;
+	entry->read_bytes = read_bytes;
+	entry->write_bytes = write_bytes;
+	telemetry->count++;
+
+	if (session) {
+		session->stat_job_count++;
+		session->stat_hw_us += hw_us;
+		session->stat_pixels += job->workload;
+		session->stat_read_bytes += read_bytes;
+		session->stat_write_bytes += write_bytes;
+	}
+
+	spin_unlock_irqrestore(&telemetry->lock, flags);
+}
+
+static int rga_telemetry_show(struct seq_file *m, void *data)
+{
+	struct rga_telemetry *telemetry = &rga_drvdata->debugger->telemetry;
+	struct rga_session_manager *session_manager = rga_drvdata->session_manager;
+	struct rga_job_telemetry *ring, *entry;
+	struct rga_session *session;
+	unsigned long flags;
+	u64 count, i;
+	int id;
+
+	ring = kmalloc_array(RGA_TELEMETRY_RING_SIZE, sizeof(*ring), GFP_KERNEL);
+	if (ring == NULL)
+		return -ENOMEM;
+
+	/* Snapshot the ring to keep the irq lock short. */
+	spin_lock_irqsave(&telemetry->lock, flags);
+	memcpy(ring, telemetry->ring, sizeof(telemetry->ring));
+	count = telemetry->count;
+	spin_unlock_irqrestore(&telemetry->lock, flags);
+
+	seq_printf(m, "total jobs = %llu\n", count);
+	seq_puts(m, "done_us tgid session request core queue_us hw_us pixels read_bytes write_bytes\n");
+
+	i = count > RGA_TELEMETRY_RING_SIZE ? count - RGA_TELEMETRY_RING_SIZE : 0;
+	for (; i < count; i++) {
+		entry = &ring[i & (RGA_TELEMETRY_RING_SIZE - 1)];
+		seq_printf(m, "%llu %d %d %d 0x%x %u %u %u %u %u\n",
+			   entry->done_us, entry->tgid, entry->session_id,
+			   entry->request_id, entry->core, entry->queue_us,
+			   entry->hw_us, entry->pixels, entry->read_bytes,
+			   entry->write_bytes);
+	}
+
+	kfree(ring);
+
+	seq_puts(m, "===================================\n");
+
+	mutex_lock(&session_manager->lock);
+
+	idr_for_each_entry(&session_manager->ctx_id_idr, session, id) {
+		spin_lock_irqsave(&telemetry->lock, flags);
+		seq_printf(m, "session %d: pid = %d, name: %s\n",
+			   id, session->tgid, session->pname);
+		seq_printf(m, "\t jobs = %u, hw_us = %llu, pixels = %llu, read_bytes = %llu, write_bytes = %llu\n",
+			   session->stat_job_count, session->stat_hw_us,
+			   session->stat_pixels, session->stat_read_bytes,
+			   session->stat_write_bytes);
+		spin_unlock_irqrestore(&telemetry->lock, flags);
+	}
+
+	mutex_unlock(&session_manager->lock);
+
+	return 0;
+}
+
 static struct rga_debugger_list rga_debugger_root_list[] = {
 	{"debug", rga_debug_show, rga_debug_write, NULL},
 	{"driver_version", rga_version_show, NULL, NULL},
@@ -469,6 +588,7 @@ static struct rga_debugger_list rga_debugger_root_list[] = {
 	{"scheduler_status", rga_scheduler_show, NULL, NULL},
 	{"mm_session", rga_mm_session_show, NULL, NULL},
 	{"request_manager", rga_request_manager_show, NULL, NULL},
+	{"telemetry", rga_telemetry_show, NULL, NULL},
 #ifdef CONFIG_NO_GKI
 	{"dump_path", rga_dump_path_show, rga_dump_path_write, NULL},
 	{"dump_image", rga_dump_image_show, rga_dump_image_write, NULL},
@@ -586,6 +586,8 @@ static struct rga_session *rga_session_init(void)
 	session->tgid = current->tgid;
 	session->pname = kstrdup_quotable_cmdline(current, GFP_KERNEL);
 
+	rga_mm_session_init_cache(session);
+
 	return session;
 }
 
@@ -593,6 +595,7 @@ static int rga_session_deinit(struct rga_session *session)
 {
 	rga_request_session_destroy_abort(session);
 	rga_mm_session_release_buffer(session);
+	rga_mm_session_release_cache(session);
 
 	rga_session_free_remove_idr(session);
 
@@ -788,6 +791,15 @@ static long rga_ioctl_request_submit(unsigned long arg, bool run_enbale)
 
 	if (run_enbale) {
 		ret = rga_request_submit(request);
+
+		/* Report every task, also when the request as a whole failed. */
+		if (request->sync_mode == RGA_BLIT_SYNC && request->task_ret_ptr) {
+			if (copy_to_user(u64_to_user_ptr(request->task_ret_ptr),
+					 request->task_ret,
+					 sizeof(int32_t) * request->task_count))
+				pr_err("request[%d] copy task result failed\n", user_request.id);
+		}
+
 		if (ret < 0) {
 			pr_err("request[%d] submit failed!\n", user_request.id);
 			return -EFAULT;
@@ -1095,6 +1107,8 @@ static int rga_debugger_init(struct rga_debugger **debugger_p)
 	INIT_LIST_HEAD(&debugger->procfs_entry_list);
 #endif
 
+	spin_lock_init(&debugger->telemetry.lock);
+
 	rga_debugfs_init();
 	rga_procfs_init();
 
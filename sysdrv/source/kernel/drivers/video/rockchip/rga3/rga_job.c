@@ -157,9 +157,10 @@ void rga_job_scheduler_dump_info(struct rga_scheduler_t *scheduler)
 	lockdep_assert_held(&scheduler->irq_lock);
 
 	pr_info("===============================================================\n");
-	pr_info("%s core = %d job_count = %d status = %d\n",
+	pr_info("%s core = %d job_count = %d job_load = %llu status = %d\n",
 		dev_driver_string(scheduler->dev),
-		scheduler->core, scheduler->job_count, scheduler->status);
+		scheduler->core, scheduler->job_count, scheduler->job_load,
+		scheduler->status);
 
 	if (scheduler->running_job)
 		rga_job_dump_info(scheduler->running_job);
@@ -218,6 +219,7 @@ next_job:
 	list_del_init(&job->head);
 
 	scheduler->job_count--;
+	scheduler->job_load -= job->workload;
 
 	scheduler->running_job = job;
 	set_bit(RGA_JOB_STATE_PREPARE, &job->state);
@@ -280,6 +282,8 @@ struct rga_job *rga_job_done(struct rga_scheduler_t *scheduler)
 			rga_get_core_name(scheduler->core),
 			ktime_us_delta(now, job->hw_running_time));
 
+	rga_telemetry_record(job, now);
+
 	rga_mm_unmap_job_info(job);
 
 	return job;
@@ -350,6 +354,7 @@ static void rga_job_insert_todo_list(struct rga_job *job)
 	}
 
 	scheduler->job_count++;
+	scheduler->job_load += job->workload;
 	set_bit(RGA_JOB_STATE_PENDING, &job->state);
 
 	spin_unlock_irqrestore(&scheduler->irq_lock, flags);
@@ -404,6 +409,13 @@ struct rga_job *rga_job_commit(struct rga_req *rga_command_base, struct rga_requ
 	job->session = request->session;
 	job->mm = request->current_mm;
 
+	if (request->task_list &&
+	    rga_command_base >= request->task_list &&
+	    rga_command_base < request->task_list + request->task_count)
+		job->task_index = rga_command_base - request->task_list;
+	else
+		job->task_index = -1;
+
 	scheduler = rga_job_schedule(job);
 	if (scheduler == NULL) {
 		pr_err("failed to get scheduler, %s(%d)\n", __func__, __LINE__);
@@ -639,6 +651,7 @@ static int rga_request_scheduler_job_abort(struct rga_request *request)
 			if (request->id == job->request_id) {
 				list_move(&job->head, &list_to_free);
 				scheduler->job_count--;
+				scheduler->job_load -= job->workload;
 
 				todo_abort_count++;
 			}
@@ -923,6 +936,9 @@ int rga_request_release_signal(struct rga_scheduler_t *scheduler, struct rga_job
 		request->finished_task_count++;
 	}
 
+	if (job->task_index >= 0)
+		request->task_ret[job->task_index] = job->ret;
+
 	failed_count = request->failed_task_count;
 	finished_count = request->finished_task_count;
 
@@ -1021,6 +1037,7 @@ struct rga_request *rga_request_config(struct rga_user_request *user_request)
 	request->sync_mode = user_request->sync_mode;
 	request->mpi_config_flags = user_request->mpi_config_flags;
 	request->acquire_fence_fd = user_request->acquire_fence_fd;
+	request->task_ret_ptr = user_request->task_ret_ptr;
 	request->feature = task_list[0].feature;
 
 	spin_unlock_irqrestore(&request->lock, flags);
@@ -1081,6 +1098,7 @@ struct rga_request *rga_request_kernel_config(struct rga_user_request *user_requ
 	request->sync_mode = user_request->sync_mode;
 	request->mpi_config_flags = user_request->mpi_config_flags;
 	request->acquire_fence_fd = user_request->acquire_fence_fd;
+	request->task_ret_ptr = user_request->task_ret_ptr;
 
 	spin_unlock_irqrestore(&request->lock, flags);
 
@@ -1097,6 +1115,7 @@ err_put_request:
 int rga_request_submit(struct rga_request *request)
 {
 	int ret = 0;
+	int i;
 	unsigned long flags;
 	struct dma_fence *release_fence;
 	struct mm_struct *current_mm;
@@ -1126,6 +1145,8 @@ int rga_request_submit(struct rga_request *request)
 	request->is_done = false;
 	request->finished_task_count = 0;
 	request->failed_task_count = 0;
+	for (i = 0; i < request->task_count; i++)
+		request->task_ret[i] = -ECANCELED;
 	request->current_mm = current_mm;
 
 	/* Unlock after ensuring that the current request will not be resubmitted. */
@@ -1202,6 +1223,7 @@ err_put_current_mm:
 int rga_request_mpi_submit(struct rga_req *req, struct rga_request *request)
 {
 	int ret = 0;
+	int i;
 	struct rga_job *job = NULL;
 	unsigned long flags;
 
@@ -1229,6 +1251,8 @@ int rga_request_mpi_submit(struct rga_req *req, struct rga_request *request)
 	request->is_done = false;
 	request->finished_task_count = 0;
 	request->failed_task_count = 0;
+	for (i = 0; i < request->task_count; i++)
+		request->task_ret[i] = -ECANCELED;
 
 	spin_unlock_irqrestore(&request->lock, flags);
 
@@ -16,6 +16,13 @@
 #include "rga_hw_config.h"
 #include "rga_debugger.h"
 
+/* Max buffer mappings kept per session for fd and virtual address jobs. */
+#define RGA_MM_CACHE_MAX_COUNT	16
+/* Max bytes the cached mappings of all sessions of one process may pin. */
+#define RGA_MM_CACHE_MAX_SIZE	SZ_128M
+/* Cached mappings unused for this long are released. */
+#define RGA_MM_CACHE_IDLE_MS	3000
+
 static void rga_current_mm_read_lock(struct mm_struct *mm)
 {
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
@@ -353,6 +360,15 @@ static inline bool rga_mm_check_contiguous_sgt(struct sg_table *sgt)
 	return false;
 }
 
+/*
+ * dma-buf api needs to use default_domain of main dev,
+ * and not IOMMU for devices without iommu_info ptr.
+ */
+static inline struct device *rga_mm_get_map_dev(struct rga_scheduler_t *scheduler)
+{
+	return scheduler->iommu_info ? scheduler->iommu_info->default_dev : scheduler->dev;
+}
+
 static void rga_mm_unmap_dma_buffer(struct rga_internal_buffer *internal_buffer)
 {
 	if (rga_mm_is_invalid_dma_buffer(internal_buffer->dma_buffer))
@@ -400,11 +416,7 @@ static int rga_mm_map_dma_buffer(struct rga_external_buffer *external_buffer,
 		return ex_buffer_size == 0 ? -EINVAL : ex_buffer_size;
 	}
 
-	/*
-	 * dma-buf api needs to use default_domain of main dev,
-	 * and not IOMMU for devices without iommu_info ptr.
-	 */
-	map_dev = scheduler->iommu_info ? scheduler->iommu_info->default_dev : scheduler->dev;
+	map_dev = rga_mm_get_map_dev(scheduler);
 
 	buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
 	if (buffer == NULL) {
@@ -516,7 +528,8 @@ static void rga_mm_unmap_virt_addr(struct rga_internal_buffer *internal_buffer)
 
 	rga_free_virt_addr(&internal_buffer->virt_addr);
 
-	mmput(internal_buffer->current_mm);
+	if (!internal_buffer->cache_mm_weak)
+		mmput(internal_buffer->current_mm);
 	mmdrop(internal_buffer->current_mm);
 	internal_buffer->current_mm = NULL;
 }
@@ -1843,6 +1856,327 @@ error_put_buffer:
 	return ret;
 }
 
+static void rga_mm_kref_release_cache_buffer(struct kref *ref)
+{
+	struct rga_internal_buffer *internal_buffer;
+
+	internal_buffer = container_of(ref, struct rga_internal_buffer, refcount);
+#ifdef RGA_MM_CACHE_VIRT_ADDR
+	if (internal_buffer->type == RGA_VIRTUAL_ADDRESS)
+		mmu_interval_notifier_remove(&internal_buffer->notifier);
+#endif
+	rga_mm_unmap_buffer(internal_buffer);
+	kfree(internal_buffer);
+}
+
+#ifdef RGA_MM_CACHE_VIRT_ADDR
+static bool rga_mm_cache_invalidate(struct mmu_interval_notifier *mni,
+				    const struct mmu_notifier_range *range,
+				    unsigned long cur_seq)
+{
+	struct rga_internal_buffer *buffer;
+
+	buffer = container_of(mni, struct rga_internal_buffer, notifier);
+	mmu_interval_set_seq(mni, cur_seq);
+
+	/*
+	 * The pages stay pinned until the buffer is released, just stop
+	 * reusing them. The stale entry is dropped on the next lookup.
+	 */
+	WRITE_ONCE(buffer->cache_stale, true);
+
+	return true;
+}
+
+static const struct mmu_interval_notifier_ops rga_mm_cache_notifier_ops = {
+	.invalidate = rga_mm_cache_invalidate,
+};
+#endif
+
+/*
+ * Buffers mapped for a single job have no session, the ones kept in the
+ * session cache are shared and refcounted.
+ */
+static void rga_mm_put_channel_buffer(struct rga_internal_buffer *buffer)
+{
+	if (buffer->session) {
+		kref_put(&buffer->refcount, rga_mm_kref_release_cache_buffer);
+	} else {
+		rga_mm_unmap_buffer(buffer);
+		kfree(buffer);
+	}
+}
+
+static bool rga_mm_cache_is_supported(struct rga_job *job,
+				      struct rga_external_buffer *external_buffer)
+{
+	if (job->session == NULL)
+		return false;
+
+	switch (external_buffer->type) {
+	case RGA_DMA_BUFFER_PTR:
+		return true;
+#ifdef RGA_MM_CACHE_VIRT_ADDR
+	case RGA_VIRTUAL_ADDRESS:
+		return job->mm != NULL;
+#endif
+	default:
+		return false;
+	}
+}
+
+static unsigned long rga_mm_cache_buffer_size(struct rga_internal_buffer *buffer)
+{
+	if (buffer->type == RGA_VIRTUAL_ADDRESS)
+		return buffer->virt_addr->size;
+
+	return buffer->dma_buffer->size;
+}
+
+/* Called with mm_cache_lock held, the buffer is put by rga_mm_cache_free(). */
+static void rga_mm_cache_del(struct rga_session *session,
+			     struct rga_internal_buffer *buffer,
+			     struct list_head *list_to_free)
+{
+	list_move(&buffer->cache_node, list_to_free);
+	session->mm_cache_count--;
+	session->mm_cache_size -= rga_mm_cache_buffer_size(buffer);
+}
+
+static void rga_mm_cache_free(struct list_head *list_to_free)
+{
+	struct rga_internal_buffer *buffer, *n;
+
+	list_for_each_entry_safe(buffer, n, list_to_free, cache_node) {
+		list_del_init(&buffer->cache_node);
+		kref_put(&buffer->refcount, rga_mm_kref_release_cache_buffer);
+	}
+}
+
+/* Bytes pinned by the other sessions opened by the same process. */
+static u64 rga_mm_cache_other_size(struct rga_session *session)
+{
+	struct rga_session_manager *session_manager = rga_drvdata->session_manager;
+	struct rga_session *other;
+	u64 size = 0;
+	int id;
+
+	mutex_lock(&session_manager->lock);
+
+	idr_for_each_entry(&session_manager->ctx_id_idr, other, id)
+		if (other != session && other->tgid == session->tgid)
+			size += READ_ONCE(other->mm_cache_size);
+
+	mutex_unlock(&session_manager->lock);
+
+	return size;
+}
+
+static void rga_mm_cache_idle_work(struct work_struct *work)
+{
+	unsigned long flags;
+	unsigned long timeout = msecs_to_jiffies(RGA_MM_CACHE_IDLE_MS);
+	struct rga_session *session;
+	struct rga_internal_buffer *buffer, *n;
+	LIST_HEAD(list_to_free);
+	bool pending;
+
+	session = container_of(to_delayed_work(work), struct rga_session, mm_cache_work);
+
+	spin_lock_irqsave(&session->mm_cache_lock, flags);
+
+	list_for_each_entry_safe(buffer, n, &session->mm_cache, cache_node)
+		if (time_after(jiffies, buffer->cache_used + timeout))
+			rga_mm_cache_del(session, buffer, &list_to_free);
+	pending = !list_empty(&session->mm_cache);
+
+	spin_unlock_irqrestore(&session->mm_cache_lock, flags);
+
+	rga_mm_cache_free(&list_to_free);
+
+	if (pending)
+		schedule_delayed_work(&session->mm_cache_work, timeout);
+}
+
+static bool rga_mm_cache_match(struct rga_job *job,
+			       struct rga_internal_buffer *buffer,
+			       struct rga_external_buffer *external_buffer)
+{
+	if (buffer->type != external_buffer->type)
+		return false;
+
+	if (buffer->type == RGA_VIRTUAL_ADDRESS)
+		return buffer->virt_addr->addr == external_buffer->memory &&
+		       buffer->current_mm == job->mm &&
+		       buffer->dma_buffer->scheduler == job->scheduler;
+
+	return (unsigned long)buffer->dma_buffer->dma_buf == external_buffer->memory &&
+	       rga_mm_get_map_dev(buffer->dma_buffer->scheduler) ==
+	       rga_mm_get_map_dev(job->scheduler);
+}
+
+static struct rga_internal_buffer *
+rga_mm_cache_lookup(struct rga_job *job, struct rga_external_buffer *external_buffer,
+		    int write_flag)
+{
+	int ex_buffer_size;
+	unsigned long flags;
+	struct rga_session *session = job->session;
+	struct rga_internal_buffer *buffer, *n, *output_buffer = NULL;
+	LIST_HEAD(list_to_free);
+
+	if (!rga_mm_cache_is_supported(job, external_buffer))
+		return NULL;
+
+	if (external_buffer->memory_parm.size)
+		ex_buffer_size = external_buffer->memory_parm.size;
+	else
+		ex_buffer_size = rga_image_size_cal(external_buffer->memory_parm.width,
+						    external_buffer->memory_parm.height,
+						    external_buffer->memory_parm.format,
+						    NULL, NULL, NULL);
+	/* Let the map path report the error. */
+	if (ex_buffer_size <= 0)
+		return NULL;
+
+	/* Virtual addresses are pinned by whole pages. */
+	if (external_buffer->type == RGA_VIRTUAL_ADDRESS)
+		ex_buffer_size = RGA_GET_PAGE_COUNT(ex_buffer_size +
+				(external_buffer->memory & (~PAGE_MASK))) * PAGE_SIZE;
+
+	spin_lock_irqsave(&session->mm_cache_lock, flags);
+
+	list_for_each_entry_safe(buffer, n, &session->mm_cache, cache_node) {
+		if (READ_ONCE(buffer->cache_stale)) {
+			rga_mm_cache_del(session, buffer, &list_to_free);
+			continue;
+		}
+
+		if (!rga_mm_cache_match(job, buffer, external_buffer))
+			continue;
+
+		if (rga_mm_cache_buffer_size(buffer) >= ex_buffer_size &&
+		    (!write_flag || buffer->cache_write) &&
+		    rga_mm_check_memory_limit(job->scheduler, buffer->mm_flag)) {
+			kref_get(&buffer->refcount);
+			list_move(&buffer->cache_node, &session->mm_cache);
+			buffer->cache_used = jiffies;
+			output_buffer = buffer;
+		}
+
+		break;
+	}
+
+	if (output_buffer)
+		session->mm_cache_hit++;
+	else
+		session->mm_cache_miss++;
+
+	spin_unlock_irqrestore(&session->mm_cache_lock, flags);
+
+	rga_mm_cache_free(&list_to_free);
+
+	return output_buffer;
+}
+
+static void rga_mm_cache_insert(struct rga_job *job,
+				struct rga_external_buffer *external_buffer,
+				struct rga_internal_buffer *buffer,
+				int write_flag)
+{
+	u64 size_limit;
+	unsigned long flags;
+	struct rga_session *session = job->session;
+	LIST_HEAD(list_to_free);
+
+	if (!rga_mm_cache_is_supported(job, external_buffer))
+		return;
+
+	/* Every session of the process shares one pinned size budget. */
+	size_limit = rga_mm_cache_other_size(session);
+	size_limit = size_limit < RGA_MM_CACHE_MAX_SIZE ?
+		     RGA_MM_CACHE_MAX_SIZE - size_limit : 0;
+	if (rga_mm_cache_buffer_size(buffer) > size_limit)
+		return;
+
+	/* dma-buf is always mapped bidirectional */
+	buffer->cache_write = true;
+
+#ifdef RGA_MM_CACHE_VIRT_ADDR
+	if (buffer->type == RGA_VIRTUAL_ADDRESS) {
+		if (mmu_interval_notifier_insert(&buffer->notifier, buffer->current_mm,
+						 buffer->virt_addr->addr & PAGE_MASK,
+						 buffer->virt_addr->size,
+						 &rga_mm_cache_notifier_ops))
+			return;
+
+		buffer->cache_write = write_flag;
+
+		/*
+		 * Don't keep the address space alive for the cache, the job
+		 * holds mm_users while it runs. On process exit the unmap
+		 * invalidates the range, the entry goes stale and only the
+		 * grabbed mm_struct and the pinned pages remain until it is
+		 * dropped.
+		 */
+		mmput(buffer->current_mm);
+		buffer->cache_mm_weak = true;
+	}
+#endif
+
+	/* One reference for the job and one for the cache. */
+	kref_init(&buffer->refcount);
+	kref_get(&buffer->refcount);
+	buffer->session = session;
+	buffer->cache_used = jiffies;
+
+	spin_lock_irqsave(&session->mm_cache_lock, flags);
+
+	list_add(&buffer->cache_node, &session->mm_cache);
+	session->mm_cache_count++;
+	session->mm_cache_size += rga_mm_cache_buffer_size(buffer);
+
+	/* Evict from the LRU tail, a job still using a buffer holds its own ref. */
+	while (session->mm_cache_count > RGA_MM_CACHE_MAX_COUNT ||
+	       session->mm_cache_size > size_limit)
+		rga_mm_cache_del(session,
+				 list_last_entry(&session->mm_cache,
+						 struct rga_internal_buffer, cache_node),
+				 &list_to_free);
+
+	spin_unlock_irqrestore(&session->mm_cache_lock, flags);
+
+	rga_mm_cache_free(&list_to_free);
+
+	schedule_delayed_work(&session->mm_cache_work,
+			      msecs_to_jiffies(RGA_MM_CACHE_IDLE_MS));
+}
+
+void rga_mm_session_init_cache(struct rga_session *session)
+{
+	INIT_LIST_HEAD(&session->mm_cache);
+	spin_lock_init(&session->mm_cache_lock);
+	INIT_DELAYED_WORK(&session->mm_cache_work, rga_mm_cache_idle_work);
+}
+
+void rga_mm_session_release_cache(struct rga_session *session)
+{
+	unsigned long flags;
+	LIST_HEAD(list_to_free);
+
+	cancel_delayed_work_sync(&session->mm_cache_work);
+
+	spin_lock_irqsave(&session->mm_cache_lock, flags);
+
+	list_splice_init(&session->mm_cache, &list_to_free);
+	session->mm_cache_count = 0;
+	session->mm_cache_size = 0;
+
+	spin_unlock_irqrestore(&session->mm_cache_lock, flags);
+
+	rga_mm_cache_free(&list_to_free);
+}
+
 static void rga_mm_unmap_channel_job_buffer(struct rga_job *job,
 					    struct rga_job_buffer *job_buffer,
 					    enum dma_data_direction dir)
@@ -1851,8 +2185,7 @@ static void rga_mm_unmap_channel_job_buffer(struct rga_job *job,
 		if (rga_mm_sync_dma_sg_for_cpu(job_buffer->addr, job, dir))
 			pr_err("sync sgt for cpu error!\n");
 
-	rga_mm_unmap_buffer(job_buffer->addr);
-	kfree(job_buffer->addr);
+	rga_mm_put_channel_buffer(job_buffer->addr);
 
 	job_buffer->page_table = NULL;
 }
@@ -1866,18 +2199,28 @@ static int rga_mm_map_channel_job_buffer(struct rga_job *job,
 	int ret;
 	struct rga_internal_buffer *buffer = NULL;
 
+	buffer = rga_mm_cache_lookup(job, job_buffer->ex_addr, write_flag);
+	if (buffer)
+		goto map_done;
+
 	buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
 	if (buffer == NULL) {
 		pr_err("%s alloc internal_buffer error!\n", __func__);
 		return -ENOMEM;
 	}
 
+	INIT_LIST_HEAD(&buffer->cache_node);
+
 	ret = rga_mm_map_buffer(job_buffer->ex_addr, buffer, job, write_flag);
 	if (ret < 0) {
 		pr_err("job buffer map failed!\n");
 		goto error_free_buffer;
 	}
 
+	rga_mm_cache_insert(job, job_buffer->ex_addr, buffer, write_flag);
+
+map_done:
+
 	ret = rga_mm_get_buffer_info(job, buffer, &img->yrgb_addr);
 	if (ret < 0) {
 		pr_err("Failed to get internal buffer info!\n");
@@ -1909,7 +2252,10 @@ static int rga_mm_map_channel_job_buffer(struct rga_job *job,
 	return 0;
 
 error_unmap_buffer:
-	rga_mm_unmap_buffer(buffer);
+	rga_mm_put_channel_buffer(buffer);
+
+	return ret;
+
 error_free_buffer:
 	kfree(buffer);
 
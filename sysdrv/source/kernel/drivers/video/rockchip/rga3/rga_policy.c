@@ -279,7 +279,7 @@ int rga_job_assign(struct rga_job *job)
 	int optional_cores = RGA_NONE_CORE;
 	int specified_cores = RGA_NONE_CORE;
 	int i;
-	int min_of_job_count = -1;
+	u64 load, min_load = U64_MAX;
 	unsigned long flags;
 
 	/* assigned by userspace */
@@ -293,6 +293,10 @@ int rga_job_assign(struct rga_job *job)
 
 	feature = rga_set_feature(rga_base);
 
+	job->workload = src0->act_w * src0->act_h + dst->act_w * dst->act_h;
+	if (src1->yrgb_addr > 0)
+		job->workload += src1->act_w * src1->act_h;
+
 	/* function */
 	for (i = 0; i < rga_drvdata->num_of_scheduler; i++) {
 		data = rga_drvdata->scheduler[i]->data;
@@ -405,9 +409,16 @@ int rga_job_assign(struct rga_job *job)
 							 flags);
 				break;
 			} else {
-				if ((min_of_job_count == -1) ||
-				    (min_of_job_count > scheduler->job_count)) {
-					min_of_job_count = scheduler->job_count;
+				/*
+				 * Balance on the pixels still to be processed
+				 * rather than the number of queued jobs, so a
+				 * core holding one 4K job is not preferred over
+				 * one holding a few small jobs.
+				 */
+				load = scheduler->job_load +
+				       scheduler->running_job->workload;
+				if (load < min_load) {
+					min_load = load;
 					core = scheduler->core;
 					job->scheduler = scheduler;
 				}
@@ -417,7 +428,6 @@ int rga_job_assign(struct rga_job *job)
 		}
 	}
 
-	/* TODO: need consider full load */
 finish:
 	if (DEBUGGER_EN(MSG))
 		pr_info("assign core: %d\n", core);
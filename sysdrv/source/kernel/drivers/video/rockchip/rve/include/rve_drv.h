@@ -136,7 +136,6 @@ struct rve_job {
 
 	struct dma_fence *out_fence;
 	struct dma_fence *in_fence;
-	spinlock_t fence_lock;
 	ktime_t timestamp;
 	ktime_t hw_running_time;
 	ktime_t hw_recoder_time;
@@ -239,6 +238,8 @@ struct rve_internal_ctx_t {
 	uint32_t running_job_count;
 	uint32_t finished_job_count;
 	bool is_running;
+	/* first error of the jobs committed by this ctx */
+	int ret;
 
 	uint32_t disable_auto_cancel;
 
@@ -247,6 +248,7 @@ struct rve_internal_ctx_t {
 	int32_t in_fence_fd;
 
 	struct dma_fence *out_fence;
+	struct dma_fence *in_fence;
 
 	spinlock_t lock;
 	struct kref refcount;
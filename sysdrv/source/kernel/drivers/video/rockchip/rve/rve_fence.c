@@ -51,7 +51,11 @@ int rve_out_fence_alloc(struct rve_job *job)
 	if (!fence)
 		return -ENOMEM;
 
-	dma_fence_init(fence, &rve_fence_ops, &job->fence_lock,
+	/*
+	 * The fence is shared by every job of a ctx and outlives the job
+	 * pages through its sync_file, so it must not use the job's lock.
+	 */
+	dma_fence_init(fence, &rve_fence_ops, &fence_ctx->spinlock,
 			 fence_ctx->context, ++fence_ctx->seqno);
 
 	job->out_fence = fence;
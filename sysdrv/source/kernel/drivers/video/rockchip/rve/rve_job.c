@@ -150,9 +150,6 @@ static struct rve_job *rve_job_alloc(struct rve_internal_ctx_t *ctx)
 	if (!job)
 		return NULL;
 
-#ifdef CONFIG_SYNC_FILE
-	spin_lock_init(&job->fence_lock);
-#endif
 	INIT_LIST_HEAD(&job->head);
 
 	job->timestamp = ktime_get();
@@ -352,11 +349,14 @@ static void rve_job_timeout_clean(struct rve_scheduler_t *scheduler)
 	if (job && (job->flags & RVE_ASYNC) &&
 	   (ktime_to_ms(ktime_sub(now, job->hw_running_time)) >= RVE_ASYNC_TIMEOUT_DELAY)) {
 		scheduler->running_job = NULL;
+		scheduler->timer.busy_time += ktime_us_delta(now, job->hw_recoder_time);
 
 		spin_unlock_irqrestore(&scheduler->irq_lock, flags);
 
+		pr_err("reset core[%d] by async job timeout", scheduler->core);
 		scheduler->ops->soft_reset(scheduler);
 
+		job->ret = -EBUSY;
 		rve_internal_ctx_signal(job);
 
 #ifndef RVE_PD_AWAYS_ON
@@ -452,8 +452,7 @@ static inline int rve_job_wait(struct rve_job *job)
 	scheduler = rve_job_get_scheduler(job);
 
 	left_time = wait_event_timeout(scheduler->job_done_wq,
-		job->ctx->finished_job_count == job->ctx->cmd_num,
-		RVE_SYNC_TIMEOUT_DELAY * job->ctx->cmd_num);
+		job->flags & RVE_JOB_DONE, RVE_SYNC_TIMEOUT_DELAY);
 
 	switch (left_time) {
 	case 0:
@@ -465,7 +464,7 @@ static inline int rve_job_wait(struct rve_job *job)
 		ret = -ERESTARTSYS;
 		break;
 	default:
-		ret = 0;
+		ret = job->ctx->ret;
 		break;
 	}
 
@@ -527,10 +526,17 @@ int rve_job_config_by_user_ctx(struct rve_user_ctx_t *user_ctx)
 
 	spin_unlock_irqrestore(&ctx->lock, flags);
 
-	/* TODO: user cmd_num */
-	user_ctx->cmd_num = 1;
+	if (user_ctx->cmd_num <= 0 || user_ctx->cmd_num > RVE_CMD_NUM_MAX) {
+		pr_err("invalid cmd_num[%d], max = %d\n",
+		       user_ctx->cmd_num, RVE_CMD_NUM_MAX);
+		return -EINVAL;
+	}
+
+	/* every cmd is queued as its own job, so keep one regcmd per job */
+	if (ctx->regcmd_data == NULL || user_ctx->cmd_num > ctx->cmd_num) {
+		kfree(ctx->regcmd_data);
+		ctx->cmd_num = 0;
 
-	if (ctx->regcmd_data == NULL) {
 		ctx->regcmd_data = kmalloc_array(user_ctx->cmd_num,
 			sizeof(struct rve_cmd_reg_array_t), GFP_KERNEL);
 		if (ctx->regcmd_data == NULL) {
@@ -559,9 +565,52 @@ int rve_job_config_by_user_ctx(struct rve_user_ctx_t *user_ctx)
 
 err_free_regcmd_data:
 	kfree(ctx->regcmd_data);
+	ctx->regcmd_data = NULL;
+	ctx->cmd_num = 0;
 	return ret;
 }
 
+/*
+ * Account the jobs that were never committed as finished with @err, so
+ * that whoever retires the last job (the in-flight ones or this call)
+ * signals the out fence with the error and clears is_running.
+ */
+static void rve_internal_ctx_abort_commit(struct rve_internal_ctx_t *ctx, int err)
+{
+	struct dma_fence *out_fence = NULL;
+	bool last;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->lock, flags);
+
+	if (ctx->ret == 0)
+		ctx->ret = err;
+
+	ctx->finished_job_count += ctx->cmd_num - ctx->running_job_count;
+	last = ctx->finished_job_count >= ctx->cmd_num;
+	if (last) {
+		out_fence = ctx->out_fence;
+		ctx->out_fence = NULL;
+		ctx->is_running = false;
+	}
+
+	spin_unlock_irqrestore(&ctx->lock, flags);
+
+#ifdef CONFIG_SYNC_FILE
+	if (out_fence) {
+		dma_fence_set_error(out_fence, err);
+		dma_fence_signal(out_fence);
+		dma_fence_put(out_fence);
+	}
+
+	/* the fd never reaches userspace */
+	if (ctx->out_fence_fd >= 0) {
+		ksys_close(ctx->out_fence_fd);
+		ctx->out_fence_fd = -1;
+	}
+#endif
+}
+
 int rve_job_commit_by_user_ctx(struct rve_user_ctx_t *user_ctx)
 {
 	struct rve_pending_ctx_manager *ctx_manager;
@@ -586,11 +635,20 @@ int rve_job_commit_by_user_ctx(struct rve_user_ctx_t *user_ctx)
 		return -EFAULT;
 	}
 
+	if (ctx->regcmd_data == NULL) {
+		pr_err("can not commit ctx[%d] before config", ctx->id);
+		spin_unlock_irqrestore(&ctx->lock, flags);
+		return -EINVAL;
+	}
+
 	/* Reset */
 	ctx->finished_job_count = 0;
 	ctx->running_job_count = 0;
+	ctx->ret = 0;
 	ctx->is_running = true;
 	ctx->disable_auto_cancel = user_ctx->disable_auto_cancel;
+	ctx->out_fence = NULL;
+	ctx->out_fence_fd = -1;
 
 	ctx->sync_mode = user_ctx->sync_mode;
 	if (ctx->sync_mode == 0)
@@ -598,16 +656,49 @@ int rve_job_commit_by_user_ctx(struct rve_user_ctx_t *user_ctx)
 
 	spin_unlock_irqrestore(&ctx->lock, flags);
 
+#ifdef CONFIG_SYNC_FILE
+	/* all jobs of the ctx wait on the same input fence */
+	if (ctx->sync_mode == RVE_ASYNC && ctx->in_fence_fd > 0) {
+		ctx->in_fence = rve_get_input_fence(ctx->in_fence_fd);
+		if (!ctx->in_fence) {
+			pr_err("%s: failed to get input dma_fence\n", __func__);
+
+			spin_lock_irqsave(&ctx->lock, flags);
+			ctx->is_running = false;
+			spin_unlock_irqrestore(&ctx->lock, flags);
+
+			return -EINVAL;
+		}
+
+		/* close input fence fd */
+		ksys_close(ctx->in_fence_fd);
+		ctx->in_fence_fd = 0;
+	}
+#endif
+
 	for (i = 0; i < ctx->cmd_num; i++) {
 		ret = rve_job_commit(ctx);
 		if (ret < 0) {
 			pr_err("rve_job_commit failed, i = %d\n", i);
-			return -EFAULT;
+			ret = -EFAULT;
+			break;
 		}
 
 		ctx->running_job_count++;
 	}
 
+#ifdef CONFIG_SYNC_FILE
+	if (ctx->in_fence) {
+		dma_fence_put(ctx->in_fence);
+		ctx->in_fence = NULL;
+	}
+#endif
+
+	if (ret < 0) {
+		rve_internal_ctx_abort_commit(ctx, ret);
+		return ret;
+	}
+
 	user_ctx->out_fence_fd = ctx->out_fence_fd;
 
 	if (unlikely(copy_to_user(u64_to_user_ptr(user_ctx->regcmd_data),
@@ -646,9 +737,6 @@ int rve_job_commit(struct rve_internal_ctx_t *ctx)
 {
 	struct rve_job *job = NULL;
 	struct rve_scheduler_t *scheduler = NULL;
-#ifdef CONFIG_SYNC_FILE
-	struct dma_fence *in_fence;
-#endif
 	int ret = 0;
 
 	job = rve_job_alloc(ctx);
@@ -661,71 +749,61 @@ int rve_job_commit(struct rve_internal_ctx_t *ctx)
 #ifdef CONFIG_SYNC_FILE
 		job->flags |= RVE_ASYNC;
 
+		/*
+		 * The first job of the ctx creates the out fence, the others
+		 * only hold a reference on it. The ctx keeps its own reference
+		 * until the last job of the ctx is done and signals it.
+		 */
 		if (!ctx->out_fence) {
 			ret = rve_out_fence_alloc(job);
 			if (ret) {
 				rve_job_free(job);
 				return ret;
 			}
-		}
 
-		ctx->out_fence = job->out_fence;
+			ctx->out_fence = dma_fence_get(job->out_fence);
 
-		ctx->out_fence_fd = rve_out_fence_get_fd(job);
-
-		if (ctx->out_fence_fd < 0)
-			pr_err("out fence get fd failed");
+			ctx->out_fence_fd = rve_out_fence_get_fd(job);
+			if (ctx->out_fence_fd < 0)
+				pr_err("out fence get fd failed");
+		} else {
+			job->out_fence = dma_fence_get(ctx->out_fence);
+		}
 
 		if (DEBUGGER_EN(MSG))
-			pr_info("in_fence_fd = %d", ctx->in_fence_fd);
+			pr_info("in_fence = %p", ctx->in_fence);
 
 		/* if input fence is valiable */
-		if (ctx->in_fence_fd > 0) {
-			in_fence = rve_get_input_fence(
-				ctx->in_fence_fd);
-			if (!in_fence) {
-				pr_err("%s: failed to get input dma_fence\n",
-					 __func__);
-				rve_job_free(job);
-				return ret;
-			}
-
-			/* close input fence fd */
-			ksys_close(ctx->in_fence_fd);
-
-			ret = dma_fence_get_status(in_fence);
-			/* ret = 1: fence has been signaled */
-			if (ret == 1) {
-				scheduler = rve_job_schedule(job);
-
-				if (scheduler == NULL) {
-					pr_err("failed to get scheduler, %s(%d)\n",
-						 __func__, __LINE__);
-					goto invalid_job;
-				}
-				/* if input fence is valid */
-			} else if (ret == 0) {
+		if (ctx->in_fence) {
+			ret = dma_fence_get_status(ctx->in_fence);
+			/* ret = 0: fence is valid and not signaled yet */
+			if (ret == 0) {
 				ret = rve_add_dma_fence_callback(job,
-					in_fence, rve_job_input_fence_signaled);
-				if (ret < 0) {
+					ctx->in_fence, rve_job_input_fence_signaled);
+				if (ret == 0)
+					return ret;
+
+				/* signaled while adding the callback */
+				if (ret != -ENOENT) {
 					pr_err("%s: failed to add fence callback\n",
 						 __func__);
 					rve_job_free(job);
 					return ret;
 				}
-			} else {
+			} else if (ret < 0) {
 				pr_err("%s: fence status error\n", __func__);
 				rve_job_free(job);
 				return ret;
 			}
-		} else {
-			scheduler = rve_job_schedule(job);
 
-			if (scheduler == NULL) {
-				pr_err("failed to get scheduler, %s(%d)\n",
-					 __func__, __LINE__);
-				goto invalid_job;
-			}
+			ret = 0;
+		}
+
+		scheduler = rve_job_schedule(job);
+		if (scheduler == NULL) {
+			pr_err("failed to get scheduler, %s(%d)\n",
+				 __func__, __LINE__);
+			goto invalid_job;
 		}
 
 		return ret;
@@ -838,22 +916,28 @@ int rve_internal_ctx_signal(struct rve_job *job)
 		return -EINVAL;
 	}
 
-	ctx->regcmd_data = job->regcmd_data;
-
 	spin_lock_irqsave(&ctx->lock, flags);
 
+	if (job->ret < 0 && ctx->ret == 0)
+		ctx->ret = job->ret;
+
 	finished_job_count = ++ctx->finished_job_count;
 
 	spin_unlock_irqrestore(&ctx->lock, flags);
 
+	/* sync mode commits and waits for the jobs of a ctx one by one */
+	job->flags |= RVE_JOB_DONE;
+
 	if (finished_job_count >= ctx->cmd_num) {
 #ifdef CONFIG_SYNC_FILE
-		if (ctx->out_fence)
+		if (ctx->out_fence) {
+			if (ctx->ret < 0)
+				dma_fence_set_error(ctx->out_fence, ctx->ret);
 			dma_fence_signal(ctx->out_fence);
+			dma_fence_put(ctx->out_fence);
+		}
 #endif
 
-		job->flags |= RVE_JOB_DONE;
-
 		wake_up(&scheduler->job_done_wq);
 
 		spin_lock_irqsave(&ctx->lock, flags);
@@ -868,6 +952,11 @@ int rve_internal_ctx_signal(struct rve_job *job)
 			if (!ctx->disable_auto_cancel)
 				kref_put(&ctx->refcount, rve_internal_ctx_kref_release);
 		}
+	} else if (job->flags & RVE_ASYNC) {
+		/* nobody waits on the intermediate jobs of an async ctx */
+		rve_job_cleanup(job);
+	} else {
+		wake_up(&scheduler->job_done_wq);
 	}
 
 	return 0;
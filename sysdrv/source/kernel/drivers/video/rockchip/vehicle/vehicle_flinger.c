@@ -47,6 +47,7 @@ static int vehicle_dump_cif;
 static int vehicle_dump_rga;
 static int vehicle_dump_vop;
 static bool nv12_display = true;
+static bool zero_copy_display = true;
 
 enum force_value {
 	FORCE_WIDTH = 1920,
@@ -131,6 +132,8 @@ struct flinger {
 	/*debug*/
 	int debug_cif_count;
 	int debug_vop_count;
+	ktime_t open_time;
+	bool first_frame_shown;
 	bool running;
 	struct drm_device *drm_dev;
 	struct drm_crtc *crtc;
@@ -580,6 +583,7 @@ static int rk_flinger_iep_deinterlace(struct flinger *flinger,
 	if (!src_buffer || !dst_buffer)
 		return -EINVAL;
 
+	dst_buffer->timestamp = src_buffer->timestamp;
 	rga_request.rotate_mode = 0;
 	rga_request.sina = 0;
 	rga_request.cosa = 0;
@@ -659,6 +663,7 @@ static int rk_flinger_rga_scaler(struct flinger *flinger,
 	if (!src_buffer || !dst_buffer)
 		return -EINVAL;
 
+	dst_buffer->timestamp = src_buffer->timestamp;
 	rga_request.rotate_mode = 0;
 	rga_request.sina = 0;
 	rga_request.cosa = 0;
@@ -961,6 +966,7 @@ static int rk_flinger_rga_render(struct flinger *flinger,
 		dst_buffer->rel_fence = NULL;
 
 	rk_flinger_rga_blit(flinger, src_buffer, dst_buffer);
+	dst_buffer->timestamp = src_buffer->timestamp;
 	rk_flinger_fill_buffer_rects(dst_buffer, &src_buffer->dst,
 				     &src_buffer->dst);
 	dst_buffer->src.f = src_buffer->dst.f;
@@ -1100,6 +1106,16 @@ static int rk_flinger_vop_show(struct flinger *flinger,
 
 	rk_drm_vehicle_commit(flinger, buffer);
 
+	if (!flinger->first_frame_shown) {
+		ktime_t now = ktime_get();
+
+		flinger->first_frame_shown = true;
+		VEHICLE_INFO("first frame shown: %lld ms after boot, %lld ms after open, %lld ms after capture\n",
+			     ktime_to_ms(ktime_get_boottime()),
+			     ktime_to_ms(ktime_sub(now, flinger->open_time)),
+			     ktime_to_ms(ktime_sub(now, buffer->timestamp)));
+	}
+
 	flinger->debug_vop_count++;
 	/* save vop show buffer */
 	if (vehicle_dump_vop) {
@@ -1167,6 +1183,30 @@ static void rk_flinger_first_done(struct work_struct *work)
 	}
 }
 
+/*
+ * The cif writes into drm buffers that the vop can scan out, so when no
+ * rotation or format conversion is needed the source buffer is shown as is.
+ * The cif line width must match the buffer pitch for that.
+ */
+static bool rk_flinger_can_zero_copy(struct flinger *flinger,
+				     struct graphic_buffer *buffer)
+{
+	if (!zero_copy_display || !nv12_display)
+		return false;
+
+	if (flinger->v_cfg.input_format == CIF_INPUT_FORMAT_PAL ||
+	    flinger->v_cfg.input_format == CIF_INPUT_FORMAT_NTSC)
+		return false;
+
+	if (!buffer->drm_buffer || buffer->offset)
+		return false;
+
+	return buffer->rotation == RGA_TRANSFORM_ROT_0 &&
+	       buffer->src.f == HAL_PIXEL_FORMAT_YCrCb_NV12 &&
+	       buffer->src.w == buffer->drm_buffer->width &&
+	       buffer->src.h <= buffer->drm_buffer->height;
+}
+
 static void rk_flinger_render_show(struct work_struct *work)
 {
 	struct graphic_buffer *src_buffer, *dst_buffer, *iep_buffer, *buffer;
@@ -1260,6 +1300,23 @@ try_again:
 			}
 		}
 
+		/* show the cif buffer directly, the one it replaces goes back to cif */
+		if (rk_flinger_can_zero_copy(flg, src_buffer)) {
+			rk_flinger_vop_show(flg, src_buffer);
+			if (flg->last_src_buffer &&
+			    flg->last_src_buffer->state == DISPLAY)
+				flg->last_src_buffer->state = FREE;
+			flg->last_src_buffer = src_buffer;
+			src_buffer->state = DISPLAY;
+
+			for (i = 0; i < NUM_TARGET_BUFFERS; i++) {
+				buffer = &(flinger->target_buffer[i]);
+				if (buffer->state == DISPLAY)
+					buffer->state = FREE;
+			}
+			continue;
+		}
+
 		/*  2. find dst buffer */
 		dst_buffer = NULL;
 		iep_buffer = NULL;
@@ -1333,6 +1390,13 @@ try_again:
 			}
 			dst_buffer->state = DISPLAY;
 		}
+
+		/* back from zero-copy, the vop no longer reads the last cif buffer */
+		if (flg->last_src_buffer) {
+			if (flg->last_src_buffer->state == DISPLAY)
+				flg->last_src_buffer->state = FREE;
+			flg->last_src_buffer = NULL;
+		}
 	} while (1);
 }
 
@@ -1448,6 +1512,9 @@ int vehicle_flinger_reverse_open(struct vehicle_cfg *v_cfg,
 	v_cfg->buf_num = NUM_SOURCE_BUFFERS;
 
 	flg->cvbs_field_count = 0;
+	flg->last_src_buffer = NULL;
+	flg->first_frame_shown = false;
+	flg->open_time = ktime_get();
 	memcpy(&flg->v_cfg, v_cfg, sizeof(struct vehicle_cfg));
 	flg->running = true;
 
@@ -84,5 +84,14 @@ static inline bool z_erofs_put_shortlivedpage(struct list_head *pagepool,
 int z_erofs_decompress(struct z_erofs_decompress_req *rq,
 		       struct list_head *pagepool);
 
+#ifdef CONFIG_EROFS_FS_ZIP_ROCKCHIP
+int z_erofs_hw_decompress(struct z_erofs_decompress_req *rq);
+#else
+static inline int z_erofs_hw_decompress(struct z_erofs_decompress_req *rq)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
 #endif
 
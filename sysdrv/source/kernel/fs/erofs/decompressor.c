@@ -309,6 +309,9 @@ static int z_erofs_decompress_generic(struct z_erofs_decompress_req *rq,
 	void *dst;
 	int ret;
 
+	if (rq->alg == Z_EROFS_COMPRESSION_LZ4 && !z_erofs_hw_decompress(rq))
+		return 0;
+
 	/* two optimized fast paths only for non bigpcluster cases yet */
 	if (rq->inputsize <= PAGE_SIZE) {
 		if (nrpages_out == 1 && !rq->inplace_io) {
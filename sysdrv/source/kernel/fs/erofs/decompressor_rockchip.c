@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (C) 2023 Rockchip Electronics Co., Ltd.
+ *
+ * Offload lz4 pcluster decompression to the Rockchip hardware decompressor.
+ *
+ * The engine only understands the lz4 frame format, whereas EROFS stores
+ * raw lz4 blocks. Each pcluster is therefore wrapped into a single-block
+ * frame in a coherent bounce buffer and decompressed into another one,
+ * then copied to the output pages.
+ *
+ * There is one engine in the SoC. Whoever finds it busy, or any pcluster
+ * the engine can't handle, takes the usual CPU path with the per-CPU
+ * buffers instead, so concurrent readers keep the CPUs busy as well.
+ */
+#include "compress.h"
+#include <linux/dma-mapping.h>
+#include <linux/of.h>
+#include <linux/of_platform.h>
+#include <linux/platform_device.h>
+#include <linux/soc/rockchip/rockchip_decompress.h>
+#include <asm/unaligned.h>
+
+/* larger pclusters (in decompressed bytes) are left to the CPU */
+#define Z_EROFS_HW_MAX_OUTSIZE	(256 * 1024)
+
+/* longest time a pcluster may take in the engine, in seconds */
+#define Z_EROFS_HW_TIMEOUT	1
+
+/*
+ * lz4 frame wrapping a single block: magic, FLG (version 01, independent
+ * blocks, no checksums), BD (4MB max block size), header checksum byte
+ * ((xxh32(FLG, BD) >> 8) & 0xff) and the compressed block size, then the
+ * block itself followed by the zero end mark.
+ */
+#define Z_EROFS_HW_LZ4F_MAGIC	0x184D2204
+#define Z_EROFS_HW_LZ4F_FLG	0x60
+#define Z_EROFS_HW_LZ4F_BD	0x70
+#define Z_EROFS_HW_LZ4F_HC	0x73
+#define Z_EROFS_HW_LZ4F_HDRSZ	11
+#define Z_EROFS_HW_LZ4F_OVERHEAD	(Z_EROFS_HW_LZ4F_HDRSZ + 4)
+
+struct z_erofs_hw_stream {
+	struct device *dev;
+	void *src, *dst;
+	dma_addr_t src_dma, dst_dma;
+	unsigned int insize;
+};
+
+static struct device *z_erofs_hw_device(void)
+{
+	struct platform_device *pdev;
+	struct device_node *np;
+
+	np = of_find_compatible_node(NULL, NULL, "rockchip,hw-decompress");
+	if (!np)
+		return NULL;
+
+	pdev = of_device_is_available(np) ? of_find_device_by_node(np) : NULL;
+	of_node_put(np);
+	if (!pdev)
+		return NULL;
+
+	/* rk_decom_start() waits for the probe, do not use an unbound engine */
+	if (!platform_get_drvdata(pdev)) {
+		put_device(&pdev->dev);
+		return NULL;
+	}
+	return &pdev->dev;
+}
+
+static void z_erofs_hw_free(struct z_erofs_hw_stream *hw)
+{
+	if (!hw)
+		return;
+
+	if (hw->dev) {
+		if (hw->src)
+			dma_free_coherent(hw->dev, hw->insize, hw->src,
+					  hw->src_dma);
+		if (hw->dst)
+			dma_free_coherent(hw->dev, Z_EROFS_HW_MAX_OUTSIZE,
+					  hw->dst, hw->dst_dma);
+		put_device(hw->dev);
+	}
+	kfree(hw);
+}
+
+void z_erofs_hw_setup(struct super_block *sb)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(sb);
+	struct z_erofs_hw_stream *hw;
+
+	/* the engine decodes whole blocks, which needs 0padding */
+	if (!erofs_sb_has_lz4_0padding(sbi))
+		return;
+
+	hw = kzalloc(sizeof(*hw), GFP_KERNEL);
+	if (!hw)
+		return;
+
+	hw->dev = z_erofs_hw_device();
+	if (!hw->dev)
+		goto err_out;
+
+	hw->insize = PAGE_ALIGN(sbi->lz4.max_pclusterblks * EROFS_BLKSIZ +
+				Z_EROFS_HW_LZ4F_OVERHEAD);
+	hw->src = dma_alloc_coherent(hw->dev, hw->insize, &hw->src_dma,
+				     GFP_KERNEL);
+	hw->dst = dma_alloc_coherent(hw->dev, Z_EROFS_HW_MAX_OUTSIZE,
+				     &hw->dst_dma, GFP_KERNEL);
+	if (!hw->src || !hw->dst) {
+		erofs_err(sb, "failed to allocate hardware decompressor buffers");
+		goto err_out;
+	}
+
+	sbi->hw_stream = hw;
+	erofs_info(sb, "lz4 pclusters are decompressed by %s",
+		   dev_name(hw->dev));
+	return;
+
+err_out:
+	z_erofs_hw_free(hw);
+}
+
+void z_erofs_hw_destroy(struct super_block *sb)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(sb);
+
+	z_erofs_hw_free(sbi->hw_stream);
+	sbi->hw_stream = NULL;
+}
+
+/* wrap the 0padded compressed data of @rq into an lz4 frame in @hw->src */
+static int z_erofs_hw_fill_frame(struct z_erofs_hw_stream *hw,
+				 struct z_erofs_decompress_req *rq)
+{
+	unsigned int inputmargin = 0, total, i;
+	u8 *src = hw->src, *tmp;
+	u8 *headpage;
+
+	headpage = kmap_atomic(*rq->in);
+	while (!headpage[inputmargin & ~PAGE_MASK])
+		if (!(++inputmargin & ~PAGE_MASK))
+			break;
+	kunmap_atomic(headpage);
+
+	if (inputmargin >= rq->inputsize)
+		return -EIO;
+	total = rq->inputsize - inputmargin;
+
+	put_unaligned_le32(Z_EROFS_HW_LZ4F_MAGIC, src);
+	src[4] = Z_EROFS_HW_LZ4F_FLG;
+	src[5] = Z_EROFS_HW_LZ4F_BD;
+	src[6] = Z_EROFS_HW_LZ4F_HC;
+	put_unaligned_le32(total, src + 7);
+
+	tmp = src + Z_EROFS_HW_LZ4F_HDRSZ;
+	for (i = 0; total; ++i) {
+		unsigned int cnt = min_t(unsigned int, total,
+					 PAGE_SIZE - inputmargin);
+		void *kaddr = kmap_atomic(rq->in[i]);
+
+		memcpy(tmp, kaddr + inputmargin, cnt);
+		kunmap_atomic(kaddr);
+		tmp += cnt;
+		total -= cnt;
+		inputmargin = 0;
+	}
+	put_unaligned_le32(0, tmp);
+	return 0;
+}
+
+static void z_erofs_hw_copy_out(struct z_erofs_decompress_req *rq,
+				const u8 *dst)
+{
+	unsigned int pageofs = rq->pageofs_out;
+	unsigned int left = rq->outputsize;
+	struct page **out = rq->out;
+
+	while (left) {
+		unsigned int cnt = min_t(unsigned int, left,
+					 PAGE_SIZE - pageofs);
+		struct page *const page = *out++;
+
+		if (page) {
+			u8 *buf = kmap_atomic(page);
+
+			memcpy(buf + pageofs, dst, cnt);
+			kunmap_atomic(buf);
+		}
+		dst += cnt;
+		left -= cnt;
+		pageofs = 0;
+	}
+}
+
+/*
+ * Decompress one full lz4 pcluster with the hardware decompressor.  Returns 0
+ * on success or a negative error if it has to be decompressed on the CPU.
+ */
+int z_erofs_hw_decompress(struct z_erofs_decompress_req *rq)
+{
+	struct z_erofs_hw_stream *hw = EROFS_SB(rq->sb)->hw_stream;
+	u64 outlen = 0;
+	int ret;
+
+	if (!hw || rq->partial_decoding ||
+	    rq->outputsize > Z_EROFS_HW_MAX_OUTSIZE ||
+	    rq->inputsize + Z_EROFS_HW_LZ4F_OVERHEAD > hw->insize)
+		return -EOPNOTSUPP;
+
+	/* the engine is shared with other users, use the CPU if busy */
+	if (!rk_decom_trylock())
+		return -EBUSY;
+
+	/* input pages may be reused for output, copy them out first */
+	ret = z_erofs_hw_fill_frame(hw, rq);
+	if (ret)
+		goto out;
+
+	ret = rk_decom_start(LZ4_MOD | DECOM_NOBLOCKING, hw->src_dma,
+			     hw->dst_dma, rq->outputsize);
+	if (ret)
+		goto out;
+
+	ret = rk_decom_wait_done(Z_EROFS_HW_TIMEOUT, &outlen);
+	if (ret)
+		goto out;
+
+	if (outlen != rq->outputsize) {
+		ret = -EIO;
+		goto out;
+	}
+	z_erofs_hw_copy_out(rq, hw->dst);
+out:
+	rk_decom_unlock();
+	return ret;
+}
@@ -83,6 +83,10 @@ struct erofs_sb_info {
 	struct inode *managed_cache;
 
 	struct erofs_sb_lz4_info lz4;
+#ifdef CONFIG_EROFS_FS_ZIP_ROCKCHIP
+	/* bounce buffers of the hardware decompressor */
+	struct z_erofs_hw_stream *hw_stream;
+#endif
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	struct dax_device *dax_dev;
 	u32 blocks;
@@ -469,6 +473,14 @@ static inline int z_erofs_load_lz4_config(struct super_block *sb,
 }
 #endif	/* !CONFIG_EROFS_FS_ZIP */
 
+#ifdef CONFIG_EROFS_FS_ZIP_ROCKCHIP
+void z_erofs_hw_setup(struct super_block *sb);
+void z_erofs_hw_destroy(struct super_block *sb);
+#else
+static inline void z_erofs_hw_setup(struct super_block *sb) {}
+static inline void z_erofs_hw_destroy(struct super_block *sb) {}
+#endif	/* !CONFIG_EROFS_FS_ZIP_ROCKCHIP */
+
 #define EFSCORRUPTED    EUCLEAN         /* Filesystem is corrupted */
 
 #endif	/* __EROFS_INTERNAL_H */
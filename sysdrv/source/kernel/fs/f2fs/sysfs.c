@@ -126,6 +126,33 @@ static ssize_t pending_discard_show(struct f2fs_attr *a,
 				&SM_I(sbi)->dcc_info->discard_cmd_cnt));
 }
 
+/*
+ * Blocks the filesystem wrote for every block the applications wrote, over
+ * the window counted by iostat, so iostat_enable has to be set.
+ */
+static ssize_t write_amplification_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	unsigned long long app_bytes, fs_bytes = 0;
+	unsigned int waf;
+	int i;
+
+	if (!sbi->iostat_enable)
+		return -EINVAL;
+
+	spin_lock(&sbi->iostat_lock);
+	app_bytes = sbi->rw_iostat[APP_WRITE_IO];
+	for (i = FS_DATA_IO; i <= FS_CP_META_IO; i++)
+		fs_bytes += sbi->rw_iostat[i];
+	spin_unlock(&sbi->iostat_lock);
+
+	if (!app_bytes)
+		return sprintf(buf, "0.00\n");
+
+	waf = div64_u64(fs_bytes * 100, app_bytes);
+	return sprintf(buf, "%u.%02u\n", waf / 100, waf % 100);
+}
+
 static ssize_t features_show(struct f2fs_attr *a,
 		struct f2fs_sb_info *sbi, char *buf)
 {
@@ -752,6 +779,7 @@ F2FS_GENERAL_RO_ATTR(encoding);
 F2FS_GENERAL_RO_ATTR(mounted_time_sec);
 F2FS_GENERAL_RO_ATTR(main_blkaddr);
 F2FS_GENERAL_RO_ATTR(pending_discard);
+F2FS_GENERAL_RO_ATTR(write_amplification);
 #ifdef CONFIG_F2FS_STAT_FS
 F2FS_STAT_ATTR(STAT_INFO, f2fs_stat_info, cp_foreground_calls, cp_count);
 F2FS_STAT_ATTR(STAT_INFO, f2fs_stat_info, cp_background_calls, bg_cp_count);
@@ -823,6 +851,7 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(max_small_discards),
 	ATTR_LIST(discard_granularity),
 	ATTR_LIST(pending_discard),
+	ATTR_LIST(write_amplification),
 	ATTR_LIST(batched_trim_sections),
 	ATTR_LIST(ipu_policy),
 	ATTR_LIST(min_ipu_util),
@@ -541,11 +541,19 @@ static int fuse_fsync(struct file *file, loff_t start, loff_t end,
 {
 	struct inode *inode = file->f_mapping->host;
 	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_file *ff = file->private_data;
 	int err;
 
 	if (fuse_is_bad(inode))
 		return -EIO;
 
+	/*
+	 * Data of a passthrough file only lives in the lower file, sync that
+	 * one directly rather than waiting for the daemon to do it.
+	 */
+	if (ff->passthrough.filp)
+		return fuse_passthrough_fsync(file, start, end, datasync);
+
 	inode_lock(inode);
 
 	/*
@@ -165,6 +165,21 @@ out:
 	return ret;
 }
 
+int fuse_passthrough_fsync(struct file *file, loff_t start, loff_t end,
+			   int datasync)
+{
+	int ret;
+	const struct cred *old_cred;
+	struct fuse_file *ff = file->private_data;
+	struct file *passthrough_filp = ff->passthrough.filp;
+
+	old_cred = override_creds(ff->passthrough.cred);
+	ret = vfs_fsync_range(passthrough_filp, start, end, datasync);
+	revert_creds(old_cred);
+
+	return ret;
+}
+
 ssize_t fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	int ret;
@@ -112,8 +112,9 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 #endif
 	if (!flashbuf) {
 		/* For NAND it's quicker to read a whole eraseblock at a time,
-		   apparently */
-		if (jffs2_cleanmarker_oob(c))
+		   apparently. Same for SPI NOR, every read costs a command,
+		   address and dummy cycles on the bus */
+		if (jffs2_cleanmarker_oob(c) || c->mtd->type == MTD_NORFLASH)
 			try_size = c->sector_size;
 		else
 			try_size = PAGE_SIZE;
@@ -217,7 +217,10 @@ int squashfs_read_data(struct super_block *sb, u64 index, int length,
 			res = -EIO;
 			goto out_free_bio;
 		}
-		res = squashfs_decompress(msblk, bio, offset, length, output);
+		res = squashfs_hw_decompress(msblk, bio, offset, length, output);
+		if (res < 0)
+			res = squashfs_decompress(msblk, bio, offset, length,
+						  output);
 	} else {
 		res = copy_bio_to_actor(bio, output, offset, length);
 	}
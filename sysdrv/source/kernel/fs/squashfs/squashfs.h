@@ -44,6 +44,23 @@ extern int squashfs_decompress(struct squashfs_sb_info *, struct bio *,
 				int, int, struct squashfs_page_actor *);
 extern int squashfs_max_decompressors(void);
 
+/* zlib_rockchip.c */
+#ifdef CONFIG_SQUASHFS_ZLIB_ROCKCHIP
+extern void squashfs_hw_setup(struct squashfs_sb_info *);
+extern void squashfs_hw_destroy(struct squashfs_sb_info *);
+extern int squashfs_hw_decompress(struct squashfs_sb_info *, struct bio *,
+				int, int, struct squashfs_page_actor *);
+#else
+static inline void squashfs_hw_setup(struct squashfs_sb_info *msblk) { }
+static inline void squashfs_hw_destroy(struct squashfs_sb_info *msblk) { }
+static inline int squashfs_hw_decompress(struct squashfs_sb_info *msblk,
+	struct bio *bio, int offset, int length,
+	struct squashfs_page_actor *output)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
 /* export.c */
 extern __le64 *squashfs_read_inode_lookup_table(struct super_block *, u64, u64,
 				unsigned int);
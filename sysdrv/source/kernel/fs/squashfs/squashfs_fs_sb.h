@@ -54,6 +54,7 @@ struct squashfs_sb_info {
 	struct mutex				meta_index_mutex;
 	struct meta_index			*meta_index;
 	struct squashfs_stream			*stream;
+	struct squashfs_hw_stream		*hw_stream;
 	__le64					*inode_lookup_table;
 	u64					inode_table;
 	u64					directory_table;
@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * Copyright (c) 2023 Rockchip Electronics Co., Ltd.
+ *
+ * zlib_rockchip.c
+ */
+
+/*
+ * This file offloads zlib block decompression to the Rockchip hardware
+ * decompressor. The engine needs physically contiguous input and output
+ * below 4G, so each mounted filesystem gets a pair of bounce buffers of
+ * one block each, allocated coherent for the decompressor device.
+ *
+ * There is one engine in the SoC. Whoever finds it busy decompresses on the
+ * CPU instead, so with concurrent readers one block is inflated by the
+ * engine while the others are inflated in software at the same time. Any
+ * engine error also falls back to the CPU, which reports real corruption.
+ *
+ * The engine is waited for outside of the decompressor stream lock, which
+ * is a per-CPU lock for the percpu decompressor and must not sleep.
+ */
+
+#include <linux/bio.h>
+#include <linux/dma-mapping.h>
+#include <linux/of.h>
+#include <linux/of_platform.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/soc/rockchip/rockchip_decompress.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs.h"
+#include "decompressor.h"
+#include "page_actor.h"
+
+/* Longest time a block may take in the engine, in seconds */
+#define SQUASHFS_HW_TIMEOUT	1
+
+struct squashfs_hw_stream {
+	struct device	*dev;
+	void		*src;
+	void		*dst;
+	dma_addr_t	src_dma;
+	dma_addr_t	dst_dma;
+	int		size;
+};
+
+static struct device *squashfs_hw_device(void)
+{
+	struct platform_device *pdev;
+	struct device_node *np;
+
+	np = of_find_compatible_node(NULL, NULL, "rockchip,hw-decompress");
+	if (!np)
+		return NULL;
+
+	pdev = of_device_is_available(np) ? of_find_device_by_node(np) : NULL;
+	of_node_put(np);
+	if (!pdev)
+		return NULL;
+
+	/* rk_decom_start() waits for the probe, do not use an unbound engine */
+	if (!platform_get_drvdata(pdev)) {
+		put_device(&pdev->dev);
+		return NULL;
+	}
+
+	return &pdev->dev;
+}
+
+static void squashfs_hw_free(struct squashfs_hw_stream *hw)
+{
+	if (hw == NULL)
+		return;
+
+	if (hw->dev) {
+		if (hw->src)
+			dma_free_coherent(hw->dev, hw->size, hw->src,
+					  hw->src_dma);
+		if (hw->dst)
+			dma_free_coherent(hw->dev, hw->size, hw->dst,
+					  hw->dst_dma);
+		put_device(hw->dev);
+	}
+	kfree(hw);
+}
+
+void squashfs_hw_setup(struct squashfs_sb_info *msblk)
+{
+	struct squashfs_hw_stream *hw;
+
+	if (msblk->decompressor->id != ZLIB_COMPRESSION)
+		return;
+
+	hw = kzalloc(sizeof(*hw), GFP_KERNEL);
+	if (hw == NULL)
+		return;
+
+	hw->dev = squashfs_hw_device();
+	if (hw->dev == NULL)
+		goto failed;
+
+	hw->size = msblk->block_size;
+	hw->src = dma_alloc_coherent(hw->dev, hw->size, &hw->src_dma,
+				     GFP_KERNEL);
+	hw->dst = dma_alloc_coherent(hw->dev, hw->size, &hw->dst_dma,
+				     GFP_KERNEL);
+	if (hw->src == NULL || hw->dst == NULL) {
+		WARNING("Failed to allocate hardware decompressor buffers\n");
+		goto failed;
+	}
+
+	msblk->hw_stream = hw;
+	TRACE("zlib blocks are decompressed by %s\n", dev_name(hw->dev));
+	return;
+
+failed:
+	squashfs_hw_free(hw);
+}
+
+void squashfs_hw_destroy(struct squashfs_sb_info *msblk)
+{
+	squashfs_hw_free(msblk->hw_stream);
+	msblk->hw_stream = NULL;
+}
+
+/*
+ * Decompress one zlib block with the hardware decompressor.  Returns the
+ * decompressed length, or a negative error if the block has to be
+ * decompressed on the CPU instead.
+ */
+int squashfs_hw_decompress(struct squashfs_sb_info *msblk, struct bio *bio,
+	int offset, int length, struct squashfs_page_actor *output)
+{
+	struct squashfs_hw_stream *hw = msblk->hw_stream;
+	struct bvec_iter_all iter_all = {};
+	struct bio_vec *bvec = bvec_init_iter_all(&iter_all);
+	int res, bytes = length, pos = 0;
+	u64 out_len = 0;
+	void *page;
+
+	if (hw == NULL || length > hw->size || output->length > hw->size)
+		return -EOPNOTSUPP;
+
+	/* the engine is shared with other users, inflate on the CPU if busy */
+	if (!rk_decom_trylock())
+		return -EBUSY;
+
+	while (bytes && bio_next_segment(bio, &iter_all)) {
+		int avail = min(bytes, ((int)bvec->bv_len) - offset);
+
+		memcpy(hw->src + pos, page_address(bvec->bv_page) +
+		       bvec->bv_offset + offset, avail);
+		pos += avail;
+		bytes -= avail;
+		offset = 0;
+	}
+	if (bytes) {
+		res = -EIO;
+		goto out;
+	}
+
+	res = rk_decom_start(ZLIB_MOD | DECOM_NOBLOCKING, hw->src_dma,
+			     hw->dst_dma, output->length);
+	if (res)
+		goto out;
+
+	res = rk_decom_wait_done(SQUASHFS_HW_TIMEOUT, &out_len);
+	if (res)
+		goto out;
+
+	if (out_len == 0 || out_len > output->length) {
+		res = -EIO;
+		goto out;
+	}
+
+	/* No sleeping from here to squashfs_finish_page() */
+	page = squashfs_first_page(output);
+	for (pos = 0; page && pos < out_len; pos += PAGE_SIZE) {
+		memcpy(page, hw->dst + pos, min_t(int, PAGE_SIZE, out_len - pos));
+		if (pos + PAGE_SIZE < out_len)
+			page = squashfs_next_page(output);
+	}
+	squashfs_finish_page(output);
+	res = out_len;
+
+out:
+	rk_decom_unlock();
+	return res;
+}
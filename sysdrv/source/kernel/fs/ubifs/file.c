@@ -578,6 +578,12 @@ static int ubifs_write_end(struct file *file, struct address_space *mapping,
 	if (appending) {
 		i_size_write(inode, end_pos);
 		ui->ui_size = end_pos;
+		/* Track sequential appends for streaming write-back */
+		if (page->index == ui->last_page_written + 1)
+			ui->written_in_a_row += 1;
+		else if (page->index != ui->last_page_written)
+			ui->written_in_a_row = 1;
+		ui->last_page_written = page->index;
 		/*
 		 * Note, we do not set @I_DIRTY_PAGES (which means that the
 		 * inode has dirty pages), this has been done in
@@ -899,6 +905,31 @@ static int ubifs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+/**
+ * finish_writepage - finish write-back of a page.
+ * @c: UBIFS file-system description object
+ * @page: page which has been written, mapped and under write-back
+ *
+ * This is a helper function which releases the budget of @page, unmaps it
+ * and ends its write-back.
+ */
+static void finish_writepage(struct ubifs_info *c, struct page *page)
+{
+	ubifs_assert(c, PagePrivate(page));
+	if (PageChecked(page))
+		release_new_page_budget(c);
+	else
+		release_existing_page_budget(c);
+
+	atomic_long_dec(&c->dirty_pg_cnt);
+	detach_page_private(page);
+	ClearPageChecked(page);
+
+	kunmap(page);
+	unlock_page(page);
+	end_page_writeback(page);
+}
+
 static int do_writepage(struct page *page, int len)
 {
 	int err = 0, i, blen;
@@ -940,19 +971,7 @@ static int do_writepage(struct page *page, int len)
 		ubifs_ro_mode(c, err);
 	}
 
-	ubifs_assert(c, PagePrivate(page));
-	if (PageChecked(page))
-		release_new_page_budget(c);
-	else
-		release_existing_page_budget(c);
-
-	atomic_long_dec(&c->dirty_pg_cnt);
-	detach_page_private(page);
-	ClearPageChecked(page);
-
-	kunmap(page);
-	unlock_page(page);
-	end_page_writeback(page);
+	finish_writepage(c, page);
 	return err;
 }
 
@@ -1069,6 +1088,138 @@ out_unlock:
 	return err;
 }
 
+/*
+ * Streaming write-back.
+ *
+ * Files which are appended to sequentially, like video segments written by a
+ * recorder, are written back in batches of up to %UBIFS_STREAM_BATCH data
+ * nodes. Every batch is built in one buffer and goes to the data journal head
+ * with a single reservation and write, and the TNC is updated once per write
+ * instead of once per page. Only pages which are fully inside @i_size are
+ * batched, the straddling page goes through 'ubifs_writepage()' as usual.
+ */
+struct ubifs_wb_batch {
+	struct inode *inode;
+	struct page *pages[UBIFS_STREAM_BATCH / UBIFS_BLOCKS_PER_PAGE];
+	int cnt;
+};
+
+/**
+ * write_batch - write the pages collected for streaming write-back.
+ * @b: the batch to write
+ *
+ * The pages are locked and unlocked by this function. Returns zero in case of
+ * success and a negative error code in case of failure.
+ */
+static int write_batch(struct ubifs_wb_batch *b)
+{
+	struct inode *inode = b->inode;
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	int err = -EAGAIN, i, j, cnt = b->cnt, blocks;
+	void *bufs[UBIFS_STREAM_BATCH];
+	unsigned int block;
+	union ubifs_key key;
+
+	if (!cnt)
+		return 0;
+	b->cnt = 0;
+
+	block = b->pages[0]->index << UBIFS_BLOCKS_PER_PAGE_SHIFT;
+	blocks = cnt * UBIFS_BLOCKS_PER_PAGE;
+	for (i = 0; i < cnt; i++) {
+		void *addr;
+
+		set_page_writeback(b->pages[i]);
+		addr = kmap(b->pages[i]);
+		for (j = 0; j < UBIFS_BLOCKS_PER_PAGE; j++)
+			bufs[i * UBIFS_BLOCKS_PER_PAGE + j] =
+				addr + j * UBIFS_BLOCK_SIZE;
+	}
+
+	if (blocks > 1)
+		err = ubifs_jnl_write_data_blocks(c, inode, block, bufs,
+						  blocks);
+	if (err == -EAGAIN) {
+		for (i = 0, err = 0; i < blocks && !err; i++) {
+			data_key_init(c, &key, inode->i_ino, block + i);
+			err = ubifs_jnl_write_data(c, inode, &key, bufs[i],
+						   UBIFS_BLOCK_SIZE);
+		}
+	}
+	if (err) {
+		ubifs_err(c, "cannot write pages %lu-%lu of inode %lu, error %d",
+			  b->pages[0]->index, b->pages[cnt - 1]->index,
+			  inode->i_ino, err);
+		ubifs_ro_mode(c, err);
+	}
+
+	for (i = 0; i < cnt; i++) {
+		if (err)
+			SetPageError(b->pages[i]);
+		finish_writepage(c, b->pages[i]);
+	}
+
+	return err;
+}
+
+static int ubifs_writepage_batch(struct page *page,
+				 struct writeback_control *wbc, void *data)
+{
+	struct ubifs_wb_batch *b = data;
+	struct inode *inode = page->mapping->host;
+	struct ubifs_inode *ui = ubifs_inode(inode);
+	pgoff_t end_index = i_size_read(inode) >> PAGE_SHIFT;
+	loff_t synced_i_size;
+	int err;
+
+	if (b->cnt && (page->index >= end_index ||
+		       b->cnt == ARRAY_SIZE(b->pages) ||
+		       page->index != b->pages[b->cnt - 1]->index + 1)) {
+		err = write_batch(b);
+		if (err) {
+			unlock_page(page);
+			return err;
+		}
+	}
+
+	if (page->index >= end_index)
+		return ubifs_writepage(page, wbc);
+
+	spin_lock(&ui->ui_lock);
+	synced_i_size = ui->synced_i_size;
+	spin_unlock(&ui->ui_lock);
+
+	/* See 'ubifs_writepage()', the inode size must go to flash first */
+	if (page->index >= synced_i_size >> PAGE_SHIFT) {
+		err = inode->i_sb->s_op->write_inode(inode, NULL);
+		if (err) {
+			unlock_page(page);
+			return err;
+		}
+	}
+
+	b->pages[b->cnt++] = page;
+	return 0;
+}
+
+static int ubifs_writepages(struct address_space *mapping,
+			    struct writeback_control *wbc)
+{
+	struct inode *inode = mapping->host;
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	struct ubifs_wb_batch b = { .inode = inode };
+	int err, err1;
+
+	if (!c->stream_write || ubifs_authenticated(c) ||
+	    ubifs_inode(inode)->written_in_a_row < UBIFS_STREAM_MIN_PAGES)
+		return generic_writepages(mapping, wbc);
+
+	err = write_cache_pages(mapping, wbc, ubifs_writepage_batch, &b);
+	err1 = write_batch(&b);
+
+	return err ? err : err1;
+}
+
 /**
  * do_attr_changes - change inode attributes.
  * @inode: inode to change attributes for
@@ -1642,6 +1793,7 @@ static int ubifs_symlink_getattr(const struct path *path, struct kstat *stat,
 const struct address_space_operations ubifs_file_address_operations = {
 	.readpage       = ubifs_readpage,
 	.writepage      = ubifs_writepage,
+	.writepages     = ubifs_writepages,
 	.write_begin    = ubifs_write_begin,
 	.write_end      = ubifs_write_end,
 	.invalidatepage = ubifs_invalidatepage,
@@ -829,6 +829,138 @@ out_free:
 	return err;
 }
 
+/**
+ * ubifs_jnl_write_data_blocks - write consecutive data blocks to the journal.
+ * @c: UBIFS file-system description object
+ * @inode: inode the data nodes belong to
+ * @block: number of the first block
+ * @bufs: data of each block, %UBIFS_BLOCK_SIZE bytes each
+ * @cnt: how many blocks to write, at most %UBIFS_STREAM_BATCH
+ *
+ * This function is the batched version of 'ubifs_jnl_write_data()' used for
+ * streaming write-back. All data nodes are built in @c->stream_buf first and
+ * then written to the data head with as few reservations as possible: one
+ * write covers every node which still fits into the current head LEB. The TNC
+ * is updated after each such write instead of after each node. This function
+ * must not be used on authenticated file-systems, where every write to a
+ * journal head has to be followed by an authentication node. Returns zero in
+ * case of success, %-EAGAIN if streaming write-back has been disabled in the
+ * meantime and nothing was written, and other negative error codes in case of
+ * failure.
+ */
+int ubifs_jnl_write_data_blocks(struct ubifs_info *c, const struct inode *inode,
+				unsigned int block, void * const *bufs, int cnt)
+{
+	struct ubifs_wbuf *wbuf = &c->jheads[DATAHD].wbuf;
+	struct ubifs_inode *ui = ubifs_inode(inode);
+	bool encrypted = IS_ENCRYPTED(inode);
+	int node_offs[UBIFS_STREAM_BATCH + 1], node_len[UBIFS_STREAM_BATCH];
+	int err = 0, i, n, lnum, offs, avail, len, compr_type, compr_len, out_len;
+	struct ubifs_data_node *data;
+	union ubifs_key key;
+	u8 hash[UBIFS_HASH_ARR_SZ];
+
+	ubifs_assert(c, cnt > 0 && cnt <= UBIFS_STREAM_BATCH);
+	ubifs_assert(c, !ubifs_authenticated(c));
+	dbg_jnl("ino %lu, blk %u, cnt %d", inode->i_ino, block, cnt);
+
+	mutex_lock(&c->stream_mutex);
+	if (!c->stream_buf) {
+		/* Streaming write-back was disabled by a re-mount */
+		err = -EAGAIN;
+		goto out_unlock;
+	}
+
+	if (!(ui->flags & UBIFS_COMPR_FL))
+		compr_type = UBIFS_COMPR_NONE;
+	else
+		compr_type = ui->compr_type;
+
+	node_offs[0] = 0;
+	for (i = 0; i < cnt; i++) {
+		int type = compr_type;
+
+		data = c->stream_buf + node_offs[i];
+		data->ch.node_type = UBIFS_DATA_NODE;
+		data_key_init(c, &key, inode->i_ino, block + i);
+		key_write(c, &key, &data->key);
+		data->size = cpu_to_le32(UBIFS_BLOCK_SIZE);
+
+		out_len = compr_len = COMPRESSED_DATA_NODE_BUF_SZ +
+				      UBIFS_CIPHER_BLOCK_SIZE - UBIFS_DATA_NODE_SZ;
+		ubifs_compress(c, bufs[i], UBIFS_BLOCK_SIZE, &data->data,
+			       &compr_len, &type);
+		ubifs_assert(c, compr_len <= UBIFS_BLOCK_SIZE);
+
+		if (encrypted) {
+			err = ubifs_encrypt(inode, data, compr_len, &out_len,
+					    block + i);
+			if (err)
+				goto out_unlock;
+		} else {
+			data->compr_size = 0;
+			out_len = compr_len;
+		}
+
+		data->compr_type = cpu_to_le16(type);
+		node_len[i] = UBIFS_DATA_NODE_SZ + out_len;
+		ubifs_prepare_node(c, data, node_len[i], 0);
+
+		/* Nodes start 8-byte aligned, zero the gap to the next one */
+		node_offs[i + 1] = node_offs[i] + ALIGN(node_len[i], 8);
+		memset((void *)data + node_len[i], 0,
+		       node_offs[i + 1] - node_offs[i] - node_len[i]);
+	}
+
+	for (i = 0; i < cnt; i = n) {
+		err = make_reservation(c, DATAHD, node_len[i]);
+		if (err)
+			goto out_unlock;
+
+		/* Take every following node which fits into this head LEB */
+		avail = c->leb_size - wbuf->offs - wbuf->used;
+		for (n = i + 1; n < cnt; n++)
+			if (node_offs[n + 1] - node_offs[i] > avail)
+				break;
+		len = node_offs[n - 1] - node_offs[i] + node_len[n - 1];
+
+		err = write_head(c, DATAHD, c->stream_buf + node_offs[i], len,
+				 &lnum, &offs, 0);
+		if (err)
+			goto out_release;
+
+		ubifs_wbuf_add_ino_nolock(wbuf, inode->i_ino);
+		release_head(c, DATAHD);
+
+		for (; i < n; i++) {
+			data = c->stream_buf + node_offs[i];
+			err = ubifs_node_calc_hash(c, data, hash);
+			if (!err) {
+				key_read(c, &data->key, &key);
+				err = ubifs_tnc_add(c, &key, lnum, offs, node_len[i],
+						    hash);
+			}
+			if (err)
+				goto out_ro;
+			offs += ALIGN(node_len[i], 8);
+		}
+
+		finish_reservation(c);
+	}
+
+	mutex_unlock(&c->stream_mutex);
+	return 0;
+
+out_release:
+	release_head(c, DATAHD);
+out_ro:
+	ubifs_ro_mode(c, err);
+	finish_reservation(c);
+out_unlock:
+	mutex_unlock(&c->stream_mutex);
+	return err;
+}
+
 /**
  * ubifs_jnl_write_inode - flush inode to the journal.
  * @c: UBIFS file-system description object
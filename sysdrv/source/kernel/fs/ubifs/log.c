@@ -214,7 +214,8 @@ int ubifs_add_bud_to_log(struct ubifs_info *c, int jhead, int lnum, int offs)
 	 * OK to read 'c->cmt_state' without spinlock because integer reads
 	 * are atomic in the kernel.
 	 */
-	if (c->bud_bytes >= c->bg_bud_bytes &&
+	if (c->bud_bytes >= (c->stream_write ? c->stream_bud_bytes :
+					       c->bg_bud_bytes) &&
 	    c->cmt_state == COMMIT_RESTING) {
 		dbg_log("bud bytes %lld (%lld max), initiate BG commit",
 			c->bud_bytes, c->max_bud_bytes);
@@ -448,6 +448,11 @@ static int ubifs_show_options(struct seq_file *s, struct dentry *root)
 	else if (c->mount_opts.bulk_read == 1)
 		seq_puts(s, ",no_bulk_read");
 
+	if (c->mount_opts.stream_write == 2)
+		seq_puts(s, ",stream_write");
+	else if (c->mount_opts.stream_write == 1)
+		seq_puts(s, ",no_stream_write");
+
 	if (c->mount_opts.chk_data_crc == 2)
 		seq_puts(s, ",chk_data_crc");
 	else if (c->mount_opts.chk_data_crc == 1)
@@ -747,6 +752,18 @@ static int init_constants_sb(struct ubifs_info *c)
 	if (c->max_bud_bytes < tmp64 + c->leb_size)
 		c->max_bud_bytes = tmp64 + c->leb_size;
 
+	/*
+	 * Streaming writers fill the journal with data nodes whose index
+	 * changes are all at the end of the same files, so every commit costs
+	 * about the same index writes no matter how much was written. Let the
+	 * journal get fuller before committing, but still leave two LEBs
+	 * for the background commit to finish before writers get blocked.
+	 */
+	c->stream_bud_bytes = min_t(long long, (c->max_bud_bytes * 15) >> 4,
+				    c->max_bud_bytes - 2 * c->leb_size);
+	if (c->stream_bud_bytes < c->bg_bud_bytes)
+		c->stream_bud_bytes = c->bg_bud_bytes;
+
 	err = ubifs_calc_lpt_geom(c);
 	if (err)
 		return err;
@@ -954,6 +971,8 @@ static int check_volume_empty(struct ubifs_info *c)
  * Opt_norm_unmount: run a journal commit before un-mounting
  * Opt_bulk_read: enable bulk-reads
  * Opt_no_bulk_read: disable bulk-reads
+ * Opt_stream_write: enable streaming write-back
+ * Opt_no_stream_write: disable streaming write-back
  * Opt_chk_data_crc: check CRCs when reading data nodes
  * Opt_no_chk_data_crc: do not check CRCs when reading data nodes
  * Opt_override_compr: override default compressor
@@ -967,6 +986,8 @@ enum {
 	Opt_norm_unmount,
 	Opt_bulk_read,
 	Opt_no_bulk_read,
+	Opt_stream_write,
+	Opt_no_stream_write,
 	Opt_chk_data_crc,
 	Opt_no_chk_data_crc,
 	Opt_override_compr,
@@ -982,6 +1003,8 @@ static const match_table_t tokens = {
 	{Opt_norm_unmount, "norm_unmount"},
 	{Opt_bulk_read, "bulk_read"},
 	{Opt_no_bulk_read, "no_bulk_read"},
+	{Opt_stream_write, "stream_write"},
+	{Opt_no_stream_write, "no_stream_write"},
 	{Opt_chk_data_crc, "chk_data_crc"},
 	{Opt_no_chk_data_crc, "no_chk_data_crc"},
 	{Opt_override_compr, "compr=%s"},
@@ -1060,6 +1083,14 @@ static int ubifs_parse_options(struct ubifs_info *c, char *options,
 			c->mount_opts.bulk_read = 1;
 			c->bulk_read = 0;
 			break;
+		case Opt_stream_write:
+			c->mount_opts.stream_write = 2;
+			c->stream_write = 1;
+			break;
+		case Opt_no_stream_write:
+			c->mount_opts.stream_write = 1;
+			c->stream_write = 0;
+			break;
 		case Opt_chk_data_crc:
 			c->mount_opts.chk_data_crc = 2;
 			c->no_chk_data_crc = 0;
@@ -1220,6 +1251,28 @@ again:
 	}
 }
 
+/**
+ * stream_init - initialize streaming write-back.
+ * @c: UBIFS file-system description object
+ */
+static void stream_init(struct ubifs_info *c)
+{
+	ubifs_assert(c, c->stream_write == 1);
+
+	if (c->stream_buf)
+		return; /* Already initialized */
+
+	c->stream_buf = vmalloc(UBIFS_STREAM_BUF_SZ);
+	if (c->stream_buf)
+		return;
+
+	/* Just disable streaming write-back */
+	ubifs_warn(c, "cannot allocate %d bytes of memory for streaming write-back, disabling it",
+		   (int)UBIFS_STREAM_BUF_SZ);
+	c->mount_opts.stream_write = 1;
+	c->stream_write = 0;
+}
+
 /**
  * check_free_space - check if there is enough free space to mount.
  * @c: UBIFS file-system description object
@@ -1309,6 +1362,11 @@ static int mount_ubifs(struct ubifs_info *c)
 	if (c->bulk_read == 1)
 		bu_init(c);
 
+	if (c->stream_write == 1)
+		stream_init(c);
+
+	ubifs_dc_init(c);
+
 	if (!c->ro_mount) {
 		c->write_reserve_buf = kmalloc(COMPRESSED_DATA_NODE_BUF_SZ + \
 					       UBIFS_CIPHER_BLOCK_SIZE,
@@ -1637,6 +1695,8 @@ out_auth:
 out_free:
 	kfree(c->write_reserve_buf);
 	kfree(c->bu.buf);
+	vfree(c->stream_buf);
+	ubifs_dc_free(c);
 	vfree(c->ileb_buf);
 	vfree(c->sbuf);
 	kfree(c->bottom_up_buf);
@@ -1679,6 +1739,8 @@ static void ubifs_umount(struct ubifs_info *c)
 	kfree(c->mst_node);
 	kfree(c->write_reserve_buf);
 	kfree(c->bu.buf);
+	vfree(c->stream_buf);
+	ubifs_dc_free(c);
 	vfree(c->ileb_buf);
 	vfree(c->sbuf);
 	kfree(c->bottom_up_buf);
@@ -2034,6 +2096,16 @@ static int ubifs_remount_fs(struct super_block *sb, int *flags, char *data)
 		mutex_unlock(&c->bu_mutex);
 	}
 
+	if (c->stream_write == 1)
+		stream_init(c);
+	else {
+		dbg_gen("disable streaming write-back");
+		mutex_lock(&c->stream_mutex);
+		vfree(c->stream_buf);
+		c->stream_buf = NULL;
+		mutex_unlock(&c->stream_mutex);
+	}
+
 	if (!c->need_recovery)
 		ubifs_assert(c, c->lst.taken_empty_lebs > 0);
 
@@ -2136,6 +2208,7 @@ static struct ubifs_info *alloc_ubifs_info(struct ubi_volume_desc *ubi)
 		mutex_init(&c->log_mutex);
 		mutex_init(&c->umount_mutex);
 		mutex_init(&c->bu_mutex);
+		mutex_init(&c->stream_mutex);
 		mutex_init(&c->write_reserve_mutex);
 		init_waitqueue_head(&c->cmt_wq);
 		c->buds = RB_ROOT;
@@ -1465,6 +1465,8 @@ again:
 		 * address of the zbranch and keep the mutex locked
 		 */
 		err = tnc_read_hashed_node(c, zt, node);
+		if (!err)
+			ubifs_dc_add(c, key, node);
 		goto out;
 	}
 	if (safely) {
@@ -1834,6 +1836,8 @@ static int do_lookup_nm(struct ubifs_info *c, const union ubifs_key *key,
 	}
 
 	err = tnc_read_hashed_node(c, &znode->zbranch[n], node);
+	if (!err)
+		ubifs_dc_add(c, key, node);
 
 out_unlock:
 	mutex_unlock(&c->tnc_mutex);
@@ -1859,6 +1863,10 @@ int ubifs_tnc_lookup_nm(struct ubifs_info *c, const union ubifs_key *key,
 	int err, len;
 	const struct ubifs_dent_node *dent = node;
 
+	/* Recently looked up or listed entries do not need the TNC mutex */
+	if (!ubifs_dc_lookup(c, key, node, nm))
+		return 0;
+
 	/*
 	 * We assume that in most of the cases there are no name collisions and
 	 * 'ubifs_tnc_lookup()' returns us the right direntry.
@@ -2278,6 +2286,8 @@ int ubifs_tnc_add(struct ubifs_info *c, const union ubifs_key *key, int lnum,
 
 	mutex_lock(&c->tnc_mutex);
 	dbg_tnck(key, "%d:%d, len %d, key ", lnum, offs, len);
+	if (is_hash_key(c, key))
+		ubifs_dc_remove(c, key);
 	found = lookup_level0_dirty(c, key, &znode, &n);
 	if (!found) {
 		struct ubifs_zbranch zbr;
@@ -2414,6 +2424,7 @@ int ubifs_tnc_add_nm(struct ubifs_info *c, const union ubifs_key *key,
 
 	mutex_lock(&c->tnc_mutex);
 	dbg_tnck(key, "LEB %d:%d, key ", lnum, offs);
+	ubifs_dc_remove(c, key);
 	found = lookup_level0_dirty(c, key, &znode, &n);
 	if (found < 0) {
 		err = found;
@@ -2619,6 +2630,8 @@ int ubifs_tnc_remove(struct ubifs_info *c, const union ubifs_key *key)
 
 	mutex_lock(&c->tnc_mutex);
 	dbg_tnck(key, "key ");
+	if (is_hash_key(c, key))
+		ubifs_dc_remove(c, key);
 	found = lookup_level0_dirty(c, key, &znode, &n);
 	if (found < 0) {
 		err = found;
@@ -2650,6 +2663,7 @@ int ubifs_tnc_remove_nm(struct ubifs_info *c, const union ubifs_key *key,
 
 	mutex_lock(&c->tnc_mutex);
 	dbg_tnck(key, "key ");
+	ubifs_dc_remove(c, key);
 	err = lookup_level0_dirty(c, key, &znode, &n);
 	if (err < 0)
 		goto out_unlock;
@@ -2703,6 +2717,7 @@ int ubifs_tnc_remove_dh(struct ubifs_info *c, const union ubifs_key *key,
 		return -EOPNOTSUPP;
 
 	mutex_lock(&c->tnc_mutex);
+	ubifs_dc_remove(c, key);
 	err = lookup_level0_dirty(c, key, &znode, &n);
 	if (err <= 0)
 		goto out_unlock;
@@ -2788,6 +2803,10 @@ int ubifs_tnc_remove_range(struct ubifs_info *c, union ubifs_key *from_key,
 	union ubifs_key *key;
 
 	mutex_lock(&c->tnc_mutex);
+	/* Truncation only removes data nodes, which are never cached */
+	if (key_type(c, from_key) != UBIFS_DATA_KEY ||
+	    key_type(c, to_key) != UBIFS_DATA_KEY)
+		ubifs_dc_remove_ino(c, key_inum(c, from_key));
 	while (1) {
 		/* Find first level 0 znode that contains keys to remove */
 		err = ubifs_lookup_level0(c, from_key, &znode, &n);
@@ -3023,6 +3042,8 @@ struct ubifs_dent_node *ubifs_tnc_next_ent(struct ubifs_info *c,
 	if (unlikely(err))
 		goto out_free;
 
+	/* Listing a directory is usually followed by looking its entries up */
+	ubifs_dc_add(c, dkey, dent);
 	mutex_unlock(&c->tnc_mutex);
 	return dent;
 
@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * This file is part of UBIFS.
+ *
+ * Copyright (C) 2023 Rockchip Electronics Co., Ltd.
+ */
+
+/*
+ * This file implements the directory entry cache, a small read-mostly cache
+ * of directory and extended attribute entry nodes which sits in front of the
+ * TNC for 'ubifs_tnc_lookup_nm()'.
+ *
+ * Every TNC lookup takes @c->tnc_mutex, so concurrent lookups in the same big
+ * directory serialize on it even when all the entries are in the leaf node
+ * cache. Cache hits here only take the RCU read lock.
+ *
+ * Entries are added and removed with @c->tnc_mutex held, in the same critical
+ * section which reads or changes the TNC, so the cache never returns an entry
+ * which is not in the TNC any more. Lookups which found an entry and
+ * 'ubifs_tnc_next_ent()' (readdir) add entries, every TNC change of a "hashed"
+ * key removes all entries with that key. A small fixed number of entries is
+ * kept per bucket, the oldest one is dropped when a bucket is full.
+ */
+
+#include <linux/hash.h>
+#include <linux/rculist.h>
+#include "ubifs.h"
+
+static struct ubifs_dc_bucket *dc_bucket(const struct ubifs_info *c,
+					 const union ubifs_key *key)
+{
+	u32 h = (u32)key_inum(c, key) ^ key_hash(c, key);
+
+	return &c->dc[hash_32(h, UBIFS_DC_BITS)];
+}
+
+static bool dc_name_eq(const struct ubifs_dent_node *dent, const char *name,
+		       int len)
+{
+	return le16_to_cpu(dent->nlen) == len && !memcmp(dent->name, name, len);
+}
+
+/**
+ * ubifs_dc_init - initialize the directory entry cache.
+ * @c: UBIFS file-system description object
+ *
+ * The cache is an optimization only, UBIFS works without it if there is no
+ * memory for the buckets.
+ */
+void ubifs_dc_init(struct ubifs_info *c)
+{
+	int i;
+
+	c->dc = kcalloc(UBIFS_DC_BUCKETS, sizeof(struct ubifs_dc_bucket),
+			GFP_KERNEL);
+	if (!c->dc) {
+		ubifs_warn(c, "cannot allocate directory entry cache, disabling it");
+		return;
+	}
+
+	for (i = 0; i < UBIFS_DC_BUCKETS; i++) {
+		spin_lock_init(&c->dc[i].lock);
+		INIT_HLIST_HEAD(&c->dc[i].head);
+	}
+}
+
+/**
+ * ubifs_dc_free - free the directory entry cache.
+ * @c: UBIFS file-system description object
+ */
+void ubifs_dc_free(struct ubifs_info *c)
+{
+	struct ubifs_dc_entry *e;
+	struct hlist_node *tmp;
+	int i;
+
+	if (!c->dc)
+		return;
+
+	for (i = 0; i < UBIFS_DC_BUCKETS; i++)
+		hlist_for_each_entry_safe(e, tmp, &c->dc[i].head, list) {
+			hlist_del(&e->list);
+			kfree(e);
+		}
+
+	kfree(c->dc);
+	c->dc = NULL;
+}
+
+/**
+ * ubifs_dc_lookup - look up a directory entry in the cache.
+ * @c: UBIFS file-system description object
+ * @key: key of the entry
+ * @node: the entry node is copied here
+ * @nm: name of the entry
+ *
+ * Returns zero if the entry was found and %-ENOENT otherwise.
+ */
+int ubifs_dc_lookup(struct ubifs_info *c, const union ubifs_key *key,
+		    void *node, const struct fscrypt_name *nm)
+{
+	struct ubifs_dc_bucket *b;
+	struct ubifs_dc_entry *e;
+	int err = -ENOENT;
+
+	if (!c->dc)
+		return err;
+
+	b = dc_bucket(c, key);
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(e, &b->head, list) {
+		if (!keys_eq(c, &e->key, key) ||
+		    !dc_name_eq((void *)e->node, fname_name(nm), fname_len(nm)))
+			continue;
+
+		memcpy(node, e->node, e->len);
+		err = 0;
+		break;
+	}
+	rcu_read_unlock();
+
+	return err;
+}
+
+/**
+ * ubifs_dc_add - add a directory entry to the cache.
+ * @c: UBIFS file-system description object
+ * @key: key of the entry
+ * @node: the entry node read from the TNC
+ *
+ * Replaces a cached entry with the same key and name. Must be called with
+ * @c->tnc_mutex held.
+ */
+void ubifs_dc_add(struct ubifs_info *c, const union ubifs_key *key,
+		  const void *node)
+{
+	const struct ubifs_dent_node *dent = node;
+	struct ubifs_dc_entry *e, *old, *last = NULL;
+	struct ubifs_dc_bucket *b;
+	int len = le32_to_cpu(dent->ch.len);
+
+	ubifs_assert(c, mutex_is_locked(&c->tnc_mutex));
+	ubifs_assert(c, is_hash_key(c, key));
+	if (!c->dc || c->replaying)
+		return;
+
+	e = kmalloc(sizeof(struct ubifs_dc_entry) + len,
+		    GFP_NOFS | __GFP_NOWARN);
+	if (!e)
+		return;
+	key_copy(c, key, &e->key);
+	e->len = len;
+	memcpy(e->node, node, len);
+
+	b = dc_bucket(c, key);
+	spin_lock(&b->lock);
+	hlist_for_each_entry(old, &b->head, list) {
+		if (keys_eq(c, &old->key, key) &&
+		    dc_name_eq((void *)old->node, dent->name,
+			       le16_to_cpu(dent->nlen))) {
+			hlist_replace_rcu(&old->list, &e->list);
+			kfree_rcu(old, rcu);
+			goto out_unlock;
+		}
+		last = old;
+	}
+
+	if (b->cnt >= UBIFS_DC_BUCKET_LEN) {
+		hlist_del_rcu(&last->list);
+		kfree_rcu(last, rcu);
+	} else
+		b->cnt += 1;
+	hlist_add_head_rcu(&e->list, &b->head);
+
+out_unlock:
+	spin_unlock(&b->lock);
+}
+
+/**
+ * ubifs_dc_remove - remove directory entries from the cache.
+ * @c: UBIFS file-system description object
+ * @key: key of the entries to remove
+ *
+ * Removes all cached entries with key @key, whatever their names are. Must be
+ * called with @c->tnc_mutex held.
+ */
+void ubifs_dc_remove(struct ubifs_info *c, const union ubifs_key *key)
+{
+	struct ubifs_dc_bucket *b;
+	struct ubifs_dc_entry *e;
+	struct hlist_node *tmp;
+
+	if (!c->dc)
+		return;
+
+	b = dc_bucket(c, key);
+	spin_lock(&b->lock);
+	hlist_for_each_entry_safe(e, tmp, &b->head, list) {
+		if (!keys_eq(c, &e->key, key))
+			continue;
+		hlist_del_rcu(&e->list);
+		kfree_rcu(e, rcu);
+		b->cnt -= 1;
+	}
+	spin_unlock(&b->lock);
+}
+
+/**
+ * ubifs_dc_remove_ino - remove all entries of an inode from the cache.
+ * @c: UBIFS file-system description object
+ * @inum: directory or extended attribute host inode number
+ *
+ * Must be called with @c->tnc_mutex held.
+ */
+void ubifs_dc_remove_ino(struct ubifs_info *c, ino_t inum)
+{
+	struct ubifs_dc_entry *e;
+	struct hlist_node *tmp;
+	int i;
+
+	if (!c->dc)
+		return;
+
+	for (i = 0; i < UBIFS_DC_BUCKETS; i++) {
+		struct ubifs_dc_bucket *b = &c->dc[i];
+
+		spin_lock(&b->lock);
+		hlist_for_each_entry_safe(e, tmp, &b->head, list) {
+			if (key_inum(c, &e->key) != inum)
+				continue;
+			hlist_del_rcu(&e->list);
+			kfree_rcu(e, rcu);
+			b->cnt -= 1;
+		}
+		spin_unlock(&b->lock);
+	}
+}
@@ -147,6 +147,27 @@
 /* Maximum number of data nodes to bulk-read */
 #define UBIFS_MAX_BULK_READ 32
 
+/* Directory entry cache geometry: number of buckets and entries per bucket */
+#define UBIFS_DC_BITS 8
+#define UBIFS_DC_BUCKETS (1 << UBIFS_DC_BITS)
+#define UBIFS_DC_BUCKET_LEN 8
+
+/* Maximum number of data nodes written by one streaming write-back batch */
+#define UBIFS_STREAM_BATCH 32
+
+/* How many pages have to be appended in a row before streaming write-back */
+#define UBIFS_STREAM_MIN_PAGES ((1024 * 1024) >> PAGE_SHIFT)
+
+/*
+ * Streaming write-back buffer size. Nodes are compressed in place one after
+ * the other, so only the last slot needs the worst case compressor room.
+ */
+#define UBIFS_STREAM_NODE_SZ \
+	ALIGN(UBIFS_MAX_DATA_NODE_SZ + UBIFS_CIPHER_BLOCK_SIZE, 8)
+#define UBIFS_STREAM_BUF_SZ \
+	((UBIFS_STREAM_BATCH - 1) * UBIFS_STREAM_NODE_SZ + \
+	 COMPRESSED_DATA_NODE_BUF_SZ + UBIFS_CIPHER_BLOCK_SIZE)
+
 #ifdef CONFIG_UBIFS_FS_AUTHENTICATION
 #define UBIFS_HASH_ARR_SZ UBIFS_MAX_HASH_LEN
 #define UBIFS_HMAC_ARR_SZ UBIFS_MAX_HMAC_LEN
@@ -366,6 +387,10 @@ struct ubifs_gced_idx_leb {
  * @compr_type: default compression type used for this inode
  * @last_page_read: page number of last page read (for bulk read)
  * @read_in_a_row: number of consecutive pages read in a row (for bulk read)
+ * @last_page_written: page number of last page appended (for streaming
+ *                     write-back)
+ * @written_in_a_row: number of consecutive pages appended in a row (for
+ *                    streaming write-back)
  * @data_len: length of the data attached to the inode
  * @data: inode's data
  *
@@ -417,6 +442,8 @@ struct ubifs_inode {
 	int flags;
 	pgoff_t last_page_read;
 	pgoff_t read_in_a_row;
+	pgoff_t last_page_written;
+	pgoff_t written_in_a_row;
 	int data_len;
 	void *data;
 };
@@ -813,6 +840,34 @@ struct bu_info {
 	int eof;
 };
 
+/**
+ * struct ubifs_dc_entry - directory entry cache entry.
+ * @list: link in the bucket list
+ * @rcu: RCU head used to free the entry
+ * @key: key of the directory or extended attribute entry
+ * @len: length of @node
+ * @node: copy of the directory or extended attribute entry node
+ */
+struct ubifs_dc_entry {
+	struct hlist_node list;
+	struct rcu_head rcu;
+	union ubifs_key key;
+	int len;
+	u8 node[];
+};
+
+/**
+ * struct ubifs_dc_bucket - directory entry cache bucket.
+ * @lock: serializes changes of the bucket, lookups only take RCU
+ * @cnt: number of entries in the bucket
+ * @head: list of entries, most recently added first
+ */
+struct ubifs_dc_bucket {
+	spinlock_t lock;
+	int cnt;
+	struct hlist_head head;
+};
+
 /**
  * struct ubifs_node_range - node length range description data structure.
  * @len: fixed node length
@@ -940,6 +995,8 @@ struct ubifs_orphan {
  * struct ubifs_mount_opts - UBIFS-specific mount options information.
  * @unmount_mode: selected unmount mode (%0 default, %1 normal, %2 fast)
  * @bulk_read: enable/disable bulk-reads (%0 default, %1 disable, %2 enable)
+ * @stream_write: enable/disable streaming write-back (%0 default, %1 disable,
+ *                %2 enable)
  * @chk_data_crc: enable/disable CRC data checking when reading data nodes
  *                (%0 default, %1 disable, %2 enable)
  * @override_compr: override default compressor (%0 - do not override and use
@@ -951,6 +1008,7 @@ struct ubifs_orphan {
 struct ubifs_mount_opts {
 	unsigned int unmount_mode:2;
 	unsigned int bulk_read:2;
+	unsigned int stream_write:2;
 	unsigned int chk_data_crc:2;
 	unsigned int override_compr:1;
 	unsigned int compr_type:2;
@@ -1024,6 +1082,7 @@ struct ubifs_debug_info;
  * @jheads: journal heads (head zero is base head)
  * @max_bud_bytes: maximum number of bytes allowed in buds
  * @bg_bud_bytes: number of bud bytes when background commit is initiated
+ * @stream_bud_bytes: @bg_bud_bytes used when streaming write-back is enabled
  * @old_buds: buds to be released after commit ends
  * @max_bud_cnt: maximum number of buds
  *
@@ -1039,6 +1098,7 @@ struct ubifs_debug_info;
  * @no_chk_data_crc: do not check CRCs when reading data nodes (except during
  *                   recovery)
  * @bulk_read: enable bulk-reads
+ * @stream_write: batch appended data of streamed files at write-back
  * @default_compr: default compression algorithm (%UBIFS_COMPR_LZO, etc)
  * @rw_incompat: the media is not R/W compatible
  * @assert_action: action to take when a ubifs_assert() fails
@@ -1068,11 +1128,17 @@ struct ubifs_debug_info;
  * @bu_mutex: protects the pre-allocated bulk-read buffer and @c->bu
  * @bu: pre-allocated bulk-read information
  *
+ * @dc: directory entry cache buckets, %NULL if the cache is not used
+ *
  * @write_reserve_mutex: protects @write_reserve_buf
  * @write_reserve_buf: on the write path we allocate memory, which might
  *                     sometimes be unavailable, in which case we use this
  *                     write reserve buffer
  *
+ * @stream_mutex: protects @stream_buf
+ * @stream_buf: buffer the data nodes of a streaming write-back batch are
+ *              built in
+ *
  * @log_lebs: number of logical eraseblocks in the log
  * @log_bytes: log size in bytes
  * @log_last: last LEB of the log
@@ -1278,6 +1344,7 @@ struct ubifs_info {
 	struct ubifs_jhead *jheads;
 	long long max_bud_bytes;
 	long long bg_bud_bytes;
+	long long stream_bud_bytes;
 	struct list_head old_buds;
 	int max_bud_cnt;
 
@@ -1292,6 +1359,7 @@ struct ubifs_info {
 	unsigned int encrypted:1;
 	unsigned int no_chk_data_crc:1;
 	unsigned int bulk_read:1;
+	unsigned int stream_write:1;
 	unsigned int default_compr:2;
 	unsigned int rw_incompat:1;
 	unsigned int assert_action:2;
@@ -1321,9 +1389,14 @@ struct ubifs_info {
 	struct mutex bu_mutex;
 	struct bu_info bu;
 
+	struct ubifs_dc_bucket *dc;
+
 	struct mutex write_reserve_mutex;
 	void *write_reserve_buf;
 
+	struct mutex stream_mutex;
+	void *stream_buf;
+
 	int log_lebs;
 	long long log_bytes;
 	int log_last;
@@ -1768,6 +1841,8 @@ int ubifs_jnl_update(struct ubifs_info *c, const struct inode *dir,
 		     int deletion, int xent);
 int ubifs_jnl_write_data(struct ubifs_info *c, const struct inode *inode,
 			 const union ubifs_key *key, const void *buf, int len);
+int ubifs_jnl_write_data_blocks(struct ubifs_info *c, const struct inode *inode,
+				unsigned int block, void * const *bufs, int cnt);
 int ubifs_jnl_write_inode(struct ubifs_info *c, const struct inode *inode);
 int ubifs_jnl_delete_inode(struct ubifs_info *c, const struct inode *inode);
 int ubifs_jnl_xrename(struct ubifs_info *c, const struct inode *fst_dir,
@@ -1875,6 +1950,16 @@ struct ubifs_znode *ubifs_load_znode(struct ubifs_info *c,
 int ubifs_tnc_read_node(struct ubifs_info *c, struct ubifs_zbranch *zbr,
 			void *node);
 
+/* tnc_cache.c */
+void ubifs_dc_init(struct ubifs_info *c);
+void ubifs_dc_free(struct ubifs_info *c);
+int ubifs_dc_lookup(struct ubifs_info *c, const union ubifs_key *key,
+		    void *node, const struct fscrypt_name *nm);
+void ubifs_dc_add(struct ubifs_info *c, const union ubifs_key *key,
+		  const void *node);
+void ubifs_dc_remove(struct ubifs_info *c, const union ubifs_key *key);
+void ubifs_dc_remove_ino(struct ubifs_info *c, ino_t inum);
+
 /* tnc_commit.c */
 int ubifs_tnc_start_commit(struct ubifs_info *c, struct ubifs_zbranch *zroot);
 int ubifs_tnc_end_commit(struct ubifs_info *c);
@@ -7,6 +7,8 @@
 
 #include <linux/dma-buf.h>
 
+struct seq_file;
+
 extern void dma_buf_cache_detach(struct dma_buf *dmabuf,
 				 struct dma_buf_attachment *attach);
 
@@ -21,6 +23,8 @@ extern struct sg_table *
 dma_buf_cache_map_attachment(struct dma_buf_attachment *attach,
 			     enum dma_data_direction direction);
 
+extern void dma_buf_cache_show(struct seq_file *s);
+
 #ifdef CONFIG_DMABUF_CACHE
 /* Replace dma-buf apis to cached apis */
 #define dma_buf_attach dma_buf_cache_attach
@@ -307,6 +307,9 @@ struct gpio_irq_chip {
  *	packed config format as generic pinconf.
  * @to_irq: optional hook supporting non-static gpio_to_irq() mappings;
  *	implementation may not sleep
+ * @get_event_time: optional hook returning the CLOCK_MONOTONIC time in ns
+ *	at which the chip latched the edge being handled on "offset", or 0 if
+ *	unknown; only called from the hardirq handler of the line's IRQ
  * @dbg_show: optional routine to show contents in debugfs; default code
  *	will be used when this is omitted, but custom code can show extra
  *	state (such as pullup/pulldown configuration).
@@ -397,6 +400,8 @@ struct gpio_chip {
 					      unsigned long config);
 	int			(*to_irq)(struct gpio_chip *gc,
 						unsigned int offset);
+	u64			(*get_event_time)(struct gpio_chip *gc,
+						  unsigned int offset);
 
 	void			(*dbg_show)(struct seq_file *s,
 						struct gpio_chip *gc);
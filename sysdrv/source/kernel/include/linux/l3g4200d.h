@@ -50,6 +50,7 @@
 #define L3G4200D_IOCTL_SET_ENABLE _IOW(L3G4200D_IOCTL_BASE, 2, int)
 #define L3G4200D_IOCTL_GET_ENABLE _IOR(L3G4200D_IOCTL_BASE, 3, int)
 #define L3G4200D_IOCTL_GET_CALIBRATION _IOR(L3G4200D_IOCTL_BASE, 4, int[3])
+#define L3G4200D_IOCTL_SET_BATCH _IOW(L3G4200D_IOCTL_BASE, 5, struct sensor_batch_config)
 
 #define L3G4200D_FS_250DPS	0x00
 #define L3G4200D_FS_500DPS	0x10
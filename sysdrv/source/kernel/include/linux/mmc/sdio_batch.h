@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ *  include/linux/mmc/sdio_batch.h
+ *
+ *  Batched SDIO FIFO transfers for network function drivers
+ */
+
+#ifndef LINUX_MMC_SDIO_BATCH_H
+#define LINUX_MMC_SDIO_BATCH_H
+
+struct scatterlist;
+struct sdio_func;
+struct sk_buff_head;
+
+extern int sdio_writesb_sg(struct sdio_func *func, unsigned int addr,
+	struct scatterlist *sgl, unsigned int nents, unsigned int count);
+extern int sdio_writesb_skbs(struct sdio_func *func, unsigned int addr,
+	struct sk_buff_head *list);
+
+#endif /* LINUX_MMC_SDIO_BATCH_H */
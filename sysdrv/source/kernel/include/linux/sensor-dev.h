@@ -20,6 +20,7 @@
 #endif
 
 #include <dt-bindings/sensor-dev.h>
+#include <linux/kfifo.h>
 #include <linux/module.h>
 
 #define SENSOR_ON		1
@@ -138,6 +139,23 @@ struct sensor_axis {
 	int z;
 };
 
+/* Batch mode: samples read by read() on the misc device */
+struct sensor_sample {
+	__s64 timestamp;	/* CLOCK_MONOTONIC, ns */
+	__s32 x;
+	__s32 y;
+	__s32 z;
+	__s32 reserved;
+};
+
+struct sensor_batch_config {
+	int rate;		/* sample rate in Hz, 0 to leave batch mode */
+	int period_ms;		/* how often the hardware FIFO is drained */
+};
+
+#define SENSOR_BATCH_SAMPLES	1024
+#define SENSOR_BATCH_CHUNK	128
+
 struct sensor_flag {
 	atomic_t a_flag;
 	atomic_t m_flag;
@@ -170,6 +188,12 @@ struct sensor_operate {
 	int (*report)(struct i2c_client *client);
 	int (*suspend)(struct i2c_client *client);
 	int (*resume)(struct i2c_client *client);
+	/*
+	 * hardware FIFO, batch returns the rate the hardware actually runs at
+	 * when enabling, read_fifo returns -EOVERFLOW if samples were lost
+	 */
+	int (*batch)(struct i2c_client *client, int enable, int rate);
+	int (*read_fifo)(struct i2c_client *client, struct sensor_axis *axis, int max);
 	struct miscdevice *misc_dev;
 };
 
@@ -197,6 +221,13 @@ struct sensor_private_data {
 	struct sensor_operate *ops;
 	struct file_operations fops;
 	struct miscdevice miscdev;
+	int batch_rate;
+	int batch_ms;
+	s64 batch_ts;
+	struct sensor_axis *batch_buf;
+	DECLARE_KFIFO_PTR(batch_fifo, struct sensor_sample);
+	struct mutex batch_mutex;
+	wait_queue_head_t batch_wq;
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct early_suspend early_suspend;
 #endif
@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Copyright (C) 2023 Rockchip Electronics Co., Ltd.
+ */
+
+#ifndef __ROCKCHIP_AMP_RING_H
+#define __ROCKCHIP_AMP_RING_H
+
+#include <linux/err.h>
+#include <linux/types.h>
+
+struct rk_amp_ring;
+
+#if IS_REACHABLE(CONFIG_ROCKCHIP_AMP_RING)
+struct rk_amp_ring *rk_amp_ring_get(const char *name,
+				    void (*notify)(void *data), void *data);
+void rk_amp_ring_put(struct rk_amp_ring *ring);
+size_t rk_amp_ring_max_msg(struct rk_amp_ring *ring);
+void *rk_amp_ring_tx_reserve(struct rk_amp_ring *ring, size_t len);
+int rk_amp_ring_tx_commit(struct rk_amp_ring *ring, size_t len, bool kick);
+const void *rk_amp_ring_rx_peek(struct rk_amp_ring *ring, size_t *len);
+void rk_amp_ring_rx_release(struct rk_amp_ring *ring);
+int rk_amp_ring_kick(struct rk_amp_ring *ring);
+#else
+static inline struct rk_amp_ring *rk_amp_ring_get(const char *name,
+						  void (*notify)(void *data),
+						  void *data)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline void rk_amp_ring_put(struct rk_amp_ring *ring)
+{
+}
+
+static inline size_t rk_amp_ring_max_msg(struct rk_amp_ring *ring)
+{
+	return 0;
+}
+
+static inline void *rk_amp_ring_tx_reserve(struct rk_amp_ring *ring, size_t len)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline int rk_amp_ring_tx_commit(struct rk_amp_ring *ring, size_t len,
+					bool kick)
+{
+	return -ENODEV;
+}
+
+static inline const void *rk_amp_ring_rx_peek(struct rk_amp_ring *ring,
+					      size_t *len)
+{
+	return NULL;
+}
+
+static inline void rk_amp_ring_rx_release(struct rk_amp_ring *ring)
+{
+}
+
+static inline int rk_amp_ring_kick(struct rk_amp_ring *ring)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif /* __ROCKCHIP_AMP_RING_H */
@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Copyright (C) 2020 Rockchip Electronics Co., Ltd
+ */
+
+#ifndef _ROCKCHIP_DECOMPRESS_H
+#define _ROCKCHIP_DECOMPRESS_H
+
+#include <linux/bits.h>
+#include <linux/errno.h>
+#include <linux/types.h>
+
+enum decom_mod {
+	LZ4_MOD,
+	GZIP_MOD,
+	ZLIB_MOD,
+};
+
+/* The high 16 bits of the mode are flags */
+#define DECOM_NOBLOCKING	BIT(16)
+
+static inline u32 rk_get_decom_mode(u32 mode)
+{
+	return mode & 0x0000ffff;
+}
+
+static inline bool rk_get_noblocking_flag(u32 mode)
+{
+	return !!(mode & DECOM_NOBLOCKING);
+}
+
+#ifdef CONFIG_ROCKCHIP_HW_DECOMPRESS
+/*
+ * There is a single engine. Hold rk_decom_lock() from rk_decom_start() until
+ * rk_decom_wait_done() returns, rk_decom_trylock() returns 1 if it was taken.
+ */
+void rk_decom_lock(void);
+int rk_decom_trylock(void);
+void rk_decom_unlock(void);
+int rk_decom_start(u32 mode, phys_addr_t src, phys_addr_t dst, u32 dst_max_size);
+/* timeout in seconds */
+int rk_decom_wait_done(u32 timeout, u64 *decom_len);
+#else
+static inline void rk_decom_lock(void)
+{
+}
+
+static inline int rk_decom_trylock(void)
+{
+	return 1;
+}
+
+static inline void rk_decom_unlock(void)
+{
+}
+
+static inline int rk_decom_start(u32 mode, phys_addr_t src, phys_addr_t dst,
+				 u32 dst_max_size)
+{
+	return -ENODEV;
+}
+
+static inline int rk_decom_wait_done(u32 timeout, u64 *decom_len)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif /* _ROCKCHIP_DECOMPRESS_H */
@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Copyright (C) 2023 Rockchip Electronics Co., Ltd.
+ */
+
+#ifndef _ROCKCHIP_THUNDERBOOT_PRELOAD_H
+#define _ROCKCHIP_THUNDERBOOT_PRELOAD_H
+
+#include <linux/soc/rockchip/rockchip_thunderboot_service.h>
+
+struct device_node;
+
+#ifdef CONFIG_ROCKCHIP_THUNDER_BOOT_PRELOAD
+void rk_tb_preload_storage_done(struct device_node *storage, int err);
+int rk_tb_preload_register_cb(const char *name, struct rk_tb_client *client);
+int rk_tb_preload_status(const char *name);
+#else
+static inline void rk_tb_preload_storage_done(struct device_node *storage,
+					      int err)
+{
+}
+
+static inline int rk_tb_preload_register_cb(const char *name,
+					    struct rk_tb_client *client)
+{
+	return -ENODEV;
+}
+
+static inline int rk_tb_preload_status(const char *name)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif
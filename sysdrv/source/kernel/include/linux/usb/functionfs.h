@@ -4,4 +4,40 @@
 
 #include <uapi/linux/usb/functionfs.h>
 
+#ifndef FUNCTIONFS_DMABUF_ATTACH
+/*
+ * dma-buf endpoint transfers, with the numbers and layout used by later
+ * upstream kernels so that applications may share their definitions.
+ */
+
+/**
+ * struct usb_ffs_dmabuf_transfer_req - Transfer request for a DMABUF object
+ * @fd:		file descriptor of the DMABUF object
+ * @flags:	must be 0
+ * @length:	number of bytes used in this DMABUF for the data transfer
+ */
+struct usb_ffs_dmabuf_transfer_req {
+	int fd;
+	__u32 flags;
+	__u64 length;
+} __attribute__((packed));
+
+/* Attach the DMABUF object, identified by its file descriptor, to the
+ * data endpoint. Returns zero on success, and a negative errno value
+ * on error. */
+#define FUNCTIONFS_DMABUF_ATTACH	_IOW('g', 131, int)
+
+/* Detach the given DMABUF object, identified by its file descriptor,
+ * from the data endpoint. Returns zero on success, and a negative
+ * errno value on error. */
+#define FUNCTIONFS_DMABUF_DETACH	_IOW('g', 132, int)
+
+/* Enqueue the previously attached DMABUF to the transfer queue.
+ * The argument is a structure that packs the DMABUF's file descriptor,
+ * the size in bytes to transfer, and flags. Returns zero on success,
+ * and a negative errno value on error. */
+#define FUNCTIONFS_DMABUF_TRANSFER	_IOW('g', 133, \
+					     struct usb_ffs_dmabuf_transfer_req)
+#endif
+
 #endif
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * uvc_bind.h -- in-kernel frame source for the UVC gadget function
+ *
+ * Copyright (C) 2023 Rockchip Electronics Co., Ltd.
+ */
+
+#ifndef __LINUX_USB_UVC_BIND_H
+#define __LINUX_USB_UVC_BIND_H
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+struct dma_buf;
+struct uvcg_bind;
+
+/**
+ * struct uvcg_bind_buffer - a frame handed to a UVC gadget function
+ * @dbuf: dma-buf holding the frame, the gadget takes its own reference
+ * @offset: offset of the frame in @dbuf
+ * @bytesused: size of the frame in bytes
+ * @timestamp: capture time in ns (CLOCK_MONOTONIC) used for the payload
+ *	PTS, or 0 to stamp the frame when it starts to be sent
+ * @error: set before @release if the frame was dropped rather than sent
+ * @release: called once the gadget is done with the frame, possibly from
+ *	interrupt context
+ * @priv: for the frame source
+ *
+ * The frame source owns the structure and must keep it around until
+ * @release is called. Device writes to @dbuf must be complete when the frame
+ * is queued.
+ */
+struct uvcg_bind_buffer {
+	struct dma_buf *dbuf;
+	unsigned int offset;
+	unsigned int bytesused;
+	u64 timestamp;
+	bool error;
+	void (*release)(struct uvcg_bind_buffer *buf);
+	void *priv;
+};
+
+#if IS_ENABLED(CONFIG_USB_F_UVC)
+struct uvcg_bind *uvcg_bind_get(const char *name);
+void uvcg_bind_put(struct uvcg_bind *bind);
+int uvcg_bind_queue(struct uvcg_bind *bind, struct uvcg_bind_buffer *buf);
+#else
+static inline struct uvcg_bind *uvcg_bind_get(const char *name)
+{
+	return NULL;
+}
+
+static inline void uvcg_bind_put(struct uvcg_bind *bind)
+{
+}
+
+static inline int uvcg_bind_queue(struct uvcg_bind *bind,
+				  struct uvcg_bind_buffer *buf)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif /* __LINUX_USB_UVC_BIND_H */
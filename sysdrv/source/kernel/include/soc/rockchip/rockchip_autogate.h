@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2023 Rockchip Electronics Co., Ltd
+ */
+
+#ifndef __SOC_ROCKCHIP_AUTOGATE_H
+#define __SOC_ROCKCHIP_AUTOGATE_H
+
+#include <linux/clk.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+
+/**
+ * struct rockchip_autogate - idle clock gating for a media block
+ * @lock: protects @armed and @gated
+ * @clks: the block's clocks, prepared and enabled by the driver
+ * @num_clks: number of entries in @clks
+ * @armed: the driver holds the clocks enabled, so they may be gated
+ * @gated: the clocks are currently disabled by the helper
+ *
+ * The driver keeps the clocks prepared while the block is powered and lets
+ * the helper disable them whenever the block goes idle, without waiting for
+ * the power-off delay to expire.
+ */
+struct rockchip_autogate {
+	spinlock_t lock;
+	struct clk_bulk_data *clks;
+	int num_clks;
+	bool armed;
+	bool gated;
+};
+
+#if IS_REACHABLE(CONFIG_ROCKCHIP_AUTOGATE)
+void rockchip_autogate_init(struct rockchip_autogate *ag,
+			    struct clk_bulk_data *clks, int num_clks);
+void rockchip_autogate_arm(struct rockchip_autogate *ag);
+void rockchip_autogate_disarm(struct rockchip_autogate *ag);
+void rockchip_autogate_gate(struct rockchip_autogate *ag);
+int rockchip_autogate_ungate(struct rockchip_autogate *ag);
+#else
+static inline void rockchip_autogate_init(struct rockchip_autogate *ag,
+					  struct clk_bulk_data *clks,
+					  int num_clks)
+{
+}
+
+static inline void rockchip_autogate_arm(struct rockchip_autogate *ag)
+{
+}
+
+static inline void rockchip_autogate_disarm(struct rockchip_autogate *ag)
+{
+}
+
+static inline void rockchip_autogate_gate(struct rockchip_autogate *ag)
+{
+}
+
+static inline int rockchip_autogate_ungate(struct rockchip_autogate *ag)
+{
+	return 0;
+}
+#endif
+
+#endif /* __SOC_ROCKCHIP_AUTOGATE_H */
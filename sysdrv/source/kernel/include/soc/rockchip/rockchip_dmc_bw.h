@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2023 Rockchip Electronics Co. Ltd.
+ */
+
+#ifndef __SOC_ROCKCHIP_DMC_BW_H
+#define __SOC_ROCKCHIP_DMC_BW_H
+
+#include <linux/err.h>
+
+struct seq_file;
+struct dmcfreq_bw_vote;
+
+#if IS_REACHABLE(CONFIG_ARM_ROCKCHIP_DMC_DEVFREQ)
+struct dmcfreq_bw_vote *rockchip_dmcfreq_bw_get(const char *name);
+void rockchip_dmcfreq_bw_put(struct dmcfreq_bw_vote *vote);
+int rockchip_dmcfreq_bw_set(struct dmcfreq_bw_vote *vote,
+			    unsigned int mbyte);
+unsigned int rockchip_dmcfreq_bw_total(void);
+void rockchip_dmcfreq_bw_show(struct seq_file *m);
+#else
+static inline struct dmcfreq_bw_vote *rockchip_dmcfreq_bw_get(const char *name)
+{
+	return NULL;
+}
+
+static inline void rockchip_dmcfreq_bw_put(struct dmcfreq_bw_vote *vote)
+{
+}
+
+static inline int rockchip_dmcfreq_bw_set(struct dmcfreq_bw_vote *vote,
+					  unsigned int mbyte)
+{
+	return 0;
+}
+
+static inline unsigned int rockchip_dmcfreq_bw_total(void)
+{
+	return 0;
+}
+
+static inline void rockchip_dmcfreq_bw_show(struct seq_file *m)
+{
+}
+#endif
+
+#endif
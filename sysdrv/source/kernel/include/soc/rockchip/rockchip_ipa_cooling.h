@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2023 Rockchip Electronics Co., Ltd
+ */
+
+#ifndef __SOC_ROCKCHIP_IPA_COOLING_H
+#define __SOC_ROCKCHIP_IPA_COOLING_H
+
+#include <linux/err.h>
+
+struct clk;
+struct device;
+struct thermal_cooling_device;
+
+#if IS_REACHABLE(CONFIG_ROCKCHIP_IPA)
+struct thermal_cooling_device *
+rockchip_ipa_cooling_register(struct device *dev, struct clk *clk,
+			      char *lkg_name);
+void rockchip_ipa_cooling_unregister(struct thermal_cooling_device *cdev);
+#else
+static inline struct thermal_cooling_device *
+rockchip_ipa_cooling_register(struct device *dev, struct clk *clk,
+			      char *lkg_name)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline void
+rockchip_ipa_cooling_unregister(struct thermal_cooling_device *cdev)
+{
+}
+#endif
+
+#endif /* __SOC_ROCKCHIP_IPA_COOLING_H */
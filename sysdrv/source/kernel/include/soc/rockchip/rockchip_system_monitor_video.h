@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2023 Rockchip Electronics Co. Ltd.
+ */
+
+#ifndef __SOC_ROCKCHIP_SYSTEM_MONITOR_VIDEO_H
+#define __SOC_ROCKCHIP_SYSTEM_MONITOR_VIDEO_H
+
+#include <linux/types.h>
+
+struct video_info;
+
+#if IS_REACHABLE(CONFIG_ROCKCHIP_SYSTEM_MONITOR)
+struct video_info *rockchip_system_monitor_add_video(unsigned int width,
+						     unsigned int height,
+						     unsigned int framerate,
+						     bool ishevc);
+void rockchip_system_monitor_del_video(struct video_info *video_info);
+unsigned int rockchip_system_monitor_get_video_load(void);
+#else
+static inline struct video_info *
+rockchip_system_monitor_add_video(unsigned int width, unsigned int height,
+				  unsigned int framerate, bool ishevc)
+{
+	return NULL;
+}
+
+static inline void
+rockchip_system_monitor_del_video(struct video_info *video_info)
+{
+}
+
+static inline unsigned int rockchip_system_monitor_get_video_load(void)
+{
+	return 0;
+}
+#endif
+
+#endif
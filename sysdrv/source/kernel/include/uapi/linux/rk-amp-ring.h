@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * Copyright (C) 2023 Rockchip Electronics Co., Ltd.
+ *
+ * Shared memory message rings between Linux and an AMP core or MCU.
+ *
+ * The region starts with a struct rk_amp_ring_hdr and holds two single
+ * producer single consumer rings, "tx" written by Linux and "rx" written by
+ * the remote side. Every ring has a control block followed by slot_num
+ * slots of slot_size bytes, each slot starting with a struct
+ * rk_amp_ring_slot. slot_num is a power of two and head/tail are free
+ * running, a ring is empty when head == tail and full when
+ * head - tail == slot_num.
+ *
+ * The producer fills slot (head & (slot_num - 1)), then publishes it by
+ * storing head + 1. The consumer reads the slot at tail, then stores
+ * tail + 1. Both sides need a barrier between the slot accesses and the
+ * index update.
+ *
+ * A doorbell is rung on the mailbox after a message is pushed to an empty
+ * ring, and after a slot is freed in a full one. To not lose it, each side
+ * issues a full barrier between storing its index and loading the other
+ * one, and checks the ring again before it waits.
+ *
+ * Linux formats the region at probe and writes magic last, the remote side
+ * must not touch the rings before it sees RK_AMP_RING_MAGIC.
+ */
+
+#ifndef _UAPI_RK_AMP_RING_H
+#define _UAPI_RK_AMP_RING_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define RK_AMP_RING_MAGIC	0x474e5241	/* "ARNG" */
+#define RK_AMP_RING_VERSION	1
+#define RK_AMP_RING_ALIGN	64
+
+struct rk_amp_ring_hdr {
+	__u32 magic;
+	__u32 version;
+	__u32 slot_size;
+	__u32 slot_num;
+	__u32 tx_offset;
+	__u32 rx_offset;
+	__u32 reserved[10];
+};
+
+/* head and tail sit on their own cache lines */
+struct rk_amp_ring_ctrl {
+	__u32 head;
+	__u32 reserved0[15];
+	__u32 tail;
+	__u32 reserved1[15];
+};
+
+struct rk_amp_ring_slot {
+	__u32 len;
+	__u32 flags;
+	__u8 data[];
+};
+
+/**
+ * struct rk_amp_ring_info - layout of the region, for mmap() users
+ * @size: size of the region
+ * @slot_size: size of a slot, including struct rk_amp_ring_slot
+ * @slot_num: number of slots per ring
+ * @tx_offset: offset of the tx ring control block, slots follow it
+ * @rx_offset: offset of the rx ring control block, slots follow it
+ */
+struct rk_amp_ring_info {
+	__u32 size;
+	__u32 slot_size;
+	__u32 slot_num;
+	__u32 tx_offset;
+	__u32 rx_offset;
+	__u32 reserved[3];
+};
+
+#define RK_AMP_RING_BASE		'A'
+#define RK_AMP_RING_IOC_INFO		_IOR(RK_AMP_RING_BASE, 0, struct rk_amp_ring_info)
+/* Ring the doorbell, for users driving the tx ring through mmap() */
+#define RK_AMP_RING_IOC_KICK		_IO(RK_AMP_RING_BASE, 1)
+
+#endif /* _UAPI_RK_AMP_RING_H */
@@ -28,7 +28,20 @@ struct rk_decom_param {
 	__u64 decom_data_len;
 };
 
+/*
+ * input of RK_DECOM_SUBMIT, and what read() returns once the job is done.
+ * user_data is handed back untouched, ret is 0 or a negative errno and
+ * param.decom_data_len the decompressed size.
+ */
+struct rk_decom_job {
+	struct rk_decom_param param;
+	__u64 user_data;
+	__s32 ret;
+	__u32 reserved;
+};
+
 #define  RK_DECOM_MAGIC		'D'
 #define  RK_DECOM_USER		_IOWR(RK_DECOM_MAGIC, 101, struct rk_decom_param)
+#define  RK_DECOM_SUBMIT	_IOW(RK_DECOM_MAGIC, 102, struct rk_decom_job)
 
 #endif
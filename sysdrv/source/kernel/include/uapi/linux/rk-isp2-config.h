@@ -60,6 +60,23 @@
 #define RKISP_CMD_GET_BAY3D_BUFFD \
 	_IOR('V', BASE_VIDIOC_PRIVATE + 15, struct rkisp_bay3dbuf_info)
 
+/* 3a stats ring to mmap, slot_num 0 to free */
+#define RKISP_CMD_STATS_RING_CFG \
+	_IOWR('V', BASE_VIDIOC_PRIVATE + 16, struct rkisp_stats_ring_cfg)
+
+/* readback schedule for multi device */
+#define RKISP_CMD_GET_SCHED \
+	_IOR('V', BASE_VIDIOC_PRIVATE + 17, struct rkisp_sched_cfg)
+
+#define RKISP_CMD_SET_SCHED \
+	_IOW('V', BASE_VIDIOC_PRIVATE + 18, struct rkisp_sched_cfg)
+
+#define RKISP_CMD_GET_WARM_INFO \
+	_IOR('V', BASE_VIDIOC_PRIVATE + 19, struct rkisp_warm_info)
+
+#define RKISP_CMD_SET_WARM_AE \
+	_IOW('V', BASE_VIDIOC_PRIVATE + 20, struct rkisp_warm_ae)
+
 /****************ISP VIDEO IOCTL******************************/
 
 #define RKISP_CMD_GET_CSI_MEMORY_MODE \
@@ -103,6 +120,36 @@
 
 #define RKISP_CMD_SET_IQTOOL_CONN_ID \
 	_IOW('V', BASE_VIDIOC_PRIVATE + 113, int)
+
+#define RKISP_CMD_GET_SLICE_LINE \
+	_IOR('V', BASE_VIDIOC_PRIVATE + 114, int)
+/* set slice line before VIDIOC_STREAMON, 0 to disable */
+#define RKISP_CMD_SET_SLICE_LINE \
+	_IOW('V', BASE_VIDIOC_PRIVATE + 115, int)
+
+#define RKISP_CMD_GET_STARVE_POLICY \
+	_IOR('V', BASE_VIDIOC_PRIVATE + 116, int)
+/* set starve policy before VIDIOC_STREAMON, enum rkisp_starve_policy */
+#define RKISP_CMD_SET_STARVE_POLICY \
+	_IOW('V', BASE_VIDIOC_PRIVATE + 117, int)
+
+/* share rockit buffer to v4l2 user, max buffers to hold, 0 to disable */
+#define RKISP_CMD_SET_SHARE_BUF_NUM \
+	_IOW('V', BASE_VIDIOC_PRIVATE + 118, int)
+
+#define RKISP_CMD_SHARE_DQBUF \
+	_IOR('V', BASE_VIDIOC_PRIVATE + 119, struct rkisp_share_buf)
+
+#define RKISP_CMD_SHARE_QBUF \
+	_IOW('V', BASE_VIDIOC_PRIVATE + 120, struct rkisp_share_buf)
+
+/* video event, u.data is struct rkisp_slice_info */
+#define RKISP_V4L2_EVENT_SLICE_READY \
+	(V4L2_EVENT_PRIVATE_START + 4)
+
+/* video event, share buffer ready to RKISP_CMD_SHARE_DQBUF */
+#define RKISP_V4L2_EVENT_SHARE_READY \
+	(V4L2_EVENT_PRIVATE_START + 5)
 /*************************************************************/
 
 #define ISP2X_ID_DPCC			(0)
@@ -337,6 +384,81 @@ struct rkisp_bay3dbuf_info {
 	} u;
 } __attribute__ ((packed));
 
+#define RKISP_SCHED_PRIO_MAX 255
+#define RKISP_SCHED_FPS_MAX 240
+
+/* struct rkisp_sched_cfg
+ * readback schedule of virtual isp to share one hardware
+ * prio: higher value first to readback, 0 ~ RKISP_SCHED_PRIO_MAX
+ * fps: target frame rate, readback over it to low priority,
+ *      0 no limit, max RKISP_SCHED_FPS_MAX
+ */
+struct rkisp_sched_cfg {
+	u32 prio;
+	u32 fps;
+} __attribute__ ((packed));
+
+/* struct rkisp_warm_ae
+ * last converged ae result saved with warm resume snapshot
+ */
+struct rkisp_warm_ae {
+	u32 exp_time[3];
+	u32 exp_gain[3];
+	u32 exp_isp_dgain[3];
+	u32 dcg_mode[3];
+} __attribute__ ((packed));
+
+/* struct rkisp_warm_info
+ * warm resume snapshot state of current stream
+ * valid: 1 isp first params from snapshot, 0 snapshot invalid or none
+ * frame_id: frame id at snapshot saved
+ * ae: ae result at snapshot saved, to init sensor exposure
+ */
+struct rkisp_warm_info {
+	u32 valid;
+	u32 frame_id;
+	struct rkisp_warm_ae ae;
+} __attribute__ ((packed));
+
+#define RKISP_STATS_RING_SLOT_MAX 8
+
+/* struct rkisp_stats_ring_cfg
+ * event_fd: eventfd signal when slot write, -1 for no signal
+ * slot_num: slot count of the ring, 0 to free
+ * buf_fd: return dma-buf fd of the ring to mmap
+ * buf_size: return ring size
+ */
+struct rkisp_stats_ring_cfg {
+	int event_fd;
+	u32 slot_num;
+	int buf_fd;
+	u32 buf_size;
+} __attribute__ ((packed));
+
+/* struct rkisp_stats_ring_head
+ * head of the ring, slots following from slot_offset
+ * write_cnt: slot write count, last slot is (write_cnt - 1) % slot_num
+ */
+struct rkisp_stats_ring_head {
+	u32 slot_num;
+	u32 slot_size;
+	u32 slot_offset;
+	u32 write_cnt;
+} __attribute__ ((packed));
+
+/* struct rkisp_stats_ring_slot
+ * head of each slot, stats buffer of the isp version following
+ * seq: odd when isp writing, read again to check after copy
+ * size: stats buffer size
+ */
+struct rkisp_stats_ring_slot {
+	u32 seq;
+	u32 frame_id;
+	u64 timestamp;
+	u32 size;
+	u32 reserved;
+} __attribute__ ((packed));
+
 #define RKISP_CMSK_WIN_MAX 12
 #define RKISP_CMSK_WIN_MAX_V30 8
 #define RKISP_CMSK_MOSAIC_MODE 0
@@ -416,6 +538,48 @@ struct rkisp_wrap_info {
 	int height;
 };
 
+/* struct rkisp_share_buf
+ * read only view of buffer written by isp for rockit
+ * fd: dma-buf fd, new for each dequeue, user to close it
+ * index: buffer id, return by RKISP_CMD_SHARE_QBUF
+ * offset: plane offset in dma-buf
+ */
+struct rkisp_share_buf {
+	int fd;
+	unsigned int index;
+	unsigned int sequence;
+	long long timestamp;
+	unsigned int width;
+	unsigned int height;
+	unsigned int bytesperline;
+	unsigned int size;
+	unsigned int offset[2];
+} __attribute__ ((packed));
+
+/* stream output policy if no buffer from user
+ * RKISP_STARVE_GATE: close mi write, frame no to ddr
+ * RKISP_STARVE_KEEP: rewrite the last buffer, hold it until new buffer
+ * RKISP_STARVE_DUMMY: write to dummy buffer
+ */
+enum rkisp_starve_policy {
+	RKISP_STARVE_GATE = 0,
+	RKISP_STARVE_KEEP,
+	RKISP_STARVE_DUMMY,
+};
+
+/* struct rkisp_slice_info
+ * sequence: frame id of the buffer in writing
+ * index: vb2 buffer index in writing, -1 if no buffer
+ * line: lines of the stream output written to buffer
+ * height: stream output height
+ */
+struct rkisp_slice_info {
+	unsigned int sequence;
+	int index;
+	unsigned int line;
+	unsigned int height;
+} __attribute__ ((packed));
+
 #define RKISP_TB_STREAM_BUF_MAX 5
 struct rkisp_tb_stream_buf {
 	unsigned int dma_addr;
@@ -109,10 +109,41 @@
 #define RKISPP_CMD_FEC_BUF_DEL \
 	_IOW('V', BASE_VIDIOC_PRIVATE + 12, int)
 
+/**output buffer share to more consumer**/
+#define RKISPP_CMD_SET_SHARE_BUF_NUM \
+	_IOW('V', BASE_VIDIOC_PRIVATE + 13, int)
+#define RKISPP_CMD_SHARE_DQBUF \
+	_IOWR('V', BASE_VIDIOC_PRIVATE + 14, struct rkispp_share_buf)
+#define RKISPP_CMD_SHARE_QBUF \
+	_IOW('V', BASE_VIDIOC_PRIVATE + 15, struct rkispp_share_buf)
+
 /************EVENT_PRIVATE**************/
 #define RKISPP_V4L2_EVENT_TNR_COMPLETE  \
 	(V4L2_EVENT_PRIVATE_START + 3)
 
+/* event data: struct rkispp_share_buf without fd */
+#define RKISPP_V4L2_EVENT_SHARE_READY  \
+	(V4L2_EVENT_PRIVATE_START + 4)
+
+/* struct rkispp_share_buf
+ * output buffer shared to consumers other than the queue owner,
+ * buffer back to ispp only when owner and all consumers release it.
+ * index: vb2 buffer index
+ * sequence: frame id, dqbuf input as last got frame id, 0 for first
+ * timestamp: frame timestamp in ns
+ * fd: dma-buf fd of the buffer, close after qbuf. It is read only for
+ *     V4L2_MEMORY_MMAP queues; for V4L2_MEMORY_DMABUF queues it is the
+ *     dma-buf the owner queued, with the access mode the owner gave it.
+ * qbuf only releases buffers got by dqbuf on the same file handle, the
+ * buffers still held are released when the handle is closed.
+ */
+struct rkispp_share_buf {
+	u32 index;
+	u32 sequence;
+	u64 timestamp;
+	s32 fd;
+} __attribute__ ((packed));
+
 struct rkispp_fec_in_out {
 	int in_width;
 	int in_height;
@@ -44,6 +44,31 @@ enum hdmirx_color_space {
 	HDMIRX_BT2020_RGB_OR_YCC = 6,
 };
 
+/**
+ * struct rk_hdmirx_fence - fence signalled once a queued buffer is filled
+ * @index: index of a buffer queued with VIDIOC_QBUF
+ * @fd: returned sync_file fd, the fence carries an error if the buffer is
+ *	returned without being filled
+ */
+struct rk_hdmirx_fence {
+	__u32 index;
+	__s32 fd;
+};
+
+/**
+ * struct rk_hdmirx_line_event - payload of RK_HDMIRX_V4L2_EVENT_LINE_FLAG
+ * @sequence: sequence the buffer will carry once it is dequeued
+ * @index: index of the buffer being filled
+ * @line: number of lines already written to the buffer
+ * @height: height of the frame
+ */
+struct rk_hdmirx_line_event {
+	__u32 sequence;
+	__u32 index;
+	__u32 line;
+	__u32 height;
+};
+
 /* Private v4l2 ioctl */
 #define RK_HDMIRX_CMD_GET_FPS \
 	_IOR('V', BASE_VIDIOC_PRIVATE + 0, int)
@@ -78,8 +103,19 @@ enum hdmirx_color_space {
 #define RK_HDMIRX_CMD_GET_COLOR_SPACE \
 	_IOR('V', BASE_VIDIOC_PRIVATE + 10, int)
 
+/* Line of the frame raising the line flag event, 0 for the middle */
+#define RK_HDMIRX_CMD_SET_LINE_FLAG \
+	_IOW('V', BASE_VIDIOC_PRIVATE + 11, int)
+
+#define RK_HDMIRX_CMD_GET_BUF_FENCE \
+	_IOWR('V', BASE_VIDIOC_PRIVATE + 12, struct rk_hdmirx_fence)
+
 /* Private v4l2 event */
 #define RK_HDMIRX_V4L2_EVENT_SIGNAL_LOST \
 	(V4L2_EVENT_PRIVATE_START + 1)
 
+/* Part of the current frame is in memory, see struct rk_hdmirx_line_event */
+#define RK_HDMIRX_V4L2_EVENT_LINE_FLAG \
+	(V4L2_EVENT_PRIVATE_START + 2)
+
 #endif /* _UAPI_RK_HDMIRX_CONFIG_H */